@@ -64,7 +64,7 @@ void benchmark_compression() {
                                                     &output_data, &output_size);
         
         auto end = std::chrono::high_resolution_clock::now();
-        auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(end - start);
+        const std::chrono::duration<double, std::milli> duration = end - start;
         
         if (result == FRESCO_OK) {
             double compression_ratio = static_cast<double>(data_size) / output_size;
@@ -0,0 +1,386 @@
+/**
+ * @file benchmark_corpus.cpp
+ * @brief Benchmark over a directory of real images
+ * @author Mehmet T. AKALIN
+ * @date 2025
+ * @license MIT
+ */
+
+#include "benchmark_corpus.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <vector>
+
+namespace {
+
+struct FileResult {
+    std::string name;
+    uint32_t width = 0;
+    uint32_t height = 0;
+    size_t compressed_size = 0;
+    double psnr = NAN;                // NAN when the input is not raw pixels
+    double ssim = NAN;
+    std::vector<double> encode_ms;
+    std::vector<double> decode_ms;
+
+    double megapixels() const { return static_cast<double>(width) * height / 1e6; }
+};
+
+// Nearest-rank percentile
+double percentile(std::vector<double> samples, double p) {
+    if (samples.empty()) {
+        return NAN;
+    }
+    std::sort(samples.begin(), samples.end());
+    const size_t rank = static_cast<size_t>(std::ceil(p / 100.0 * samples.size()));
+    return samples[std::min(std::max<size_t>(rank, 1), samples.size()) - 1];
+}
+
+double sum(const std::vector<double>& values) {
+    double total = 0.0;
+    for (double value : values) {
+        total += value;
+    }
+    return total;
+}
+
+double psnr(const std::vector<uint8_t>& a, const uint8_t* b) {
+    double error = 0.0;
+    for (size_t i = 0; i < a.size(); i++) {
+        const double d = static_cast<double>(a[i]) - b[i];
+        error += d * d;
+    }
+    error /= static_cast<double>(a.size());
+    return error == 0.0 ? 99.0 : 10.0 * std::log10(255.0 * 255.0 / error);
+}
+
+std::vector<double> luma(const uint8_t* pixels, uint32_t width, uint32_t height,
+                         uint32_t channels) {
+    std::vector<double> y(static_cast<size_t>(width) * height);
+    for (size_t i = 0; i < y.size(); i++) {
+        const uint8_t* p = pixels + i * channels;
+        y[i] = channels >= 3 ? 0.299 * p[0] + 0.587 * p[1] + 0.114 * p[2] : p[0];
+    }
+    return y;
+}
+
+// Mean SSIM of the luma over 8x8 windows every 4 pixels
+double ssim(const std::vector<uint8_t>& a, const uint8_t* b, uint32_t width, uint32_t height,
+            uint32_t channels) {
+    const std::vector<double> x = luma(a.data(), width, height, channels);
+    const std::vector<double> y = luma(b, width, height, channels);
+    const double c1 = (0.01 * 255) * (0.01 * 255);
+    const double c2 = (0.03 * 255) * (0.03 * 255);
+    const uint32_t window_w = std::min(width, 8u), window_h = std::min(height, 8u);
+    const double n = static_cast<double>(window_w) * window_h;
+    double total = 0.0;
+    size_t windows = 0;
+    for (uint32_t wy = 0; wy + window_h <= height; wy += 4) {
+        for (uint32_t wx = 0; wx + window_w <= width; wx += 4) {
+            double sx = 0, sy = 0, sxx = 0, syy = 0, sxy = 0;
+            for (uint32_t j = 0; j < window_h; j++) {
+                const size_t row = static_cast<size_t>(wy + j) * width + wx;
+                for (uint32_t i = 0; i < window_w; i++) {
+                    const double u = x[row + i], v = y[row + i];
+                    sx += u;
+                    sy += v;
+                    sxx += u * u;
+                    syy += v * v;
+                    sxy += u * v;
+                }
+            }
+            const double mx = sx / n, my = sy / n;
+            const double vx = sxx / n - mx * mx, vy = syy / n - my * my;
+            const double cov = sxy / n - mx * my;
+            total += ((2 * mx * my + c1) * (2 * cov + c2)) /
+                     ((mx * mx + my * my + c1) * (vx + vy + c2));
+            windows++;
+        }
+    }
+    return windows ? total / static_cast<double>(windows) : 1.0;
+}
+
+// Times one file; false if the encoder does not take it
+bool measure_file(const std::filesystem::path& path, const CorpusOptions& options,
+                  FileResult& result) {
+    std::ifstream file(path, std::ios::binary);
+    std::vector<uint8_t> input((std::istreambuf_iterator<char>(file)),
+                               std::istreambuf_iterator<char>());
+    if (!file.good() && !file.eof()) {
+        std::cerr << "skip " << path.filename().string() << ": read error\n";
+        return false;
+    }
+
+    fresco_encode_params_t encode_params = {};
+    encode_params.mode = options.lossless ? FRESCO_COMPRESSION_LOSSLESS : FRESCO_COMPRESSION_LOSSY;
+    encode_params.quality = options.quality;
+    encode_params.effort = options.effort;
+    encode_params.max_threads = options.threads;
+    fresco_decode_params_t decode_params = {};
+    decode_params.max_threads = options.threads;
+
+    fresco_encoder_t* encoder = nullptr;
+    fresco_decoder_t* decoder = nullptr;
+    fresco_encoder_create(&encoder);
+    fresco_decoder_create(&decoder);
+    fresco_error_t error = fresco_encoder_set_params(encoder, &encode_params);
+    if (error == FRESCO_OK) {
+        error = fresco_decoder_set_params(decoder, &decode_params);
+    }
+
+    result.name = path.filename().string();
+    for (uint32_t run = 0; run < options.repeat && error == FRESCO_OK; run++) {
+        uint8_t* encoded = nullptr;
+        size_t encoded_size = 0;
+        auto start = std::chrono::steady_clock::now();
+        error = fresco_encoder_encode(encoder, input.data(), input.size(), &encoded,
+                                      &encoded_size);
+        auto end = std::chrono::steady_clock::now();
+        if (error != FRESCO_OK) {
+            break;
+        }
+        result.encode_ms.push_back(std::chrono::duration<double, std::milli>(end - start).count());
+
+        uint8_t* decoded = nullptr;
+        size_t decoded_size = 0;
+        start = std::chrono::steady_clock::now();
+        error = fresco_decoder_decode(decoder, encoded, encoded_size, &decoded, &decoded_size);
+        end = std::chrono::steady_clock::now();
+        if (error != FRESCO_OK) {
+            fresco_free(encoded);
+            break;
+        }
+        result.decode_ms.push_back(std::chrono::duration<double, std::milli>(end - start).count());
+
+        if (run == 0) {
+            fresco_metadata_t metadata = {};
+            error = fresco_get_metadata(encoded, encoded_size, &metadata);
+            result.width = metadata.width;
+            result.height = metadata.height;
+            result.compressed_size = encoded_size;
+            // Quality is only defined when the input was the raw pixels
+            if (error == FRESCO_OK && decoded_size == input.size()) {
+                result.psnr = psnr(input, decoded);
+                result.ssim = ssim(input, decoded, metadata.width, metadata.height,
+                                   metadata.channels);
+            }
+        }
+        fresco_free(encoded);
+        fresco_free(decoded);
+    }
+    fresco_encoder_destroy(encoder);
+    fresco_decoder_destroy(decoder);
+
+    if (error != FRESCO_OK) {
+        std::cerr << "skip " << result.name << ": " << fresco_error_string(error) << "\n";
+        return false;
+    }
+    return true;
+}
+
+// One report row: a file, or the whole corpus
+struct Row {
+    std::string name;
+    uint32_t width, height;
+    uint64_t bytes;
+    double bpp, psnr, ssim;
+    double encode_p50, encode_p95, encode_p99;
+    double decode_p50, decode_p95, decode_p99;
+    double encode_mps, decode_mps;
+};
+
+Row file_row(const FileResult& file) {
+    const double pixels = static_cast<double>(file.width) * file.height;
+    return {file.name, file.width, file.height, file.compressed_size,
+            file.compressed_size * 8.0 / pixels, file.psnr, file.ssim,
+            percentile(file.encode_ms, 50), percentile(file.encode_ms, 95),
+            percentile(file.encode_ms, 99), percentile(file.decode_ms, 50),
+            percentile(file.decode_ms, 95), percentile(file.decode_ms, 99),
+            file.megapixels() * file.encode_ms.size() / (sum(file.encode_ms) / 1000.0),
+            file.megapixels() * file.decode_ms.size() / (sum(file.decode_ms) / 1000.0)};
+}
+
+// Latency percentiles over every run of every file; throughput and bpp over
+// all pixels; quality as the mean over the files that have it
+Row total_row(const std::vector<FileResult>& files) {
+    std::vector<double> encode_ms, decode_ms;
+    double megapixels = 0.0, encoded_megapixels = 0.0, decoded_megapixels = 0.0;
+    double psnr_sum = 0.0, ssim_sum = 0.0;
+    size_t rated = 0;
+    uint64_t bytes = 0;
+    for (const auto& file : files) {
+        encode_ms.insert(encode_ms.end(), file.encode_ms.begin(), file.encode_ms.end());
+        decode_ms.insert(decode_ms.end(), file.decode_ms.begin(), file.decode_ms.end());
+        megapixels += file.megapixels();
+        encoded_megapixels += file.megapixels() * file.encode_ms.size();
+        decoded_megapixels += file.megapixels() * file.decode_ms.size();
+        bytes += file.compressed_size;
+        if (!std::isnan(file.psnr)) {
+            psnr_sum += file.psnr;
+            ssim_sum += file.ssim;
+            rated++;
+        }
+    }
+    return {"TOTAL", 0, 0, bytes, bytes * 8.0 / (megapixels * 1e6),
+            rated ? psnr_sum / rated : NAN, rated ? ssim_sum / rated : NAN,
+            percentile(encode_ms, 50), percentile(encode_ms, 95), percentile(encode_ms, 99),
+            percentile(decode_ms, 50), percentile(decode_ms, 95), percentile(decode_ms, 99),
+            encoded_megapixels / (sum(encode_ms) / 1000.0),
+            decoded_megapixels / (sum(decode_ms) / 1000.0)};
+}
+
+std::string number(double value, int precision) {
+    if (std::isnan(value)) {
+        return "";
+    }
+    char buffer[32];
+    std::snprintf(buffer, sizeof(buffer), "%.*f", precision, value);
+    return buffer;
+}
+
+std::string json_number(double value, int precision) {
+    return std::isnan(value) ? "null" : number(value, precision);
+}
+
+std::string json_string(const std::string& text) {
+    std::string out = "\"";
+    for (char c : text) {
+        if (c == '"' || c == '\\') {
+            out += '\\';
+            out += c;
+        } else if (static_cast<unsigned char>(c) < 0x20) {
+            char escaped[8];
+            std::snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+            out += escaped;
+        } else {
+            out += c;
+        }
+    }
+    return out + "\"";
+}
+
+std::string csv_field(const std::string& text) {
+    if (text.find_first_of(",\"\n") == std::string::npos) {
+        return text;
+    }
+    std::string out = "\"";
+    for (char c : text) {
+        out += c;
+        if (c == '"') {
+            out += '"';
+        }
+    }
+    return out + "\"";
+}
+
+void write_csv(std::ostream& out, const std::vector<Row>& rows) {
+    out << "file,width,height,bytes,bpp,psnr_db,ssim,encode_p50_ms,encode_p95_ms,"
+           "encode_p99_ms,decode_p50_ms,decode_p95_ms,decode_p99_ms,encode_mps,decode_mps\n";
+    for (const auto& row : rows) {
+        // The total row has no dimensions
+        out << csv_field(row.name) << ','
+            << (row.width ? std::to_string(row.width) : "") << ','
+            << (row.height ? std::to_string(row.height) : "") << ',' << row.bytes << ',' << number(row.bpp, 4) << ',' << number(row.psnr, 3) << ','
+            << number(row.ssim, 5) << ',' << number(row.encode_p50, 3) << ','
+            << number(row.encode_p95, 3) << ',' << number(row.encode_p99, 3) << ','
+            << number(row.decode_p50, 3) << ',' << number(row.decode_p95, 3) << ','
+            << number(row.decode_p99, 3) << ',' << number(row.encode_mps, 2) << ','
+            << number(row.decode_mps, 2) << '\n';
+    }
+}
+
+void write_json_row(std::ostream& out, const Row& row, bool with_size) {
+    out << "{";
+    if (with_size) {
+        out << "\"file\": " << json_string(row.name) << ", \"width\": " << row.width
+            << ", \"height\": " << row.height << ", ";
+    }
+    out << "\"bytes\": " << row.bytes << ", \"bpp\": " << json_number(row.bpp, 4)
+        << ", \"psnr_db\": " << json_number(row.psnr, 3)
+        << ", \"ssim\": " << json_number(row.ssim, 5)
+        << ", \"encode_ms\": {\"p50\": " << json_number(row.encode_p50, 3)
+        << ", \"p95\": " << json_number(row.encode_p95, 3)
+        << ", \"p99\": " << json_number(row.encode_p99, 3) << "}"
+        << ", \"decode_ms\": {\"p50\": " << json_number(row.decode_p50, 3)
+        << ", \"p95\": " << json_number(row.decode_p95, 3)
+        << ", \"p99\": " << json_number(row.decode_p99, 3) << "}"
+        << ", \"encode_mps\": " << json_number(row.encode_mps, 2)
+        << ", \"decode_mps\": " << json_number(row.decode_mps, 2) << "}";
+}
+
+void write_json(std::ostream& out, const CorpusOptions& options, const std::vector<Row>& rows) {
+    out << "{\n  \"settings\": {\"corpus\": " << json_string(options.directory)
+        << ", \"mode\": \"" << (options.lossless ? "lossless" : "lossy") << "\""
+        << ", \"quality\": " << int(options.quality) << ", \"effort\": " << int(options.effort)
+        << ", \"threads\": " << options.threads << ", \"repeat\": " << options.repeat
+        << ", \"version\": " << json_string(fresco_get_version_string()) << "},\n";
+    out << "  \"files\": [";
+    for (size_t i = 0; i + 1 < rows.size(); i++) {
+        out << (i ? ",\n    " : "\n    ");
+        write_json_row(out, rows[i], true);
+    }
+    out << "\n  ],\n  \"total\": ";
+    write_json_row(out, rows.back(), false);
+    out << "\n}\n";
+}
+
+} // namespace
+
+int benchmark_corpus(const CorpusOptions& options) {
+    namespace fs = std::filesystem;
+    std::error_code error;
+    std::vector<fs::path> paths;
+    for (fs::directory_iterator it(options.directory, error), end; !error && it != end;
+         it.increment(error)) {
+        if (it->is_regular_file()) {
+            paths.push_back(it->path());
+        }
+    }
+    if (error) {
+        std::cerr << "Error: cannot read " << options.directory << ": " << error.message() << "\n";
+        return 1;
+    }
+    std::sort(paths.begin(), paths.end());
+
+    std::vector<FileResult> files;
+    for (const auto& path : paths) {
+        FileResult result;
+        if (measure_file(path, options, result)) {
+            std::cerr << result.name << ": " << number(percentile(result.encode_ms, 50), 2)
+                      << " ms encode, " << number(percentile(result.decode_ms, 50), 2)
+                      << " ms decode\n";
+            files.push_back(std::move(result));
+        }
+    }
+    if (files.empty()) {
+        std::cerr << "Error: no file in " << options.directory << " could be encoded\n";
+        return 1;
+    }
+
+    std::vector<Row> rows;
+    for (const auto& file : files) {
+        rows.push_back(file_row(file));
+    }
+    rows.push_back(total_row(files));
+
+    std::ofstream report_file;
+    if (!options.output.empty()) {
+        report_file.open(options.output);
+        if (!report_file) {
+            std::cerr << "Error: cannot write " << options.output << "\n";
+            return 1;
+        }
+    }
+    std::ostream& out = options.output.empty() ? std::cout : report_file;
+    if (options.format == "json") {
+        write_json(out, options, rows);
+    } else {
+        write_csv(out, rows);
+    }
+    return out.good() ? 0 : 1;
+}
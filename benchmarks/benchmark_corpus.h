@@ -0,0 +1,34 @@
+/**
+ * @file benchmark_corpus.h
+ * @brief Benchmark over a directory of real images
+ * @author Mehmet T. AKALIN
+ * @date 2025
+ * @license MIT
+ */
+
+#ifndef FRESCO_BENCHMARK_CORPUS_H
+#define FRESCO_BENCHMARK_CORPUS_H
+
+#include "fresco/fresco.h"
+#include <string>
+
+struct CorpusOptions {
+    std::string directory;
+    uint32_t threads = 0;             // Encoder and decoder max_threads (0: all cores)
+    uint32_t repeat = 5;              // Timed encodes and decodes per file
+    uint8_t quality = 85;
+    uint8_t effort = 5;
+    bool lossless = false;
+    std::string format = "csv";       // csv or json
+    std::string output;               // Report file; empty writes to stdout
+};
+
+/**
+ * Encodes and decodes every file of the directory `repeat` times and reports
+ * p50/p95/p99 latency, MP/s, bpp, PSNR and SSIM per file and for the whole
+ * corpus. Files the encoder does not accept are skipped with a note on
+ * stderr. Returns 0 on success, 1 if nothing could be measured.
+ */
+int benchmark_corpus(const CorpusOptions& options);
+
+#endif // FRESCO_BENCHMARK_CORPUS_H
@@ -87,7 +87,7 @@ void benchmark_decoding() {
                                      &decoded_data, &decoded_size);
         
         auto end = std::chrono::high_resolution_clock::now();
-        auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(end - start);
+        const std::chrono::duration<double, std::milli> duration = end - start;
         
         if (result == FRESCO_OK) {
             double speed_mbps = (decoded_size / 1024.0 / 1024.0) / (duration.count() / 1000.0);
@@ -0,0 +1,131 @@
+/**
+ * @file benchmark_effort.cpp
+ * @brief Speed against size for every effort level
+ * @author Mehmet T. AKALIN
+ * @date 2025
+ * @license MIT
+ */
+
+#include "fresco/fresco.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <iostream>
+#include <random>
+#include <vector>
+
+namespace {
+
+// Smooth shading, edges and sensor-like noise, so the coder has real work
+std::vector<uint8_t> make_photo(uint32_t size) {
+    std::vector<uint8_t> image(static_cast<size_t>(size) * size * 3);
+    std::mt19937 rng(11);
+    std::normal_distribution<double> noise(0.0, 3.0);
+    auto clamp = [](double v) { return static_cast<uint8_t>(v < 0 ? 0 : (v > 255 ? 255 : v)); };
+    for (uint32_t y = 0; y < size; y++) {
+        for (uint32_t x = 0; x < size; x++) {
+            uint8_t* p = &image[(static_cast<size_t>(y) * size + x) * 3];
+            const double shade = 110 + 60 * std::sin(x * 0.004) * std::cos(y * 0.006);
+            const double edge = ((x / 97 + y / 61) % 3) * 25.0;
+            p[0] = clamp(shade + edge + noise(rng));
+            p[1] = clamp(shade * 0.8 + 30 + noise(rng));
+            p[2] = clamp(shade * 0.6 + edge * 0.5 + 20 + noise(rng));
+        }
+    }
+    return image;
+}
+
+double median(std::vector<double> values) {
+    std::sort(values.begin(), values.end());
+    return values[values.size() / 2];
+}
+
+} // namespace
+
+void benchmark_effort() {
+    std::cout << "=== FRESCO Effort Benchmark ===" << std::endl;
+
+    // Full HD pixel count; raw input is read as square RGB
+    const uint32_t size = 1440;
+    const int repeats = 3;
+    const double megapixels = static_cast<double>(size) * size / 1e6;
+    const std::vector<uint8_t> image = make_photo(size);
+
+    std::cout << "\nImage size: " << size << "x" << size << ", quality 85, "
+              << "median of " << repeats << " runs" << std::endl;
+    std::cout << "  effort  encode MP/s  frames/s  decode MP/s    bpp   PSNR dB" << std::endl;
+
+    for (uint8_t effort = 1; effort <= 10; effort++) {
+        fresco_encode_params_t params = {};
+        params.mode = FRESCO_COMPRESSION_LOSSY;
+        params.quality = 85;
+        params.effort = effort;
+
+        std::vector<double> encode_ms, decode_ms;
+        size_t compressed_size = 0;
+        double psnr = 0.0;
+        bool failed = false;
+        for (int run = 0; run < repeats && !failed; run++) {
+            fresco_encoder_t* encoder = nullptr;
+            fresco_encoder_create(&encoder);
+            fresco_encoder_set_params(encoder, &params);
+            uint8_t* encoded = nullptr;
+            size_t encoded_size = 0;
+            auto start = std::chrono::high_resolution_clock::now();
+            fresco_error_t result = fresco_encoder_encode(encoder, image.data(), image.size(),
+                                                          &encoded, &encoded_size);
+            auto end = std::chrono::high_resolution_clock::now();
+            fresco_encoder_destroy(encoder);
+            if (result != FRESCO_OK) {
+                std::cout << "  " << int(effort) << ": Failed - " << fresco_error_string(result)
+                          << std::endl;
+                failed = true;
+                break;
+            }
+            encode_ms.push_back(std::chrono::duration<double, std::milli>(end - start).count());
+
+            fresco_decoder_t* decoder = nullptr;
+            fresco_decoder_create(&decoder);
+            uint8_t* decoded = nullptr;
+            size_t decoded_size = 0;
+            start = std::chrono::high_resolution_clock::now();
+            result = fresco_decoder_decode(decoder, encoded, encoded_size, &decoded, &decoded_size);
+            end = std::chrono::high_resolution_clock::now();
+            fresco_decoder_destroy(decoder);
+            if (result != FRESCO_OK || decoded_size != image.size()) {
+                std::cout << "  " << int(effort) << ": Decode failed" << std::endl;
+                fresco_free(encoded);
+                fresco_free(decoded);
+                failed = true;
+                break;
+            }
+            decode_ms.push_back(std::chrono::duration<double, std::milli>(end - start).count());
+
+            if (run == 0) {
+                double error = 0.0;
+                for (size_t i = 0; i < image.size(); i++) {
+                    const double d = static_cast<double>(image[i]) - decoded[i];
+                    error += d * d;
+                }
+                error /= static_cast<double>(image.size());
+                psnr = error == 0.0 ? 99.0 : 10.0 * std::log10(255.0 * 255.0 / error);
+                compressed_size = encoded_size;
+            }
+            fresco_free(encoded);
+            fresco_free(decoded);
+        }
+        if (failed) {
+            continue;
+        }
+
+        const double encode = median(encode_ms);
+        const double decode = median(decode_ms);
+        char line[128];
+        std::snprintf(line, sizeof(line), "  %6d  %11.1f  %8.1f  %11.1f  %5.2f  %8.2f",
+                      effort, megapixels / (encode / 1000.0), 1000.0 / encode,
+                      megapixels / (decode / 1000.0),
+                      compressed_size * 8.0 / (static_cast<double>(size) * size), psnr);
+        std::cout << line << std::endl;
+    }
+}
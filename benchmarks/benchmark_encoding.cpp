@@ -15,12 +15,13 @@
 void benchmark_encoding() {
     std::cout << "=== FRESCO Encoding Benchmark ===" << std::endl;
     
-    // Test different image sizes
+    // Test different image sizes. Raw input is read as square RGB, so these
+    // match the pixel counts of the common formats.
     std::vector<std::pair<size_t, size_t>> sizes = {
-        {640, 480},   // VGA
-        {1280, 720},  // HD
-        {1920, 1080}, // Full HD
-        {3840, 2160}  // 4K
+        {512, 512},   // About VGA
+        {960, 960},   // HD
+        {1440, 1440}, // Full HD
+        {2880, 2880}  // 4K
     };
     
     for (const auto& [width, height] : sizes) {
@@ -65,7 +66,7 @@ void benchmark_encoding() {
                                                         &output_data, &output_size);
             
             auto end = std::chrono::high_resolution_clock::now();
-            auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(end - start);
+            const std::chrono::duration<double, std::milli> duration = end - start;
             
             if (result == FRESCO_OK) {
                 double speed_mbps = (data_size / 1024.0 / 1024.0) / (duration.count() / 1000.0);
@@ -6,14 +6,78 @@
  * @license MIT
  */
 
+#include "benchmark_corpus.h"
 #include <iostream>
+#include <string>
 
 // Forward declarations
 void benchmark_compression();
 void benchmark_encoding();
+void benchmark_effort();
 void benchmark_decoding();
+void benchmark_vector();
+void benchmark_mesh();
+
+namespace {
+
+void print_usage(const char* program_name) {
+    std::cout << "Usage: " << program_name << " [--corpus <dir> [options]]\n\n";
+    std::cout << "Without --corpus, runs the synthetic benchmark suite.\n\n";
+    std::cout << "Corpus options:\n";
+    std::cout << "  --corpus <dir>        Encode and decode every file of the directory\n";
+    std::cout << "  --threads <count>     Threads per encode and decode (default: all cores)\n";
+    std::cout << "  --repeat <count>      Timed runs per file (default: 5)\n";
+    std::cout << "  --quality <1-100>     Quality setting (default: 85)\n";
+    std::cout << "  --effort <1-10>       Encoding effort (default: 5)\n";
+    std::cout << "  --lossless            Use lossless compression\n";
+    std::cout << "  --format <csv|json>   Report format (default: csv)\n";
+    std::cout << "  --output <file>       Write the report to a file instead of stdout\n";
+}
+
+// Returns false on a malformed command line
+bool parse_corpus_options(int argc, char** argv, CorpusOptions& options) {
+    for (int i = 1; i < argc; i++) {
+        const std::string arg = argv[i];
+        const bool has_value = i + 1 < argc;
+        try {
+            if (arg == "--corpus" && has_value) {
+                options.directory = argv[++i];
+            } else if (arg == "--threads" && has_value) {
+                options.threads = static_cast<uint32_t>(std::stoul(argv[++i]));
+            } else if (arg == "--repeat" && has_value) {
+                options.repeat = static_cast<uint32_t>(std::stoul(argv[++i]));
+            } else if (arg == "--quality" && has_value) {
+                options.quality = static_cast<uint8_t>(std::stoi(argv[++i]));
+            } else if (arg == "--effort" && has_value) {
+                options.effort = static_cast<uint8_t>(std::stoi(argv[++i]));
+            } else if (arg == "--lossless") {
+                options.lossless = true;
+            } else if (arg == "--format" && has_value) {
+                options.format = argv[++i];
+            } else if (arg == "--output" && has_value) {
+                options.output = argv[++i];
+            } else {
+                return false;
+            }
+        } catch (const std::exception&) {
+            return false;
+        }
+    }
+    return options.repeat > 0 && (options.format == "csv" || options.format == "json");
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    if (argc > 1) {
+        CorpusOptions options;
+        if (!parse_corpus_options(argc, argv, options) || options.directory.empty()) {
+            print_usage(argv[0]);
+            return 1;
+        }
+        return benchmark_corpus(options);
+    }
 
-int main() {
     std::cout << "FRESCO Performance Benchmarks\n";
     std::cout << "=============================\n\n";
     
@@ -23,9 +87,18 @@ int main() {
     benchmark_encoding();
     std::cout << "\n";
     
+    benchmark_effort();
+    std::cout << "\n";
+    
     benchmark_decoding();
     std::cout << "\n";
     
+    benchmark_vector();
+    std::cout << "\n";
+    
+    benchmark_mesh();
+    std::cout << "\n";
+    
     std::cout << "All benchmarks completed.\n";
     return 0;
 }
@@ -0,0 +1,144 @@
+/**
+ * @file benchmark_mesh.cpp
+ * @brief 3D track performance benchmarks
+ * @author Mehmet T. AKALIN
+ * @date 2025
+ * @license MIT
+ */
+
+#include "fresco/fresco.h"
+#include <iostream>
+#include <vector>
+#include <chrono>
+#include <cmath>
+
+void benchmark_mesh() {
+    std::cout << "=== FRESCO 3D Track Benchmark ===" << std::endl;
+
+    // Closed torus with normals and uvs
+    const uint32_t rings = 1024;
+    const uint32_t sides = 512;
+    const float pi = 3.14159265358979f;
+
+    std::vector<float> positions, normals, uvs;
+    std::vector<uint32_t> indices;
+    for (uint32_t i = 0; i < rings; i++) {
+        const float u = 2.0f * pi * i / rings;
+        for (uint32_t j = 0; j < sides; j++) {
+            const float v = 2.0f * pi * j / sides;
+            const float r = 3.0f + std::cos(v);
+            positions.insert(positions.end(), {r * std::cos(u), r * std::sin(u), std::sin(v)});
+            normals.insert(normals.end(),
+                           {std::cos(v) * std::cos(u), std::cos(v) * std::sin(u), std::sin(v)});
+            uvs.insert(uvs.end(), {static_cast<float>(i) / rings, static_cast<float>(j) / sides});
+        }
+    }
+    for (uint32_t i = 0; i < rings; i++) {
+        for (uint32_t j = 0; j < sides; j++) {
+            const uint32_t a = i * sides + j;
+            const uint32_t b = ((i + 1) % rings) * sides + j;
+            const uint32_t c = ((i + 1) % rings) * sides + (j + 1) % sides;
+            const uint32_t d = i * sides + (j + 1) % sides;
+            indices.insert(indices.end(), {a, b, c, a, c, d});
+        }
+    }
+
+    const fresco_mesh_t mesh = {positions.data(), normals.data(), uvs.data(),
+                                positions.size() / 3, indices.data(), indices.size() / 3};
+    const size_t raw_size = (positions.size() + normals.size() + uvs.size()) * sizeof(float) +
+                            indices.size() * sizeof(uint32_t);
+    std::cout << "Vertices: " << mesh.vertex_count << ", triangles: " << mesh.triangle_count
+              << std::endl;
+    std::cout << "Raw size: " << raw_size << " bytes" << std::endl;
+
+    fresco_encoder_t* encoder = nullptr;
+    fresco_encoder_create(&encoder);
+
+    fresco_encode_params_t params = {};
+    params.mode = FRESCO_COMPRESSION_LOSSY;
+    params.quality = 85;
+    params.effort = 5;
+    params.enable_3d = 1;
+    fresco_encoder_set_params(encoder, &params);
+    fresco_encoder_set_mesh(encoder, &mesh);
+
+    uint8_t* encoded_data = nullptr;
+    size_t encoded_size = 0;
+    auto start_time = std::chrono::high_resolution_clock::now();
+    fresco_error_t result = fresco_encoder_encode(encoder, nullptr, 0, &encoded_data, &encoded_size);
+    auto end_time = std::chrono::high_resolution_clock::now();
+    fresco_encoder_destroy(encoder);
+
+    if (result != FRESCO_OK) {
+        std::cout << "Encoding failed: " << fresco_error_string(result) << std::endl;
+        return;
+    }
+
+    auto encode_ms = std::chrono::duration_cast<std::chrono::milliseconds>(end_time - start_time);
+    std::cout << "Encoded size: " << encoded_size << " bytes ("
+              << encoded_size * 8.0 / mesh.triangle_count << " bits/triangle)" << std::endl;
+    std::cout << "Encoding time: " << encode_ms.count() << " ms" << std::endl;
+
+    fresco_decoder_t* decoder = nullptr;
+    fresco_decoder_create(&decoder);
+
+    const int iterations = 10;
+    start_time = std::chrono::high_resolution_clock::now();
+    for (int i = 0; i < iterations && result == FRESCO_OK; i++) {
+        fresco_mesh_t* decoded = nullptr;
+        result = fresco_decoder_decode_mesh(decoder, encoded_data, encoded_size, &decoded);
+        fresco_free(decoded);
+    }
+    end_time = std::chrono::high_resolution_clock::now();
+
+    if (result == FRESCO_OK) {
+        double seconds = std::chrono::duration<double>(end_time - start_time).count() / iterations;
+        std::cout << "Decoding time: " << seconds * 1e3 << " ms" << std::endl;
+        std::cout << "Decoding speed: " << (mesh.triangle_count / 1e6) / seconds
+                  << " M triangles/s" << std::endl;
+    } else {
+        std::cout << "Decoding failed: " << fresco_error_string(result) << std::endl;
+    }
+
+    fresco_free(encoded_data);
+    encoded_data = nullptr;
+
+    // Progressive: time to the coarse base level against the full mesh
+    encoder = nullptr;
+    fresco_encoder_create(&encoder);
+    params.mesh_lod_levels = 5;
+    fresco_encoder_set_params(encoder, &params);
+    fresco_encoder_set_mesh(encoder, &mesh);
+    start_time = std::chrono::high_resolution_clock::now();
+    result = fresco_encoder_encode(encoder, nullptr, 0, &encoded_data, &encoded_size);
+    end_time = std::chrono::high_resolution_clock::now();
+    fresco_encoder_destroy(encoder);
+    if (result != FRESCO_OK) {
+        std::cout << "Progressive encoding failed: " << fresco_error_string(result) << std::endl;
+        fresco_decoder_destroy(decoder);
+        return;
+    }
+
+    encode_ms = std::chrono::duration_cast<std::chrono::milliseconds>(end_time - start_time);
+    std::cout << "Progressive size (" << params.mesh_lod_levels << " levels): " << encoded_size
+              << " bytes, encoding time " << encode_ms.count() << " ms" << std::endl;
+
+    for (uint32_t level = 0; level < params.mesh_lod_levels && result == FRESCO_OK; level++) {
+        fresco_mesh_t* decoded = nullptr;
+        start_time = std::chrono::high_resolution_clock::now();
+        result = fresco_decoder_decode_mesh_lod(decoder, encoded_data, encoded_size, level,
+                                                nullptr, nullptr, &decoded);
+        end_time = std::chrono::high_resolution_clock::now();
+        if (result == FRESCO_OK) {
+            std::cout << "Level " << level << ": " << decoded->triangle_count << " triangles in "
+                      << std::chrono::duration<double>(end_time - start_time).count() * 1e3
+                      << " ms" << std::endl;
+        }
+        fresco_free(decoded);
+    }
+
+    fresco_decoder_destroy(decoder);
+    fresco_free(encoded_data);
+}
+
+// Main function moved to benchmark_main.cpp
@@ -0,0 +1,471 @@
+/**
+ * @file benchmark_stages.cpp
+ * @brief Per-stage microbenchmarks of the raster pipeline
+ * @author Mehmet T. AKALIN
+ * @date 2025
+ * @license MIT
+ *
+ * Each stage runs on one 256x256 tile in isolation, so a change to one stage
+ * shows up in its own line. Results are Google Benchmark output, and
+ * --benchmark_format=json or --benchmark_out=<file> gives the JSON that
+ * compare_benchmarks.py checks against a baseline. The SIMD paths are
+ * chosen at compile time; the "simd" context field names the ones in this
+ * build, so every dispatch level is a separate build of this target.
+ */
+
+#include "fresco/fresco.h"
+#include "core/bitpack.h"
+#include "core/container.h"
+#include "core/range_coder.h"
+#include "core/varint.h"
+#include "codecs/coefficient_coder.h"
+#include "codecs/lossy_codec.h"
+#include "codecs/wavelet.h"
+#include <benchmark/benchmark.h>
+#include <cmath>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+
+using namespace fresco;
+
+constexpr uint32_t kTile = 256;
+constexpr uint32_t kLevels = 5;
+constexpr size_t kTilePixels = static_cast<size_t>(kTile) * kTile;
+constexpr size_t kPackedValues = 65536;
+
+// Smooth shading, edges and noise, as in the effort benchmark
+std::vector<uint8_t> make_rgb(uint32_t size) {
+    std::vector<uint8_t> image(static_cast<size_t>(size) * size * 3);
+    std::mt19937 rng(11);
+    std::normal_distribution<double> noise(0.0, 3.0);
+    auto clamp = [](double v) { return static_cast<uint8_t>(v < 0 ? 0 : (v > 255 ? 255 : v)); };
+    for (uint32_t y = 0; y < size; y++) {
+        for (uint32_t x = 0; x < size; x++) {
+            uint8_t* p = &image[(static_cast<size_t>(y) * size + x) * 3];
+            const double shade = 110 + 60 * std::sin(x * 0.02) * std::cos(y * 0.03);
+            const double edge = ((x / 37 + y / 23) % 3) * 25.0;
+            p[0] = clamp(shade + edge + noise(rng));
+            p[1] = clamp(shade * 0.8 + 30 + noise(rng));
+            p[2] = clamp(shade * 0.6 + edge * 0.5 + 20 + noise(rng));
+        }
+    }
+    return image;
+}
+
+// Level-shifted luma of the test tile
+std::vector<int32_t> make_plane() {
+    const std::vector<uint8_t> rgb = make_rgb(kTile);
+    std::vector<int32_t> plane(kTilePixels);
+    for (size_t i = 0; i < kTilePixels; i++) {
+        int32_t luma, co, cg;
+        rct_forward(rgb[i * 3], rgb[i * 3 + 1], rgb[i * 3 + 2], luma, co, cg);
+        plane[i] = luma - 128;
+    }
+    return plane;
+}
+
+std::vector<int32_t> make_coefficients() {
+    std::vector<int32_t> plane = make_plane();
+    std::vector<int32_t> scratch(kTile);
+    dwt53_forward(plane.data(), kTile, kTile, kTile, kLevels, scratch.data());
+    return plane;
+}
+
+// Quantized at the default quality, as the coder sees it
+std::vector<int32_t> make_quantized() {
+    std::vector<int32_t> plane = make_coefficients();
+    const float base_step = LossyCodec::step_for_quality(85);
+    for (const auto& band : subband_layout(kTile, kTile, kLevels)) {
+        const float step = LossyCodec::band_step(base_step, 0, true, band);
+        const float rounding =
+            band.orientation == Orientation::LL ? kLowpassRounding : kDetailRounding;
+        for (uint32_t y = band.y; y < band.y + band.height; y++) {
+            for (uint32_t x = band.x; x < band.x + band.width; x++) {
+                int32_t& value = plane[static_cast<size_t>(y) * kTile + x];
+                value = LossyCodec::quantize(value, 1.0f / step, rounding);
+            }
+        }
+    }
+    return plane;
+}
+
+// Zigzagged residual-sized values for the integer packers
+std::vector<uint32_t> make_small_values() {
+    std::vector<uint32_t> values(kPackedValues);
+    std::mt19937 rng(5);
+    std::geometric_distribution<uint32_t> magnitude(0.05);
+    for (auto& value : values) {
+        value = magnitude(rng);
+    }
+    return values;
+}
+
+void set_pixels_processed(benchmark::State& state, size_t pixels) {
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations()) *
+                            static_cast<int64_t>(pixels));
+}
+
+void BM_ColorTransformForward(benchmark::State& state) {
+    const std::vector<uint8_t> rgb = make_rgb(kTile);
+    std::vector<int32_t> planes(kTilePixels * 3);
+    for (auto _ : state) {
+        for (size_t i = 0; i < kTilePixels; i++) {
+            rct_forward(rgb[i * 3], rgb[i * 3 + 1], rgb[i * 3 + 2], planes[i],
+                        planes[kTilePixels + i], planes[2 * kTilePixels + i]);
+        }
+        benchmark::DoNotOptimize(planes.data());
+        benchmark::ClobberMemory();
+    }
+    set_pixels_processed(state, kTilePixels);
+}
+BENCHMARK(BM_ColorTransformForward);
+
+void BM_ColorTransformInverse(benchmark::State& state) {
+    const std::vector<uint8_t> rgb = make_rgb(kTile);
+    std::vector<int32_t> planes(kTilePixels * 3);
+    for (size_t i = 0; i < kTilePixels; i++) {
+        rct_forward(rgb[i * 3], rgb[i * 3 + 1], rgb[i * 3 + 2], planes[i],
+                    planes[kTilePixels + i], planes[2 * kTilePixels + i]);
+    }
+    std::vector<uint8_t> out(kTilePixels * 3);
+    for (auto _ : state) {
+        for (size_t i = 0; i < kTilePixels; i++) {
+            int32_t r, g, b;
+            rct_inverse(planes[i], planes[kTilePixels + i], planes[2 * kTilePixels + i], r, g, b);
+            out[i * 3] = static_cast<uint8_t>(r);
+            out[i * 3 + 1] = static_cast<uint8_t>(g);
+            out[i * 3 + 2] = static_cast<uint8_t>(b);
+        }
+        benchmark::DoNotOptimize(out.data());
+        benchmark::ClobberMemory();
+    }
+    set_pixels_processed(state, kTilePixels);
+}
+BENCHMARK(BM_ColorTransformInverse);
+
+// The transforms work in place, so each iteration restores the input first;
+// the copy is a few percent of the transform
+void BM_WaveletForward(benchmark::State& state) {
+    const uint32_t levels = static_cast<uint32_t>(state.range(0));
+    const std::vector<int32_t> source = make_plane();
+    std::vector<int32_t> plane(kTilePixels), scratch(kTile);
+    for (auto _ : state) {
+        std::memcpy(plane.data(), source.data(), kTilePixels * sizeof(int32_t));
+        dwt53_forward(plane.data(), kTile, kTile, kTile, levels, scratch.data());
+        benchmark::DoNotOptimize(plane.data());
+    }
+    set_pixels_processed(state, kTilePixels);
+}
+BENCHMARK(BM_WaveletForward)->Arg(3)->Arg(5);
+
+void BM_WaveletInverse(benchmark::State& state) {
+    const uint32_t levels = static_cast<uint32_t>(state.range(0));
+    std::vector<int32_t> source = make_plane();
+    std::vector<int32_t> plane(kTilePixels), scratch(kTile);
+    dwt53_forward(source.data(), kTile, kTile, kTile, levels, scratch.data());
+    for (auto _ : state) {
+        std::memcpy(plane.data(), source.data(), kTilePixels * sizeof(int32_t));
+        dwt53_inverse(plane.data(), kTile, kTile, kTile, levels, 0, scratch.data());
+        benchmark::DoNotOptimize(plane.data());
+    }
+    set_pixels_processed(state, kTilePixels);
+}
+BENCHMARK(BM_WaveletInverse)->Arg(3)->Arg(5);
+
+void BM_Quantize(benchmark::State& state) {
+    const std::vector<int32_t> coefficients = make_coefficients();
+    const auto bands = subband_layout(kTile, kTile, kLevels);
+    const float base_step = LossyCodec::step_for_quality(85);
+    std::vector<int32_t> quantized(kTilePixels);
+    for (auto _ : state) {
+        for (const auto& band : bands) {
+            const float inverse_step = 1.0f / LossyCodec::band_step(base_step, 0, true, band);
+            for (uint32_t y = band.y; y < band.y + band.height; y++) {
+                const size_t row = static_cast<size_t>(y) * kTile;
+                for (uint32_t x = band.x; x < band.x + band.width; x++) {
+                    quantized[row + x] =
+                        LossyCodec::quantize(coefficients[row + x], inverse_step, kDetailRounding);
+                }
+            }
+        }
+        benchmark::DoNotOptimize(quantized.data());
+        benchmark::ClobberMemory();
+    }
+    set_pixels_processed(state, kTilePixels);
+}
+BENCHMARK(BM_Quantize);
+
+void BM_Dequantize(benchmark::State& state) {
+    const std::vector<int32_t> quantized = make_quantized();
+    const auto bands = subband_layout(kTile, kTile, kLevels);
+    const float base_step = LossyCodec::step_for_quality(85);
+    std::vector<int32_t> coefficients(kTilePixels);
+    for (auto _ : state) {
+        for (const auto& band : bands) {
+            const float step = LossyCodec::band_step(base_step, 0, true, band);
+            for (uint32_t y = band.y; y < band.y + band.height; y++) {
+                const size_t row = static_cast<size_t>(y) * kTile;
+                for (uint32_t x = band.x; x < band.x + band.width; x++) {
+                    coefficients[row + x] = LossyCodec::dequantize(quantized[row + x], step);
+                }
+            }
+        }
+        benchmark::DoNotOptimize(coefficients.data());
+        benchmark::ClobberMemory();
+    }
+    set_pixels_processed(state, kTilePixels);
+}
+BENCHMARK(BM_Dequantize);
+
+void BM_RateModel(benchmark::State& state) {
+    const std::vector<int32_t> coefficients = make_coefficients();
+    for (auto _ : state) {
+        RateModel model(1, kLevels, true);
+        model.add_plane(0, coefficients.data(), kTile, kTile, kTile);
+        benchmark::DoNotOptimize(model.estimate_bytes(LossyCodec::step_for_quality(85)));
+    }
+    set_pixels_processed(state, kTilePixels);
+}
+BENCHMARK(BM_RateModel);
+
+// Entropy coding of one quantized plane with each coder, by EntropyCoder id
+void encode_plane(EntropyCoder coder, const std::vector<int32_t>& plane,
+                  const std::vector<Subband>& bands, std::vector<uint32_t>& scratch,
+                  std::vector<uint8_t>& out) {
+    out.clear();
+    if (coder == EntropyCoder::Static) {
+        for (const auto& band : bands) {
+            encode_band_static(band, plane.data(), kTile, scratch, out);
+        }
+        return;
+    }
+    RangeEncoder encoder(out);
+    PlaneModels models;
+    for (const auto& band : bands) {
+        encode_band(encoder, models, band, plane.data(), kTile,
+                    coder == EntropyCoder::AdaptiveReduced);
+    }
+    encoder.finish();
+}
+
+void BM_EntropyEncode(benchmark::State& state) {
+    const EntropyCoder coder = static_cast<EntropyCoder>(state.range(0));
+    const std::vector<int32_t> quantized = make_quantized();
+    const auto bands = subband_layout(kTile, kTile, kLevels);
+    std::vector<uint32_t> scratch;
+    std::vector<uint8_t> out;
+    for (auto _ : state) {
+        encode_plane(coder, quantized, bands, scratch, out);
+        benchmark::DoNotOptimize(out.data());
+    }
+    set_pixels_processed(state, kTilePixels);
+    state.counters["bytes"] = static_cast<double>(out.size());
+}
+BENCHMARK(BM_EntropyEncode)->Arg(0)->Arg(1)->Arg(2);
+
+void BM_EntropyDecode(benchmark::State& state) {
+    const EntropyCoder coder = static_cast<EntropyCoder>(state.range(0));
+    const auto bands = subband_layout(kTile, kTile, kLevels);
+    std::vector<uint32_t> scratch;
+    std::vector<uint8_t> encoded;
+    encode_plane(coder, make_quantized(), bands, scratch, encoded);
+    std::vector<int32_t> plane(kTilePixels), unpacked;
+    for (auto _ : state) {
+        if (coder == EntropyCoder::Static) {
+            const uint8_t* data = encoded.data();
+            for (const auto& band : bands) {
+                data = decode_band_static(data, encoded.data() + encoded.size(), band,
+                                          plane.data(), kTile, unpacked);
+            }
+            benchmark::DoNotOptimize(data);
+        } else {
+            RangeDecoder decoder(encoded.data(), encoded.data() + encoded.size());
+            PlaneModels models;
+            for (const auto& band : bands) {
+                decode_band(decoder, models, band, plane.data(), kTile,
+                            coder == EntropyCoder::AdaptiveReduced);
+            }
+        }
+        benchmark::DoNotOptimize(plane.data());
+    }
+    set_pixels_processed(state, kTilePixels);
+}
+BENCHMARK(BM_EntropyDecode)->Arg(0)->Arg(1)->Arg(2);
+
+void BM_BitpackEncode(benchmark::State& state) {
+    const std::vector<uint32_t> values = make_small_values();
+    std::vector<uint8_t> out;
+    for (auto _ : state) {
+        out.clear();
+        bitpack_encode(values.data(), values.size(), out);
+        benchmark::DoNotOptimize(out.data());
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations()) * kPackedValues);
+}
+BENCHMARK(BM_BitpackEncode);
+
+void BM_BitpackDecode(benchmark::State& state) {
+    const std::vector<uint32_t> values = make_small_values();
+    std::vector<uint8_t> packed;
+    bitpack_encode(values.data(), values.size(), packed);
+    std::vector<uint32_t> out(values.size());
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(
+            bitpack_decode(packed.data(), packed.data() + packed.size(), out.size(), out.data()));
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations()) * kPackedValues);
+}
+BENCHMARK(BM_BitpackDecode);
+
+void BM_StreamVByteEncode(benchmark::State& state) {
+    const std::vector<uint32_t> values = make_small_values();
+    std::vector<uint8_t> out;
+    for (auto _ : state) {
+        out.clear();
+        stream_vbyte_encode(values.data(), values.size(), out);
+        benchmark::DoNotOptimize(out.data());
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations()) * kPackedValues);
+}
+BENCHMARK(BM_StreamVByteEncode);
+
+void BM_StreamVByteDecode(benchmark::State& state) {
+    const std::vector<uint32_t> values = make_small_values();
+    std::vector<uint8_t> packed;
+    stream_vbyte_encode(values.data(), values.size(), packed);
+    std::vector<uint32_t> out(values.size());
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(stream_vbyte_decode(packed.data(), packed.data() + packed.size(),
+                                                     out.size(), out.data()));
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations()) * kPackedValues);
+}
+BENCHMARK(BM_StreamVByteDecode);
+
+void BM_ContainerParse(benchmark::State& state) {
+    ImageInfo info = {};
+    info.width = 1024;
+    info.height = 1024;
+    info.channels = 3;
+    info.bit_depth = 8;
+    info.colorspace = FRESCO_COLORSPACE_RGB;
+    fresco_encode_params_t params = {};
+    Container writer;
+    writer.initialize(info, params);
+    writer.add_track(TrackType::Vector, std::vector<uint8_t>(256, 1));
+    std::vector<uint8_t> file;
+    writer.finalize(std::vector<uint8_t>(4096, 0), file);
+
+    for (auto _ : state) {
+        Container reader;
+        ContainerInfo container_info;
+        if (reader.parse(file.data(), file.size(), container_info) != FRESCO_OK) {
+            state.SkipWithError("parse failed");
+            break;
+        }
+        benchmark::DoNotOptimize(container_info.tracks.data());
+    }
+}
+BENCHMARK(BM_ContainerParse);
+
+// Whole files through the public API, by effort
+void BM_Encode(benchmark::State& state) {
+    const uint32_t size = 512;
+    const std::vector<uint8_t> image = make_rgb(size);
+    fresco_encode_params_t params = {};
+    params.mode = FRESCO_COMPRESSION_LOSSY;
+    params.quality = 85;
+    params.effort = static_cast<uint8_t>(state.range(0));
+    params.max_threads = 1;
+    fresco_encoder_t* encoder = nullptr;
+    fresco_encoder_create(&encoder);
+    fresco_encoder_set_params(encoder, &params);
+    size_t encoded_size = 0;
+    for (auto _ : state) {
+        uint8_t* encoded = nullptr;
+        if (fresco_encoder_encode(encoder, image.data(), image.size(), &encoded,
+                                  &encoded_size) != FRESCO_OK) {
+            state.SkipWithError("encode failed");
+            break;
+        }
+        fresco_free(encoded);
+    }
+    fresco_encoder_destroy(encoder);
+    set_pixels_processed(state, static_cast<size_t>(size) * size);
+    state.counters["bpp"] = encoded_size * 8.0 / (static_cast<double>(size) * size);
+}
+BENCHMARK(BM_Encode)->Arg(1)->Arg(5)->Arg(9)->Unit(benchmark::kMillisecond);
+
+void BM_Decode(benchmark::State& state) {
+    const uint32_t size = 512;
+    const std::vector<uint8_t> image = make_rgb(size);
+    fresco_encode_params_t params = {};
+    params.mode = FRESCO_COMPRESSION_LOSSY;
+    params.quality = 85;
+    params.effort = static_cast<uint8_t>(state.range(0));
+    fresco_encoder_t* encoder = nullptr;
+    fresco_encoder_create(&encoder);
+    fresco_encoder_set_params(encoder, &params);
+    uint8_t* encoded = nullptr;
+    size_t encoded_size = 0;
+    fresco_encoder_encode(encoder, image.data(), image.size(), &encoded, &encoded_size);
+    fresco_encoder_destroy(encoder);
+
+    fresco_decoder_t* decoder = nullptr;
+    fresco_decoder_create(&decoder);
+    fresco_decode_params_t decode_params = {};
+    decode_params.max_threads = 1;
+    fresco_decoder_set_params(decoder, &decode_params);
+    for (auto _ : state) {
+        uint8_t* decoded = nullptr;
+        size_t decoded_size = 0;
+        if (fresco_decoder_decode(decoder, encoded, encoded_size, &decoded,
+                                  &decoded_size) != FRESCO_OK) {
+            state.SkipWithError("decode failed");
+            break;
+        }
+        fresco_free(decoded);
+    }
+    fresco_decoder_destroy(decoder);
+    fresco_free(encoded);
+    set_pixels_processed(state, static_cast<size_t>(size) * size);
+}
+BENCHMARK(BM_Decode)->Arg(1)->Arg(5)->Arg(9)->Unit(benchmark::kMillisecond);
+
+std::string simd_paths() {
+    std::string paths;
+    auto add = [&paths](const char* name) {
+        paths += paths.empty() ? name : std::string(",") + name;
+    };
+#if defined(__AVX2__)
+    add("avx2");
+#endif
+#if defined(__SSSE3__)
+    add("ssse3");
+#endif
+#if defined(__SSE2__)
+    add("sse2");
+#endif
+#if defined(__ARM_NEON)
+    add("neon");
+#endif
+    return paths.empty() ? "scalar" : paths;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    benchmark::Initialize(&argc, argv);
+    if (benchmark::ReportUnrecognizedArguments(argc, argv)) {
+        return 1;
+    }
+    benchmark::AddCustomContext("fresco_version", fresco_get_version_string());
+    benchmark::AddCustomContext("simd", simd_paths());
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+    return 0;
+}
@@ -0,0 +1,141 @@
+/**
+ * @file benchmark_vector.cpp
+ * @brief Vector track performance benchmarks
+ * @author Mehmet T. AKALIN
+ * @date 2025
+ * @license MIT
+ */
+
+#include "fresco/fresco.h"
+#include <iostream>
+#include <vector>
+#include <chrono>
+#include <random>
+
+void benchmark_vector() {
+    std::cout << "=== FRESCO Vector Track Benchmark ===" << std::endl;
+
+    // Map-tile-like content: many short polylines in a 4096 unit extent
+    const size_t path_count = 20000;
+    const size_t segments_per_path = 50;
+
+    std::mt19937 gen(1234);
+    std::uniform_real_distribution<float> start(0.0f, 4096.0f);
+    std::uniform_real_distribution<float> step(-8.0f, 8.0f);
+
+    std::vector<uint8_t> commands;
+    std::vector<float> points;
+    for (size_t i = 0; i < path_count; i++) {
+        float x = start(gen);
+        float y = start(gen);
+        commands.push_back(FRESCO_PATH_MOVE);
+        points.push_back(x);
+        points.push_back(y);
+        for (size_t s = 0; s < segments_per_path; s++) {
+            x += step(gen);
+            y += step(gen);
+            commands.push_back(FRESCO_PATH_LINE);
+            points.push_back(x);
+            points.push_back(y);
+        }
+    }
+
+    std::vector<fresco_vector_path_t> paths(path_count);
+    for (size_t i = 0; i < path_count; i++) {
+        const size_t count = segments_per_path + 1;
+        paths[i] = {commands.data() + i * count, count, points.data() + i * count * 2, count,
+                    0x000000ffu, FRESCO_FILL_NONZERO};
+    }
+
+    const size_t raw_size = commands.size() + points.size() * sizeof(float);
+    std::cout << "Paths: " << path_count << ", segments: " << path_count * segments_per_path
+              << std::endl;
+    std::cout << "Raw size: " << raw_size << " bytes" << std::endl;
+
+    fresco_encoder_t* encoder = nullptr;
+    fresco_encoder_create(&encoder);
+
+    fresco_encode_params_t params = {};
+    params.mode = FRESCO_COMPRESSION_LOSSLESS;
+    params.quality = 85;
+    params.effort = 5;
+    params.enable_vector = 1;
+    fresco_encoder_set_params(encoder, &params);
+    fresco_encoder_set_vector_paths(encoder, 4096, 4096, paths.data(), paths.size());
+
+    uint8_t* encoded_data = nullptr;
+    size_t encoded_size = 0;
+    auto start_time = std::chrono::high_resolution_clock::now();
+    fresco_error_t result = fresco_encoder_encode(encoder, nullptr, 0, &encoded_data, &encoded_size);
+    auto end_time = std::chrono::high_resolution_clock::now();
+    fresco_encoder_destroy(encoder);
+
+    if (result != FRESCO_OK) {
+        std::cout << "Encoding failed: " << fresco_error_string(result) << std::endl;
+        return;
+    }
+
+    auto encode_us = std::chrono::duration_cast<std::chrono::microseconds>(end_time - start_time);
+    std::cout << "Encoded size: " << encoded_size << " bytes" << std::endl;
+    std::cout << "Encoding time: " << encode_us.count() << " us" << std::endl;
+
+    fresco_decoder_t* decoder = nullptr;
+    fresco_decoder_create(&decoder);
+
+    const int iterations = 20;
+    start_time = std::chrono::high_resolution_clock::now();
+    for (int i = 0; i < iterations && result == FRESCO_OK; i++) {
+        fresco_vector_path_t* decoded = nullptr;
+        size_t decoded_count = 0;
+        result = fresco_decoder_decode_vector(decoder, encoded_data, encoded_size,
+                                              &decoded, &decoded_count);
+        fresco_free(decoded);
+    }
+    end_time = std::chrono::high_resolution_clock::now();
+
+    if (result == FRESCO_OK) {
+        double seconds = std::chrono::duration<double>(end_time - start_time).count() / iterations;
+        std::cout << "Decoding time: " << seconds * 1e6 << " us" << std::endl;
+        std::cout << "Decoding speed: " << (encoded_size / 1e9) / seconds << " GB/s encoded, "
+                  << (path_count * segments_per_path / 1e6) / seconds << " M segments/s"
+                  << std::endl;
+    } else {
+        std::cout << "Decoding failed: " << fresco_error_string(result) << std::endl;
+    }
+
+    // Rasterize the vector-only file onto its 4096x4096 canvas
+    const uint32_t thread_counts[] = {1, 0};
+    for (uint32_t threads : thread_counts) {
+        if (result != FRESCO_OK) {
+            break;
+        }
+        fresco_decode_params_t decode_params = {};
+        decode_params.max_threads = threads;
+        fresco_decoder_set_params(decoder, &decode_params);
+
+        const int render_iterations = 3;
+        start_time = std::chrono::high_resolution_clock::now();
+        for (int i = 0; i < render_iterations && result == FRESCO_OK; i++) {
+            uint8_t* pixels = nullptr;
+            size_t pixel_size = 0;
+            result = fresco_decoder_decode(decoder, encoded_data, encoded_size, &pixels, &pixel_size);
+            fresco_free(pixels);
+        }
+        end_time = std::chrono::high_resolution_clock::now();
+
+        if (result == FRESCO_OK) {
+            double seconds =
+                std::chrono::duration<double>(end_time - start_time).count() / render_iterations;
+            std::cout << "Render time (" << (threads ? "1 thread" : "all threads") << "): "
+                      << seconds * 1e3 << " ms, " << (4096.0 * 4096.0 / 1e6) / seconds << " MP/s"
+                      << std::endl;
+        } else {
+            std::cout << "Rendering failed: " << fresco_error_string(result) << std::endl;
+        }
+    }
+
+    fresco_decoder_destroy(decoder);
+    fresco_free(encoded_data);
+}
+
+// Main function moved to benchmark_main.cpp
@@ -0,0 +1,85 @@
+#!/usr/bin/env python3
+"""
+Compare two runs of fresco_stage_benchmarks and flag regressions.
+
+Both inputs are Google Benchmark JSON (--benchmark_out=<file> or
+--benchmark_format=json). Benchmarks are matched by name; with
+--benchmark_repetitions the median aggregate is used. The exit status is 1
+when any benchmark got slower than the threshold allows, so the script can
+gate an upgrade in CI.
+
+Usage:
+    compare_benchmarks.py baseline.json contender.json [--threshold 5]
+                          [--metric cpu_time|real_time]
+"""
+
+import argparse
+import json
+import sys
+
+UNIT_NS = {"ns": 1.0, "us": 1e3, "ms": 1e6, "s": 1e9}
+
+
+def load_times(path, metric):
+    with open(path) as f:
+        report = json.load(f)
+    times = {}
+    medians = {}
+    for bench in report.get("benchmarks", []):
+        if bench.get("error_occurred"):
+            continue
+        # Times are in each benchmark's own unit; normalize to nanoseconds
+        time = bench[metric] * UNIT_NS[bench.get("time_unit", "ns")]
+        if bench.get("run_type") == "aggregate":
+            if bench.get("aggregate_name") == "median":
+                medians[bench["run_name"]] = time
+            continue
+        # Repeated runs without aggregates keep the fastest
+        name = bench.get("run_name", bench["name"])
+        times[name] = min(time, times.get(name, time))
+    times.update(medians)
+    return times, report.get("context", {})
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.strip().splitlines()[0])
+    parser.add_argument("baseline")
+    parser.add_argument("contender")
+    parser.add_argument("--threshold", type=float, default=5.0,
+                        help="allowed slowdown in percent (default: 5)")
+    parser.add_argument("--metric", choices=("cpu_time", "real_time"), default="cpu_time")
+    args = parser.parse_args()
+
+    baseline, baseline_context = load_times(args.baseline, args.metric)
+    contender, contender_context = load_times(args.contender, args.metric)
+    for key in ("simd", "fresco_version"):
+        if baseline_context.get(key) != contender_context.get(key):
+            print(f"note: {key} differs: {baseline_context.get(key)} -> "
+                  f"{contender_context.get(key)}")
+
+    regressions = []
+    width = max((len(name) for name in baseline), default=10)
+    print(f"{'benchmark':<{width}}  {'baseline ns':>12}  {'contender ns':>12}  {'change':>8}")
+    for name, before in baseline.items():
+        after = contender.get(name)
+        if after is None:
+            print(f"{name:<{width}}  {before:>12.0f}  {'missing':>12}")
+            continue
+        change = (after - before) / before * 100.0 if before > 0 else 0.0
+        flag = ""
+        if change > args.threshold:
+            flag = "  REGRESSION"
+            regressions.append(name)
+        print(f"{name:<{width}}  {before:>12.0f}  {after:>12.0f}  {change:>+7.1f}%{flag}")
+    for name in contender:
+        if name not in baseline:
+            print(f"{name:<{width}}  {'new':>12}  {contender[name]:>12.0f}")
+
+    if regressions:
+        print(f"\n{len(regressions)} benchmark(s) slower than the {args.threshold:g}% threshold")
+        return 1
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -12,9 +12,9 @@ __author__ = "Mehmet T. AKALIN"
 __license__ = "MIT"
 
 # Import main classes and functions
-from .encoder import FrescoEncoder
-from .decoder import FrescoDecoder
-from .metadata import FrescoMetadata
+from .encoder import FrescoEncoder, encode
+from .decoder import FrescoDecoder, decode
+from .metadata import FrescoMetadata, get_metadata
 
 __all__ = [
     'FrescoEncoder',
@@ -0,0 +1,111 @@
+"""
+FRESCO Decoder Python wrapper
+"""
+
+from typing import Optional
+import numpy as np
+from . import _fresco
+from ._fresco import *
+from .encoder import Buffer
+
+
+class FrescoDecoder:
+    """
+    FRESCO decoder for converting FRESCO data to images.
+    
+    Images are decoded straight into a NumPy array, either a new one or one
+    passed in by the caller, and the GIL is released while decoding.
+    """
+    
+    def __init__(self, **kwargs):
+        """
+        Initialize the FRESCO decoder.
+        
+        Args:
+            **kwargs: Decoding parameters (see set_params for details)
+        """
+        self._decoder = _fresco.Decoder()
+        
+        if kwargs:
+            self.set_params(**kwargs)
+    
+    def set_params(self,
+                   max_threads: int = 0,
+                   render_vector: bool = False,
+                   max_memory_bytes: int = 0) -> None:
+        """
+        Set decoding parameters.
+        
+        Args:
+            max_threads: Maximum number of threads (0 for auto-detect)
+            render_vector: Rasterize the vector track into the image
+            max_memory_bytes: Largest working memory of a decode, output included (0 for none)
+        """
+        if self._decoder is None:
+            raise RuntimeError("Decoder not initialized")
+        
+        self._decoder.set_params(max_threads=max_threads,
+                                 render_vector=render_vector,
+                                 max_memory_bytes=max_memory_bytes)
+    
+    def decode(self, data: Buffer, out: Optional[np.ndarray] = None) -> np.ndarray:
+        """
+        Decode FRESCO data to an image.
+        
+        Args:
+            data: Encoded FRESCO data in any contiguous byte buffer
+            out: Optional writable uint8 array of shape (height, width) for
+                 one channel or (height, width, channels) otherwise; its
+                 rows may be strided, so a view into a larger batch works
+            
+        Returns:
+            out, or a new array when out is None
+        """
+        if self._decoder is None:
+            raise RuntimeError("Decoder not initialized")
+        
+        return self._decoder.decode(data, out)
+    
+    def decode_file(self, input_path: str) -> np.ndarray:
+        """
+        Decode a FRESCO file.
+        
+        Args:
+            input_path: Path to input FRESCO file
+            
+        Returns:
+            Decoded image
+        """
+        with open(input_path, 'rb') as f:
+            data = f.read()
+        
+        return self.decode(data)
+    
+    def __enter__(self):
+        return self
+    
+    def __exit__(self, exc_type, exc_val, exc_tb):
+        self.close()
+    
+    def close(self):
+        """Close the decoder and free resources."""
+        self._decoder = None
+    
+    def __del__(self):
+        self.close()
+
+
+def decode(data: Buffer, out: Optional[np.ndarray] = None, **kwargs) -> np.ndarray:
+    """
+    Convenience function to decode FRESCO data to an image.
+    
+    Args:
+        data: Encoded FRESCO data
+        out: Optional array to decode into (see FrescoDecoder.decode)
+        **kwargs: Decoding parameters (see FrescoDecoder.set_params)
+        
+    Returns:
+        Decoded image
+    """
+    with FrescoDecoder(**kwargs) as decoder:
+        return decoder.decode(data, out)
@@ -4,8 +4,12 @@ FRESCO Encoder Python wrapper
 
 from typing import Optional, Dict, Any, Union
 import numpy as np
+from . import _fresco
 from ._fresco import *
 
+# Anything exposing the buffer protocol: bytes, bytearray, memoryview or ndarray
+Buffer = Union[bytes, bytearray, memoryview, np.ndarray]
+
 
 class FrescoEncoder:
     """
@@ -29,20 +33,21 @@ class FrescoEncoder:
             self.set_params(**kwargs)
     
     def _create_encoder(self):
-        """Create the underlying C encoder."""
-        result = fresco_encoder_create(self._encoder)
-        if result != FRESCO_OK:
-            raise RuntimeError(f"Failed to create encoder: {fresco_error_string(result)}")
+        """Create the underlying native encoder."""
+        self._encoder = _fresco.Encoder()
     
     def set_params(self, 
                    mode: str = "lossy",
                    quality: int = 85,
                    effort: int = 5,
                    max_threads: int = 0,
-                   tile_size: int = 256,
+                   tile_size: int = 0,
                    enable_animation: bool = False,
                    enable_3d: bool = False,
-                   enable_vector: bool = False) -> None:
+                   enable_vector: bool = False,
+                   target_bytes: int = 0,
+                   target_bpp: float = 0.0,
+                   max_memory_bytes: int = 0) -> None:
         """
         Set encoding parameters.
         
@@ -51,10 +56,13 @@ class FrescoEncoder:
             quality: Quality setting (1-100, higher is better)
             effort: Encoding effort (1-10, higher is slower but better compression)
             max_threads: Maximum number of threads (0 for auto-detect)
-            tile_size: Tile size for tiled encoding
+            tile_size: Tile size for tiled encoding (0 for the effort's default)
             enable_animation: Enable animation support
             enable_3d: Enable 3D model support
             enable_vector: Enable vector graphics support
+            target_bytes: Largest file size in bytes, lossy only (0 for none)
+            target_bpp: Largest file size in bits per pixel, lossy only (0 for none)
+            max_memory_bytes: Largest working memory of an encode, output included (0 for none)
         """
         if self._encoder is None:
             raise RuntimeError("Encoder not initialized")
@@ -65,28 +73,31 @@ class FrescoEncoder:
         if effort < 1 or effort > 10:
             raise ValueError("Effort must be between 1 and 10")
         
-        # Create parameters structure
-        params = fresco_encode_params_t()
-        params.mode = FRESCO_COMPRESSION_LOSSY if mode == "lossy" else FRESCO_COMPRESSION_LOSSLESS
-        params.quality = quality
-        params.effort = effort
-        params.max_threads = max_threads
-        params.tile_size = tile_size
-        params.enable_animation = 1 if enable_animation else 0
-        params.enable_3d = 1 if enable_3d else 0
-        params.enable_vector = 1 if enable_vector else 0
-        
-        result = fresco_encoder_set_params(self._encoder, params)
-        if result != FRESCO_OK:
-            raise RuntimeError(f"Failed to set encoder parameters: {fresco_error_string(result)}")
+        self._encoder.set_params(
+            mode=FRESCO_COMPRESSION_LOSSY if mode == "lossy" else FRESCO_COMPRESSION_LOSSLESS,
+            quality=quality,
+            effort=effort,
+            max_threads=max_threads,
+            tile_size=tile_size,
+            enable_animation=enable_animation,
+            enable_3d=enable_3d,
+            enable_vector=enable_vector,
+            target_bytes=target_bytes,
+            target_bpp=target_bpp,
+            max_memory_bytes=max_memory_bytes)
     
-    def encode(self, data: Union[bytes, np.ndarray], 
+    def encode(self, data: Buffer, 
                format: Optional[str] = None) -> bytes:
         """
         Encode image data to FRESCO format.
         
+        The data is read in place and the GIL is released while encoding, so
+        encoders on other threads run in parallel.
+        
         Args:
-            data: Input image data (bytes or numpy array)
+            data: A uint8 array of shape (height, width) or (height, width,
+                  channels), whose rows may be strided (a crop, for example),
+                  or a byte buffer holding an image file
             format: Input format (auto-detected if None)
             
         Returns:
@@ -95,28 +106,7 @@ class FrescoEncoder:
         if self._encoder is None:
             raise RuntimeError("Encoder not initialized")
         
-        # Convert numpy array to bytes if needed
-        if isinstance(data, np.ndarray):
-            data = data.tobytes()
-        
-        if not isinstance(data, bytes):
-            raise TypeError("Data must be bytes or numpy array")
-        
-        # Encode
-        output_data = None
-        output_size = 0
-        
-        result = fresco_encoder_encode(self._encoder, data, len(data),
-                                     output_data, output_size)
-        
-        if result != FRESCO_OK:
-            raise RuntimeError(f"Failed to encode: {fresco_error_string(result)}")
-        
-        # Convert to Python bytes
-        encoded_data = bytes(output_data[:output_size])
-        fresco_free(output_data)
-        
-        return encoded_data
+        return self._encoder.encode(data)
     
     def encode_file(self, input_path: str, output_path: str) -> None:
         """
@@ -142,22 +132,20 @@ class FrescoEncoder:
     
     def close(self):
         """Close the encoder and free resources."""
-        if self._encoder is not None:
-            fresco_encoder_destroy(self._encoder)
-            self._encoder = None
+        self._encoder = None
     
     def __del__(self):
         self.close()
 
 
-def encode(data: Union[bytes, np.ndarray], 
+def encode(data: Buffer, 
            output_path: Optional[str] = None,
            **kwargs) -> Union[bytes, None]:
     """
     Convenience function to encode image data to FRESCO format.
     
     Args:
-        data: Input image data (bytes or numpy array)
+        data: Input image data (see FrescoEncoder.encode)
         output_path: Optional output file path
         **kwargs: Encoding parameters (see FrescoEncoder.set_params)
         
@@ -0,0 +1,42 @@
+"""
+FRESCO Metadata Python wrapper
+"""
+
+from dataclasses import dataclass
+from . import _fresco
+from .encoder import Buffer
+
+
+@dataclass(frozen=True)
+class FrescoMetadata:
+    """Image properties read from the container header."""
+    
+    width: int
+    height: int
+    channels: int
+    bit_depth: int
+    colorspace: int
+    frame_count: int
+    frame_rate: float
+    file_size: int
+    compressed_size: int
+    
+    @property
+    def shape(self) -> tuple:
+        """Shape of the array FrescoDecoder.decode returns."""
+        if self.channels == 1:
+            return (self.height, self.width)
+        return (self.height, self.width, self.channels)
+
+
+def get_metadata(data: Buffer) -> FrescoMetadata:
+    """
+    Read the metadata of FRESCO data without decoding it.
+    
+    Args:
+        data: Encoded FRESCO data in any contiguous byte buffer
+        
+    Returns:
+        Metadata of the image
+    """
+    return FrescoMetadata(**_fresco.get_metadata(data))
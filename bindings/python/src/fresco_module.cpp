@@ -0,0 +1,339 @@
+/**
+ * @file fresco_module.cpp
+ * @brief FRESCO native Python module
+ * @author Mehmet T. AKALIN
+ * @date 2025
+ * @license MIT
+ */
+
+#include "fresco/fresco.h"
+#include <pybind11/numpy.h>
+#include <pybind11/pybind11.h>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace py = pybind11;
+
+namespace {
+
+using Output = std::unique_ptr<uint8_t, void (*)(void*)>;
+
+[[noreturn]] void raise_error(fresco_error_t result, const char* what) {
+    const std::string message = std::string(what) + ": " + fresco_error_string(result);
+    switch (result) {
+        case FRESCO_ERROR_INVALID_PARAMETER:
+            throw py::value_error(message);
+        case FRESCO_ERROR_OUT_OF_MEMORY:
+            PyErr_SetString(PyExc_MemoryError, message.c_str());
+            throw py::error_already_set();
+        case FRESCO_ERROR_IO:
+            PyErr_SetString(PyExc_OSError, message.c_str());
+            throw py::error_already_set();
+        default:
+            throw std::runtime_error(message);
+    }
+}
+
+bool is_bytes_format(const py::buffer_info& info) {
+    return info.itemsize == 1 && (info.format == "B" || info.format == "b" || info.format == "c");
+}
+
+// Byte offset of the last byte of an image with the given shape and strides,
+// which must all be positive, plus one
+size_t image_extent(const fresco_image_t& image) {
+    return (static_cast<size_t>(image.height) - 1) * image.row_stride +
+           static_cast<size_t>(image.width) * image.channels;
+}
+
+// An ndarray of shape (height, width) or (height, width, channels) as a
+// fresco_image_t. Rows may lie anywhere in memory; returns false when the
+// channels of a row are not packed, which fresco_image_t cannot describe.
+bool describe_image(const py::buffer_info& info, fresco_image_t& image) {
+    if (!is_bytes_format(info) || (info.ndim != 2 && info.ndim != 3)) {
+        throw py::value_error("pixels must be a uint8 array of shape (height, width) or "
+                              "(height, width, channels)");
+    }
+    const py::ssize_t channels = info.ndim == 3 ? info.shape[2] : 1;
+    if (info.shape[0] < 1 || info.shape[1] < 1 || channels < 1 || channels > 4 ||
+        info.shape[0] > UINT32_MAX || info.shape[1] > UINT32_MAX) {
+        throw py::value_error("pixels must have 1 to 4 channels and a non-empty size");
+    }
+    image.pixels = static_cast<const uint8_t*>(info.ptr);
+    image.width = static_cast<uint32_t>(info.shape[1]);
+    image.height = static_cast<uint32_t>(info.shape[0]);
+    image.channels = static_cast<uint8_t>(channels);
+    image.row_stride = static_cast<size_t>(info.strides[0]);
+    const bool packed_channels = info.ndim == 2 || channels == 1 || info.strides[2] == 1;
+    return packed_channels && info.strides[1] == channels &&
+           info.strides[0] >= info.shape[1] * channels;
+}
+
+// Packed copy of an image whose strides describe_image rejected
+std::vector<uint8_t> gather(const py::buffer_info& info, fresco_image_t& image) {
+    const size_t channels = image.channels;
+    std::vector<uint8_t> packed(static_cast<size_t>(image.width) * image.height * channels);
+    const auto* base = static_cast<const uint8_t*>(info.ptr);
+    const py::ssize_t channel_stride = info.ndim == 3 ? info.strides[2] : 0;
+    uint8_t* out = packed.data();
+    for (py::ssize_t y = 0; y < info.shape[0]; y++) {
+        for (py::ssize_t x = 0; x < info.shape[1]; x++) {
+            const uint8_t* pixel = base + y * info.strides[0] + x * info.strides[1];
+            for (size_t c = 0; c < channels; c++) {
+                *out++ = pixel[static_cast<py::ssize_t>(c) * channel_stride];
+            }
+        }
+    }
+    image.pixels = packed.data();
+    image.row_stride = 0;
+    return packed;
+}
+
+// Encoded data: anything exposing a contiguous byte buffer
+py::buffer_info encoded_buffer(const py::buffer& data) {
+    py::buffer_info info = data.request();
+    if (!is_bytes_format(info) || info.ndim != 1 || (info.size > 1 && info.strides[0] != 1)) {
+        throw py::value_error("data must be a contiguous byte buffer");
+    }
+    return info;
+}
+
+class Encoder {
+public:
+    Encoder() {
+        fresco_error_t result = fresco_encoder_create(&encoder_);
+        if (result != FRESCO_OK) {
+            raise_error(result, "Failed to create encoder");
+        }
+    }
+
+    ~Encoder() { fresco_encoder_destroy(encoder_); }
+
+    Encoder(const Encoder&) = delete;
+    Encoder& operator=(const Encoder&) = delete;
+
+    void set_params(int mode, int quality, int effort, uint32_t max_threads, uint32_t tile_size,
+                    bool enable_animation, bool enable_3d, bool enable_vector,
+                    uint32_t mesh_lod_levels, uint64_t target_bytes, float target_bpp,
+                    uint64_t max_memory_bytes) {
+        if (quality < 1 || quality > 100 || effort < 1 || effort > 10) {
+            raise_error(FRESCO_ERROR_INVALID_PARAMETER, "Failed to set encoder parameters");
+        }
+        fresco_encode_params_t params = {};
+        params.mode = static_cast<fresco_compression_t>(mode);
+        params.quality = static_cast<uint8_t>(quality);
+        params.effort = static_cast<uint8_t>(effort);
+        params.max_threads = max_threads;
+        params.tile_size = tile_size;
+        params.enable_animation = enable_animation;
+        params.enable_3d = enable_3d;
+        params.enable_vector = enable_vector;
+        params.mesh_lod_levels = mesh_lod_levels;
+        params.target_bytes = target_bytes;
+        params.target_bpp = target_bpp;
+        params.max_memory_bytes = max_memory_bytes;
+        std::lock_guard<std::mutex> lock(mutex_);
+        fresco_error_t result = fresco_encoder_set_params(encoder_, &params);
+        if (result != FRESCO_OK) {
+            raise_error(result, "Failed to set encoder parameters");
+        }
+    }
+
+    py::bytes encode(const py::buffer& data) {
+        py::buffer_info info = data.request();
+        const bool raw = info.ndim == 1;
+        fresco_image_t image = {};
+        bool packed = true;
+        if (raw) {
+            info = encoded_buffer(data);
+        } else {
+            packed = describe_image(info, image);
+        }
+
+        uint8_t* output = nullptr;
+        size_t output_size = 0;
+        fresco_error_t result;
+        {
+            py::gil_scoped_release release;
+            std::lock_guard<std::mutex> lock(mutex_);
+            std::vector<uint8_t> copy;
+            if (!packed) {
+                copy = gather(info, image);
+            }
+            result = raw ? fresco_encoder_encode(encoder_, static_cast<const uint8_t*>(info.ptr),
+                                                 static_cast<size_t>(info.size), &output,
+                                                 &output_size)
+                         : fresco_encoder_encode_image(encoder_, &image, &output, &output_size);
+        }
+        if (result != FRESCO_OK) {
+            raise_error(result, "Failed to encode");
+        }
+        Output owned(output, fresco_free);
+        return py::bytes(reinterpret_cast<const char*>(output), output_size);
+    }
+
+private:
+    fresco_encoder_t* encoder_ = nullptr;
+    std::mutex mutex_;
+};
+
+// Decodes through an immutable fresco_decoder_config_t, so threads sharing
+// one Decoder decode in parallel; set_params swaps in a new configuration
+// and calls already running keep the one they started with
+class Decoder {
+public:
+    Decoder() { config_ = create_config(nullptr, "Failed to create decoder"); }
+
+    void set_params(uint32_t max_threads, bool render_vector, uint64_t max_memory_bytes) {
+        fresco_decode_params_t params = {};
+        params.max_threads = max_threads;
+        params.render_vector = render_vector;
+        params.max_memory_bytes = max_memory_bytes;
+        std::shared_ptr<fresco_decoder_config_t> config = create_config(&params, "Failed to set decoder parameters");
+        std::lock_guard<std::mutex> lock(mutex_);
+        config_ = std::move(config);
+    }
+
+    // Decodes into out when given, otherwise into a new array; either way
+    // the tiles are written straight into the array's memory
+    py::object decode(const py::buffer& data, const py::object& out) {
+        const py::buffer_info input = encoded_buffer(data);
+        const auto* input_data = static_cast<const uint8_t*>(input.ptr);
+        const size_t input_size = static_cast<size_t>(input.size);
+
+        fresco_metadata_t metadata = {};
+        fresco_error_t result;
+        {
+            py::gil_scoped_release release;
+            result = fresco_get_metadata(input_data, input_size, &metadata);
+        }
+        if (result != FRESCO_OK) {
+            raise_error(result, "Failed to decode");
+        }
+        std::vector<py::ssize_t> shape = {metadata.height, metadata.width};
+        if (metadata.channels != 1) {
+            shape.push_back(metadata.channels);
+        }
+
+        py::object target = out;
+        if (target.is_none()) {
+            target = py::array_t<uint8_t>(shape);
+        }
+        const py::buffer_info pixels = target.cast<py::buffer>().request(true);
+        fresco_image_t image = {};
+        if (pixels.shape != shape || !describe_image(pixels, image)) {
+            throw py::value_error("out must be a writable uint8 array of shape " +
+                                  py::repr(py::tuple(py::cast(shape))).cast<std::string>() +
+                                  " whose rows hold packed pixels");
+        }
+
+        {
+            py::gil_scoped_release release;
+            std::shared_ptr<fresco_decoder_config_t> config;
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                config = config_;
+            }
+            result = fresco_decoder_config_decode_into(config.get(), input_data, input_size,
+                                                       static_cast<uint8_t*>(pixels.ptr),
+                                                       image.row_stride, image_extent(image),
+                                                       nullptr);
+        }
+        if (result != FRESCO_OK) {
+            raise_error(result, "Failed to decode");
+        }
+        return target;
+    }
+
+private:
+    static std::shared_ptr<fresco_decoder_config_t> create_config(
+        const fresco_decode_params_t* params, const char* what) {
+        fresco_decoder_config_t* config = nullptr;
+        fresco_error_t result = fresco_decoder_config_create(params, nullptr, nullptr, &config);
+        if (result != FRESCO_OK) {
+            raise_error(result, what);
+        }
+        return std::shared_ptr<fresco_decoder_config_t>(config, fresco_decoder_config_destroy);
+    }
+
+    std::shared_ptr<fresco_decoder_config_t> config_;
+    std::mutex mutex_;
+};
+
+py::dict get_metadata(const py::buffer& data) {
+    const py::buffer_info input = encoded_buffer(data);
+    fresco_metadata_t metadata = {};
+    fresco_error_t result;
+    {
+        py::gil_scoped_release release;
+        result = fresco_get_metadata(static_cast<const uint8_t*>(input.ptr),
+                                     static_cast<size_t>(input.size), &metadata);
+    }
+    if (result != FRESCO_OK) {
+        raise_error(result, "Failed to get metadata");
+    }
+    py::dict fields;
+    fields["width"] = metadata.width;
+    fields["height"] = metadata.height;
+    fields["channels"] = metadata.channels;
+    fields["bit_depth"] = metadata.bit_depth;
+    fields["colorspace"] = static_cast<int>(metadata.colorspace);
+    fields["frame_count"] = metadata.frame_count;
+    fields["frame_rate"] = metadata.frame_rate;
+    fields["file_size"] = metadata.file_size;
+    fields["compressed_size"] = metadata.compressed_size;
+    return fields;
+}
+
+} // namespace
+
+PYBIND11_MODULE(_fresco, m) {
+    m.doc() = "FRESCO native module. Buffers are read and written in place and "
+              "the GIL is released while coding.";
+
+    py::class_<Encoder>(m, "Encoder")
+        .def(py::init<>())
+        .def("set_params", &Encoder::set_params, py::arg("mode") = 0,
+             py::arg("quality") = 85, py::arg("effort") = 5, py::arg("max_threads") = 0,
+             py::arg("tile_size") = 0, py::arg("enable_animation") = false,
+             py::arg("enable_3d") = false, py::arg("enable_vector") = false,
+             py::arg("mesh_lod_levels") = 0, py::arg("target_bytes") = 0,
+             py::arg("target_bpp") = 0.0f, py::arg("max_memory_bytes") = 0)
+        .def("encode", &Encoder::encode, py::arg("data"),
+             "Encode a uint8 array of shape (height, width[, channels]), whose rows may be "
+             "strided, or a byte buffer in a supported input format");
+
+    py::class_<Decoder>(m, "Decoder")
+        .def(py::init<>())
+        .def("set_params", &Decoder::set_params, py::arg("max_threads") = 0,
+             py::arg("render_vector") = false, py::arg("max_memory_bytes") = 0)
+        .def("decode", &Decoder::decode, py::arg("data"), py::arg("out") = py::none(),
+             "Decode into out, a writable uint8 array of the image's shape, or into a new "
+             "array when out is None");
+
+    m.def("get_metadata", &get_metadata, py::arg("data"));
+    m.def("fresco_error_string",
+          [](int error) { return fresco_error_string(static_cast<fresco_error_t>(error)); });
+    m.def("get_version", []() { return std::string(fresco_get_version_string()); });
+
+    m.attr("FRESCO_OK") = static_cast<int>(FRESCO_OK);
+    m.attr("FRESCO_ERROR_INVALID_PARAMETER") = static_cast<int>(FRESCO_ERROR_INVALID_PARAMETER);
+    m.attr("FRESCO_ERROR_OUT_OF_MEMORY") = static_cast<int>(FRESCO_ERROR_OUT_OF_MEMORY);
+    m.attr("FRESCO_ERROR_IO") = static_cast<int>(FRESCO_ERROR_IO);
+    m.attr("FRESCO_ERROR_UNSUPPORTED_FORMAT") = static_cast<int>(FRESCO_ERROR_UNSUPPORTED_FORMAT);
+    m.attr("FRESCO_ERROR_CORRUPTED_DATA") = static_cast<int>(FRESCO_ERROR_CORRUPTED_DATA);
+    m.attr("FRESCO_ERROR_ENCODING_FAILED") = static_cast<int>(FRESCO_ERROR_ENCODING_FAILED);
+    m.attr("FRESCO_ERROR_DECODING_FAILED") = static_cast<int>(FRESCO_ERROR_DECODING_FAILED);
+    m.attr("FRESCO_ERROR_NOT_IMPLEMENTED") = static_cast<int>(FRESCO_ERROR_NOT_IMPLEMENTED);
+    m.attr("FRESCO_COMPRESSION_LOSSY") = static_cast<int>(FRESCO_COMPRESSION_LOSSY);
+    m.attr("FRESCO_COMPRESSION_LOSSLESS") = static_cast<int>(FRESCO_COMPRESSION_LOSSLESS);
+    m.attr("FRESCO_COLORSPACE_RGB") = static_cast<int>(FRESCO_COLORSPACE_RGB);
+    m.attr("FRESCO_COLORSPACE_RGBA") = static_cast<int>(FRESCO_COLORSPACE_RGBA);
+    m.attr("FRESCO_COLORSPACE_YUV420") = static_cast<int>(FRESCO_COLORSPACE_YUV420);
+    m.attr("FRESCO_COLORSPACE_YUV422") = static_cast<int>(FRESCO_COLORSPACE_YUV422);
+    m.attr("FRESCO_COLORSPACE_YUV444") = static_cast<int>(FRESCO_COLORSPACE_YUV444);
+    m.attr("FRESCO_COLORSPACE_GRAY") = static_cast<int>(FRESCO_COLORSPACE_GRAY);
+    m.attr("FRESCO_COLORSPACE_GRAYA") = static_cast<int>(FRESCO_COLORSPACE_GRAYA);
+}
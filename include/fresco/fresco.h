@@ -63,6 +63,31 @@ typedef enum {
     FRESCO_COLORSPACE_GRAYA           ///< Grayscale with alpha
 } fresco_colorspace_t;
 
+/**
+ * @brief Image file format written by fresco_decoder_decode_file and
+ *        fresco_write_image_file
+ */
+typedef enum {
+    FRESCO_FILE_PNM = 0,              ///< PGM for gray, PPM for RGB, PAM with alpha
+    FRESCO_FILE_PAM,                  ///< PAM (P7) for every channel count
+    FRESCO_FILE_PNG,                  ///< PNG with fast deflate
+    FRESCO_FILE_PNG_STORED            ///< PNG with uncompressed deflate blocks
+} fresco_file_format_t;
+
+/**
+ * @brief When a decode checks the CRC-32C of the data it reads
+ *
+ * Files carry a checksum for the moov box, for every track other than the
+ * raster track, and for the raster track's index and each of its tiles.
+ * A mismatch gives FRESCO_ERROR_CORRUPTED_DATA. 3D tracks are read chunk by
+ * chunk and checked only with FRESCO_VERIFY_ALWAYS.
+ */
+typedef enum {
+    FRESCO_VERIFY_LAZY = 0,           ///< Check each tile and track the first time a call reads it
+    FRESCO_VERIFY_ALWAYS,             ///< Check every track and tile before any pixel is written
+    FRESCO_VERIFY_SKIP                ///< Check nothing, for data that is known to be intact
+} fresco_verify_t;
+
 /**
  * @brief Compression mode
  */
@@ -71,6 +96,72 @@ typedef enum {
     FRESCO_COMPRESSION_LOSSLESS       ///< Lossless compression
 } fresco_compression_t;
 
+/**
+ * @brief Vector path commands
+ *
+ * Each command consumes a fixed number of points: MOVE and LINE one,
+ * QUAD two, CUBIC three and CLOSE none. Arcs are expected to be converted
+ * to cubic segments by the caller.
+ */
+typedef enum {
+    FRESCO_PATH_MOVE = 0,             ///< Start a new subpath
+    FRESCO_PATH_LINE,                 ///< Straight line
+    FRESCO_PATH_QUAD,                 ///< Quadratic Bezier curve
+    FRESCO_PATH_CUBIC,                ///< Cubic Bezier curve
+    FRESCO_PATH_CLOSE                 ///< Close the current subpath
+} fresco_path_command_t;
+
+/**
+ * @brief Fill rule for vector paths
+ */
+typedef enum {
+    FRESCO_FILL_NONZERO = 0,          ///< Non-zero winding rule
+    FRESCO_FILL_EVENODD               ///< Even-odd rule
+} fresco_fill_rule_t;
+
+/**
+ * @brief Vector path
+ */
+typedef struct {
+    const uint8_t* commands;          ///< Path commands (fresco_path_command_t values)
+    size_t command_count;             ///< Number of commands
+    const float* points;              ///< Interleaved x, y coordinates
+    size_t point_count;               ///< Number of points (x, y pairs)
+    uint32_t fill_color;              ///< Fill color as 0xRRGGBBAA
+    fresco_fill_rule_t fill_rule;     ///< Fill rule
+} fresco_vector_path_t;
+
+/**
+ * @brief Triangle mesh
+ */
+typedef struct {
+    const float* positions;           ///< x, y, z per vertex
+    const float* normals;             ///< x, y, z per vertex, or NULL
+    const float* uvs;                 ///< u, v per vertex, or NULL
+    size_t vertex_count;              ///< Number of vertices
+    const uint32_t* indices;          ///< Three vertex indices per triangle
+    size_t triangle_count;            ///< Number of triangles
+} fresco_mesh_t;
+
+/**
+ * @brief Octree node of a progressive mesh
+ *
+ * Each node holds a chunk approximating all geometry inside its cube;
+ * children refine (replace) their parent. Level 0 is the base level of
+ * detail, leaves hold the original triangles.
+ */
+typedef struct {
+    uint32_t level;                   ///< Depth in the octree, 0 for the root
+    uint32_t parent;                  ///< Index of the parent node, UINT32_MAX for the root
+    uint32_t first_child;             ///< Index of the first child node
+    uint32_t child_count;             ///< Number of child nodes (consecutive)
+    float bounds_min[3];              ///< Minimum corner of the node cube
+    float bounds_size;                ///< Edge length of the node cube
+    float error;                      ///< Largest vertex displacement by simplification
+    size_t triangle_count;            ///< Triangles in the node's chunk
+    size_t compressed_size;           ///< Bytes of the node's chunk
+} fresco_mesh_node_t;
+
 /**
  * @brief Image metadata structure
  */
@@ -86,6 +177,31 @@ typedef struct {
     uint64_t compressed_size;         ///< Compressed data size in bytes
 } fresco_metadata_t;
 
+/**
+ * @brief Interleaved 8-bit image in caller memory
+ */
+typedef struct {
+    const uint8_t* pixels;            ///< First byte of the top row
+    uint32_t width;                   ///< Image width in pixels
+    uint32_t height;                  ///< Image height in pixels
+    uint8_t channels;                 ///< 1 gray, 2 gray+alpha, 3 RGB or 4 RGBA
+    size_t row_stride;                ///< Bytes from one row to the next, 0 for width * channels
+} fresco_image_t;
+
+/**
+ * @brief Rectangle of the raster at one resolution level
+ *
+ * Level n is the image at 1 / 2^n of its size, width and height rounded
+ * up; the rectangle is in the pixels of that level.
+ */
+typedef struct {
+    uint32_t x;                       ///< Left column
+    uint32_t y;                       ///< Top row
+    uint32_t width;                   ///< Width in pixels
+    uint32_t height;                  ///< Height in pixels
+    uint32_t level;                   ///< Resolution level, 0 for full size
+} fresco_region_t;
+
 /**
  * @brief Encoding parameters
  */
@@ -94,10 +210,14 @@ typedef struct {
     uint8_t quality;                  ///< Quality setting (1-100)
     uint8_t effort;                   ///< Encoding effort (1-10)
     uint32_t max_threads;             ///< Maximum number of threads
-    uint32_t tile_size;               ///< Tile size for tiled encoding
+    uint32_t tile_size;               ///< Tile size for tiled encoding (0: set by effort)
     int enable_animation;             ///< Enable animation support
     int enable_3d;                    ///< Enable 3D model support
     int enable_vector;                ///< Enable vector graphics support
+    uint32_t mesh_lod_levels;         ///< Octree levels of a progressive mesh (0 or 1: single level, at most 8)
+    uint64_t target_bytes;            ///< Lossy only: largest file size in bytes, overrides quality (0: off)
+    float target_bpp;                 ///< Lossy only: largest file size in bits per pixel (0: off)
+    uint64_t max_memory_bytes;        ///< Largest working memory of a call, output included (0: no limit)
 } fresco_encode_params_t;
 
 /**
@@ -107,8 +227,123 @@ typedef struct {
     uint32_t max_threads;             ///< Maximum number of threads
     int enable_progressive;           ///< Enable progressive decoding
     int enable_metadata;              ///< Extract metadata only
+    int render_vector;                ///< Rasterize the vector track into the output
+    uint64_t max_memory_bytes;        ///< Largest working memory of a call, output included (0: no limit)
+    fresco_verify_t verify;           ///< Checksum verification of the input
 } fresco_decode_params_t;
 
+/**
+ * @brief Timing and resource figures of the last encode or decode call
+ *
+ * Stage times are summed over worker threads, so with several threads they
+ * can add up to more than total_ns.
+ */
+typedef struct {
+    uint64_t total_ns;                ///< Wall time of the whole call
+    uint64_t parse_ns;                ///< Input parsing (encode) or container parsing (decode)
+    uint64_t color_ns;                ///< Color transform and level shift
+    uint64_t transform_ns;            ///< Wavelet transform
+    uint64_t quantize_ns;             ///< Quantization, rate search and dequantization
+    uint64_t entropy_ns;              ///< Entropy coding or decoding
+    uint64_t container_ns;            ///< Track assembly, boxes and output copies
+    uint64_t vector_ns;               ///< Vector track coding, or rendering on decode
+    uint64_t mesh_ns;                 ///< 3D track coding
+    uint64_t raster_bytes;            ///< Raster track payload size
+    uint64_t vector_bytes;            ///< Vector track payload size
+    uint64_t mesh_bytes;              ///< 3D track payload size
+    uint64_t tiles;                   ///< Raster tiles coded, counting every rate control pass
+    uint32_t threads;                 ///< Worker threads of the raster codec
+    uint64_t peak_scratch_bytes;      ///< Largest working memory of the raster codec
+    uint64_t tile_cache_hits;         ///< Tiles of a region decode taken from the tile cache
+} fresco_stats_t;
+
+/**
+ * @brief Process-wide totals since the library was loaded
+ *
+ * Byte and stage figures cover successful fresco_encoder_encode and
+ * fresco_decoder_decode calls only; failed calls are counted as errors.
+ */
+typedef struct {
+    uint64_t images_encoded;          ///< Successful encode calls
+    uint64_t images_decoded;          ///< Successful decode calls
+    uint64_t encode_errors;           ///< Encode calls that returned an error
+    uint64_t decode_errors;           ///< Decode calls that returned an error
+    uint64_t encode_bytes_in;         ///< Input bytes of successful encodes
+    uint64_t encode_bytes_out;        ///< FRESCO bytes written by successful encodes
+    uint64_t decode_bytes_in;         ///< FRESCO bytes read by successful decodes
+    uint64_t decode_bytes_out;        ///< Pixel bytes written by successful decodes
+    uint64_t parse_ns;                ///< Stage times, as in fresco_stats_t
+    uint64_t color_ns;
+    uint64_t transform_ns;
+    uint64_t quantize_ns;
+    uint64_t entropy_ns;
+    uint64_t container_ns;
+    uint64_t vector_ns;
+    uint64_t mesh_ns;
+    uint64_t allocations;             ///< Buffers returned by fresco_malloc
+    uint64_t allocated_bytes;         ///< Bytes returned by fresco_malloc
+    uint64_t queue_depth;             ///< Work items (tiles, bands) waiting for a worker now
+    uint64_t tile_cache_hits;         ///< Tiles a region decode found in a tile cache
+    uint64_t tile_cache_misses;       ///< Tiles a region decode looked up in a tile cache and decoded
+    uint64_t tile_cache_evictions;    ///< Tiles dropped from tile caches to stay within their budget
+} fresco_counters_t;
+
+/**
+ * @brief Outcome of an asynchronous encode or decode
+ */
+typedef struct {
+    fresco_error_t result;            ///< Result of the call
+    uint8_t* output_data;             ///< Output on success, owned by the receiver (free with fresco_free)
+    size_t output_size;               ///< Size of the output in bytes
+    void* user_data;                  ///< As passed to the asynchronous call
+} fresco_completion_t;
+
+/**
+ * @brief Receiver of trace events
+ *
+ * Each call carries one Chrome trace event (a JSON object with ph "X", not
+ * NUL-terminated). Joined with commas inside a JSON array they form a trace
+ * file that chrome://tracing and Perfetto open.
+ */
+typedef void (*fresco_trace_sink_t)(const char* event, size_t length, void* user_data);
+
+/**
+ * @brief Receiver of a completion
+ *
+ * Called on the worker thread of the handle that ran the call; the
+ * completion is only valid during the call. It must not destroy that handle.
+ */
+typedef void (*fresco_completion_callback_t)(const fresco_completion_t* completion);
+
+/** Pyramid tile size used when fresco_pyramid_params_t.tile_size is 0 */
+#define FRESCO_PYRAMID_TILE_SIZE 256
+
+/**
+ * @brief Deep-zoom pyramid parameters
+ *
+ * Level k of the pyramid is the image at 1 / 2^(n - k) of its size, width
+ * and height rounded up, where level n is the full image and level 0 a
+ * single pixel. Each level is cut into tile_size squares, the last ones in a
+ * row or column smaller, and each tile reaches overlap pixels into its
+ * neighbours on the sides it has them.
+ */
+typedef struct {
+    uint32_t tile_size;               ///< Tile width and height in pixels (0: FRESCO_PYRAMID_TILE_SIZE)
+    uint32_t overlap;                 ///< Pixels shared with each neighbouring tile, below tile_size
+    uint32_t min_level;               ///< Coarsest level to emit, 0 for all
+} fresco_pyramid_params_t;
+
+/**
+ * @brief Receiver of the tiles of a pyramid
+ *
+ * Called once per tile with its level, column and row; the tile is only
+ * valid during the call. Tiles of one row of a level may be passed from
+ * several threads at once. Anything but FRESCO_OK ends the pyramid with
+ * that result.
+ */
+typedef fresco_error_t (*fresco_pyramid_sink_t)(uint32_t level, uint32_t column, uint32_t row,
+                                                const fresco_image_t* tile, void* user_data);
+
 /**
  * @brief FRESCO encoder handle
  */
@@ -119,6 +354,26 @@ typedef struct fresco_encoder fresco_encoder_t;
  */
 typedef struct fresco_decoder fresco_decoder_t;
 
+/**
+ * @brief Immutable decoding setup that many threads may decode with at once
+ */
+typedef struct fresco_decoder_config fresco_decoder_config_t;
+
+/**
+ * @brief Queue of finished asynchronous calls, with a descriptor to poll
+ */
+typedef struct fresco_completion_queue fresco_completion_queue_t;
+
+/**
+ * @brief Worker threads shared by encoders and decoders
+ */
+typedef struct fresco_thread_pool fresco_thread_pool_t;
+
+/**
+ * @brief Decoded raster tiles shared by decoders, within a byte budget
+ */
+typedef struct fresco_tile_cache fresco_tile_cache_t;
+
 /**
  * @brief Get library version information
  * @param major Pointer to store major version
@@ -156,14 +411,33 @@ FRESCO_API void fresco_encoder_destroy(fresco_encoder_t* encoder);
 FRESCO_API fresco_error_t fresco_encoder_set_params(fresco_encoder_t* encoder,
                                         const fresco_encode_params_t* params);
 
+/**
+ * @brief Run the encoder's parallel work on a thread pool
+ *
+ * max_threads 0 then means one worker per pool thread; a non-zero value
+ * still caps the workers of one call.
+ *
+ * @param encoder Encoder handle
+ * @param pool Pool that outlives the encoder, or NULL to start threads per call
+ * @return FRESCO_OK on success
+ */
+FRESCO_API fresco_error_t fresco_encoder_set_thread_pool(fresco_encoder_t* encoder,
+                                             fresco_thread_pool_t* pool);
+
 /**
  * @brief Encode image data to FRESCO format
+ *
+ * The input is a PNG, a binary PGM/PPM/PAM, or packed 8-bit RGB of a square
+ * image. PNG rows are inflated as the tiles that need them are encoded,
+ * except under a lossy rate target, which needs the whole image first.
+ *
  * @param encoder Encoder handle
  * @param input_data Input image data
  * @param input_size Size of input data
  * @param output_data Pointer to store output data
  * @param output_size Pointer to store output size
- * @return FRESCO_OK on success
+ * @return FRESCO_OK on success, FRESCO_ERROR_CORRUPTED_DATA for a
+ *         malformed PNG or PNM file
  */
 FRESCO_API fresco_error_t fresco_encoder_encode(fresco_encoder_t* encoder,
                                     const uint8_t* input_data,
@@ -171,6 +445,117 @@ FRESCO_API fresco_error_t fresco_encoder_encode(fresco_encoder_t* encoder,
                                     uint8_t** output_data,
                                     size_t* output_size);
 
+/**
+ * @brief Encode an image described by its size and row stride
+ *
+ * The pixels are read in place, so padded rows and crops of a larger image
+ * need no copy.
+ *
+ * @param encoder Encoder handle
+ * @param image Image to encode
+ * @param output_data Pointer to store output data
+ * @param output_size Pointer to store output size
+ * @return FRESCO_OK on success
+ */
+FRESCO_API fresco_error_t fresco_encoder_encode_image(fresco_encoder_t* encoder,
+                                          const fresco_image_t* image,
+                                          uint8_t** output_data,
+                                          size_t* output_size);
+
+/**
+ * @brief Recompress a JPEG file without loss
+ *
+ * The quantized DCT coefficients are read from the entropy-coded scans and
+ * coded again with context modeling; fresco_decoder_decode_jpeg rebuilds the
+ * original file byte for byte. Baseline and progressive Huffman-coded files
+ * are supported. The file takes the place of the raster track, so quality,
+ * mode and the rate targets do not apply; vector and 3D tracks are written
+ * as with fresco_encoder_encode.
+ *
+ * @param encoder Encoder handle
+ * @param jpeg_data JPEG file
+ * @param jpeg_size Size of the JPEG file
+ * @param output_data Pointer to store output data
+ * @param output_size Pointer to store output size
+ * @return FRESCO_OK on success, FRESCO_ERROR_UNSUPPORTED_FORMAT for
+ *         arithmetic-coded, lossless, hierarchical or 12-bit files, and for
+ *         files whose scans would not be rebuilt exactly
+ */
+FRESCO_API fresco_error_t fresco_encoder_encode_jpeg(fresco_encoder_t* encoder,
+                                         const uint8_t* jpeg_data,
+                                         size_t jpeg_size,
+                                         uint8_t** output_data,
+                                         size_t* output_size);
+
+/**
+ * @brief Queue an encode and return without waiting for it
+ *
+ * The calls of one handle run one at a time, in order, on a worker thread
+ * of the handle. Exactly one of callback and queue receives the completion.
+ * input_data must stay valid until then, and the handle must not be used
+ * for synchronous calls or new parameters while calls are pending.
+ * Destroying the handle waits for its pending calls.
+ *
+ * @param encoder Encoder handle
+ * @param input_data Input image data
+ * @param input_size Size of input data
+ * @param callback Receiver of the completion, or NULL
+ * @param queue Queue for the completion, or NULL
+ * @param user_data Passed back in the completion
+ * @return FRESCO_OK when queued; the result of the encode is in the completion
+ */
+FRESCO_API fresco_error_t fresco_encoder_encode_async(fresco_encoder_t* encoder,
+                                          const uint8_t* input_data,
+                                          size_t input_size,
+                                          fresco_completion_callback_t callback,
+                                          fresco_completion_queue_t* queue,
+                                          void* user_data);
+
+/**
+ * @brief Get the statistics of the last encode call
+ * @param encoder Encoder handle
+ * @param stats Pointer to store the statistics; all zero before the first call
+ * @return FRESCO_OK on success
+ */
+FRESCO_API fresco_error_t fresco_encoder_get_stats(const fresco_encoder_t* encoder,
+                                                  fresco_stats_t* stats);
+
+/**
+ * @brief Attach vector paths to be stored in the vector track
+ *
+ * The paths are copied. They are written by fresco_encoder_encode when
+ * enable_vector is set; with an empty raster input (input_size 0) a
+ * vector-only file is produced. Coordinates are quantized to 1/16 unit.
+ *
+ * @param encoder Encoder handle
+ * @param width Canvas width the coordinates refer to
+ * @param height Canvas height the coordinates refer to
+ * @param paths Array of paths (may be NULL when path_count is 0)
+ * @param path_count Number of paths
+ * @return FRESCO_OK on success
+ */
+FRESCO_API fresco_error_t fresco_encoder_set_vector_paths(fresco_encoder_t* encoder,
+                                              uint32_t width,
+                                              uint32_t height,
+                                              const fresco_vector_path_t* paths,
+                                              size_t path_count);
+
+/**
+ * @brief Attach a triangle mesh to be stored in the 3D track
+ *
+ * The mesh is copied. It is written by fresco_encoder_encode when enable_3d
+ * is set; with an empty raster input (input_size 0) a file without a raster
+ * track is produced. Positions, normals and uvs are quantized according to
+ * the quality setting, and vertices and triangles are stored in traversal
+ * order.
+ *
+ * @param encoder Encoder handle
+ * @param mesh Mesh to attach, or NULL to remove a previously attached one
+ * @return FRESCO_OK on success
+ */
+FRESCO_API fresco_error_t fresco_encoder_set_mesh(fresco_encoder_t* encoder,
+                                      const fresco_mesh_t* mesh);
+
 /**
  * @brief Create a new decoder
  * @param decoder Pointer to store decoder handle
@@ -193,6 +578,24 @@ FRESCO_API void fresco_decoder_destroy(fresco_decoder_t* decoder);
 FRESCO_API fresco_error_t fresco_decoder_set_params(fresco_decoder_t* decoder,
                                         const fresco_decode_params_t* params);
 
+/**
+ * @brief Run the decoder's parallel work on a thread pool, as fresco_encoder_set_thread_pool
+ * @param decoder Decoder handle
+ * @param pool Pool that outlives the decoder, or NULL to start threads per call
+ * @return FRESCO_OK on success
+ */
+FRESCO_API fresco_error_t fresco_decoder_set_thread_pool(fresco_decoder_t* decoder,
+                                             fresco_thread_pool_t* pool);
+
+/**
+ * @brief Look up and keep the tiles of region decodes in a tile cache
+ * @param decoder Decoder handle
+ * @param cache Cache that outlives the decoder, or NULL to decode every tile
+ * @return FRESCO_OK on success
+ */
+FRESCO_API fresco_error_t fresco_decoder_set_tile_cache(fresco_decoder_t* decoder,
+                                            fresco_tile_cache_t* cache);
+
 /**
  * @brief Decode FRESCO data to image format
  * @param decoder Decoder handle
@@ -208,6 +611,363 @@ FRESCO_API fresco_error_t fresco_decoder_decode(fresco_decoder_t* decoder,
                                     uint8_t** output_data,
                                     size_t* output_size);
 
+/**
+ * @brief Decode FRESCO data into a caller buffer
+ *
+ * The tiles are written straight into pixels, without an intermediate
+ * buffer. fresco_get_metadata gives the size to allocate.
+ *
+ * @param decoder Decoder handle
+ * @param input_data Input FRESCO data
+ * @param input_size Size of input data
+ * @param pixels Buffer for the interleaved image
+ * @param row_stride Bytes from one row to the next, 0 for width * channels
+ * @param capacity Size of the buffer in bytes
+ * @return FRESCO_OK on success, FRESCO_ERROR_INVALID_PARAMETER if the buffer is too small
+ */
+FRESCO_API fresco_error_t fresco_decoder_decode_into(fresco_decoder_t* decoder,
+                                         const uint8_t* input_data,
+                                         size_t input_size,
+                                         uint8_t* pixels,
+                                         size_t row_stride,
+                                         size_t capacity);
+
+/**
+ * @brief Decode one rectangle of the raster into a caller buffer
+ *
+ * Only the tiles that overlap the region are decoded, and at level n only
+ * the coarsest wavelet levels are inverted. With a tile cache attached,
+ * tiles are looked up there first and kept there after decoding. Vector
+ * and 3D tracks are not rendered.
+ *
+ * @param decoder Decoder handle
+ * @param input_data Input FRESCO data
+ * @param input_size Size of input data
+ * @param region Rectangle and level to decode
+ * @param pixels Buffer for the interleaved region
+ * @param row_stride Bytes from one row to the next, 0 for region width * channels
+ * @param capacity Size of the buffer in bytes
+ * @return FRESCO_OK on success, FRESCO_ERROR_INVALID_PARAMETER if the region lies
+ *         outside the level or the buffer is too small, FRESCO_ERROR_UNSUPPORTED_FORMAT
+ *         if the file has no raster track or the tiles cannot be decoded at that level
+ */
+FRESCO_API fresco_error_t fresco_decoder_decode_region(fresco_decoder_t* decoder,
+                                           const uint8_t* input_data,
+                                           size_t input_size,
+                                           const fresco_region_t* region,
+                                           uint8_t* pixels,
+                                           size_t row_stride,
+                                           size_t capacity);
+
+/**
+ * @brief Decode the raster as the tiles of a deep-zoom pyramid
+ *
+ * Each raster tile is decoded once, and every level down to the wavelet
+ * depth is taken from the inverse transform on its way to full size; only
+ * the levels coarser than that are downsampled, from the coarsest decoded
+ * one. Rows of raster tiles are decoded one after another, so besides the
+ * coarsest decoded level only a band of each level is held. Vector and 3D
+ * tracks are not rendered.
+ *
+ * @param decoder Decoder handle
+ * @param input_data Input FRESCO data
+ * @param input_size Size of input data
+ * @param params Pyramid parameters, or NULL for 256-pixel tiles without overlap
+ * @param sink Receiver of the tiles
+ * @param user_data Passed to each call of sink
+ * @return FRESCO_OK on success, FRESCO_ERROR_INVALID_PARAMETER if min_level is
+ *         past the full-size level or overlap is not below tile_size,
+ *         FRESCO_ERROR_UNSUPPORTED_FORMAT if the file has no raster track, or the
+ *         first error returned by sink
+ */
+FRESCO_API fresco_error_t fresco_decoder_decode_pyramid(fresco_decoder_t* decoder,
+                                            const uint8_t* input_data,
+                                            size_t input_size,
+                                            const fresco_pyramid_params_t* params,
+                                            fresco_pyramid_sink_t sink,
+                                            void* user_data);
+
+/**
+ * @brief Rebuild the JPEG file recompressed by fresco_encoder_encode_jpeg
+ *
+ * Files holding a JPEG track have no raster track, so fresco_decoder_decode
+ * and the other pixel decodes return FRESCO_ERROR_UNSUPPORTED_FORMAT for
+ * them.
+ *
+ * @param decoder Decoder handle
+ * @param input_data Input FRESCO data
+ * @param input_size Size of input data
+ * @param jpeg_data Pointer to store the JPEG file, freed with fresco_free
+ * @param jpeg_size Pointer to store its size
+ * @return FRESCO_OK on success, FRESCO_ERROR_UNSUPPORTED_FORMAT if the file
+ *         has no JPEG track
+ */
+FRESCO_API fresco_error_t fresco_decoder_decode_jpeg(fresco_decoder_t* decoder,
+                                         const uint8_t* input_data,
+                                         size_t input_size,
+                                         uint8_t** jpeg_data,
+                                         size_t* jpeg_size);
+
+/**
+ * @brief Decode FRESCO data to an image file
+ *
+ * Each row of tiles is written to the file as soon as it is decoded, so the
+ * full image is never held besides the file. The exception is when the
+ * vector track is drawn over the raster (render_vector, or a file without
+ * one), which needs the whole image first. FRESCO_FILE_PNG filters the rows
+ * and codes them with a fast deflate; FRESCO_FILE_PNG_STORED skips both for
+ * speed over size.
+ *
+ * @param decoder Decoder handle
+ * @param input_data Input FRESCO data
+ * @param input_size Size of input data
+ * @param format File format to write
+ * @param file_data Pointer to store the file, freed with fresco_free
+ * @param file_size Pointer to store its size
+ * @return FRESCO_OK on success, FRESCO_ERROR_UNSUPPORTED_FORMAT if the
+ *         file has no pixels or samples wider than 8 bits
+ */
+FRESCO_API fresco_error_t fresco_decoder_decode_file(fresco_decoder_t* decoder,
+                                         const uint8_t* input_data,
+                                         size_t input_size,
+                                         fresco_file_format_t format,
+                                         uint8_t** file_data,
+                                         size_t* file_size);
+
+/**
+ * @brief Write 8-bit pixels in caller memory as an image file
+ *
+ * Takes the same formats as fresco_decoder_decode_file, for images that do
+ * not come from one call, such as the tiles of a pyramid.
+ *
+ * @param image Pixels to write
+ * @param format File format to write
+ * @param file_data Pointer to store the file, freed with fresco_free
+ * @param file_size Pointer to store its size
+ * @return FRESCO_OK on success, FRESCO_ERROR_UNSUPPORTED_FORMAT for an
+ *         empty image or more than 4 channels
+ */
+FRESCO_API fresco_error_t fresco_write_image_file(const fresco_image_t* image,
+                                      fresco_file_format_t format,
+                                      uint8_t** file_data,
+                                      size_t* file_size);
+
+/**
+ * @brief Queue a decode and return without waiting for it
+ *
+ * Works as fresco_encoder_encode_async; the output of the completion is the
+ * image fresco_decoder_decode would return.
+ *
+ * @param decoder Decoder handle
+ * @param input_data Input FRESCO data
+ * @param input_size Size of input data
+ * @param callback Receiver of the completion, or NULL
+ * @param queue Queue for the completion, or NULL
+ * @param user_data Passed back in the completion
+ * @return FRESCO_OK when queued; the result of the decode is in the completion
+ */
+FRESCO_API fresco_error_t fresco_decoder_decode_async(fresco_decoder_t* decoder,
+                                          const uint8_t* input_data,
+                                          size_t input_size,
+                                          fresco_completion_callback_t callback,
+                                          fresco_completion_queue_t* queue,
+                                          void* user_data);
+
+/**
+ * @brief Get the statistics of the last decode call
+ * @param decoder Decoder handle
+ * @param stats Pointer to store the statistics; all zero before the first call
+ * @return FRESCO_OK on success
+ */
+FRESCO_API fresco_error_t fresco_decoder_get_stats(const fresco_decoder_t* decoder,
+                                                  fresco_stats_t* stats);
+
+/**
+ * @brief Create a decoder configuration
+ *
+ * Unlike a decoder handle, a configuration never changes after it is
+ * created, and the decode functions below take it as const. Any number of
+ * threads may decode with one configuration at the same time; each call
+ * keeps its tile buffers in the thread that runs it.
+ *
+ * @param params Decoding parameters, or NULL for the defaults
+ * @param pool Pool that outlives the configuration, or NULL to start threads per call
+ * @param cache Tile cache for region decodes that outlives the configuration, or NULL
+ * @param config Pointer to store the configuration
+ * @return FRESCO_OK on success
+ */
+FRESCO_API fresco_error_t fresco_decoder_config_create(const fresco_decode_params_t* params,
+                                           fresco_thread_pool_t* pool,
+                                           fresco_tile_cache_t* cache,
+                                           fresco_decoder_config_t** config);
+
+/**
+ * @brief Destroy a decoder configuration once no call is using it
+ * @param config Configuration to destroy
+ */
+FRESCO_API void fresco_decoder_config_destroy(fresco_decoder_config_t* config);
+
+/**
+ * @brief Decode FRESCO data as fresco_decoder_decode, safe to call from many threads
+ * @param config Decoder configuration
+ * @param input_data Input FRESCO data
+ * @param input_size Size of input data
+ * @param output_data Pointer to store output data
+ * @param output_size Pointer to store output size
+ * @param stats Pointer to store the statistics of this call, or NULL
+ * @return FRESCO_OK on success
+ */
+FRESCO_API fresco_error_t fresco_decoder_config_decode(const fresco_decoder_config_t* config,
+                                           const uint8_t* input_data,
+                                           size_t input_size,
+                                           uint8_t** output_data,
+                                           size_t* output_size,
+                                           fresco_stats_t* stats);
+
+/**
+ * @brief Decode FRESCO data as fresco_decoder_decode_into, safe to call from many threads
+ * @param config Decoder configuration
+ * @param input_data Input FRESCO data
+ * @param input_size Size of input data
+ * @param pixels Buffer for the interleaved image
+ * @param row_stride Bytes from one row to the next, 0 for width * channels
+ * @param capacity Size of the buffer in bytes
+ * @param stats Pointer to store the statistics of this call, or NULL
+ * @return FRESCO_OK on success, FRESCO_ERROR_INVALID_PARAMETER if the buffer is too small
+ */
+FRESCO_API fresco_error_t fresco_decoder_config_decode_into(const fresco_decoder_config_t* config,
+                                                const uint8_t* input_data,
+                                                size_t input_size,
+                                                uint8_t* pixels,
+                                                size_t row_stride,
+                                                size_t capacity,
+                                                fresco_stats_t* stats);
+
+/**
+ * @brief Decode a region as fresco_decoder_decode_region, safe to call from many threads
+ * @param config Decoder configuration
+ * @param input_data Input FRESCO data
+ * @param input_size Size of input data
+ * @param region Rectangle and level to decode
+ * @param pixels Buffer for the interleaved region
+ * @param row_stride Bytes from one row to the next, 0 for region width * channels
+ * @param capacity Size of the buffer in bytes
+ * @param stats Pointer to store the statistics of this call, or NULL
+ * @return FRESCO_OK on success
+ */
+FRESCO_API fresco_error_t fresco_decoder_config_decode_region(const fresco_decoder_config_t* config,
+                                                  const uint8_t* input_data,
+                                                  size_t input_size,
+                                                  const fresco_region_t* region,
+                                                  uint8_t* pixels,
+                                                  size_t row_stride,
+                                                  size_t capacity,
+                                                  fresco_stats_t* stats);
+
+/**
+ * @brief Decode the vector track of FRESCO data
+ *
+ * The paths, their commands and their points are returned in a single
+ * allocation that is released with fresco_free(*paths).
+ *
+ * @param decoder Decoder handle
+ * @param input_data Input FRESCO data
+ * @param input_size Size of input data
+ * @param paths Pointer to store the decoded paths
+ * @param path_count Pointer to store the number of paths
+ * @return FRESCO_OK on success, FRESCO_ERROR_UNSUPPORTED_FORMAT if the
+ *         file has no vector track
+ */
+FRESCO_API fresco_error_t fresco_decoder_decode_vector(fresco_decoder_t* decoder,
+                                           const uint8_t* input_data,
+                                           size_t input_size,
+                                           fresco_vector_path_t** paths,
+                                           size_t* path_count);
+
+/**
+ * @brief Decode the 3D track of FRESCO data
+ *
+ * The mesh descriptor and its arrays are returned in a single allocation
+ * that is released with fresco_free(*mesh).
+ *
+ * @param decoder Decoder handle
+ * @param input_data Input FRESCO data
+ * @param input_size Size of input data
+ * @param mesh Pointer to store the decoded mesh
+ * @return FRESCO_OK on success, FRESCO_ERROR_UNSUPPORTED_FORMAT if the
+ *         file has no 3D track
+ */
+FRESCO_API fresco_error_t fresco_decoder_decode_mesh(fresco_decoder_t* decoder,
+                                         const uint8_t* input_data,
+                                         size_t input_size,
+                                         fresco_mesh_t** mesh);
+
+/**
+ * @brief Read the chunk index of the 3D track
+ *
+ * Only the index is parsed, no geometry is decoded. A track written with a
+ * single level yields one root node. The array is released with
+ * fresco_free(*nodes).
+ *
+ * @param decoder Decoder handle
+ * @param input_data Input FRESCO data
+ * @param input_size Size of input data
+ * @param nodes Pointer to store the nodes, breadth first
+ * @param node_count Pointer to store the number of nodes
+ * @return FRESCO_OK on success, FRESCO_ERROR_UNSUPPORTED_FORMAT if the
+ *         file has no 3D track
+ */
+FRESCO_API fresco_error_t fresco_decoder_get_mesh_nodes(fresco_decoder_t* decoder,
+                                            const uint8_t* input_data,
+                                            size_t input_size,
+                                            fresco_mesh_node_t** nodes,
+                                            size_t* node_count);
+
+/**
+ * @brief Decode selected octree nodes of the 3D track into one mesh
+ *
+ * Only the chunks of the listed nodes are decoded. Vertices on chunk
+ * borders are repeated in every chunk that uses them.
+ *
+ * @param decoder Decoder handle
+ * @param input_data Input FRESCO data
+ * @param input_size Size of input data
+ * @param node_indices Indices into the array from fresco_decoder_get_mesh_nodes
+ * @param node_count Number of indices
+ * @param mesh Pointer to store the decoded mesh, released with fresco_free
+ * @return FRESCO_OK on success
+ */
+FRESCO_API fresco_error_t fresco_decoder_decode_mesh_nodes(fresco_decoder_t* decoder,
+                                               const uint8_t* input_data,
+                                               size_t input_size,
+                                               const uint32_t* node_indices,
+                                               size_t node_count,
+                                               fresco_mesh_t** mesh);
+
+/**
+ * @brief Decode one level of detail of the 3D track, optionally clipped
+ *
+ * Decodes the nodes at the given level, and leaves above it, whose cube
+ * overlaps the box [region_min, region_max]. Level 0 is the coarsest;
+ * levels past the deepest select the full-resolution leaves.
+ *
+ * @param decoder Decoder handle
+ * @param input_data Input FRESCO data
+ * @param input_size Size of input data
+ * @param level Level of detail
+ * @param region_min Minimum corner (x, y, z) of the region, or NULL for all
+ * @param region_max Maximum corner (x, y, z) of the region, or NULL for all
+ * @param mesh Pointer to store the decoded mesh, released with fresco_free
+ * @return FRESCO_OK on success
+ */
+FRESCO_API fresco_error_t fresco_decoder_decode_mesh_lod(fresco_decoder_t* decoder,
+                                             const uint8_t* input_data,
+                                             size_t input_size,
+                                             uint32_t level,
+                                             const float* region_min,
+                                             const float* region_max,
+                                             fresco_mesh_t** mesh);
+
 /**
  * @brief Get metadata from FRESCO data
  * @param input_data Input FRESCO data
@@ -219,6 +979,27 @@ FRESCO_API fresco_error_t fresco_get_metadata(const uint8_t* input_data,
                                   size_t input_size,
                                   fresco_metadata_t* metadata);
 
+/**
+ * @brief Get metadata from a FRESCO file without reading it whole
+ *
+ * Reads the first 4 KiB, plus the box headers and the moov box when they lie
+ * further in. Track payloads are never read. Uses pread, so the offset of the
+ * descriptor is left unchanged.
+ *
+ * @param fd Open, readable descriptor of a regular file
+ * @param metadata Pointer to store metadata
+ * @return FRESCO_OK on success, FRESCO_ERROR_IO if the file cannot be read
+ */
+FRESCO_API fresco_error_t fresco_probe_fd(int fd, fresco_metadata_t* metadata);
+
+/**
+ * @brief Get metadata from the FRESCO file at a path, as fresco_probe_fd
+ * @param path Path of the file
+ * @param metadata Pointer to store metadata
+ * @return FRESCO_OK on success, FRESCO_ERROR_IO if the file cannot be opened or read
+ */
+FRESCO_API fresco_error_t fresco_probe_path(const char* path, fresco_metadata_t* metadata);
+
 /**
  * @brief Allocate memory using FRESCO's memory manager
  * @param size Number of bytes to allocate
@@ -232,6 +1013,105 @@ FRESCO_API void* fresco_malloc(size_t size);
  */
 FRESCO_API void fresco_free(void* ptr);
 
+/**
+ * @brief Create a thread pool
+ *
+ * Handles attached to one pool run their tiles and bands on its workers
+ * instead of starting threads per call, so concurrent calls share the
+ * machine. Each worker keeps its own deque of tasks and idle workers steal
+ * from the others; the calling thread works on its own call too.
+ *
+ * @param threads Number of worker threads (0 for one per core)
+ * @param pool Pointer to store the pool handle
+ * @return FRESCO_OK on success
+ */
+FRESCO_API fresco_error_t fresco_thread_pool_create(uint32_t threads, fresco_thread_pool_t** pool);
+
+/**
+ * @brief Destroy a thread pool after the handles attached to it
+ * @param pool Pool handle
+ */
+FRESCO_API void fresco_thread_pool_destroy(fresco_thread_pool_t* pool);
+
+/**
+ * @brief Get the number of worker threads of a pool
+ * @param pool Pool handle
+ * @return Number of workers, 0 if pool is NULL
+ */
+FRESCO_API uint32_t fresco_thread_pool_size(const fresco_thread_pool_t* pool);
+
+/**
+ * @brief Create a cache of decoded tiles for region decodes
+ *
+ * Tiles are keyed by the file they come from, their index and the level
+ * they were decoded at. The file is told apart by a hash of its raster
+ * header and tile index, and a hash of each tile's compressed bytes is
+ * checked before a cached tile is used. Once the tiles exceed max_bytes,
+ * the least recently used go first. The cache is split into shards with
+ * locks of their own, so any number of decoders on any threads may share it.
+ *
+ * @param max_bytes Budget for the decoded pixels and their bookkeeping
+ * @param cache Pointer to store the cache handle
+ * @return FRESCO_OK on success
+ */
+FRESCO_API fresco_error_t fresco_tile_cache_create(uint64_t max_bytes, fresco_tile_cache_t** cache);
+
+/**
+ * @brief Destroy a tile cache after the decoders attached to it
+ * @param cache Cache handle
+ */
+FRESCO_API void fresco_tile_cache_destroy(fresco_tile_cache_t* cache);
+
+/**
+ * @brief Get the bytes a tile cache holds now
+ * @param cache Cache handle
+ * @return Bytes held, 0 if cache is NULL
+ */
+FRESCO_API uint64_t fresco_tile_cache_bytes(const fresco_tile_cache_t* cache);
+
+/**
+ * @brief Create a completion queue
+ *
+ * One queue can collect the completions of any number of encoders and
+ * decoders.
+ *
+ * @param queue Pointer to store the queue handle
+ * @return FRESCO_OK on success, FRESCO_ERROR_IO if no descriptor is available
+ */
+FRESCO_API fresco_error_t fresco_completion_queue_create(fresco_completion_queue_t** queue);
+
+/**
+ * @brief Destroy a completion queue, freeing the outputs of unpolled completions
+ *
+ * Calls that complete into the queue must have finished before.
+ *
+ * @param queue Queue handle
+ */
+FRESCO_API void fresco_completion_queue_destroy(fresco_completion_queue_t* queue);
+
+/**
+ * @brief Descriptor that is readable while completions are waiting
+ *
+ * An eventfd on Linux and a pipe on other POSIX systems, for epoll, kqueue
+ * or poll. Only fresco_completion_queue_poll may read it.
+ *
+ * @param queue Queue handle
+ * @return The descriptor, or -1 where none is available
+ */
+FRESCO_API int fresco_completion_queue_fd(const fresco_completion_queue_t* queue);
+
+/**
+ * @brief Take waiting completions without blocking
+ * @param queue Queue handle
+ * @param completions Array to store up to capacity completions, oldest first
+ * @param capacity Size of the array
+ * @param count Pointer to store the number stored, 0 if none were waiting
+ * @return FRESCO_OK on success
+ */
+FRESCO_API fresco_error_t fresco_completion_queue_poll(fresco_completion_queue_t* queue,
+                                                      fresco_completion_t* completions,
+                                                      size_t capacity, size_t* count);
+
 /**
  * @brief Get error message for error code
  * @param error Error code
@@ -239,6 +1119,43 @@ FRESCO_API void fresco_free(void* ptr);
  */
 FRESCO_API const char* fresco_error_string(fresco_error_t error);
 
+/**
+ * @brief Send trace events of every encode and decode call to a sink
+ *
+ * Events cover each call, each raster tile and each stage, tagged with the
+ * thread that ran them. The sink is process-wide and its calls are
+ * serialized, so it needs no locking of its own; it must not call back into
+ * FRESCO. Passing NULL turns tracing off, after which the previous sink is
+ * no longer called.
+ *
+ * @param sink Event receiver, or NULL
+ * @param user_data Passed to every sink call
+ * @return FRESCO_OK on success, FRESCO_ERROR_NOT_IMPLEMENTED when the library
+ *         was built without tracing (ENABLE_TRACING=OFF)
+ */
+FRESCO_API fresco_error_t fresco_set_trace_sink(fresco_trace_sink_t sink, void* user_data);
+
+/**
+ * @brief Read the process-wide performance counters
+ *
+ * Threads update the counters in separate shards without locking; this sums
+ * the shards, so figures of calls still running may be partly included.
+ *
+ * @param counters Pointer to store the totals
+ * @return FRESCO_OK on success
+ */
+FRESCO_API fresco_error_t fresco_get_counters(fresco_counters_t* counters);
+
+/**
+ * @brief Render counters in the Prometheus text exposition format
+ * @param counters Totals from fresco_get_counters
+ * @param text Pointer to store the NUL-terminated text (free with fresco_free)
+ * @param length Pointer to store the text length without the terminator
+ * @return FRESCO_OK on success
+ */
+FRESCO_API fresco_error_t fresco_format_counters_prometheus(const fresco_counters_t* counters,
+                                                            char** text, size_t* length);
+
 #ifdef __cplusplus
 }
 #endif
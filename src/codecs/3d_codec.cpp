@@ -7,11 +7,828 @@
  */
 
 #include "fresco/fresco.h"
+#include "3d_codec.h"
+#include "core/varint.h"
+#include "core/bitpack.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
 #include <vector>
 
 namespace fresco {
 
-// TODO: Implement 3D model compression
-// This is a placeholder for future implementation
+namespace {
+
+constexpr uint8_t kMeshVersion = 1;
+constexpr uint8_t kFlagNormals = 0x01;
+constexpr uint8_t kFlagUvs = 0x02;
+constexpr uint32_t kNoVertex = UINT32_MAX;
+constexpr uint32_t kNoFace = UINT32_MAX;
+
+// Connectivity symbols, one per traversal step
+enum Symbol : uint8_t {
+    kSymbolNew = 0,     // Triangle whose third vertex is new
+    kSymbolLeft = 1,    // Third vertex ends the open gate into the gate start
+    kSymbolRight = 2,   // Third vertex starts the open gate out of the gate end
+    kSymbolEnd = 3,     // No unvisited triangle across the gate
+    kSymbolRef = 4,     // Third vertex is some earlier vertex
+};
+
+// Prefix code, read least significant bit first: 0, 10, 110, 1110, 1111
+struct SymbolCode {
+    uint8_t bits;
+    uint8_t length;
+};
+
+constexpr SymbolCode kSymbolCodes[] = {{0x0, 1}, {0x1, 2}, {0x3, 3}, {0x7, 4}, {0xf, 4}};
+
+struct SymbolTable {
+    uint8_t symbol[16];
+    uint8_t length[16];
+};
+
+constexpr SymbolTable make_symbol_table() {
+    SymbolTable table{};
+    for (int window = 0; window < 16; window++) {
+        int ones = 0;
+        while (ones < 4 && (window >> ones) & 1) {
+            ones++;
+        }
+        table.symbol[window] = static_cast<uint8_t>(ones);
+        table.length[window] = static_cast<uint8_t>(ones < 4 ? ones + 1 : 4);
+    }
+    return table;
+}
+
+constexpr SymbolTable kSymbolTable = make_symbol_table();
+
+// Directed edge a -> b of a visited triangle whose far side has not been
+// explored yet; o is the vertex opposite the edge in that triangle
+struct Gate {
+    uint32_t a, b, o;
+    bool open;
+};
+
+// A vertex is predicted as value[a] + value[b] - value[o]. Vertices that are
+// not reached across a gate use their predecessor (a == b == o).
+struct Prediction {
+    uint32_t a, b, o;
+};
+
+// Open gates by vertex. Only the most recent gate into and out of each vertex
+// is tracked, which on a manifold boundary is the only one; index checks
+// against the stack reject entries that were popped or closed.
+class GateStack {
+public:
+    explicit GateStack(size_t vertex_count)
+        : into_(vertex_count, UINT32_MAX), out_of_(vertex_count, UINT32_MAX) {
+        gates_.reserve(vertex_count + 3);
+    }
+
+    bool empty() const { return gates_.empty(); }
+
+    Gate pop() {
+        const Gate gate = gates_.back();
+        gates_.pop_back();
+        return gate;
+    }
+
+    void push(uint32_t a, uint32_t b, uint32_t o) {
+        const uint32_t index = static_cast<uint32_t>(gates_.size());
+        out_of_[a] = index;
+        into_[b] = index;
+        gates_.push_back({a, b, o, true});
+    }
+
+    // Open gate x -> v, or nullptr
+    Gate* into(uint32_t v) {
+        const uint32_t index = into_[v];
+        return index < gates_.size() && gates_[index].open && gates_[index].b == v
+                   ? &gates_[index] : nullptr;
+    }
+
+    // Open gate v -> x, or nullptr
+    Gate* out_of(uint32_t v) {
+        const uint32_t index = out_of_[v];
+        return index < gates_.size() && gates_[index].open && gates_[index].a == v
+                   ? &gates_[index] : nullptr;
+    }
+
+    // Adds triangle (b, a, c) across gate a -> b. Its edges a -> c and c -> b
+    // close the matching open gates or become gates themselves.
+    void advance(const Gate& gate, uint32_t c) {
+        Gate* left = into(gate.a);
+        Gate* right = out_of(gate.b);
+        const bool close_left = left && left->a == c;
+        const bool close_right = right && right->b == c;
+        if (close_left) {
+            left->open = false;
+        }
+        if (close_right) {
+            right->open = false;
+        }
+        if (!close_right) {
+            push(c, gate.b, gate.a);
+        }
+        if (!close_left) {
+            push(gate.a, c, gate.b);
+        }
+    }
+
+private:
+    std::vector<Gate> gates_;
+    std::vector<uint32_t> into_;
+    std::vector<uint32_t> out_of_;
+};
+
+class SymbolWriter {
+public:
+    void put(uint8_t symbol) {
+        const SymbolCode code = kSymbolCodes[symbol];
+        for (unsigned i = 0; i < code.length; i++) {
+            if (bit_count % 8 == 0) {
+                bytes.push_back(0);
+            }
+            bytes.back() |= static_cast<uint8_t>(((code.bits >> i) & 1) << (bit_count % 8));
+            bit_count++;
+        }
+    }
+
+    std::vector<uint8_t> bytes;
+    size_t bit_count = 0;
+};
+
+class SymbolReader {
+public:
+    SymbolReader(const uint8_t* data, size_t bit_count)
+        : data_(data), bit_count_(bit_count), byte_count_((bit_count + 7) / 8) {}
+
+    // Next symbol, or -1 past the end of the stream
+    int next() {
+        if (position_ >= bit_count_) {
+            return -1;
+        }
+        const size_t byte = position_ >> 3;
+        uint32_t window = data_[byte];
+        if (byte + 1 < byte_count_) {
+            window |= static_cast<uint32_t>(data_[byte + 1]) << 8;
+        }
+        window = (window >> (position_ & 7)) & 15;
+        position_ += kSymbolTable.length[window];
+        return position_ <= bit_count_ ? kSymbolTable.symbol[window] : -1;
+    }
+
+private:
+    const uint8_t* data_;
+    size_t bit_count_;
+    size_t byte_count_;
+    size_t position_ = 0;
+};
+
+inline uint64_t edge_key(uint32_t a, uint32_t b) {
+    return (static_cast<uint64_t>(a) << 32) | b;
+}
+
+inline float sign_not_zero(float value) {
+    return value < 0.0f ? -1.0f : 1.0f;
+}
+
+// Octahedral mapping of a unit vector to two components in [0, max_q]
+void oct_encode(const float* normal, int32_t max_q, int32_t* out) {
+    float x = normal[0], y = normal[1], z = normal[2];
+    float l1 = std::fabs(x) + std::fabs(y) + std::fabs(z);
+    if (!(l1 > 0.0f)) {
+        x = 0.0f;
+        y = 0.0f;
+        z = 1.0f;
+        l1 = 1.0f;
+    }
+    x /= l1;
+    y /= l1;
+    if (z < 0.0f) {
+        const float fx = (1.0f - std::fabs(y)) * sign_not_zero(x);
+        const float fy = (1.0f - std::fabs(x)) * sign_not_zero(y);
+        x = fx;
+        y = fy;
+    }
+    out[0] = static_cast<int32_t>(std::lrint((x * 0.5f + 0.5f) * max_q));
+    out[1] = static_cast<int32_t>(std::lrint((y * 0.5f + 0.5f) * max_q));
+}
+
+void oct_decode(int32_t qx, int32_t qy, float scale, float* normal) {
+    float x = qx * scale - 1.0f;
+    float y = qy * scale - 1.0f;
+    const float z = 1.0f - std::fabs(x) - std::fabs(y);
+    if (z < 0.0f) {
+        const float fx = (1.0f - std::fabs(y)) * sign_not_zero(x);
+        const float fy = (1.0f - std::fabs(x)) * sign_not_zero(y);
+        x = fx;
+        y = fy;
+    }
+    const float length = std::sqrt(x * x + y * y + z * z);
+    const float inverse = length > 0.0f ? 1.0f / length : 0.0f;
+    normal[0] = x * inverse;
+    normal[1] = y * inverse;
+    normal[2] = z * inverse;
+}
+
+struct Traversal {
+    std::vector<uint32_t> order;          // Output vertex -> input vertex
+    std::vector<Prediction> predictions;  // Per output vertex
+    SymbolWriter symbols;
+    std::vector<uint32_t> refs;           // Distances back for REF vertices
+};
+
+/*
+ * Depth-first traversal over triangles, EdgeBreaker style. Popping a gate
+ * either finds nothing across it (END) or the next triangle, whose third
+ * vertex is new (NEW), is the neighbour of the gate on the open boundary
+ * (LEFT, RIGHT), or is some other earlier vertex (REF). The new triangle's
+ * remaining edges close the open gates they coincide with, the others become
+ * gates. On manifold meshes nearly every triangle is NEW, LEFT or RIGHT,
+ * which need no vertex index. Triangles that cannot be reached across an
+ * edge with consistent orientation start a new component.
+ */
+class ConnectivityEncoder {
+public:
+    ConnectivityEncoder(const MeshData& data, Traversal& out)
+        : indices_(data.indices.data()), triangle_count_(data.triangle_count()),
+          vertex_count_(static_cast<uint32_t>(data.vertex_count())), out_(out),
+          gates_(data.vertex_count()) {}
+
+    void run() {
+        build_edges();
+        visited_.assign(triangle_count_, 0);
+        remap_.assign(vertex_count_, kNoVertex);
+        out_.order.reserve(vertex_count_);
+        out_.predictions.reserve(vertex_count_);
+
+        size_t emitted = 0;
+        size_t cursor = 0;
+        while (emitted < triangle_count_) {
+            if (gates_.empty()) {
+                while (visited_[cursor]) {
+                    cursor++;
+                }
+                start_component(static_cast<uint32_t>(cursor));
+                emitted++;
+                continue;
+            }
+
+            const Gate gate = gates_.pop();
+            if (!gate.open) {
+                continue;
+            }
+
+            const uint32_t face = find_face(gate.b, gate.a);
+            if (face == kNoFace) {
+                out_.symbols.put(kSymbolEnd);
+                continue;
+            }
+            visited_[face] = 1;
+            emitted++;
+            const uint32_t c = third_vertex(face, gate.b, gate.a);
+
+            if (remap_[c] == kNoVertex) {
+                out_.symbols.put(kSymbolNew);
+                add_vertex(c, {remap_[gate.a], remap_[gate.b], remap_[gate.o]});
+            } else if (const Gate* left = gates_.into(gate.a); left && left->a == c) {
+                out_.symbols.put(kSymbolLeft);
+            } else if (const Gate* right = gates_.out_of(gate.b); right && right->b == c) {
+                out_.symbols.put(kSymbolRight);
+            } else {
+                out_.symbols.put(kSymbolRef);
+                out_.refs.push_back(static_cast<uint32_t>(out_.order.size() - 1 - remap_[c]));
+            }
+            gates_.advance(gate, c);
+        }
+
+        // Vertices no triangle refers to keep their place after the others
+        for (uint32_t v = 0; v < vertex_count_; v++) {
+            if (remap_[v] == kNoVertex) {
+                add_vertex(v, previous_prediction());
+            }
+        }
+    }
+
+private:
+    void build_edges() {
+        edges_.reserve(triangle_count_ * 3);
+        for (size_t f = 0; f < triangle_count_; f++) {
+            const uint32_t* t = indices_ + 3 * f;
+            if (t[0] == t[1] || t[1] == t[2] || t[2] == t[0]) {
+                continue;   // Degenerate triangles are only ever component starts
+            }
+            for (int k = 0; k < 3; k++) {
+                edges_.push_back({edge_key(t[k], t[(k + 1) % 3]), static_cast<uint32_t>(f)});
+            }
+        }
+        std::sort(edges_.begin(), edges_.end());
+    }
+
+    // First unvisited triangle containing the directed edge a -> b
+    uint32_t find_face(uint32_t a, uint32_t b) const {
+        const uint64_t key = edge_key(a, b);
+        auto it = std::lower_bound(edges_.begin(), edges_.end(), std::make_pair(key, 0u));
+        for (; it != edges_.end() && it->first == key; ++it) {
+            if (!visited_[it->second]) {
+                return it->second;
+            }
+        }
+        return kNoFace;
+    }
+
+    uint32_t third_vertex(uint32_t face, uint32_t a, uint32_t b) const {
+        const uint32_t* t = indices_ + 3 * static_cast<size_t>(face);
+        for (int k = 0; k < 3; k++) {
+            if (t[k] == a && t[(k + 1) % 3] == b) {
+                return t[(k + 2) % 3];
+            }
+        }
+        return t[0];
+    }
+
+    Prediction previous_prediction() const {
+        const uint32_t previous = out_.order.empty() ? 0 : static_cast<uint32_t>(out_.order.size() - 1);
+        return {previous, previous, previous};
+    }
+
+    void add_vertex(uint32_t vertex, const Prediction& prediction) {
+        remap_[vertex] = static_cast<uint32_t>(out_.order.size());
+        out_.order.push_back(vertex);
+        out_.predictions.push_back(prediction);
+    }
+
+    void start_component(uint32_t face) {
+        visited_[face] = 1;
+        const uint32_t* t = indices_ + 3 * static_cast<size_t>(face);
+        for (int k = 0; k < 3; k++) {
+            if (remap_[t[k]] == kNoVertex) {
+                out_.symbols.put(kSymbolNew);
+                add_vertex(t[k], previous_prediction());
+            } else {
+                out_.symbols.put(kSymbolRef);
+                out_.refs.push_back(static_cast<uint32_t>(out_.order.size() - 1 - remap_[t[k]]));
+            }
+        }
+        if (t[0] != t[1] && t[1] != t[2] && t[2] != t[0]) {
+            gates_.push(t[2], t[0], t[1]);
+            gates_.push(t[1], t[2], t[0]);
+            gates_.push(t[0], t[1], t[2]);
+        }
+    }
+
+    const uint32_t* indices_;
+    size_t triangle_count_;
+    uint32_t vertex_count_;
+    Traversal& out_;
+
+    std::vector<std::pair<uint64_t, uint32_t>> edges_;   // Sorted directed edges
+    std::vector<uint8_t> visited_;
+    std::vector<uint32_t> remap_;                        // Input vertex -> output vertex
+    GateStack gates_;                                    // Input vertex ids
+};
+
+// Mirrors ConnectivityEncoder; returns false on malformed streams
+bool decode_connectivity(SymbolReader& symbols, const std::vector<uint32_t>& refs,
+                         uint32_t vertex_count, size_t triangle_count, uint32_t* indices,
+                         Prediction* predictions, uint32_t& vertices_reached) {
+    GateStack gates(vertex_count);
+    size_t r = 0;
+    uint32_t next = 0;
+    auto ref = [&](uint32_t& vertex) {
+        if (r >= refs.size() || refs[r] >= next) {
+            return false;
+        }
+        vertex = next - 1 - refs[r++];
+        return true;
+    };
+
+    uint32_t* out = indices;
+    for (size_t faces = 0; faces < triangle_count;) {
+        if (gates.empty()) {
+            uint32_t t[3];
+            for (int k = 0; k < 3; k++) {
+                const int symbol = symbols.next();
+                if (symbol == kSymbolNew && next < vertex_count) {
+                    const uint32_t previous = next ? next - 1 : 0;
+                    predictions[next] = {previous, previous, previous};
+                    t[k] = next++;
+                } else if (symbol != kSymbolRef || !ref(t[k])) {
+                    return false;
+                }
+            }
+            out[0] = t[0];
+            out[1] = t[1];
+            out[2] = t[2];
+            out += 3;
+            faces++;
+            if (t[0] != t[1] && t[1] != t[2] && t[2] != t[0]) {
+                gates.push(t[2], t[0], t[1]);
+                gates.push(t[1], t[2], t[0]);
+                gates.push(t[0], t[1], t[2]);
+            }
+            continue;
+        }
+
+        const Gate gate = gates.pop();
+        if (!gate.open) {
+            continue;
+        }
+
+        uint32_t c;
+        switch (symbols.next()) {
+        case kSymbolEnd:
+            continue;
+        case kSymbolNew:
+            if (next >= vertex_count) {
+                return false;
+            }
+            c = next++;
+            predictions[c] = {gate.a, gate.b, gate.o};
+            break;
+        case kSymbolLeft: {
+            const Gate* left = gates.into(gate.a);
+            if (!left) {
+                return false;
+            }
+            c = left->a;
+            break;
+        }
+        case kSymbolRight: {
+            const Gate* right = gates.out_of(gate.b);
+            if (!right) {
+                return false;
+            }
+            c = right->b;
+            break;
+        }
+        case kSymbolRef:
+            if (!ref(c)) {
+                return false;
+            }
+            break;
+        default:
+            return false;
+        }
+
+        out[0] = gate.b;
+        out[1] = gate.a;
+        out[2] = c;
+        out += 3;
+        faces++;
+        gates.advance(gate, c);
+    }
+
+    vertices_reached = next;
+    return true;
+}
+
+// Parallelogram reconstruction of one quantized component, in place. The
+// arithmetic wraps so corrupted residuals cannot overflow.
+void reconstruct_parallelogram(const Prediction* predictions, size_t count, int32_t* values) {
+    uint32_t* q = reinterpret_cast<uint32_t*>(values);
+    for (size_t v = 1; v < count; v++) {
+        const Prediction& p = predictions[v];
+        q[v] += q[p.a] + q[p.b] - q[p.o];
+    }
+}
+
+// Normals are predicted by the mean of the gate endpoints
+void reconstruct_average(const Prediction* predictions, size_t count, int32_t* values) {
+    uint32_t* q = reinterpret_cast<uint32_t*>(values);
+    for (size_t v = 1; v < count; v++) {
+        const Prediction& p = predictions[v];
+        q[v] += static_cast<uint32_t>((static_cast<int64_t>(values[p.a]) + values[p.b] + 1) >> 1);
+    }
+}
+
+void append_residuals(const std::vector<int32_t>& values, const std::vector<Prediction>& predictions,
+                      bool average, std::vector<uint8_t>& out) {
+    std::vector<uint32_t> residuals(values.size());
+    for (size_t v = 0; v < values.size(); v++) {
+        int32_t predicted = 0;
+        if (v > 0) {
+            const Prediction& p = predictions[v];
+            predicted = average ? (values[p.a] + values[p.b] + 1) >> 1
+                                : values[p.a] + values[p.b] - values[p.o];
+        }
+        residuals[v] = zigzag_encode(values[v] - predicted);
+    }
+    bitpack_encode(residuals.data(), residuals.size(), out);
+}
+
+inline int32_t quantize(float value, float minimum, float scale, int32_t max_q) {
+    const int32_t q = static_cast<int32_t>(std::lrint((value - minimum) * scale));
+    return std::clamp(q, 0, max_q);
+}
+
+} // namespace
+
+/*
+ * Track layout (varints are LEB128, fixed-width fields little-endian):
+ *
+ *   u8      version
+ *   u8      flags (normals, uvs)
+ *   u8      position, normal and uv quantization bits
+ *   varint  vertex count, triangle count
+ *   f32     position minimum x, y, z and extent
+ *   f32     uv minimum u, v and extent u, v (with uvs)
+ *   varint  symbol bit count, then prefix coded connectivity symbols
+ *   varint  reference count, then svb references
+ *   packed  zigzag residuals per component: x, y, z, normal u, v, uv u, v
+ *
+ * Vertices are numbered in the order the traversal reaches them. Positions
+ * and uvs are predicted with the parallelogram rule from the triangle across
+ * the gate, normals from the gate endpoints, so residuals stay small and
+ * every component is an independent bit-packed stream.
+ */
+
+MeshQuantization MeshQuantization::from_quality(uint8_t quality) {
+    MeshQuantization quantization;
+    quantization.position_bits = static_cast<uint8_t>(8 + quality * 8 / 100);
+    quantization.normal_bits = static_cast<uint8_t>(6 + quality * 6 / 100);
+    quantization.uv_bits = static_cast<uint8_t>(8 + quality * 6 / 100);
+    return quantization;
+}
+
+fresco_error_t MeshCodec::validate(const MeshData& data) {
+    const size_t vertex_count = data.vertex_count();
+    if (data.positions.size() % 3 != 0 || data.indices.size() % 3 != 0 ||
+        vertex_count >= kNoVertex ||
+        (!data.normals.empty() && data.normals.size() != vertex_count * 3) ||
+        (!data.uvs.empty() && data.uvs.size() != vertex_count * 2)) {
+        return FRESCO_ERROR_INVALID_PARAMETER;
+    }
+    for (uint32_t index : data.indices) {
+        if (index >= vertex_count) {
+            return FRESCO_ERROR_INVALID_PARAMETER;
+        }
+    }
+    auto finite = [](const std::vector<float>& values) {
+        return std::all_of(values.begin(), values.end(), [](float v) { return std::isfinite(v); });
+    };
+    if (!finite(data.positions) || !finite(data.normals) || !finite(data.uvs)) {
+        return FRESCO_ERROR_INVALID_PARAMETER;
+    }
+    return FRESCO_OK;
+}
+
+fresco_error_t MeshCodec::encode(const MeshData& data, const MeshQuantization& quantization,
+                                std::vector<uint8_t>& encoded_data) {
+    fresco_error_t result = validate(data);
+    if (result != FRESCO_OK) {
+        return result;
+    }
+    if (quantization.position_bits < 1 || quantization.position_bits > 24 ||
+        quantization.normal_bits < 2 || quantization.normal_bits > 16 ||
+        quantization.uv_bits < 1 || quantization.uv_bits > 24) {
+        return FRESCO_ERROR_INVALID_PARAMETER;
+    }
+
+    const size_t vertex_count = data.vertex_count();
+    const bool has_normals = !data.normals.empty();
+    const bool has_uvs = !data.uvs.empty();
+
+    Traversal traversal;
+    ConnectivityEncoder(data, traversal).run();
+
+    // Bounds of the positions; one extent for all axes keeps the grid cubic
+    float position_min[3] = {0.0f, 0.0f, 0.0f};
+    float position_extent = 0.0f;
+    float uv_min[2] = {0.0f, 0.0f};
+    float uv_extent[2] = {0.0f, 0.0f};
+    if (quantization.fixed_grid) {
+        std::copy(quantization.grid_min, quantization.grid_min + 3, position_min);
+        position_extent = quantization.grid_extent;
+    } else if (vertex_count > 0) {
+        for (int axis = 0; axis < 3; axis++) {
+            float lo = data.positions[axis], hi = lo;
+            for (size_t v = 1; v < vertex_count; v++) {
+                lo = std::min(lo, data.positions[v * 3 + axis]);
+                hi = std::max(hi, data.positions[v * 3 + axis]);
+            }
+            position_min[axis] = lo;
+            position_extent = std::max(position_extent, hi - lo);
+        }
+    }
+    if (vertex_count > 0) {
+        for (int axis = 0; has_uvs && axis < 2; axis++) {
+            float lo = data.uvs[axis], hi = lo;
+            for (size_t v = 1; v < vertex_count; v++) {
+                lo = std::min(lo, data.uvs[v * 2 + axis]);
+                hi = std::max(hi, data.uvs[v * 2 + axis]);
+            }
+            uv_min[axis] = lo;
+            uv_extent[axis] = hi - lo;
+        }
+    }
+    if (!std::isfinite(position_extent) || position_extent < 0.0f ||
+        !std::isfinite(position_min[0]) || !std::isfinite(position_min[1]) ||
+        !std::isfinite(position_min[2]) || !std::isfinite(uv_extent[0]) ||
+        !std::isfinite(uv_extent[1])) {
+        return FRESCO_ERROR_INVALID_PARAMETER;
+    }
+
+    encoded_data.clear();
+    encoded_data.push_back(kMeshVersion);
+    encoded_data.push_back((has_normals ? kFlagNormals : 0) | (has_uvs ? kFlagUvs : 0));
+    encoded_data.push_back(quantization.position_bits);
+    encoded_data.push_back(quantization.normal_bits);
+    encoded_data.push_back(quantization.uv_bits);
+    write_varint(encoded_data, vertex_count);
+    write_varint(encoded_data, data.triangle_count());
+    for (float value : position_min) {
+        write_f32_le(encoded_data, value);
+    }
+    write_f32_le(encoded_data, position_extent);
+    if (has_uvs) {
+        write_f32_le(encoded_data, uv_min[0]);
+        write_f32_le(encoded_data, uv_min[1]);
+        write_f32_le(encoded_data, uv_extent[0]);
+        write_f32_le(encoded_data, uv_extent[1]);
+    }
+
+    write_varint(encoded_data, traversal.symbols.bit_count);
+    encoded_data.insert(encoded_data.end(), traversal.symbols.bytes.begin(),
+                        traversal.symbols.bytes.end());
+    write_varint(encoded_data, traversal.refs.size());
+    stream_vbyte_encode(traversal.refs.data(), traversal.refs.size(), encoded_data);
+
+    // Quantize in traversal order, one array per component
+    std::vector<int32_t> values(vertex_count);
+    const int32_t position_max = (1 << quantization.position_bits) - 1;
+    const float position_scale = position_extent > 0.0f ? position_max / position_extent : 0.0f;
+    for (int axis = 0; axis < 3; axis++) {
+        for (size_t v = 0; v < vertex_count; v++) {
+            values[v] = quantize(data.positions[traversal.order[v] * 3 + axis], position_min[axis],
+                                 position_scale, position_max);
+        }
+        append_residuals(values, traversal.predictions, false, encoded_data);
+    }
+
+    if (has_normals) {
+        const int32_t normal_max = (1 << quantization.normal_bits) - 1;
+        std::vector<int32_t> octahedral(vertex_count * 2);
+        for (size_t v = 0; v < vertex_count; v++) {
+            oct_encode(&data.normals[traversal.order[v] * 3], normal_max, &octahedral[v * 2]);
+        }
+        for (int axis = 0; axis < 2; axis++) {
+            for (size_t v = 0; v < vertex_count; v++) {
+                values[v] = octahedral[v * 2 + axis];
+            }
+            append_residuals(values, traversal.predictions, true, encoded_data);
+        }
+    }
+
+    if (has_uvs) {
+        const int32_t uv_max = (1 << quantization.uv_bits) - 1;
+        for (int axis = 0; axis < 2; axis++) {
+            const float scale = uv_extent[axis] > 0.0f ? uv_max / uv_extent[axis] : 0.0f;
+            for (size_t v = 0; v < vertex_count; v++) {
+                values[v] = quantize(data.uvs[traversal.order[v] * 2 + axis], uv_min[axis], scale,
+                                     uv_max);
+            }
+            append_residuals(values, traversal.predictions, false, encoded_data);
+        }
+    }
+
+    return FRESCO_OK;
+}
+
+fresco_error_t MeshCodec::decode(const uint8_t* encoded_data, size_t encoded_size,
+                                MeshData& data) {
+    const uint8_t* p = encoded_data;
+    const uint8_t* end = encoded_data + encoded_size;
+
+    if (encoded_size < 5 || p[0] != kMeshVersion) {
+        return FRESCO_ERROR_UNSUPPORTED_FORMAT;
+    }
+    const uint8_t flags = p[1];
+    const uint8_t position_bits = p[2];
+    const uint8_t normal_bits = p[3];
+    const uint8_t uv_bits = p[4];
+    p += 5;
+    if (position_bits < 1 || position_bits > 24 || normal_bits < 2 || normal_bits > 16 ||
+        uv_bits < 1 || uv_bits > 24) {
+        return FRESCO_ERROR_CORRUPTED_DATA;
+    }
+    const bool has_normals = flags & kFlagNormals;
+    const bool has_uvs = flags & kFlagUvs;
+
+    uint64_t vertex_count, triangle_count;
+    float position_min[3], position_extent;
+    float uv_min[2] = {0.0f, 0.0f}, uv_extent[2] = {0.0f, 0.0f};
+    if (!read_varint(p, end, vertex_count) || !read_varint(p, end, triangle_count) ||
+        !read_f32_le(p, end, position_min[0]) || !read_f32_le(p, end, position_min[1]) ||
+        !read_f32_le(p, end, position_min[2]) || !read_f32_le(p, end, position_extent)) {
+        return FRESCO_ERROR_CORRUPTED_DATA;
+    }
+    if (has_uvs && (!read_f32_le(p, end, uv_min[0]) || !read_f32_le(p, end, uv_min[1]) ||
+                    !read_f32_le(p, end, uv_extent[0]) || !read_f32_le(p, end, uv_extent[1]))) {
+        return FRESCO_ERROR_CORRUPTED_DATA;
+    }
+
+    // Every triangle takes at least one symbol bit, every 128 vertices at
+    // least one byte in each of three position streams
+    uint64_t symbol_bits;
+    if (!read_varint(p, end, symbol_bits) ||
+        symbol_bits > 8 * static_cast<uint64_t>(end - p) || triangle_count > symbol_bits) {
+        return FRESCO_ERROR_CORRUPTED_DATA;
+    }
+    SymbolReader symbols(p, symbol_bits);
+    p += (symbol_bits + 7) / 8;
+    if (vertex_count >= kNoVertex || vertex_count > static_cast<uint64_t>(end - p) / 3 * 128) {
+        return FRESCO_ERROR_CORRUPTED_DATA;
+    }
+
+    uint64_t ref_count;
+    if (!read_varint(p, end, ref_count) || ref_count > static_cast<uint64_t>(end - p)) {
+        return FRESCO_ERROR_CORRUPTED_DATA;
+    }
+    std::vector<uint32_t> refs(ref_count);
+    p = stream_vbyte_decode(p, end, refs.size(), refs.data());
+    if (!p) {
+        return FRESCO_ERROR_CORRUPTED_DATA;
+    }
+
+    data.indices.resize(triangle_count * 3);
+    std::vector<Prediction> predictions(vertex_count);
+    uint32_t reached = 0;
+    if (!decode_connectivity(symbols, refs, static_cast<uint32_t>(vertex_count),
+                             triangle_count, data.indices.data(), predictions.data(), reached)) {
+        return FRESCO_ERROR_CORRUPTED_DATA;
+    }
+    for (uint32_t v = std::max(reached, 1u); v < vertex_count; v++) {
+        predictions[v] = {v - 1, v - 1, v - 1};
+    }
+
+    // Residual streams; prediction runs in place over each component
+    const size_t component_count = 3 + (has_normals ? 2 : 0) + (has_uvs ? 2 : 0);
+    std::vector<int32_t> components(component_count * vertex_count);
+    for (size_t c = 0; c < component_count; c++) {
+        int32_t* values = components.data() + c * vertex_count;
+        p = bitpack_decode_zigzag(p, end, vertex_count, values);
+        if (!p) {
+            return FRESCO_ERROR_CORRUPTED_DATA;
+        }
+        const bool normal = has_normals && (c == 3 || c == 4);
+        if (normal) {
+            reconstruct_average(predictions.data(), vertex_count, values);
+        } else {
+            reconstruct_parallelogram(predictions.data(), vertex_count, values);
+        }
+    }
+
+    const int32_t* component = components.data();
+    data.positions.resize(vertex_count * 3);
+    const float position_step = position_extent / static_cast<float>((1 << position_bits) - 1);
+    for (int axis = 0; axis < 3; axis++, component += vertex_count) {
+        float* out = data.positions.data() + axis;
+        for (size_t v = 0; v < vertex_count; v++) {
+            out[v * 3] = position_min[axis] + static_cast<float>(component[v]) * position_step;
+        }
+    }
+
+    data.normals.clear();
+    if (has_normals) {
+        data.normals.resize(vertex_count * 3);
+        const float scale = 2.0f / static_cast<float>((1 << normal_bits) - 1);
+        for (size_t v = 0; v < vertex_count; v++) {
+            oct_decode(component[v], component[vertex_count + v], scale, &data.normals[v * 3]);
+        }
+        component += 2 * vertex_count;
+    }
+
+    data.uvs.clear();
+    if (has_uvs) {
+        data.uvs.resize(vertex_count * 2);
+        for (int axis = 0; axis < 2; axis++, component += vertex_count) {
+            const float step = uv_extent[axis] / static_cast<float>((1 << uv_bits) - 1);
+            float* out = data.uvs.data() + axis;
+            for (size_t v = 0; v < vertex_count; v++) {
+                out[v * 2] = uv_min[axis] + static_cast<float>(component[v]) * step;
+            }
+        }
+    }
+
+    return FRESCO_OK;
+}
+
+fresco_error_t MeshCodec::read_header(const uint8_t* encoded_data, size_t encoded_size,
+                                     MeshHeader& header) {
+    const uint8_t* p = encoded_data;
+    const uint8_t* end = encoded_data + encoded_size;
+    if (encoded_size < 5 || p[0] != kMeshVersion) {
+        return FRESCO_ERROR_UNSUPPORTED_FORMAT;
+    }
+    p += 5;
+    if (!read_varint(p, end, header.vertex_count) || !read_varint(p, end, header.triangle_count) ||
+        !read_f32_le(p, end, header.position_min[0]) || !read_f32_le(p, end, header.position_min[1]) ||
+        !read_f32_le(p, end, header.position_min[2]) || !read_f32_le(p, end, header.position_extent)) {
+        return FRESCO_ERROR_CORRUPTED_DATA;
+    }
+    return FRESCO_OK;
+}
 
 } // namespace fresco
@@ -0,0 +1,75 @@
+/**
+ * @file 3d_codec.h
+ * @brief FRESCO 3D model codec interface
+ * @author Mehmet T. AKALIN
+ * @date 2025
+ * @license MIT
+ */
+
+#ifndef FRESCO_3D_CODEC_H
+#define FRESCO_3D_CODEC_H
+
+#include "fresco/fresco.h"
+#include <vector>
+
+namespace fresco {
+
+// Triangle mesh with per-vertex attributes, stored structure-of-arrays
+struct MeshData {
+    std::vector<float> positions;   // x, y, z per vertex
+    std::vector<float> normals;     // Empty, or x, y, z per vertex
+    std::vector<float> uvs;         // Empty, or u, v per vertex
+    std::vector<uint32_t> indices;  // Three per triangle
+
+    size_t vertex_count() const { return positions.size() / 3; }
+    size_t triangle_count() const { return indices.size() / 3; }
+};
+
+struct MeshQuantization {
+    uint8_t position_bits;
+    uint8_t normal_bits;   // Per octahedral component
+    uint8_t uv_bits;
+
+    // Position grid shared by several meshes, so vertices on a common border
+    // dequantize to the same coordinates; otherwise fitted to each mesh
+    bool fixed_grid = false;
+    float grid_min[3] = {0.0f, 0.0f, 0.0f};
+    float grid_extent = 0.0f;
+
+    static MeshQuantization from_quality(uint8_t quality);
+};
+
+// Counts and position grid from the header of an encoded mesh
+struct MeshHeader {
+    uint64_t vertex_count;
+    uint64_t triangle_count;
+    float position_min[3];
+    float position_extent;
+};
+
+class MeshCodec {
+public:
+    MeshCodec() = default;
+    ~MeshCodec() = default;
+
+    // Checks attribute sizes, index range and that values are finite
+    static fresco_error_t validate(const MeshData& data);
+
+    /**
+     * Vertices and triangles are renumbered in traversal order, so the
+     * decoded mesh is the same surface with a different vertex and triangle
+     * order. Triangle orientation is preserved.
+     */
+    fresco_error_t encode(const MeshData& data, const MeshQuantization& quantization,
+                         std::vector<uint8_t>& encoded_data);
+
+    fresco_error_t decode(const uint8_t* encoded_data, size_t encoded_size,
+                         MeshData& data);
+
+    static fresco_error_t read_header(const uint8_t* encoded_data, size_t encoded_size,
+                                      MeshHeader& header);
+};
+
+} // namespace fresco
+
+#endif // FRESCO_3D_CODEC_H
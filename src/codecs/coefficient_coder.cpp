@@ -0,0 +1,320 @@
+/**
+ * @file coefficient_coder.cpp
+ * @brief Context-modelled entropy coding of quantized wavelet subbands
+ * @author Mehmet T. AKALIN
+ * @date 2025
+ * @license MIT
+ */
+
+#include "coefficient_coder.h"
+#include "core/bitpack.h"
+#include "core/varint.h"
+#include <algorithm>
+#include <cstdlib>
+#include <type_traits>
+#include <vector>
+
+namespace fresco {
+
+namespace {
+
+inline uint32_t bit_length(uint32_t value) {
+    uint32_t length = 0;
+    while (value) {
+        length++;
+        value >>= 1;
+    }
+    return length;
+}
+
+inline uint32_t magnitude(int32_t value) {
+    return static_cast<uint32_t>(value < 0 ? -static_cast<int64_t>(value) : value);
+}
+
+// Neighbourhood activity 2|L| + 2|T| + |TL| + |TR| on a log scale
+inline uint32_t magnitude_context(uint32_t activity) {
+    return std::min(bit_length(activity), kMagnitudeContexts - 1);
+}
+
+inline uint32_t sign_context(int32_t left, int32_t top) {
+    const uint32_t l = left < 0 ? 0 : (left == 0 ? 1 : 2);
+    const uint32_t t = top < 0 ? 0 : (top == 0 ? 1 : 2);
+    return l * 3 + t;
+}
+
+// Both sides of the coder share the binarization; the encoder passes the
+// value through, the decoder reads it
+struct EncodeSide {
+    RangeEncoder& coder;
+    uint32_t bit(BitModel& model, uint32_t bit) {
+        coder.encode(model, bit);
+        return bit;
+    }
+    uint32_t bits(uint32_t value, uint32_t count) {
+        coder.encode_direct(value, count);
+        return value;
+    }
+};
+
+struct DecodeSide {
+    RangeDecoder& coder;
+    uint32_t bit(BitModel& model, uint32_t) { return coder.decode(model); }
+    uint32_t bits(uint32_t, uint32_t count) { return coder.decode_direct(count); }
+};
+
+template <typename Side>
+int32_t code_value(Side& side, BandModels& models, uint32_t context, uint32_t sign_ctx,
+                   int32_t value) {
+    const uint32_t abs_value = magnitude(value);
+    if (!side.bit(models.zero[context], abs_value != 0)) {
+        return 0;
+    }
+    const uint32_t negative = side.bit(models.sign[sign_ctx], value < 0);
+    uint32_t result = 1;
+    if (side.bit(models.one[context], abs_value > 1)) {
+        // abs - 1 = 2^e + mantissa
+        const uint32_t rest = abs_value > 1 ? abs_value - 1 : 1;
+        const uint32_t target = bit_length(rest) - 1;
+        BitModel* exponent_models =
+            models.exponent[std::min(context / 4, kExponentContexts - 1)];
+        uint32_t exponent = 0;
+        while (exponent < kMaxExponent &&
+               side.bit(exponent_models[exponent], exponent < target)) {
+            exponent++;
+        }
+        const uint32_t mantissa = side.bits(rest & ((1u << exponent) - 1), exponent);
+        result = 1 + ((1u << exponent) | mantissa);
+    }
+    return negative ? -static_cast<int32_t>(result) : static_cast<int32_t>(result);
+}
+
+// LL band: raster order, residuals of the median edge predictor, contexts
+// from the neighbouring residuals
+// Reduced contexts look at the left and top neighbours only and share one
+// sign model
+inline uint32_t reduced_context(uint32_t left, uint32_t top) {
+    return std::min(bit_length(left + top), kMagnitudeContexts - 1);
+}
+
+template <typename Side, typename Value>
+void code_ll(Side& side, BandModels& models, const Subband& band, Value* plane, size_t stride,
+             bool reduced) {
+    const uint32_t width = band.width;
+    std::vector<int32_t> residuals(static_cast<size_t>(width) * band.height);
+    for (uint32_t y = 0; y < band.height; y++) {
+        Value* row = plane + (band.y + y) * stride + band.x;
+        const Value* above = y > 0 ? row - stride : nullptr;
+        int32_t* res_row = &residuals[static_cast<size_t>(y) * width];
+        const int32_t* res_above = y > 0 ? res_row - width : nullptr;
+        for (uint32_t x = 0; x < width; x++) {
+            int32_t prediction;
+            if (y == 0) {
+                prediction = x > 0 ? row[x - 1] : 0;
+            } else if (x == 0) {
+                prediction = above[0];
+            } else {
+                prediction = med_predict(row[x - 1], above[x], above[x - 1]);
+            }
+            const int32_t left = x > 0 ? res_row[x - 1] : 0;
+            const int32_t top = y > 0 ? res_above[x] : 0;
+            const int32_t top_left = (x > 0 && y > 0) ? res_above[x - 1] : 0;
+            const int32_t top_right = (y > 0 && x + 1 < width) ? res_above[x + 1] : 0;
+            uint32_t context, sign_ctx;
+            if (reduced) {
+                context = reduced_context(magnitude(left), magnitude(top));
+                sign_ctx = 0;
+            } else {
+                const uint32_t activity = 2 * magnitude(left) + 2 * magnitude(top) +
+                                          magnitude(top_left) + magnitude(top_right);
+                context = magnitude_context(activity);
+                sign_ctx = sign_context(left, top);
+            }
+            const int32_t residual = code_value(side, models, context, sign_ctx,
+                                                static_cast<int32_t>(row[x] - prediction));
+            res_row[x] = residual;
+            if constexpr (!std::is_const_v<Value>) {
+                row[x] = prediction + residual;
+            }
+        }
+    }
+}
+
+// Detail bands: 8x8 blocks in raster order, raster order inside a block
+template <typename Side, typename Value>
+void code_detail(Side& side, BandModels& models, const Subband& band, Value* plane,
+                 size_t stride, bool reduced) {
+    const uint32_t blocks_x = (band.width + kCoefficientBlock - 1) / kCoefficientBlock;
+    const uint32_t blocks_y = (band.height + kCoefficientBlock - 1) / kCoefficientBlock;
+    std::vector<uint8_t> nonzero(static_cast<size_t>(blocks_x) * blocks_y, 0);
+    Value* origin = plane + band.y * stride + band.x;
+    constexpr bool decoding = !std::is_const_v<Value>;
+
+    for (uint32_t by = 0; by < blocks_y; by++) {
+        for (uint32_t bx = 0; bx < blocks_x; bx++) {
+            const uint32_t x0 = bx * kCoefficientBlock;
+            const uint32_t y0 = by * kCoefficientBlock;
+            const uint32_t x1 = std::min(x0 + kCoefficientBlock, band.width);
+            const uint32_t y1 = std::min(y0 + kCoefficientBlock, band.height);
+
+            uint32_t any = 0;
+            if constexpr (!decoding) {
+                for (uint32_t y = y0; y < y1 && !any; y++) {
+                    for (uint32_t x = x0; x < x1; x++) {
+                        if (origin[y * stride + x] != 0) {
+                            any = 1;
+                            break;
+                        }
+                    }
+                }
+            }
+            const uint32_t block_ctx = (bx > 0 ? nonzero[by * blocks_x + bx - 1] : 0) +
+                                       (by > 0 ? nonzero[(by - 1) * blocks_x + bx] : 0);
+            any = side.bit(models.block_zero[block_ctx], any);
+            nonzero[by * blocks_x + bx] = static_cast<uint8_t>(any);
+            if (!any) {
+                if constexpr (decoding) {
+                    for (uint32_t y = y0; y < y1; y++) {
+                        std::fill(origin + y * stride + x0, origin + y * stride + x1, 0);
+                    }
+                }
+                continue;
+            }
+
+            for (uint32_t y = y0; y < y1; y++) {
+                Value* row = origin + y * stride;
+                const Value* above = y > 0 ? row - stride : nullptr;
+                // The top-right neighbour is decoded unless it sits in the
+                // next block of the same block row
+                const bool top_row_of_block = y == y0;
+                for (uint32_t x = x0; x < x1; x++) {
+                    const int32_t left = x > 0 ? row[x - 1] : 0;
+                    const int32_t top = above ? above[x] : 0;
+                    uint32_t context, sign_ctx;
+                    if (reduced) {
+                        context = reduced_context(magnitude(left), magnitude(top));
+                        sign_ctx = 0;
+                    } else {
+                        const int32_t top_left = (above && x > 0) ? above[x - 1] : 0;
+                        const bool has_top_right = above && x + 1 < band.width &&
+                                                   (x + 1 < x1 || top_row_of_block);
+                        const int32_t top_right = has_top_right ? above[x + 1] : 0;
+                        const uint32_t activity = 2 * magnitude(left) + 2 * magnitude(top) +
+                                                  magnitude(top_left) + magnitude(top_right);
+                        context = magnitude_context(activity);
+                        sign_ctx = sign_context(left, top);
+                    }
+                    const int32_t value = code_value(side, models, context, sign_ctx, row[x]);
+                    if constexpr (decoding) {
+                        row[x] = value;
+                    }
+                }
+            }
+        }
+    }
+}
+
+} // namespace
+
+uint32_t band_class(const Subband& band) {
+    if (band.orientation == Orientation::LL) {
+        return 0;
+    }
+    return std::min(band.level, kBandClasses - 1);
+}
+
+void encode_band(RangeEncoder& encoder, PlaneModels& models, const Subband& band,
+                 const int32_t* plane, size_t stride, bool reduced_contexts) {
+    if (band.width == 0 || band.height == 0) {
+        return;
+    }
+    EncodeSide side{encoder};
+    BandModels& band_models = models.bands[band_class(band)];
+    if (band.orientation == Orientation::LL) {
+        code_ll(side, band_models, band, plane, stride, reduced_contexts);
+    } else {
+        code_detail(side, band_models, band, plane, stride, reduced_contexts);
+    }
+}
+
+void decode_band(RangeDecoder& decoder, PlaneModels& models, const Subband& band,
+                 int32_t* plane, size_t stride, bool reduced_contexts) {
+    if (band.width == 0 || band.height == 0) {
+        return;
+    }
+    DecodeSide side{decoder};
+    BandModels& band_models = models.bands[band_class(band)];
+    if (band.orientation == Orientation::LL) {
+        code_ll(side, band_models, band, plane, stride, reduced_contexts);
+    } else {
+        code_detail(side, band_models, band, plane, stride, reduced_contexts);
+    }
+}
+
+void encode_band_static(const Subband& band, const int32_t* plane, size_t stride,
+                        std::vector<uint32_t>& scratch, std::vector<uint8_t>& out) {
+    const size_t count = static_cast<size_t>(band.width) * band.height;
+    if (count == 0) {
+        return;
+    }
+    scratch.resize(count);
+    uint32_t* values = scratch.data();
+    const int32_t* origin = plane + band.y * stride + band.x;
+    const bool lowpass = band.orientation == Orientation::LL;
+    for (uint32_t y = 0; y < band.height; y++) {
+        const int32_t* row = origin + y * stride;
+        const int32_t* above = row - stride;
+        for (uint32_t x = 0; x < band.width; x++) {
+            int32_t value = row[x];
+            if (lowpass) {
+                if (y == 0) {
+                    value -= x > 0 ? row[x - 1] : 0;
+                } else if (x == 0) {
+                    value -= above[0];
+                } else {
+                    value -= med_predict(row[x - 1], above[x], above[x - 1]);
+                }
+            }
+            *values++ = zigzag_encode(value);
+        }
+    }
+    bitpack_encode(scratch.data(), count, out);
+}
+
+const uint8_t* decode_band_static(const uint8_t* data, const uint8_t* end, const Subband& band,
+                                  int32_t* plane, size_t stride, std::vector<int32_t>& scratch) {
+    const size_t count = static_cast<size_t>(band.width) * band.height;
+    if (count == 0) {
+        return data;
+    }
+    scratch.resize(count);
+    data = bitpack_decode_zigzag(data, end, count, scratch.data());
+    if (!data) {
+        return nullptr;
+    }
+    const int32_t* values = scratch.data();
+    int32_t* origin = plane + band.y * stride + band.x;
+    const bool lowpass = band.orientation == Orientation::LL;
+    for (uint32_t y = 0; y < band.height; y++) {
+        int32_t* row = origin + y * stride;
+        const int32_t* above = row - stride;
+        if (!lowpass) {
+            std::copy(values, values + band.width, row);
+            values += band.width;
+            continue;
+        }
+        for (uint32_t x = 0; x < band.width; x++) {
+            int32_t prediction;
+            if (y == 0) {
+                prediction = x > 0 ? row[x - 1] : 0;
+            } else if (x == 0) {
+                prediction = above[0];
+            } else {
+                prediction = med_predict(row[x - 1], above[x], above[x - 1]);
+            }
+            row[x] = prediction + *values++;
+        }
+    }
+    return data;
+}
+
+} // namespace fresco
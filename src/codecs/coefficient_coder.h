@@ -0,0 +1,91 @@
+/**
+ * @file coefficient_coder.h
+ * @brief Context-modelled entropy coding of quantized wavelet subbands
+ * @author Mehmet T. AKALIN
+ * @date 2025
+ * @license MIT
+ */
+
+#ifndef FRESCO_COEFFICIENT_CODER_H
+#define FRESCO_COEFFICIENT_CODER_H
+
+#include "core/range_coder.h"
+#include "wavelet.h"
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+namespace fresco {
+
+// How the coefficients of a raster track are entropy coded
+enum class EntropyCoder : uint8_t {
+    Adaptive = 0,          // Range coding with neighbourhood contexts
+    AdaptiveReduced = 1,   // Range coding with left and top contexts only
+    Static = 2             // Bit-packed, no adaptation
+};
+
+constexpr uint32_t kCoefficientBlock = 8;
+constexpr uint32_t kBandClasses = 4;         // LL, then detail levels 1, 2 and 3+
+constexpr uint32_t kMagnitudeContexts = 12;
+constexpr uint32_t kExponentContexts = 3;
+constexpr uint32_t kMaxExponent = 24;
+
+// Adaptive models of one subband class
+struct BandModels {
+    BitModel block_zero[3];                  // By zero-ness of the left and top blocks
+    BitModel zero[kMagnitudeContexts];
+    BitModel sign[9];                        // By the signs of the left and top values
+    BitModel one[kMagnitudeContexts];
+    BitModel exponent[kExponentContexts][kMaxExponent];
+};
+
+// Models of one plane of a tile. They start fresh for every tile, so tiles
+// decode independently of each other.
+struct PlaneModels {
+    BandModels bands[kBandClasses];
+};
+
+uint32_t band_class(const Subband& band);
+
+/**
+ * Codes the quantized values of one subband of a plane. Detail bands are
+ * scanned in 8x8 blocks behind a block-is-zero flag; each value is a zero
+ * flag, a sign and an adaptive Exp-Golomb magnitude, with contexts from
+ * the already coded neighbours. The LL band is coded as the residual of a
+ * median edge predictor. Magnitudes must stay below 2^25.
+ */
+void encode_band(RangeEncoder& encoder, PlaneModels& models, const Subband& band,
+                 const int32_t* plane, size_t stride, bool reduced_contexts = false);
+
+void decode_band(RangeDecoder& decoder, PlaneModels& models, const Subband& band,
+                 int32_t* plane, size_t stride, bool reduced_contexts = false);
+
+/**
+ * Static coding for the fastest effort: the band in raster order (LL as
+ * median-predicted residuals), zigzag mapped and bit-packed in blocks of 128
+ * with one width per block. No models, no adaptation; all-zero stretches
+ * cost one byte per block.
+ */
+void encode_band_static(const Subband& band, const int32_t* plane, size_t stride,
+                        std::vector<uint32_t>& scratch, std::vector<uint8_t>& out);
+
+// Returns a pointer past the band, or nullptr if the data is truncated
+const uint8_t* decode_band_static(const uint8_t* data, const uint8_t* end, const Subband& band,
+                                  int32_t* plane, size_t stride, std::vector<int32_t>& scratch);
+
+// Median edge predictor of LOCO-I from the left, top and top-left values
+inline int32_t med_predict(int32_t left, int32_t top, int32_t top_left) {
+    const int32_t lo = left < top ? left : top;
+    const int32_t hi = left < top ? top : left;
+    if (top_left >= hi) {
+        return lo;
+    }
+    if (top_left <= lo) {
+        return hi;
+    }
+    return left + top - top_left;
+}
+
+} // namespace fresco
+
+#endif // FRESCO_COEFFICIENT_CODER_H
@@ -0,0 +1,1348 @@
+/**
+ * @file jpeg_codec.cpp
+ * @brief Lossless recompression of JPEG files
+ * @author Mehmet T. AKALIN
+ * @date 2025
+ * @license MIT
+ */
+
+#include "jpeg_codec.h"
+#include "coefficient_coder.h"
+#include "core/parallel.h"
+#include "core/range_coder.h"
+#include "core/varint.h"
+#include <algorithm>
+#include <cstdlib>
+#include <memory>
+#include <type_traits>
+
+namespace fresco {
+
+namespace {
+
+constexpr uint8_t kMarkerSoi = 0xD8;
+constexpr uint8_t kMarkerEoi = 0xD9;
+constexpr uint8_t kMarkerSos = 0xDA;
+constexpr uint8_t kMarkerDht = 0xC4;
+constexpr uint8_t kMarkerDri = 0xDD;
+constexpr uint8_t kMarkerDnl = 0xDC;
+constexpr uint8_t kMarkerRst0 = 0xD0;
+constexpr uint8_t kMarkerTem = 0x01;
+
+constexpr uint8_t kFormatVersion = 1;
+constexpr uint8_t kFlagExplicitRuns = 1;
+
+// Where libjpeg ends an EOB run of a progressive AC scan: at its longest
+// code, or once the correction bits held back for a refinement run would
+// no longer fit its buffer (MAX_CORR_BITS - DCTSIZE2 + 1)
+constexpr uint32_t kMaxEobRun = 0x7FFF;
+constexpr uint32_t kMaxCorrectionBits = 1000 - 64 + 1;
+
+constexpr uint32_t kBlockSize = 64;
+
+struct HuffmanTable {
+    bool defined = false;
+    int32_t max_code[17];     // Largest code of each length, -1 if none
+    int32_t offset[17];       // Index into values of a code of each length, less the code
+    uint8_t values[256];
+    uint16_t fast[256];       // (length << 8) | value for codes of up to 8 bits, else 0
+    uint16_t code[256];
+    uint8_t length[256];      // 0 when the value has no code
+};
+
+struct Component {
+    uint8_t id = 0;
+    uint32_t h = 1;
+    uint32_t v = 1;
+    uint32_t blocks_x = 0;         // Padded to whole MCUs
+    uint32_t blocks_y = 0;
+    uint32_t scan_blocks_x = 0;    // Covered by a scan of this component alone
+    uint32_t scan_blocks_y = 0;
+};
+
+struct Frame {
+    bool defined = false;
+    bool progressive = false;
+    uint32_t width = 0;
+    uint32_t height = 0;
+    uint32_t mcus_x = 0;
+    uint32_t mcus_y = 0;
+    std::vector<Component> components;
+};
+
+// What the marker segments so far have set up
+struct JpegState {
+    Frame frame;
+    HuffmanTable dc_tables[4];
+    HuffmanTable ac_tables[4];
+    uint32_t restart_interval = 0;
+};
+
+struct Scan {
+    uint32_t count = 0;
+    uint32_t component[4] = {};    // Index into the frame components
+    uint8_t dc_table[4] = {};
+    uint8_t ac_table[4] = {};
+    uint32_t ss = 0;
+    uint32_t se = 63;
+    uint32_t ah = 0;
+    uint32_t al = 0;
+};
+
+// Quantized coefficients of each component, 64 per block in zigzag order
+using Coefficients = std::vector<std::vector<int16_t>>;
+
+uint32_t read_u16(const uint8_t* data) {
+    return (static_cast<uint32_t>(data[0]) << 8) | data[1];
+}
+
+inline uint32_t bit_length(uint32_t value) {
+    uint32_t length = 0;
+    while (value) {
+        length++;
+        value >>= 1;
+    }
+    return length;
+}
+
+fresco_error_t build_huffman_table(const uint8_t* counts, const uint8_t* values, uint32_t total,
+                                   HuffmanTable& table) {
+    table = HuffmanTable();
+    std::copy(values, values + total, table.values);
+    std::fill(std::begin(table.fast), std::end(table.fast), 0);
+    std::fill(std::begin(table.length), std::end(table.length), 0);
+    uint32_t code = 0;
+    uint32_t index = 0;
+    table.max_code[0] = -1;
+    for (uint32_t length = 1; length <= 16; length++) {
+        // The all-ones code of each length is reserved. Checked before the
+        // codes are entered, as more codes than fit would run past fast
+        if (code + counts[length - 1] >= (1u << length)) {
+            return FRESCO_ERROR_CORRUPTED_DATA;
+        }
+        table.offset[length] = static_cast<int32_t>(index) - static_cast<int32_t>(code);
+        for (uint32_t i = 0; i < counts[length - 1]; i++, index++, code++) {
+            const uint8_t value = values[index];
+            table.code[value] = static_cast<uint16_t>(code);
+            table.length[value] = static_cast<uint8_t>(length);
+            if (length <= 8) {
+                const uint32_t first = code << (8 - length);
+                const uint32_t last = std::min(first + (1u << (8 - length)), 256u);
+                for (uint32_t j = first; j < last; j++) {
+                    table.fast[j] = static_cast<uint16_t>((length << 8) | value);
+                }
+            }
+        }
+        table.max_code[length] = counts[length - 1] ? static_cast<int32_t>(code) - 1 : -1;
+        code <<= 1;
+    }
+    table.defined = true;
+    return FRESCO_OK;
+}
+
+fresco_error_t read_huffman_tables(const uint8_t* data, size_t size, JpegState& state) {
+    while (size > 0) {
+        if (size < 17) {
+            return FRESCO_ERROR_CORRUPTED_DATA;
+        }
+        const uint32_t table_class = data[0] >> 4;
+        const uint32_t id = data[0] & 15;
+        uint32_t total = 0;
+        for (uint32_t i = 0; i < 16; i++) {
+            total += data[1 + i];
+        }
+        if (table_class > 1 || id > 3 || total > 256 || size < 17 + total) {
+            return FRESCO_ERROR_CORRUPTED_DATA;
+        }
+        HuffmanTable& table = table_class == 0 ? state.dc_tables[id] : state.ac_tables[id];
+        fresco_error_t result = build_huffman_table(data + 1, data + 17, total, table);
+        if (result != FRESCO_OK) {
+            return result;
+        }
+        data += 17 + total;
+        size -= 17 + total;
+    }
+    return FRESCO_OK;
+}
+
+fresco_error_t read_frame(const uint8_t* data, size_t size, bool progressive, Frame& frame) {
+    // One frame per file; hierarchical files have several
+    if (frame.defined) {
+        return FRESCO_ERROR_UNSUPPORTED_FORMAT;
+    }
+    if (size < 6) {
+        return FRESCO_ERROR_CORRUPTED_DATA;
+    }
+    const uint32_t count = data[5];
+    if (data[0] != 8) {
+        return FRESCO_ERROR_UNSUPPORTED_FORMAT;
+    }
+    if (count < 1 || count > 4 || size < 6 + 3 * count) {
+        return FRESCO_ERROR_CORRUPTED_DATA;
+    }
+    frame.height = read_u16(data + 1);
+    frame.width = read_u16(data + 3);
+    // A height of 0 is given later in a DNL segment
+    if (frame.height == 0) {
+        return FRESCO_ERROR_UNSUPPORTED_FORMAT;
+    }
+    if (frame.width == 0) {
+        return FRESCO_ERROR_CORRUPTED_DATA;
+    }
+    frame.progressive = progressive;
+    frame.components.resize(count);
+    uint32_t h_max = 1;
+    uint32_t v_max = 1;
+    for (uint32_t c = 0; c < count; c++) {
+        Component& component = frame.components[c];
+        component.id = data[6 + 3 * c];
+        component.h = data[7 + 3 * c] >> 4;
+        component.v = data[7 + 3 * c] & 15;
+        if (component.h < 1 || component.h > 4 || component.v < 1 || component.v > 4) {
+            return FRESCO_ERROR_CORRUPTED_DATA;
+        }
+        h_max = std::max(h_max, component.h);
+        v_max = std::max(v_max, component.v);
+    }
+    frame.mcus_x = (frame.width + 8 * h_max - 1) / (8 * h_max);
+    frame.mcus_y = (frame.height + 8 * v_max - 1) / (8 * v_max);
+    for (Component& component : frame.components) {
+        component.blocks_x = frame.mcus_x * component.h;
+        component.blocks_y = frame.mcus_y * component.v;
+        const uint64_t width = (uint64_t(frame.width) * component.h + h_max - 1) / h_max;
+        const uint64_t height = (uint64_t(frame.height) * component.v + v_max - 1) / v_max;
+        component.scan_blocks_x = static_cast<uint32_t>((width + 7) / 8);
+        component.scan_blocks_y = static_cast<uint32_t>((height + 7) / 8);
+    }
+    frame.defined = true;
+    return FRESCO_OK;
+}
+
+fresco_error_t read_scan_header(const uint8_t* data, size_t size, const JpegState& state,
+                                Scan& scan) {
+    const Frame& frame = state.frame;
+    if (!frame.defined || size < 1) {
+        return FRESCO_ERROR_CORRUPTED_DATA;
+    }
+    scan.count = data[0];
+    if (scan.count < 1 || scan.count > 4 || size < 4 + 2 * scan.count) {
+        return FRESCO_ERROR_CORRUPTED_DATA;
+    }
+    uint32_t blocks_per_mcu = 0;
+    for (uint32_t i = 0; i < scan.count; i++) {
+        const uint8_t id = data[1 + 2 * i];
+        uint32_t index = 0;
+        while (index < frame.components.size() && frame.components[index].id != id) {
+            index++;
+        }
+        if (index == frame.components.size()) {
+            return FRESCO_ERROR_CORRUPTED_DATA;
+        }
+        scan.component[i] = index;
+        scan.dc_table[i] = data[2 + 2 * i] >> 4;
+        scan.ac_table[i] = data[2 + 2 * i] & 15;
+        if (scan.dc_table[i] > 3 || scan.ac_table[i] > 3) {
+            return FRESCO_ERROR_CORRUPTED_DATA;
+        }
+        blocks_per_mcu += frame.components[index].h * frame.components[index].v;
+    }
+    const uint8_t* spectral = data + 1 + 2 * scan.count;
+    scan.ss = spectral[0];
+    scan.se = spectral[1];
+    scan.ah = spectral[2] >> 4;
+    scan.al = spectral[2] & 15;
+    if (scan.count > 1 && blocks_per_mcu > 10) {
+        return FRESCO_ERROR_CORRUPTED_DATA;
+    }
+    if (!frame.progressive) {
+        // Sequential scans code the whole block whatever they say
+        scan.ss = 0;
+        scan.se = 63;
+        scan.ah = 0;
+        scan.al = 0;
+        return FRESCO_OK;
+    }
+    if (scan.ss > scan.se || scan.se > 63 || (scan.ss == 0 && scan.se != 0) ||
+        (scan.ss > 0 && scan.count != 1) || scan.ah > 13 || scan.al > 13) {
+        return FRESCO_ERROR_CORRUPTED_DATA;
+    }
+    return FRESCO_OK;
+}
+
+// Reads marker segments from pos up to and including the next scan header,
+// leaving pos after it. found is false when the file ends first; pos is then
+// size, as anything after EOI is kept as it is.
+fresco_error_t read_segments(const uint8_t* data, size_t size, size_t& pos, JpegState& state,
+                             Scan& scan, bool& found) {
+    found = false;
+    while (true) {
+        // Bytes other than markers between segments are kept as they are
+        while (pos < size && data[pos] != 0xFF) {
+            pos++;
+        }
+        while (pos < size && data[pos] == 0xFF) {
+            pos++;
+        }
+        if (pos >= size) {
+            pos = size;
+            return FRESCO_OK;
+        }
+        const uint8_t marker = data[pos++];
+        if (marker == kMarkerEoi) {
+            pos = size;
+            return FRESCO_OK;
+        }
+        if (marker == kMarkerSoi || marker == kMarkerTem ||
+            (marker >= kMarkerRst0 && marker < kMarkerRst0 + 8)) {
+            continue;
+        }
+        if (pos + 2 > size) {
+            return FRESCO_ERROR_CORRUPTED_DATA;
+        }
+        const uint32_t length = read_u16(data + pos);
+        if (length < 2 || pos + length > size) {
+            return FRESCO_ERROR_CORRUPTED_DATA;
+        }
+        const uint8_t* payload = data + pos + 2;
+        const size_t payload_size = length - 2;
+        fresco_error_t result = FRESCO_OK;
+        if (marker == kMarkerDht) {
+            result = read_huffman_tables(payload, payload_size, state);
+        } else if (marker == 0xC0 || marker == 0xC1 || marker == 0xC2) {
+            result = read_frame(payload, payload_size, marker == 0xC2, state.frame);
+        } else if ((marker >= 0xC3 && marker <= 0xCF) || marker == kMarkerDnl) {
+            // Lossless, hierarchical and arithmetic-coded frames, arithmetic
+            // coding conditions (DAC), and heights
+            // given after the first scan
+            result = FRESCO_ERROR_UNSUPPORTED_FORMAT;
+        } else if (marker == kMarkerDri) {
+            if (payload_size < 2) {
+                return FRESCO_ERROR_CORRUPTED_DATA;
+            }
+            state.restart_interval = read_u16(payload);
+        } else if (marker == kMarkerSos) {
+            result = read_scan_header(payload, payload_size, state, scan);
+            found = result == FRESCO_OK;
+        }
+        if (result != FRESCO_OK) {
+            return result;
+        }
+        pos += length;
+        if (found) {
+            return FRESCO_OK;
+        }
+    }
+}
+
+// Entropy-coded data with its stuffed zero bytes removed. Past a marker or
+// the end it reads zeros, as libjpeg does; position() is where the bits read
+// so far end, the byte holding the last one included.
+class BitReader {
+public:
+    BitReader(const uint8_t* data, size_t begin, size_t end)
+        : data_(data), begin_(begin), pos_(begin), end_(end) {}
+
+    uint32_t peek16() {
+        fill();
+        return static_cast<uint32_t>(buffer_ >> 48);
+    }
+
+    void skip(uint32_t count) {
+        buffer_ <<= count;
+        bits_ -= count;
+    }
+
+    uint32_t bits(uint32_t count) {
+        if (count == 0) {
+            return 0;
+        }
+        fill();
+        const uint32_t value = static_cast<uint32_t>(buffer_ >> (64 - count));
+        skip(count);
+        return value;
+    }
+
+    size_t position() const {
+        const uint64_t consumed = loads_ - bits_ / 8;
+        return consumed > 0 ? ends_[(consumed - 1) & 15] : begin_;
+    }
+
+private:
+    void fill() {
+        while (bits_ <= 56) {
+            uint8_t byte = 0;
+            if (!marker_ && pos_ < end_) {
+                byte = data_[pos_];
+                if (byte != 0xFF) {
+                    pos_++;
+                } else if (pos_ + 1 < end_ && data_[pos_ + 1] == 0) {
+                    pos_ += 2;
+                } else {
+                    marker_ = true;
+                    byte = 0;
+                }
+            }
+            buffer_ |= static_cast<uint64_t>(byte) << (56 - bits_);
+            bits_ += 8;
+            ends_[loads_ & 15] = pos_;
+            loads_++;
+        }
+    }
+
+    const uint8_t* data_;
+    size_t begin_;
+    size_t pos_;
+    size_t end_;
+    uint64_t buffer_ = 0;
+    uint32_t bits_ = 0;
+    bool marker_ = false;
+    uint64_t loads_ = 0;
+    size_t ends_[16] = {};    // Source position after each of the last loads
+};
+
+// Appends entropy-coded bits with 0xFF bytes stuffed
+class BitWriter {
+public:
+    explicit BitWriter(std::vector<uint8_t>& out) : out_(out) {}
+
+    void put(uint32_t value, uint32_t count) {
+        buffer_ = (buffer_ << count) | (value & ((1u << count) - 1));
+        bits_ += count;
+        while (bits_ >= 8) {
+            bits_ -= 8;
+            const uint8_t byte = static_cast<uint8_t>(buffer_ >> bits_);
+            out_.push_back(byte);
+            if (byte == 0xFF) {
+                out_.push_back(0);
+            }
+        }
+        buffer_ &= (1u << bits_) - 1;
+    }
+
+    bool symbol(const HuffmanTable& table, uint32_t value) {
+        if (table.length[value] == 0) {
+            return false;
+        }
+        put(table.code[value], table.length[value]);
+        return true;
+    }
+
+    // Pads the last byte with ones
+    void flush() {
+        if (bits_ > 0) {
+            put(0x7F, 8 - bits_);
+        }
+    }
+
+private:
+    std::vector<uint8_t>& out_;
+    uint32_t buffer_ = 0;
+    uint32_t bits_ = 0;
+};
+
+bool decode_symbol(BitReader& reader, const HuffmanTable& table, uint32_t& symbol) {
+    const uint32_t peek = reader.peek16();
+    const uint32_t fast = table.fast[peek >> 8];
+    if (fast) {
+        reader.skip(fast >> 8);
+        symbol = fast & 0xFF;
+        return true;
+    }
+    for (uint32_t length = 9; length <= 16; length++) {
+        const int32_t code = static_cast<int32_t>(peek >> (16 - length));
+        if (code <= table.max_code[length]) {
+            reader.skip(length);
+            symbol = table.values[code + table.offset[length]];
+            return true;
+        }
+    }
+    return false;
+}
+
+// Value of the s extra bits that follow a Huffman symbol
+inline int32_t extend(uint32_t bits, uint32_t s) {
+    return s == 0 ? 0 :
+           bits < (1u << (s - 1)) ? static_cast<int32_t>(bits) - static_cast<int32_t>((1u << s) - 1) :
+                                    static_cast<int32_t>(bits);
+}
+
+inline bool store(int16_t& coefficient, int32_t value) {
+    if (value < INT16_MIN || value > INT16_MAX) {
+        return false;
+    }
+    coefficient = static_cast<int16_t>(value);
+    return true;
+}
+
+// Calls block(index in scan, coefficients) for every block of the scan in
+// coding order, and restart() between restart intervals
+template <typename Block, typename Restart>
+fresco_error_t for_each_block(const JpegState& state, const Scan& scan,
+                              Coefficients& coefficients, Block&& block, Restart&& restart) {
+    const Frame& frame = state.frame;
+    const uint32_t interval = state.restart_interval;
+    fresco_error_t result = FRESCO_OK;
+    if (scan.count == 1) {
+        // One component: an MCU is one block, and the padding is not coded
+        const Component& component = frame.components[scan.component[0]];
+        int16_t* blocks = coefficients[scan.component[0]].data();
+        uint64_t mcu = 0;
+        for (uint32_t by = 0; by < component.scan_blocks_y; by++) {
+            for (uint32_t bx = 0; bx < component.scan_blocks_x; bx++, mcu++) {
+                if (interval && mcu > 0 && mcu % interval == 0 &&
+                    (result = restart()) != FRESCO_OK) {
+                    return result;
+                }
+                int16_t* coefs = blocks + (size_t(by) * component.blocks_x + bx) * kBlockSize;
+                if ((result = block(0, coefs)) != FRESCO_OK) {
+                    return result;
+                }
+            }
+        }
+        return FRESCO_OK;
+    }
+    uint64_t mcu = 0;
+    for (uint32_t my = 0; my < frame.mcus_y; my++) {
+        for (uint32_t mx = 0; mx < frame.mcus_x; mx++, mcu++) {
+            if (interval && mcu > 0 && mcu % interval == 0 && (result = restart()) != FRESCO_OK) {
+                return result;
+            }
+            for (uint32_t i = 0; i < scan.count; i++) {
+                const Component& component = frame.components[scan.component[i]];
+                int16_t* blocks = coefficients[scan.component[i]].data();
+                for (uint32_t y = 0; y < component.v; y++) {
+                    for (uint32_t x = 0; x < component.h; x++) {
+                        const size_t by = size_t(my) * component.v + y;
+                        const size_t bx = size_t(mx) * component.h + x;
+                        int16_t* coefs = blocks + (by * component.blocks_x + bx) * kBlockSize;
+                        if ((result = block(i, coefs)) != FRESCO_OK) {
+                            return result;
+                        }
+                    }
+                }
+            }
+        }
+    }
+    return FRESCO_OK;
+}
+
+bool tables_defined(const JpegState& state, const Scan& scan) {
+    for (uint32_t i = 0; i < scan.count; i++) {
+        const bool dc = scan.ss == 0 && scan.ah == 0;
+        const bool ac = scan.se > 0;
+        if ((dc && !state.dc_tables[scan.dc_table[i]].defined) ||
+            (ac && !state.ac_tables[scan.ac_table[i]].defined)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Entropy-decodes the scan starting at pos into coefficients, leaving pos
+// where its data ends. The EOB runs of progressive AC scans are appended to
+// runs in the order they are read.
+fresco_error_t decode_scan(const uint8_t* data, size_t size, size_t& pos, const JpegState& state,
+                           const Scan& scan, Coefficients& coefficients,
+                           std::vector<uint32_t>& runs) {
+    if (!tables_defined(state, scan)) {
+        return FRESCO_ERROR_CORRUPTED_DATA;
+    }
+    BitReader reader(data, pos, size);
+    int32_t predictions[4] = {};
+    uint32_t eobrun = 0;
+    uint32_t restarts = 0;
+    const bool progressive = state.frame.progressive;
+    const int32_t p1 = 1 << scan.al;
+    const int32_t m1 = -p1;
+
+    auto restart = [&]() {
+        const size_t at = reader.position();
+        if (at + 2 > size || data[at] != 0xFF || data[at + 1] != kMarkerRst0 + (restarts & 7)) {
+            return FRESCO_ERROR_UNSUPPORTED_FORMAT;
+        }
+        restarts++;
+        reader = BitReader(data, at + 2, size);
+        std::fill(std::begin(predictions), std::end(predictions), 0);
+        eobrun = 0;
+        return FRESCO_OK;
+    };
+
+    auto decode_dc = [&](uint32_t i, int16_t* coefs) {
+        uint32_t s;
+        if (!decode_symbol(reader, state.dc_tables[scan.dc_table[i]], s) || s > 15) {
+            return false;
+        }
+        predictions[i] += extend(reader.bits(s), s);
+        return store(coefs[0], predictions[i] * (1 << scan.al));
+    };
+
+    auto block = [&](uint32_t i, int16_t* coefs) {
+        if (!progressive) {
+            if (!decode_dc(i, coefs)) {
+                return FRESCO_ERROR_CORRUPTED_DATA;
+            }
+            const HuffmanTable& table = state.ac_tables[scan.ac_table[i]];
+            for (uint32_t k = 1; k < kBlockSize; k++) {
+                uint32_t symbol;
+                if (!decode_symbol(reader, table, symbol)) {
+                    return FRESCO_ERROR_CORRUPTED_DATA;
+                }
+                const uint32_t r = symbol >> 4;
+                const uint32_t s = symbol & 15;
+                if (s == 0) {
+                    if (r != 15) {
+                        break;
+                    }
+                    k += 15;
+                    continue;
+                }
+                k += r;
+                if (k >= kBlockSize) {
+                    return FRESCO_ERROR_CORRUPTED_DATA;
+                }
+                coefs[k] = static_cast<int16_t>(extend(reader.bits(s), s));
+            }
+            return FRESCO_OK;
+        }
+
+        if (scan.ss == 0) {
+            if (scan.ah == 0) {
+                return decode_dc(i, coefs) ? FRESCO_OK : FRESCO_ERROR_CORRUPTED_DATA;
+            }
+            if (reader.bits(1)) {
+                coefs[0] = static_cast<int16_t>(coefs[0] | p1);
+            }
+            return FRESCO_OK;
+        }
+
+        const HuffmanTable& table = state.ac_tables[scan.ac_table[0]];
+        if (scan.ah == 0) {
+            if (eobrun > 0) {
+                eobrun--;
+                return FRESCO_OK;
+            }
+            for (uint32_t k = scan.ss; k <= scan.se; k++) {
+                uint32_t symbol;
+                if (!decode_symbol(reader, table, symbol)) {
+                    return FRESCO_ERROR_CORRUPTED_DATA;
+                }
+                const uint32_t r = symbol >> 4;
+                const uint32_t s = symbol & 15;
+                if (s == 0) {
+                    if (r != 15) {
+                        eobrun = (1u << r) + reader.bits(r);
+                        runs.push_back(eobrun);
+                        eobrun--;
+                        break;
+                    }
+                    k += 15;
+                    continue;
+                }
+                k += r;
+                if (k > scan.se || !store(coefs[k], extend(reader.bits(s), s) * (1 << scan.al))) {
+                    return FRESCO_ERROR_CORRUPTED_DATA;
+                }
+            }
+            return FRESCO_OK;
+        }
+
+        // Refinement: one correction bit for each coefficient that is already
+        // nonzero, and newly nonzero ones of magnitude 1
+        uint32_t k = scan.ss;
+        auto refine = [&](int16_t& coef) {
+            if (reader.bits(1) && (coef & p1) == 0) {
+                coef = static_cast<int16_t>(coef + (coef >= 0 ? p1 : m1));
+            }
+        };
+        if (eobrun == 0) {
+            for (; k <= scan.se; k++) {
+                uint32_t symbol;
+                if (!decode_symbol(reader, table, symbol)) {
+                    return FRESCO_ERROR_CORRUPTED_DATA;
+                }
+                int32_t r = symbol >> 4;
+                const uint32_t s = symbol & 15;
+                int32_t value = 0;
+                if (s != 0) {
+                    if (s != 1) {
+                        return FRESCO_ERROR_CORRUPTED_DATA;
+                    }
+                    value = reader.bits(1) ? p1 : m1;
+                } else if (r != 15) {
+                    eobrun = (1u << r) + reader.bits(r);
+                    runs.push_back(eobrun);
+                    break;
+                }
+                do {
+                    if (coefs[k] != 0) {
+                        refine(coefs[k]);
+                    } else if (--r < 0) {
+                        break;
+                    }
+                    k++;
+                } while (k <= scan.se);
+                if (value != 0) {
+                    if (k > scan.se) {
+                        return FRESCO_ERROR_CORRUPTED_DATA;
+                    }
+                    coefs[k] = static_cast<int16_t>(value);
+                }
+            }
+        }
+        if (eobrun > 0) {
+            for (; k <= scan.se; k++) {
+                if (coefs[k] != 0) {
+                    refine(coefs[k]);
+                }
+            }
+            eobrun--;
+        }
+        return FRESCO_OK;
+    };
+
+    fresco_error_t result = for_each_block(state, scan, coefficients, block, restart);
+    if (result == FRESCO_OK) {
+        pos = reader.position();
+    }
+    return result;
+}
+
+// Where the rebuilt scans end their EOB runs: where libjpeg does, or where
+// the original file did, as read by decode_scan
+struct RunPolicy {
+    const std::vector<uint32_t>* runs = nullptr;
+    size_t next = 0;
+
+    bool ends_run(uint32_t eobrun, uint32_t correction_bits) const {
+        if (runs) {
+            return next < runs->size() && eobrun == (*runs)[next];
+        }
+        return eobrun == kMaxEobRun || correction_bits > kMaxCorrectionBits;
+    }
+};
+
+// Huffman-codes the scan from the coefficients, as libjpeg does but for
+// the EOB runs, which follow policy
+fresco_error_t encode_scan(const JpegState& state, const Scan& scan, Coefficients& coefficients,
+                           RunPolicy& policy, std::vector<uint8_t>& out) {
+    if (!tables_defined(state, scan)) {
+        return FRESCO_ERROR_CORRUPTED_DATA;
+    }
+    BitWriter writer(out);
+    int32_t predictions[4] = {};
+    uint32_t eobrun = 0;
+    uint32_t restarts = 0;
+    std::vector<uint8_t> correction_bits;    // Held back for the pending EOB run
+    std::vector<uint8_t> block_bits;
+    bool coded = true;
+    const HuffmanTable& ac_table = state.ac_tables[scan.ac_table[0]];
+
+    auto put_value = [&](const HuffmanTable& table, uint32_t run, int32_t value) {
+        const uint32_t magnitude = static_cast<uint32_t>(value < 0 ? -value : value);
+        const uint32_t s = bit_length(magnitude);
+        coded &= writer.symbol(table, (run << 4) | s);
+        writer.put(static_cast<uint32_t>(value < 0 ? value - 1 : value), s);
+    };
+    auto emit_eobrun = [&]() {
+        if (eobrun > 0) {
+            const uint32_t r = bit_length(eobrun) - 1;
+            coded &= writer.symbol(ac_table, r << 4);
+            writer.put(eobrun, r);
+            eobrun = 0;
+            policy.next++;
+        }
+        for (uint8_t bit : correction_bits) {
+            writer.put(bit, 1);
+        }
+        correction_bits.clear();
+    };
+    auto restart = [&]() {
+        emit_eobrun();
+        writer.flush();
+        out.push_back(0xFF);
+        out.push_back(static_cast<uint8_t>(kMarkerRst0 + (restarts++ & 7)));
+        std::fill(std::begin(predictions), std::end(predictions), 0);
+        return FRESCO_OK;
+    };
+    auto encode_dc = [&](uint32_t i, const int16_t* coefs) {
+        const int32_t value = coefs[0] >> scan.al;
+        put_value(state.dc_tables[scan.dc_table[i]], 0, value - predictions[i]);
+        predictions[i] = value;
+    };
+
+    auto block = [&](uint32_t i, int16_t* coefs) {
+        if (!state.frame.progressive) {
+            encode_dc(i, coefs);
+            const HuffmanTable& table = state.ac_tables[scan.ac_table[i]];
+            uint32_t r = 0;
+            for (uint32_t k = 1; k < kBlockSize; k++) {
+                if (coefs[k] == 0) {
+                    r++;
+                    continue;
+                }
+                for (; r > 15; r -= 16) {
+                    coded &= writer.symbol(table, 0xF0);
+                }
+                put_value(table, r, coefs[k]);
+                r = 0;
+            }
+            if (r > 0) {
+                coded &= writer.symbol(table, 0x00);
+            }
+            return coded ? FRESCO_OK : FRESCO_ERROR_UNSUPPORTED_FORMAT;
+        }
+
+        if (scan.ss == 0) {
+            if (scan.ah == 0) {
+                encode_dc(i, coefs);
+            } else {
+                writer.put(static_cast<uint32_t>(coefs[0] >> scan.al) & 1, 1);
+            }
+            return coded ? FRESCO_OK : FRESCO_ERROR_UNSUPPORTED_FORMAT;
+        }
+
+        if (scan.ah == 0) {
+            uint32_t r = 0;
+            for (uint32_t k = scan.ss; k <= scan.se; k++) {
+                const int32_t coef = coefs[k];
+                const int32_t magnitude = (coef < 0 ? -coef : coef) >> scan.al;
+                if (magnitude == 0) {
+                    r++;
+                    continue;
+                }
+                emit_eobrun();
+                for (; r > 15; r -= 16) {
+                    coded &= writer.symbol(ac_table, 0xF0);
+                }
+                put_value(ac_table, r, coef < 0 ? -magnitude : magnitude);
+                r = 0;
+            }
+            if (r > 0) {
+                eobrun++;
+                if (policy.ends_run(eobrun, 0)) {
+                    emit_eobrun();
+                }
+            }
+            return coded ? FRESCO_OK : FRESCO_ERROR_UNSUPPORTED_FORMAT;
+        }
+
+        // Refinement, after libjpeg's encode_mcu_AC_refine
+        int32_t magnitudes[kBlockSize];
+        uint32_t last_new = 0;
+        for (uint32_t k = scan.ss; k <= scan.se; k++) {
+            const int32_t coef = coefs[k];
+            magnitudes[k] = (coef < 0 ? -coef : coef) >> scan.al;
+            if (magnitudes[k] == 1) {
+                last_new = k;
+            }
+        }
+        uint32_t r = 0;
+        block_bits.clear();
+        for (uint32_t k = scan.ss; k <= scan.se; k++) {
+            if (magnitudes[k] == 0) {
+                r++;
+                continue;
+            }
+            // Runs of zeros are coded only ahead of a newly nonzero value
+            while (r > 15 && k <= last_new) {
+                emit_eobrun();
+                coded &= writer.symbol(ac_table, 0xF0);
+                r -= 16;
+                for (uint8_t bit : block_bits) {
+                    writer.put(bit, 1);
+                }
+                block_bits.clear();
+            }
+            if (magnitudes[k] > 1) {
+                block_bits.push_back(static_cast<uint8_t>(magnitudes[k] & 1));
+                continue;
+            }
+            emit_eobrun();
+            coded &= writer.symbol(ac_table, (r << 4) | 1);
+            writer.put(coefs[k] < 0 ? 0 : 1, 1);
+            for (uint8_t bit : block_bits) {
+                writer.put(bit, 1);
+            }
+            block_bits.clear();
+            r = 0;
+        }
+        if (r > 0 || !block_bits.empty()) {
+            eobrun++;
+            correction_bits.insert(correction_bits.end(), block_bits.begin(), block_bits.end());
+            if (policy.ends_run(eobrun, static_cast<uint32_t>(correction_bits.size()))) {
+                emit_eobrun();
+            }
+        }
+        return coded ? FRESCO_OK : FRESCO_ERROR_UNSUPPORTED_FORMAT;
+    };
+
+    fresco_error_t result = for_each_block(state, scan, coefficients, block, restart);
+    if (result != FRESCO_OK) {
+        return result;
+    }
+    emit_eobrun();
+    writer.flush();
+    return coded ? FRESCO_OK : FRESCO_ERROR_UNSUPPORTED_FORMAT;
+}
+
+// Marker segments between the scans, as pointers into the file or the
+// encoded data; segment i ends with the header of scan i and the last one
+// runs to the end of the file
+struct Segment {
+    const uint8_t* data;
+    size_t size;
+};
+
+// Writes the file from its segments and coefficients
+fresco_error_t rebuild(const std::vector<Segment>& segments, const std::vector<uint32_t>* runs,
+                       Coefficients& coefficients, std::vector<uint8_t>& out) {
+    JpegState state;
+    RunPolicy policy;
+    policy.runs = runs;
+    out.clear();
+    for (size_t i = 0; i < segments.size(); i++) {
+        const Segment& segment = segments[i];
+        out.insert(out.end(), segment.data, segment.data + segment.size);
+        if (i + 1 == segments.size()) {
+            break;
+        }
+        size_t pos = 0;
+        Scan scan;
+        bool found = false;
+        fresco_error_t result = read_segments(segment.data, segment.size, pos, state, scan, found);
+        if (result != FRESCO_OK) {
+            return result;
+        }
+        if (!found || pos != segment.size) {
+            return FRESCO_ERROR_CORRUPTED_DATA;
+        }
+        result = encode_scan(state, scan, coefficients, policy, out);
+        if (result != FRESCO_OK) {
+            return result;
+        }
+    }
+    return FRESCO_OK;
+}
+
+// Frame header from the segments before the first scan; the file must start
+// with SOI and a marker
+fresco_error_t read_first_frame(const uint8_t* data, size_t size, JpegState& state) {
+    size_t pos = 0;
+    Scan scan;
+    bool found = false;
+    if (size < 3 || data[0] != 0xFF || data[1] != kMarkerSoi || data[2] != 0xFF) {
+        return FRESCO_ERROR_UNSUPPORTED_FORMAT;
+    }
+    fresco_error_t result = read_segments(data, size, pos, state, scan, found);
+    if (result != FRESCO_OK) {
+        return result;
+    }
+    return state.frame.defined ? FRESCO_OK : FRESCO_ERROR_CORRUPTED_DATA;
+}
+
+uint64_t coefficient_bytes(const Frame& frame) {
+    uint64_t bytes = 0;
+    for (const Component& component : frame.components) {
+        bytes += uint64_t(component.blocks_x) * component.blocks_y * kBlockSize * sizeof(int16_t);
+    }
+    return bytes;
+}
+
+void allocate(const Frame& frame, Coefficients& coefficients) {
+    coefficients.resize(frame.components.size());
+    for (size_t c = 0; c < frame.components.size(); c++) {
+        const Component& component = frame.components[c];
+        coefficients[c].assign(size_t(component.blocks_x) * component.blocks_y * kBlockSize, 0);
+    }
+}
+
+// Coefficient models of one component
+constexpr uint32_t kCountContexts = 8;
+constexpr uint32_t kRemainingContexts = 6;
+constexpr uint32_t kNeighbourContexts = 8;
+constexpr uint32_t kFrequencyBands = 6;
+constexpr uint32_t kMaxJpegExponent = 16;
+constexpr uint32_t kModeledMantissaBits = 2;
+
+struct JpegModels {
+    BitModel dc_zero[kNeighbourContexts];
+    BitModel dc_sign[kNeighbourContexts];
+    BitModel dc_exponent[kNeighbourContexts][kMaxJpegExponent];
+    BitModel count[kCountContexts][kBlockSize];    // Binary tree over the nonzero AC count
+    BitModel zero[kBlockSize][kRemainingContexts][kNeighbourContexts];
+    BitModel sign[kBlockSize];
+    BitModel exponent[kFrequencyBands][kRemainingContexts][kNeighbourContexts][kMaxJpegExponent];
+    BitModel dc_mantissa[kMaxJpegExponent][3];    // Tree over the top two mantissa bits
+    BitModel mantissa[kFrequencyBands][kMaxJpegExponent][3];
+};
+
+struct EncodeSide {
+    RangeEncoder& coder;
+    uint32_t bit(BitModel& model, uint32_t bit) {
+        coder.encode(model, bit);
+        return bit;
+    }
+    uint32_t bits(uint32_t value, uint32_t count) {
+        coder.encode_direct(value, count);
+        return value;
+    }
+};
+
+struct DecodeSide {
+    RangeDecoder& coder;
+    uint32_t bit(BitModel& model, uint32_t) { return coder.decode(model); }
+    uint32_t bits(uint32_t, uint32_t count) { return coder.decode_direct(count); }
+};
+
+inline uint32_t neighbour_context(uint32_t activity) {
+    return std::min(bit_length(activity), kNeighbourContexts - 1);
+}
+
+// Nonzero magnitude as an adaptive Exp-Golomb code: the exponent in unary,
+// then the bits below the leading one. The first two of those lean towards
+// the smaller values and are modeled as a tree; the rest are close to even.
+template <typename Side>
+uint32_t code_magnitude(Side& side, BitModel* exponents, BitModel (*mantissas)[3],
+                        uint32_t magnitude) {
+    const uint32_t target = bit_length(magnitude) - 1;
+    uint32_t exponent = 0;
+    while (exponent + 1 < kMaxJpegExponent && side.bit(exponents[exponent], exponent < target)) {
+        exponent++;
+    }
+    uint32_t value = 1;
+    uint32_t low = exponent;
+    for (uint32_t i = 0; i < kModeledMantissaBits && low > 0; i++) {
+        low--;
+        value = 2 * value + side.bit(mantissas[exponent][value - 1], (magnitude >> low) & 1);
+    }
+    const uint32_t mantissa = side.bits(magnitude & ((1u << low) - 1), low);
+    return (value << low) | mantissa;
+}
+
+/**
+ * Codes the blocks of one component in raster order. The DC value is the
+ * residual of the median edge predictor over the neighbouring DC values.
+ * The AC values start with their nonzero count, with the counts of the
+ * left and top blocks as context; each is then a zero flag with the
+ * zigzag position, the nonzero values left and the same coefficient of the
+ * left and top blocks as context, a sign and a magnitude.
+ */
+template <typename Side, typename Coef>
+void code_component(Side& side, JpegModels& models, const Component& component, Coef* coefs) {
+    constexpr bool decoding = !std::is_const_v<Coef>;
+    const uint32_t blocks_x = component.blocks_x;
+    std::vector<uint8_t> counts(size_t(blocks_x) * component.blocks_y);
+    std::vector<int32_t> residuals(counts.size());
+    for (uint32_t by = 0; by < component.blocks_y; by++) {
+        for (uint32_t bx = 0; bx < blocks_x; bx++) {
+            const size_t index = size_t(by) * blocks_x + bx;
+            Coef* block = coefs + index * kBlockSize;
+            const Coef* left = bx > 0 ? block - kBlockSize : nullptr;
+            const Coef* top = by > 0 ? block - size_t(blocks_x) * kBlockSize : nullptr;
+
+            int32_t prediction = 0;
+            if (left && top) {
+                prediction = med_predict(left[0], top[0], top[-static_cast<ptrdiff_t>(kBlockSize)]);
+            } else if (left || top) {
+                prediction = left ? left[0] : top[0];
+            }
+            const uint32_t dc_activity =
+                (bx > 0 ? static_cast<uint32_t>(std::abs(residuals[index - 1])) : 0) +
+                (by > 0 ? static_cast<uint32_t>(std::abs(residuals[index - blocks_x])) : 0);
+            const uint32_t dc_ctx = neighbour_context(dc_activity);
+            int32_t residual = decoding ? 0 : block[0] - prediction;
+            if (side.bit(models.dc_zero[dc_ctx], residual != 0)) {
+                const uint32_t negative = side.bit(models.dc_sign[dc_ctx], residual < 0);
+                const uint32_t magnitude = code_magnitude(
+                    side, models.dc_exponent[dc_ctx], models.dc_mantissa,
+                    static_cast<uint32_t>(residual < 0 ? -residual : residual));
+                residual = negative ? -static_cast<int32_t>(magnitude)
+                                    : static_cast<int32_t>(magnitude);
+            } else {
+                residual = 0;
+            }
+            residuals[index] = residual;
+            if constexpr (decoding) {
+                block[0] = static_cast<int16_t>(prediction + residual);
+            }
+
+            uint32_t count = 0;
+            if constexpr (!decoding) {
+                for (uint32_t k = 1; k < kBlockSize; k++) {
+                    count += block[k] != 0;
+                }
+            }
+            const uint32_t neighbours = (left ? counts[index - 1] : 0) +
+                                        (top ? counts[index - blocks_x] : 0);
+            const uint32_t average = left && top ? (neighbours + 1) / 2 : neighbours;
+            const uint32_t count_ctx =
+                average < 4 ? average : std::min(bit_length(average) + 1, kCountContexts - 1);
+            uint32_t node = 1;
+            for (int b = 5; b >= 0; b--) {
+                node = 2 * node + side.bit(models.count[count_ctx][node], (count >> b) & 1);
+            }
+            count = node - 64;
+            counts[index] = static_cast<uint8_t>(count);
+
+            uint32_t remaining = count;
+            for (uint32_t k = 1; k < kBlockSize && remaining > 0; k++) {
+                uint32_t activity;
+                if (left && top) {
+                    activity = std::abs(left[k]) + std::abs(top[k]);
+                } else {
+                    activity = 2 * std::abs(left ? left[k] : top ? top[k] : 0);
+                }
+                const uint32_t ctx = neighbour_context(activity);
+                const uint32_t remaining_ctx = std::min(bit_length(remaining), kRemainingContexts) - 1;
+                // Once the values left fill the positions left, all are nonzero
+                const uint32_t nonzero =
+                    remaining == kBlockSize - k ||
+                    side.bit(models.zero[k][remaining_ctx][ctx], decoding ? 0 : block[k] != 0);
+                if (!nonzero) {
+                    continue;
+                }
+                const int32_t value = decoding ? 0 : block[k];
+                const uint32_t negative = side.bit(models.sign[k], value < 0);
+                const uint32_t magnitude =
+                    code_magnitude(side, models.exponent[bit_length(k) - 1][remaining_ctx][ctx],
+                                   models.mantissa[bit_length(k) - 1],
+                                   static_cast<uint32_t>(value < 0 ? -value : value));
+                if constexpr (decoding) {
+                    block[k] = static_cast<int16_t>(negative ? -static_cast<int32_t>(magnitude)
+                                                             : static_cast<int32_t>(magnitude));
+                }
+                remaining--;
+            }
+        }
+    }
+}
+
+} // namespace
+
+fresco_error_t JpegCodec::read_info(const uint8_t* data, size_t size, ImageInfo& image_info) {
+    JpegState state;
+    fresco_error_t result = read_first_frame(data, size, state);
+    if (result != FRESCO_OK) {
+        return result;
+    }
+    const Frame& frame = state.frame;
+    image_info.width = frame.width;
+    image_info.height = frame.height;
+    image_info.channels = static_cast<uint8_t>(frame.components.size());
+    image_info.bit_depth = 8;
+    image_info.row_stride = 0;
+    switch (frame.components.size()) {
+        case 1:
+            image_info.colorspace = FRESCO_COLORSPACE_GRAY;
+            break;
+        case 2:
+            image_info.colorspace = FRESCO_COLORSPACE_GRAYA;
+            break;
+        case 3: {
+            // Subsampling of the chroma against the luma
+            const Component& luma = frame.components[0];
+            const Component& chroma = frame.components[1];
+            if (luma.h == 2 * chroma.h && luma.v == 2 * chroma.v) {
+                image_info.colorspace = FRESCO_COLORSPACE_YUV420;
+            } else if (luma.h == 2 * chroma.h && luma.v == chroma.v) {
+                image_info.colorspace = FRESCO_COLORSPACE_YUV422;
+            } else {
+                image_info.colorspace = FRESCO_COLORSPACE_YUV444;
+            }
+            break;
+        }
+        default:
+            image_info.colorspace = FRESCO_COLORSPACE_RGBA;
+            break;
+    }
+    return FRESCO_OK;
+}
+
+fresco_error_t JpegCodec::encode(const uint8_t* data, size_t size,
+                                 const fresco_encode_params_t& params,
+                                 std::vector<uint8_t>& encoded_data, RasterStats& stats) const {
+    Stopwatch watch(stats.times);
+    JpegState state;
+    fresco_error_t result = read_first_frame(data, size, state);
+    if (result != FRESCO_OK) {
+        return result;
+    }
+    // The coefficients, the rebuilt file to check against and the output
+    const uint64_t working_bytes = coefficient_bytes(state.frame) + 2 * uint64_t(size);
+    if (params.max_memory_bytes > 0 && working_bytes > params.max_memory_bytes) {
+        return FRESCO_ERROR_OUT_OF_MEMORY;
+    }
+    Coefficients coefficients;
+    allocate(state.frame, coefficients);
+
+    // Split the file into the marker segments and the scans between them
+    state = JpegState();
+    std::vector<Segment> segments;
+    std::vector<uint32_t> runs;
+    size_t start = 0;
+    size_t pos = 0;
+    while (true) {
+        Scan scan;
+        bool found = false;
+        result = read_segments(data, size, pos, state, scan, found);
+        if (result != FRESCO_OK) {
+            return result;
+        }
+        segments.push_back({data + start, (found ? pos : size) - start});
+        if (!found) {
+            break;
+        }
+        result = decode_scan(data, size, pos, state, scan, coefficients, runs);
+        if (result != FRESCO_OK) {
+            return result;
+        }
+        start = pos;
+    }
+    if (segments.size() < 2) {
+        return FRESCO_ERROR_CORRUPTED_DATA;
+    }
+    watch.lap(Stage::Parse);
+
+    // The file must come back exactly, with libjpeg's EOB runs if it can
+    std::vector<uint8_t> rebuilt;
+    rebuilt.reserve(size);
+    bool explicit_runs = false;
+    result = rebuild(segments, nullptr, coefficients, rebuilt);
+    if (result != FRESCO_OK || rebuilt.size() != size ||
+        !std::equal(rebuilt.begin(), rebuilt.end(), data)) {
+        explicit_runs = true;
+        result = rebuild(segments, &runs, coefficients, rebuilt);
+        if (result != FRESCO_OK || rebuilt.size() != size ||
+            !std::equal(rebuilt.begin(), rebuilt.end(), data)) {
+            return FRESCO_ERROR_UNSUPPORTED_FORMAT;
+        }
+    }
+    const uint64_t rebuilt_bytes = capacity_bytes(rebuilt);
+    std::vector<uint8_t>().swap(rebuilt);
+    watch.lap(Stage::Entropy);
+
+    const Frame& frame = state.frame;
+    const size_t component_count = frame.components.size();
+    std::vector<std::vector<uint8_t>> streams(component_count);
+    parallel_for(component_count, params.max_threads, [&](size_t c, uint32_t) {
+        auto models = std::make_unique<JpegModels>();
+        RangeEncoder encoder(streams[c]);
+        EncodeSide side{encoder};
+        code_component(side, *models, frame.components[c],
+                       static_cast<const int16_t*>(coefficients[c].data()));
+        encoder.finish();
+    });
+
+    encoded_data.clear();
+    encoded_data.push_back(kFormatVersion);
+    encoded_data.push_back(explicit_runs ? kFlagExplicitRuns : 0);
+    write_varint(encoded_data, segments.size());
+    for (const Segment& segment : segments) {
+        write_varint(encoded_data, segment.size);
+        encoded_data.insert(encoded_data.end(), segment.data, segment.data + segment.size);
+    }
+    if (explicit_runs) {
+        write_varint(encoded_data, runs.size());
+        for (uint32_t run : runs) {
+            write_varint(encoded_data, run);
+        }
+    }
+    for (const auto& stream : streams) {
+        write_varint(encoded_data, stream.size());
+        encoded_data.insert(encoded_data.end(), stream.begin(), stream.end());
+    }
+    watch.lap(Stage::Entropy);
+
+    stats.threads = resolve_thread_count(params.max_threads, component_count);
+    stats.peak_scratch_bytes = capacity_bytes(coefficients) + rebuilt_bytes +
+                               capacity_bytes(streams) + capacity_bytes(runs);
+    return FRESCO_OK;
+}
+
+fresco_error_t JpegCodec::decode(const uint8_t* encoded_data, size_t encoded_size,
+                                 const fresco_decode_params_t& params, std::vector<uint8_t>& jpeg,
+                                 RasterStats& stats) const {
+    Stopwatch watch(stats.times);
+    const uint8_t* p = encoded_data;
+    const uint8_t* end = encoded_data + encoded_size;
+    if (encoded_size < 2 || p[0] != kFormatVersion) {
+        return FRESCO_ERROR_UNSUPPORTED_FORMAT;
+    }
+    const bool explicit_runs = (p[1] & kFlagExplicitRuns) != 0;
+    p += 2;
+
+    uint64_t segment_count = 0;
+    if (!read_varint(p, end, segment_count) || segment_count < 2 ||
+        segment_count > static_cast<uint64_t>(end - p)) {
+        return FRESCO_ERROR_CORRUPTED_DATA;
+    }
+    std::vector<Segment> segments(segment_count);
+    for (Segment& segment : segments) {
+        uint64_t length = 0;
+        if (!read_varint(p, end, length) || length > static_cast<uint64_t>(end - p)) {
+            return FRESCO_ERROR_CORRUPTED_DATA;
+        }
+        segment = {p, static_cast<size_t>(length)};
+        p += length;
+    }
+    std::vector<uint32_t> runs;
+    if (explicit_runs) {
+        uint64_t run_count = 0;
+        if (!read_varint(p, end, run_count) || run_count > static_cast<uint64_t>(end - p)) {
+            return FRESCO_ERROR_CORRUPTED_DATA;
+        }
+        runs.resize(run_count);
+        for (uint32_t& run : runs) {
+            uint64_t value = 0;
+            if (!read_varint(p, end, value) || value == 0 || value > kMaxEobRun) {
+                return FRESCO_ERROR_CORRUPTED_DATA;
+            }
+            run = static_cast<uint32_t>(value);
+        }
+    }
+
+    JpegState state;
+    fresco_error_t result = read_first_frame(segments[0].data, segments[0].size, state);
+    if (result != FRESCO_OK) {
+        return result == FRESCO_ERROR_UNSUPPORTED_FORMAT ? FRESCO_ERROR_CORRUPTED_DATA : result;
+    }
+    const Frame& frame = state.frame;
+    const size_t component_count = frame.components.size();
+    std::vector<Segment> streams(component_count);
+    for (Segment& stream : streams) {
+        uint64_t length = 0;
+        if (!read_varint(p, end, length) || length > static_cast<uint64_t>(end - p)) {
+            return FRESCO_ERROR_CORRUPTED_DATA;
+        }
+        stream = {p, static_cast<size_t>(length)};
+        p += length;
+    }
+    if (params.max_memory_bytes > 0 &&
+        coefficient_bytes(frame) + encoded_size > params.max_memory_bytes) {
+        return FRESCO_ERROR_OUT_OF_MEMORY;
+    }
+    Coefficients coefficients;
+    allocate(frame, coefficients);
+    watch.lap(Stage::Parse);
+
+    std::vector<uint8_t> overrun(component_count, 0);
+    parallel_for(component_count, params.max_threads, [&](size_t c, uint32_t) {
+        auto models = std::make_unique<JpegModels>();
+        RangeDecoder decoder(streams[c].data, streams[c].data + streams[c].size);
+        DecodeSide side{decoder};
+        code_component(side, *models, frame.components[c], coefficients[c].data());
+        overrun[c] = decoder.overrun();
+    });
+    if (std::find(overrun.begin(), overrun.end(), 1) != overrun.end()) {
+        return FRESCO_ERROR_CORRUPTED_DATA;
+    }
+    watch.lap(Stage::Entropy);
+
+    result = rebuild(segments, explicit_runs ? &runs : nullptr, coefficients, jpeg);
+    watch.lap(Stage::Entropy);
+    stats.threads = resolve_thread_count(params.max_threads, component_count);
+    stats.peak_scratch_bytes = capacity_bytes(coefficients);
+    return result;
+}
+
+} // namespace fresco
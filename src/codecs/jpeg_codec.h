@@ -0,0 +1,48 @@
+/**
+ * @file jpeg_codec.h
+ * @brief Lossless recompression of JPEG files
+ * @author Mehmet T. AKALIN
+ * @date 2025
+ * @license MIT
+ */
+
+#ifndef FRESCO_JPEG_CODEC_H
+#define FRESCO_JPEG_CODEC_H
+
+#include "fresco/fresco.h"
+#include "core/compression.h"
+#include <vector>
+
+namespace fresco {
+
+/**
+ * Recompresses baseline and progressive Huffman-coded JPEG files without
+ * going through pixels. The scans are entropy-decoded to the quantized DCT
+ * coefficients, which are range coded with contexts from the neighbouring
+ * blocks; the marker segments between the scans are kept as they are. The
+ * scans are rebuilt from the coefficients with the file's own Huffman
+ * tables, so decoding returns the original file byte for byte.
+ */
+class JpegCodec {
+public:
+    JpegCodec() = default;
+    ~JpegCodec() = default;
+
+    // Frame size and components, from the marker segments before the first scan
+    static fresco_error_t read_info(const uint8_t* data, size_t size, ImageInfo& image_info);
+
+    // Fails with FRESCO_ERROR_UNSUPPORTED_FORMAT for arithmetic-coded,
+    // lossless, hierarchical and 12-bit files, and for any file whose scans
+    // do not rebuild exactly. The coefficients count against
+    // params.max_memory_bytes; components are coded in parallel.
+    fresco_error_t encode(const uint8_t* data, size_t size, const fresco_encode_params_t& params,
+                         std::vector<uint8_t>& encoded_data, RasterStats& stats) const;
+
+    fresco_error_t decode(const uint8_t* encoded_data, size_t encoded_size,
+                         const fresco_decode_params_t& params, std::vector<uint8_t>& jpeg,
+                         RasterStats& stats) const;
+};
+
+} // namespace fresco
+
+#endif // FRESCO_JPEG_CODEC_H
@@ -1,17 +1,294 @@
 /**
  * @file lossless_codec.cpp
- * @brief FRESCO lossless compression codec
+ * @brief FRESCO palette coding of tiles with few colors
  * @author Mehmet T. AKALIN
  * @date 2025
  * @license MIT
  */
 
 #include "fresco/fresco.h"
+#include "lossless_codec.h"
+#include "core/range_coder.h"
+#include <algorithm>
+#include <cstring>
 #include <vector>
 
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#define FRESCO_PALETTE_SSE2 1
+#endif
+
 namespace fresco {
 
-// TODO: Implement lossless compression algorithms
-// This is a placeholder for future implementation
+namespace {
+
+// Open addressing over the packed colors, at most half full
+constexpr uint32_t kColorSlots = 2 * kMaxPaletteColors;
+// Run lengths stay below 2^24 + 1: tiles are at most 4096 pixels square
+constexpr uint32_t kRunExponents = 25;
+
+enum Segment : uint32_t {
+    kSegmentStart = 0,
+    kSegmentIndex = 1,    // A run of one index
+    kSegmentCopy = 2      // A run of indices copied from the row above
+};
+
+struct PaletteModels {
+    BitModel copy[3];                        // By the kind of the segment before
+    BitModel index[kMaxPaletteColors];       // Bit tree
+    BitModel run[2][kRunExponents];          // Exponent by run kind
+};
+
+uint32_t pack_color(const uint8_t* pixel, uint32_t channels) {
+    uint32_t color = 0;
+    std::memcpy(&color, pixel, channels);
+    return color;
+}
+
+// Bits of a bit tree over symbols below alphabet
+uint32_t symbol_bits(uint32_t alphabet) {
+    uint32_t bits = 0;
+    while ((1u << bits) < alphabet) {
+        bits++;
+    }
+    return bits;
+}
+
+// Indices after a run of one index skip that index, which cannot follow
+uint32_t excluded_index(uint32_t segment, uint32_t last_index) {
+    return segment == kSegmentIndex ? last_index : kMaxPaletteColors;
+}
+
+void encode_run(RangeEncoder& encoder, BitModel* models, uint32_t length) {
+    uint32_t exponent = 0;
+    while ((length >> (exponent + 1)) != 0) {
+        encoder.encode(models[exponent], 1);
+        exponent++;
+    }
+    if (exponent + 1 < kRunExponents) {
+        encoder.encode(models[exponent], 0);
+    }
+    encoder.encode_direct(length & ((1u << exponent) - 1), exponent);
+}
+
+uint32_t decode_run(RangeDecoder& decoder, BitModel* models) {
+    uint32_t exponent = 0;
+    while (exponent + 1 < kRunExponents && decoder.decode(models[exponent])) {
+        exponent++;
+    }
+    return (1u << exponent) | decoder.decode_direct(exponent);
+}
+
+template <uint32_t Channels>
+void expand_rows(const TilePalette& palette, const uint8_t* indices, uint32_t width,
+                 uint32_t height, uint8_t* out, size_t out_stride) {
+    for (uint32_t y = 0; y < height; y++) {
+        const uint8_t* row = indices + static_cast<size_t>(y) * width;
+        uint8_t* dst = out + y * out_stride;
+        for (uint32_t x = 0; x < width; x++, dst += Channels) {
+            std::memcpy(dst, palette.colors[row[x]], Channels);
+        }
+    }
+}
+
+} // namespace
+
+bool LosslessCodec::find_palette(const uint8_t* pixels, size_t stride, uint32_t width,
+                                 uint32_t height, uint32_t channels, TilePalette& palette,
+                                 std::vector<uint8_t>& indices) {
+    uint32_t keys[kColorSlots];
+    uint8_t slots[kColorSlots];
+    std::memset(slots, 0xFF, sizeof(slots));
+    palette.count = 0;
+    indices.resize(static_cast<size_t>(width) * height);
+
+    auto lookup = [&](const uint8_t* pixel, uint8_t& index) {
+        const uint32_t color = pack_color(pixel, channels);
+        uint32_t slot = (color * 0x9E3779B1u) >> 25;
+        while (slots[slot] != 0xFF) {
+            if (keys[slot] == color) {
+                index = slots[slot];
+                return true;
+            }
+            slot = (slot + 1) & (kColorSlots - 1);
+        }
+        if (palette.count == kMaxPaletteColors) {
+            return false;
+        }
+        keys[slot] = color;
+        index = slots[slot] = static_cast<uint8_t>(palette.count);
+        std::memcpy(palette.colors[palette.count++], pixel, channels);
+        return true;
+    };
+
+#if defined(FRESCO_PALETTE_SSE2)
+    const size_t row_bytes = static_cast<size_t>(width) * channels;
+#endif
+    for (uint32_t y = 0; y < height; y++) {
+        const uint8_t* row = pixels + y * stride;
+        uint8_t* row_indices = &indices[static_cast<size_t>(y) * width];
+        uint8_t index = 0;
+        if (!lookup(row, index)) {
+            return false;
+        }
+        row_indices[0] = index;
+        uint32_t x = 1;
+        while (x < width) {
+#if defined(FRESCO_PALETTE_SSE2)
+            // Sixteen bytes that each equal the byte a pixel to the left
+            // hold whole pixels that repeat the current one
+            const size_t offset = static_cast<size_t>(x) * channels;
+            if (offset + 16 <= row_bytes) {
+                const __m128i here = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row + offset));
+                const __m128i left =
+                    _mm_loadu_si128(reinterpret_cast<const __m128i*>(row + offset - channels));
+                if (_mm_movemask_epi8(_mm_cmpeq_epi8(here, left)) == 0xFFFF) {
+                    const uint32_t count = 16 / channels;
+                    std::memset(row_indices + x, index, count);
+                    x += count;
+                    continue;
+                }
+            }
+#endif
+            const uint8_t* pixel = row + static_cast<size_t>(x) * channels;
+            if (std::memcmp(pixel, pixel - channels, channels) != 0 && !lookup(pixel, index)) {
+                return false;
+            }
+            row_indices[x++] = index;
+        }
+    }
+    return true;
+}
+
+void LosslessCodec::encode_palette(const TilePalette& palette, const uint8_t* indices,
+                                   uint32_t width, uint32_t height, uint32_t channels,
+                                   std::vector<uint8_t>& out) {
+    out.push_back(static_cast<uint8_t>(palette.count - 1));
+    for (uint32_t i = 0; i < palette.count; i++) {
+        out.insert(out.end(), palette.colors[i], palette.colors[i] + channels);
+    }
+
+    PaletteModels models;
+    RangeEncoder encoder(out);
+    const size_t total = static_cast<size_t>(width) * height;
+    uint32_t segment = kSegmentStart;
+    uint32_t last_index = 0;
+    size_t pos = 0;
+    while (pos < total) {
+        const uint8_t index = indices[pos];
+        size_t index_run = 1;
+        while (pos + index_run < total && indices[pos + index_run] == index) {
+            index_run++;
+        }
+        size_t copy_run = 0;
+        if (pos >= width) {
+            while (pos + copy_run < total &&
+                   indices[pos + copy_run] == indices[pos + copy_run - width]) {
+                copy_run++;
+            }
+            encoder.encode(models.copy[segment], copy_run >= index_run);
+        }
+        if (copy_run > 0 && copy_run >= index_run) {
+            encode_run(encoder, models.run[1], static_cast<uint32_t>(copy_run));
+            segment = kSegmentCopy;
+            pos += copy_run;
+            continue;
+        }
+
+        const uint32_t excluded = excluded_index(segment, last_index);
+        const uint32_t alphabet = palette.count - (excluded < palette.count ? 1 : 0);
+        const uint32_t symbol = index > excluded ? index - 1u : index;
+        uint32_t node = 1;
+        for (uint32_t bit = symbol_bits(alphabet); bit-- > 0;) {
+            const uint32_t value = (symbol >> bit) & 1;
+            encoder.encode(models.index[node], value);
+            node = 2 * node + value;
+        }
+        encode_run(encoder, models.run[0], static_cast<uint32_t>(index_run));
+        segment = kSegmentIndex;
+        last_index = index;
+        pos += index_run;
+    }
+    encoder.finish();
+}
+
+bool LosslessCodec::decode_palette(const uint8_t* data, size_t size, uint32_t width,
+                                   uint32_t height, uint32_t channels, TilePalette& palette,
+                                   std::vector<uint8_t>& indices) {
+    if (size < 1) {
+        return false;
+    }
+    palette.count = data[0] + 1u;
+    if (palette.count > kMaxPaletteColors || size < 1 + palette.count * channels) {
+        return false;
+    }
+    for (uint32_t i = 0; i < palette.count; i++) {
+        std::memcpy(palette.colors[i], data + 1 + i * channels, channels);
+    }
+    const uint8_t* end = data + size;
+    data += 1 + palette.count * channels;
+
+    PaletteModels models;
+    RangeDecoder decoder(data, end);
+    const size_t total = static_cast<size_t>(width) * height;
+    indices.resize(total);
+    uint8_t* out = indices.data();
+    uint32_t segment = kSegmentStart;
+    uint32_t last_index = 0;
+    size_t pos = 0;
+    while (pos < total) {
+        if (pos >= width && decoder.decode(models.copy[segment])) {
+            const size_t run = decode_run(decoder, models.run[1]);
+            if (run > total - pos) {
+                return false;
+            }
+            // The source may overlap the run itself, a row at a time apart
+            for (size_t done = 0; done < run;) {
+                const size_t chunk = std::min<size_t>(run - done, width);
+                std::memcpy(out + pos + done, out + pos + done - width, chunk);
+                done += chunk;
+            }
+            segment = kSegmentCopy;
+            pos += run;
+            continue;
+        }
+
+        const uint32_t excluded = excluded_index(segment, last_index);
+        const uint32_t alphabet = palette.count - (excluded < palette.count ? 1 : 0);
+        uint32_t node = 1;
+        const uint32_t bits = symbol_bits(alphabet);
+        for (uint32_t bit = 0; bit < bits; bit++) {
+            node = 2 * node + decoder.decode(models.index[node]);
+        }
+        const uint32_t symbol = node - (1u << bits);
+        if (symbol >= alphabet) {
+            return false;
+        }
+        const uint32_t index = symbol >= excluded ? symbol + 1 : symbol;
+        const size_t run = decode_run(decoder, models.run[0]);
+        if (run > total - pos) {
+            return false;
+        }
+        std::memset(out + pos, static_cast<int>(index), run);
+        segment = kSegmentIndex;
+        last_index = index;
+        pos += run;
+        if (decoder.overrun()) {
+            return false;
+        }
+    }
+    return !decoder.overrun();
+}
+
+void LosslessCodec::expand_palette(const TilePalette& palette, const uint8_t* indices,
+                                   uint32_t width, uint32_t height, uint32_t channels,
+                                   uint8_t* out, size_t out_stride) {
+    switch (channels) {
+        case 1: expand_rows<1>(palette, indices, width, height, out, out_stride); break;
+        case 2: expand_rows<2>(palette, indices, width, height, out, out_stride); break;
+        case 3: expand_rows<3>(palette, indices, width, height, out, out_stride); break;
+        default: expand_rows<4>(palette, indices, width, height, out, out_stride); break;
+    }
+}
 
 } // namespace fresco
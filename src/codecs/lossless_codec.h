@@ -0,0 +1,61 @@
+/**
+ * @file lossless_codec.h
+ * @brief FRESCO palette coding of tiles with few colors
+ * @author Mehmet T. AKALIN
+ * @date 2025
+ * @license MIT
+ */
+
+#ifndef FRESCO_LOSSLESS_CODEC_H
+#define FRESCO_LOSSLESS_CODEC_H
+
+#include "fresco/fresco.h"
+#include <vector>
+
+namespace fresco {
+
+constexpr uint32_t kMaxPaletteColors = 64;
+
+// The colors of a tile in order of first appearance, channels bytes each
+struct TilePalette {
+    uint32_t count = 0;
+    uint8_t colors[kMaxPaletteColors][4] = {};
+};
+
+/**
+ * Screen content: tiles of UI, text and diagrams have a handful of colors
+ * in long runs. Such tiles are coded exactly as a palette and one index a
+ * pixel, the indices as runs of one index or copies of the row above, with
+ * the run lengths and indices range coded. No transform is involved, so
+ * both directions are a pass over the pixels.
+ */
+class LosslessCodec {
+public:
+    // Collects the colors of a width x height tile whose rows are stride
+    // bytes apart, and the palette index of every pixel. Pixels equal to
+    // their left neighbour are taken 16 bytes at a time without a lookup.
+    // Returns false as soon as there are more than kMaxPaletteColors colors.
+    static bool find_palette(const uint8_t* pixels, size_t stride, uint32_t width,
+                             uint32_t height, uint32_t channels, TilePalette& palette,
+                             std::vector<uint8_t>& indices);
+
+    // Appends the palette and the coded indices to out
+    static void encode_palette(const TilePalette& palette, const uint8_t* indices,
+                               uint32_t width, uint32_t height, uint32_t channels,
+                               std::vector<uint8_t>& out);
+
+    // Reads what encode_palette wrote; false on corrupt data
+    static bool decode_palette(const uint8_t* data, size_t size, uint32_t width,
+                               uint32_t height, uint32_t channels, TilePalette& palette,
+                               std::vector<uint8_t>& indices);
+
+    // Writes the colors of width x height indices to out, rows out_stride
+    // bytes apart
+    static void expand_palette(const TilePalette& palette, const uint8_t* indices,
+                               uint32_t width, uint32_t height, uint32_t channels,
+                               uint8_t* out, size_t out_stride);
+};
+
+} // namespace fresco
+
+#endif // FRESCO_LOSSLESS_CODEC_H
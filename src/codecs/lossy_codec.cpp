@@ -1,17 +1,160 @@
 /**
  * @file lossy_codec.cpp
- * @brief FRESCO lossy compression codec
+ * @brief FRESCO lossy quantization and rate estimation
  * @author Mehmet T. AKALIN
  * @date 2025
  * @license MIT
  */
 
 #include "fresco/fresco.h"
+#include "lossy_codec.h"
+#include "coefficient_coder.h"
+#include <algorithm>
+#include <cmath>
 #include <vector>
 
 namespace fresco {
 
-// TODO: Implement lossy compression algorithms
-// This is a placeholder for future implementation
+namespace {
+
+// Plane weights for YCoCg-R: the inverse of each plane's contribution to
+// RGB error relative to luma (sqrt(3) / 0.707 and sqrt(3) / 0.866)
+constexpr float kPlaneWeights[kMaxPlanes] = {1.0f, 2.449f, 2.0f, 1.0f};
+
+constexpr uint32_t kExactBins = 16;
+constexpr uint32_t kBinsPerOctave = 8;
+
+uint32_t histogram_bin(uint32_t magnitude) {
+    if (magnitude < kExactBins) {
+        return magnitude;
+    }
+    const double octaves = std::log2(static_cast<double>(magnitude)) - 4.0;
+    const uint32_t bin = kExactBins + static_cast<uint32_t>(octaves * kBinsPerOctave);
+    return std::min(bin, kRateHistogramBins - 1);
+}
+
+double bin_value(uint32_t bin) {
+    if (bin < kExactBins) {
+        return bin;
+    }
+    return std::exp2(4.0 + (bin - kExactBins + 0.5) / kBinsPerOctave);
+}
+
+uint32_t bit_length(uint64_t value) {
+    uint32_t length = 0;
+    while (value) {
+        length++;
+        value >>= 1;
+    }
+    return length;
+}
+
+} // namespace
+
+float LossyCodec::step_for_quality(uint8_t quality) {
+    // Doubles every 12 quality points: 1.0 at 100, about 2.4 at 85
+    return std::exp2((100.0f - static_cast<float>(quality)) / 12.0f);
+}
+
+float LossyCodec::band_step(float base_step, uint32_t plane, bool color_transform,
+                            const Subband& band) {
+    const float weight = color_transform ? kPlaneWeights[std::min(plane, kMaxPlanes - 1)] : 1.0f;
+    return base_step * weight / subband_gain(band.orientation, band.level);
+}
+
+RateModel::RateModel(uint32_t planes, uint32_t levels, bool color_transform)
+    : planes_(planes), levels_(levels), color_transform_(color_transform) {
+    // The layout of any plane size has the same bands in the same order
+    const auto layout = subband_layout(1u << levels, 1u << levels, levels);
+    for (uint32_t plane = 0; plane < planes; plane++) {
+        for (const auto& band : layout) {
+            Band entry;
+            entry.orientation = band.orientation;
+            entry.level = band.level;
+            bands_.push_back(entry);
+        }
+    }
+}
+
+void RateModel::add_plane(uint32_t plane, const int32_t* coefficients, uint32_t width,
+                          uint32_t height, size_t stride) {
+    const auto layout = subband_layout(width, height, levels_);
+    Band* bands = &bands_[plane * layout.size()];
+    for (size_t b = 0; b < layout.size(); b++) {
+        const Subband& band = layout[b];
+        auto& counts = bands[b].counts;
+        const int32_t* origin = coefficients + band.y * stride + band.x;
+        for (uint32_t y = 0; y < band.height; y++) {
+            const int32_t* row = origin + y * stride;
+            const int32_t* above = y > 0 ? row - stride : nullptr;
+            for (uint32_t x = 0; x < band.width; x++) {
+                int64_t value = row[x];
+                if (band.orientation == Orientation::LL) {
+                    if (y == 0) {
+                        value -= x > 0 ? row[x - 1] : 0;
+                    } else if (x == 0) {
+                        value -= above[0];
+                    } else {
+                        value -= med_predict(row[x - 1], above[x], above[x - 1]);
+                    }
+                }
+                counts[histogram_bin(static_cast<uint32_t>(value < 0 ? -value : value))]++;
+            }
+        }
+    }
+}
+
+void RateModel::merge(const RateModel& other) {
+    for (size_t b = 0; b < bands_.size() && b < other.bands_.size(); b++) {
+        for (uint32_t i = 0; i < kRateHistogramBins; i++) {
+            bands_[b].counts[i] += other.bands_[b].counts[i];
+        }
+    }
+}
+
+double RateModel::estimate_bytes(float base_step) const {
+    const size_t bands_per_plane = bands_.size() / std::max(planes_, 1u);
+    double bits = 0.0;
+    for (size_t b = 0; b < bands_.size(); b++) {
+        const Band& band = bands_[b];
+        const uint32_t plane = static_cast<uint32_t>(b / bands_per_plane);
+        const Subband subband = {band.orientation, band.level, 0, 0, 0, 0};
+        const bool lowpass = band.orientation == Orientation::LL;
+        const double step = LossyCodec::band_step(base_step, plane, color_transform_, subband);
+        const double rounding = lowpass ? kLowpassRounding : kDetailRounding;
+
+        // Symbols of the binarization: zero, one, then one per exponent
+        std::array<double, kMaxExponent + 3> symbols{};
+        double total = 0.0;
+        double extra_bits = 0.0;
+        for (uint32_t i = 0; i < kRateHistogramBins; i++) {
+            const double count = static_cast<double>(band.counts[i]);
+            if (count == 0.0) {
+                continue;
+            }
+            total += count;
+            const uint64_t q = static_cast<uint64_t>(bin_value(i) / step + rounding);
+            if (q == 0) {
+                symbols[0] += count;
+                continue;
+            }
+            extra_bits += count;    // sign
+            if (q == 1) {
+                symbols[1] += count;
+                continue;
+            }
+            const uint32_t exponent = std::min(bit_length(q - 1) - 1, kMaxExponent);
+            symbols[2 + exponent] += count;
+            extra_bits += count * exponent;
+        }
+        for (double count : symbols) {
+            if (count > 0.0) {
+                bits -= count * std::log2(count / total);
+            }
+        }
+        bits += extra_bits;
+    }
+    return bits / 8.0;
+}
 
 } // namespace fresco
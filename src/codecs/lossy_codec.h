@@ -0,0 +1,96 @@
+/**
+ * @file lossy_codec.h
+ * @brief FRESCO lossy quantization and rate estimation
+ * @author Mehmet T. AKALIN
+ * @date 2025
+ * @license MIT
+ */
+
+#ifndef FRESCO_LOSSY_CODEC_H
+#define FRESCO_LOSSY_CODEC_H
+
+#include "fresco/fresco.h"
+#include "wavelet.h"
+#include <algorithm>
+#include <array>
+#include <vector>
+
+namespace fresco {
+
+constexpr uint32_t kMaxPlanes = 4;
+constexpr uint32_t kRateHistogramBins = 192;
+
+// Rounding offset of the deadzone quantizer: q = floor(|c| / step + offset)
+constexpr float kDetailRounding = 0.375f;
+constexpr float kLowpassRounding = 0.5f;
+// Decoded magnitudes sit this far into their quantization bin
+constexpr float kReconstructionBias = 0.0625f;
+constexpr float kMaxDequantized = 1073741824.0f;
+
+class LossyCodec {
+public:
+    // Pixel-domain step of the luma plane for a quality setting
+    static float step_for_quality(uint8_t quality);
+
+    // Step of one subband: the base step scaled by the plane weight and
+    // divided by the subband's synthesis gain, so every band contributes
+    // about the same error per pixel
+    static float band_step(float base_step, uint32_t plane, bool color_transform,
+                          const Subband& band);
+
+    static int32_t quantize(int32_t coefficient, float inverse_step, float rounding) {
+        const float scaled = static_cast<float>(coefficient < 0 ? -coefficient : coefficient) *
+                                 inverse_step + rounding;
+        const int32_t q = static_cast<int32_t>(scaled);
+        return coefficient < 0 ? -q : q;
+    }
+
+    static int32_t dequantize(int32_t value, float step) {
+        if (value == 0) {
+            return 0;
+        }
+        const float magnitude = (static_cast<float>(value < 0 ? -value : value) +
+                                 kReconstructionBias) * step + 0.5f;
+        // Only corrupt data gets near the limit
+        const int32_t result = static_cast<int32_t>(std::min(magnitude, kMaxDequantized));
+        return value < 0 ? -result : result;
+    }
+};
+
+/**
+ * Coefficient statistics of a whole image for rate control. Magnitudes of
+ * every subband of every plane go into log-spaced histograms (exact below
+ * 16, eight bins per octave above), collected once from the transformed
+ * tiles. estimate_bytes() then prices any base step from the histograms
+ * alone with a zeroth-order entropy of the coder's binarization, so the
+ * search for a step never touches the pixels again.
+ */
+class RateModel {
+public:
+    RateModel(uint32_t planes, uint32_t levels, bool color_transform);
+
+    // Adds the coefficients of one transformed tile plane. LL enters as
+    // median-predicted residuals, which is what the coder sees.
+    void add_plane(uint32_t plane, const int32_t* coefficients, uint32_t width,
+                   uint32_t height, size_t stride);
+
+    void merge(const RateModel& other);
+
+    double estimate_bytes(float base_step) const;
+
+private:
+    struct Band {
+        Orientation orientation;
+        uint32_t level;
+        std::array<uint64_t, kRateHistogramBins> counts{};
+    };
+
+    uint32_t planes_;
+    uint32_t levels_;
+    bool color_transform_;
+    std::vector<Band> bands_;    // planes x bands in coding order
+};
+
+} // namespace fresco
+
+#endif // FRESCO_LOSSY_CODEC_H
@@ -0,0 +1,563 @@
+/**
+ * @file mesh_lod.cpp
+ * @brief FRESCO progressive mesh (octree of level-of-detail chunks)
+ * @author Mehmet T. AKALIN
+ * @date 2025
+ * @license MIT
+ */
+
+#include "fresco/fresco.h"
+#include "mesh_lod.h"
+#include "core/varint.h"
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+namespace fresco {
+
+namespace {
+
+constexpr uint8_t kLodVersion = 2;
+constexpr uint32_t kNoNode = UINT32_MAX;
+
+// Cluster grid cells along the edge of one node
+constexpr uint32_t kClusterCells = 32;
+
+// Position precision of simplified levels, in bits below one cluster cell
+constexpr uint8_t kClusterSubcellBits = 4;
+
+// Smallest encoded node entry: mask, error, triangle count, chunk size
+constexpr size_t kMinNodeBytes = 7;
+
+// Root cube the octree and the cluster grids are laid over
+struct Grid {
+    float min[3];
+    float size;
+
+    uint32_t cell(const float* p, int axis, uint32_t resolution) const {
+        if (size <= 0.0f) {
+            return 0;
+        }
+        const float t = (p[axis] - min[axis]) / size * static_cast<float>(resolution);
+        return static_cast<uint32_t>(std::clamp(static_cast<int64_t>(t), int64_t{0},
+                                                static_cast<int64_t>(resolution) - 1));
+    }
+};
+
+// Interleaves the low 7 bits of each coordinate, x in the lowest bit, so a
+// child's code is its parent's code times eight plus its octant
+uint32_t morton(uint32_t x, uint32_t y, uint32_t z) {
+    uint32_t code = 0;
+    for (uint32_t bit = 0; bit < kMaxMeshLodLevels - 1; bit++) {
+        code |= ((x >> bit) & 1) << (3 * bit);
+        code |= ((y >> bit) & 1) << (3 * bit + 1);
+        code |= ((z >> bit) & 1) << (3 * bit + 2);
+    }
+    return code;
+}
+
+uint32_t node_code(const Grid& grid, const float* p, uint32_t level) {
+    const uint32_t resolution = 1u << level;
+    return morton(grid.cell(p, 0, resolution), grid.cell(p, 1, resolution),
+                  grid.cell(p, 2, resolution));
+}
+
+// Mesh of one level plus the vertices no triangle uses (point clouds)
+struct LevelMesh {
+    MeshData mesh;
+    std::vector<uint32_t> loose;
+    float error = 0.0f;
+};
+
+std::vector<uint32_t> loose_vertices(const MeshData& data) {
+    std::vector<uint8_t> used(data.vertex_count(), 0);
+    for (uint32_t index : data.indices) {
+        used[index] = 1;
+    }
+    std::vector<uint32_t> loose;
+    for (uint32_t v = 0; v < used.size(); v++) {
+        if (!used[v]) {
+            loose.push_back(v);
+        }
+    }
+    return loose;
+}
+
+// Vertex clustering: vertices sharing a grid cell merge into their average,
+// triangles that collapse are dropped and duplicates removed
+LevelMesh cluster(const MeshData& data, const std::vector<uint32_t>& loose, const Grid& grid,
+                  uint32_t resolution) {
+    const size_t vertex_count = data.vertex_count();
+    std::vector<std::pair<uint64_t, uint32_t>> keys(vertex_count);
+    for (uint32_t v = 0; v < vertex_count; v++) {
+        const float* p = &data.positions[v * 3];
+        const uint64_t key = grid.cell(p, 0, resolution) +
+                             static_cast<uint64_t>(resolution) *
+                                 (grid.cell(p, 1, resolution) +
+                                  static_cast<uint64_t>(resolution) * grid.cell(p, 2, resolution));
+        keys[v] = {key, v};
+    }
+    std::sort(keys.begin(), keys.end());
+
+    LevelMesh level;
+    MeshData& out = level.mesh;
+    const bool has_normals = !data.normals.empty();
+    const bool has_uvs = !data.uvs.empty();
+    std::vector<uint32_t> cluster_of(vertex_count);
+    for (size_t begin = 0; begin < keys.size();) {
+        size_t end = begin;
+        double position[3] = {0.0, 0.0, 0.0};
+        double normal[3] = {0.0, 0.0, 0.0};
+        double uv[2] = {0.0, 0.0};
+        const uint32_t id = static_cast<uint32_t>(out.vertex_count());
+        for (; end < keys.size() && keys[end].first == keys[begin].first; end++) {
+            const uint32_t v = keys[end].second;
+            cluster_of[v] = id;
+            for (int k = 0; k < 3; k++) {
+                position[k] += data.positions[v * 3 + k];
+                if (has_normals) {
+                    normal[k] += data.normals[v * 3 + k];
+                }
+            }
+            for (int k = 0; has_uvs && k < 2; k++) {
+                uv[k] += data.uvs[v * 2 + k];
+            }
+        }
+        const double count = static_cast<double>(end - begin);
+        for (int k = 0; k < 3; k++) {
+            out.positions.push_back(static_cast<float>(position[k] / count));
+        }
+        if (has_normals) {
+            const double length =
+                std::sqrt(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+            const uint32_t first = keys[begin].second;
+            for (int k = 0; k < 3; k++) {
+                out.normals.push_back(length > 0.0 ? static_cast<float>(normal[k] / length)
+                                                   : data.normals[first * 3 + k]);
+            }
+        }
+        for (int k = 0; has_uvs && k < 2; k++) {
+            out.uvs.push_back(static_cast<float>(uv[k] / count));
+        }
+        begin = end;
+    }
+
+    std::vector<std::array<uint32_t, 3>> triangles;
+    triangles.reserve(data.triangle_count());
+    for (size_t t = 0; t < data.indices.size(); t += 3) {
+        uint32_t a = cluster_of[data.indices[t]];
+        uint32_t b = cluster_of[data.indices[t + 1]];
+        uint32_t c = cluster_of[data.indices[t + 2]];
+        if (a == b || b == c || a == c) {
+            continue;
+        }
+        // Rotate the smallest index first so duplicates compare equal
+        while (a > b || a > c) {
+            std::swap(a, b);
+            std::swap(b, c);
+        }
+        triangles.push_back({a, b, c});
+    }
+    std::sort(triangles.begin(), triangles.end());
+    triangles.erase(std::unique(triangles.begin(), triangles.end()), triangles.end());
+    out.indices.reserve(triangles.size() * 3);
+    for (const auto& triangle : triangles) {
+        out.indices.insert(out.indices.end(), triangle.begin(), triangle.end());
+    }
+
+    // Clusters of unreferenced input vertices survive as points
+    std::vector<uint8_t> used(out.vertex_count(), 0);
+    for (uint32_t index : out.indices) {
+        used[index] = 1;
+    }
+    for (uint32_t v : loose) {
+        if (!used[cluster_of[v]]) {
+            used[cluster_of[v]] = 1;
+            level.loose.push_back(cluster_of[v]);
+        }
+    }
+
+    level.error = grid.size / static_cast<float>(resolution) * std::sqrt(3.0f);
+    return level;
+}
+
+// Triangles and loose vertices of one level grouped by octree cell
+struct Cell {
+    uint32_t code;
+    std::vector<uint8_t> chunk;
+    uint64_t triangle_count;
+};
+
+fresco_error_t split_level(const MeshData& mesh, const std::vector<uint32_t>& loose,
+                           uint32_t depth, const Grid& grid, const MeshQuantization& quantization,
+                           MeshCodec& codec, std::vector<Cell>& cells) {
+    // (cell, item) pairs; triangles first, then loose vertices
+    const size_t triangle_count = mesh.triangle_count();
+    std::vector<std::pair<uint32_t, uint32_t>> items;
+    items.reserve(triangle_count + loose.size());
+    for (uint32_t t = 0; t < triangle_count; t++) {
+        float centroid[3];
+        for (int k = 0; k < 3; k++) {
+            centroid[k] = (mesh.positions[mesh.indices[t * 3] * 3 + k] +
+                           mesh.positions[mesh.indices[t * 3 + 1] * 3 + k] +
+                           mesh.positions[mesh.indices[t * 3 + 2] * 3 + k]) / 3.0f;
+        }
+        items.emplace_back(node_code(grid, centroid, depth), t);
+    }
+    for (size_t i = 0; i < loose.size(); i++) {
+        items.emplace_back(node_code(grid, &mesh.positions[loose[i] * 3], depth),
+                           static_cast<uint32_t>(triangle_count + i));
+    }
+    std::sort(items.begin(), items.end());
+
+    std::vector<uint32_t> remap(mesh.vertex_count(), kNoNode);
+    MeshData chunk;
+    for (size_t begin = 0; begin < items.size();) {
+        chunk.positions.clear();
+        chunk.normals.clear();
+        chunk.uvs.clear();
+        chunk.indices.clear();
+        std::vector<uint32_t> touched;
+        auto local = [&](uint32_t v) {
+            if (remap[v] == kNoNode) {
+                remap[v] = static_cast<uint32_t>(touched.size());
+                touched.push_back(v);
+                chunk.positions.insert(chunk.positions.end(), &mesh.positions[v * 3],
+                                       &mesh.positions[v * 3 + 3]);
+                if (!mesh.normals.empty()) {
+                    chunk.normals.insert(chunk.normals.end(), &mesh.normals[v * 3],
+                                         &mesh.normals[v * 3 + 3]);
+                }
+                if (!mesh.uvs.empty()) {
+                    chunk.uvs.insert(chunk.uvs.end(), &mesh.uvs[v * 2], &mesh.uvs[v * 2 + 2]);
+                }
+            }
+            return remap[v];
+        };
+
+        size_t end = begin;
+        for (; end < items.size() && items[end].first == items[begin].first; end++) {
+            const uint32_t item = items[end].second;
+            if (item < triangle_count) {
+                for (int k = 0; k < 3; k++) {
+                    chunk.indices.push_back(local(mesh.indices[item * 3 + k]));
+                }
+            } else {
+                local(loose[item - triangle_count]);
+            }
+        }
+        for (uint32_t v : touched) {
+            remap[v] = kNoNode;
+        }
+
+        Cell cell;
+        cell.code = items[begin].first;
+        cell.triangle_count = chunk.triangle_count();
+        fresco_error_t result = codec.encode(chunk, quantization, cell.chunk);
+        if (result != FRESCO_OK) {
+            return result;
+        }
+        cells.push_back(std::move(cell));
+        begin = end;
+    }
+    return FRESCO_OK;
+}
+
+} // namespace
+
+/*
+ * Progressive track layout (varints are LEB128, f32 little-endian):
+ *
+ *   u8      version (2; a plain mesh track starts with version 1)
+ *   u8      level count
+ *   f32     root cube minimum x, y, z and edge length
+ *   varint  node count
+ *   per node, breadth first, children in octant order:
+ *     u8      child mask (bit = x + 2y + 4z of the child octant)
+ *     f32     geometric error
+ *     varint  triangle count, chunk size
+ *   chunks  mesh codec tracks in node order; size 0 for an empty node
+ *
+ * Coarse levels come first, so the base level can be decoded from a short
+ * prefix of the track and the index alone locates any region.
+ */
+
+fresco_error_t MeshLodCodec::encode(const MeshData& data, const MeshQuantization& quantization,
+                                   uint32_t level_count, std::vector<uint8_t>& encoded_data) {
+    if (level_count <= 1) {
+        return codec_.encode(data, quantization, encoded_data);
+    }
+    if (level_count > kMaxMeshLodLevels) {
+        return FRESCO_ERROR_INVALID_PARAMETER;
+    }
+    fresco_error_t result = MeshCodec::validate(data);
+    if (result != FRESCO_OK) {
+        return result;
+    }
+
+    Grid grid = {{0.0f, 0.0f, 0.0f}, 0.0f};
+    const size_t vertex_count = data.vertex_count();
+    for (int axis = 0; axis < 3 && vertex_count > 0; axis++) {
+        float lo = data.positions[axis], hi = lo;
+        for (size_t v = 1; v < vertex_count; v++) {
+            lo = std::min(lo, data.positions[v * 3 + axis]);
+            hi = std::max(hi, data.positions[v * 3 + axis]);
+        }
+        grid.min[axis] = lo;
+        grid.size = std::max(grid.size, hi - lo);
+    }
+    if (!std::isfinite(grid.size)) {
+        return FRESCO_ERROR_INVALID_PARAMETER;
+    }
+
+    MeshQuantization shared = quantization;
+    shared.fixed_grid = true;
+    std::copy(grid.min, grid.min + 3, shared.grid_min);
+    shared.grid_extent = grid.size;
+
+    // Cells of every level, finest first
+    const std::vector<uint32_t> loose = loose_vertices(data);
+    std::vector<std::vector<Cell>> levels(level_count);
+    std::vector<float> errors(level_count, 0.0f);
+    for (uint32_t depth = 0; depth < level_count; depth++) {
+        if (depth + 1 == level_count) {
+            result = split_level(data, loose, depth, grid, shared, codec_, levels[depth]);
+        } else {
+            const uint32_t resolution = kClusterCells << depth;
+            LevelMesh level = cluster(data, loose, grid, resolution);
+            errors[depth] = level.error;
+
+            // Positions already moved by up to a cluster cell need no finer
+            // grid than a fraction of that cell
+            MeshQuantization coarse = shared;
+            uint8_t cell_bits = 0;
+            while ((1u << cell_bits) < resolution) {
+                cell_bits++;
+            }
+            coarse.position_bits = std::min<uint8_t>(shared.position_bits,
+                                                      cell_bits + kClusterSubcellBits);
+            result = split_level(level.mesh, level.loose, depth, grid, coarse, codec_,
+                                 levels[depth]);
+        }
+        if (result != FRESCO_OK) {
+            return result;
+        }
+    }
+
+    // A node exists when it or any descendant holds geometry; add the empty
+    // ancestors bottom up so every level lists its occupied cells in order
+    for (uint32_t depth = level_count - 1; depth > 0; depth--) {
+        std::vector<Cell>& parents = levels[depth - 1];
+        std::vector<Cell> missing;
+        for (const Cell& child : levels[depth]) {
+            const uint32_t code = child.code >> 3;
+            if (!std::binary_search(parents.begin(), parents.end(), Cell{code, {}, 0},
+                                    [](const Cell& a, const Cell& b) { return a.code < b.code; }) &&
+                (missing.empty() || missing.back().code != code)) {
+                missing.push_back(Cell{code, {}, 0});
+            }
+        }
+        for (Cell& cell : missing) {
+            parents.push_back(std::move(cell));
+        }
+        std::sort(parents.begin(), parents.end(),
+                  [](const Cell& a, const Cell& b) { return a.code < b.code; });
+    }
+    if (levels[0].empty()) {
+        levels[0].push_back(Cell{0, {}, 0});
+    }
+
+    encoded_data.clear();
+    encoded_data.push_back(kLodVersion);
+    encoded_data.push_back(static_cast<uint8_t>(level_count));
+    for (float value : grid.min) {
+        write_f32_le(encoded_data, value);
+    }
+    write_f32_le(encoded_data, grid.size);
+    size_t node_count = 0;
+    for (const auto& cells : levels) {
+        node_count += cells.size();
+    }
+    write_varint(encoded_data, node_count);
+
+    for (uint32_t depth = 0; depth < level_count; depth++) {
+        size_t child = 0;
+        for (const Cell& cell : levels[depth]) {
+            uint8_t mask = 0;
+            if (depth + 1 < level_count) {
+                const std::vector<Cell>& children = levels[depth + 1];
+                for (; child < children.size() && (children[child].code >> 3) == cell.code; child++) {
+                    mask |= static_cast<uint8_t>(1u << (children[child].code & 7));
+                }
+            }
+            encoded_data.push_back(mask);
+            write_f32_le(encoded_data, errors[depth]);
+            write_varint(encoded_data, cell.triangle_count);
+            write_varint(encoded_data, cell.chunk.size());
+        }
+    }
+    for (const auto& cells : levels) {
+        for (const Cell& cell : cells) {
+            encoded_data.insert(encoded_data.end(), cell.chunk.begin(), cell.chunk.end());
+        }
+    }
+    return FRESCO_OK;
+}
+
+fresco_error_t MeshLodCodec::read_index(const uint8_t* encoded_data, size_t encoded_size,
+                                       std::vector<MeshLodNode>& nodes) {
+    nodes.clear();
+    if (encoded_size > 0 && encoded_data[0] != kLodVersion) {
+        MeshHeader header;
+        fresco_error_t result = MeshCodec::read_header(encoded_data, encoded_size, header);
+        if (result != FRESCO_OK) {
+            return result;
+        }
+        MeshLodNode root = {};
+        root.parent = kNoNode;
+        std::copy(header.position_min, header.position_min + 3, root.bounds_min);
+        root.bounds_size = header.position_extent;
+        root.triangle_count = header.triangle_count;
+        root.chunk_size = encoded_size;
+        nodes.push_back(root);
+        return FRESCO_OK;
+    }
+
+    const uint8_t* p = encoded_data;
+    const uint8_t* end = encoded_data + encoded_size;
+    if (encoded_size < 2) {
+        return FRESCO_ERROR_UNSUPPORTED_FORMAT;
+    }
+    const uint32_t level_count = p[1];
+    p += 2;
+    float root_min[3], root_size;
+    uint64_t node_count;
+    if (level_count < 2 || level_count > kMaxMeshLodLevels || !read_f32_le(p, end, root_min[0]) ||
+        !read_f32_le(p, end, root_min[1]) || !read_f32_le(p, end, root_min[2]) ||
+        !read_f32_le(p, end, root_size) || root_size < 0.0f || !read_varint(p, end, node_count) ||
+        node_count == 0 || node_count > static_cast<uint64_t>(end - p) / kMinNodeBytes) {
+        return FRESCO_ERROR_CORRUPTED_DATA;
+    }
+
+    nodes.resize(node_count);
+    MeshLodNode& root = nodes[0];
+    root.level = 0;
+    root.parent = kNoNode;
+    std::copy(root_min, root_min + 3, root.bounds_min);
+    root.bounds_size = root_size;
+
+    size_t next = 1;
+    uint64_t chunk_total = 0;
+    for (size_t i = 0; i < node_count; i++) {
+        MeshLodNode& node = nodes[i];
+        if (p == end) {
+            return FRESCO_ERROR_CORRUPTED_DATA;
+        }
+        const uint8_t mask = *p++;
+        uint64_t triangle_count, chunk_size;
+        if (!read_f32_le(p, end, node.error) || !read_varint(p, end, triangle_count) ||
+            !read_varint(p, end, chunk_size) || chunk_size > encoded_size) {
+            return FRESCO_ERROR_CORRUPTED_DATA;
+        }
+        node.triangle_count = triangle_count;
+        node.chunk_offset = static_cast<size_t>(chunk_total);
+        node.chunk_size = static_cast<size_t>(chunk_size);
+        chunk_total += chunk_size;
+
+        node.first_child = static_cast<uint32_t>(next);
+        node.child_count = 0;
+        if (mask != 0 && node.level + 1 >= level_count) {
+            return FRESCO_ERROR_CORRUPTED_DATA;
+        }
+        const float half = node.bounds_size * 0.5f;
+        for (uint32_t octant = 0; octant < 8; octant++) {
+            if (!(mask & (1u << octant))) {
+                continue;
+            }
+            if (next >= node_count) {
+                return FRESCO_ERROR_CORRUPTED_DATA;
+            }
+            MeshLodNode& child = nodes[next++];
+            child.level = node.level + 1;
+            child.parent = static_cast<uint32_t>(i);
+            for (int k = 0; k < 3; k++) {
+                child.bounds_min[k] = node.bounds_min[k] + ((octant >> k) & 1 ? half : 0.0f);
+            }
+            child.bounds_size = half;
+            node.child_count++;
+        }
+    }
+    if (next != node_count || chunk_total > static_cast<uint64_t>(end - p)) {
+        return FRESCO_ERROR_CORRUPTED_DATA;
+    }
+    const size_t chunk_start = static_cast<size_t>(p - encoded_data);
+    for (MeshLodNode& node : nodes) {
+        node.chunk_offset += chunk_start;
+    }
+    return FRESCO_OK;
+}
+
+void MeshLodCodec::select(const std::vector<MeshLodNode>& nodes, uint32_t level,
+                          const float* region_min, const float* region_max,
+                          std::vector<uint32_t>& selected) {
+    selected.clear();
+    for (uint32_t i = 0; i < nodes.size(); i++) {
+        const MeshLodNode& node = nodes[i];
+        if (node.level > level || (node.level < level && node.child_count > 0)) {
+            continue;
+        }
+        bool overlaps = true;
+        for (int k = 0; region_min && region_max && k < 3; k++) {
+            overlaps = overlaps && node.bounds_min[k] <= region_max[k] &&
+                       node.bounds_min[k] + node.bounds_size >= region_min[k];
+        }
+        if (overlaps) {
+            selected.push_back(i);
+        }
+    }
+}
+
+fresco_error_t MeshLodCodec::decode(const uint8_t* encoded_data,
+                                   const std::vector<MeshLodNode>& nodes, const uint32_t* selected,
+                                   size_t count, MeshData& data) {
+    data = MeshData();
+    MeshData chunk;
+    bool first = true;
+    for (size_t i = 0; i < count; i++) {
+        if (selected[i] >= nodes.size()) {
+            return FRESCO_ERROR_INVALID_PARAMETER;
+        }
+        const MeshLodNode& node = nodes[selected[i]];
+        if (node.chunk_size == 0) {
+            continue;
+        }
+        fresco_error_t result =
+            codec_.decode(encoded_data + node.chunk_offset, node.chunk_size, chunk);
+        if (result != FRESCO_OK) {
+            return result == FRESCO_ERROR_UNSUPPORTED_FORMAT ? FRESCO_ERROR_CORRUPTED_DATA
+                                                             : result;
+        }
+        // Every chunk carries the attributes of the source mesh
+        if (!first && (chunk.normals.empty() != data.normals.empty() ||
+                       chunk.uvs.empty() != data.uvs.empty())) {
+            return FRESCO_ERROR_CORRUPTED_DATA;
+        }
+        first = false;
+
+        const uint32_t base = static_cast<uint32_t>(data.vertex_count());
+        if (data.vertex_count() + chunk.vertex_count() >= UINT32_MAX) {
+            return FRESCO_ERROR_CORRUPTED_DATA;
+        }
+        data.positions.insert(data.positions.end(), chunk.positions.begin(), chunk.positions.end());
+        data.normals.insert(data.normals.end(), chunk.normals.begin(), chunk.normals.end());
+        data.uvs.insert(data.uvs.end(), chunk.uvs.begin(), chunk.uvs.end());
+        for (uint32_t index : chunk.indices) {
+            data.indices.push_back(base + index);
+        }
+    }
+    return FRESCO_OK;
+}
+
+} // namespace fresco
@@ -0,0 +1,73 @@
+/**
+ * @file mesh_lod.h
+ * @brief FRESCO progressive mesh (octree of level-of-detail chunks)
+ * @author Mehmet T. AKALIN
+ * @date 2025
+ * @license MIT
+ */
+
+#ifndef FRESCO_MESH_LOD_H
+#define FRESCO_MESH_LOD_H
+
+#include "fresco/fresco.h"
+#include "3d_codec.h"
+#include <vector>
+
+namespace fresco {
+
+constexpr uint32_t kMaxMeshLodLevels = 8;
+
+// One octree cell of a progressive mesh. Its chunk approximates everything
+// below it, so a set of nodes that covers each root-to-leaf path exactly
+// once is a complete surface.
+struct MeshLodNode {
+    uint32_t level;
+    uint32_t parent;          // UINT32_MAX for the root
+    uint32_t first_child;
+    uint32_t child_count;
+    float bounds_min[3];
+    float bounds_size;
+    float error;              // Largest vertex displacement by simplification
+    uint64_t triangle_count;
+    size_t chunk_offset;      // From the start of the track
+    size_t chunk_size;
+};
+
+class MeshLodCodec {
+public:
+    MeshLodCodec() = default;
+    ~MeshLodCodec() = default;
+
+    /**
+     * Splits the mesh over an octree with level_count levels. Leaves hold the
+     * original triangles whose centroid lies in their cell; each level above
+     * is vertex-clustered on a grid half as fine as the one below. All chunks
+     * share one position grid, so chunks of a level meet without cracks. With
+     * a single level the track is a plain mesh.
+     */
+    fresco_error_t encode(const MeshData& data, const MeshQuantization& quantization,
+                         uint32_t level_count, std::vector<uint8_t>& encoded_data);
+
+    // Reads the chunk index without decoding geometry; a plain mesh track
+    // yields a single root node
+    static fresco_error_t read_index(const uint8_t* encoded_data, size_t encoded_size,
+                                     std::vector<MeshLodNode>& nodes);
+
+    // Nodes at level, or leaves above it, whose cell overlaps the region
+    // (null for everything)
+    static void select(const std::vector<MeshLodNode>& nodes, uint32_t level,
+                       const float* region_min, const float* region_max,
+                       std::vector<uint32_t>& selected);
+
+    // Decodes the chunks of the given nodes into one mesh; vertices on chunk
+    // borders appear once per chunk
+    fresco_error_t decode(const uint8_t* encoded_data, const std::vector<MeshLodNode>& nodes,
+                         const uint32_t* selected, size_t count, MeshData& data);
+
+private:
+    MeshCodec codec_;
+};
+
+} // namespace fresco
+
+#endif // FRESCO_MESH_LOD_H
@@ -7,11 +7,250 @@
  */
 
 #include "fresco/fresco.h"
+#include "vector_codec.h"
+#include "core/varint.h"
 #include <vector>
+#include <cmath>
+#include <cstring>
 
 namespace fresco {
 
-// TODO: Implement vector graphics compression
-// This is a placeholder for future implementation
+namespace {
+
+constexpr uint8_t kVectorVersion = 1;
+constexpr uint8_t kQuantBits = 4;   // 1/16 unit
+constexpr float kMaxCoordinate = static_cast<float>(1 << 26);
+
+constexpr uint8_t kPointsPerCommand[] = {1, 1, 2, 3, 0};
+constexpr uint8_t kCommandCount = sizeof(kPointsPerCommand);
+
+} // namespace
+
+/*
+ * Track layout (varints are LEB128, fixed-width fields little-endian):
+ *
+ *   u8      version
+ *   u8      quantization bits
+ *   varint  canvas width, canvas height
+ *   varint  path count, point count
+ *   varint  command count of each path
+ *   u32     fill color of each path
+ *   u8      fill rule of each path
+ *   varint  run count, then (u8 command, varint length) per run
+ *   svb     zigzag coordinate deltas, x and y each against the previous point
+ *
+ * The commands of all paths form a single run-length coded stream, so runs
+ * may cross path boundaries.
+ */
+
+uint32_t VectorCodec::points_per_command(uint8_t command) {
+    return command < kCommandCount ? kPointsPerCommand[command] : 0;
+}
+
+fresco_error_t VectorCodec::validate(const VectorData& data) {
+    size_t command_offset = 0;
+    size_t point_offset = 0;
+    for (const auto& path : data.paths) {
+        if (path.fill_rule > FRESCO_FILL_EVENODD ||
+            path.command_count > data.commands.size() - command_offset) {
+            return FRESCO_ERROR_INVALID_PARAMETER;
+        }
+
+        // Paths start with a move and never close twice in a row, which
+        // bounds the command count by twice the point count
+        const uint8_t* commands = data.commands.data() + command_offset;
+        uint32_t points = 0;
+        for (uint32_t i = 0; i < path.command_count; i++) {
+            const uint8_t command = commands[i];
+            if (command >= kCommandCount || (i == 0 && command != FRESCO_PATH_MOVE) ||
+                (command == FRESCO_PATH_CLOSE && commands[i - 1] == FRESCO_PATH_CLOSE)) {
+                return FRESCO_ERROR_INVALID_PARAMETER;
+            }
+            points += kPointsPerCommand[command];
+        }
+        if (points != path.point_count) {
+            return FRESCO_ERROR_INVALID_PARAMETER;
+        }
+        command_offset += path.command_count;
+        point_offset += path.point_count;
+    }
+    if (command_offset != data.commands.size() || point_offset * 2 != data.points.size()) {
+        return FRESCO_ERROR_INVALID_PARAMETER;
+    }
+
+    for (float coordinate : data.points) {
+        if (!(std::fabs(coordinate) < kMaxCoordinate)) {
+            return FRESCO_ERROR_INVALID_PARAMETER;
+        }
+    }
+    return FRESCO_OK;
+}
+
+fresco_error_t VectorCodec::encode(const VectorData& data, std::vector<uint8_t>& encoded_data) {
+    fresco_error_t result = validate(data);
+    if (result != FRESCO_OK) {
+        return result;
+    }
+
+    const size_t point_count = data.points.size() / 2;
+
+    encoded_data.clear();
+    encoded_data.push_back(kVectorVersion);
+    encoded_data.push_back(kQuantBits);
+    write_varint(encoded_data, data.width);
+    write_varint(encoded_data, data.height);
+    write_varint(encoded_data, data.paths.size());
+    write_varint(encoded_data, point_count);
+
+    for (const auto& path : data.paths) {
+        write_varint(encoded_data, path.command_count);
+    }
+    for (const auto& path : data.paths) {
+        write_u32_le(encoded_data, path.fill_color);
+    }
+    for (const auto& path : data.paths) {
+        encoded_data.push_back(path.fill_rule);
+    }
+
+    // Run-length coded command stream
+    std::vector<uint8_t> runs;
+    size_t run_count = 0;
+    for (size_t i = 0; i < data.commands.size();) {
+        size_t length = 1;
+        while (i + length < data.commands.size() && data.commands[i + length] == data.commands[i]) {
+            length++;
+        }
+        runs.push_back(data.commands[i]);
+        write_varint(runs, length);
+        run_count++;
+        i += length;
+    }
+    write_varint(encoded_data, run_count);
+    encoded_data.insert(encoded_data.end(), runs.begin(), runs.end());
+
+    // Quantized coordinate deltas
+    const float scale = static_cast<float>(1 << kQuantBits);
+    std::vector<uint32_t> deltas(data.points.size());
+    int32_t previous[2] = {0, 0};
+    for (size_t i = 0; i < data.points.size(); i++) {
+        const int32_t value = static_cast<int32_t>(std::lrint(data.points[i] * scale));
+        deltas[i] = zigzag_encode(static_cast<int32_t>(
+            static_cast<uint32_t>(value) - static_cast<uint32_t>(previous[i & 1])));
+        previous[i & 1] = value;
+    }
+    stream_vbyte_encode(deltas.data(), deltas.size(), encoded_data);
+
+    return FRESCO_OK;
+}
+
+fresco_error_t VectorCodec::decode(const uint8_t* encoded_data, size_t encoded_size,
+                                  VectorData& data) const {
+    const uint8_t* p = encoded_data;
+    const uint8_t* end = encoded_data + encoded_size;
+
+    if (encoded_size < 2 || p[0] != kVectorVersion) {
+        return FRESCO_ERROR_UNSUPPORTED_FORMAT;
+    }
+    const uint8_t quant_bits = p[1];
+    p += 2;
+    if (quant_bits > 16) {
+        return FRESCO_ERROR_CORRUPTED_DATA;
+    }
+
+    uint64_t width, height, path_count, point_count;
+    if (!read_varint(p, end, width) || !read_varint(p, end, height) ||
+        !read_varint(p, end, path_count) || !read_varint(p, end, point_count) ||
+        width > UINT32_MAX || height > UINT32_MAX) {
+        return FRESCO_ERROR_CORRUPTED_DATA;
+    }
+    // Every path takes at least six bytes, every coordinate pair at least
+    // two data bytes
+    const uint64_t remaining = static_cast<uint64_t>(end - p);
+    if (path_count > remaining / 6 || point_count > remaining / 2) {
+        return FRESCO_ERROR_CORRUPTED_DATA;
+    }
+
+    data.width = static_cast<uint32_t>(width);
+    data.height = static_cast<uint32_t>(height);
+    data.paths.resize(path_count);
+
+    uint64_t command_total = 0;
+    for (auto& path : data.paths) {
+        uint64_t command_count;
+        if (!read_varint(p, end, command_count) || command_count > 2 * point_count) {
+            return FRESCO_ERROR_CORRUPTED_DATA;
+        }
+        path.command_count = static_cast<uint32_t>(command_count);
+        command_total += command_count;
+    }
+    if (command_total > 2 * point_count) {
+        return FRESCO_ERROR_CORRUPTED_DATA;
+    }
+    for (auto& path : data.paths) {
+        if (!read_u32_le(p, end, path.fill_color)) {
+            return FRESCO_ERROR_CORRUPTED_DATA;
+        }
+    }
+    if (static_cast<uint64_t>(end - p) < path_count) {
+        return FRESCO_ERROR_CORRUPTED_DATA;
+    }
+    for (auto& path : data.paths) {
+        path.fill_rule = *p++;
+        if (path.fill_rule > FRESCO_FILL_EVENODD) {
+            return FRESCO_ERROR_CORRUPTED_DATA;
+        }
+    }
+
+    // Expand command runs
+    data.commands.resize(command_total);
+    uint64_t run_count;
+    if (!read_varint(p, end, run_count)) {
+        return FRESCO_ERROR_CORRUPTED_DATA;
+    }
+    uint64_t filled = 0;
+    for (uint64_t run = 0; run < run_count; run++) {
+        uint64_t length;
+        if (p >= end) {
+            return FRESCO_ERROR_CORRUPTED_DATA;
+        }
+        const uint8_t command = *p++;
+        if (command >= kCommandCount || !read_varint(p, end, length) ||
+            length > command_total - filled) {
+            return FRESCO_ERROR_CORRUPTED_DATA;
+        }
+        std::memset(data.commands.data() + filled, command, length);
+        filled += length;
+    }
+    if (filled != command_total) {
+        return FRESCO_ERROR_CORRUPTED_DATA;
+    }
+
+    // Point counts follow from the commands
+    const uint8_t* commands = data.commands.data();
+    uint64_t point_total = 0;
+    for (auto& path : data.paths) {
+        uint32_t points = 0;
+        for (uint32_t i = 0; i < path.command_count; i++) {
+            points += kPointsPerCommand[commands[i]];
+        }
+        commands += path.command_count;
+        path.point_count = points;
+        point_total += points;
+    }
+    if (point_total != point_count) {
+        return FRESCO_ERROR_CORRUPTED_DATA;
+    }
+
+    // Coordinates, dequantized while decoding
+    const float inverse_scale = 1.0f / static_cast<float>(1 << quant_bits);
+    data.points.resize(point_count * 2);
+    p = stream_vbyte_decode_delta2_scaled(p, end, data.points.size(), inverse_scale,
+                                          data.points.data());
+    if (!p) {
+        return FRESCO_ERROR_CORRUPTED_DATA;
+    }
+
+    return FRESCO_OK;
+}
 
 } // namespace fresco
@@ -0,0 +1,52 @@
+/**
+ * @file vector_codec.h
+ * @brief FRESCO vector graphics codec interface
+ * @author Mehmet T. AKALIN
+ * @date 2025
+ * @license MIT
+ */
+
+#ifndef FRESCO_VECTOR_CODEC_H
+#define FRESCO_VECTOR_CODEC_H
+
+#include "fresco/fresco.h"
+#include <vector>
+
+namespace fresco {
+
+struct VectorPath {
+    uint32_t command_count;
+    uint32_t point_count;
+    uint32_t fill_color;
+    uint8_t fill_rule;
+};
+
+// Paths are stored structure-of-arrays: the commands and points of all paths
+// are concatenated in path order.
+struct VectorData {
+    uint32_t width = 0;
+    uint32_t height = 0;
+    std::vector<VectorPath> paths;
+    std::vector<uint8_t> commands;
+    std::vector<float> points;      // Interleaved x, y
+};
+
+class VectorCodec {
+public:
+    VectorCodec() = default;
+    ~VectorCodec() = default;
+
+    static uint32_t points_per_command(uint8_t command);
+
+    // Checks command values, point counts and coordinate range
+    static fresco_error_t validate(const VectorData& data);
+
+    fresco_error_t encode(const VectorData& data, std::vector<uint8_t>& encoded_data);
+
+    fresco_error_t decode(const uint8_t* encoded_data, size_t encoded_size,
+                         VectorData& data) const;
+};
+
+} // namespace fresco
+
+#endif // FRESCO_VECTOR_CODEC_H
@@ -0,0 +1,371 @@
+/**
+ * @file vector_rasterizer.cpp
+ * @brief FRESCO vector track rasterizer
+ * @author Mehmet T. AKALIN
+ * @date 2025
+ * @license MIT
+ */
+
+#include "fresco/fresco.h"
+#include "vector_rasterizer.h"
+#include "core/parallel.h"
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+namespace fresco {
+
+namespace {
+
+constexpr uint32_t kBandHeight = 32;
+constexpr float kFlattenTolerance = 0.25f;   // Pixels
+constexpr int kMaxCurveSegments = 256;
+
+struct Edge {
+    float x0, y0, x1, y1;
+};
+
+struct PathEdges {
+    size_t first;
+    size_t count;
+    float min_x, min_y, max_x, max_y;
+    uint32_t color;
+    uint8_t fill_rule;
+};
+
+// Turns paths into line edges in pixel space. Edges are split at x = 0 and
+// x = width and clamped, so parts outside the image collapse onto its border
+// and still contribute their winding to the pixels inside.
+class EdgeBuilder {
+public:
+    EdgeBuilder(float width, std::vector<Edge>& edges) : width_(width), edges_(edges) {}
+
+    void line(float x0, float y0, float x1, float y1) {
+        if (y0 == y1) {
+            return;
+        }
+        const float bounds[2] = {0.0f, width_};
+        for (float bound : bounds) {
+            if ((x0 < bound && x1 > bound) || (x0 > bound && x1 < bound)) {
+                const float y = y0 + (bound - x0) * (y1 - y0) / (x1 - x0);
+                line(x0, y0, bound, y);
+                line(bound, y, x1, y1);
+                return;
+            }
+        }
+        edges_.push_back({std::clamp(x0, 0.0f, width_), y0, std::clamp(x1, 0.0f, width_), y1});
+    }
+
+    void quad(float x0, float y0, float x1, float y1, float x2, float y2) {
+        const float dd = std::hypot(x0 - 2 * x1 + x2, y0 - 2 * y1 + y2);
+        const int n = segment_count(0.25f * dd);
+        float px = x0, py = y0;
+        for (int i = 1; i <= n; i++) {
+            const float t = static_cast<float>(i) / n;
+            const float mt = 1.0f - t;
+            const float x = mt * mt * x0 + 2 * mt * t * x1 + t * t * x2;
+            const float y = mt * mt * y0 + 2 * mt * t * y1 + t * t * y2;
+            line(px, py, x, y);
+            px = x;
+            py = y;
+        }
+    }
+
+    void cubic(float x0, float y0, float x1, float y1, float x2, float y2, float x3, float y3) {
+        const float dd = std::max(std::hypot(x0 - 2 * x1 + x2, y0 - 2 * y1 + y2),
+                                  std::hypot(x1 - 2 * x2 + x3, y1 - 2 * y2 + y3));
+        const int n = segment_count(0.75f * dd);
+        float px = x0, py = y0;
+        for (int i = 1; i <= n; i++) {
+            const float t = static_cast<float>(i) / n;
+            const float mt = 1.0f - t;
+            const float x = mt * mt * mt * x0 + 3 * mt * mt * t * x1 + 3 * mt * t * t * x2 +
+                            t * t * t * x3;
+            const float y = mt * mt * mt * y0 + 3 * mt * mt * t * y1 + 3 * mt * t * t * y2 +
+                            t * t * t * y3;
+            line(px, py, x, y);
+            px = x;
+            py = y;
+        }
+    }
+
+private:
+    // Wang's bound: the flattening error is below tolerance with
+    // sqrt(k * max second difference / tolerance) segments
+    static int segment_count(float scaled_dd) {
+        const float n = std::ceil(std::sqrt(scaled_dd / kFlattenTolerance));
+        return static_cast<int>(std::clamp(n, 1.0f, static_cast<float>(kMaxCurveSegments)));
+    }
+
+    float width_;
+    std::vector<Edge>& edges_;
+};
+
+void build_edges(const VectorData& data, float scale_x, float scale_y, float width,
+                 std::vector<Edge>& edges, std::vector<PathEdges>& paths) {
+    EdgeBuilder builder(width, edges);
+    const uint8_t* commands = data.commands.data();
+    const float* points = data.points.data();
+
+    for (const auto& path : data.paths) {
+        PathEdges path_edges = {edges.size(), 0, 0, 0, 0, 0, path.fill_color, path.fill_rule};
+
+        float start_x = 0, start_y = 0, x = 0, y = 0;
+        auto point = [&](uint32_t i, float& px, float& py) {
+            px = points[2 * i] * scale_x;
+            py = points[2 * i + 1] * scale_y;
+        };
+
+        // Filling closes every subpath implicitly
+        uint32_t p = 0;
+        for (uint32_t c = 0; c < path.command_count; c++) {
+            float x1, y1, x2, y2, x3, y3;
+            switch (commands[c]) {
+            case FRESCO_PATH_MOVE:
+                builder.line(x, y, start_x, start_y);
+                point(p++, x, y);
+                start_x = x;
+                start_y = y;
+                break;
+            case FRESCO_PATH_LINE:
+                point(p++, x1, y1);
+                builder.line(x, y, x1, y1);
+                x = x1;
+                y = y1;
+                break;
+            case FRESCO_PATH_QUAD:
+                point(p++, x1, y1);
+                point(p++, x2, y2);
+                builder.quad(x, y, x1, y1, x2, y2);
+                x = x2;
+                y = y2;
+                break;
+            case FRESCO_PATH_CUBIC:
+                point(p++, x1, y1);
+                point(p++, x2, y2);
+                point(p++, x3, y3);
+                builder.cubic(x, y, x1, y1, x2, y2, x3, y3);
+                x = x3;
+                y = y3;
+                break;
+            default: // FRESCO_PATH_CLOSE
+                builder.line(x, y, start_x, start_y);
+                x = start_x;
+                y = start_y;
+                break;
+            }
+        }
+        builder.line(x, y, start_x, start_y);
+
+        commands += path.command_count;
+        points += 2 * static_cast<size_t>(path.point_count);
+
+        path_edges.count = edges.size() - path_edges.first;
+        if (path_edges.count == 0) {
+            continue;
+        }
+        path_edges.min_x = path_edges.min_y = INFINITY;
+        path_edges.max_x = path_edges.max_y = -INFINITY;
+        for (size_t i = path_edges.first; i < edges.size(); i++) {
+            const Edge& e = edges[i];
+            path_edges.min_x = std::min({path_edges.min_x, e.x0, e.x1});
+            path_edges.max_x = std::max({path_edges.max_x, e.x0, e.x1});
+            path_edges.min_y = std::min({path_edges.min_y, e.y0, e.y1});
+            path_edges.max_y = std::max({path_edges.max_y, e.y0, e.y1});
+        }
+        paths.push_back(path_edges);
+    }
+}
+
+// Signed-area accumulation: every edge adds, per covered row, its exact
+// area contribution to the cells it crosses. A running sum along the row
+// then yields the winding-weighted coverage of each pixel.
+void accumulate_edge(const Edge& edge, int band_y0, int band_y1, float* acc, size_t stride) {
+    float x0 = edge.x0, y0 = edge.y0, x1 = edge.x1, y1 = edge.y1;
+    float dir = 1.0f;
+    if (y0 > y1) {
+        std::swap(x0, x1);
+        std::swap(y0, y1);
+        dir = -1.0f;
+    }
+
+    const int y_start = std::max(static_cast<int>(std::floor(y0)), band_y0);
+    const int y_end = std::min(static_cast<int>(std::ceil(y1)), band_y1);
+    const float dxdy = (x1 - x0) / (y1 - y0);
+    const float x_limit = static_cast<float>(stride - 2);
+
+    for (int y = y_start; y < y_end; y++) {
+        const float top = std::max(static_cast<float>(y), y0);
+        const float bottom = std::min(static_cast<float>(y + 1), y1);
+        const float d = (bottom - top) * dir;
+        const float xa = std::clamp(x0 + (top - y0) * dxdy, 0.0f, x_limit);
+        const float xb = std::clamp(x0 + (bottom - y0) * dxdy, 0.0f, x_limit);
+        float* row = acc + static_cast<size_t>(y - band_y0) * stride;
+
+        const float xl = std::min(xa, xb);
+        const float xr = std::max(xa, xb);
+        const int xli = static_cast<int>(xl);
+        const int xri = static_cast<int>(std::ceil(xr));
+
+        if (xri <= xli + 1) {
+            const float xm = 0.5f * (xa + xb) - xli;
+            row[xli] += d - d * xm;
+            row[xli + 1] += d * xm;
+        } else {
+            const float s = 1.0f / (xr - xl);
+            const float x0f = xl - xli;
+            const float a0 = 0.5f * s * (1.0f - x0f) * (1.0f - x0f);
+            const float x1f = xr - xri + 1.0f;
+            const float am = 0.5f * s * x1f * x1f;
+            row[xli] += d * a0;
+            if (xri == xli + 2) {
+                row[xli + 1] += d * (1.0f - a0 - am);
+            } else {
+                const float a1 = s * (1.5f - x0f);
+                row[xli + 1] += d * (a1 - a0);
+                for (int xi = xli + 2; xi < xri - 1; xi++) {
+                    row[xi] += d * s;
+                }
+                const float a2 = a1 + (xri - xli - 3) * s;
+                row[xri - 1] += d * (1.0f - a2 - am);
+            }
+            row[xri] += d * am;
+        }
+    }
+}
+
+inline uint8_t to_u8(float value) {
+    return static_cast<uint8_t>(std::clamp(value, 0.0f, 255.0f) + 0.5f);
+}
+
+void blend_pixel(uint8_t* pixel, uint8_t channels, const float color[4], float coverage) {
+    const float alpha = color[3] * coverage;
+    const float luma = color[0] * 0.299f + color[1] * 0.587f + color[2] * 0.114f;
+    switch (channels) {
+    case 1:
+        pixel[0] = to_u8(pixel[0] + (luma - pixel[0]) * alpha);
+        break;
+    case 2: {
+        const float dst_alpha = pixel[1] / 255.0f;
+        const float out_alpha = alpha + dst_alpha * (1.0f - alpha);
+        if (out_alpha > 0.0f) {
+            pixel[0] = to_u8((luma * alpha + pixel[0] * dst_alpha * (1.0f - alpha)) / out_alpha);
+        }
+        pixel[1] = to_u8(out_alpha * 255.0f);
+        break;
+    }
+    case 3:
+        for (int c = 0; c < 3; c++) {
+            pixel[c] = to_u8(pixel[c] + (color[c] - pixel[c]) * alpha);
+        }
+        break;
+    default: {
+        const float dst_alpha = pixel[3] / 255.0f;
+        const float out_alpha = alpha + dst_alpha * (1.0f - alpha);
+        if (out_alpha > 0.0f) {
+            for (int c = 0; c < 3; c++) {
+                pixel[c] = to_u8((color[c] * alpha + pixel[c] * dst_alpha * (1.0f - alpha)) /
+                                 out_alpha);
+            }
+        }
+        pixel[3] = to_u8(out_alpha * 255.0f);
+        break;
+    }
+    }
+}
+
+} // namespace
+
+fresco_error_t VectorRasterizer::render(const VectorData& data, uint32_t width, uint32_t height,
+                                       uint8_t channels, uint32_t max_threads, uint8_t* pixels,
+                                       size_t row_stride) const {
+    if (!pixels || channels < 1 || channels > 4 ||
+        (row_stride != 0 && row_stride < static_cast<size_t>(width) * channels)) {
+        return FRESCO_ERROR_INVALID_PARAMETER;
+    }
+    if (row_stride == 0) {
+        row_stride = static_cast<size_t>(width) * channels;
+    }
+    if (width == 0 || height == 0 || data.paths.empty()) {
+        return FRESCO_OK;
+    }
+
+    const float scale_x = data.width ? static_cast<float>(width) / data.width : 1.0f;
+    const float scale_y = data.height ? static_cast<float>(height) / data.height : 1.0f;
+
+    std::vector<Edge> edges;
+    std::vector<PathEdges> paths;
+    build_edges(data, scale_x, scale_y, static_cast<float>(width), edges, paths);
+    if (paths.empty()) {
+        return FRESCO_OK;
+    }
+
+    // Cells up to x = width + 1 can be touched by edges on the right border
+    const size_t stride = static_cast<size_t>(width) + 2;
+    const size_t band_count = (height + kBandHeight - 1) / kBandHeight;
+    const uint32_t workers = resolve_thread_count(max_threads, band_count);
+    std::vector<std::vector<float>> scratch(workers);
+
+    parallel_for(band_count, max_threads, [&](size_t band, uint32_t worker) {
+        std::vector<float>& acc = scratch[worker];
+        if (acc.empty()) {
+            acc.assign(stride * kBandHeight, 0.0f);
+        }
+
+        const int band_y0 = static_cast<int>(band * kBandHeight);
+        const int band_y1 = std::min(band_y0 + static_cast<int>(kBandHeight),
+                                     static_cast<int>(height));
+
+        for (const auto& path : paths) {
+            const int row_start = std::max(static_cast<int>(std::floor(path.min_y)), band_y0);
+            const int row_end = std::min(static_cast<int>(std::ceil(path.max_y)), band_y1);
+            if (row_start >= row_end) {
+                continue;
+            }
+
+            for (size_t e = path.first; e < path.first + path.count; e++) {
+                accumulate_edge(edges[e], band_y0, band_y1, acc.data(), stride);
+            }
+
+            const float color[4] = {
+                static_cast<float>((path.color >> 24) & 0xff),
+                static_cast<float>((path.color >> 16) & 0xff),
+                static_cast<float>((path.color >> 8) & 0xff),
+                static_cast<float>(path.color & 0xff) / 255.0f,
+            };
+
+            // Only the cells inside the path bounds were touched; the running
+            // sum clears them again so the buffer never needs a full reset
+            const size_t col_start = static_cast<size_t>(path.min_x);
+            const size_t col_end = std::min(static_cast<size_t>(std::ceil(path.max_x)) + 2, stride);
+            for (int y = row_start; y < row_end; y++) {
+                float* row = acc.data() + static_cast<size_t>(y - band_y0) * stride;
+                uint8_t* line = pixels + static_cast<size_t>(y) * row_stride;
+                float sum = 0.0f;
+                for (size_t x = col_start; x < col_end; x++) {
+                    sum += row[x];
+                    row[x] = 0.0f;
+                    if (x >= width) {
+                        continue;
+                    }
+                    float coverage = std::fabs(sum);
+                    if (path.fill_rule == FRESCO_FILL_EVENODD) {
+                        coverage = std::fmod(coverage, 2.0f);
+                        if (coverage > 1.0f) {
+                            coverage = 2.0f - coverage;
+                        }
+                    } else if (coverage > 1.0f) {
+                        coverage = 1.0f;
+                    }
+                    if (coverage >= 1.0f / 512.0f) {
+                        blend_pixel(line + x * channels, channels, color, coverage);
+                    }
+                }
+            }
+        }
+    });
+
+    return FRESCO_OK;
+}
+
+} // namespace fresco
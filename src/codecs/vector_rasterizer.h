@@ -0,0 +1,37 @@
+/**
+ * @file vector_rasterizer.h
+ * @brief FRESCO vector track rasterizer interface
+ * @author Mehmet T. AKALIN
+ * @date 2025
+ * @license MIT
+ */
+
+#ifndef FRESCO_VECTOR_RASTERIZER_H
+#define FRESCO_VECTOR_RASTERIZER_H
+
+#include "fresco/fresco.h"
+#include "vector_codec.h"
+#include <vector>
+
+namespace fresco {
+
+class VectorRasterizer {
+public:
+    VectorRasterizer() = default;
+    ~VectorRasterizer() = default;
+
+    /**
+     * Fills the paths in order with anti-aliased coverage and blends them
+     * source-over into an interleaved 8-bit image with 1 to 4 channels. The
+     * canvas of the vector data is scaled to width x height. Horizontal bands
+     * of the image are rendered in parallel on up to max_threads threads.
+     * Rows of pixels are row_stride bytes apart, 0 when packed.
+     */
+    fresco_error_t render(const VectorData& data, uint32_t width, uint32_t height,
+                         uint8_t channels, uint32_t max_threads, uint8_t* pixels,
+                         size_t row_stride) const;
+};
+
+} // namespace fresco
+
+#endif // FRESCO_VECTOR_RASTERIZER_H
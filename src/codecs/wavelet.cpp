@@ -0,0 +1,271 @@
+/**
+ * @file wavelet.cpp
+ * @brief Reversible color transform and 5/3 wavelet for raster tiles
+ * @author Mehmet T. AKALIN
+ * @date 2025
+ * @license MIT
+ */
+
+#include "wavelet.h"
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+namespace fresco {
+
+namespace {
+
+// Mirror index for symmetric extension without repeating the edge sample
+inline size_t mirror(ptrdiff_t i, size_t n) {
+    if (i < 0) {
+        i = -i;
+    }
+    if (static_cast<size_t>(i) >= n) {
+        i = static_cast<ptrdiff_t>(2 * (n - 1)) - i;
+    }
+    return static_cast<size_t>(i);
+}
+
+// One level on a single line: low half to out[0..), high half after it
+void lift_forward(const int32_t* in, size_t n, int32_t* out) {
+    if (n < 2) {
+        out[0] = in[0];
+        return;
+    }
+    const size_t low_count = (n + 1) / 2;
+    const size_t high_count = n / 2;
+    int32_t* low = out;
+    int32_t* high = out + low_count;
+    for (size_t i = 0; i < high_count; i++) {
+        const int32_t left = in[2 * i];
+        const int32_t right = in[mirror(static_cast<ptrdiff_t>(2 * i + 2), n)];
+        high[i] = in[2 * i + 1] - ((left + right) >> 1);
+    }
+    for (size_t i = 0; i < low_count; i++) {
+        const int32_t before = high[i > 0 ? i - 1 : 0];
+        const int32_t after = high[std::min(i, high_count - 1)];
+        low[i] = in[2 * i] + ((before + after + 2) >> 2);
+    }
+}
+
+void lift_inverse(const int32_t* in, size_t n, int32_t* out) {
+    if (n < 2) {
+        out[0] = in[0];
+        return;
+    }
+    const size_t low_count = (n + 1) / 2;
+    const size_t high_count = n / 2;
+    const int32_t* low = in;
+    const int32_t* high = in + low_count;
+    for (size_t i = 0; i < low_count; i++) {
+        const int32_t before = high[i > 0 ? i - 1 : 0];
+        const int32_t after = high[std::min(i, high_count - 1)];
+        out[2 * i] = low[i] - ((before + after + 2) >> 2);
+    }
+    for (size_t i = 0; i < high_count; i++) {
+        const int32_t left = out[2 * i];
+        const int32_t right = out[mirror(static_cast<ptrdiff_t>(2 * i + 2), n)];
+        out[2 * i + 1] = high[i] + ((left + right) >> 1);
+    }
+}
+
+// Vertical lifting runs on whole rows, so the inner loops are contiguous
+void columns_forward(int32_t* plane, uint32_t width, uint32_t height, size_t stride) {
+    if (height < 2) {
+        return;
+    }
+    const size_t low_count = (height + 1) / 2;
+    const size_t high_count = height / 2;
+    auto row = [&](size_t y) { return plane + y * stride; };
+
+    // Predict: odd rows become high-pass rows
+    for (size_t i = 0; i < high_count; i++) {
+        int32_t* odd = row(2 * i + 1);
+        const int32_t* above = row(2 * i);
+        const int32_t* below = row(mirror(static_cast<ptrdiff_t>(2 * i + 2), height));
+        for (uint32_t x = 0; x < width; x++) {
+            odd[x] -= (above[x] + below[x]) >> 1;
+        }
+    }
+    // Update: even rows become low-pass rows
+    for (size_t i = 0; i < low_count; i++) {
+        int32_t* even = row(2 * i);
+        const int32_t* before = row(2 * (i > 0 ? i - 1 : 0) + 1);
+        const int32_t* after = row(2 * std::min(i, high_count - 1) + 1);
+        for (uint32_t x = 0; x < width; x++) {
+            even[x] += (before[x] + after[x] + 2) >> 2;
+        }
+    }
+
+    // Deinterleave rows: lows to the top, highs below
+    std::vector<int32_t> rows(static_cast<size_t>(high_count) * width);
+    for (size_t i = 0; i < high_count; i++) {
+        std::memcpy(&rows[i * width], row(2 * i + 1), width * sizeof(int32_t));
+    }
+    for (size_t i = 1; i < low_count; i++) {
+        std::memmove(row(i), row(2 * i), width * sizeof(int32_t));
+    }
+    for (size_t i = 0; i < high_count; i++) {
+        std::memcpy(row(low_count + i), &rows[i * width], width * sizeof(int32_t));
+    }
+}
+
+void columns_inverse(int32_t* plane, uint32_t width, uint32_t height, size_t stride) {
+    if (height < 2) {
+        return;
+    }
+    const size_t low_count = (height + 1) / 2;
+    const size_t high_count = height / 2;
+    auto row = [&](size_t y) { return plane + y * stride; };
+
+    // Interleave rows back: lows to even rows, highs to odd rows
+    std::vector<int32_t> rows(static_cast<size_t>(high_count) * width);
+    for (size_t i = 0; i < high_count; i++) {
+        std::memcpy(&rows[i * width], row(low_count + i), width * sizeof(int32_t));
+    }
+    for (size_t i = low_count; i-- > 1;) {
+        std::memmove(row(2 * i), row(i), width * sizeof(int32_t));
+    }
+    for (size_t i = 0; i < high_count; i++) {
+        std::memcpy(row(2 * i + 1), &rows[i * width], width * sizeof(int32_t));
+    }
+
+    for (size_t i = 0; i < low_count; i++) {
+        int32_t* even = row(2 * i);
+        const int32_t* before = row(2 * (i > 0 ? i - 1 : 0) + 1);
+        const int32_t* after = row(2 * std::min(i, high_count - 1) + 1);
+        for (uint32_t x = 0; x < width; x++) {
+            even[x] -= (before[x] + after[x] + 2) >> 2;
+        }
+    }
+    for (size_t i = 0; i < high_count; i++) {
+        int32_t* odd = row(2 * i + 1);
+        const int32_t* above = row(2 * i);
+        const int32_t* below = row(mirror(static_cast<ptrdiff_t>(2 * i + 2), height));
+        for (uint32_t x = 0; x < width; x++) {
+            odd[x] += (above[x] + below[x]) >> 1;
+        }
+    }
+}
+
+// Synthesis gains from the float version of the lifting steps: the inverse
+// of a unit impulse placed in a subband of a long 1D signal
+std::array<std::array<float, kMaxWaveletLevels + 1>, 2> compute_gains() {
+    std::array<std::array<float, kMaxWaveletLevels + 1>, 2> gains = {};
+    const size_t n = size_t{1} << (kMaxWaveletLevels + 4);
+    for (uint32_t level = 1; level <= kMaxWaveletLevels; level++) {
+        for (int high = 0; high < 2; high++) {
+            std::vector<double> signal(n, 0.0);
+            // Impulse in the middle of the band at this level
+            const size_t band_size = n >> level;
+            signal[(high ? band_size : 0) + band_size / 2] = 1.0;
+            for (uint32_t l = level; l >= 1; l--) {
+                const size_t count = n >> (l - 1);
+                const size_t half = count / 2;
+                std::vector<double> out(count);
+                for (size_t i = 0; i < half; i++) {
+                    const double before = signal[half + (i > 0 ? i - 1 : 0)];
+                    const double after = signal[half + i];
+                    out[2 * i] = signal[i] - (before + after) / 4.0;
+                }
+                for (size_t i = 0; i < half; i++) {
+                    const double right = out[2 * std::min(i + 1, half - 1)];
+                    out[2 * i + 1] = signal[half + i] + (out[2 * i] + right) / 2.0;
+                }
+                std::copy(out.begin(), out.end(), signal.begin());
+            }
+            double energy = 0.0;
+            for (double v : signal) {
+                energy += v * v;
+            }
+            gains[high][level] = static_cast<float>(std::sqrt(energy));
+        }
+    }
+    gains[0][0] = 1.0f;
+    gains[1][0] = 1.0f;
+    return gains;
+}
+
+} // namespace
+
+std::vector<Subband> subband_layout(uint32_t width, uint32_t height, uint32_t levels) {
+    std::vector<uint32_t> widths(levels + 1), heights(levels + 1);
+    widths[0] = width;
+    heights[0] = height;
+    for (uint32_t l = 1; l <= levels; l++) {
+        widths[l] = (widths[l - 1] + 1) / 2;
+        heights[l] = (heights[l - 1] + 1) / 2;
+    }
+
+    std::vector<Subband> bands;
+    bands.push_back({Orientation::LL, levels, 0, 0, widths[levels], heights[levels]});
+    for (uint32_t l = levels; l >= 1; l--) {
+        const uint32_t low_w = widths[l], low_h = heights[l];
+        const uint32_t high_w = widths[l - 1] - low_w, high_h = heights[l - 1] - low_h;
+        bands.push_back({Orientation::HL, l, low_w, 0, high_w, low_h});
+        bands.push_back({Orientation::LH, l, 0, low_h, low_w, high_h});
+        bands.push_back({Orientation::HH, l, low_w, low_h, high_w, high_h});
+    }
+    return bands;
+}
+
+void dwt53_forward(int32_t* plane, uint32_t width, uint32_t height, size_t stride,
+                   uint32_t levels, int32_t* scratch) {
+    uint32_t w = width, h = height;
+    for (uint32_t level = 0; level < levels && (w > 1 || h > 1); level++) {
+        if (w > 1) {
+            for (uint32_t y = 0; y < h; y++) {
+                int32_t* row = plane + y * stride;
+                std::memcpy(scratch, row, w * sizeof(int32_t));
+                lift_forward(scratch, w, row);
+            }
+        }
+        columns_forward(plane, w, h, stride);
+        w = (w + 1) / 2;
+        h = (h + 1) / 2;
+    }
+}
+
+void dwt53_inverse(int32_t* plane, uint32_t width, uint32_t height, size_t stride,
+                   uint32_t levels, uint32_t skip, int32_t* scratch) {
+    std::vector<uint32_t> widths(levels + 1), heights(levels + 1);
+    widths[0] = width;
+    heights[0] = height;
+    for (uint32_t l = 1; l <= levels; l++) {
+        widths[l] = (widths[l - 1] + 1) / 2;
+        heights[l] = (heights[l - 1] + 1) / 2;
+    }
+    for (uint32_t level = levels; level > skip; level--) {
+        const uint32_t w = widths[level - 1], h = heights[level - 1];
+        if (w <= 1 && h <= 1) {
+            continue;
+        }
+        columns_inverse(plane, w, h, stride);
+        if (w > 1) {
+            for (uint32_t y = 0; y < h; y++) {
+                int32_t* row = plane + y * stride;
+                std::memcpy(scratch, row, w * sizeof(int32_t));
+                lift_inverse(scratch, w, row);
+            }
+        }
+    }
+}
+
+float subband_gain(Orientation orientation, uint32_t level) {
+    static const auto gains = compute_gains();
+    level = std::min(level, kMaxWaveletLevels);
+    switch (orientation) {
+        case Orientation::LL:
+            return gains[0][level] * gains[0][level];
+        case Orientation::HL:
+        case Orientation::LH:
+            return gains[0][level] * gains[1][level];
+        case Orientation::HH:
+        default:
+            return gains[1][level] * gains[1][level];
+    }
+}
+
+} // namespace fresco
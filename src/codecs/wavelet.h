@@ -0,0 +1,73 @@
+/**
+ * @file wavelet.h
+ * @brief Reversible color transform and 5/3 wavelet for raster tiles
+ * @author Mehmet T. AKALIN
+ * @date 2025
+ * @license MIT
+ */
+
+#ifndef FRESCO_WAVELET_H
+#define FRESCO_WAVELET_H
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+namespace fresco {
+
+constexpr uint32_t kMaxWaveletLevels = 8;
+
+// Subband orientation: LL, high horizontally, high vertically, both high
+enum class Orientation : uint8_t { LL = 0, HL = 1, LH = 2, HH = 3 };
+
+// Rectangle of one subband inside a transformed plane (Mallat layout)
+struct Subband {
+    Orientation orientation;
+    uint32_t level;    // 1 is the finest; LL carries the number of levels
+    uint32_t x, y;
+    uint32_t width, height;
+};
+
+/**
+ * Subbands of a width x height plane after `levels` decompositions, in
+ * coding order: LL first, then HL, LH, HH from the coarsest level to the
+ * finest. Low bands take the ceiling half at every level.
+ */
+std::vector<Subband> subband_layout(uint32_t width, uint32_t height, uint32_t levels);
+
+/**
+ * Reversible integer 5/3 lifting (the JPEG 2000 reversible filter) with
+ * symmetric extension, applied in place to the low band of each level.
+ * scratch must hold width values.
+ */
+void dwt53_forward(int32_t* plane, uint32_t width, uint32_t height, size_t stride,
+                   uint32_t levels, int32_t* scratch);
+
+// Inverts the coarsest `levels - skip` decompositions, leaving the image at
+// 1 / 2^skip resolution in the top-left corner
+void dwt53_inverse(int32_t* plane, uint32_t width, uint32_t height, size_t stride,
+                   uint32_t levels, uint32_t skip, int32_t* scratch);
+
+// L2 norm of the synthesis basis function of a subband, which scales how
+// quantization error in that band shows up in the pixels
+float subband_gain(Orientation orientation, uint32_t level);
+
+// Reversible YCoCg-R on interleaved samples: Y keeps the 0..255 range,
+// Co and Cg span -255..255
+inline void rct_forward(int32_t r, int32_t g, int32_t b, int32_t& y, int32_t& co, int32_t& cg) {
+    co = r - b;
+    const int32_t t = b + (co >> 1);
+    cg = g - t;
+    y = t + (cg >> 1);
+}
+
+inline void rct_inverse(int32_t y, int32_t co, int32_t cg, int32_t& r, int32_t& g, int32_t& b) {
+    const int32_t t = y - (cg >> 1);
+    g = cg + t;
+    b = t - (co >> 1);
+    r = b + co;
+}
+
+} // namespace fresco
+
+#endif // FRESCO_WAVELET_H
@@ -0,0 +1,240 @@
+/**
+ * @file async.cpp
+ * @brief FRESCO asynchronous calls and completion queues
+ * @author Mehmet T. AKALIN
+ * @date 2025
+ * @license MIT
+ */
+
+#include "async.h"
+#include "counters.h"
+#include "utils.h"
+#include <cerrno>
+#include <chrono>
+#include <list>
+#include <new>
+#include <system_error>
+
+#ifdef __linux__
+#include <sys/eventfd.h>
+#endif
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace fresco {
+
+// Finished calls in completion order. The descriptor is readable exactly
+// while the queue is not empty: it is signalled by the push that fills the
+// queue and drained by the poll that empties it, both under the lock.
+class CompletionQueue {
+public:
+    CompletionQueue() {
+#if defined(__linux__)
+        read_fd_ = write_fd_ = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        if (read_fd_ < 0) {
+            throw std::system_error(errno, std::generic_category());
+        }
+#elif !defined(_WIN32)
+        int fds[2];
+        if (::pipe(fds) != 0) {
+            throw std::system_error(errno, std::generic_category());
+        }
+        for (int fd : fds) {
+            ::fcntl(fd, F_SETFL, ::fcntl(fd, F_GETFL) | O_NONBLOCK);
+            ::fcntl(fd, F_SETFD, FD_CLOEXEC);
+        }
+        read_fd_ = fds[0];
+        write_fd_ = fds[1];
+#endif
+    }
+
+    ~CompletionQueue() {
+        // Outputs nobody polled would leak otherwise
+        for (const auto& completion : completions_) {
+            fresco_free(completion.output_data);
+        }
+#ifndef _WIN32
+        if (write_fd_ != read_fd_) {
+            ::close(write_fd_);
+        }
+        ::close(read_fd_);
+#endif
+    }
+
+    CompletionQueue(const CompletionQueue&) = delete;
+    CompletionQueue& operator=(const CompletionQueue&) = delete;
+
+    int fd() const { return read_fd_; }
+
+    // The node is allocated by the caller beforehand, so delivering a
+    // completion cannot fail
+    void push(std::list<fresco_completion_t>& node) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (completions_.empty()) {
+            signal();
+        }
+        completions_.splice(completions_.end(), node);
+    }
+
+    size_t poll(fresco_completion_t* out, size_t capacity) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        size_t count = 0;
+        while (count < capacity && !completions_.empty()) {
+            out[count++] = completions_.front();
+            completions_.pop_front();
+        }
+        if (count > 0 && completions_.empty()) {
+            drain();
+        }
+        return count;
+    }
+
+private:
+    void signal() {
+#if defined(__linux__)
+        const uint64_t one = 1;
+        (void)!::write(write_fd_, &one, sizeof(one));
+#elif !defined(_WIN32)
+        const char one = 1;
+        (void)!::write(write_fd_, &one, 1);
+#endif
+    }
+
+    void drain() {
+#if defined(__linux__)
+        uint64_t value;
+        (void)!::read(read_fd_, &value, sizeof(value));
+#elif !defined(_WIN32)
+        char bytes[64];
+        while (::read(read_fd_, bytes, sizeof(bytes)) > 0) {
+        }
+#endif
+    }
+
+    std::mutex mutex_;
+    std::list<fresco_completion_t> completions_;
+    int read_fd_ = -1;
+    int write_fd_ = -1;
+};
+
+AsyncWorker::~AsyncWorker() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    ready_.notify_one();
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+}
+
+fresco_error_t AsyncWorker::submit(std::function<fresco_error_t(uint8_t**, size_t*)> call,
+                                   fresco_completion_callback_t callback,
+                                   fresco_completion_queue_t* queue, void* user_data) {
+    if ((callback == nullptr) == (queue == nullptr)) {
+        return FRESCO_ERROR_INVALID_PARAMETER;
+    }
+
+    try {
+        std::list<fresco_completion_t> node(1);
+        node.front().user_data = user_data;
+        auto job = [call = std::move(call), callback, queue, node]() mutable {
+            counter_sub(Counter::QueueDepth, 1);
+            fresco_completion_t& completion = node.front();
+            completion.result = call(&completion.output_data, &completion.output_size);
+            if (completion.result != FRESCO_OK) {
+                completion.output_data = nullptr;
+                completion.output_size = 0;
+            }
+            if (callback) {
+                callback(&completion);
+            } else {
+                reinterpret_cast<CompletionQueue*>(queue)->push(node);
+            }
+        };
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!thread_.joinable()) {
+            thread_ = std::thread(&AsyncWorker::run, this);
+        }
+        jobs_.push_back(std::move(job));
+        // Under the lock, so the worker cannot take the job off first
+        counter_add(Counter::QueueDepth, 1);
+    } catch (const std::bad_alloc&) {
+        return FRESCO_ERROR_OUT_OF_MEMORY;
+    } catch (const std::system_error&) {
+        // No thread could be started
+        return FRESCO_ERROR_OUT_OF_MEMORY;
+    }
+    ready_.notify_one();
+    return FRESCO_OK;
+}
+
+void AsyncWorker::run() {
+    for (;;) {
+        std::function<void()> job;
+        {
+            // Timed waits are inline in libstdc++; the untimed one needs a
+            // newer libstdc++ at run time than the one the library may be
+            // deployed next to
+            std::unique_lock<std::mutex> lock(mutex_);
+            while (!stopping_ && jobs_.empty()) {
+                ready_.wait_for(lock, std::chrono::seconds(1));
+            }
+            if (jobs_.empty()) {
+                return;
+            }
+            job = std::move(jobs_.front());
+            jobs_.pop_front();
+        }
+        job();
+    }
+}
+
+} // namespace fresco
+
+extern "C" {
+
+fresco_error_t fresco_completion_queue_create(fresco_completion_queue_t** queue) {
+    if (!queue) {
+        return FRESCO_ERROR_INVALID_PARAMETER;
+    }
+
+    try {
+        *queue = reinterpret_cast<fresco_completion_queue_t*>(new fresco::CompletionQueue());
+        return FRESCO_OK;
+    } catch (const std::bad_alloc&) {
+        return FRESCO_ERROR_OUT_OF_MEMORY;
+    } catch (const std::system_error&) {
+        return FRESCO_ERROR_IO;
+    }
+}
+
+void fresco_completion_queue_destroy(fresco_completion_queue_t* queue) {
+    if (queue) {
+        delete reinterpret_cast<fresco::CompletionQueue*>(queue);
+    }
+}
+
+int fresco_completion_queue_fd(const fresco_completion_queue_t* queue) {
+    if (!queue) {
+        return -1;
+    }
+
+    return reinterpret_cast<const fresco::CompletionQueue*>(queue)->fd();
+}
+
+fresco_error_t fresco_completion_queue_poll(fresco_completion_queue_t* queue,
+                                           fresco_completion_t* completions, size_t capacity,
+                                           size_t* count) {
+    if (!queue || (!completions && capacity > 0) || !count) {
+        return FRESCO_ERROR_INVALID_PARAMETER;
+    }
+
+    *count = reinterpret_cast<fresco::CompletionQueue*>(queue)->poll(completions, capacity);
+    return FRESCO_OK;
+}
+
+} // extern "C"
@@ -0,0 +1,50 @@
+/**
+ * @file async.h
+ * @brief FRESCO asynchronous calls and completion queues
+ * @author Mehmet T. AKALIN
+ * @date 2025
+ * @license MIT
+ */
+
+#ifndef FRESCO_ASYNC_H
+#define FRESCO_ASYNC_H
+
+#include "fresco/fresco.h"
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+namespace fresco {
+
+// Runs the asynchronous calls of one handle one at a time, in submission
+// order, on a thread started with the first call. The destructor waits for
+// the queued calls, so their completions are all delivered.
+class AsyncWorker {
+public:
+    AsyncWorker() = default;
+    ~AsyncWorker();
+
+    AsyncWorker(const AsyncWorker&) = delete;
+    AsyncWorker& operator=(const AsyncWorker&) = delete;
+
+    // call fills in the output of the completion and returns the result.
+    // Exactly one of callback and queue is set.
+    fresco_error_t submit(std::function<fresco_error_t(uint8_t**, size_t*)> call,
+                          fresco_completion_callback_t callback,
+                          fresco_completion_queue_t* queue, void* user_data);
+
+private:
+    void run();
+
+    std::mutex mutex_;
+    std::condition_variable ready_;
+    std::deque<std::function<void()>> jobs_;
+    bool stopping_ = false;
+    std::thread thread_;
+};
+
+} // namespace fresco
+
+#endif // FRESCO_ASYNC_H
@@ -0,0 +1,183 @@
+/**
+ * @file bitpack.cpp
+ * @brief FRESCO binary packing of small integers
+ * @author Mehmet T. AKALIN
+ * @date 2025
+ * @license MIT
+ */
+
+#include "fresco/fresco.h"
+#include "bitpack.h"
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#define FRESCO_BITPACK_SSE2 1
+#endif
+
+namespace fresco {
+
+namespace {
+
+constexpr size_t kBlockSize = 128;
+constexpr size_t kLanes = 4;
+constexpr size_t kValuesPerLane = kBlockSize / kLanes;
+
+inline uint32_t load_u32_le(const uint8_t* p) {
+    return static_cast<uint32_t>(p[0]) | (static_cast<uint32_t>(p[1]) << 8) |
+           (static_cast<uint32_t>(p[2]) << 16) | (static_cast<uint32_t>(p[3]) << 24);
+}
+
+#if !defined(FRESCO_BITPACK_SSE2)
+void unpack_block_scalar(const uint8_t* words, unsigned width, uint32_t* out) {
+    const uint32_t mask = width == 32 ? ~0u : (1u << width) - 1;
+    for (size_t lane = 0; lane < kLanes; lane++) {
+        unsigned bit = 0;
+        size_t word = 0;
+        for (size_t k = 0; k < kValuesPerLane; k++) {
+            uint32_t value = load_u32_le(words + (word * kLanes + lane) * 4) >> bit;
+            if (bit + width > 32) {
+                value |= load_u32_le(words + ((word + 1) * kLanes + lane) * 4) << (32 - bit);
+            }
+            out[k * kLanes + lane] = value & mask;
+            bit += width;
+            if (bit >= 32) {
+                bit -= 32;
+                word++;
+            }
+        }
+    }
+}
+
+#endif
+
+#if defined(FRESCO_BITPACK_SSE2)
+template <bool Zigzag>
+void unpack_block_sse2(const uint8_t* words, unsigned width, uint32_t* out) {
+    const __m128i* in = reinterpret_cast<const __m128i*>(words);
+    const __m128i mask = _mm_set1_epi32(width == 32 ? -1 : static_cast<int>((1u << width) - 1));
+    const __m128i one = _mm_set1_epi32(1);
+    __m128i current = _mm_loadu_si128(in);
+    unsigned bit = 0;
+    unsigned word = 0;
+    for (size_t k = 0; k < kValuesPerLane; k++) {
+        __m128i value = _mm_srl_epi32(current, _mm_cvtsi32_si128(static_cast<int>(bit)));
+        if (bit + width > 32) {
+            const __m128i next = _mm_loadu_si128(in + word + 1);
+            value = _mm_or_si128(value, _mm_sll_epi32(next, _mm_cvtsi32_si128(static_cast<int>(32 - bit))));
+        }
+        value = _mm_and_si128(value, mask);
+        if (Zigzag) {
+            value = _mm_xor_si128(_mm_srli_epi32(value, 1),
+                                  _mm_sub_epi32(_mm_setzero_si128(), _mm_and_si128(value, one)));
+        }
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + k * kLanes), value);
+        bit += width;
+        if (bit >= 32) {
+            bit -= 32;
+            word++;
+            if (word < width) {
+                current = _mm_loadu_si128(in + word);
+            }
+        }
+    }
+}
+#endif
+
+template <bool Zigzag>
+const uint8_t* bitpack_decode_impl(const uint8_t* data, const uint8_t* end, size_t count,
+                                   uint32_t* values) {
+    uint32_t tail[kBlockSize];
+    for (size_t i = 0; i < count; i += kBlockSize) {
+        if (data >= end) {
+            return nullptr;
+        }
+        const unsigned width = *data++;
+        const size_t bytes = static_cast<size_t>(width) * kLanes * 4;
+        if (width > 32 || static_cast<size_t>(end - data) < bytes) {
+            return nullptr;
+        }
+
+        const size_t n = std::min(kBlockSize, count - i);
+        uint32_t* out = n == kBlockSize ? values + i : tail;
+        if (width == 0) {
+            std::memset(out, 0, kBlockSize * sizeof(uint32_t));
+        } else {
+#if defined(FRESCO_BITPACK_SSE2)
+            unpack_block_sse2<Zigzag>(data, width, out);
+#else
+            unpack_block_scalar(data, width, out);
+            if (Zigzag) {
+                for (size_t k = 0; k < kBlockSize; k++) {
+                    out[k] = (out[k] >> 1) ^ (0u - (out[k] & 1));
+                }
+            }
+#endif
+        }
+        if (out == tail) {
+            std::memcpy(values + i, tail, n * sizeof(uint32_t));
+        }
+        data += bytes;
+    }
+    return data;
+}
+
+} // namespace
+
+void bitpack_encode(const uint32_t* values, size_t count, std::vector<uint8_t>& out) {
+    for (size_t i = 0; i < count; i += kBlockSize) {
+        const size_t n = std::min(kBlockSize, count - i);
+        uint32_t block[kBlockSize] = {};
+        std::copy(values + i, values + i + n, block);
+
+        uint32_t any = 0;
+        for (size_t k = 0; k < n; k++) {
+            any |= block[k];
+        }
+        unsigned width = 0;
+        while (width < 32 && (any >> width) != 0) {
+            width++;
+        }
+        out.push_back(static_cast<uint8_t>(width));
+        if (width == 0) {
+            continue;
+        }
+
+        uint32_t words[kBlockSize] = {};
+        for (size_t lane = 0; lane < kLanes; lane++) {
+            unsigned bit = 0;
+            size_t word = 0;
+            for (size_t k = 0; k < kValuesPerLane; k++) {
+                const uint32_t value = block[k * kLanes + lane];
+                words[word * kLanes + lane] |= value << bit;
+                if (bit + width > 32) {
+                    words[(word + 1) * kLanes + lane] |= value >> (32 - bit);
+                }
+                bit += width;
+                if (bit >= 32) {
+                    bit -= 32;
+                    word++;
+                }
+            }
+        }
+        for (size_t w = 0; w < width * kLanes; w++) {
+            for (int shift = 0; shift < 32; shift += 8) {
+                out.push_back(static_cast<uint8_t>(words[w] >> shift));
+            }
+        }
+    }
+}
+
+const uint8_t* bitpack_decode(const uint8_t* data, const uint8_t* end,
+                              size_t count, uint32_t* values) {
+    return bitpack_decode_impl<false>(data, end, count, values);
+}
+
+const uint8_t* bitpack_decode_zigzag(const uint8_t* data, const uint8_t* end,
+                                     size_t count, int32_t* values) {
+    return bitpack_decode_impl<true>(data, end, count, reinterpret_cast<uint32_t*>(values));
+}
+
+} // namespace fresco
@@ -0,0 +1,36 @@
+/**
+ * @file bitpack.h
+ * @brief FRESCO binary packing of small integers
+ * @author Mehmet T. AKALIN
+ * @date 2025
+ * @license MIT
+ */
+
+#ifndef FRESCO_BITPACK_H
+#define FRESCO_BITPACK_H
+
+#include "fresco/fresco.h"
+#include <vector>
+
+namespace fresco {
+
+/**
+ * Values are packed in blocks of 128 with one bit width per block, stored as
+ * a width byte followed by 16 * width bytes. Within a block value i lives in
+ * 32-bit lane i % 4, so four values are unpacked with one vector shift and
+ * mask. Unlike Stream VByte, values below 256 cost their bit width rather
+ * than a full byte, which suits prediction residuals.
+ */
+void bitpack_encode(const uint32_t* values, size_t count, std::vector<uint8_t>& out);
+
+// The decoders return a pointer past the consumed bytes, or nullptr if the
+// stream is truncated or malformed.
+const uint8_t* bitpack_decode(const uint8_t* data, const uint8_t* end,
+                              size_t count, uint32_t* values);
+
+const uint8_t* bitpack_decode_zigzag(const uint8_t* data, const uint8_t* end,
+                                     size_t count, int32_t* values);
+
+} // namespace fresco
+
+#endif // FRESCO_BITPACK_H
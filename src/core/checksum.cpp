@@ -0,0 +1,220 @@
+/**
+ * @file checksum.cpp
+ * @brief FRESCO checksums of the container, zlib and PNG formats
+ * @author Mehmet T. AKALIN
+ * @date 2025
+ * @license MIT
+ */
+
+#include "checksum.h"
+#include <algorithm>
+#include <cstring>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#define FRESCO_CHECKSUM_SSE2 1
+#endif
+#if defined(__SSE4_2__)
+#include <nmmintrin.h>
+#define FRESCO_CHECKSUM_SSE42 1
+#endif
+
+namespace fresco {
+
+namespace {
+
+constexpr uint32_t kAdlerModulus = 65521;
+// Bytes summed before the Adler-32 sums must be reduced, as in zlib
+constexpr size_t kAdlerBlock = 5552;
+
+constexpr uint32_t kCrc32Polynomial = 0xEDB88320u;
+constexpr uint32_t kCrc32cPolynomial = 0x82F63B78u;
+
+// Slicing-by-8: table k gives the CRC of a byte followed by k zero bytes
+struct CrcTables {
+    uint32_t table[8][256];
+
+    explicit CrcTables(uint32_t polynomial) {
+        for (uint32_t i = 0; i < 256; i++) {
+            uint32_t crc = i;
+            for (int bit = 0; bit < 8; bit++) {
+                crc = (crc >> 1) ^ (polynomial & (0u - (crc & 1)));
+            }
+            table[0][i] = crc;
+        }
+        for (uint32_t i = 0; i < 256; i++) {
+            for (int k = 1; k < 8; k++) {
+                table[k][i] = (table[k - 1][i] >> 8) ^ table[0][table[k - 1][i] & 0xFF];
+            }
+        }
+    }
+};
+
+const CrcTables& crc_tables() {
+    static const CrcTables tables(kCrc32Polynomial);
+    return tables;
+}
+
+// Runs the CRC register over data without the inversions at either end
+uint32_t crc_update(const CrcTables& tables, uint32_t crc, const uint8_t* data, size_t size) {
+    const auto& t = tables.table;
+    for (; size >= 8; size -= 8, data += 8) {
+        const uint32_t low = crc ^ (static_cast<uint32_t>(data[0]) |
+                                    (static_cast<uint32_t>(data[1]) << 8) |
+                                    (static_cast<uint32_t>(data[2]) << 16) |
+                                    (static_cast<uint32_t>(data[3]) << 24));
+        crc = t[7][low & 0xFF] ^ t[6][(low >> 8) & 0xFF] ^ t[5][(low >> 16) & 0xFF] ^
+              t[4][low >> 24] ^ t[3][data[4]] ^ t[2][data[5]] ^ t[1][data[6]] ^ t[0][data[7]];
+    }
+    for (; size > 0; size--) {
+        crc = (crc >> 8) ^ t[0][(crc ^ *data++) & 0xFF];
+    }
+    return crc;
+}
+
+#if defined(FRESCO_CHECKSUM_SSE42)
+// The crc32 instruction takes 3 cycles but starts one a cycle, so long
+// inputs run three lanes at once and fold them together. Lanes are this
+// long, and shifting the register past a lane of zero bytes is a table
+// lookup per byte.
+constexpr size_t kCrcLane = 2048;
+
+struct LaneShift {
+    uint32_t table[4][256];
+
+    LaneShift() {
+        const CrcTables bytes(kCrc32cPolynomial);
+        const uint8_t zeros[kCrcLane] = {};
+        uint32_t bits[32];
+        for (int bit = 0; bit < 32; bit++) {
+            bits[bit] = crc_update(bytes, 1u << bit, zeros, kCrcLane);
+        }
+        for (int k = 0; k < 4; k++) {
+            for (uint32_t value = 0; value < 256; value++) {
+                uint32_t shifted = 0;
+                for (int bit = 0; bit < 8; bit++) {
+                    if (value & (1u << bit)) {
+                        shifted ^= bits[8 * k + bit];
+                    }
+                }
+                table[k][value] = shifted;
+            }
+        }
+    }
+
+    uint32_t operator()(uint32_t crc) const {
+        return table[0][crc & 0xFF] ^ table[1][(crc >> 8) & 0xFF] ^
+               table[2][(crc >> 16) & 0xFF] ^ table[3][crc >> 24];
+    }
+};
+
+const LaneShift& lane_shift() {
+    static const LaneShift shift;
+    return shift;
+}
+
+uint64_t load_u64(const uint8_t* data) {
+    uint64_t value;
+    std::memcpy(&value, data, sizeof(value));
+    return value;
+}
+#else
+const CrcTables& crc32c_tables() {
+    static const CrcTables tables(kCrc32cPolynomial);
+    return tables;
+}
+#endif
+
+#if defined(FRESCO_CHECKSUM_SSE2)
+uint32_t horizontal_sum(__m128i v) {
+    v = _mm_add_epi32(v, _mm_shuffle_epi32(v, _MM_SHUFFLE(1, 0, 3, 2)));
+    v = _mm_add_epi32(v, _mm_shuffle_epi32(v, _MM_SHUFFLE(2, 3, 0, 1)));
+    return static_cast<uint32_t>(_mm_cvtsi128_si32(v));
+}
+#endif
+
+} // namespace
+
+uint32_t crc32(uint32_t crc, const uint8_t* data, size_t size) {
+    return ~crc_update(crc_tables(), ~crc, data, size);
+}
+
+uint32_t crc32c(uint32_t crc, const uint8_t* data, size_t size) {
+    crc = ~crc;
+#if defined(FRESCO_CHECKSUM_SSE42)
+    if (size >= 3 * kCrcLane) {
+        const LaneShift& shift = lane_shift();
+        do {
+            uint64_t a = crc, b = 0, c = 0;
+            for (size_t i = 0; i < kCrcLane; i += 8) {
+                a = _mm_crc32_u64(a, load_u64(data + i));
+                b = _mm_crc32_u64(b, load_u64(data + kCrcLane + i));
+                c = _mm_crc32_u64(c, load_u64(data + 2 * kCrcLane + i));
+            }
+            crc = shift(shift(static_cast<uint32_t>(a)) ^ static_cast<uint32_t>(b)) ^
+                  static_cast<uint32_t>(c);
+            data += 3 * kCrcLane;
+            size -= 3 * kCrcLane;
+        } while (size >= 3 * kCrcLane);
+    }
+    uint64_t wide = crc;
+    for (; size >= 8; size -= 8, data += 8) {
+        wide = _mm_crc32_u64(wide, load_u64(data));
+    }
+    crc = static_cast<uint32_t>(wide);
+    for (; size > 0; size--) {
+        crc = _mm_crc32_u8(crc, *data++);
+    }
+    return ~crc;
+#else
+    return ~crc_update(crc32c_tables(), crc, data, size);
+#endif
+}
+
+uint32_t adler32(uint32_t adler, const uint8_t* data, size_t size) {
+    uint32_t a = adler & 0xFFFF;
+    uint32_t b = adler >> 16;
+#if defined(FRESCO_CHECKSUM_SSE2)
+    // 16 bytes a step: a gains their sum, b gains 16 times the a before the
+    // step plus the bytes weighted 16 down to 1
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i weights_low = _mm_setr_epi16(16, 15, 14, 13, 12, 11, 10, 9);
+    const __m128i weights_high = _mm_setr_epi16(8, 7, 6, 5, 4, 3, 2, 1);
+    while (size >= 16) {
+        size_t steps = std::min(size, kAdlerBlock) / 16;
+        size -= steps * 16;
+        __m128i sum_a = zero;
+        __m128i prior_a = zero;    // The a of every step before its bytes
+        __m128i sum_b = zero;
+        const uint64_t step_count = steps;
+        do {
+            const __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data));
+            prior_a = _mm_add_epi32(prior_a, sum_a);
+            sum_a = _mm_add_epi32(sum_a, _mm_sad_epu8(bytes, zero));
+            sum_b = _mm_add_epi32(sum_b,
+                                  _mm_madd_epi16(_mm_unpacklo_epi8(bytes, zero), weights_low));
+            sum_b = _mm_add_epi32(sum_b,
+                                  _mm_madd_epi16(_mm_unpackhi_epi8(bytes, zero), weights_high));
+            data += 16;
+        } while (--steps);
+        const uint64_t wide_b = b + 16 * (step_count * a + horizontal_sum(prior_a)) +
+                                horizontal_sum(sum_b);
+        a = (a + horizontal_sum(sum_a)) % kAdlerModulus;
+        b = static_cast<uint32_t>(wide_b % kAdlerModulus);
+    }
+#endif
+    while (size > 0) {
+        const size_t count = std::min(size, kAdlerBlock);
+        for (size_t i = 0; i < count; i++) {
+            a += data[i];
+            b += a;
+        }
+        a %= kAdlerModulus;
+        b %= kAdlerModulus;
+        data += count;
+        size -= count;
+    }
+    return (b << 16) | a;
+}
+
+} // namespace fresco
@@ -0,0 +1,32 @@
+/**
+ * @file checksum.h
+ * @brief FRESCO checksums of the container, zlib and PNG formats
+ * @author Mehmet T. AKALIN
+ * @date 2025
+ * @license MIT
+ */
+
+#ifndef FRESCO_CHECKSUM_H
+#define FRESCO_CHECKSUM_H
+
+#include <cstddef>
+#include <cstdint>
+
+namespace fresco {
+
+// CRC-32 of PNG chunks and gzip (reflected polynomial 0xEDB88320). Pass 0
+// to start and the previous result to continue.
+uint32_t crc32(uint32_t crc, const uint8_t* data, size_t size);
+
+// CRC-32C (Castagnoli, reflected polynomial 0x82F63B78) of FRESCO tiles and
+// tracks, with the SSE4.2 crc32 instruction when the build has it. Pass 0
+// to start and the previous result to continue.
+uint32_t crc32c(uint32_t crc, const uint8_t* data, size_t size);
+
+// Adler-32 of zlib streams. Pass 1 to start and the previous result to
+// continue.
+uint32_t adler32(uint32_t adler, const uint8_t* data, size_t size);
+
+} // namespace fresco
+
+#endif // FRESCO_CHECKSUM_H
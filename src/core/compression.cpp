@@ -8,29 +8,1482 @@
 
 #include "fresco/fresco.h"
 #include "compression.h"
+#include "parallel.h"
+#include "range_coder.h"
+#include "varint.h"
+#include "bitpack.h"
+#include "stats.h"
+#include "tile_cache.h"
+#include "checksum.h"
+#include "codecs/wavelet.h"
+#include "codecs/coefficient_coder.h"
+#include "codecs/lossy_codec.h"
+#include "codecs/lossless_codec.h"
+#include <algorithm>
+#include <cmath>
 #include <vector>
 #include <cstring>
 
 namespace fresco {
 
+namespace {
+
+// Version 2 adds a CRC-32C per tile and one of the header and index,
+// version 3 a mode byte in front of each tile; versions 1 (unchecked) and
+// 2 still decode
+constexpr uint8_t kRasterVersion = 3;
+constexpr uint8_t kRasterVersionChecked = 2;
+constexpr uint8_t kRasterVersionUnchecked = 1;
+constexpr uint8_t kTileTransform = 0;
+constexpr uint8_t kTilePalette = 1;
+constexpr uint8_t kRasterFlagLossless = 0x01;
+constexpr uint8_t kRasterFlagColorTransform = 0x02;
+constexpr uint32_t kDefaultTileSize = 256;
+constexpr uint32_t kMinTileSize = 16;
+constexpr uint32_t kMaxTileSize = 4096;
+constexpr uint32_t kMaxRasterLevels = 6;
+constexpr int32_t kLevelShift = 128;
+
+// Rate control: step search range, model refinement passes and the share
+// of the budget that ends the search early
+constexpr float kMinBaseStep = 1.0f / 16.0f;
+constexpr float kMaxBaseStep = 4096.0f;
+constexpr double kRateTolerance = 0.97;
+// Tile mode, range coder flush and tile size varint
+constexpr double kTileOverheadBytes = 8.0;
+// Palette tiles up to this size are kept without trying the transform
+constexpr uint32_t kPaletteBitsPerPixel = 1;
+
+// Deadzone rounding offsets tried by the rate-distortion search of detail
+// bands; the first is the fixed offset used when there is no search
+constexpr float kRoundingCandidates[] = {kDetailRounding, 0.3f, 0.45f, 0.25f, 0.2f, 0.5f};
+// Lagrange multiplier of a uniform quantizer at high rate, 2 ln 2 / 12, per
+// squared step
+constexpr double kLambdaPerStep2 = 0.1155;
+
+// The tools each effort level turns on. Every step up costs encoder time
+// only; the decoder's work depends on the transform depth and the coder.
+struct EffortPreset {
+    uint32_t tile_size;         // Used when the caller leaves tile_size at 0
+    uint32_t max_levels;        // Wavelet decomposition depth
+    EntropyCoder coder;
+    uint32_t rounding_search;   // Deadzone offsets tried per detail band
+    int rate_passes;            // Coded passes of target size rate control
+};
+
+constexpr EffortPreset kEffortPresets[10] = {
+    {256, 3, EntropyCoder::Static, 1, 4},              // 1: real-time path
+    {256, 4, EntropyCoder::AdaptiveReduced, 1, 4},
+    {256, 5, EntropyCoder::AdaptiveReduced, 1, 6},
+    {256, 5, EntropyCoder::Adaptive, 1, 6},
+    {256, 5, EntropyCoder::Adaptive, 1, 8},            // 5: default
+    {256, 5, EntropyCoder::Adaptive, 2, 8},
+    {256, 5, EntropyCoder::Adaptive, 3, 8},
+    {512, 6, EntropyCoder::Adaptive, 3, 8},
+    {512, 6, EntropyCoder::Adaptive, 4, 10},
+    {512, 6, EntropyCoder::Adaptive, 6, 12},
+};
+
+const EffortPreset& effort_preset(uint8_t effort) {
+    return kEffortPresets[std::min<uint8_t>(std::max<uint8_t>(effort, 1), 10) - 1];
+}
+
+struct RasterLayout {
+    uint32_t width = 0;
+    uint32_t height = 0;
+    uint32_t channels = 0;
+    size_t row_stride = 0;  // Bytes between rows of the caller's pixels
+    uint32_t planes = 0;
+    uint32_t tile_size = 0;
+    uint32_t levels = 0;
+    uint32_t tiles_x = 0;
+    uint32_t tiles_y = 0;
+    bool lossless = false;
+    bool color_transform = false;
+    float base_step = 1.0f;
+    uint32_t max_levels = kMaxRasterLevels;
+    EntropyCoder coder = EntropyCoder::Adaptive;
+    uint32_t rounding_search = 1;
+    const uint8_t* checksums = nullptr;    // CRC-32C of each tile, little-endian
+    bool verify_tiles = false;             // Check each tile as it is read
+    bool tile_modes = false;               // Each tile starts with its mode byte
+
+    size_t tile_count() const { return static_cast<size_t>(tiles_x) * tiles_y; }
+
+    uint32_t tile_checksum(size_t tile) const {
+        const uint8_t* p = checksums + 4 * tile;
+        return static_cast<uint32_t>(p[0]) | (static_cast<uint32_t>(p[1]) << 8) |
+               (static_cast<uint32_t>(p[2]) << 16) | (static_cast<uint32_t>(p[3]) << 24);
+    }
+
+    void tile_rect(size_t tile, uint32_t& x, uint32_t& y, uint32_t& w, uint32_t& h) const {
+        x = static_cast<uint32_t>(tile % tiles_x) * tile_size;
+        y = static_cast<uint32_t>(tile / tiles_x) * tile_size;
+        w = std::min(tile_size, width - x);
+        h = std::min(tile_size, height - y);
+    }
+
+    void set_tiling(uint32_t tile) {
+        tile_size = tile;
+        tiles_x = (width + tile - 1) / tile;
+        tiles_y = (height + tile - 1) / tile;
+        levels = 0;
+        while (levels < max_levels && (tile >> (levels + 1)) >= 4) {
+            levels++;
+        }
+    }
+};
+
+// Loads one tile as level-shifted planes (YCoCg-R when color_transform)
+// and transforms every plane; pixels holds the image from row first_row
+void forward_tile(const uint8_t* pixels, uint32_t first_row, const RasterLayout& layout,
+                  size_t tile, std::vector<int32_t>& coefficients, std::vector<int32_t>& scratch,
+                  Stopwatch& watch) {
+    uint32_t tx, ty, tw, th;
+    layout.tile_rect(tile, tx, ty, tw, th);
+    const size_t plane_size = static_cast<size_t>(tw) * th;
+    coefficients.resize(plane_size * layout.planes);
+    scratch.resize(tw);
+
+    const uint32_t channels = layout.channels;
+    for (uint32_t y = 0; y < th; y++) {
+        const uint8_t* src = pixels +
+                             (static_cast<size_t>(ty - first_row) + y) * layout.row_stride +
+                             tx * channels;
+        const size_t row = static_cast<size_t>(y) * tw;
+        for (uint32_t x = 0; x < tw; x++, src += channels) {
+            if (layout.color_transform) {
+                int32_t luma, co, cg;
+                rct_forward(src[0], src[1], src[2], luma, co, cg);
+                coefficients[row + x] = luma - kLevelShift;
+                coefficients[plane_size + row + x] = co;
+                coefficients[2 * plane_size + row + x] = cg;
+                if (channels > 3) {
+                    coefficients[3 * plane_size + row + x] = src[3] - kLevelShift;
+                }
+            } else {
+                for (uint32_t c = 0; c < channels; c++) {
+                    coefficients[c * plane_size + row + x] = src[c] - kLevelShift;
+                }
+            }
+        }
+    }
+    watch.lap(Stage::Color);
+
+    for (uint32_t p = 0; p < layout.planes; p++) {
+        dwt53_forward(&coefficients[p * plane_size], tw, th, tw, layout.levels, scratch.data());
+    }
+    watch.lap(Stage::Transform);
+}
+
+// Rate-distortion choice of the deadzone rounding of one detail band:
+// distortion is measured against the decoder's reconstruction and rate is
+// the zeroth-order entropy of the magnitudes plus sign and mantissa bits
+float choose_rounding(const int32_t* plane, size_t stride, const Subband& band, float step,
+                      uint32_t candidates) {
+    constexpr uint32_t kExact = 16;
+    const float inverse_step = 1.0f / step;
+    const double lambda = kLambdaPerStep2 * static_cast<double>(step) * step;
+    const double count = static_cast<double>(band.width) * band.height;
+    float best_rounding = kRoundingCandidates[0];
+    double best_cost = 0.0;
+    for (uint32_t c = 0; c < candidates; c++) {
+        const float rounding = kRoundingCandidates[c];
+        uint64_t histogram[kExact + 32] = {};
+        uint64_t extra_bits = 0;
+        double distortion = 0.0;
+        for (uint32_t y = band.y; y < band.y + band.height; y++) {
+            const int32_t* row = plane + static_cast<size_t>(y) * stride;
+            for (uint32_t x = band.x; x < band.x + band.width; x++) {
+                const int32_t q = LossyCodec::quantize(row[x], inverse_step, rounding);
+                const double error = static_cast<double>(row[x]) -
+                                     LossyCodec::dequantize(q, step);
+                distortion += error * error;
+                const uint32_t magnitude = static_cast<uint32_t>(q < 0 ? -q : q);
+                if (magnitude < kExact) {
+                    histogram[magnitude]++;
+                    extra_bits += magnitude != 0;
+                } else {
+                    const uint32_t bits = 32 - static_cast<uint32_t>(__builtin_clz(magnitude));
+                    histogram[kExact + bits]++;
+                    extra_bits += bits;    // Sign and mantissa
+                }
+            }
+        }
+        double rate = static_cast<double>(extra_bits);
+        for (uint64_t n : histogram) {
+            if (n) {
+                rate -= static_cast<double>(n) * std::log2(static_cast<double>(n) / count);
+            }
+        }
+        const double cost = distortion + lambda * rate;
+        if (c == 0 || cost < best_cost) {
+            best_cost = cost;
+            best_rounding = rounding;
+        }
+    }
+    return best_rounding;
+}
+
+// Quantizes the transformed planes of a tile and entropy codes them, all
+// planes of the tile in one stream
+void encode_tile(const RasterLayout& layout, size_t tile, const int32_t* coefficients,
+                 std::vector<int32_t>& quantized, std::vector<uint32_t>& packed,
+                 std::vector<uint8_t>& out, Stopwatch& watch) {
+    uint32_t tx, ty, tw, th;
+    layout.tile_rect(tile, tx, ty, tw, th);
+    const size_t plane_size = static_cast<size_t>(tw) * th;
+    const auto bands = subband_layout(tw, th, layout.levels);
+
+    out.clear();
+    out.push_back(kTileTransform);
+    RangeEncoder encoder(out);
+    for (uint32_t p = 0; p < layout.planes; p++) {
+        const int32_t* plane = coefficients + p * plane_size;
+        if (!layout.lossless) {
+            quantized.resize(plane_size);
+            for (const auto& band : bands) {
+                const float step = LossyCodec::band_step(layout.base_step, p,
+                                                         layout.color_transform, band);
+                const float inverse_step = 1.0f / step;
+                float rounding = kLowpassRounding;
+                if (band.orientation != Orientation::LL) {
+                    rounding = layout.rounding_search > 1
+                                   ? choose_rounding(plane, tw, band, step, layout.rounding_search)
+                                   : kDetailRounding;
+                }
+                for (uint32_t y = band.y; y < band.y + band.height; y++) {
+                    const int32_t* src = plane + static_cast<size_t>(y) * tw;
+                    int32_t* dst = &quantized[static_cast<size_t>(y) * tw];
+                    for (uint32_t x = band.x; x < band.x + band.width; x++) {
+                        dst[x] = LossyCodec::quantize(src[x], inverse_step, rounding);
+                    }
+                }
+            }
+            plane = quantized.data();
+            watch.lap(Stage::Quantize);
+        }
+
+        if (layout.coder == EntropyCoder::Static) {
+            for (const auto& band : bands) {
+                encode_band_static(band, plane, tw, packed, out);
+            }
+        } else {
+            PlaneModels models;
+            for (const auto& band : bands) {
+                encode_band(encoder, models, band, plane, tw,
+                            layout.coder == EntropyCoder::AdaptiveReduced);
+            }
+        }
+        watch.lap(Stage::Entropy);
+    }
+    if (layout.coder != EntropyCoder::Static) {
+        encoder.finish();
+    }
+}
+
+// Codes one tile as a palette into out when it has at most
+// kMaxPaletteColors colors; pixels holds the image from row first_row
+bool encode_palette_tile(const uint8_t* pixels, uint32_t first_row, const RasterLayout& layout,
+                         size_t tile, std::vector<uint8_t>& indices, std::vector<uint8_t>& out,
+                         Stopwatch& watch) {
+    uint32_t tx, ty, tw, th;
+    layout.tile_rect(tile, tx, ty, tw, th);
+    const uint8_t* src = pixels + static_cast<size_t>(ty - first_row) * layout.row_stride +
+                         static_cast<size_t>(tx) * layout.channels;
+    TilePalette palette;
+    const bool found = LosslessCodec::find_palette(src, layout.row_stride, tw, th,
+                                                   layout.channels, palette, indices);
+    watch.lap(Stage::Color);
+    if (!found) {
+        return false;
+    }
+    out.clear();
+    out.push_back(kTilePalette);
+    LosslessCodec::encode_palette(palette, indices.data(), tw, th, layout.channels, out);
+    watch.lap(Stage::Entropy);
+    return true;
+}
+
+// Whether a palette tile of size bytes is taken without coding the
+// transform too
+bool palette_small(const RasterLayout& layout, size_t tile, size_t size) {
+    uint32_t tx, ty, tw, th;
+    layout.tile_rect(tile, tx, ty, tw, th);
+    return size * 8 <= static_cast<size_t>(tw) * th * kPaletteBitsPerPixel;
+}
+
+// Codes one tile into out; pixels holds the image from row first_row. A
+// tile of few colors is coded as a palette, exactly in either mode; when
+// that takes more than kPaletteBitsPerPixel the transform is coded too and
+// the smaller of the two kept.
+void code_tile(const uint8_t* pixels, uint32_t first_row, const RasterLayout& layout,
+               size_t tile, std::vector<int32_t>& coefficients, std::vector<int32_t>& scratch,
+               std::vector<int32_t>& quantized, std::vector<uint32_t>& packed,
+               std::vector<uint8_t>& indices, std::vector<uint8_t>& palette,
+               std::vector<uint8_t>& out, Stopwatch& watch) {
+    const bool found = encode_palette_tile(pixels, first_row, layout, tile, indices, palette,
+                                           watch);
+    if (found && palette_small(layout, tile, palette.size())) {
+        out.swap(palette);
+        return;
+    }
+    forward_tile(pixels, first_row, layout, tile, coefficients, scratch, watch);
+    encode_tile(layout, tile, coefficients.data(), quantized, packed, out, watch);
+    if (found && palette.size() < out.size()) {
+        out.swap(palette);
+    }
+}
+
+// Tile buffers of one decoding thread. They outlive the call, so a thread
+// that decodes image after image stops allocating once they have grown to
+// its largest tile.
+struct TileScratch {
+    std::vector<int32_t> planes;
+    std::vector<int32_t> scratch;
+    std::vector<int32_t> unpacked;
+    std::vector<uint8_t> pixels;     // A tile only partly inside a region
+    std::vector<uint8_t> indices;    // Palette indices of a tile
+
+    uint64_t bytes() const {
+        return capacity_bytes(planes) + capacity_bytes(scratch) + capacity_bytes(unpacked) +
+               capacity_bytes(pixels) + capacity_bytes(indices);
+    }
+};
+
+// The level-shifted plane values of one pixel (YCoCg-R when
+// color_transform), as forward_tile() loads them
+void pixel_planes(const RasterLayout& layout, const uint8_t* src, int32_t* values) {
+    if (layout.color_transform) {
+        rct_forward(src[0], src[1], src[2], values[0], values[1], values[2]);
+        values[0] -= kLevelShift;
+        if (layout.channels > 3) {
+            values[3] = src[3] - kLevelShift;
+        }
+    } else {
+        for (uint32_t c = 0; c < layout.channels; c++) {
+            values[c] = src[c] - kLevelShift;
+        }
+    }
+}
+
+bool tile_intact(const RasterLayout& layout, size_t tile, const uint8_t* data, size_t size) {
+    return !layout.verify_tiles || crc32c(0, data, size) == layout.tile_checksum(tile);
+}
+
+bool palette_tile(const RasterLayout& layout, const uint8_t* data, size_t size) {
+    return layout.tile_modes && size > 0 && data[0] == kTilePalette;
+}
+
+// Decodes the indices of a palette tile into scratch.indices
+bool read_palette(const RasterLayout& layout, size_t tile, const uint8_t* data, size_t size,
+                  TilePalette& palette, TileScratch& scratch, Stopwatch& watch) {
+    uint32_t tx, ty, tw, th;
+    layout.tile_rect(tile, tx, ty, tw, th);
+    const bool ok = LosslessCodec::decode_palette(data + 1, size - 1, tw, th, layout.channels,
+                                                  palette, scratch.indices);
+    watch.lap(Stage::Entropy);
+    return ok;
+}
+
+// Entropy decodes all planes of a tile into scratch.planes and dequantizes
+// the bands that 1 / 2^skip resolution needs. A palette tile is expanded
+// and transformed instead, which gives the planes of its exact pixels.
+bool read_tile(const RasterLayout& layout, size_t tile, const uint8_t* data, size_t size,
+               uint32_t skip, TileScratch& scratch, Stopwatch& watch) {
+    if (!tile_intact(layout, tile, data, size)) {
+        return false;
+    }
+    std::vector<int32_t>& planes = scratch.planes;
+    if (palette_tile(layout, data, size)) {
+        TilePalette palette;
+        if (!read_palette(layout, tile, data, size, palette, scratch, watch)) {
+            return false;
+        }
+        uint32_t tx, ty, tw, th;
+        layout.tile_rect(tile, tx, ty, tw, th);
+        const size_t plane_size = static_cast<size_t>(tw) * th;
+        int32_t values[kMaxPaletteColors][kMaxPlanes];
+        for (uint32_t i = 0; i < palette.count; i++) {
+            pixel_planes(layout, palette.colors[i], values[i]);
+        }
+        planes.resize(plane_size * layout.planes);
+        for (uint32_t p = 0; p < layout.planes; p++) {
+            int32_t* plane = &planes[p * plane_size];
+            for (size_t i = 0; i < plane_size; i++) {
+                plane[i] = values[scratch.indices[i]][p];
+            }
+        }
+        watch.lap(Stage::Color);
+        scratch.scratch.resize(tw);
+        for (uint32_t p = 0; p < layout.planes; p++) {
+            dwt53_forward(&planes[p * plane_size], tw, th, tw, layout.levels,
+                          scratch.scratch.data());
+        }
+        watch.lap(Stage::Transform);
+        return true;
+    }
+    if (layout.tile_modes) {
+        if (size == 0 || data[0] != kTileTransform) {
+            return false;
+        }
+        data++;
+        size--;
+    }
+    uint32_t tx, ty, tw, th;
+    layout.tile_rect(tile, tx, ty, tw, th);
+    const size_t plane_size = static_cast<size_t>(tw) * th;
+    const auto bands = subband_layout(tw, th, layout.levels);
+    planes.assign(plane_size * layout.planes, 0);
+
+    RangeDecoder decoder(data, data + size);
+    const uint8_t* packed = data;
+    const uint8_t* end = data + size;
+    for (uint32_t p = 0; p < layout.planes; p++) {
+        int32_t* plane = &planes[p * plane_size];
+        if (layout.coder == EntropyCoder::Static) {
+            for (const auto& band : bands) {
+                packed = decode_band_static(packed, end, band, plane, tw, scratch.unpacked);
+                if (!packed) {
+                    return false;
+                }
+            }
+        } else {
+            PlaneModels models;
+            for (const auto& band : bands) {
+                decode_band(decoder, models, band, plane, tw,
+                            layout.coder == EntropyCoder::AdaptiveReduced);
+            }
+            if (decoder.overrun()) {
+                return false;
+            }
+        }
+        watch.lap(Stage::Entropy);
+
+        if (!layout.lossless) {
+            for (const auto& band : bands) {
+                if (band.orientation != Orientation::LL && band.level <= skip) {
+                    continue;    // Finer than the output, never inverted
+                }
+                const float step = LossyCodec::band_step(layout.base_step, p,
+                                                         layout.color_transform, band);
+                for (uint32_t y = band.y; y < band.y + band.height; y++) {
+                    int32_t* row = plane + static_cast<size_t>(y) * tw;
+                    for (uint32_t x = band.x; x < band.x + band.width; x++) {
+                        row[x] = LossyCodec::dequantize(row[x], step);
+                    }
+                }
+            }
+            watch.lap(Stage::Quantize);
+        }
+    }
+    return layout.coder != EntropyCoder::Static || packed == end;
+}
+
+// Converts the tile's planes, inverted down to 1 / 2^skip resolution, into
+// out, its top-left pixel at that resolution, with rows out_stride bytes
+// apart
+void write_tile(const RasterLayout& layout, size_t tile, uint32_t skip,
+                const std::vector<int32_t>& planes, uint8_t* out, size_t out_stride,
+                Stopwatch& watch) {
+    uint32_t tx, ty, tw, th;
+    layout.tile_rect(tile, tx, ty, tw, th);
+    const size_t plane_size = static_cast<size_t>(tw) * th;
+    auto clamp = [](int32_t v) -> uint8_t {
+        return static_cast<uint8_t>(v < 0 ? 0 : (v > 255 ? 255 : v));
+    };
+    // The low band takes the ceiling half at every level
+    const uint32_t out_width = (tw + (1u << skip) - 1) >> skip;
+    const uint32_t out_height = (th + (1u << skip) - 1) >> skip;
+    const uint32_t channels = layout.channels;
+    for (uint32_t y = 0; y < out_height; y++) {
+        uint8_t* dst = out + y * out_stride;
+        const size_t row = static_cast<size_t>(y) * tw;
+        for (uint32_t x = 0; x < out_width; x++, dst += channels) {
+            if (layout.color_transform) {
+                int32_t r, g, b;
+                rct_inverse(planes[row + x] + kLevelShift, planes[plane_size + row + x],
+                            planes[2 * plane_size + row + x], r, g, b);
+                dst[0] = clamp(r);
+                dst[1] = clamp(g);
+                dst[2] = clamp(b);
+                if (channels > 3) {
+                    dst[3] = clamp(planes[3 * plane_size + row + x] + kLevelShift);
+                }
+            } else {
+                for (uint32_t c = 0; c < channels; c++) {
+                    dst[c] = clamp(planes[c * plane_size + row + x] + kLevelShift);
+                }
+            }
+        }
+    }
+    watch.lap(Stage::Color);
+}
+
+// Writes a palette tile at full resolution straight into out, its
+// top-left pixel, with rows out_stride bytes apart
+bool write_palette_tile(const RasterLayout& layout, size_t tile, const uint8_t* data,
+                        size_t size, TileScratch& scratch, uint8_t* out, size_t out_stride,
+                        Stopwatch& watch) {
+    if (!tile_intact(layout, tile, data, size)) {
+        return false;
+    }
+    TilePalette palette;
+    if (!read_palette(layout, tile, data, size, palette, scratch, watch)) {
+        return false;
+    }
+    uint32_t tx, ty, tw, th;
+    layout.tile_rect(tile, tx, ty, tw, th);
+    LosslessCodec::expand_palette(palette, scratch.indices.data(), tw, th, layout.channels, out,
+                                  out_stride);
+    watch.lap(Stage::Color);
+    return true;
+}
+
+// Decodes one tile at 1 / 2^skip resolution into out, its top-left pixel
+// at that resolution, with rows out_stride bytes apart
+bool decode_tile(const RasterLayout& layout, size_t tile, const uint8_t* data, size_t size,
+                 uint32_t skip, TileScratch& scratch, uint8_t* out, size_t out_stride,
+                 Stopwatch& watch) {
+    if (skip == 0 && palette_tile(layout, data, size)) {
+        return write_palette_tile(layout, tile, data, size, scratch, out, out_stride, watch);
+    }
+    if (!read_tile(layout, tile, data, size, skip, scratch, watch)) {
+        return false;
+    }
+    uint32_t tx, ty, tw, th;
+    layout.tile_rect(tile, tx, ty, tw, th);
+    const size_t plane_size = static_cast<size_t>(tw) * th;
+    scratch.scratch.resize(tw);
+    for (uint32_t p = 0; p < layout.planes; p++) {
+        dwt53_inverse(&scratch.planes[p * plane_size], tw, th, tw, layout.levels, skip,
+                      scratch.scratch.data());
+    }
+    watch.lap(Stage::Transform);
+    write_tile(layout, tile, skip, scratch.planes, out, out_stride, watch);
+    return true;
+}
+
+void write_raster(const RasterLayout& layout, const std::vector<std::vector<uint8_t>>& tiles,
+                  std::vector<uint8_t>& out) {
+    size_t payload = 0;
+    for (const auto& tile : tiles) {
+        payload += tile.size();
+    }
+    out.clear();
+    out.reserve(20 + tiles.size() * 7 + payload);
+    out.push_back(kRasterVersion);
+    out.push_back(static_cast<uint8_t>((layout.lossless ? kRasterFlagLossless : 0) |
+                                       (layout.color_transform ? kRasterFlagColorTransform : 0)));
+    out.push_back(static_cast<uint8_t>(layout.levels));
+    out.push_back(static_cast<uint8_t>(layout.coder));
+    write_varint(out, layout.tile_size);
+    write_f32_le(out, layout.lossless ? 1.0f : layout.base_step);
+    for (const auto& tile : tiles) {
+        write_varint(out, tile.size());
+    }
+    for (const auto& tile : tiles) {
+        write_u32_le(out, crc32c(0, tile.data(), tile.size()));
+    }
+    write_u32_le(out, crc32c(0, out.data(), out.size()));
+    for (const auto& tile : tiles) {
+        out.insert(out.end(), tile.begin(), tile.end());
+    }
+}
+
+size_t varint_size(uint64_t value) {
+    size_t size = 1;
+    for (value >>= 7; value; value >>= 7) {
+        size++;
+    }
+    return size;
+}
+
+// Size write_raster() will produce
+size_t raster_size(const RasterLayout& layout, const std::vector<std::vector<uint8_t>>& tiles) {
+    size_t size = 12 + varint_size(layout.tile_size);
+    for (const auto& tile : tiles) {
+        size += tile.size() + varint_size(tile.size()) + 4;
+    }
+    return size;
+}
+
+// Working memory of one worker on one tile: the planes, quantized or
+// unpacked coefficients, packed values, palette indices and a transform row
+uint64_t tile_working_bytes(const RasterLayout& layout) {
+    const uint64_t pixels = static_cast<uint64_t>(layout.tile_size) * layout.tile_size;
+    const uint64_t values = pixels * layout.planes;
+    return values * (2 * sizeof(int32_t) + sizeof(uint32_t)) + pixels +
+           layout.tile_size * sizeof(int32_t);
+}
+
+// Workers that fit into a memory budget beside reserved bytes, at most
+// wanted and 0 if not even one does; a zero budget means no limit
+uint32_t workers_within(uint64_t budget, uint64_t reserved, uint64_t per_worker,
+                        uint32_t wanted) {
+    if (budget == 0) {
+        return wanted;
+    }
+    if (reserved >= budget) {
+        return 0;
+    }
+    return static_cast<uint32_t>(std::min<uint64_t>(wanted, (budget - reserved) / per_worker));
+}
+
+// Raster size to plan memory for before coding: the target when there is
+// one, else about 4 bpp lossless and 1.5 bpp lossy for 8-bit RGB
+uint64_t expected_raster_bytes(const RasterLayout& layout, uint64_t pixel_bytes,
+                               uint64_t byte_budget) {
+    if (!layout.lossless && byte_budget > 0) {
+        return byte_budget;
+    }
+    return layout.lossless ? pixel_bytes / 6 + 1 : pixel_bytes / 16 + 1;
+}
+
+// Levels the tiles can be decoded at: each must halve the tile size to
+// whole pixels, so that tile positions scale with the level
+uint32_t supported_levels(const RasterLayout& layout) {
+    uint32_t levels = 0;
+    while (levels < layout.levels && layout.tile_size % (2u << levels) == 0) {
+        levels++;
+    }
+    return levels;
+}
+
+TileScratch& thread_tile_scratch() {
+    thread_local TileScratch scratch;
+    return scratch;
+}
+
+// Reads the raster track header and tile index for pixels whose rows are
+// row_stride bytes apart (0 when packed). Tile i then lies at
+// tiles + offsets[i], offsets[i + 1] - offsets[i] bytes long. Unless verify
+// is SKIP the index is checked here; ALWAYS checks every tile too, LAZY
+// leaves each tile to read_tile().
+fresco_error_t read_raster(const uint8_t* compressed_data, size_t compressed_size,
+                           const ContainerInfo& container_info, size_t row_stride,
+                           fresco_verify_t verify, RasterLayout& layout,
+                           std::vector<size_t>& offsets, const uint8_t*& tiles) {
+    layout.width = container_info.width;
+    layout.height = container_info.height;
+    layout.channels = container_info.channels;
+    layout.planes = container_info.channels;
+    if (container_info.bit_depth != 8 || layout.channels < 1 || layout.channels > kMaxPlanes ||
+        layout.width == 0 || layout.height == 0) {
+        return FRESCO_ERROR_UNSUPPORTED_FORMAT;
+    }
+    const size_t row_bytes = static_cast<size_t>(layout.width) * layout.channels;
+    layout.row_stride = row_stride ? row_stride : row_bytes;
+    if (layout.row_stride < row_bytes) {
+        return FRESCO_ERROR_INVALID_PARAMETER;
+    }
+
+    const uint8_t* data = compressed_data;
+    const uint8_t* end = data + compressed_size;
+    if (end - data < 4 || data[0] < kRasterVersionUnchecked || data[0] > kRasterVersion) {
+        return FRESCO_ERROR_CORRUPTED_DATA;
+    }
+    const bool checked = data[0] >= kRasterVersionChecked;
+    layout.tile_modes = data[0] >= kRasterVersion;
+    const uint8_t flags = data[1];
+    const uint8_t levels = data[2];
+    const uint8_t coder = data[3];
+    data += 4;
+    uint64_t tile_size = 0;
+    float base_step = 0.0f;
+    if (!read_varint(data, end, tile_size) || !read_f32_le(data, end, base_step) ||
+        tile_size < kMinTileSize || tile_size > kMaxTileSize || levels > kMaxWaveletLevels ||
+        coder > static_cast<uint8_t>(EntropyCoder::Static) || !(base_step > 0.0f)) {
+        return FRESCO_ERROR_CORRUPTED_DATA;
+    }
+    layout.lossless = (flags & kRasterFlagLossless) != 0;
+    layout.color_transform = (flags & kRasterFlagColorTransform) != 0;
+    if (layout.color_transform && layout.channels < 3) {
+        return FRESCO_ERROR_CORRUPTED_DATA;
+    }
+    layout.base_step = base_step;
+    layout.coder = static_cast<EntropyCoder>(coder);
+    layout.set_tiling(static_cast<uint32_t>(tile_size));
+    layout.levels = levels;
+
+    // Every tile takes at least its size varint, so a header asking for
+    // more tiles than there are bytes is corrupt; checked before the index
+    // and the per-tile state sized from it are allocated
+    const size_t tile_count = layout.tile_count();
+    if (tile_count > static_cast<size_t>(end - data)) {
+        return FRESCO_ERROR_CORRUPTED_DATA;
+    }
+    offsets.assign(tile_count + 1, 0);
+    for (size_t i = 0; i < tile_count; i++) {
+        uint64_t size = 0;
+        if (!read_varint(data, end, size) || size > compressed_size) {
+            return FRESCO_ERROR_CORRUPTED_DATA;
+        }
+        offsets[i + 1] = offsets[i] + static_cast<size_t>(size);
+    }
+    if (checked) {
+        if (static_cast<size_t>(end - data) < 4 * (tile_count + 1)) {
+            return FRESCO_ERROR_CORRUPTED_DATA;
+        }
+        layout.checksums = data;
+        data += 4 * tile_count;
+        uint32_t index_checksum = 0;
+        read_u32_le(data, end, index_checksum);
+        if (verify != FRESCO_VERIFY_SKIP &&
+            crc32c(0, compressed_data, static_cast<size_t>(data - compressed_data - 4)) !=
+                index_checksum) {
+            return FRESCO_ERROR_CORRUPTED_DATA;
+        }
+    }
+    if (offsets[tile_count] > static_cast<size_t>(end - data)) {
+        return FRESCO_ERROR_CORRUPTED_DATA;
+    }
+    if (checked && verify == FRESCO_VERIFY_ALWAYS) {
+        for (size_t i = 0; i < tile_count; i++) {
+            if (crc32c(0, data + offsets[i], offsets[i + 1] - offsets[i]) !=
+                layout.tile_checksum(i)) {
+                return FRESCO_ERROR_CORRUPTED_DATA;
+            }
+        }
+    }
+    layout.verify_tiles = checked && verify == FRESCO_VERIFY_LAZY;
+    tiles = data;
+    return FRESCO_OK;
+}
+
+} // namespace
+
+namespace {
+
+// Tiling, levels and coder of an encode; the caller sets row_stride
+RasterLayout encode_layout(const ImageInfo& image_info, const fresco_encode_params_t& params) {
+    RasterLayout layout;
+    layout.width = image_info.width;
+    layout.height = image_info.height;
+    layout.channels = image_info.channels;
+    layout.planes = image_info.channels;
+    layout.lossless = params.mode == FRESCO_COMPRESSION_LOSSLESS;
+    layout.color_transform = image_info.channels >= 3;
+    layout.base_step = layout.lossless ? 1.0f : LossyCodec::step_for_quality(params.quality);
+    const EffortPreset& preset = effort_preset(params.effort);
+    layout.max_levels = preset.max_levels;
+    layout.coder = preset.coder;
+    layout.rounding_search = preset.rounding_search;
+    const uint32_t tile = params.tile_size == 0 ? preset.tile_size : params.tile_size;
+    layout.set_tiling(std::min(std::max(tile, kMinTileSize), kMaxTileSize));
+    return layout;
+}
+
+} // namespace
+
 fresco_error_t Compression::compress(const uint8_t* input_data, size_t input_size,
                                     const ImageInfo& image_info,
                                     const fresco_encode_params_t& params,
-                                    std::vector<uint8_t>& compressed_data) {
-    // TODO: Implement actual compression algorithms
-    // For now, just return the input data as-is
-    compressed_data.assign(input_data, input_data + input_size);
+                                    uint64_t byte_budget,
+                                    std::vector<uint8_t>& compressed_data,
+                                    RasterStats& stats) {
+    if (image_info.bit_depth != 8 || image_info.channels < 1 ||
+        image_info.channels > kMaxPlanes || image_info.width == 0 || image_info.height == 0) {
+        return FRESCO_ERROR_UNSUPPORTED_FORMAT;
+    }
+    const size_t pixel_bytes =
+        static_cast<size_t>(image_info.width) * image_info.height * image_info.channels;
+    const size_t row_bytes = static_cast<size_t>(image_info.width) * image_info.channels;
+    const size_t row_stride = image_info.row_stride ? image_info.row_stride : row_bytes;
+    if (row_stride < row_bytes ||
+        input_size < (static_cast<size_t>(image_info.height) - 1) * row_stride + row_bytes) {
+        return FRESCO_ERROR_INVALID_PARAMETER;
+    }
+
+    RasterLayout layout = encode_layout(image_info, params);
+    layout.row_stride = row_stride;
+    const EffortPreset& preset = effort_preset(params.effort);
+
+    // Under a memory budget the compressed tiles and the raster written
+    // from them are planned at the expected size and checked at the real
+    // one; the workers get what is left
+    const size_t tile_count = layout.tile_count();
+    const uint64_t memory_budget = params.max_memory_bytes;
+    const uint64_t per_worker = tile_working_bytes(layout);
+    const uint64_t reserved = 2 * expected_raster_bytes(layout, pixel_bytes, byte_budget) +
+                              tile_count * sizeof(std::vector<uint8_t>);
+    const uint32_t workers = workers_within(memory_budget, reserved, per_worker,
+                                            resolve_thread_count(params.max_threads, tile_count));
+    if (workers == 0) {
+        return FRESCO_ERROR_OUT_OF_MEMORY;
+    }
+    std::vector<std::vector<uint8_t>> tiles(tile_count);
+    std::vector<std::vector<int32_t>> worker_scratch(workers), worker_quantized(workers);
+    std::vector<std::vector<uint32_t>> worker_packed(workers);
+    std::vector<std::vector<uint8_t>> worker_indices(workers), worker_palette(workers);
+    std::vector<std::vector<int32_t>> coefficients;
+    std::vector<uint8_t> best;
+    std::vector<StageTimes> worker_times(workers);
+    Stopwatch watch(stats.times);
+
+    // Worker buffers only grow, so their final size is the peak
+    auto buffer_bytes = [&]() {
+        return capacity_bytes(tiles) + capacity_bytes(worker_scratch) +
+               capacity_bytes(worker_quantized) + capacity_bytes(worker_packed) +
+               capacity_bytes(worker_indices) + capacity_bytes(worker_palette) +
+               capacity_bytes(coefficients) + capacity_bytes(best);
+    };
+    auto finish_stats = [&]() {
+        for (const auto& times : worker_times) {
+            stats.times.merge(times);
+        }
+        stats.threads = workers;
+        stats.peak_scratch_bytes = buffer_bytes();
+    };
+    // Whether writing a raster of raster_bytes stays within the budget
+    auto raster_fits = [&](size_t raster_bytes) {
+        return memory_budget == 0 || buffer_bytes() + raster_bytes <= memory_budget;
+    };
+
+    if (layout.lossless || byte_budget == 0) {
+        coefficients.resize(workers);
+        parallel_for(tile_count, workers, [&](size_t i, uint32_t worker) {
+            Stopwatch tile_watch(worker_times[worker], static_cast<int64_t>(i));
+            code_tile(input_data, 0, layout, i, coefficients[worker], worker_scratch[worker],
+                      worker_quantized[worker], worker_packed[worker], worker_indices[worker],
+                      worker_palette[worker], tiles[i], tile_watch);
+        });
+        stats.tiles = tile_count;
+        watch.skip();
+        if (!raster_fits(raster_size(layout, tiles))) {
+            finish_stats();
+            return FRESCO_ERROR_OUT_OF_MEMORY;
+        }
+        write_raster(layout, tiles, compressed_data);
+        watch.lap(Stage::Container);
+        finish_stats();
+        return FRESCO_OK;
+    }
+
+    // Rate control: transform once, keep the coefficients and price base
+    // steps from their statistics. When every tile's coefficients (4 bytes
+    // a sample) do not fit the budget, each pass transforms the tiles again
+    // into per-worker buffers instead (strip mode).
+    const uint64_t coefficient_bytes = static_cast<uint64_t>(pixel_bytes) * sizeof(int32_t);
+    const bool keep_coefficients =
+        memory_budget == 0 || reserved + coefficient_bytes + workers * per_worker <= memory_budget;
+    coefficients.resize(keep_coefficients ? tile_count : workers);
+    auto tile_coefficients = [&](size_t i, uint32_t worker) -> std::vector<int32_t>& {
+        return coefficients[keep_coefficients ? i : worker];
+    };
+    std::vector<RateModel> worker_models(
+        workers, RateModel(layout.planes, layout.levels, layout.color_transform));
+    auto model_tile = [&](size_t i, uint32_t worker, Stopwatch& tile_watch) {
+        std::vector<int32_t>& tile_data = tile_coefficients(i, worker);
+        forward_tile(input_data, 0, layout, i, tile_data, worker_scratch[worker], tile_watch);
+        uint32_t tx, ty, tw, th;
+        layout.tile_rect(i, tx, ty, tw, th);
+        const size_t plane_size = static_cast<size_t>(tw) * th;
+        for (uint32_t p = 0; p < layout.planes; p++) {
+            worker_models[worker].add_plane(p, &tile_data[p * plane_size], tw, th, tw);
+        }
+        tile_watch.lap(Stage::Quantize);
+    };
+    // Palette tiles do not depend on the step: they are coded once here and
+    // left out of the search
+    std::vector<uint8_t> fixed(tile_count, 0);
+    parallel_for(tile_count, workers, [&](size_t i, uint32_t worker) {
+        Stopwatch tile_watch(worker_times[worker], static_cast<int64_t>(i));
+        std::vector<uint8_t>& palette = worker_palette[worker];
+        if (encode_palette_tile(input_data, 0, layout, i, worker_indices[worker], palette,
+                                tile_watch) &&
+            palette_small(layout, i, palette.size())) {
+            tiles[i].swap(palette);
+            fixed[i] = 1;
+            return;
+        }
+        model_tile(i, worker, tile_watch);
+    });
+    watch.skip();
+
+    const double budget = static_cast<double>(byte_budget);
+    double fixed_bytes = 0.0, fixed_pixels = 0.0;
+    std::vector<size_t> fixed_tiles;
+    for (size_t i = 0; i < tile_count; i++) {
+        if (fixed[i]) {
+            uint32_t tx, ty, tw, th;
+            layout.tile_rect(i, tx, ty, tw, th);
+            fixed_bytes += static_cast<double>(tiles[i].size() + varint_size(tiles[i].size()) + 4);
+            fixed_pixels += static_cast<double>(tw) * th;
+            fixed_tiles.push_back(i);
+        }
+    }
+    if (fixed_bytes >
+        budget * fixed_pixels / (static_cast<double>(layout.width) * layout.height)) {
+        // Dearer than their share of the budget by pixels, which a tight
+        // target could not be met with: code them like the rest
+        parallel_for(fixed_tiles.size(), workers, [&](size_t j, uint32_t worker) {
+            Stopwatch tile_watch(worker_times[worker], static_cast<int64_t>(fixed_tiles[j]));
+            model_tile(fixed_tiles[j], worker, tile_watch);
+        });
+        watch.skip();
+        std::fill(fixed.begin(), fixed.end(), 0);
+        fixed_tiles.clear();
+        fixed_bytes = 0.0;
+    }
+    RateModel model = worker_models[0];
+    for (uint32_t w = 1; w < workers; w++) {
+        model.merge(worker_models[w]);
+    }
+
+    const double overhead =
+        12.0 + fixed_bytes +
+        kTileOverheadBytes * static_cast<double>(tile_count - fixed_tiles.size());
+
+    // The answer stays bracketed between the largest step that overshot
+    // and the smallest one that fit. Each coded pass measures how far the
+    // model is off at its step; inside the bracket the correction is
+    // interpolated between the two ends, outside it the last one is used.
+    // Two passes landing on the same side in a row mean the model is not
+    // converging there, so the next pass bisects the bracket instead.
+    float low = kMinBaseStep, high = kMaxBaseStep;
+    double low_scale = 0.0, high_scale = 0.0, last_scale = 1.0;
+    auto scale_at = [&](float step) {
+        if (low_scale > 0.0 && high_scale > 0.0) {
+            const double t = std::log(step / low) / std::log(high / low);
+            return low_scale + (high_scale - low_scale) * std::min(std::max(t, 0.0), 1.0);
+        }
+        return last_scale;
+    };
+    auto predicted = [&](float step) {
+        return model.estimate_bytes(step) * scale_at(step) + overhead;
+    };
+
+    // One coded pass at layout.base_step; the step search around it is
+    // charged to quantization, the raster assembly to the container
+    auto code_tiles = [&]() {
+        watch.lap(Stage::Quantize);
+        parallel_for(tile_count, workers, [&](size_t i, uint32_t worker) {
+            if (fixed[i]) {
+                return;
+            }
+            Stopwatch tile_watch(worker_times[worker], static_cast<int64_t>(i));
+            std::vector<int32_t>& tile_data = tile_coefficients(i, worker);
+            if (!keep_coefficients) {
+                forward_tile(input_data, 0, layout, i, tile_data, worker_scratch[worker],
+                             tile_watch);
+            }
+            encode_tile(layout, i, tile_data.data(), worker_quantized[worker],
+                        worker_packed[worker], tiles[i], tile_watch);
+        });
+        stats.tiles += tile_count;
+        watch.skip();
+        return raster_size(layout, tiles);
+    };
+
+    bool have_fit = false;
+    int last_side = 0, same_side = 0;    // +1 fit, -1 overshot
+    for (int pass = 0; pass < preset.rate_passes; pass++) {
+        if (same_side >= 2 && low > kMinBaseStep && high < kMaxBaseStep) {
+            layout.base_step = std::sqrt(low * high);
+        } else {
+            float lo = low, hi = high;
+            if (predicted(hi) > budget) {
+                lo = hi;
+            }
+            for (int i = 0; i < 32 && hi / lo > 1.001f; i++) {
+                const float mid = std::sqrt(lo * hi);
+                if (predicted(mid) <= budget) {
+                    hi = mid;
+                } else {
+                    lo = mid;
+                }
+            }
+            layout.base_step = hi;
+        }
+
+        const size_t actual = code_tiles();
+        const double estimate = model.estimate_bytes(layout.base_step);
+        if (estimate > 0.0 && actual > overhead) {
+            last_scale = (static_cast<double>(actual) - overhead) / estimate;
+        }
+        const int side = actual <= budget ? 1 : -1;
+        same_side = side == last_side ? same_side + 1 : 1;
+        last_side = side;
+        if (actual <= budget) {
+            if (!have_fit || actual > best.size()) {
+                if (!raster_fits(actual)) {
+                    finish_stats();
+                    return FRESCO_ERROR_OUT_OF_MEMORY;
+                }
+                watch.lap(Stage::Quantize);
+                write_raster(layout, tiles, best);
+                watch.lap(Stage::Container);
+            }
+            have_fit = true;
+            high = layout.base_step;
+            high_scale = last_scale;
+            if (actual >= budget * kRateTolerance) {
+                break;
+            }
+        } else {
+            low = layout.base_step;
+            low_scale = last_scale;
+            if (layout.base_step >= kMaxBaseStep) {
+                break;
+            }
+        }
+        if (high / low <= 1.001f) {
+            break;
+        }
+    }
+
+    if (!have_fit) {
+        // The model never got below the budget; walk the step up from the
+        // last overshoot
+        for (float step = low * 1.25f; step <= kMaxBaseStep * 1.25f && !have_fit; step *= 1.25f) {
+            layout.base_step = std::min(step, kMaxBaseStep);
+            const size_t actual = code_tiles();
+            if (actual <= budget) {
+                if (!raster_fits(actual)) {
+                    finish_stats();
+                    return FRESCO_ERROR_OUT_OF_MEMORY;
+                }
+                write_raster(layout, tiles, best);
+                watch.lap(Stage::Container);
+                have_fit = true;
+            }
+        }
+        if (!have_fit) {
+            finish_stats();
+            return FRESCO_ERROR_ENCODING_FAILED;
+        }
+    }
+    watch.lap(Stage::Quantize);
+    finish_stats();
+    compressed_data = std::move(best);
+    return FRESCO_OK;
+}
+
+fresco_error_t Compression::compress_rows(TileRowSource& source, const ImageInfo& image_info,
+                                         const fresco_encode_params_t& params,
+                                         std::vector<uint8_t>& compressed_data,
+                                         RasterStats& stats) {
+    if (image_info.bit_depth != 8 || image_info.channels < 1 ||
+        image_info.channels > kMaxPlanes || image_info.width == 0 || image_info.height == 0) {
+        return FRESCO_ERROR_UNSUPPORTED_FORMAT;
+    }
+    const size_t pixel_bytes =
+        static_cast<size_t>(image_info.width) * image_info.height * image_info.channels;
+    const size_t row_bytes = static_cast<size_t>(image_info.width) * image_info.channels;
+    RasterLayout layout = encode_layout(image_info, params);
+    layout.row_stride = row_bytes;
+
+    // Same plan as the unbudgeted path of compress, plus the band of rows
+    // the source holds for one row of tiles
+    const size_t tile_count = layout.tile_count();
+    const uint64_t memory_budget = params.max_memory_bytes;
+    const uint64_t per_worker = tile_working_bytes(layout);
+    const uint64_t band_bytes = static_cast<uint64_t>(layout.tile_size) * row_bytes;
+    const uint64_t reserved = 2 * expected_raster_bytes(layout, pixel_bytes, 0) + band_bytes +
+                              tile_count * sizeof(std::vector<uint8_t>);
+    const uint32_t workers =
+        workers_within(memory_budget, reserved, per_worker,
+                       resolve_thread_count(params.max_threads, layout.tiles_x));
+    if (workers == 0) {
+        return FRESCO_ERROR_OUT_OF_MEMORY;
+    }
+    std::vector<std::vector<uint8_t>> tiles(tile_count);
+    std::vector<std::vector<int32_t>> coefficients(workers), worker_scratch(workers),
+        worker_quantized(workers);
+    std::vector<std::vector<uint32_t>> worker_packed(workers);
+    std::vector<std::vector<uint8_t>> worker_indices(workers), worker_palette(workers);
+    std::vector<StageTimes> worker_times(workers);
+    Stopwatch watch(stats.times);
+
+    auto finish_stats = [&]() {
+        for (const auto& times : worker_times) {
+            stats.times.merge(times);
+        }
+        stats.threads = workers;
+        stats.peak_scratch_bytes = capacity_bytes(tiles) + capacity_bytes(coefficients) +
+                                   capacity_bytes(worker_scratch) +
+                                   capacity_bytes(worker_quantized) +
+                                   capacity_bytes(worker_packed) +
+                                   capacity_bytes(worker_indices) +
+                                   capacity_bytes(worker_palette) + band_bytes;
+    };
+
+    for (uint32_t row = 0; row < layout.tiles_y; row++) {
+        const uint32_t first = row * layout.tile_size;
+        const uint32_t count = std::min(layout.tile_size, layout.height - first);
+        const uint8_t* rows = nullptr;
+        size_t row_stride = 0;
+        fresco_error_t result = source.read_rows(first, count, rows, row_stride);
+        if (result != FRESCO_OK) {
+            finish_stats();
+            return result;
+        }
+        if (rows == nullptr || row_stride < row_bytes) {
+            finish_stats();
+            return FRESCO_ERROR_INVALID_PARAMETER;
+        }
+        watch.lap(Stage::Parse);
+        layout.row_stride = row_stride;
+        const size_t row_tiles = static_cast<size_t>(row) * layout.tiles_x;
+        parallel_for(layout.tiles_x, workers, [&](size_t x, uint32_t worker) {
+            const size_t i = row_tiles + x;
+            Stopwatch tile_watch(worker_times[worker], static_cast<int64_t>(i));
+            code_tile(rows, first, layout, i, coefficients[worker], worker_scratch[worker],
+                      worker_quantized[worker], worker_packed[worker], worker_indices[worker],
+                      worker_palette[worker], tiles[i], tile_watch);
+        });
+        watch.skip();
+    }
+    stats.tiles = tile_count;
+    if (memory_budget != 0 &&
+        capacity_bytes(tiles) + capacity_bytes(coefficients) + capacity_bytes(worker_scratch) +
+                capacity_bytes(worker_quantized) + capacity_bytes(worker_packed) +
+                capacity_bytes(worker_indices) + capacity_bytes(worker_palette) +
+                raster_size(layout, tiles) >
+            memory_budget) {
+        finish_stats();
+        return FRESCO_ERROR_OUT_OF_MEMORY;
+    }
+    write_raster(layout, tiles, compressed_data);
+    watch.lap(Stage::Container);
+    finish_stats();
     return FRESCO_OK;
 }
 
-fresco_error_t Compression::decompress(const std::vector<uint8_t>& compressed_data,
+fresco_error_t Compression::decompress(const uint8_t* compressed_data, size_t compressed_size,
                                       const ContainerInfo& container_info,
                                       const fresco_decode_params_t& params,
-                                      std::vector<uint8_t>& decompressed_data) {
-    // TODO: Implement actual decompression algorithms
-    // For now, just return the compressed data as-is
-    decompressed_data = compressed_data;
+                                      uint8_t* pixels,
+                                      size_t row_stride,
+                                      RasterStats& stats) const {
+    RasterLayout layout;
+    std::vector<size_t> offsets;
+    const uint8_t* data = nullptr;
+    fresco_error_t result = read_raster(compressed_data, compressed_size, container_info,
+                                        row_stride, params.verify, layout, offsets, data);
+    if (result != FRESCO_OK) {
+        return result;
+    }
+
+    // The caller's pixels and the tile index come first, the workers get
+    // what is left of the budget
+    const size_t tile_count = layout.tile_count();
+    const uint64_t pixel_bytes =
+        static_cast<uint64_t>(layout.width) * layout.height * layout.channels;
+    const uint64_t index_bytes = (tile_count + 1) * sizeof(size_t) + tile_count;
+    const uint32_t workers =
+        workers_within(params.max_memory_bytes, pixel_bytes + index_bytes,
+                       tile_working_bytes(layout),
+                       resolve_thread_count(params.max_threads, tile_count));
+    if (workers == 0) {
+        return FRESCO_ERROR_OUT_OF_MEMORY;
+    }
+
+    // A worker runs on one thread from start to end, so it can keep that
+    // thread's scratch for all of its tiles. Threads started for this call
+    // take their scratch with them, hence the sizes are noted as they go.
+    std::vector<TileScratch*> worker_scratch(workers, nullptr);
+    std::vector<uint64_t> worker_scratch_bytes(workers, 0);
+    std::vector<StageTimes> worker_times(workers);
+    std::vector<uint8_t> failed(tile_count, 0);
+    parallel_for(tile_count, workers, [&](size_t i, uint32_t worker) {
+        Stopwatch tile_watch(worker_times[worker], static_cast<int64_t>(i));
+        TileScratch*& scratch = worker_scratch[worker];
+        if (!scratch) {
+            scratch = &thread_tile_scratch();
+        }
+        uint32_t tx, ty, tw, th;
+        layout.tile_rect(i, tx, ty, tw, th);
+        failed[i] = !decode_tile(layout, i, data + offsets[i], offsets[i + 1] - offsets[i], 0,
+                                 *scratch, pixels + ty * layout.row_stride + tx * layout.channels,
+                                 layout.row_stride, tile_watch);
+        worker_scratch_bytes[worker] = scratch->bytes();
+    });
+    for (const auto& times : worker_times) {
+        stats.times.merge(times);
+    }
+    stats.tiles = tile_count;
+    stats.threads = workers;
+    stats.peak_scratch_bytes = capacity_bytes(offsets);
+    for (uint64_t bytes : worker_scratch_bytes) {
+        stats.peak_scratch_bytes += bytes;
+    }
+    if (std::find(failed.begin(), failed.end(), 1) != failed.end()) {
+        return FRESCO_ERROR_CORRUPTED_DATA;
+    }
+    return FRESCO_OK;
+}
+
+fresco_error_t Compression::decompress_region(const uint8_t* compressed_data,
+                                             size_t compressed_size,
+                                             const ContainerInfo& container_info,
+                                             const fresco_decode_params_t& params,
+                                             const fresco_region_t& region,
+                                             uint8_t* pixels,
+                                             size_t row_stride,
+                                             TileCache* cache,
+                                             RasterStats& stats) const {
+    RasterLayout layout;
+    std::vector<size_t> offsets;
+    const uint8_t* data = nullptr;
+    fresco_error_t result = read_raster(compressed_data, compressed_size, container_info, 0,
+                                        params.verify, layout, offsets, data);
+    if (result != FRESCO_OK) {
+        return result;
+    }
+    const uint32_t level = region.level;
+    if (level > supported_levels(layout)) {
+        return FRESCO_ERROR_UNSUPPORTED_FORMAT;
+    }
+    const uint32_t channels = layout.channels;
+    const size_t region_row_bytes = static_cast<size_t>(region.width) * channels;
+    if (row_stride == 0) {
+        row_stride = region_row_bytes;
+    }
+
+    const uint32_t level_tile = layout.tile_size >> level;
+    std::vector<size_t> tiles;
+    for (uint32_t y = region.y / level_tile; y <= (region.y + region.height - 1) / level_tile;
+         y++) {
+        for (uint32_t x = region.x / level_tile; x <= (region.x + region.width - 1) / level_tile;
+             x++) {
+            tiles.push_back(static_cast<size_t>(y) * layout.tiles_x + x);
+        }
+    }
+
+    // Header and index tell files apart, and the checksum of each tile's
+    // bytes guards against two that only differ in a tile's contents. The
+    // index holds those checksums when the track has them.
+    uint64_t file = 0;
+    if (cache) {
+        file = hash_bytes(compressed_data, static_cast<size_t>(data - compressed_data),
+                          (static_cast<uint64_t>(layout.width) << 32 | layout.height) ^
+                              (static_cast<uint64_t>(channels) << 60));
+    }
+
+    const uint64_t region_bytes = static_cast<uint64_t>(region.height) * region_row_bytes;
+    const uint64_t index_bytes = (layout.tile_count() + 1) * sizeof(size_t) + tiles.size();
+    const uint64_t tile_pixel_bytes =
+        static_cast<uint64_t>(level_tile) * level_tile * channels;
+    const uint32_t workers =
+        workers_within(params.max_memory_bytes, region_bytes + index_bytes,
+                       tile_working_bytes(layout) + tile_pixel_bytes,
+                       resolve_thread_count(params.max_threads, tiles.size()));
+    if (workers == 0) {
+        return FRESCO_ERROR_OUT_OF_MEMORY;
+    }
+
+    std::vector<TileScratch*> worker_scratch(workers, nullptr);
+    std::vector<uint64_t> worker_scratch_bytes(workers, 0);
+    std::vector<uint64_t> worker_hits(workers, 0);
+    std::vector<StageTimes> worker_times(workers);
+    std::vector<uint8_t> failed(tiles.size(), 0);
+    parallel_for(tiles.size(), workers, [&](size_t i, uint32_t worker) {
+        const size_t tile = tiles[i];
+        Stopwatch tile_watch(worker_times[worker], static_cast<int64_t>(tile));
+        TileScratch*& scratch = worker_scratch[worker];
+        if (!scratch) {
+            scratch = &thread_tile_scratch();
+        }
+
+        // The tile at the region's level, and the part of it to copy
+        uint32_t tx, ty, tw, th;
+        layout.tile_rect(tile, tx, ty, tw, th);
+        const uint32_t left = tx >> level;
+        const uint32_t top = ty >> level;
+        const uint32_t width = (tw + (1u << level) - 1) >> level;
+        const uint32_t height = (th + (1u << level) - 1) >> level;
+        const uint32_t x0 = std::max(left, region.x);
+        const uint32_t x1 = std::min(left + width, region.x + region.width);
+        const uint32_t y0 = std::max(top, region.y);
+        const uint32_t y1 = std::min(top + height, region.y + region.height);
+        const uint8_t* tile_data = data + offsets[tile];
+        const size_t tile_size = offsets[tile + 1] - offsets[tile];
+        const size_t tile_stride = static_cast<size_t>(width) * channels;
+
+        if (!cache && x0 == left && x1 == left + width && y0 == top && y1 == top + height) {
+            // Wholly inside and nowhere to keep it: straight into the output
+            failed[i] = !decode_tile(layout, tile, tile_data, tile_size, level, *scratch,
+                                     pixels + (y0 - region.y) * row_stride +
+                                         static_cast<size_t>(x0 - region.x) * channels,
+                                     row_stride, tile_watch);
+            worker_scratch_bytes[worker] = scratch->bytes();
+            return;
+        }
+
+        const TileCache::Key key{file, static_cast<uint32_t>(tile), level};
+        uint64_t checksum = 0;
+        TileCache::Pixels cached;
+        if (cache) {
+            checksum = layout.checksums ? layout.tile_checksum(tile)
+                                        : hash_bytes(tile_data, tile_size);
+            cached = cache->find(key, checksum);
+        }
+        const uint8_t* source = nullptr;
+        if (cached) {
+            worker_hits[worker]++;
+            source = cached->data();
+        } else {
+            std::shared_ptr<std::vector<uint8_t>> decoded;
+            uint8_t* target = nullptr;
+            if (cache) {
+                decoded = std::make_shared<std::vector<uint8_t>>(tile_stride * height);
+                target = decoded->data();
+            } else {
+                scratch->pixels.resize(tile_stride * height);
+                target = scratch->pixels.data();
+            }
+            if (!decode_tile(layout, tile, tile_data, tile_size, level, *scratch, target,
+                             tile_stride, tile_watch)) {
+                failed[i] = 1;
+                return;
+            }
+            if (cache) {
+                cache->insert(key, checksum, decoded);
+            }
+            source = target;
+        }
+        for (uint32_t y = y0; y < y1; y++) {
+            std::memcpy(pixels + (y - region.y) * row_stride +
+                            static_cast<size_t>(x0 - region.x) * channels,
+                        source + (y - top) * tile_stride + static_cast<size_t>(x0 - left) * channels,
+                        static_cast<size_t>(x1 - x0) * channels);
+        }
+        tile_watch.lap(Stage::Container);
+        worker_scratch_bytes[worker] = scratch->bytes();
+    });
+    for (const auto& times : worker_times) {
+        stats.times.merge(times);
+    }
+    for (uint64_t hits : worker_hits) {
+        stats.tile_cache_hits += hits;
+    }
+    stats.tiles = tiles.size() - stats.tile_cache_hits;
+    stats.threads = workers;
+    stats.peak_scratch_bytes = capacity_bytes(offsets) + capacity_bytes(tiles);
+    for (uint64_t bytes : worker_scratch_bytes) {
+        stats.peak_scratch_bytes += bytes;
+    }
+    if (std::find(failed.begin(), failed.end(), 1) != failed.end()) {
+        return FRESCO_ERROR_CORRUPTED_DATA;
+    }
     return FRESCO_OK;
 }
 
+fresco_error_t Compression::native_levels(const uint8_t* compressed_data,
+                                         size_t compressed_size,
+                                         const ContainerInfo& container_info,
+                                         uint32_t& levels, uint32_t& tile_size) const {
+    RasterLayout layout;
+    std::vector<size_t> offsets;
+    const uint8_t* data = nullptr;
+    // Only the header is needed; the decode that follows checks the rest
+    fresco_error_t result = read_raster(compressed_data, compressed_size, container_info, 0,
+                                        FRESCO_VERIFY_SKIP, layout, offsets, data);
+    if (result != FRESCO_OK) {
+        return result;
+    }
+    levels = supported_levels(layout);
+    tile_size = layout.tile_size;
+    return FRESCO_OK;
+}
+
+fresco_error_t Compression::decompress_levels(const uint8_t* compressed_data,
+                                             size_t compressed_size,
+                                             const ContainerInfo& container_info,
+                                             const fresco_decode_params_t& params,
+                                             uint32_t max_level,
+                                             TileRowSink& sink,
+                                             RasterStats& stats) const {
+    RasterLayout layout;
+    std::vector<size_t> offsets;
+    const uint8_t* data = nullptr;
+    fresco_error_t result = read_raster(compressed_data, compressed_size, container_info, 0,
+                                        params.verify, layout, offsets, data);
+    if (result != FRESCO_OK) {
+        return result;
+    }
+    if (max_level > supported_levels(layout)) {
+        return FRESCO_ERROR_UNSUPPORTED_FORMAT;
+    }
+
+    const uint64_t index_bytes = (layout.tile_count() + 1) * sizeof(size_t) + layout.tiles_x;
+    const uint32_t workers =
+        workers_within(params.max_memory_bytes, index_bytes, tile_working_bytes(layout),
+                       resolve_thread_count(params.max_threads, layout.tiles_x));
+    if (workers == 0) {
+        return FRESCO_ERROR_OUT_OF_MEMORY;
+    }
+
+    std::vector<uint64_t> worker_scratch_bytes(workers, 0);
+    std::vector<StageTimes> worker_times(workers);
+    std::vector<uint8_t> failed(layout.tiles_x, 0);
+    for (uint32_t row = 0; row < layout.tiles_y && result == FRESCO_OK; row++) {
+        result = sink.begin_row(row);
+        if (result != FRESCO_OK) {
+            break;
+        }
+        // Each row is a parallel_for of its own, and without a pool its
+        // threads exit with their scratch at the end of the row, so the
+        // scratch a worker keeps lasts one row only
+        std::vector<TileScratch*> worker_scratch(workers, nullptr);
+        parallel_for(layout.tiles_x, workers, [&](size_t column, uint32_t worker) {
+            const size_t tile = static_cast<size_t>(row) * layout.tiles_x + column;
+            Stopwatch tile_watch(worker_times[worker], static_cast<int64_t>(tile));
+            TileScratch*& scratch = worker_scratch[worker];
+            if (!scratch) {
+                scratch = &thread_tile_scratch();
+            }
+            const uint8_t* tile_data = data + offsets[tile];
+            const size_t tile_size = offsets[tile + 1] - offsets[tile];
+            uint32_t tx, ty, tw, th;
+            layout.tile_rect(tile, tx, ty, tw, th);
+            if (max_level == 0 && palette_tile(layout, tile_data, tile_size)) {
+                size_t out_stride = 0;
+                uint8_t* out = sink.tile_pixels(0, tx, ty, out_stride);
+                failed[column] = !write_palette_tile(layout, tile, tile_data, tile_size, *scratch,
+                                                     out, out_stride, tile_watch);
+                worker_scratch_bytes[worker] = scratch->bytes();
+                return;
+            }
+            if (!read_tile(layout, tile, tile_data, tile_size, 0, *scratch, tile_watch)) {
+                failed[column] = 1;
+                return;
+            }
+            const size_t plane_size = static_cast<size_t>(tw) * th;
+            scratch->scratch.resize(tw);
+            // One level of the inverse transform at a time, each level
+            // written out on the way
+            for (uint32_t level = max_level + 1; level-- > 0;) {
+                const uint32_t from = level == max_level ? layout.levels : level + 1;
+                for (uint32_t p = 0; p < layout.planes; p++) {
+                    dwt53_inverse(&scratch->planes[p * plane_size], tw, th, tw, from, level,
+                                  scratch->scratch.data());
+                }
+                tile_watch.lap(Stage::Transform);
+                size_t out_stride = 0;
+                uint8_t* out = sink.tile_pixels(level, tx >> level, ty >> level, out_stride);
+                write_tile(layout, tile, level, scratch->planes, out, out_stride, tile_watch);
+            }
+            worker_scratch_bytes[worker] = scratch->bytes();
+        });
+        if (std::find(failed.begin(), failed.end(), 1) != failed.end()) {
+            result = FRESCO_ERROR_CORRUPTED_DATA;
+            break;
+        }
+        result = sink.end_row(row);
+    }
+    for (const auto& times : worker_times) {
+        stats.times.merge(times);
+    }
+    stats.tiles = layout.tile_count();
+    stats.threads = workers;
+    stats.peak_scratch_bytes = capacity_bytes(offsets);
+    for (uint64_t bytes : worker_scratch_bytes) {
+        stats.peak_scratch_bytes += bytes;
+    }
+    return result;
+}
+
 } // namespace fresco
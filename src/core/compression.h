@@ -10,16 +10,73 @@
 #define FRESCO_COMPRESSION_H
 
 #include "fresco/fresco.h"
+#include "stats.h"
 #include <vector>
 
 namespace fresco {
 
+class TileCache;
+
+// Receives the tiles of decompress_levels one row of tiles at a time
+class TileRowSink {
+public:
+    virtual ~TileRowSink() = default;
+
+    // Before the tiles of a row are decoded, on the calling thread
+    virtual fresco_error_t begin_row(uint32_t row) = 0;
+
+    // Where the tile at (x, y) of the image at 1 / 2^level, in the pixels of
+    // that level, is written; rows are row_stride bytes apart. Called from
+    // worker threads, each for a different tile.
+    virtual uint8_t* tile_pixels(uint32_t level, uint32_t x, uint32_t y, size_t& row_stride) = 0;
+
+    // After all tiles of the row are written at every level, on the calling
+    // thread; an error ends the decode
+    virtual fresco_error_t end_row(uint32_t row) = 0;
+};
+
+// Gives compress_rows its input a band of rows at a time, for inputs that
+// are decoded while they are encoded
+class TileRowSource {
+public:
+    virtual ~TileRowSource() = default;
+
+    // Rows [first, first + count) of the image, rows row_stride bytes
+    // apart. Bands are asked for in order from the top, on the calling
+    // thread, and stay valid until the next call.
+    virtual fresco_error_t read_rows(uint32_t first, uint32_t count, const uint8_t*& rows,
+                                     size_t& row_stride) = 0;
+};
+
+constexpr uint32_t make_fourcc(char a, char b, char c, char d) {
+    return (static_cast<uint32_t>(static_cast<uint8_t>(a)) << 24) |
+           (static_cast<uint32_t>(static_cast<uint8_t>(b)) << 16) |
+           (static_cast<uint32_t>(static_cast<uint8_t>(c)) << 8) |
+           static_cast<uint32_t>(static_cast<uint8_t>(d));
+}
+
+enum class TrackType : uint32_t {
+    Raster = make_fourcc('r', 'a', 's', 't'),
+    Vector = make_fourcc('v', 'e', 'c', 't'),
+    Mesh = make_fourcc('m', 'e', 's', 'h'),
+    Jpeg = make_fourcc('j', 'p', 'e', 'g')    // A JPEG file recompressed in place of a raster
+};
+
+struct TrackInfo {
+    TrackType type;
+    uint64_t offset;   // Absolute file offset of the track payload
+    uint64_t size;
+    bool has_checksum = false;
+    uint32_t checksum = 0;    // CRC-32C of the payload
+};
+
 struct ImageInfo {
     uint32_t width;
     uint32_t height;
     uint8_t channels;
     uint8_t bit_depth;
     fresco_colorspace_t colorspace;
+    size_t row_stride = 0;  // Bytes from one input row to the next, 0 when packed
 };
 
 struct ContainerInfo {
@@ -31,22 +88,85 @@ struct ContainerInfo {
     uint32_t frame_count;
     float frame_rate;
     uint64_t compressed_size;
+    std::vector<TrackInfo> tracks;
+
+    const TrackInfo* find_track(TrackType type) const {
+        for (const auto& track : tracks) {
+            if (track.type == type) {
+                return &track;
+            }
+        }
+        return nullptr;
+    }
 };
 
+// Codes the raster track: tiles of a reversible 5/3 wavelet, quantized in
+// lossy mode and range coded per tile
 class Compression {
 public:
     Compression() = default;
     ~Compression() = default;
 
+    // A non-zero byte_budget caps the size of the compressed data in lossy
+    // mode; the quantizer is then chosen by rate control instead of quality.
+    // A non-zero params.max_memory_bytes limits the worker count and, under
+    // rate control, switches from keeping every tile's coefficients to
+    // transforming tiles again on each pass. Stage times are added to
+    // stats, which is otherwise overwritten.
     fresco_error_t compress(const uint8_t* input_data, size_t input_size,
                            const ImageInfo& image_info,
                            const fresco_encode_params_t& params,
-                           std::vector<uint8_t>& compressed_data);
+                           uint64_t byte_budget,
+                           std::vector<uint8_t>& compressed_data,
+                           RasterStats& stats);
+
+    // As compress without a byte budget, with the input read from source a
+    // row of tiles at a time: each band is encoded before the next is read,
+    // so the whole image is never held
+    fresco_error_t compress_rows(TileRowSource& source, const ImageInfo& image_info,
+                                const fresco_encode_params_t& params,
+                                std::vector<uint8_t>& compressed_data, RasterStats& stats);
 
-    fresco_error_t decompress(const std::vector<uint8_t>& compressed_data,
+    // Decodes the raster track payload straight into pixels, whose rows are
+    // row_stride bytes apart (0 when packed). The packed image counts against
+    // params.max_memory_bytes, and the worker count is cut to what fits
+    // beside them.
+    fresco_error_t decompress(const uint8_t* data, size_t size,
                              const ContainerInfo& container_info,
                              const fresco_decode_params_t& params,
-                             std::vector<uint8_t>& decompressed_data);
+                             uint8_t* pixels,
+                             size_t row_stride,
+                             RasterStats& stats) const;
+
+    // Decodes only the tiles that overlap region, inverting the wavelet down
+    // to its level, into pixels whose rows are row_stride bytes apart (0 when
+    // packed). The region must lie inside its level. Tiles are taken from
+    // cache when it holds them and kept there after decoding; stats.tiles
+    // counts the tiles decoded.
+    fresco_error_t decompress_region(const uint8_t* data, size_t size,
+                                    const ContainerInfo& container_info,
+                                    const fresco_decode_params_t& params,
+                                    const fresco_region_t& region,
+                                    uint8_t* pixels,
+                                    size_t row_stride,
+                                    TileCache* cache,
+                                    RasterStats& stats) const;
+
+    // Deepest level decompress_region and decompress_levels can decode: the
+    // wavelet depth, less where the tile size does not halve that often
+    fresco_error_t native_levels(const uint8_t* data, size_t size,
+                                const ContainerInfo& container_info, uint32_t& levels,
+                                uint32_t& tile_size) const;
+
+    // Decodes every tile once, a row of tiles at a time, and writes it at
+    // each level from max_level down to 0 where sink says, taking each
+    // level from the inverse wavelet transform on its way to full size
+    fresco_error_t decompress_levels(const uint8_t* data, size_t size,
+                                    const ContainerInfo& container_info,
+                                    const fresco_decode_params_t& params,
+                                    uint32_t max_level,
+                                    TileRowSink& sink,
+                                    RasterStats& stats) const;
 };
 
 } // namespace fresco
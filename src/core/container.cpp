@@ -8,51 +8,449 @@
 
 #include "fresco/fresco.h"
 #include "container.h"
+#include "checksum.h"
+#include <algorithm>
 #include <vector>
 #include <cstring>
 
 namespace fresco {
 
+namespace {
+
+constexpr uint32_t kBoxFtyp = make_fourcc('f', 't', 'y', 'p');
+constexpr uint32_t kBoxMoov = make_fourcc('m', 'o', 'o', 'v');
+constexpr uint32_t kBoxMvhd = make_fourcc('m', 'v', 'h', 'd');
+constexpr uint32_t kBoxTrak = make_fourcc('t', 'r', 'a', 'k');
+constexpr uint32_t kBoxTkhd = make_fourcc('t', 'k', 'h', 'd');
+constexpr uint32_t kBoxMdat = make_fourcc('m', 'd', 'a', 't');
+// Last in moov: the CRC-32C of the moov payload before it
+constexpr uint32_t kBoxCrcc = make_fourcc('c', 'r', 'c', 'c');
+
+constexpr uint32_t kBrandFresco = make_fourcc('f', 'r', 'e', 's');
+constexpr uint32_t kBrandIsom = make_fourcc('i', 's', 'o', 'm');
+constexpr uint32_t kBrandMif1 = make_fourcc('m', 'i', 'f', '1');
+constexpr uint32_t kMinorVersion = 0x00010000;
+
+constexpr size_t kBoxHeaderSize = 8;
+constexpr size_t kFtypSize = kBoxHeaderSize + 20;
+constexpr size_t kMvhdSize = kBoxHeaderSize + 24;
+// Files before track checksums have 28-byte tkhd payloads
+constexpr size_t kTkhdSize = kBoxHeaderSize + 32;
+constexpr size_t kTkhdSizeV0 = kBoxHeaderSize + 28;
+constexpr size_t kTrakSize = kBoxHeaderSize + kTkhdSize;
+constexpr size_t kCrccSize = kBoxHeaderSize + 4;
+// tkhd flag: the payload CRC-32C follows the track size. Raster tracks
+// check their own index and tiles instead.
+constexpr uint32_t kTkhdFlagChecksum = 0x000001;
+
+// probe() reads this much up front, which holds ftyp and moov of files
+// with a few tracks; a moov box beyond this size is taken as corrupt
+constexpr uint64_t kProbeReadSize = 4096;
+constexpr uint64_t kMaxMoovSize = 16u << 20;
+
+void put_u8(std::vector<uint8_t>& out, uint8_t value) {
+    out.push_back(value);
+}
+
+void put_u32(std::vector<uint8_t>& out, uint32_t value) {
+    for (int shift = 24; shift >= 0; shift -= 8) {
+        out.push_back(static_cast<uint8_t>(value >> shift));
+    }
+}
+
+void put_u64(std::vector<uint8_t>& out, uint64_t value) {
+    put_u32(out, static_cast<uint32_t>(value >> 32));
+    put_u32(out, static_cast<uint32_t>(value));
+}
+
+uint32_t get_u32(const uint8_t* p) {
+    return (static_cast<uint32_t>(p[0]) << 24) | (static_cast<uint32_t>(p[1]) << 16) |
+           (static_cast<uint32_t>(p[2]) << 8) | static_cast<uint32_t>(p[3]);
+}
+
+uint64_t get_u64(const uint8_t* p) {
+    return (static_cast<uint64_t>(get_u32(p)) << 32) | get_u32(p + 4);
+}
+
+struct Box {
+    uint32_t type;
+    const uint8_t* data;   // Payload, past the header
+    uint64_t size;         // Payload size
+};
+
+// Decodes the box header at p from the available bytes; remaining is what
+// is left of the enclosing data from p on. Returns false on a malformed
+// header.
+bool read_box_header(const uint8_t* p, uint64_t available, uint64_t remaining, uint32_t& type,
+                     uint64_t& box_size, uint64_t& header_size) {
+    if (available < kBoxHeaderSize) {
+        return false;
+    }
+    box_size = get_u32(p);
+    type = get_u32(p + 4);
+    header_size = kBoxHeaderSize;
+    if (box_size == 1) {
+        if (available < 16) {
+            return false;
+        }
+        box_size = get_u64(p + 8);
+        header_size = 16;
+    } else if (box_size == 0) {
+        box_size = remaining;
+    }
+    return box_size >= header_size && box_size <= remaining;
+}
+
+// Reads the box at data[offset]; returns false on a malformed header
+bool read_box(const uint8_t* data, uint64_t size, uint64_t offset, Box& box, uint64_t& next) {
+    uint64_t box_size, header_size;
+    if (!read_box_header(data + offset, size - offset, size - offset, box.type, box_size,
+                         header_size)) {
+        return false;
+    }
+    box.data = data + offset + header_size;
+    box.size = box_size - header_size;
+    next = offset + box_size;
+    return true;
+}
+
+fresco_error_t parse_moov(const Box& moov, fresco_verify_t verify, ContainerInfo& container_info,
+                          bool& have_mvhd) {
+    uint64_t offset = 0;
+    while (offset < moov.size) {
+        Box box;
+        uint64_t next;
+        if (!read_box(moov.data, moov.size, offset, box, next)) {
+            return FRESCO_ERROR_CORRUPTED_DATA;
+        }
+
+        if (box.type == kBoxMvhd) {
+            if (box.size < kMvhdSize - kBoxHeaderSize) {
+                return FRESCO_ERROR_CORRUPTED_DATA;
+            }
+            const uint8_t* p = box.data + 4; // version and flags
+            container_info.width = get_u32(p);
+            container_info.height = get_u32(p + 4);
+            container_info.channels = p[8];
+            container_info.bit_depth = p[9];
+            container_info.colorspace = static_cast<fresco_colorspace_t>(p[10]);
+            container_info.frame_count = get_u32(p + 12);
+            uint32_t frame_rate_bits = get_u32(p + 16);
+            std::memcpy(&container_info.frame_rate, &frame_rate_bits, sizeof(float));
+            have_mvhd = true;
+        } else if (box.type == kBoxTrak) {
+            Box tkhd;
+            uint64_t tkhd_next;
+            if (!read_box(box.data, box.size, 0, tkhd, tkhd_next) || tkhd.type != kBoxTkhd ||
+                tkhd.size < kTkhdSizeV0 - kBoxHeaderSize) {
+                return FRESCO_ERROR_CORRUPTED_DATA;
+            }
+            const uint32_t flags = get_u32(tkhd.data) & 0xFFFFFF;
+            const uint8_t* p = tkhd.data + 8; // version/flags, track id
+            TrackInfo track;
+            track.type = static_cast<TrackType>(get_u32(p));
+            track.offset = get_u64(p + 4);
+            track.size = get_u64(p + 12);
+            if (flags & kTkhdFlagChecksum) {
+                if (tkhd.size < kTkhdSize - kBoxHeaderSize) {
+                    return FRESCO_ERROR_CORRUPTED_DATA;
+                }
+                track.has_checksum = true;
+                track.checksum = get_u32(p + 20);
+            }
+            container_info.tracks.push_back(track);
+        } else if (box.type == kBoxCrcc && verify != FRESCO_VERIFY_SKIP) {
+            if (box.size < kCrccSize - kBoxHeaderSize ||
+                crc32c(0, moov.data, static_cast<size_t>(offset)) != get_u32(box.data)) {
+                return FRESCO_ERROR_CORRUPTED_DATA;
+            }
+        }
+        // Unknown boxes are skipped for forward compatibility
+
+        offset = next;
+    }
+    return FRESCO_OK;
+}
+
+} // namespace
+
 fresco_error_t Container::initialize(const ImageInfo& image_info,
                                    const fresco_encode_params_t& params) {
-    // TODO: Initialize container with image info
+    (void)params;
+    image_info_ = image_info;
+    tracks_.clear();
     return FRESCO_OK;
 }
 
+fresco_error_t Container::add_track(TrackType type, std::vector<uint8_t> data) {
+    if (type == TrackType::Raster) {
+        return FRESCO_ERROR_INVALID_PARAMETER;
+    }
+    tracks_.push_back({type, std::move(data)});
+    return FRESCO_OK;
+}
+
+uint64_t Container::size_without_raster() const {
+    uint64_t payload_size = 0;
+    for (const auto& track : tracks_) {
+        payload_size += track.data.size();
+    }
+    // The raster track adds one trak box; assumes the compact mdat header
+    // of payloads below 4 GiB
+    const uint64_t moov_size =
+        kBoxHeaderSize + kMvhdSize + (tracks_.size() + 1) * kTrakSize + kCrccSize;
+    return kFtypSize + moov_size + kBoxHeaderSize + payload_size;
+}
+
 fresco_error_t Container::finalize(const std::vector<uint8_t>& compressed_data,
                                   std::vector<uint8_t>& container_data) {
-    // TODO: Create final container with proper ISOBMFF structure
-    // For now, just return the compressed data
-    container_data = compressed_data;
+    struct TrackRef {
+        TrackType type;
+        const std::vector<uint8_t>* data;
+    };
+    std::vector<TrackRef> tracks;
+    if (!compressed_data.empty()) {
+        tracks.push_back({TrackType::Raster, &compressed_data});
+    }
+    for (const auto& track : tracks_) {
+        tracks.push_back({track.type, &track.data});
+    }
+
+    uint64_t payload_size = 0;
+    for (const auto& track : tracks) {
+        payload_size += track.data->size();
+    }
+
+    const size_t moov_size = kBoxHeaderSize + kMvhdSize + tracks.size() * kTrakSize + kCrccSize;
+    const bool large_mdat = payload_size + kBoxHeaderSize > 0xffffffffull;
+    const size_t mdat_header_size = large_mdat ? 16 : kBoxHeaderSize;
+    const uint64_t payload_offset = kFtypSize + moov_size + mdat_header_size;
+
+    container_data.clear();
+    container_data.reserve(payload_offset + payload_size);
+
+    // File type box
+    put_u32(container_data, kFtypSize);
+    put_u32(container_data, kBoxFtyp);
+    put_u32(container_data, kBrandFresco);
+    put_u32(container_data, kMinorVersion);
+    put_u32(container_data, kBrandFresco);
+    put_u32(container_data, kBrandIsom);
+    put_u32(container_data, kBrandMif1);
+
+    // Movie box
+    put_u32(container_data, static_cast<uint32_t>(moov_size));
+    put_u32(container_data, kBoxMoov);
+    const size_t moov_payload = container_data.size();
+
+    put_u32(container_data, kMvhdSize);
+    put_u32(container_data, kBoxMvhd);
+    put_u32(container_data, 0); // version and flags
+    put_u32(container_data, image_info_.width);
+    put_u32(container_data, image_info_.height);
+    put_u8(container_data, image_info_.channels);
+    put_u8(container_data, image_info_.bit_depth);
+    put_u8(container_data, static_cast<uint8_t>(image_info_.colorspace));
+    put_u8(container_data, 0);
+    put_u32(container_data, 1); // frame count
+    put_u32(container_data, 0); // frame rate (0.0f)
+
+    uint64_t track_offset = payload_offset;
+    for (size_t i = 0; i < tracks.size(); i++) {
+        const std::vector<uint8_t>& data = *tracks[i].data;
+        const bool checksum = tracks[i].type != TrackType::Raster;
+        put_u32(container_data, kTrakSize);
+        put_u32(container_data, kBoxTrak);
+        put_u32(container_data, kTkhdSize);
+        put_u32(container_data, kBoxTkhd);
+        put_u32(container_data, checksum ? kTkhdFlagChecksum : 0); // version and flags
+        put_u32(container_data, static_cast<uint32_t>(i + 1));
+        put_u32(container_data, static_cast<uint32_t>(tracks[i].type));
+        put_u64(container_data, track_offset);
+        put_u64(container_data, data.size());
+        put_u32(container_data, checksum ? crc32c(0, data.data(), data.size()) : 0);
+        track_offset += data.size();
+    }
+    const uint32_t moov_checksum = crc32c(0, container_data.data() + moov_payload,
+                                          container_data.size() - moov_payload);
+    put_u32(container_data, kCrccSize);
+    put_u32(container_data, kBoxCrcc);
+    put_u32(container_data, moov_checksum);
+
+    // Media data box
+    if (large_mdat) {
+        put_u32(container_data, 1);
+        put_u32(container_data, kBoxMdat);
+        put_u64(container_data, payload_size + 16);
+    } else {
+        put_u32(container_data, static_cast<uint32_t>(payload_size + kBoxHeaderSize));
+        put_u32(container_data, kBoxMdat);
+    }
+    for (const auto& track : tracks) {
+        container_data.insert(container_data.end(), track.data->begin(), track.data->end());
+    }
+
+    tracks_.clear();
     return FRESCO_OK;
 }
 
 fresco_error_t Container::parse(const uint8_t* input_data, size_t input_size,
-                               ContainerInfo& container_info) {
-    // TODO: Parse ISOBMFF container structure
-    // For now, assume it's just raw image data
-    container_info.width = 1920;  // Default values
-    container_info.height = 1080;
-    container_info.channels = 3;
-    container_info.bit_depth = 8;
-    container_info.colorspace = FRESCO_COLORSPACE_RGB;
-    container_info.frame_count = 1;
-    container_info.frame_rate = 0.0f;
-    container_info.compressed_size = input_size;
+                               ContainerInfo& container_info, fresco_verify_t verify) const {
+    fresco_error_t result = parse_header(input_data, input_size, container_info, verify);
+    if (result != FRESCO_OK) {
+        return result;
+    }
+
+    for (const auto& track : container_info.tracks) {
+        if (track.offset > input_size || track.size > input_size - track.offset) {
+            return FRESCO_ERROR_CORRUPTED_DATA;
+        }
+    }
+    if (verify == FRESCO_VERIFY_ALWAYS) {
+        for (const auto& track : container_info.tracks) {
+            result = verify_track(input_data, track);
+            if (result != FRESCO_OK) {
+                return result;
+            }
+        }
+    }
+    return FRESCO_OK;
+}
+
+fresco_error_t Container::verify_track(const uint8_t* input_data, const TrackInfo& track) {
+    if (track.has_checksum &&
+        crc32c(0, input_data + track.offset, static_cast<size_t>(track.size)) != track.checksum) {
+        return FRESCO_ERROR_CORRUPTED_DATA;
+    }
     return FRESCO_OK;
 }
 
 fresco_error_t Container::parse_header(const uint8_t* input_data, size_t input_size,
-                                      ContainerInfo& container_info) {
-    // TODO: Parse only the container header
-    return parse(input_data, input_size, container_info);
+                                      ContainerInfo& container_info,
+                                      fresco_verify_t verify) const {
+    if (!input_data) {
+        return FRESCO_ERROR_INVALID_PARAMETER;
+    }
+
+    container_info = ContainerInfo();
+    container_info.frame_count = 1;
+
+    Box ftyp;
+    uint64_t offset;
+    if (!read_box(input_data, input_size, 0, ftyp, offset) || ftyp.type != kBoxFtyp ||
+        ftyp.size < 8 || get_u32(ftyp.data) != kBrandFresco) {
+        return FRESCO_ERROR_UNSUPPORTED_FORMAT;
+    }
+
+    bool have_mvhd = false;
+    while (offset < input_size) {
+        Box box;
+        uint64_t next;
+        if (!read_box(input_data, input_size, offset, box, next)) {
+            return FRESCO_ERROR_CORRUPTED_DATA;
+        }
+        if (box.type == kBoxMoov) {
+            fresco_error_t result = parse_moov(box, verify, container_info, have_mvhd);
+            if (result != FRESCO_OK) {
+                return result;
+            }
+            break;
+        }
+        offset = next;
+    }
+
+    if (!have_mvhd) {
+        return FRESCO_ERROR_CORRUPTED_DATA;
+    }
+
+    for (const auto& track : container_info.tracks) {
+        container_info.compressed_size += track.size;
+    }
+    return FRESCO_OK;
+}
+
+fresco_error_t Container::probe(const ReadAt& read, uint64_t file_size,
+                               ContainerInfo& container_info) {
+    container_info = ContainerInfo();
+    container_info.frame_count = 1;
+
+    std::vector<uint8_t> head(static_cast<size_t>(std::min(file_size, kProbeReadSize)));
+    if (!read(0, head.size(), head.data())) {
+        return FRESCO_ERROR_IO;
+    }
+    Box ftyp;
+    uint64_t offset;
+    if (!read_box(head.data(), head.size(), 0, ftyp, offset) || ftyp.type != kBoxFtyp ||
+        ftyp.size < 8 || get_u32(ftyp.data) != kBrandFresco) {
+        return FRESCO_ERROR_UNSUPPORTED_FORMAT;
+    }
+
+    // Walk the top-level box headers up to moov; payloads other than moov
+    // are skipped without reading them
+    bool have_mvhd = false;
+    std::vector<uint8_t> moov_data;
+    while (offset < file_size) {
+        uint8_t header[16];
+        const uint64_t available = std::min<uint64_t>(sizeof(header), file_size - offset);
+        const uint8_t* p = header;
+        if (offset + available <= head.size()) {
+            p = head.data() + offset;
+        } else if (!read(offset, static_cast<size_t>(available), header)) {
+            return FRESCO_ERROR_IO;
+        }
+        uint32_t type;
+        uint64_t box_size, header_size;
+        if (!read_box_header(p, available, file_size - offset, type, box_size, header_size)) {
+            return FRESCO_ERROR_CORRUPTED_DATA;
+        }
+        if (type == kBoxMoov) {
+            Box moov;
+            moov.type = type;
+            moov.size = box_size - header_size;
+            const uint64_t start = offset + header_size;
+            if (moov.size > kMaxMoovSize) {
+                return FRESCO_ERROR_CORRUPTED_DATA;
+            }
+            if (start + moov.size <= head.size()) {
+                moov.data = head.data() + start;
+            } else {
+                moov_data.resize(static_cast<size_t>(moov.size));
+                if (!read(start, moov_data.size(), moov_data.data())) {
+                    return FRESCO_ERROR_IO;
+                }
+                moov.data = moov_data.data();
+            }
+            fresco_error_t result =
+                parse_moov(moov, FRESCO_VERIFY_LAZY, container_info, have_mvhd);
+            if (result != FRESCO_OK) {
+                return result;
+            }
+            break;
+        }
+        offset += box_size;
+    }
+
+    if (!have_mvhd) {
+        return FRESCO_ERROR_CORRUPTED_DATA;
+    }
+
+    for (const auto& track : container_info.tracks) {
+        container_info.compressed_size += track.size;
+    }
+    return FRESCO_OK;
 }
 
 fresco_error_t Container::extract_data(const uint8_t* input_data, size_t input_size,
-                                      std::vector<uint8_t>& compressed_data) {
-    // TODO: Extract compressed data from container
-    // For now, assume the entire input is compressed data
-    compressed_data.assign(input_data, input_data + input_size);
+                                      const ContainerInfo& container_info,
+                                      const uint8_t*& compressed_data,
+                                      size_t& compressed_size) const {
+    (void)input_size;
+    const TrackInfo* track = container_info.find_track(TrackType::Raster);
+    if (!track) {
+        return FRESCO_ERROR_UNSUPPORTED_FORMAT;
+    }
+    compressed_data = input_data + track->offset;
+    compressed_size = static_cast<size_t>(track->size);
     return FRESCO_OK;
 }
 
@@ -11,6 +11,7 @@
 
 #include "fresco/fresco.h"
 #include "compression.h"
+#include <functional>
 #include <vector>
 
 namespace fresco {
@@ -23,17 +24,54 @@ public:
     fresco_error_t initialize(const ImageInfo& image_info,
                              const fresco_encode_params_t& params);
 
+    // Queue an additional (non-raster) track for the next finalize()
+    fresco_error_t add_track(TrackType type, std::vector<uint8_t> data);
+
+    // Bytes finalize() writes besides a raster track's payload: boxes and
+    // the queued tracks
+    uint64_t size_without_raster() const;
+
+    // Writes ftyp, moov and mdat; compressed_data becomes the raster track
+    // unless it is empty
     fresco_error_t finalize(const std::vector<uint8_t>& compressed_data,
                            std::vector<uint8_t>& container_data);
 
+    // Checks moov against its checksum unless verify is SKIP, and with
+    // ALWAYS every track that carries one as well
     fresco_error_t parse(const uint8_t* input_data, size_t input_size,
-                        ContainerInfo& container_info);
+                        ContainerInfo& container_info,
+                        fresco_verify_t verify = FRESCO_VERIFY_LAZY) const;
 
     fresco_error_t parse_header(const uint8_t* input_data, size_t input_size,
-                               ContainerInfo& container_info);
+                               ContainerInfo& container_info,
+                               fresco_verify_t verify = FRESCO_VERIFY_LAZY) const;
+
+    // FRESCO_ERROR_CORRUPTED_DATA when the track's payload does not match
+    // its checksum; tracks without one always pass
+    static fresco_error_t verify_track(const uint8_t* input_data, const TrackInfo& track);
+
+    // Reads size bytes at offset into out; false on a failed or short read
+    using ReadAt = std::function<bool(uint64_t offset, size_t size, uint8_t* out)>;
 
+    // parse_header() for data that is not in memory: reads the first few KB
+    // and, when moov lies beyond them, the box headers up to it and moov
+    // itself, but never a track payload
+    static fresco_error_t probe(const ReadAt& read, uint64_t file_size,
+                                ContainerInfo& container_info);
+
+    // Points at the raster track payload inside input_data, without a copy
     fresco_error_t extract_data(const uint8_t* input_data, size_t input_size,
-                               std::vector<uint8_t>& compressed_data);
+                               const ContainerInfo& container_info,
+                               const uint8_t*& compressed_data, size_t& compressed_size) const;
+
+private:
+    struct PendingTrack {
+        TrackType type;
+        std::vector<uint8_t> data;
+    };
+
+    ImageInfo image_info_ = {};
+    std::vector<PendingTrack> tracks_;
 };
 
 } // namespace fresco
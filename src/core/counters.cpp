@@ -0,0 +1,214 @@
+/**
+ * @file counters.cpp
+ * @brief FRESCO process-wide performance counters
+ * @author Mehmet T. AKALIN
+ * @date 2025
+ * @license MIT
+ */
+
+#include "counters.h"
+#include <algorithm>
+#include <atomic>
+#include <cstdarg>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+
+namespace fresco {
+
+namespace {
+
+// Threads are spread over the shards round-robin; each shard sits on its own
+// cache lines so two threads on different shards never share one
+constexpr size_t kCounterShards = 16;
+
+struct alignas(64) CounterShard {
+    std::atomic<uint64_t> values[kCounterCount];
+};
+
+CounterShard g_shards[kCounterShards];
+std::atomic<size_t> g_next_shard(0);
+
+CounterShard& local_shard() {
+    thread_local CounterShard& shard =
+        g_shards[g_next_shard.fetch_add(1, std::memory_order_relaxed) % kCounterShards];
+    return shard;
+}
+
+uint64_t total(Counter counter) {
+    uint64_t sum = 0;
+    for (const auto& shard : g_shards) {
+        sum += shard.values[static_cast<size_t>(counter)].load(std::memory_order_relaxed);
+    }
+    return sum;
+}
+
+void append(std::string& text, const char* format, ...) {
+    char line[256];
+    va_list args;
+    va_start(args, format);
+    const int length = std::vsnprintf(line, sizeof(line), format, args);
+    va_end(args);
+    if (length > 0) {
+        text.append(line, std::min(static_cast<size_t>(length), sizeof(line) - 1));
+    }
+}
+
+void append_header(std::string& text, const char* name, const char* type, const char* help) {
+    append(text, "# HELP %s %s\n# TYPE %s %s\n", name, help, name, type);
+}
+
+} // namespace
+
+void counter_add(Counter counter, uint64_t value) {
+    local_shard().values[static_cast<size_t>(counter)].fetch_add(value,
+                                                                 std::memory_order_relaxed);
+}
+
+void count_call(bool encode, fresco_error_t result, uint64_t bytes_in, uint64_t bytes_out,
+                const fresco_stats_t& stats) {
+    CounterShard& shard = local_shard();
+    auto add = [&shard](Counter counter, uint64_t value) {
+        if (value) {
+            shard.values[static_cast<size_t>(counter)].fetch_add(value,
+                                                                 std::memory_order_relaxed);
+        }
+    };
+
+    if (result != FRESCO_OK) {
+        add(encode ? Counter::EncodeErrors : Counter::DecodeErrors, 1);
+        return;
+    }
+    add(encode ? Counter::ImagesEncoded : Counter::ImagesDecoded, 1);
+    add(encode ? Counter::EncodeBytesIn : Counter::DecodeBytesIn, bytes_in);
+    add(encode ? Counter::EncodeBytesOut : Counter::DecodeBytesOut, bytes_out);
+    add(Counter::ParseNs, stats.parse_ns);
+    add(Counter::ColorNs, stats.color_ns);
+    add(Counter::TransformNs, stats.transform_ns);
+    add(Counter::QuantizeNs, stats.quantize_ns);
+    add(Counter::EntropyNs, stats.entropy_ns);
+    add(Counter::ContainerNs, stats.container_ns);
+    add(Counter::VectorNs, stats.vector_ns);
+    add(Counter::MeshNs, stats.mesh_ns);
+}
+
+void read_counters(fresco_counters_t& counters) {
+    counters.images_encoded = total(Counter::ImagesEncoded);
+    counters.images_decoded = total(Counter::ImagesDecoded);
+    counters.encode_errors = total(Counter::EncodeErrors);
+    counters.decode_errors = total(Counter::DecodeErrors);
+    counters.encode_bytes_in = total(Counter::EncodeBytesIn);
+    counters.encode_bytes_out = total(Counter::EncodeBytesOut);
+    counters.decode_bytes_in = total(Counter::DecodeBytesIn);
+    counters.decode_bytes_out = total(Counter::DecodeBytesOut);
+    counters.parse_ns = total(Counter::ParseNs);
+    counters.color_ns = total(Counter::ColorNs);
+    counters.transform_ns = total(Counter::TransformNs);
+    counters.quantize_ns = total(Counter::QuantizeNs);
+    counters.entropy_ns = total(Counter::EntropyNs);
+    counters.container_ns = total(Counter::ContainerNs);
+    counters.vector_ns = total(Counter::VectorNs);
+    counters.mesh_ns = total(Counter::MeshNs);
+    counters.allocations = total(Counter::Allocations);
+    counters.allocated_bytes = total(Counter::AllocatedBytes);
+    counters.queue_depth = total(Counter::QueueDepth);
+    counters.tile_cache_hits = total(Counter::TileCacheHits);
+    counters.tile_cache_misses = total(Counter::TileCacheMisses);
+    counters.tile_cache_evictions = total(Counter::TileCacheEvictions);
+}
+
+std::string format_prometheus(const fresco_counters_t& counters) {
+    std::string text;
+    const unsigned long long encode_values[] = {
+        counters.images_encoded, counters.encode_errors, counters.encode_bytes_in,
+        counters.encode_bytes_out};
+    const unsigned long long decode_values[] = {
+        counters.images_decoded, counters.decode_errors, counters.decode_bytes_in,
+        counters.decode_bytes_out};
+    const char* const names[] = {"fresco_images_total", "fresco_errors_total",
+                                 "fresco_bytes_in_total", "fresco_bytes_out_total"};
+    const char* const helps[] = {"Images coded successfully", "Calls that returned an error",
+                                 "Bytes handed to successful calls",
+                                 "Bytes produced by successful calls"};
+    for (size_t i = 0; i < 4; i++) {
+        append_header(text, names[i], "counter", helps[i]);
+        append(text, "%s{operation=\"encode\"} %llu\n", names[i], encode_values[i]);
+        append(text, "%s{operation=\"decode\"} %llu\n", names[i], decode_values[i]);
+    }
+
+    append_header(text, "fresco_stage_seconds_total", "counter",
+                  "Time spent per stage, summed over worker threads");
+    const struct {
+        const char* stage;
+        uint64_t ns;
+    } stages[] = {{"parse", counters.parse_ns},         {"color", counters.color_ns},
+                  {"transform", counters.transform_ns}, {"quantize", counters.quantize_ns},
+                  {"entropy", counters.entropy_ns},     {"container", counters.container_ns},
+                  {"vector", counters.vector_ns},       {"mesh", counters.mesh_ns}};
+    for (const auto& stage : stages) {
+        append(text, "fresco_stage_seconds_total{stage=\"%s\"} %llu.%09llu\n", stage.stage,
+               static_cast<unsigned long long>(stage.ns / 1000000000),
+               static_cast<unsigned long long>(stage.ns % 1000000000));
+    }
+
+    append_header(text, "fresco_allocations_total", "counter",
+                  "Buffers allocated through fresco_malloc");
+    append(text, "fresco_allocations_total %llu\n",
+           static_cast<unsigned long long>(counters.allocations));
+    append_header(text, "fresco_allocated_bytes_total", "counter",
+                  "Bytes allocated through fresco_malloc");
+    append(text, "fresco_allocated_bytes_total %llu\n",
+           static_cast<unsigned long long>(counters.allocated_bytes));
+    append_header(text, "fresco_queue_depth", "gauge", "Work items waiting for a worker thread");
+    append(text, "fresco_queue_depth %llu\n",
+           static_cast<unsigned long long>(counters.queue_depth));
+    append_header(text, "fresco_tile_cache_lookups_total", "counter",
+                  "Region decode lookups of a tile in a tile cache");
+    append(text, "fresco_tile_cache_lookups_total{result=\"hit\"} %llu\n",
+           static_cast<unsigned long long>(counters.tile_cache_hits));
+    append(text, "fresco_tile_cache_lookups_total{result=\"miss\"} %llu\n",
+           static_cast<unsigned long long>(counters.tile_cache_misses));
+    append_header(text, "fresco_tile_cache_evictions_total", "counter",
+                  "Tiles dropped from a tile cache to stay within its budget");
+    append(text, "fresco_tile_cache_evictions_total %llu\n",
+           static_cast<unsigned long long>(counters.tile_cache_evictions));
+    return text;
+}
+
+} // namespace fresco
+
+extern "C" {
+
+fresco_error_t fresco_get_counters(fresco_counters_t* counters) {
+    if (!counters) {
+        return FRESCO_ERROR_INVALID_PARAMETER;
+    }
+
+    fresco::read_counters(*counters);
+    return FRESCO_OK;
+}
+
+fresco_error_t fresco_format_counters_prometheus(const fresco_counters_t* counters, char** text,
+                                                 size_t* length) {
+    if (!counters || !text || !length) {
+        return FRESCO_ERROR_INVALID_PARAMETER;
+    }
+
+    try {
+        const std::string formatted = fresco::format_prometheus(*counters);
+        // Not counted as an allocation, so scraping does not move the counters
+        char* out = static_cast<char*>(std::malloc(formatted.size() + 1));
+        if (!out) {
+            return FRESCO_ERROR_OUT_OF_MEMORY;
+        }
+        std::memcpy(out, formatted.c_str(), formatted.size() + 1);
+        *text = out;
+        *length = formatted.size();
+        return FRESCO_OK;
+    } catch (const std::bad_alloc&) {
+        return FRESCO_ERROR_OUT_OF_MEMORY;
+    }
+}
+
+} // extern "C"
@@ -0,0 +1,65 @@
+/**
+ * @file counters.h
+ * @brief FRESCO process-wide performance counters
+ * @author Mehmet T. AKALIN
+ * @date 2025
+ * @license MIT
+ */
+
+#ifndef FRESCO_COUNTERS_H
+#define FRESCO_COUNTERS_H
+
+#include "fresco/fresco.h"
+#include <string>
+
+namespace fresco {
+
+enum class Counter : uint32_t {
+    ImagesEncoded = 0,
+    ImagesDecoded,
+    EncodeErrors,
+    DecodeErrors,
+    EncodeBytesIn,
+    EncodeBytesOut,
+    DecodeBytesIn,
+    DecodeBytesOut,
+    ParseNs,
+    ColorNs,
+    TransformNs,
+    QuantizeNs,
+    EntropyNs,
+    ContainerNs,
+    VectorNs,
+    MeshNs,
+    Allocations,
+    AllocatedBytes,
+    QueueDepth,
+    TileCacheHits,
+    TileCacheMisses,
+    TileCacheEvictions
+};
+
+constexpr size_t kCounterCount = 22;
+
+// Adds to the calling thread's shard; relaxed and uncontended unless more
+// threads than shards update at once. Gauges go down by adding the two's
+// complement.
+void counter_add(Counter counter, uint64_t value);
+
+inline void counter_sub(Counter counter, uint64_t value) {
+    counter_add(counter, ~value + 1);
+}
+
+// Folds the figures of one finished encode or decode call into the counters
+void count_call(bool encode, fresco_error_t result, uint64_t bytes_in, uint64_t bytes_out,
+                const fresco_stats_t& stats);
+
+// Sum over all shards
+void read_counters(fresco_counters_t& counters);
+
+// Prometheus text exposition format, version 0.0.4
+std::string format_prometheus(const fresco_counters_t& counters);
+
+} // namespace fresco
+
+#endif // FRESCO_COUNTERS_H
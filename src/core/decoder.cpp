@@ -11,79 +11,828 @@
 #include "compression.h"
 #include "container.h"
 #include "utils.h"
+#include "stats.h"
+#include "counters.h"
+#include "async.h"
+#include "thread_pool.h"
+#include "tile_cache.h"
+#include "pyramid.h"
+#include "codecs/vector_codec.h"
+#include "codecs/vector_rasterizer.h"
+#include "codecs/3d_codec.h"
+#include "codecs/mesh_lod.h"
+#include "codecs/jpeg_codec.h"
 
+#include <algorithm>
 #include <memory>
 #include <vector>
 #include <cstring>
 
 namespace fresco {
 
-class DecoderImpl {
+// Where a decode writes the image: the caller's buffer of capacity bytes
+// with rows row_stride apart, or a new packed buffer from fresco_malloc when
+// pixels is null. With a region, only that part of the raster is decoded,
+// always into the caller's buffer. With a pyramid, the image goes to sink
+// as pyramid tiles instead. With jpeg, the output is the JPEG file of the
+// JPEG track, in a new buffer from fresco_malloc. With file, the output is
+// the image as a file of file_format, in a new buffer from fresco_malloc.
+struct PixelTarget {
+    uint8_t* pixels = nullptr;
+    size_t row_stride = 0;
+    size_t capacity = 0;
+    const fresco_region_t* region = nullptr;
+    const fresco_pyramid_params_t* pyramid = nullptr;
+    fresco_pyramid_sink_t sink = nullptr;
+    void* sink_data = nullptr;
+    bool jpeg = false;
+    bool file = false;
+    fresco_file_format_t file_format = FRESCO_FILE_PNM;
+};
+
+namespace {
+
+fresco_decode_params_t default_decode_params() {
+    fresco_decode_params_t params = {};
+    params.max_threads = 0; // Auto-detect
+    params.enable_progressive = 0;
+    params.enable_metadata = 0;
+    params.render_vector = 0;
+    return params;
+}
+
+// Gathers each row of tiles in a band of image rows and hands the band to a
+// file writer, so a file is written while the raster is decoded
+class FileRowSink : public TileRowSink {
 public:
-    DecoderImpl() : params_(), container_(), compression_() {
-        // Set default parameters
-        params_.max_threads = 0; // Auto-detect
-        params_.enable_progressive = 0;
-        params_.enable_metadata = 0;
+    FileRowSink(ImageWriter& writer, const ContainerInfo& container_info, uint32_t tile_size)
+        : writer_(writer), height_(container_info.height), channels_(container_info.channels),
+          tile_size_(tile_size),
+          row_bytes_(static_cast<size_t>(container_info.width) * container_info.channels) {}
+
+    fresco_error_t begin_row(uint32_t row) override {
+        first_ = row * tile_size_;
+        count_ = std::min(tile_size_, height_ - first_);
+        band_.resize(row_bytes_ * count_);
+        return FRESCO_OK;
+    }
+
+    uint8_t* tile_pixels(uint32_t level, uint32_t x, uint32_t y, size_t& row_stride) override {
+        (void)level;
+        row_stride = row_bytes_;
+        return band_.data() + (y - first_) * row_bytes_ + static_cast<size_t>(x) * channels_;
+    }
+
+    fresco_error_t end_row(uint32_t row) override {
+        (void)row;
+        return writer_.write_rows(band_.data(), row_bytes_, count_);
+    }
+
+    uint64_t band_bytes() const { return static_cast<uint64_t>(tile_size_) * row_bytes_; }
+
+private:
+    ImageWriter& writer_;
+    uint32_t height_;
+    uint32_t channels_;
+    uint32_t tile_size_;
+    size_t row_bytes_;
+    uint32_t first_ = 0;
+    uint32_t count_ = 0;
+    std::vector<uint8_t> band_;
+};
+
+// Checks a track that is about to be read whole. parse() has checked it
+// already with ALWAYS, and SKIP checks nothing.
+fresco_error_t check_track(const fresco_decode_params_t& params, const uint8_t* input_data,
+                           const TrackInfo& track) {
+    if (params.verify != FRESCO_VERIFY_LAZY) {
+        return FRESCO_OK;
+    }
+    return Container::verify_track(input_data, track);
+}
+
+// Hands out a copy of data from fresco_malloc
+fresco_error_t copy_out(const std::vector<uint8_t>& data, uint8_t** output_data,
+                        size_t* output_size) {
+    *output_data = static_cast<uint8_t*>(fresco_malloc(data.size()));
+    if (!*output_data) {
+        return FRESCO_ERROR_OUT_OF_MEMORY;
+    }
+    std::memcpy(*output_data, data.data(), data.size());
+    *output_size = data.size();
+    return FRESCO_OK;
+}
+
+} // namespace
+
+// Everything a raster decode reads besides its input. Nothing here changes
+// while decoding and the tile buffers of a call belong to its threads, so
+// any number of threads may decode through one instance at once.
+class DecodeConfig {
+public:
+    explicit DecodeConfig(const fresco_decode_params_t& params, ThreadPool* pool = nullptr,
+                          TileCache* cache = nullptr)
+        : params_(params), pool_(pool), cache_(cache) {}
+
+    fresco_error_t decode(const uint8_t* input_data, size_t input_size,
+                         uint8_t** output_data, size_t* output_size,
+                         fresco_stats_t& stats) const {
+        if (!input_data || !output_data || !output_size) {
+            return FRESCO_ERROR_INVALID_PARAMETER;
+        }
+
+        return decode_to(input_data, input_size, PixelTarget(), output_data, output_size, stats);
+    }
+
+    fresco_error_t decode_into(const uint8_t* input_data, size_t input_size, uint8_t* pixels,
+                              size_t row_stride, size_t capacity, fresco_stats_t& stats) const {
+        if (!input_data || !pixels) {
+            return FRESCO_ERROR_INVALID_PARAMETER;
+        }
+
+        PixelTarget target;
+        target.pixels = pixels;
+        target.row_stride = row_stride;
+        target.capacity = capacity;
+        size_t written = 0;
+        return decode_to(input_data, input_size, target, nullptr, &written, stats);
+    }
+
+    fresco_error_t decode_region(const uint8_t* input_data, size_t input_size,
+                                 const fresco_region_t* region, uint8_t* pixels,
+                                 size_t row_stride, size_t capacity,
+                                 fresco_stats_t& stats) const {
+        if (!input_data || !region || !pixels) {
+            return FRESCO_ERROR_INVALID_PARAMETER;
+        }
+
+        PixelTarget target;
+        target.pixels = pixels;
+        target.row_stride = row_stride;
+        target.capacity = capacity;
+        target.region = region;
+        size_t written = 0;
+        return decode_to(input_data, input_size, target, nullptr, &written, stats);
+    }
+
+    fresco_error_t decode_pyramid(const uint8_t* input_data, size_t input_size,
+                                  const fresco_pyramid_params_t* params,
+                                  fresco_pyramid_sink_t sink, void* user_data,
+                                  fresco_stats_t& stats) const {
+        if (!input_data || !sink) {
+            return FRESCO_ERROR_INVALID_PARAMETER;
+        }
+
+        fresco_pyramid_params_t pyramid = {};
+        if (params) {
+            pyramid = *params;
+        }
+        if (pyramid.tile_size == 0) {
+            pyramid.tile_size = FRESCO_PYRAMID_TILE_SIZE;
+        }
+        if (pyramid.overlap >= pyramid.tile_size) {
+            return FRESCO_ERROR_INVALID_PARAMETER;
+        }
+
+        PixelTarget target;
+        target.pyramid = &pyramid;
+        target.sink = sink;
+        target.sink_data = user_data;
+        size_t written = 0;
+        return decode_to(input_data, input_size, target, nullptr, &written, stats);
     }
 
+    fresco_error_t decode_jpeg(const uint8_t* input_data, size_t input_size,
+                               uint8_t** jpeg_data, size_t* jpeg_size,
+                               fresco_stats_t& stats) const {
+        if (!input_data || !jpeg_data || !jpeg_size) {
+            return FRESCO_ERROR_INVALID_PARAMETER;
+        }
+
+        PixelTarget target;
+        target.jpeg = true;
+        return decode_to(input_data, input_size, target, jpeg_data, jpeg_size, stats);
+    }
+
+    fresco_error_t decode_file(const uint8_t* input_data, size_t input_size,
+                               fresco_file_format_t format, uint8_t** file_data,
+                               size_t* file_size, fresco_stats_t& stats) const {
+        if (!input_data || !file_data || !file_size) {
+            return FRESCO_ERROR_INVALID_PARAMETER;
+        }
+
+        PixelTarget target;
+        target.file = true;
+        target.file_format = format;
+        return decode_to(input_data, input_size, target, file_data, file_size, stats);
+    }
+
+private:
+    fresco_error_t decode_to(const uint8_t* input_data, size_t input_size,
+                             const PixelTarget& target, uint8_t** output_data,
+                             size_t* output_size, fresco_stats_t& stats) const {
+        TraceSpan span("decode");
+        PoolScope pool_scope(pool_);
+        stats = fresco_stats_t();
+        const uint64_t start = now_ns();
+        StageTimes times;
+        RasterStats raster_stats;
+        fresco_error_t result;
+        try {
+            result = decode_tracks(input_data, input_size, times, raster_stats, target,
+                                   output_data, output_size, stats);
+            times.merge(raster_stats.times);
+            fill_stats(times, raster_stats, now_ns() - start, stats);
+        } catch (const std::bad_alloc&) {
+            result = FRESCO_ERROR_OUT_OF_MEMORY;
+        } catch (const std::exception& e) {
+            result = FRESCO_ERROR_DECODING_FAILED;
+        }
+        count_call(false, result, input_size, result == FRESCO_OK ? *output_size : 0, stats);
+        return result;
+    }
+
+    fresco_error_t decode_tracks(const uint8_t* input_data, size_t input_size, StageTimes& times,
+                                 RasterStats& raster_stats, const PixelTarget& target,
+                                 uint8_t** output_data, size_t* output_size,
+                                 fresco_stats_t& stats) const {
+        Stopwatch watch(times);
+        // Parse FRESCO container
+        ContainerInfo container_info;
+        fresco_error_t result =
+            container_.parse(input_data, input_size, container_info, params_.verify);
+        if (result != FRESCO_OK) {
+            return result;
+        }
+        watch.lap(Stage::Parse);
+        for (const auto& track : container_info.tracks) {
+            if (track.type == TrackType::Raster || track.type == TrackType::Jpeg) {
+                stats.raster_bytes = track.size;
+            } else if (track.type == TrackType::Vector) {
+                stats.vector_bytes = track.size;
+            } else if (track.type == TrackType::Mesh) {
+                stats.mesh_bytes = track.size;
+            }
+        }
+
+        if (target.region) {
+            return decode_region_track(input_data, input_size, container_info, target, watch,
+                                       raster_stats, output_size);
+        }
+        if (target.pyramid) {
+            return decode_pyramid_track(input_data, input_size, container_info, target, watch,
+                                        raster_stats, output_size);
+        }
+        if (target.jpeg) {
+            return decode_jpeg_track(input_data, container_info, watch, raster_stats,
+                                     output_data, output_size);
+        }
+
+        const TrackInfo* vector_track = container_info.find_track(TrackType::Vector);
+        // A JPEG track has no pixels of its own to draw the vectors over
+        const bool vector_only = vector_track && !container_info.find_track(TrackType::Raster) &&
+                                 !container_info.find_track(TrackType::Jpeg);
+        // Vectors are drawn over the whole image; without them, files are
+        // written a row of tiles at a time
+        if (target.file && !vector_only && !(vector_track && params_.render_vector)) {
+            return decode_file_track(input_data, input_size, container_info, target, watch,
+                                     raster_stats, output_data, output_size);
+        }
+
+        // Tiles are decoded straight into the output buffer, which is the
+        // only full-size allocation of the call and none when the caller
+        // brings it
+        const size_t row_bytes =
+            static_cast<size_t>(container_info.width) * container_info.channels;
+        const size_t pixel_bytes = row_bytes * container_info.height;
+        if (params_.max_memory_bytes > 0 && pixel_bytes > params_.max_memory_bytes) {
+            return FRESCO_ERROR_OUT_OF_MEMORY;
+        }
+        std::unique_ptr<uint8_t, void (*)(void*)> owned(nullptr, fresco_free);
+        uint8_t* pixels = target.pixels;
+        size_t row_stride = row_bytes;
+        if (pixels) {
+            row_stride = target.row_stride ? target.row_stride : row_bytes;
+            if (row_stride < row_bytes ||
+                (pixel_bytes > 0 &&
+                 target.capacity < (container_info.height - 1) * row_stride + row_bytes)) {
+                return FRESCO_ERROR_INVALID_PARAMETER;
+            }
+        } else {
+            owned.reset(static_cast<uint8_t*>(fresco_malloc(pixel_bytes)));
+            if (!owned && pixel_bytes > 0) {
+                return FRESCO_ERROR_OUT_OF_MEMORY;
+            }
+            pixels = owned.get();
+        }
+
+        if (vector_only) {
+            // Vector-only files are rendered onto a transparent canvas
+            for (uint32_t y = 0; y < container_info.height; y++) {
+                std::memset(pixels + y * row_stride, 0, row_bytes);
+            }
+        } else {
+            const uint8_t* compressed_data = nullptr;
+            size_t compressed_size = 0;
+            result = container_.extract_data(input_data, input_size, container_info,
+                                             compressed_data, compressed_size);
+            if (result != FRESCO_OK) {
+                return result;
+            }
+
+            // Decompress data
+            watch.lap(Stage::Container);
+            result = compression_.decompress(compressed_data, compressed_size, container_info,
+                                             params_, pixels, row_stride, raster_stats);
+            watch.skip();
+            if (result != FRESCO_OK) {
+                return result;
+            }
+        }
+
+        watch.lap(Stage::Container);
+        if (vector_track && (vector_only || params_.render_vector)) {
+            result = render_vector_track(input_data, *vector_track, container_info, pixels,
+                                         row_stride);
+            if (result != FRESCO_OK) {
+                return result;
+            }
+            watch.lap(Stage::Vector);
+        }
+
+        if (target.file) {
+            return write_file(pixels, row_stride, container_info, target.file_format, watch,
+                              output_data, output_size);
+        }
+        *output_size = pixel_bytes;
+        if (output_data) {
+            *output_data = owned.release();
+        }
+        return FRESCO_OK;
+    }
+
+    fresco_error_t decode_region_track(const uint8_t* input_data, size_t input_size,
+                                       const ContainerInfo& container_info,
+                                       const PixelTarget& target, Stopwatch& watch,
+                                       RasterStats& raster_stats, size_t* output_size) const {
+        const fresco_region_t& region = *target.region;
+        if (!container_info.find_track(TrackType::Raster) || region.level >= 32) {
+            return FRESCO_ERROR_UNSUPPORTED_FORMAT;
+        }
+        // Level n is the image at 1 / 2^n, rounded up
+        const uint64_t scale = uint64_t(1) << region.level;
+        const uint64_t level_width = (container_info.width + scale - 1) / scale;
+        const uint64_t level_height = (container_info.height + scale - 1) / scale;
+        if (region.width == 0 || region.height == 0 ||
+            uint64_t(region.x) + region.width > level_width ||
+            uint64_t(region.y) + region.height > level_height) {
+            return FRESCO_ERROR_INVALID_PARAMETER;
+        }
+
+        const size_t row_bytes = static_cast<size_t>(region.width) * container_info.channels;
+        const size_t pixel_bytes = row_bytes * region.height;
+        const size_t row_stride = target.row_stride ? target.row_stride : row_bytes;
+        if (row_stride < row_bytes ||
+            target.capacity < (region.height - 1) * row_stride + row_bytes) {
+            return FRESCO_ERROR_INVALID_PARAMETER;
+        }
+        if (params_.max_memory_bytes > 0 && pixel_bytes > params_.max_memory_bytes) {
+            return FRESCO_ERROR_OUT_OF_MEMORY;
+        }
+
+        const uint8_t* compressed_data = nullptr;
+        size_t compressed_size = 0;
+        fresco_error_t result = container_.extract_data(input_data, input_size, container_info,
+                                                        compressed_data, compressed_size);
+        if (result != FRESCO_OK) {
+            return result;
+        }
+        watch.lap(Stage::Container);
+        result = compression_.decompress_region(compressed_data, compressed_size, container_info,
+                                                params_, region, target.pixels, row_stride,
+                                                cache_, raster_stats);
+        watch.skip();
+        if (result != FRESCO_OK) {
+            return result;
+        }
+        *output_size = pixel_bytes;
+        return FRESCO_OK;
+    }
+
+    fresco_error_t decode_pyramid_track(const uint8_t* input_data, size_t input_size,
+                                        const ContainerInfo& container_info,
+                                        const PixelTarget& target, Stopwatch& watch,
+                                        RasterStats& raster_stats, size_t* output_size) const {
+        if (!container_info.find_track(TrackType::Raster)) {
+            return FRESCO_ERROR_UNSUPPORTED_FORMAT;
+        }
+        if (target.pyramid->min_level >
+            pyramid_top_level(container_info.width, container_info.height)) {
+            return FRESCO_ERROR_INVALID_PARAMETER;
+        }
+
+        const uint8_t* compressed_data = nullptr;
+        size_t compressed_size = 0;
+        fresco_error_t result = container_.extract_data(input_data, input_size, container_info,
+                                                        compressed_data, compressed_size);
+        if (result != FRESCO_OK) {
+            return result;
+        }
+        uint32_t native_levels = 0, raster_tile = 0;
+        result = compression_.native_levels(compressed_data, compressed_size, container_info,
+                                            native_levels, raster_tile);
+        if (result != FRESCO_OK) {
+            return result;
+        }
+        watch.lap(Stage::Container);
+
+        PyramidBuilder builder(container_info.width, container_info.height,
+                               container_info.channels, native_levels, raster_tile,
+                               *target.pyramid, params_.max_threads, target.sink,
+                               target.sink_data);
+        result = compression_.decompress_levels(compressed_data, compressed_size, container_info,
+                                                params_, builder.max_reduction(), builder,
+                                                raster_stats);
+        if (result == FRESCO_OK) {
+            result = builder.finish();
+        }
+        watch.skip();
+        if (result != FRESCO_OK) {
+            return result;
+        }
+        *output_size = builder.tile_bytes();
+        return FRESCO_OK;
+    }
+
+    fresco_error_t decode_jpeg_track(const uint8_t* input_data,
+                                     const ContainerInfo& container_info, Stopwatch& watch,
+                                     RasterStats& raster_stats, uint8_t** jpeg_data,
+                                     size_t* jpeg_size) const {
+        const TrackInfo* track = container_info.find_track(TrackType::Jpeg);
+        if (!track) {
+            return FRESCO_ERROR_UNSUPPORTED_FORMAT;
+        }
+        fresco_error_t result = check_track(params_, input_data, *track);
+        if (result != FRESCO_OK) {
+            return result;
+        }
+        watch.lap(Stage::Container);
+        std::vector<uint8_t> jpeg;
+        result = jpeg_codec_.decode(input_data + track->offset,
+                                                   static_cast<size_t>(track->size), params_,
+                                                   jpeg, raster_stats);
+        watch.skip();
+        if (result != FRESCO_OK) {
+            return result;
+        }
+        result = copy_out(jpeg, jpeg_data, jpeg_size);
+        watch.lap(Stage::Container);
+        return result;
+    }
+
+    fresco_error_t decode_file_track(const uint8_t* input_data, size_t input_size,
+                                     const ContainerInfo& container_info,
+                                     const PixelTarget& target, Stopwatch& watch,
+                                     RasterStats& raster_stats, uint8_t** file_data,
+                                     size_t* file_size) const {
+        if (container_info.bit_depth != 8) {
+            return FRESCO_ERROR_UNSUPPORTED_FORMAT;
+        }
+        const uint8_t* compressed_data = nullptr;
+        size_t compressed_size = 0;
+        fresco_error_t result = container_.extract_data(input_data, input_size, container_info,
+                                                        compressed_data, compressed_size);
+        if (result != FRESCO_OK) {
+            return result;
+        }
+        uint32_t native_levels = 0, raster_tile = 0;
+        result = compression_.native_levels(compressed_data, compressed_size, container_info,
+                                            native_levels, raster_tile);
+        if (result != FRESCO_OK) {
+            return result;
+        }
+        std::unique_ptr<ImageWriter> writer;
+        result = create_image_writer(target.file_format, container_info.width,
+                                     container_info.height, container_info.channels, writer);
+        if (result != FRESCO_OK) {
+            return result;
+        }
+        FileRowSink sink(*writer, container_info, raster_tile);
+        if (params_.max_memory_bytes > 0 && sink.band_bytes() > params_.max_memory_bytes) {
+            return FRESCO_ERROR_OUT_OF_MEMORY;
+        }
+        watch.lap(Stage::Container);
+
+        result = compression_.decompress_levels(compressed_data, compressed_size, container_info,
+                                                params_, 0, sink, raster_stats);
+        watch.skip();
+        if (result != FRESCO_OK) {
+            return result;
+        }
+        std::vector<uint8_t> file;
+        result = writer->finish(file);
+        if (result == FRESCO_OK) {
+            result = copy_out(file, file_data, file_size);
+        }
+        watch.lap(Stage::Container);
+        return result;
+    }
+
+    fresco_error_t write_file(const uint8_t* pixels, size_t row_stride,
+                              const ContainerInfo& container_info, fresco_file_format_t format,
+                              Stopwatch& watch, uint8_t** file_data, size_t* file_size) const {
+        if (container_info.bit_depth != 8) {
+            return FRESCO_ERROR_UNSUPPORTED_FORMAT;
+        }
+        std::unique_ptr<ImageWriter> writer;
+        fresco_error_t result = create_image_writer(
+            format, container_info.width, container_info.height, container_info.channels, writer);
+        if (result != FRESCO_OK) {
+            return result;
+        }
+        result = writer->write_rows(pixels, row_stride, container_info.height);
+        std::vector<uint8_t> file;
+        if (result == FRESCO_OK) {
+            result = writer->finish(file);
+        }
+        if (result == FRESCO_OK) {
+            result = copy_out(file, file_data, file_size);
+        }
+        watch.lap(Stage::Container);
+        return result;
+    }
+
+    fresco_error_t render_vector_track(const uint8_t* input_data, const TrackInfo& track,
+                                      const ContainerInfo& container_info,
+                                      uint8_t* pixels, size_t row_stride) const {
+        if (container_info.bit_depth != 8) {
+            return FRESCO_ERROR_UNSUPPORTED_FORMAT;
+        }
+
+        fresco_error_t result = check_track(params_, input_data, track);
+        if (result != FRESCO_OK) {
+            return result;
+        }
+        VectorData vector_data;
+        result = vector_codec_.decode(input_data + track.offset, track.size, vector_data);
+        if (result != FRESCO_OK) {
+            return result;
+        }
+        return rasterizer_.render(vector_data, container_info.width, container_info.height,
+                                  container_info.channels, params_.max_threads, pixels,
+                                  row_stride);
+    }
+
+    fresco_decode_params_t params_;
+    ThreadPool* pool_;
+    TileCache* cache_;
+    Container container_;
+    Compression compression_;
+    VectorCodec vector_codec_;
+    VectorRasterizer rasterizer_;
+    JpegCodec jpeg_codec_;
+};
+
+class DecoderImpl {
+public:
+    DecoderImpl() : config_(params_) {}
+
     ~DecoderImpl() = default;
 
     fresco_error_t set_params(const fresco_decode_params_t* params) {
-        if (!params) {
+        if (!params || params->verify > FRESCO_VERIFY_SKIP) {
             return FRESCO_ERROR_INVALID_PARAMETER;
         }
 
+        config_ = DecodeConfig(*params, pool_, cache_);
         params_ = *params;
         return FRESCO_OK;
     }
 
     fresco_error_t decode(const uint8_t* input_data, size_t input_size,
                          uint8_t** output_data, size_t* output_size) {
-        if (!input_data || !output_data || !output_size) {
+        return config_.decode(input_data, input_size, output_data, output_size, stats_);
+    }
+
+    fresco_error_t decode_into(const uint8_t* input_data, size_t input_size, uint8_t* pixels,
+                              size_t row_stride, size_t capacity) {
+        return config_.decode_into(input_data, input_size, pixels, row_stride, capacity, stats_);
+    }
+
+    fresco_error_t decode_region(const uint8_t* input_data, size_t input_size,
+                                const fresco_region_t* region, uint8_t* pixels,
+                                size_t row_stride, size_t capacity) {
+        return config_.decode_region(input_data, input_size, region, pixels, row_stride,
+                                     capacity, stats_);
+    }
+
+    fresco_error_t decode_pyramid(const uint8_t* input_data, size_t input_size,
+                                  const fresco_pyramid_params_t* params,
+                                  fresco_pyramid_sink_t sink, void* user_data) {
+        return config_.decode_pyramid(input_data, input_size, params, sink, user_data, stats_);
+    }
+
+    fresco_error_t decode_jpeg(const uint8_t* input_data, size_t input_size,
+                               uint8_t** jpeg_data, size_t* jpeg_size) {
+        return config_.decode_jpeg(input_data, input_size, jpeg_data, jpeg_size, stats_);
+    }
+
+    fresco_error_t decode_file(const uint8_t* input_data, size_t input_size,
+                               fresco_file_format_t format, uint8_t** file_data,
+                               size_t* file_size) {
+        return config_.decode_file(input_data, input_size, format, file_data, file_size,
+                                   stats_);
+    }
+
+    fresco_error_t decode_async(const uint8_t* input_data, size_t input_size,
+                               fresco_completion_callback_t callback,
+                               fresco_completion_queue_t* queue, void* user_data) {
+        return async_.submit(
+            [this, input_data, input_size](uint8_t** output_data, size_t* output_size) {
+                return decode(input_data, input_size, output_data, output_size);
+            },
+            callback, queue, user_data);
+    }
+
+    void set_thread_pool(ThreadPool* pool) {
+        pool_ = pool;
+        config_ = DecodeConfig(params_, pool_, cache_);
+    }
+
+    void set_tile_cache(TileCache* cache) {
+        cache_ = cache;
+        config_ = DecodeConfig(params_, pool_, cache_);
+    }
+
+    const fresco_stats_t& stats() const { return stats_; }
+
+    fresco_error_t decode_vector(const uint8_t* input_data, size_t input_size,
+                                fresco_vector_path_t** paths, size_t* path_count) {
+        if (!input_data || !paths || !path_count) {
             return FRESCO_ERROR_INVALID_PARAMETER;
         }
 
         try {
-            // Parse FRESCO container
             ContainerInfo container_info;
-            fresco_error_t result = container_.parse(input_data, input_size, container_info);
+            fresco_error_t result =
+                container_.parse(input_data, input_size, container_info, params_.verify);
             if (result != FRESCO_OK) {
                 return result;
             }
 
-            // Extract compressed data
-            std::vector<uint8_t> compressed_data;
-            result = container_.extract_data(input_data, input_size, compressed_data);
+            const TrackInfo* track = container_info.find_track(TrackType::Vector);
+            if (!track) {
+                return FRESCO_ERROR_UNSUPPORTED_FORMAT;
+            }
+            result = check_track(params_, input_data, *track);
             if (result != FRESCO_OK) {
                 return result;
             }
 
-            // Decompress data
-            std::vector<uint8_t> decompressed_data;
-            result = compression_.decompress(compressed_data, container_info, params_, decompressed_data);
+            VectorData vector_data;
+            result = vector_codec_.decode(input_data + track->offset, track->size, vector_data);
             if (result != FRESCO_OK) {
                 return result;
             }
 
-            // Convert to output format
-            std::vector<uint8_t> output_format_data;
-            result = convert_to_output_format(decompressed_data, container_info, output_format_data);
+            // Path array, points and commands share one allocation
+            const size_t path_bytes = vector_data.paths.size() * sizeof(fresco_vector_path_t);
+            const size_t point_bytes = vector_data.points.size() * sizeof(float);
+            const size_t total_bytes = path_bytes + point_bytes + vector_data.commands.size();
+            uint8_t* block = static_cast<uint8_t*>(fresco_malloc(total_bytes > 0 ? total_bytes : 1));
+            if (!block) {
+                return FRESCO_ERROR_OUT_OF_MEMORY;
+            }
+
+            auto* out_paths = reinterpret_cast<fresco_vector_path_t*>(block);
+            auto* out_points = reinterpret_cast<float*>(block + path_bytes);
+            uint8_t* out_commands = block + path_bytes + point_bytes;
+            std::memcpy(out_points, vector_data.points.data(), point_bytes);
+            std::memcpy(out_commands, vector_data.commands.data(), vector_data.commands.size());
+
+            size_t command_offset = 0;
+            size_t point_offset = 0;
+            for (size_t i = 0; i < vector_data.paths.size(); i++) {
+                const VectorPath& path = vector_data.paths[i];
+                out_paths[i].commands = out_commands + command_offset;
+                out_paths[i].command_count = path.command_count;
+                out_paths[i].points = out_points + point_offset * 2;
+                out_paths[i].point_count = path.point_count;
+                out_paths[i].fill_color = path.fill_color;
+                out_paths[i].fill_rule = static_cast<fresco_fill_rule_t>(path.fill_rule);
+                command_offset += path.command_count;
+                point_offset += path.point_count;
+            }
+
+            *paths = out_paths;
+            *path_count = vector_data.paths.size();
+            return FRESCO_OK;
+        } catch (const std::bad_alloc&) {
+            return FRESCO_ERROR_OUT_OF_MEMORY;
+        } catch (const std::exception& e) {
+            return FRESCO_ERROR_DECODING_FAILED;
+        }
+    }
+
+    fresco_error_t decode_mesh(const uint8_t* input_data, size_t input_size, fresco_mesh_t** mesh) {
+        // Full resolution: every leaf of a progressive track
+        return decode_mesh_lod(input_data, input_size, UINT32_MAX, nullptr, nullptr, mesh);
+    }
+
+    fresco_error_t get_mesh_nodes(const uint8_t* input_data, size_t input_size,
+                                 fresco_mesh_node_t** nodes, size_t* node_count) {
+        if (!input_data || !nodes || !node_count) {
+            return FRESCO_ERROR_INVALID_PARAMETER;
+        }
+
+        try {
+            const uint8_t* mesh_track = nullptr;
+            std::vector<MeshLodNode> index;
+            fresco_error_t result = read_mesh_index(input_data, input_size, mesh_track, index);
             if (result != FRESCO_OK) {
                 return result;
             }
 
-            // Allocate output buffer
-            *output_size = output_format_data.size();
-            *output_data = static_cast<uint8_t*>(fresco_malloc(*output_size));
-            if (!*output_data) {
+            auto* out = static_cast<fresco_mesh_node_t*>(
+                fresco_malloc(index.size() * sizeof(fresco_mesh_node_t)));
+            if (!out) {
                 return FRESCO_ERROR_OUT_OF_MEMORY;
             }
+            for (size_t i = 0; i < index.size(); i++) {
+                const MeshLodNode& node = index[i];
+                out[i].level = node.level;
+                out[i].parent = node.parent;
+                out[i].first_child = node.first_child;
+                out[i].child_count = node.child_count;
+                std::memcpy(out[i].bounds_min, node.bounds_min, sizeof(out[i].bounds_min));
+                out[i].bounds_size = node.bounds_size;
+                out[i].error = node.error;
+                out[i].triangle_count = static_cast<size_t>(node.triangle_count);
+                out[i].compressed_size = node.chunk_size;
+            }
 
-            // Copy data to output buffer
-            std::memcpy(*output_data, output_format_data.data(), *output_size);
-
+            *nodes = out;
+            *node_count = index.size();
             return FRESCO_OK;
+        } catch (const std::bad_alloc&) {
+            return FRESCO_ERROR_OUT_OF_MEMORY;
+        } catch (const std::exception& e) {
+            return FRESCO_ERROR_DECODING_FAILED;
+        }
+    }
+
+    fresco_error_t decode_mesh_nodes(const uint8_t* input_data, size_t input_size,
+                                    const uint32_t* node_indices, size_t node_count,
+                                    fresco_mesh_t** mesh) {
+        if (!input_data || !mesh || (node_count > 0 && !node_indices)) {
+            return FRESCO_ERROR_INVALID_PARAMETER;
+        }
+
+        try {
+            const uint8_t* mesh_track = nullptr;
+            std::vector<MeshLodNode> index;
+            fresco_error_t result = read_mesh_index(input_data, input_size, mesh_track, index);
+            if (result != FRESCO_OK) {
+                return result;
+            }
+            MeshData mesh_data;
+            result = mesh_lod_.decode(mesh_track, index, node_indices, node_count, mesh_data);
+            if (result != FRESCO_OK) {
+                return result;
+            }
+            return pack_mesh(mesh_data, mesh);
+        } catch (const std::bad_alloc&) {
+            return FRESCO_ERROR_OUT_OF_MEMORY;
+        } catch (const std::exception& e) {
+            return FRESCO_ERROR_DECODING_FAILED;
+        }
+    }
+
+    fresco_error_t decode_mesh_lod(const uint8_t* input_data, size_t input_size, uint32_t level,
+                                  const float* region_min, const float* region_max,
+                                  fresco_mesh_t** mesh) {
+        if (!input_data || !mesh) {
+            return FRESCO_ERROR_INVALID_PARAMETER;
+        }
+
+        try {
+            const uint8_t* mesh_track = nullptr;
+            std::vector<MeshLodNode> index;
+            fresco_error_t result = read_mesh_index(input_data, input_size, mesh_track, index);
+            if (result != FRESCO_OK) {
+                return result;
+            }
+            std::vector<uint32_t> selected;
+            MeshLodCodec::select(index, level, region_min, region_max, selected);
+            MeshData mesh_data;
+            result = mesh_lod_.decode(mesh_track, index, selected.data(), selected.size(),
+                                      mesh_data);
+            if (result != FRESCO_OK) {
+                return result;
+            }
+            return pack_mesh(mesh_data, mesh);
+        } catch (const std::bad_alloc&) {
+            return FRESCO_ERROR_OUT_OF_MEMORY;
         } catch (const std::exception& e) {
             return FRESCO_ERROR_DECODING_FAILED;
         }
@@ -98,21 +847,14 @@ public:
         try {
             // Parse container header only
             ContainerInfo container_info;
-            fresco_error_t result = container_.parse_header(input_data, input_size, container_info);
+            fresco_error_t result =
+                container_.parse_header(input_data, input_size, container_info, params_.verify);
             if (result != FRESCO_OK) {
                 return result;
             }
 
             // Fill metadata structure
-            metadata->width = container_info.width;
-            metadata->height = container_info.height;
-            metadata->channels = container_info.channels;
-            metadata->bit_depth = container_info.bit_depth;
-            metadata->colorspace = container_info.colorspace;
-            metadata->frame_count = container_info.frame_count;
-            metadata->frame_rate = container_info.frame_rate;
-            metadata->file_size = input_size;
-            metadata->compressed_size = container_info.compressed_size;
+            fill_metadata(container_info, input_size, *metadata);
 
             return FRESCO_OK;
         } catch (const std::exception& e) {
@@ -121,9 +863,68 @@ public:
     }
 
 private:
-    fresco_decode_params_t params_;
+    // Locates the 3D track and parses its chunk index. Chunks are read one
+    // by one, so the track is checked only with ALWAYS.
+    fresco_error_t read_mesh_index(const uint8_t* input_data, size_t input_size,
+                                  const uint8_t*& mesh_track, std::vector<MeshLodNode>& index) {
+        ContainerInfo container_info;
+        fresco_error_t result =
+            container_.parse(input_data, input_size, container_info, params_.verify);
+        if (result != FRESCO_OK) {
+            return result;
+        }
+        const TrackInfo* track = container_info.find_track(TrackType::Mesh);
+        if (!track) {
+            return FRESCO_ERROR_UNSUPPORTED_FORMAT;
+        }
+        mesh_track = input_data + track->offset;
+        return MeshLodCodec::read_index(mesh_track, track->size, index);
+    }
+
+    fresco_error_t pack_mesh(const MeshData& mesh_data, fresco_mesh_t** mesh) {
+        // Descriptor, attributes and indices share one allocation
+        const size_t position_bytes = mesh_data.positions.size() * sizeof(float);
+        const size_t normal_bytes = mesh_data.normals.size() * sizeof(float);
+        const size_t uv_bytes = mesh_data.uvs.size() * sizeof(float);
+        const size_t index_bytes = mesh_data.indices.size() * sizeof(uint32_t);
+        uint8_t* block = static_cast<uint8_t*>(fresco_malloc(
+            sizeof(fresco_mesh_t) + position_bytes + normal_bytes + uv_bytes + index_bytes));
+        if (!block) {
+            return FRESCO_ERROR_OUT_OF_MEMORY;
+        }
+
+        auto* out = reinterpret_cast<fresco_mesh_t*>(block);
+        uint8_t* cursor = block + sizeof(fresco_mesh_t);
+        auto place = [&cursor](const void* data, size_t bytes) -> uint8_t* {
+            if (bytes == 0) {
+                return nullptr;
+            }
+            uint8_t* destination = cursor;
+            std::memcpy(destination, data, bytes);
+            cursor += bytes;
+            return destination;
+        };
+        out->positions = reinterpret_cast<const float*>(place(mesh_data.positions.data(), position_bytes));
+        out->normals = reinterpret_cast<const float*>(place(mesh_data.normals.data(), normal_bytes));
+        out->uvs = reinterpret_cast<const float*>(place(mesh_data.uvs.data(), uv_bytes));
+        out->vertex_count = mesh_data.vertex_count();
+        out->indices = reinterpret_cast<const uint32_t*>(place(mesh_data.indices.data(), index_bytes));
+        out->triangle_count = mesh_data.triangle_count();
+
+        *mesh = out;
+        return FRESCO_OK;
+    }
+
+    fresco_decode_params_t params_ = default_decode_params();
+    ThreadPool* pool_ = nullptr;
+    TileCache* cache_ = nullptr;
+    DecodeConfig config_;
+    fresco_stats_t stats_ = {};
     Container container_;
-    Compression compression_;
+    VectorCodec vector_codec_;
+    MeshLodCodec mesh_lod_;
+    // Last, so pending calls finish before the rest is destroyed
+    AsyncWorker async_;
 };
 
 } // namespace fresco
@@ -151,6 +952,26 @@ void fresco_decoder_destroy(fresco_decoder_t* decoder) {
     }
 }
 
+fresco_error_t fresco_decoder_set_thread_pool(fresco_decoder_t* decoder, fresco_thread_pool_t* pool) {
+    if (!decoder) {
+        return FRESCO_ERROR_INVALID_PARAMETER;
+    }
+
+    auto* impl = reinterpret_cast<fresco::DecoderImpl*>(decoder);
+    impl->set_thread_pool(reinterpret_cast<fresco::ThreadPool*>(pool));
+    return FRESCO_OK;
+}
+
+fresco_error_t fresco_decoder_set_tile_cache(fresco_decoder_t* decoder, fresco_tile_cache_t* cache) {
+    if (!decoder) {
+        return FRESCO_ERROR_INVALID_PARAMETER;
+    }
+
+    auto* impl = reinterpret_cast<fresco::DecoderImpl*>(decoder);
+    impl->set_tile_cache(reinterpret_cast<fresco::TileCache*>(cache));
+    return FRESCO_OK;
+}
+
 fresco_error_t fresco_decoder_set_params(fresco_decoder_t* decoder,
                                         const fresco_decode_params_t* params) {
     if (!decoder) {
@@ -174,6 +995,276 @@ fresco_error_t fresco_decoder_decode(fresco_decoder_t* decoder,
     return impl->decode(input_data, input_size, output_data, output_size);
 }
 
+fresco_error_t fresco_decoder_decode_into(fresco_decoder_t* decoder,
+                                         const uint8_t* input_data,
+                                         size_t input_size,
+                                         uint8_t* pixels,
+                                         size_t row_stride,
+                                         size_t capacity) {
+    if (!decoder) {
+        return FRESCO_ERROR_INVALID_PARAMETER;
+    }
+
+    auto* impl = reinterpret_cast<fresco::DecoderImpl*>(decoder);
+    return impl->decode_into(input_data, input_size, pixels, row_stride, capacity);
+}
+
+fresco_error_t fresco_decoder_decode_region(fresco_decoder_t* decoder,
+                                           const uint8_t* input_data,
+                                           size_t input_size,
+                                           const fresco_region_t* region,
+                                           uint8_t* pixels,
+                                           size_t row_stride,
+                                           size_t capacity) {
+    if (!decoder) {
+        return FRESCO_ERROR_INVALID_PARAMETER;
+    }
+
+    auto* impl = reinterpret_cast<fresco::DecoderImpl*>(decoder);
+    return impl->decode_region(input_data, input_size, region, pixels, row_stride, capacity);
+}
+
+fresco_error_t fresco_decoder_decode_pyramid(fresco_decoder_t* decoder,
+                                            const uint8_t* input_data,
+                                            size_t input_size,
+                                            const fresco_pyramid_params_t* params,
+                                            fresco_pyramid_sink_t sink,
+                                            void* user_data) {
+    if (!decoder) {
+        return FRESCO_ERROR_INVALID_PARAMETER;
+    }
+
+    auto* impl = reinterpret_cast<fresco::DecoderImpl*>(decoder);
+    return impl->decode_pyramid(input_data, input_size, params, sink, user_data);
+}
+
+fresco_error_t fresco_decoder_decode_jpeg(fresco_decoder_t* decoder,
+                                         const uint8_t* input_data,
+                                         size_t input_size,
+                                         uint8_t** jpeg_data,
+                                         size_t* jpeg_size) {
+    if (!decoder) {
+        return FRESCO_ERROR_INVALID_PARAMETER;
+    }
+
+    auto* impl = reinterpret_cast<fresco::DecoderImpl*>(decoder);
+    return impl->decode_jpeg(input_data, input_size, jpeg_data, jpeg_size);
+}
+
+fresco_error_t fresco_decoder_decode_file(fresco_decoder_t* decoder,
+                                         const uint8_t* input_data,
+                                         size_t input_size,
+                                         fresco_file_format_t format,
+                                         uint8_t** file_data,
+                                         size_t* file_size) {
+    if (!decoder) {
+        return FRESCO_ERROR_INVALID_PARAMETER;
+    }
+
+    auto* impl = reinterpret_cast<fresco::DecoderImpl*>(decoder);
+    return impl->decode_file(input_data, input_size, format, file_data, file_size);
+}
+
+fresco_error_t fresco_write_image_file(const fresco_image_t* image,
+                                      fresco_file_format_t format,
+                                      uint8_t** file_data,
+                                      size_t* file_size) {
+    if (!image || !image->pixels || !file_data || !file_size) {
+        return FRESCO_ERROR_INVALID_PARAMETER;
+    }
+    const size_t row_bytes = static_cast<size_t>(image->width) * image->channels;
+    const size_t row_stride = image->row_stride ? image->row_stride : row_bytes;
+    if (row_stride < row_bytes) {
+        return FRESCO_ERROR_INVALID_PARAMETER;
+    }
+
+    std::unique_ptr<fresco::ImageWriter> writer;
+    fresco_error_t result = fresco::create_image_writer(format, image->width, image->height,
+                                                        image->channels, writer);
+    if (result != FRESCO_OK) {
+        return result;
+    }
+    try {
+        result = writer->write_rows(image->pixels, row_stride, image->height);
+        std::vector<uint8_t> file;
+        if (result == FRESCO_OK) {
+            result = writer->finish(file);
+        }
+        if (result == FRESCO_OK) {
+            result = fresco::copy_out(file, file_data, file_size);
+        }
+        return result;
+    } catch (const std::bad_alloc&) {
+        return FRESCO_ERROR_OUT_OF_MEMORY;
+    }
+}
+
+fresco_error_t fresco_decoder_decode_async(fresco_decoder_t* decoder,
+                                          const uint8_t* input_data,
+                                          size_t input_size,
+                                          fresco_completion_callback_t callback,
+                                          fresco_completion_queue_t* queue,
+                                          void* user_data) {
+    if (!decoder) {
+        return FRESCO_ERROR_INVALID_PARAMETER;
+    }
+
+    auto* impl = reinterpret_cast<fresco::DecoderImpl*>(decoder);
+    return impl->decode_async(input_data, input_size, callback, queue, user_data);
+}
+
+fresco_error_t fresco_decoder_get_stats(const fresco_decoder_t* decoder, fresco_stats_t* stats) {
+    if (!decoder || !stats) {
+        return FRESCO_ERROR_INVALID_PARAMETER;
+    }
+
+    *stats = reinterpret_cast<const fresco::DecoderImpl*>(decoder)->stats();
+    return FRESCO_OK;
+}
+
+fresco_error_t fresco_decoder_config_create(const fresco_decode_params_t* params,
+                                           fresco_thread_pool_t* pool,
+                                           fresco_tile_cache_t* cache,
+                                           fresco_decoder_config_t** config) {
+    if (!config || (params && params->verify > FRESCO_VERIFY_SKIP)) {
+        return FRESCO_ERROR_INVALID_PARAMETER;
+    }
+
+    try {
+        *config = reinterpret_cast<fresco_decoder_config_t*>(new fresco::DecodeConfig(
+            params ? *params : fresco::default_decode_params(),
+            reinterpret_cast<fresco::ThreadPool*>(pool),
+            reinterpret_cast<fresco::TileCache*>(cache)));
+        return FRESCO_OK;
+    } catch (const std::exception&) {
+        return FRESCO_ERROR_OUT_OF_MEMORY;
+    }
+}
+
+void fresco_decoder_config_destroy(fresco_decoder_config_t* config) {
+    if (config) {
+        delete reinterpret_cast<fresco::DecodeConfig*>(config);
+    }
+}
+
+fresco_error_t fresco_decoder_config_decode(const fresco_decoder_config_t* config,
+                                           const uint8_t* input_data,
+                                           size_t input_size,
+                                           uint8_t** output_data,
+                                           size_t* output_size,
+                                           fresco_stats_t* stats) {
+    if (!config) {
+        return FRESCO_ERROR_INVALID_PARAMETER;
+    }
+
+    const auto* impl = reinterpret_cast<const fresco::DecodeConfig*>(config);
+    fresco_stats_t call_stats;
+    return impl->decode(input_data, input_size, output_data, output_size,
+                        stats ? *stats : call_stats);
+}
+
+fresco_error_t fresco_decoder_config_decode_into(const fresco_decoder_config_t* config,
+                                                const uint8_t* input_data,
+                                                size_t input_size,
+                                                uint8_t* pixels,
+                                                size_t row_stride,
+                                                size_t capacity,
+                                                fresco_stats_t* stats) {
+    if (!config) {
+        return FRESCO_ERROR_INVALID_PARAMETER;
+    }
+
+    const auto* impl = reinterpret_cast<const fresco::DecodeConfig*>(config);
+    fresco_stats_t call_stats;
+    return impl->decode_into(input_data, input_size, pixels, row_stride, capacity,
+                             stats ? *stats : call_stats);
+}
+
+fresco_error_t fresco_decoder_config_decode_region(const fresco_decoder_config_t* config,
+                                                  const uint8_t* input_data,
+                                                  size_t input_size,
+                                                  const fresco_region_t* region,
+                                                  uint8_t* pixels,
+                                                  size_t row_stride,
+                                                  size_t capacity,
+                                                  fresco_stats_t* stats) {
+    if (!config) {
+        return FRESCO_ERROR_INVALID_PARAMETER;
+    }
+
+    const auto* impl = reinterpret_cast<const fresco::DecodeConfig*>(config);
+    fresco_stats_t call_stats;
+    return impl->decode_region(input_data, input_size, region, pixels, row_stride, capacity,
+                               stats ? *stats : call_stats);
+}
+
+fresco_error_t fresco_decoder_decode_vector(fresco_decoder_t* decoder,
+                                           const uint8_t* input_data,
+                                           size_t input_size,
+                                           fresco_vector_path_t** paths,
+                                           size_t* path_count) {
+    if (!decoder) {
+        return FRESCO_ERROR_INVALID_PARAMETER;
+    }
+
+    auto* impl = reinterpret_cast<fresco::DecoderImpl*>(decoder);
+    return impl->decode_vector(input_data, input_size, paths, path_count);
+}
+
+fresco_error_t fresco_decoder_decode_mesh(fresco_decoder_t* decoder,
+                                         const uint8_t* input_data,
+                                         size_t input_size,
+                                         fresco_mesh_t** mesh) {
+    if (!decoder) {
+        return FRESCO_ERROR_INVALID_PARAMETER;
+    }
+
+    auto* impl = reinterpret_cast<fresco::DecoderImpl*>(decoder);
+    return impl->decode_mesh(input_data, input_size, mesh);
+}
+
+fresco_error_t fresco_decoder_get_mesh_nodes(fresco_decoder_t* decoder,
+                                            const uint8_t* input_data,
+                                            size_t input_size,
+                                            fresco_mesh_node_t** nodes,
+                                            size_t* node_count) {
+    if (!decoder) {
+        return FRESCO_ERROR_INVALID_PARAMETER;
+    }
+
+    auto* impl = reinterpret_cast<fresco::DecoderImpl*>(decoder);
+    return impl->get_mesh_nodes(input_data, input_size, nodes, node_count);
+}
+
+fresco_error_t fresco_decoder_decode_mesh_nodes(fresco_decoder_t* decoder,
+                                               const uint8_t* input_data,
+                                               size_t input_size,
+                                               const uint32_t* node_indices,
+                                               size_t node_count,
+                                               fresco_mesh_t** mesh) {
+    if (!decoder) {
+        return FRESCO_ERROR_INVALID_PARAMETER;
+    }
+
+    auto* impl = reinterpret_cast<fresco::DecoderImpl*>(decoder);
+    return impl->decode_mesh_nodes(input_data, input_size, node_indices, node_count, mesh);
+}
+
+fresco_error_t fresco_decoder_decode_mesh_lod(fresco_decoder_t* decoder,
+                                             const uint8_t* input_data,
+                                             size_t input_size,
+                                             uint32_t level,
+                                             const float* region_min,
+                                             const float* region_max,
+                                             fresco_mesh_t** mesh) {
+    if (!decoder) {
+        return FRESCO_ERROR_INVALID_PARAMETER;
+    }
+
+    auto* impl = reinterpret_cast<fresco::DecoderImpl*>(decoder);
+    return impl->decode_mesh_lod(input_data, input_size, level, region_min, region_max, mesh);
+}
+
 fresco_error_t fresco_get_metadata(const uint8_t* input_data,
                                   size_t input_size,
                                   fresco_metadata_t* metadata) {
@@ -0,0 +1,430 @@
+/**
+ * @file deflate.cpp
+ * @brief FRESCO zlib stream encoding
+ * @author Mehmet T. AKALIN
+ * @date 2025
+ * @license MIT
+ */
+
+#include "deflate.h"
+#include "checksum.h"
+#include <algorithm>
+#include <cstring>
+
+namespace fresco {
+
+namespace {
+
+constexpr size_t kWindowSize = 32768;
+constexpr size_t kBlockSize = 1 << 17;    // Input coded as one block
+constexpr uint32_t kHashBits = 15;
+constexpr uint32_t kMinMatch = 4;          // The hash covers 4 bytes
+constexpr uint32_t kMaxMatch = 258;
+constexpr uint32_t kMatchFlag = 1u << 31;  // Tokens: (length << 16) | distance
+constexpr uint32_t kMaxStored = 65535;
+constexpr uint32_t kLiteralCount = 286;
+constexpr uint32_t kDistanceCount = 30;
+constexpr uint32_t kEndOfBlock = 256;
+
+constexpr uint16_t kLengthBase[29] = {3,  4,  5,  6,  7,  8,  9,  10, 11,  13,
+                                      15, 17, 19, 23, 27, 31, 35, 43, 51,  59,
+                                      67, 83, 99, 115, 131, 163, 195, 227, 258};
+constexpr uint8_t kLengthExtra[29] = {0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2,
+                                      2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0};
+constexpr uint16_t kDistanceBase[30] = {1,    2,    3,    4,    5,    7,     9,     13,
+                                        17,   25,   33,   49,   65,   97,    129,   193,
+                                        257,  385,  513,  769,  1025, 1537,  2049,  3073,
+                                        4097, 6145, 8193, 12289, 16385, 24577};
+constexpr uint8_t kDistanceExtra[30] = {0, 0, 0, 0, 1, 1, 2, 2,  3,  3,  4,  4,  5,  5,  6,
+                                        6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13};
+constexpr uint8_t kCodeLengthOrder[19] = {16, 17, 18, 0, 8,  7, 9,  6, 10, 5,
+                                          11, 4,  12, 3, 13, 2, 14, 1, 15};
+
+// Length and distance codes by value. Distances up to 256 are looked up
+// directly, longer ones by (distance - 1) >> 7, as in zlib.
+struct SymbolTables {
+    uint8_t length_code[kMaxMatch + 1];
+    uint8_t distance_code[512];
+
+    SymbolTables() {
+        for (uint32_t code = 0; code < 29; code++) {
+            const uint32_t last = code == 28 ? kMaxMatch : kLengthBase[code + 1] - 1u;
+            for (uint32_t length = kLengthBase[code]; length <= last; length++) {
+                length_code[length] = static_cast<uint8_t>(code);
+            }
+        }
+        for (uint32_t code = 0; code < 30; code++) {
+            const uint32_t last = code == 29 ? 32768 : kDistanceBase[code + 1] - 1u;
+            for (uint32_t distance = kDistanceBase[code]; distance <= last; distance++) {
+                if (distance <= 256) {
+                    distance_code[distance - 1] = static_cast<uint8_t>(code);
+                } else {
+                    distance_code[256 + ((distance - 1) >> 7)] = static_cast<uint8_t>(code);
+                }
+            }
+        }
+    }
+
+    uint32_t distance(uint32_t value) const {
+        return value <= 256 ? distance_code[value - 1] : distance_code[256 + ((value - 1) >> 7)];
+    }
+};
+
+const SymbolTables& symbol_tables() {
+    static const SymbolTables tables;
+    return tables;
+}
+
+inline uint32_t load_u32(const uint8_t* p) {
+    uint32_t value;
+    std::memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+// Code lengths of at most limit bits for the symbols of nonzero frequency:
+// a Huffman tree, then the over-long codes moved up as in JPEG Annex K.2
+void build_lengths(const uint32_t* frequency, uint32_t count, uint32_t limit, uint8_t* lengths) {
+    std::fill(lengths, lengths + count, 0);
+    std::vector<uint32_t> symbols;
+    for (uint32_t i = 0; i < count; i++) {
+        if (frequency[i]) {
+            symbols.push_back(i);
+        }
+    }
+    // Decoders want a complete code, which takes two symbols
+    if (symbols.size() < 2) {
+        const uint32_t first = symbols.empty() ? 0 : symbols[0];
+        lengths[first] = 1;
+        lengths[first == 0 ? 1 : 0] = 1;
+        return;
+    }
+    std::stable_sort(symbols.begin(), symbols.end(),
+                     [&](uint32_t a, uint32_t b) { return frequency[a] < frequency[b]; });
+
+    // Two-queue construction over the sorted leaves: nodes [0, n) are the
+    // leaves, [n, 2n - 1) the internal nodes in the order they are made
+    const size_t n = symbols.size();
+    std::vector<uint64_t> weight(2 * n - 1);
+    std::vector<uint32_t> parent(2 * n - 1);
+    for (size_t i = 0; i < n; i++) {
+        weight[i] = frequency[symbols[i]];
+    }
+    size_t leaf = 0, internal = n;
+    for (size_t node = n; node < 2 * n - 1; node++) {
+        for (int child = 0; child < 2; child++) {
+            const bool take_leaf =
+                leaf < n && (internal == node || weight[leaf] <= weight[internal]);
+            const size_t chosen = take_leaf ? leaf++ : internal++;
+            parent[chosen] = static_cast<uint32_t>(node);
+            weight[node] += weight[chosen];
+        }
+    }
+    std::vector<uint32_t> depth(2 * n - 1, 0);
+    std::vector<uint32_t> length_count(n + 1, 0);
+    for (size_t node = 2 * n - 1; node-- > 0;) {
+        if (node != 2 * n - 2) {
+            depth[node] = depth[parent[node]] + 1;
+        }
+        if (node < n) {
+            length_count[depth[node]]++;
+        }
+    }
+
+    for (uint32_t length = static_cast<uint32_t>(n); length > limit; length--) {
+        while (length_count[length] > 0) {
+            uint32_t shorter = length - 2;
+            while (length_count[shorter] == 0) {
+                shorter--;
+            }
+            length_count[length] -= 2;
+            length_count[length - 1]++;
+            length_count[shorter + 1] += 2;
+            length_count[shorter]--;
+        }
+    }
+
+    // The rarest symbols take the longest codes
+    size_t next = 0;
+    for (uint32_t length = std::min<uint32_t>(limit, static_cast<uint32_t>(n)); length > 0;
+         length--) {
+        for (uint32_t i = 0; i < length_count[length]; i++) {
+            lengths[symbols[next++]] = static_cast<uint8_t>(length);
+        }
+    }
+}
+
+// Canonical codes for lengths, bit-reversed to be written least
+// significant bit first
+void build_codes(const uint8_t* lengths, uint32_t count, uint16_t* codes) {
+    uint32_t length_count[16] = {};
+    for (uint32_t i = 0; i < count; i++) {
+        length_count[lengths[i]]++;
+    }
+    length_count[0] = 0;
+    uint32_t next[16] = {};
+    uint32_t code = 0;
+    for (uint32_t length = 1; length < 16; length++) {
+        code = (code + length_count[length - 1]) << 1;
+        next[length] = code;
+    }
+    for (uint32_t i = 0; i < count; i++) {
+        const uint32_t length = lengths[i];
+        if (length == 0) {
+            codes[i] = 0;
+            continue;
+        }
+        uint32_t value = next[length]++;
+        uint32_t reversed = 0;
+        for (uint32_t bit = 0; bit < length; bit++) {
+            reversed = (reversed << 1) | ((value >> bit) & 1);
+        }
+        codes[i] = static_cast<uint16_t>(reversed);
+    }
+}
+
+// Run-length codes of a dynamic block's code lengths: each entry is the
+// symbol in the low byte and its extra bits above
+void run_length_code(const uint8_t* lengths, uint32_t count, std::vector<uint32_t>& out) {
+    for (uint32_t i = 0; i < count;) {
+        const uint8_t value = lengths[i];
+        uint32_t run = 1;
+        while (i + run < count && lengths[i + run] == value) {
+            run++;
+        }
+        i += run;
+        if (value == 0) {
+            while (run >= 11) {
+                const uint32_t take = std::min<uint32_t>(run, 138);
+                out.push_back(18 | ((take - 11) << 8));
+                run -= take;
+            }
+            if (run >= 3) {
+                out.push_back(17 | ((run - 3) << 8));
+                run = 0;
+            }
+        } else {
+            out.push_back(value);
+            run--;
+            while (run >= 3) {
+                const uint32_t take = std::min<uint32_t>(run, 6);
+                out.push_back(16 | ((take - 3) << 8));
+                run -= take;
+            }
+        }
+        for (; run > 0; run--) {
+            out.push_back(value);
+        }
+    }
+}
+
+constexpr uint8_t kRunExtraBits[19] = {0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+                                       0, 0, 0, 0, 0, 0, 2, 3, 7};
+
+} // namespace
+
+Deflater::Deflater(uint32_t level) : level_(level) {
+    if (level_ > 0) {
+        hash_.assign(size_t(1) << kHashBits, 0);
+    }
+}
+
+void Deflater::put_bits(uint32_t value, uint32_t count, std::vector<uint8_t>& out) {
+    bits_ |= static_cast<uint64_t>(value) << bit_count_;
+    bit_count_ += count;
+    while (bit_count_ >= 8) {
+        out.push_back(static_cast<uint8_t>(bits_));
+        bits_ >>= 8;
+        bit_count_ -= 8;
+    }
+}
+
+void Deflater::align(std::vector<uint8_t>& out) {
+    if (bit_count_ > 0) {
+        put_bits(0, 8 - bit_count_, out);
+    }
+}
+
+void Deflater::write(const uint8_t* data, size_t size, std::vector<uint8_t>& out) {
+    if (!header_written_) {
+        // Deflate with a 32 KiB window, fastest compression level
+        out.push_back(0x78);
+        out.push_back(0x01);
+        header_written_ = true;
+    }
+    adler_ = adler32(adler_, data, size);
+    buffer_.insert(buffer_.end(), data, data + size);
+    while (buffer_.size() - history_ >= kBlockSize) {
+        compress_block(kBlockSize, false, out);
+    }
+}
+
+void Deflater::finish(std::vector<uint8_t>& out) {
+    write(nullptr, 0, out);
+    compress_block(buffer_.size() - history_, true, out);
+    align(out);
+    for (int shift = 24; shift >= 0; shift -= 8) {
+        out.push_back(static_cast<uint8_t>(adler_ >> shift));
+    }
+}
+
+void Deflater::write_stored(const uint8_t* data, size_t size, bool final,
+                            std::vector<uint8_t>& out) {
+    do {
+        const uint32_t length = static_cast<uint32_t>(std::min<size_t>(size, kMaxStored));
+        put_bits(final && length == size ? 1 : 0, 1, out);
+        put_bits(0, 2, out);
+        align(out);
+        put_bits(length, 16, out);
+        put_bits(~length & 0xFFFF, 16, out);
+        out.insert(out.end(), data, data + length);
+        data += length;
+        size -= length;
+    } while (size > 0);
+}
+
+void Deflater::compress_block(size_t size, bool final, std::vector<uint8_t>& out) {
+    const uint8_t* data = buffer_.data();
+    const size_t start = history_;
+    const size_t end = history_ + size;
+
+    if (level_ == 0) {
+        write_stored(data + start, size, final, out);
+    } else {
+        // Greedy parse: the last position with the same 4-byte hash is the
+        // only candidate
+        tokens_.clear();
+        uint32_t literal_frequency[kLiteralCount] = {};
+        uint32_t distance_frequency[kDistanceCount] = {};
+        const SymbolTables& tables = symbol_tables();
+        size_t pos = start;
+        while (pos + kMinMatch <= end) {
+            const uint32_t word = load_u32(data + pos);
+            const uint32_t hash = (word * 0x9E3779B1u) >> (32 - kHashBits);
+            const uint32_t here = static_cast<uint32_t>(buffer_start_ + pos);
+            const uint32_t candidate = hash_[hash];
+            hash_[hash] = here + 1;
+            if (candidate) {
+                const uint32_t distance = here - (candidate - 1);
+                if (distance >= 1 && distance <= kWindowSize && distance <= pos &&
+                    load_u32(data + pos - distance) == word) {
+                    const size_t longest = std::min<size_t>(kMaxMatch, end - pos);
+                    size_t length = kMinMatch;
+                    while (length < longest && data[pos + length] == data[pos + length - distance]) {
+                        length++;
+                    }
+                    tokens_.push_back(kMatchFlag | static_cast<uint32_t>(length << 16) | distance);
+                    literal_frequency[257 + tables.length_code[length]]++;
+                    distance_frequency[tables.distance(distance)]++;
+                    pos += length;
+                    continue;
+                }
+            }
+            tokens_.push_back(data[pos]);
+            literal_frequency[data[pos]]++;
+            pos++;
+        }
+        for (; pos < end; pos++) {
+            tokens_.push_back(data[pos]);
+            literal_frequency[data[pos]]++;
+        }
+        literal_frequency[kEndOfBlock]++;
+
+        uint8_t lengths[kLiteralCount + kDistanceCount];
+        build_lengths(literal_frequency, kLiteralCount, 15, lengths);
+        build_lengths(distance_frequency, kDistanceCount, 15, lengths + kLiteralCount);
+        uint32_t literal_count = kLiteralCount;
+        while (literal_count > 257 && lengths[literal_count - 1] == 0) {
+            literal_count--;
+        }
+        uint32_t distance_count = kDistanceCount;
+        while (distance_count > 1 && lengths[kLiteralCount + distance_count - 1] == 0) {
+            distance_count--;
+        }
+        // The two code length sequences are coded as one
+        uint8_t sequence[kLiteralCount + kDistanceCount];
+        std::memcpy(sequence, lengths, literal_count);
+        std::memcpy(sequence + literal_count, lengths + kLiteralCount, distance_count);
+        std::vector<uint32_t> runs;
+        run_length_code(sequence, literal_count + distance_count, runs);
+        uint32_t run_frequency[19] = {};
+        for (uint32_t run : runs) {
+            run_frequency[run & 0xFF]++;
+        }
+        uint8_t run_lengths[19];
+        build_lengths(run_frequency, 19, 7, run_lengths);
+        uint32_t run_length_count = 19;
+        while (run_length_count > 4 && run_lengths[kCodeLengthOrder[run_length_count - 1]] == 0) {
+            run_length_count--;
+        }
+
+        // Coded size, to fall back to stored blocks for incompressible data
+        uint64_t coded_bits = 3 + 14 + 3 * run_length_count;
+        for (uint32_t s = 0; s < 19; s++) {
+            coded_bits += static_cast<uint64_t>(run_frequency[s]) * (run_lengths[s] + kRunExtraBits[s]);
+        }
+        for (uint32_t s = 0; s < kLiteralCount; s++) {
+            coded_bits += static_cast<uint64_t>(literal_frequency[s]) *
+                          (lengths[s] + (s > 256 ? kLengthExtra[s - 257] : 0));
+        }
+        for (uint32_t s = 0; s < kDistanceCount; s++) {
+            coded_bits += static_cast<uint64_t>(distance_frequency[s]) *
+                          (lengths[kLiteralCount + s] + kDistanceExtra[s]);
+        }
+        const uint64_t stored_bits = (size + 5 * (size / kMaxStored + 1)) * 8 + 10;
+        if (stored_bits <= coded_bits) {
+            write_stored(data + start, size, final, out);
+        } else {
+            uint16_t codes[kLiteralCount + kDistanceCount];
+            build_codes(lengths, kLiteralCount, codes);
+            build_codes(lengths + kLiteralCount, kDistanceCount, codes + kLiteralCount);
+            uint16_t run_codes[19];
+            build_codes(run_lengths, 19, run_codes);
+
+            put_bits(final ? 1 : 0, 1, out);
+            put_bits(2, 2, out);
+            put_bits(literal_count - 257, 5, out);
+            put_bits(distance_count - 1, 5, out);
+            put_bits(run_length_count - 4, 4, out);
+            for (uint32_t i = 0; i < run_length_count; i++) {
+                put_bits(run_lengths[kCodeLengthOrder[i]], 3, out);
+            }
+            for (uint32_t run : runs) {
+                const uint32_t symbol = run & 0xFF;
+                put_bits(run_codes[symbol], run_lengths[symbol], out);
+                if (kRunExtraBits[symbol]) {
+                    put_bits(run >> 8, kRunExtraBits[symbol], out);
+                }
+            }
+            const uint16_t* distance_codes = codes + kLiteralCount;
+            const uint8_t* distance_lengths = lengths + kLiteralCount;
+            for (uint32_t token : tokens_) {
+                if (!(token & kMatchFlag)) {
+                    put_bits(codes[token], lengths[token], out);
+                    continue;
+                }
+                const uint32_t length = (token >> 16) & 0x1FF;
+                const uint32_t distance = token & 0xFFFF;
+                const uint32_t length_code = tables.length_code[length];
+                put_bits(codes[257 + length_code], lengths[257 + length_code], out);
+                put_bits(length - kLengthBase[length_code], kLengthExtra[length_code], out);
+                const uint32_t distance_code = tables.distance(distance);
+                put_bits(distance_codes[distance_code], distance_lengths[distance_code], out);
+                put_bits(distance - kDistanceBase[distance_code], kDistanceExtra[distance_code],
+                         out);
+            }
+            put_bits(codes[kEndOfBlock], lengths[kEndOfBlock], out);
+        }
+    }
+
+    // Keep the window that later matches may reach
+    history_ = end;
+    const size_t keep = level_ > 0 ? kWindowSize : 0;
+    if (history_ > keep) {
+        const size_t drop = history_ - keep;
+        buffer_.erase(buffer_.begin(), buffer_.begin() + drop);
+        buffer_start_ += drop;
+        history_ = keep;
+    }
+}
+
+} // namespace fresco
@@ -0,0 +1,54 @@
+/**
+ * @file deflate.h
+ * @brief FRESCO zlib stream encoding
+ * @author Mehmet T. AKALIN
+ * @date 2025
+ * @license MIT
+ */
+
+#ifndef FRESCO_DEFLATE_H
+#define FRESCO_DEFLATE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace fresco {
+
+/**
+ * Encodes a zlib stream (RFC 1950/1951) from input given in pieces of any
+ * size. Level 0 writes stored blocks. Level 1 is built for speed over
+ * ratio: one hash probe a position, greedy matches, and one dynamic Huffman
+ * code per block, with the block stored instead when that is smaller.
+ */
+class Deflater {
+public:
+    explicit Deflater(uint32_t level);
+
+    // Appends the compressed bytes that are complete to out
+    void write(const uint8_t* data, size_t size, std::vector<uint8_t>& out);
+
+    // Ends the stream with the Adler-32 of all input
+    void finish(std::vector<uint8_t>& out);
+
+private:
+    void compress_block(size_t size, bool final, std::vector<uint8_t>& out);
+    void write_stored(const uint8_t* data, size_t size, bool final, std::vector<uint8_t>& out);
+    void put_bits(uint32_t value, uint32_t count, std::vector<uint8_t>& out);
+    void align(std::vector<uint8_t>& out);
+
+    uint32_t level_;
+    std::vector<uint8_t> buffer_;    // The last 32 KiB of input, then what is not coded yet
+    size_t history_ = 0;             // Bytes of buffer_ already coded
+    uint64_t buffer_start_ = 0;      // Position in the input of buffer_[0]
+    std::vector<uint32_t> hash_;     // Last position, plus one, of each 4-byte hash
+    std::vector<uint32_t> tokens_;
+    uint64_t bits_ = 0;
+    uint32_t bit_count_ = 0;
+    uint32_t adler_ = 1;
+    bool header_written_ = false;
+};
+
+} // namespace fresco
+
+#endif // FRESCO_DEFLATE_H
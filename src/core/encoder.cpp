@@ -11,11 +11,20 @@
 #include "compression.h"
 #include "container.h"
 #include "utils.h"
+#include "stats.h"
+#include "counters.h"
+#include "async.h"
+#include "thread_pool.h"
+#include "codecs/vector_codec.h"
+#include "codecs/3d_codec.h"
+#include "codecs/mesh_lod.h"
+#include "codecs/jpeg_codec.h"
 
 #include <memory>
 #include <vector>
 #include <cstring>
 #include <algorithm>
+#include <cmath>
 
 namespace fresco {
 
@@ -31,6 +40,9 @@ public:
         params_.enable_animation = 0;
         params_.enable_3d = 0;
         params_.enable_vector = 0;
+        params_.mesh_lod_levels = 0;
+        params_.target_bytes = 0;
+        params_.target_bpp = 0.0f;
     }
 
     ~EncoderImpl() = default;
@@ -47,65 +59,388 @@ public:
         if (params->effort < 1 || params->effort > 10) {
             return FRESCO_ERROR_INVALID_PARAMETER;
         }
+        if (params->mesh_lod_levels > kMaxMeshLodLevels) {
+            return FRESCO_ERROR_INVALID_PARAMETER;
+        }
+        if (!std::isfinite(params->target_bpp) || params->target_bpp < 0.0f) {
+            return FRESCO_ERROR_INVALID_PARAMETER;
+        }
+        // A size target needs a quantizer to trade against
+        if ((params->target_bytes > 0 || params->target_bpp > 0.0f) &&
+            params->mode != FRESCO_COMPRESSION_LOSSY) {
+            return FRESCO_ERROR_INVALID_PARAMETER;
+        }
 
         params_ = *params;
         return FRESCO_OK;
     }
 
+    fresco_error_t set_vector_paths(uint32_t width, uint32_t height,
+                                   const fresco_vector_path_t* paths, size_t path_count) {
+        if (path_count > 0 && !paths) {
+            return FRESCO_ERROR_INVALID_PARAMETER;
+        }
+
+        try {
+            VectorData vector_data;
+            vector_data.width = width;
+            vector_data.height = height;
+            vector_data.paths.reserve(path_count);
+            for (size_t i = 0; i < path_count; i++) {
+                const fresco_vector_path_t& path = paths[i];
+                if ((path.command_count > 0 && !path.commands) ||
+                    (path.point_count > 0 && !path.points) ||
+                    path.command_count > UINT32_MAX || path.point_count > UINT32_MAX) {
+                    return FRESCO_ERROR_INVALID_PARAMETER;
+                }
+                vector_data.paths.push_back({static_cast<uint32_t>(path.command_count),
+                                             static_cast<uint32_t>(path.point_count),
+                                             path.fill_color,
+                                             static_cast<uint8_t>(path.fill_rule)});
+                vector_data.commands.insert(vector_data.commands.end(), path.commands,
+                                            path.commands + path.command_count);
+                vector_data.points.insert(vector_data.points.end(), path.points,
+                                          path.points + path.point_count * 2);
+            }
+
+            fresco_error_t result = VectorCodec::validate(vector_data);
+            if (result != FRESCO_OK) {
+                return result;
+            }
+
+            vector_data_ = std::move(vector_data);
+            has_vector_ = path_count > 0;
+            return FRESCO_OK;
+        } catch (const std::bad_alloc&) {
+            return FRESCO_ERROR_OUT_OF_MEMORY;
+        }
+    }
+
+    fresco_error_t set_mesh(const fresco_mesh_t* mesh) {
+        if (!mesh) {
+            mesh_data_ = MeshData();
+            has_mesh_ = false;
+            return FRESCO_OK;
+        }
+        if ((mesh->vertex_count > 0 && !mesh->positions) ||
+            (mesh->triangle_count > 0 && !mesh->indices)) {
+            return FRESCO_ERROR_INVALID_PARAMETER;
+        }
+
+        try {
+            const size_t vertex_count = mesh->vertex_count;
+            MeshData mesh_data;
+            mesh_data.positions.assign(mesh->positions, mesh->positions + vertex_count * 3);
+            if (mesh->normals) {
+                mesh_data.normals.assign(mesh->normals, mesh->normals + vertex_count * 3);
+            }
+            if (mesh->uvs) {
+                mesh_data.uvs.assign(mesh->uvs, mesh->uvs + vertex_count * 2);
+            }
+            mesh_data.indices.assign(mesh->indices, mesh->indices + mesh->triangle_count * 3);
+
+            fresco_error_t result = MeshCodec::validate(mesh_data);
+            if (result != FRESCO_OK) {
+                return result;
+            }
+
+            mesh_data_ = std::move(mesh_data);
+            has_mesh_ = vertex_count > 0;
+            return FRESCO_OK;
+        } catch (const std::bad_alloc&) {
+            return FRESCO_ERROR_OUT_OF_MEMORY;
+        }
+    }
+
     fresco_error_t encode(const uint8_t* input_data, size_t input_size,
                          uint8_t** output_data, size_t* output_size) {
-        if (!input_data || !output_data || !output_size) {
+        if ((!input_data && input_size > 0) || !output_data || !output_size) {
             return FRESCO_ERROR_INVALID_PARAMETER;
         }
 
+        const bool write_vector = params_.enable_vector && has_vector_;
+        const bool write_mesh = params_.enable_3d && has_mesh_;
+        const bool no_raster = (write_vector || write_mesh) && input_size == 0;
+        if (!input_data && !no_raster) {
+            return FRESCO_ERROR_INVALID_PARAMETER;
+        }
+
+        return encode_from(input_data, input_size, nullptr, no_raster, false, write_vector,
+                           write_mesh, input_size, output_data, output_size);
+    }
+
+    fresco_error_t encode_jpeg(const uint8_t* jpeg_data, size_t jpeg_size, uint8_t** output_data,
+                              size_t* output_size) {
+        if (!jpeg_data || jpeg_size == 0 || !output_data || !output_size) {
+            return FRESCO_ERROR_INVALID_PARAMETER;
+        }
+        return encode_from(jpeg_data, jpeg_size, nullptr, false, true,
+                           params_.enable_vector && has_vector_, params_.enable_3d && has_mesh_,
+                           jpeg_size, output_data, output_size);
+    }
+
+    fresco_error_t encode_image(const fresco_image_t* image, uint8_t** output_data,
+                               size_t* output_size) {
+        if (!image || !image->pixels || !output_data || !output_size ||
+            image->width == 0 || image->height == 0 || image->channels < 1 ||
+            image->channels > 4) {
+            return FRESCO_ERROR_INVALID_PARAMETER;
+        }
+        const size_t row_bytes = static_cast<size_t>(image->width) * image->channels;
+        const size_t row_stride = image->row_stride ? image->row_stride : row_bytes;
+        if (row_stride < row_bytes) {
+            return FRESCO_ERROR_INVALID_PARAMETER;
+        }
+
+        static const fresco_colorspace_t colorspaces[] = {
+            FRESCO_COLORSPACE_GRAY, FRESCO_COLORSPACE_GRAYA, FRESCO_COLORSPACE_RGB,
+            FRESCO_COLORSPACE_RGBA};
+        ImageInfo image_info;
+        image_info.width = image->width;
+        image_info.height = image->height;
+        image_info.channels = image->channels;
+        image_info.bit_depth = 8;
+        image_info.colorspace = colorspaces[image->channels - 1];
+        image_info.row_stride = row_stride;
+        const size_t extent = (static_cast<size_t>(image->height) - 1) * row_stride + row_bytes;
+        return encode_from(image->pixels, extent, &image_info, false, false,
+                           params_.enable_vector && has_vector_, params_.enable_3d && has_mesh_,
+                           row_bytes * image->height, output_data, output_size);
+    }
+
+    fresco_error_t encode_async(const uint8_t* input_data, size_t input_size,
+                               fresco_completion_callback_t callback,
+                               fresco_completion_queue_t* queue, void* user_data) {
+        return async_.submit(
+            [this, input_data, input_size](uint8_t** output_data, size_t* output_size) {
+                return encode(input_data, input_size, output_data, output_size);
+            },
+            callback, queue, user_data);
+    }
+
+    void set_thread_pool(ThreadPool* pool) { pool_ = pool; }
+
+    const fresco_stats_t& stats() const { return stats_; }
+
+private:
+    // image_info describes the raster input; when null it is parsed from
+    // input_data, which is a JPEG file to recompress when jpeg is set.
+    // image_bytes is what the counters report as read.
+    fresco_error_t encode_from(const uint8_t* input_data, size_t input_size,
+                               const ImageInfo* image_info, bool no_raster, bool jpeg,
+                               bool write_vector, bool write_mesh, size_t image_bytes,
+                               uint8_t** output_data, size_t* output_size) {
+        TraceSpan span("encode");
+        PoolScope pool_scope(pool_);
+        stats_ = fresco_stats_t();
+        const uint64_t start = now_ns();
+        StageTimes times;
+        RasterStats raster_stats;
+        fresco_error_t result;
         try {
-            // Parse input image format
-            ImageInfo image_info;
-            fresco_error_t result = parse_image_format(input_data, input_size, image_info);
+            result = encode_tracks(input_data, input_size, image_info, no_raster, jpeg,
+                                   write_vector, write_mesh, times, raster_stats, output_data,
+                                   output_size);
+            times.merge(raster_stats.times);
+            fill_stats(times, raster_stats, now_ns() - start, stats_);
+        } catch (const std::bad_alloc&) {
+            result = FRESCO_ERROR_OUT_OF_MEMORY;
+        } catch (const std::exception& e) {
+            result = FRESCO_ERROR_ENCODING_FAILED;
+        }
+        count_call(true, result, image_bytes, result == FRESCO_OK ? *output_size : 0, stats_);
+        return result;
+    }
+
+    fresco_error_t encode_tracks(const uint8_t* input_data, size_t input_size,
+                                 const ImageInfo* given_info, bool no_raster, bool jpeg,
+                                 bool write_vector, bool write_mesh, StageTimes& times,
+                                 RasterStats& raster_stats,
+                                 uint8_t** output_data, size_t* output_size) {
+        Stopwatch watch(times);
+        // Parse input image format
+        ImageInfo image_info;
+        ParsedImage parsed;
+        fresco_error_t result;
+        if (given_info) {
+            image_info = *given_info;
+        } else if (no_raster) {
+            // The canvas of the vector track, if any, gives the image size
+            image_info.width = write_vector ? vector_data_.width : 0;
+            image_info.height = write_vector ? vector_data_.height : 0;
+            image_info.channels = write_vector ? 4 : 0;
+            image_info.bit_depth = 8;
+            image_info.colorspace = FRESCO_COLORSPACE_RGBA;
+        } else if (jpeg) {
+            result = JpegCodec::read_info(input_data, input_size, image_info);
+            if (result != FRESCO_OK) {
+                return result;
+            }
+        } else {
+            result = parse_image_format(input_data, input_size, parsed);
             if (result != FRESCO_OK) {
                 return result;
             }
+            image_info = parsed.info;
+            if (parsed.pixels) {
+                input_data = parsed.pixels;
+                input_size = parsed.pixel_bytes;
+            }
+        }
+        watch.lap(Stage::Parse);
+
+        // Initialize container
+        result = container_.initialize(image_info, params_);
+        if (result != FRESCO_OK) {
+            return result;
+        }
+        watch.lap(Stage::Container);
 
-            // Initialize container
-            result = container_.initialize(image_info, params_);
+        // Encode vector track
+        if (write_vector) {
+            std::vector<uint8_t> vector_track;
+            result = vector_codec_.encode(vector_data_, vector_track);
             if (result != FRESCO_OK) {
                 return result;
             }
+            stats_.vector_bytes = vector_track.size();
+            result = container_.add_track(TrackType::Vector, std::move(vector_track));
+            if (result != FRESCO_OK) {
+                return result;
+            }
+            watch.lap(Stage::Vector);
+        }
 
-            // Compress image data
-            std::vector<uint8_t> compressed_data;
-            result = compression_.compress(input_data, input_size, image_info, params_, compressed_data);
+        // Encode 3D track
+        if (write_mesh) {
+            std::vector<uint8_t> mesh_track;
+            result = mesh_lod_.encode(mesh_data_, MeshQuantization::from_quality(params_.quality),
+                                      params_.mesh_lod_levels, mesh_track);
             if (result != FRESCO_OK) {
                 return result;
             }
+            stats_.mesh_bytes = mesh_track.size();
+            result = container_.add_track(TrackType::Mesh, std::move(mesh_track));
+            if (result != FRESCO_OK) {
+                return result;
+            }
+            watch.lap(Stage::Mesh);
+        }
 
-            // Create final container
-            std::vector<uint8_t> container_data;
-            result = container_.finalize(compressed_data, container_data);
+        // The JPEG track takes the place of the raster one; its size is the
+        // JPEG's, so rate targets do not apply
+        if (jpeg) {
+            std::vector<uint8_t> jpeg_track;
+            watch.lap(Stage::Container);
+            result = jpeg_codec_.encode(input_data, input_size, params_, jpeg_track, raster_stats);
+            watch.skip();
             if (result != FRESCO_OK) {
                 return result;
             }
+            stats_.raster_bytes = jpeg_track.size();
+            result = container_.add_track(TrackType::Jpeg, std::move(jpeg_track));
+            if (result != FRESCO_OK) {
+                return result;
+            }
+        }
 
-            // Allocate output buffer
-            *output_size = container_data.size();
-            *output_data = static_cast<uint8_t*>(fresco_malloc(*output_size));
-            if (!*output_data) {
-                return FRESCO_ERROR_OUT_OF_MEMORY;
+        // Compress image data last, so a size target can account for
+        // everything else in the file
+        std::vector<uint8_t> compressed_data;
+        if (!no_raster && !jpeg) {
+            uint64_t budget = 0;
+            const uint64_t target = target_size(image_info);
+            if (target > 0) {
+                const uint64_t reserved = container_.size_without_raster();
+                if (target <= reserved) {
+                    return FRESCO_ERROR_ENCODING_FAILED;
+                }
+                budget = target - reserved;
+            }
+            watch.lap(Stage::Container);
+            if (parsed.rows && (budget == 0 || params_.mode == FRESCO_COMPRESSION_LOSSLESS)) {
+                // Rows are decoded as their tiles are encoded
+                result = compression_.compress_rows(*parsed.rows, image_info, params_,
+                                                    compressed_data, raster_stats);
+            } else {
+                if (parsed.rows) {
+                    // Rate control prices the whole image, so it is decoded first
+                    const uint8_t* rows = nullptr;
+                    size_t row_stride = 0;
+                    result = parsed.rows->read_rows(0, image_info.height, rows, row_stride);
+                    if (result != FRESCO_OK) {
+                        return result;
+                    }
+                    input_data = rows;
+                    input_size = row_stride * image_info.height;
+                    image_info.row_stride = row_stride;
+                }
+                result = compression_.compress(input_data, input_size, image_info, params_,
+                                               budget, compressed_data, raster_stats);
             }
+            watch.skip();
+            if (result != FRESCO_OK) {
+                return result;
+            }
+            stats_.raster_bytes = compressed_data.size();
+        }
 
-            // Copy data to output buffer
-            std::memcpy(*output_data, container_data.data(), *output_size);
+        // The container is assembled next to the raster track, then copied
+        // to the output once the raster is gone
+        const uint64_t container_size = container_.size_without_raster() + compressed_data.size();
+        if (params_.max_memory_bytes > 0 && 2 * container_size > params_.max_memory_bytes) {
+            return FRESCO_ERROR_OUT_OF_MEMORY;
+        }
 
-            return FRESCO_OK;
-        } catch (const std::exception& e) {
-            return FRESCO_ERROR_ENCODING_FAILED;
+        // Create final container
+        std::vector<uint8_t> container_data;
+        result = container_.finalize(compressed_data, container_data);
+        if (result != FRESCO_OK) {
+            return result;
+        }
+        std::vector<uint8_t>().swap(compressed_data);
+
+        // Allocate output buffer
+        *output_size = container_data.size();
+        *output_data = static_cast<uint8_t*>(fresco_malloc(*output_size));
+        if (!*output_data) {
+            return FRESCO_ERROR_OUT_OF_MEMORY;
         }
+
+        // Copy data to output buffer
+        std::memcpy(*output_data, container_data.data(), *output_size);
+        watch.lap(Stage::Container);
+
+        return FRESCO_OK;
+    }
+
+    // File size limit from target_bytes and target_bpp, the tighter of the
+    // two when both are set; 0 when neither is
+    uint64_t target_size(const ImageInfo& image_info) const {
+        uint64_t target = params_.target_bytes;
+        if (params_.target_bpp > 0.0f) {
+            const double pixels = static_cast<double>(image_info.width) * image_info.height;
+            const uint64_t bpp_bytes =
+                static_cast<uint64_t>(std::max(1.0, params_.target_bpp * pixels / 8.0));
+            target = target > 0 ? std::min(target, bpp_bytes) : bpp_bytes;
+        }
+        return target;
     }
 
-private:
     fresco_encode_params_t params_;
+    fresco_stats_t stats_ = {};
     Container container_;
     Compression compression_;
+    VectorCodec vector_codec_;
+    VectorData vector_data_;
+    bool has_vector_ = false;
+    MeshLodCodec mesh_lod_;
+    MeshData mesh_data_;
+    JpegCodec jpeg_codec_;
+    bool has_mesh_ = false;
+    ThreadPool* pool_ = nullptr;
+    // Last, so pending calls finish before the rest is destroyed
+    AsyncWorker async_;
 };
 
 } // namespace fresco
@@ -133,6 +468,16 @@ void fresco_encoder_destroy(fresco_encoder_t* encoder) {
     }
 }
 
+fresco_error_t fresco_encoder_set_thread_pool(fresco_encoder_t* encoder, fresco_thread_pool_t* pool) {
+    if (!encoder) {
+        return FRESCO_ERROR_INVALID_PARAMETER;
+    }
+
+    auto* impl = reinterpret_cast<fresco::EncoderImpl*>(encoder);
+    impl->set_thread_pool(reinterpret_cast<fresco::ThreadPool*>(pool));
+    return FRESCO_OK;
+}
+
 fresco_error_t fresco_encoder_set_params(fresco_encoder_t* encoder,
                                         const fresco_encode_params_t* params) {
     if (!encoder) {
@@ -156,4 +501,74 @@ fresco_error_t fresco_encoder_encode(fresco_encoder_t* encoder,
     return impl->encode(input_data, input_size, output_data, output_size);
 }
 
+fresco_error_t fresco_encoder_encode_jpeg(fresco_encoder_t* encoder,
+                                         const uint8_t* jpeg_data,
+                                         size_t jpeg_size,
+                                         uint8_t** output_data,
+                                         size_t* output_size) {
+    if (!encoder) {
+        return FRESCO_ERROR_INVALID_PARAMETER;
+    }
+
+    auto* impl = reinterpret_cast<fresco::EncoderImpl*>(encoder);
+    return impl->encode_jpeg(jpeg_data, jpeg_size, output_data, output_size);
+}
+
+fresco_error_t fresco_encoder_encode_image(fresco_encoder_t* encoder,
+                                          const fresco_image_t* image,
+                                          uint8_t** output_data,
+                                          size_t* output_size) {
+    if (!encoder) {
+        return FRESCO_ERROR_INVALID_PARAMETER;
+    }
+
+    auto* impl = reinterpret_cast<fresco::EncoderImpl*>(encoder);
+    return impl->encode_image(image, output_data, output_size);
+}
+
+fresco_error_t fresco_encoder_encode_async(fresco_encoder_t* encoder,
+                                          const uint8_t* input_data,
+                                          size_t input_size,
+                                          fresco_completion_callback_t callback,
+                                          fresco_completion_queue_t* queue,
+                                          void* user_data) {
+    if (!encoder) {
+        return FRESCO_ERROR_INVALID_PARAMETER;
+    }
+
+    auto* impl = reinterpret_cast<fresco::EncoderImpl*>(encoder);
+    return impl->encode_async(input_data, input_size, callback, queue, user_data);
+}
+
+fresco_error_t fresco_encoder_get_stats(const fresco_encoder_t* encoder, fresco_stats_t* stats) {
+    if (!encoder || !stats) {
+        return FRESCO_ERROR_INVALID_PARAMETER;
+    }
+
+    *stats = reinterpret_cast<const fresco::EncoderImpl*>(encoder)->stats();
+    return FRESCO_OK;
+}
+
+fresco_error_t fresco_encoder_set_vector_paths(fresco_encoder_t* encoder,
+                                              uint32_t width,
+                                              uint32_t height,
+                                              const fresco_vector_path_t* paths,
+                                              size_t path_count) {
+    if (!encoder) {
+        return FRESCO_ERROR_INVALID_PARAMETER;
+    }
+
+    auto* impl = reinterpret_cast<fresco::EncoderImpl*>(encoder);
+    return impl->set_vector_paths(width, height, paths, path_count);
+}
+
+fresco_error_t fresco_encoder_set_mesh(fresco_encoder_t* encoder, const fresco_mesh_t* mesh) {
+    if (!encoder) {
+        return FRESCO_ERROR_INVALID_PARAMETER;
+    }
+
+    auto* impl = reinterpret_cast<fresco::EncoderImpl*>(encoder);
+    return impl->set_mesh(mesh);
+}
+
 } // extern "C"
@@ -0,0 +1,759 @@
+/**
+ * @file image_formats.cpp
+ * @brief FRESCO image file formats
+ * @author Mehmet T. AKALIN
+ * @date 2025
+ * @license MIT
+ */
+
+#include "image_formats.h"
+#include "inflate.h"
+#include "deflate.h"
+#include "checksum.h"
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <string>
+#include <vector>
+
+namespace fresco {
+
+namespace {
+
+fresco_colorspace_t colorspace_for(uint32_t channels) {
+    switch (channels) {
+        case 1: return FRESCO_COLORSPACE_GRAY;
+        case 2: return FRESCO_COLORSPACE_GRAYA;
+        case 4: return FRESCO_COLORSPACE_RGBA;
+        default: return FRESCO_COLORSPACE_RGB;
+    }
+}
+
+void set_info(ImageInfo& info, uint32_t width, uint32_t height, uint32_t channels) {
+    info.width = width;
+    info.height = height;
+    info.channels = static_cast<uint8_t>(channels);
+    info.bit_depth = 8;
+    info.colorspace = colorspace_for(channels);
+    info.row_stride = 0;
+}
+
+// ---------------------------------------------------------------- PNM
+
+// Header tokens of a PNM file, with the whitespace and comments around them
+class PnmHeader {
+public:
+    PnmHeader(const uint8_t* data, size_t size) : data_(data), size_(size) {}
+
+    size_t pos() const { return pos_; }
+
+    void skip_space() {
+        while (pos_ < size_) {
+            if (data_[pos_] == '#') {
+                while (pos_ < size_ && data_[pos_] != '\n') {
+                    pos_++;
+                }
+            } else if (is_space(data_[pos_])) {
+                pos_++;
+            } else {
+                break;
+            }
+        }
+    }
+
+    bool number(uint32_t& value) {
+        skip_space();
+        const size_t start = pos_;
+        uint64_t parsed = 0;
+        while (pos_ < size_ && data_[pos_] >= '0' && data_[pos_] <= '9' && parsed <= UINT32_MAX) {
+            parsed = parsed * 10 + (data_[pos_++] - '0');
+        }
+        if (pos_ == start || parsed > UINT32_MAX) {
+            return false;
+        }
+        value = static_cast<uint32_t>(parsed);
+        return true;
+    }
+
+    // One token of a PAM header line
+    bool word(std::string& value) {
+        while (pos_ < size_ && (data_[pos_] == ' ' || data_[pos_] == '\t')) {
+            pos_++;
+        }
+        const size_t start = pos_;
+        while (pos_ < size_ && !is_space(data_[pos_])) {
+            pos_++;
+        }
+        value.assign(reinterpret_cast<const char*>(data_ + start), pos_ - start);
+        return pos_ > start;
+    }
+
+    // The single whitespace byte before the raster
+    bool end_of_header() {
+        if (pos_ >= size_ || !is_space(data_[pos_])) {
+            return false;
+        }
+        pos_++;
+        return true;
+    }
+
+    bool next_line() {
+        while (pos_ < size_ && data_[pos_] != '\n') {
+            pos_++;
+        }
+        if (pos_ == size_) {
+            return false;
+        }
+        pos_++;
+        return true;
+    }
+
+private:
+    static bool is_space(uint8_t c) {
+        return c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\v' || c == '\f';
+    }
+
+    const uint8_t* data_;
+    size_t size_;
+    size_t pos_ = 0;
+};
+
+// Samples of a maxval other than 255, scaled to 8 bits a band at a time
+class PnmRowSource : public TileRowSource {
+public:
+    PnmRowSource(const uint8_t* raster, uint32_t width, uint32_t channels, uint32_t maxval)
+        : raster_(raster), row_samples_(static_cast<size_t>(width) * channels), maxval_(maxval),
+          sample_bytes_(maxval > 255 ? 2 : 1) {}
+
+    fresco_error_t read_rows(uint32_t first, uint32_t count, const uint8_t*& rows,
+                             size_t& row_stride) override {
+        try {
+            band_.resize(row_samples_ * count);
+        } catch (const std::bad_alloc&) {
+            return FRESCO_ERROR_OUT_OF_MEMORY;
+        }
+        const size_t samples = row_samples_ * count;
+        const uint8_t* src = raster_ + static_cast<size_t>(first) * row_samples_ * sample_bytes_;
+        const uint32_t half = maxval_ / 2;
+        for (size_t i = 0; i < samples; i++) {
+            uint32_t value = sample_bytes_ == 2 ? (src[2 * i] << 8) | src[2 * i + 1] : src[i];
+            value = std::min(value, maxval_);
+            band_[i] = static_cast<uint8_t>((value * 255 + half) / maxval_);
+        }
+        rows = band_.data();
+        row_stride = row_samples_;
+        return FRESCO_OK;
+    }
+
+private:
+    const uint8_t* raster_;
+    size_t row_samples_;
+    uint32_t maxval_;
+    uint32_t sample_bytes_;
+    std::vector<uint8_t> band_;
+};
+
+// The PAM header lines after "P7", up to ENDHDR
+fresco_error_t read_pam_header(PnmHeader& header, uint32_t& width, uint32_t& height,
+                               uint32_t& depth, uint32_t& maxval) {
+    width = height = depth = maxval = 0;
+    std::string key;
+    for (;;) {
+        header.skip_space();
+        if (!header.word(key)) {
+            return FRESCO_ERROR_CORRUPTED_DATA;
+        }
+        if (key == "ENDHDR") {
+            return header.next_line() ? FRESCO_OK : FRESCO_ERROR_CORRUPTED_DATA;
+        }
+        bool ok = true;
+        if (key == "WIDTH") {
+            ok = header.number(width);
+        } else if (key == "HEIGHT") {
+            ok = header.number(height);
+        } else if (key == "DEPTH") {
+            ok = header.number(depth);
+        } else if (key == "MAXVAL") {
+            ok = header.number(maxval);
+        }
+        // TUPLTYPE and unknown keys are informational; DEPTH decides the layout
+        if (!ok || !header.next_line()) {
+            return FRESCO_ERROR_CORRUPTED_DATA;
+        }
+    }
+}
+
+// ---------------------------------------------------------------- PNG
+
+constexpr uint8_t kPngSignature[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+
+enum PngColorType : uint8_t {
+    kPngGray = 0,
+    kPngRgb = 2,
+    kPngPalette = 3,
+    kPngGrayAlpha = 4,
+    kPngRgbAlpha = 6
+};
+
+// Most bytes deflate can produce from one byte of input: a 258-byte match
+// in every bit or so of a fixed-code block
+constexpr uint64_t kMaxInflateRatio = 1032;
+
+// Adam7 passes: first column and row, then the steps between them
+constexpr uint8_t kAdam7[7][4] = {{0, 0, 8, 8}, {4, 0, 8, 8}, {0, 4, 4, 8}, {2, 0, 4, 4},
+                                  {0, 2, 2, 4}, {1, 0, 2, 2}, {0, 1, 1, 2}};
+
+uint32_t read_u32_be(const uint8_t* p) {
+    return (static_cast<uint32_t>(p[0]) << 24) | (static_cast<uint32_t>(p[1]) << 16) |
+           (static_cast<uint32_t>(p[2]) << 8) | p[3];
+}
+
+struct PngHeader {
+    uint32_t width = 0;
+    uint32_t height = 0;
+    uint8_t depth = 0;
+    uint8_t color_type = 0;
+    bool interlaced = false;
+    uint32_t samples = 0;    // Per pixel in the file
+    uint32_t channels = 0;   // Per pixel after expansion
+
+    uint8_t palette[256][4] = {};
+    bool transparent = false;    // tRNS present
+    uint16_t key[3] = {};        // Transparent gray or RGB sample values
+
+    std::vector<ByteSpan> idat;
+
+    // Bytes of a filtered row of width pixels, without its filter byte
+    size_t row_bytes(uint32_t width) const {
+        return (static_cast<size_t>(width) * samples * depth + 7) / 8;
+    }
+    // Distance to the byte of the previous pixel for the filters
+    size_t filter_distance() const { return std::max<size_t>(1, samples * depth / 8); }
+};
+
+uint8_t paeth(uint8_t a, uint8_t b, uint8_t c) {
+    const int p = a + b - c;
+    const int pa = std::abs(p - a);
+    const int pb = std::abs(p - b);
+    const int pc = std::abs(p - c);
+    if (pa <= pb && pa <= pc) {
+        return a;
+    }
+    return pb <= pc ? b : c;
+}
+
+// Undoes the filter of row in place against the previous, unfiltered row
+bool unfilter(uint8_t filter, uint8_t* row, const uint8_t* prior, size_t bytes, size_t bpp) {
+    switch (filter) {
+        case 0:
+            return true;
+        case 1:
+            for (size_t i = bpp; i < bytes; i++) {
+                row[i] = static_cast<uint8_t>(row[i] + row[i - bpp]);
+            }
+            return true;
+        case 2:
+            for (size_t i = 0; i < bytes; i++) {
+                row[i] = static_cast<uint8_t>(row[i] + prior[i]);
+            }
+            return true;
+        case 3:
+            for (size_t i = 0; i < bytes; i++) {
+                const uint32_t left = i >= bpp ? row[i - bpp] : 0;
+                row[i] = static_cast<uint8_t>(row[i] + ((left + prior[i]) >> 1));
+            }
+            return true;
+        case 4:
+            for (size_t i = 0; i < bytes; i++) {
+                const uint8_t left = i >= bpp ? row[i - bpp] : 0;
+                const uint8_t upper_left = i >= bpp ? prior[i - bpp] : 0;
+                row[i] = static_cast<uint8_t>(row[i] + paeth(left, prior[i], upper_left));
+            }
+            return true;
+        default:
+            return false;
+    }
+}
+
+class PngRowSource : public TileRowSource {
+public:
+    explicit PngRowSource(PngHeader header)
+        : header_(std::move(header)), inflater_(header_.idat),
+          out_row_bytes_(static_cast<size_t>(header_.width) * header_.channels) {}
+
+    fresco_error_t read_rows(uint32_t first, uint32_t count, const uint8_t*& rows,
+                             size_t& row_stride) override {
+        row_stride = out_row_bytes_;
+        try {
+            if (header_.interlaced) {
+                if (image_.empty()) {
+                    fresco_error_t result = read_interlaced();
+                    if (result != FRESCO_OK) {
+                        return result;
+                    }
+                }
+                rows = image_.data() + static_cast<size_t>(first) * out_row_bytes_;
+                return FRESCO_OK;
+            }
+            if (first != next_row_) {
+                return FRESCO_ERROR_INVALID_PARAMETER;
+            }
+            band_.resize(out_row_bytes_ * count);
+            if (current_.empty()) {
+                current_.resize(header_.row_bytes(header_.width) + 1);
+                previous_.assign(current_.size(), 0);
+            }
+        } catch (const std::bad_alloc&) {
+            return FRESCO_ERROR_OUT_OF_MEMORY;
+        }
+        for (uint32_t y = 0; y < count; y++) {
+            fresco_error_t result = next_row(header_.width);
+            if (result != FRESCO_OK) {
+                return result;
+            }
+            expand(current_.data() + 1, header_.width, &band_[y * out_row_bytes_],
+                   header_.channels);
+        }
+        next_row_ += count;
+        if (next_row_ == header_.height) {
+            fresco_error_t result = inflater_.finish();
+            if (result != FRESCO_OK) {
+                return result;
+            }
+        }
+        rows = band_.data();
+        return FRESCO_OK;
+    }
+
+private:
+    // Inflates and unfilters the next row of width pixels into current_,
+    // whose first byte is the filter type
+    fresco_error_t next_row(uint32_t width) {
+        const size_t bytes = header_.row_bytes(width);
+        std::swap(current_, previous_);
+        fresco_error_t result = inflater_.read(current_.data(), bytes + 1);
+        if (result != FRESCO_OK) {
+            return result;
+        }
+        if (!unfilter(current_[0], current_.data() + 1, previous_.data() + 1, bytes,
+                      header_.filter_distance())) {
+            return FRESCO_ERROR_CORRUPTED_DATA;
+        }
+        return FRESCO_OK;
+    }
+
+    uint32_t sample(const uint8_t* row, size_t index) const {
+        switch (header_.depth) {
+            case 16: return (row[2 * index] << 8) | row[2 * index + 1];
+            case 8: return row[index];
+            default: {
+                const size_t bit = index * header_.depth;
+                return (row[bit / 8] >> (8 - header_.depth - bit % 8)) &
+                       ((1u << header_.depth) - 1);
+            }
+        }
+    }
+
+    uint8_t to_8bit(uint32_t value) const {
+        if (header_.depth == 16) {
+            return static_cast<uint8_t>(value >> 8);
+        }
+        return static_cast<uint8_t>(value * 255 / ((1u << header_.depth) - 1));
+    }
+
+    // Converts a row of width pixels to 8-bit samples, pixels pixel_step
+    // samples apart in out
+    void expand(const uint8_t* row, uint32_t width, uint8_t* out, size_t pixel_step) const {
+        const uint32_t channels = header_.channels;
+        if (header_.depth == 8 && header_.samples == channels &&
+            header_.color_type != kPngPalette && pixel_step == channels) {
+            std::memcpy(out, row, static_cast<size_t>(width) * channels);
+            return;
+        }
+        for (uint32_t x = 0; x < width; x++, out += pixel_step) {
+            if (header_.color_type == kPngPalette) {
+                std::memcpy(out, header_.palette[sample(row, x)], channels);
+                continue;
+            }
+            bool keyed = header_.transparent;
+            for (uint32_t c = 0; c < header_.samples; c++) {
+                const uint32_t value = sample(row, static_cast<size_t>(x) * header_.samples + c);
+                keyed = keyed && value == header_.key[c];
+                out[c] = to_8bit(value);
+            }
+            if (header_.transparent) {
+                out[header_.samples] = keyed ? 0 : 255;
+            }
+        }
+    }
+
+    fresco_error_t read_interlaced() {
+        image_.resize(out_row_bytes_ * header_.height);
+        current_.resize(header_.row_bytes(header_.width) + 1);
+        const uint32_t channels = header_.channels;
+        for (const auto& pass : kAdam7) {
+            if (header_.width <= pass[0] || header_.height <= pass[1]) {
+                continue;
+            }
+            const uint32_t width = (header_.width - pass[0] + pass[2] - 1) / pass[2];
+            const uint32_t height = (header_.height - pass[1] + pass[3] - 1) / pass[3];
+            // Each pass starts over from a row of zeros
+            previous_.assign(current_.size(), 0);
+            std::fill(current_.begin(), current_.end(), 0);
+            for (uint32_t y = 0; y < height; y++) {
+                fresco_error_t result = next_row(width);
+                if (result != FRESCO_OK) {
+                    return result;
+                }
+                const size_t row = pass[1] + static_cast<size_t>(y) * pass[3];
+                expand(current_.data() + 1, width,
+                       &image_[row * out_row_bytes_ + static_cast<size_t>(pass[0]) * channels],
+                       static_cast<size_t>(pass[2]) * channels);
+            }
+        }
+        return inflater_.finish();
+    }
+
+    PngHeader header_;
+    Inflater inflater_;
+    size_t out_row_bytes_;
+    uint32_t next_row_ = 0;
+    std::vector<uint8_t> current_;
+    std::vector<uint8_t> previous_;
+    std::vector<uint8_t> band_;
+    std::vector<uint8_t> image_;    // The whole image, when interlaced
+};
+
+bool valid_png_depth(uint8_t color_type, uint8_t depth) {
+    switch (color_type) {
+        case kPngGray: return depth == 1 || depth == 2 || depth == 4 || depth == 8 || depth == 16;
+        case kPngPalette: return depth == 1 || depth == 2 || depth == 4 || depth == 8;
+        case kPngRgb:
+        case kPngGrayAlpha:
+        case kPngRgbAlpha: return depth == 8 || depth == 16;
+        default: return false;
+    }
+}
+
+fresco_error_t read_png_chunks(const uint8_t* data, size_t size, PngHeader& header) {
+    size_t pos = sizeof(kPngSignature);
+    bool have_header = false;
+    uint32_t palette_size = 0;
+    while (pos + 12 <= size) {
+        const uint32_t length = read_u32_be(data + pos);
+        const uint8_t* type = data + pos + 4;
+        const uint8_t* chunk = data + pos + 8;
+        if (length > size - pos - 12) {
+            return FRESCO_ERROR_CORRUPTED_DATA;
+        }
+        pos += 12 + static_cast<size_t>(length);
+
+        if (!have_header) {
+            // IHDR comes first
+            if (std::memcmp(type, "IHDR", 4) != 0 || length != 13) {
+                return FRESCO_ERROR_CORRUPTED_DATA;
+            }
+            header.width = read_u32_be(chunk);
+            header.height = read_u32_be(chunk + 4);
+            header.depth = chunk[8];
+            header.color_type = chunk[9];
+            if (header.width == 0 || header.height == 0 || header.width > INT32_MAX ||
+                header.height > INT32_MAX || !valid_png_depth(header.color_type, header.depth) ||
+                chunk[10] != 0 || chunk[11] != 0 || chunk[12] > 1) {
+                return FRESCO_ERROR_CORRUPTED_DATA;
+            }
+            header.interlaced = chunk[12] == 1;
+            static const uint8_t kSamples[7] = {1, 0, 3, 1, 2, 0, 4};
+            header.samples = kSamples[header.color_type];
+            header.channels = header.color_type == kPngPalette ? 3 : header.samples;
+            have_header = true;
+        } else if (std::memcmp(type, "PLTE", 4) == 0) {
+            if (length % 3 != 0 || length / 3 > 256) {
+                return FRESCO_ERROR_CORRUPTED_DATA;
+            }
+            palette_size = length / 3;
+            for (uint32_t i = 0; i < palette_size; i++) {
+                std::memcpy(header.palette[i], chunk + 3 * i, 3);
+                header.palette[i][3] = 255;
+            }
+        } else if (std::memcmp(type, "tRNS", 4) == 0) {
+            if (header.transparent) {
+                return FRESCO_ERROR_CORRUPTED_DATA;
+            }
+            if (header.color_type == kPngPalette) {
+                if (length > palette_size) {
+                    return FRESCO_ERROR_CORRUPTED_DATA;
+                }
+                for (uint32_t i = 0; i < length; i++) {
+                    header.palette[i][3] = chunk[i];
+                }
+            } else if (header.color_type == kPngGray || header.color_type == kPngRgb) {
+                if (length != 2 * header.samples) {
+                    return FRESCO_ERROR_CORRUPTED_DATA;
+                }
+                for (uint32_t c = 0; c < header.samples; c++) {
+                    header.key[c] = static_cast<uint16_t>((chunk[2 * c] << 8) | chunk[2 * c + 1]);
+                }
+            } else {
+                return FRESCO_ERROR_CORRUPTED_DATA;
+            }
+            header.transparent = true;
+            header.channels++;
+        } else if (std::memcmp(type, "IDAT", 4) == 0) {
+            if (length > 0) {
+                header.idat.push_back({chunk, length});
+            }
+        } else if (std::memcmp(type, "IEND", 4) == 0) {
+            break;
+        } else if (!(type[0] & 0x20)) {
+            // An unknown critical chunk changes how the image reads
+            return FRESCO_ERROR_UNSUPPORTED_FORMAT;
+        }
+    }
+    if (!have_header || header.idat.empty() ||
+        (header.color_type == kPngPalette && palette_size == 0)) {
+        return FRESCO_ERROR_CORRUPTED_DATA;
+    }
+    // As for PNM, the size in IHDR must fit the data there is, here once
+    // inflated, before the rows are allocated from it
+    uint64_t idat_bytes = 0;
+    for (const ByteSpan& span : header.idat) {
+        idat_bytes += span.size;
+    }
+    // Every other row at least has a filter byte, interlaced or not
+    const uint64_t inflated = idat_bytes * kMaxInflateRatio;
+    const uint64_t row_bits = static_cast<uint64_t>(header.width) * header.samples * header.depth;
+    if (header.height / 2 > inflated || header.height > 8 * inflated / row_bits) {
+        return FRESCO_ERROR_CORRUPTED_DATA;
+    }
+    return FRESCO_OK;
+}
+
+} // namespace
+
+fresco_error_t read_pnm(const uint8_t* data, size_t size, ParsedImage& image) {
+    if (size < 3 || data[0] != 'P' || (data[1] != '5' && data[1] != '6' && data[1] != '7') ||
+        !std::strchr(" \t\r\n", data[2])) {
+        return FRESCO_ERROR_UNSUPPORTED_FORMAT;
+    }
+    PnmHeader header(data, size);
+    std::string magic;
+    header.word(magic);
+    uint32_t width = 0, height = 0, channels = data[1] == '5' ? 1 : 3, maxval = 0;
+    if (data[1] == '7') {
+        fresco_error_t result = read_pam_header(header, width, height, channels, maxval);
+        if (result != FRESCO_OK) {
+            return result;
+        }
+    } else if (!header.number(width) || !header.number(height) || !header.number(maxval) ||
+               !header.end_of_header()) {
+        return FRESCO_ERROR_CORRUPTED_DATA;
+    }
+    if (width == 0 || height == 0 || channels == 0 || maxval == 0 || maxval > 65535) {
+        return FRESCO_ERROR_CORRUPTED_DATA;
+    }
+    if (channels > 4) {
+        return FRESCO_ERROR_UNSUPPORTED_FORMAT;
+    }
+    const uint64_t raster_bytes = static_cast<uint64_t>(width) * height * channels *
+                                  (maxval > 255 ? 2 : 1);
+    if (raster_bytes > size - header.pos()) {
+        return FRESCO_ERROR_CORRUPTED_DATA;
+    }
+
+    set_info(image.info, width, height, channels);
+    const uint8_t* raster = data + header.pos();
+    if (maxval == 255) {
+        image.pixels = raster;
+        image.pixel_bytes = static_cast<size_t>(raster_bytes);
+        return FRESCO_OK;
+    }
+    try {
+        image.rows = std::make_unique<PnmRowSource>(raster, width, channels, maxval);
+    } catch (const std::bad_alloc&) {
+        return FRESCO_ERROR_OUT_OF_MEMORY;
+    }
+    return FRESCO_OK;
+}
+
+fresco_error_t read_png(const uint8_t* data, size_t size, ParsedImage& image) {
+    if (size < sizeof(kPngSignature) ||
+        std::memcmp(data, kPngSignature, sizeof(kPngSignature)) != 0) {
+        return FRESCO_ERROR_UNSUPPORTED_FORMAT;
+    }
+    try {
+        PngHeader header;
+        fresco_error_t result = read_png_chunks(data, size, header);
+        if (result != FRESCO_OK) {
+            return result;
+        }
+        set_info(image.info, header.width, header.height, header.channels);
+        image.rows = std::make_unique<PngRowSource>(std::move(header));
+    } catch (const std::bad_alloc&) {
+        return FRESCO_ERROR_OUT_OF_MEMORY;
+    }
+    return FRESCO_OK;
+}
+
+namespace {
+
+// Header of a PNM file of 8-bit samples: P5 and P6 where they fit, PAM
+// otherwise
+std::string pnm_header(bool pam, uint32_t width, uint32_t height, uint32_t channels) {
+    if (!pam && (channels == 1 || channels == 3)) {
+        return (channels == 1 ? "P5\n" : "P6\n") + std::to_string(width) + " " +
+               std::to_string(height) + "\n255\n";
+    }
+    static const char* const kTupleTypes[4] = {"GRAYSCALE", "GRAYSCALE_ALPHA", "RGB",
+                                               "RGB_ALPHA"};
+    return "P7\nWIDTH " + std::to_string(width) + "\nHEIGHT " + std::to_string(height) +
+           "\nDEPTH " + std::to_string(channels) + "\nMAXVAL 255\nTUPLTYPE " +
+           kTupleTypes[channels - 1] + "\nENDHDR\n";
+}
+
+class PnmWriter : public ImageWriter {
+public:
+    PnmWriter(bool pam, uint32_t width, uint32_t height, uint32_t channels)
+        : row_bytes_(static_cast<size_t>(width) * channels) {
+        const std::string header = pnm_header(pam, width, height, channels);
+        file_.reserve(header.size() + row_bytes_ * height);
+        file_.assign(header.begin(), header.end());
+    }
+
+    fresco_error_t write_rows(const uint8_t* rows, size_t row_stride, uint32_t count) override {
+        for (uint32_t y = 0; y < count; y++) {
+            file_.insert(file_.end(), rows + y * row_stride, rows + y * row_stride + row_bytes_);
+        }
+        return FRESCO_OK;
+    }
+
+    fresco_error_t finish(std::vector<uint8_t>& file) override {
+        file = std::move(file_);
+        return FRESCO_OK;
+    }
+
+private:
+    size_t row_bytes_;
+    std::vector<uint8_t> file_;
+};
+
+// Compressed bytes gathered before they go out as an IDAT chunk
+constexpr size_t kIdatSize = 1 << 18;
+
+class PngWriter : public ImageWriter {
+public:
+    PngWriter(bool stored, uint32_t width, uint32_t height, uint32_t channels)
+        : stored_(stored), row_bytes_(static_cast<size_t>(width) * channels), deflater_(stored ? 0 : 1),
+          filtered_(row_bytes_ + 1), previous_(row_bytes_, 0) {
+        file_.assign(kPngSignature, kPngSignature + sizeof(kPngSignature));
+        static const uint8_t kColorTypes[4] = {kPngGray, kPngGrayAlpha, kPngRgb, kPngRgbAlpha};
+        uint8_t header[13];
+        store_u32_be(header, width);
+        store_u32_be(header + 4, height);
+        header[8] = 8;
+        header[9] = kColorTypes[channels - 1];
+        header[10] = header[11] = header[12] = 0;
+        write_chunk("IHDR", header, sizeof(header));
+    }
+
+    fresco_error_t write_rows(const uint8_t* rows, size_t row_stride, uint32_t count) override {
+        for (uint32_t y = 0; y < count; y++) {
+            const uint8_t* row = rows + y * row_stride;
+            filter(row);
+            deflater_.write(filtered_.data(), filtered_.size(), compressed_);
+            if (!stored_) {
+                std::memcpy(previous_.data(), row, row_bytes_);
+            }
+        }
+        if (compressed_.size() >= kIdatSize) {
+            write_chunk("IDAT", compressed_.data(), compressed_.size());
+            compressed_.clear();
+        }
+        return FRESCO_OK;
+    }
+
+    fresco_error_t finish(std::vector<uint8_t>& file) override {
+        deflater_.finish(compressed_);
+        write_chunk("IDAT", compressed_.data(), compressed_.size());
+        write_chunk("IEND", nullptr, 0);
+        file = std::move(file_);
+        return FRESCO_OK;
+    }
+
+private:
+    static void store_u32_be(uint8_t* p, uint32_t value) {
+        p[0] = static_cast<uint8_t>(value >> 24);
+        p[1] = static_cast<uint8_t>(value >> 16);
+        p[2] = static_cast<uint8_t>(value >> 8);
+        p[3] = static_cast<uint8_t>(value);
+    }
+
+    void write_chunk(const char* type, const uint8_t* data, size_t size) {
+        uint8_t length[4];
+        store_u32_be(length, static_cast<uint32_t>(size));
+        file_.insert(file_.end(), length, length + 4);
+        const size_t start = file_.size();
+        file_.insert(file_.end(), type, type + 4);
+        if (size > 0) {
+            file_.insert(file_.end(), data, data + size);
+        }
+        uint8_t crc[4];
+        store_u32_be(crc, crc32(0, file_.data() + start, size + 4));
+        file_.insert(file_.end(), crc, crc + 4);
+    }
+
+    // Up filter: one subtraction a byte, which vectorizes, and across
+    // photos, screenshots and gradients within a few percent of choosing
+    // per row. Stored output keeps rows unfiltered, as filtering would
+    // only cost time.
+    void filter(const uint8_t* row) {
+        uint8_t* out = filtered_.data() + 1;
+        if (stored_) {
+            filtered_[0] = 0;
+            std::memcpy(out, row, row_bytes_);
+            return;
+        }
+        filtered_[0] = 2;
+        const uint8_t* prior = previous_.data();
+        for (size_t i = 0; i < row_bytes_; i++) {
+            out[i] = static_cast<uint8_t>(row[i] - prior[i]);
+        }
+    }
+
+    bool stored_;
+    size_t row_bytes_;
+    Deflater deflater_;
+    std::vector<uint8_t> filtered_;    // Filter type, then the filtered row
+    std::vector<uint8_t> previous_;
+    std::vector<uint8_t> compressed_;
+    std::vector<uint8_t> file_;
+};
+
+} // namespace
+
+fresco_error_t create_image_writer(fresco_file_format_t format, uint32_t width, uint32_t height,
+                                   uint32_t channels, std::unique_ptr<ImageWriter>& writer) {
+    if (channels < 1 || channels > 4 || width == 0 || height == 0) {
+        return FRESCO_ERROR_UNSUPPORTED_FORMAT;
+    }
+    try {
+        switch (format) {
+            case FRESCO_FILE_PNM:
+            case FRESCO_FILE_PAM:
+                writer = std::make_unique<PnmWriter>(format == FRESCO_FILE_PAM, width, height,
+                                                     channels);
+                return FRESCO_OK;
+            case FRESCO_FILE_PNG:
+            case FRESCO_FILE_PNG_STORED:
+                writer = std::make_unique<PngWriter>(format == FRESCO_FILE_PNG_STORED, width,
+                                                     height, channels);
+                return FRESCO_OK;
+        }
+    } catch (const std::bad_alloc&) {
+        return FRESCO_ERROR_OUT_OF_MEMORY;
+    }
+    return FRESCO_ERROR_INVALID_PARAMETER;
+}
+
+} // namespace fresco
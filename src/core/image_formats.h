@@ -0,0 +1,62 @@
+/**
+ * @file image_formats.h
+ * @brief FRESCO image file formats
+ * @author Mehmet T. AKALIN
+ * @date 2025
+ * @license MIT
+ */
+
+#ifndef FRESCO_IMAGE_FORMATS_H
+#define FRESCO_IMAGE_FORMATS_H
+
+#include "fresco/fresco.h"
+#include "compression.h"
+#include <memory>
+#include <vector>
+
+namespace fresco {
+
+// An input image as the encoder takes it: either a view of 8-bit samples
+// inside the input itself, or a source that decodes rows on demand. Either
+// way the input must outlive it.
+struct ParsedImage {
+    ImageInfo info = {};
+    const uint8_t* pixels = nullptr;    // The view, rows info.row_stride apart
+    size_t pixel_bytes = 0;
+    std::unique_ptr<TileRowSource> rows;    // Set instead of pixels
+};
+
+// Binary PGM (P5), PPM (P6) and PAM (P7) with 1 to 4 channels. Samples
+// with a maxval of 255 are viewed in place; others are scaled to 8 bits a
+// band of rows at a time. FRESCO_ERROR_UNSUPPORTED_FORMAT when the data is
+// not PNM at all.
+fresco_error_t read_pnm(const uint8_t* data, size_t size, ParsedImage& image);
+
+// PNG of every color type and bit depth, 16-bit samples cut to their high
+// byte, palettes expanded and tRNS turned into an alpha channel. Rows are
+// inflated and unfiltered as the encoder asks for them; interlaced images
+// are decoded whole on the first request. Chunk CRCs are not checked, the
+// zlib Adler-32 is.
+fresco_error_t read_png(const uint8_t* data, size_t size, ParsedImage& image);
+
+// Writes a decoded image as a file, a band of rows at a time from the top
+class ImageWriter {
+public:
+    virtual ~ImageWriter() = default;
+
+    virtual fresco_error_t write_rows(const uint8_t* rows, size_t row_stride,
+                                      uint32_t count) = 0;
+
+    // The whole file, once every row is written
+    virtual fresco_error_t finish(std::vector<uint8_t>& file) = 0;
+};
+
+// A writer of 8-bit samples with 1 to 4 channels. PNM picks P5 or P6 and
+// falls back to PAM for alpha; PNG rows are filtered and deflated as they
+// come, PNG_STORED rows are stored unfiltered.
+fresco_error_t create_image_writer(fresco_file_format_t format, uint32_t width, uint32_t height,
+                                   uint32_t channels, std::unique_ptr<ImageWriter>& writer);
+
+} // namespace fresco
+
+#endif // FRESCO_IMAGE_FORMATS_H
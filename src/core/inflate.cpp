@@ -0,0 +1,400 @@
+/**
+ * @file inflate.cpp
+ * @brief FRESCO zlib stream decoding
+ * @author Mehmet T. AKALIN
+ * @date 2025
+ * @license MIT
+ */
+
+#include "inflate.h"
+#include "checksum.h"
+#include <algorithm>
+
+namespace fresco {
+
+namespace {
+
+constexpr size_t kWindowSize = 32768;
+
+constexpr uint16_t kLengthBase[29] = {3,  4,  5,  6,  7,  8,  9,  10, 11,  13,
+                                      15, 17, 19, 23, 27, 31, 35, 43, 51,  59,
+                                      67, 83, 99, 115, 131, 163, 195, 227, 258};
+constexpr uint8_t kLengthExtra[29] = {0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2,
+                                      2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0};
+constexpr uint16_t kDistanceBase[30] = {1,    2,    3,    4,    5,    7,     9,     13,
+                                        17,   25,   33,   49,   65,   97,    129,   193,
+                                        257,  385,  513,  769,  1025, 1537,  2049,  3073,
+                                        4097, 6145, 8193, 12289, 16385, 24577};
+constexpr uint8_t kDistanceExtra[30] = {0, 0, 0, 0, 1, 1, 2, 2,  3,  3,  4,  4,  5,  5,  6,
+                                        6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13};
+// Order of the code length code lengths in a dynamic block header
+constexpr uint8_t kCodeLengthOrder[19] = {16, 17, 18, 0, 8,  7, 9,  6, 10, 5,
+                                          11, 4,  12, 3, 13, 2, 14, 1, 15};
+
+inline uint32_t reverse_bits(uint32_t value, uint32_t count) {
+    uint32_t reversed = 0;
+    for (uint32_t i = 0; i < count; i++) {
+        reversed = (reversed << 1) | ((value >> i) & 1);
+    }
+    return reversed;
+}
+
+} // namespace
+
+Inflater::Inflater(std::vector<ByteSpan> input)
+    : input_(std::move(input)), window_(kWindowSize) {}
+
+// Loads whole bytes until count bits are buffered; false at the end of input
+bool Inflater::need(uint32_t count) {
+    while (count_ < count) {
+        while (span_ < input_.size() && pos_ >= input_[span_].size) {
+            span_++;
+            pos_ = 0;
+        }
+        if (span_ == input_.size()) {
+            return false;
+        }
+        buffer_ |= static_cast<uint64_t>(input_[span_].data[pos_++]) << count_;
+        count_ += 8;
+    }
+    return true;
+}
+
+// Takes count buffered bits, least significant first
+uint32_t Inflater::bits(uint32_t count) {
+    const uint32_t value = static_cast<uint32_t>(buffer_ & ((uint64_t(1) << count) - 1));
+    buffer_ >>= count;
+    count_ -= count;
+    return value;
+}
+
+bool Inflater::build(HuffmanCode& code, const uint8_t* lengths, uint32_t count) {
+    std::fill(std::begin(code.count), std::end(code.count), 0);
+    for (uint32_t i = 0; i < count; i++) {
+        code.count[lengths[i]]++;
+    }
+    code.count[0] = 0;
+
+    // Over-subscribed codes are invalid; incomplete ones are allowed, as a
+    // single distance code is
+    uint16_t offsets[16];
+    int32_t left = 1;
+    offsets[1] = 0;
+    for (uint32_t length = 1; length < 16; length++) {
+        left = 2 * left - code.count[length];
+        if (left < 0) {
+            return false;
+        }
+        if (length < 15) {
+            offsets[length + 1] = static_cast<uint16_t>(offsets[length] + code.count[length]);
+        }
+    }
+    for (uint32_t i = 0; i < count; i++) {
+        if (lengths[i]) {
+            code.symbol[offsets[lengths[i]]++] = static_cast<uint16_t>(i);
+        }
+    }
+
+    std::fill(std::begin(code.fast), std::end(code.fast), 0);
+    uint32_t first = 0;
+    uint32_t index = 0;
+    for (uint32_t length = 1; length <= HuffmanCode::kFastBits; length++) {
+        for (uint32_t i = 0; i < code.count[length]; i++, index++) {
+            // Codes are read bit-reversed; fill every entry that starts with this one
+            const uint32_t reversed = reverse_bits(first + i, length);
+            const uint16_t entry = static_cast<uint16_t>((code.symbol[index] << 4) | length);
+            for (uint32_t fill = reversed; fill < (1u << HuffmanCode::kFastBits);
+                 fill += 1u << length) {
+                code.fast[fill] = entry;
+            }
+        }
+        first = (first + code.count[length]) << 1;
+    }
+    return true;
+}
+
+bool Inflater::decode(const HuffmanCode& code, uint32_t& symbol) {
+    need(15);
+    const uint32_t entry = code.fast[buffer_ & ((1u << HuffmanCode::kFastBits) - 1)];
+    if (entry && (entry & 15) <= count_) {
+        bits(entry & 15);
+        symbol = entry >> 4;
+        return true;
+    }
+    // Canonical decode, one bit at a time, past the table
+    int32_t value = 0;
+    int32_t first = 0;
+    int32_t index = 0;
+    for (uint32_t length = 1; length < 16; length++) {
+        if (count_ == 0) {
+            return false;
+        }
+        value |= static_cast<int32_t>(bits(1));
+        const int32_t count = code.count[length];
+        if (value - first < count) {
+            symbol = code.symbol[index + value - first];
+            return true;
+        }
+        index += count;
+        first = (first + count) << 1;
+        value <<= 1;
+    }
+    return false;
+}
+
+fresco_error_t Inflater::begin_block() {
+    if (!need(3)) {
+        return FRESCO_ERROR_CORRUPTED_DATA;
+    }
+    final_ = bits(1) != 0;
+    const uint32_t type = bits(2);
+    if (type == 0) {
+        // Stored: aligned to a byte, then the length and its complement
+        bits(count_ & 7);
+        if (!need(32)) {
+            return FRESCO_ERROR_CORRUPTED_DATA;
+        }
+        const uint32_t length = bits(16);
+        if ((bits(16) ^ 0xFFFF) != length) {
+            return FRESCO_ERROR_CORRUPTED_DATA;
+        }
+        stored_left_ = length;
+        state_ = State::Stored;
+        return FRESCO_OK;
+    }
+    if (type == 1) {
+        uint8_t lengths[288 + 30];
+        std::fill(lengths, lengths + 144, 8);
+        std::fill(lengths + 144, lengths + 256, 9);
+        std::fill(lengths + 256, lengths + 280, 7);
+        std::fill(lengths + 280, lengths + 288, 8);
+        std::fill(lengths + 288, lengths + 318, 5);
+        build(literals_, lengths, 288);
+        build(distances_, lengths + 288, 30);
+        state_ = State::Codes;
+        return FRESCO_OK;
+    }
+    if (type == 2) {
+        fresco_error_t result = read_dynamic_codes();
+        if (result == FRESCO_OK) {
+            state_ = State::Codes;
+        }
+        return result;
+    }
+    return FRESCO_ERROR_CORRUPTED_DATA;
+}
+
+fresco_error_t Inflater::read_dynamic_codes() {
+    if (!need(14)) {
+        return FRESCO_ERROR_CORRUPTED_DATA;
+    }
+    const uint32_t literal_count = bits(5) + 257;
+    const uint32_t distance_count = bits(5) + 1;
+    const uint32_t length_count = bits(4) + 4;
+    if (literal_count > 286 || distance_count > 30) {
+        return FRESCO_ERROR_CORRUPTED_DATA;
+    }
+
+    uint8_t lengths[286 + 30] = {};
+    for (uint32_t i = 0; i < length_count; i++) {
+        if (!need(3)) {
+            return FRESCO_ERROR_CORRUPTED_DATA;
+        }
+        lengths[kCodeLengthOrder[i]] = static_cast<uint8_t>(bits(3));
+    }
+    HuffmanCode length_code;
+    if (!build(length_code, lengths, 19)) {
+        return FRESCO_ERROR_CORRUPTED_DATA;
+    }
+
+    const uint32_t total = literal_count + distance_count;
+    std::fill(lengths, lengths + 19, 0);
+    for (uint32_t i = 0; i < total;) {
+        uint32_t symbol;
+        if (!decode(length_code, symbol)) {
+            return FRESCO_ERROR_CORRUPTED_DATA;
+        }
+        if (symbol < 16) {
+            lengths[i++] = static_cast<uint8_t>(symbol);
+            continue;
+        }
+        uint8_t value = 0;
+        uint32_t repeat;
+        if (symbol == 16) {
+            if (i == 0 || !need(2)) {
+                return FRESCO_ERROR_CORRUPTED_DATA;
+            }
+            value = lengths[i - 1];
+            repeat = 3 + bits(2);
+        } else if (symbol == 17) {
+            if (!need(3)) {
+                return FRESCO_ERROR_CORRUPTED_DATA;
+            }
+            repeat = 3 + bits(3);
+        } else {
+            if (!need(7)) {
+                return FRESCO_ERROR_CORRUPTED_DATA;
+            }
+            repeat = 11 + bits(7);
+        }
+        if (i + repeat > total) {
+            return FRESCO_ERROR_CORRUPTED_DATA;
+        }
+        std::fill(lengths + i, lengths + i + repeat, value);
+        i += repeat;
+    }
+    // The end-of-block code must be there
+    if (lengths[256] == 0 || !build(literals_, lengths, literal_count) ||
+        !build(distances_, lengths + literal_count, distance_count)) {
+        return FRESCO_ERROR_CORRUPTED_DATA;
+    }
+    return FRESCO_OK;
+}
+
+inline void Inflater::put(uint8_t byte, uint8_t*& out) {
+    window_[written_ & (kWindowSize - 1)] = byte;
+    written_++;
+    *out++ = byte;
+}
+
+fresco_error_t Inflater::read(uint8_t* out, size_t size) {
+    uint8_t* const start = out;
+    uint8_t* const end = out + size;
+    fresco_error_t result = FRESCO_OK;
+
+    if (!header_read_) {
+        // CMF and FLG: deflate with a window of at most 32 KiB, no preset
+        // dictionary, and a check value
+        if (!need(16)) {
+            return FRESCO_ERROR_CORRUPTED_DATA;
+        }
+        const uint32_t cmf = bits(8);
+        const uint32_t flg = bits(8);
+        if ((cmf & 15) != 8 || (cmf >> 4) > 7 || (flg & 0x20) || (cmf * 256 + flg) % 31 != 0) {
+            return FRESCO_ERROR_CORRUPTED_DATA;
+        }
+        header_read_ = true;
+    }
+
+    while (out < end && result == FRESCO_OK) {
+        if (match_left_ > 0) {
+            const uint32_t count =
+                static_cast<uint32_t>(std::min<size_t>(match_left_, end - out));
+            for (uint32_t i = 0; i < count; i++) {
+                put(window_[(written_ - match_distance_) & (kWindowSize - 1)], out);
+            }
+            match_left_ -= count;
+            continue;
+        }
+        switch (state_) {
+            case State::Header:
+                result = begin_block();
+                break;
+            case State::Stored: {
+                if (stored_left_ == 0) {
+                    state_ = final_ ? State::Done : State::Header;
+                    break;
+                }
+                // Whole bytes left in the bit buffer come first
+                while (stored_left_ > 0 && out < end && count_ >= 8) {
+                    put(static_cast<uint8_t>(bits(8)), out);
+                    stored_left_--;
+                }
+                while (stored_left_ > 0 && out < end) {
+                    while (span_ < input_.size() && pos_ >= input_[span_].size) {
+                        span_++;
+                        pos_ = 0;
+                    }
+                    if (span_ == input_.size()) {
+                        return FRESCO_ERROR_CORRUPTED_DATA;
+                    }
+                    const size_t count = std::min<size_t>(
+                        {stored_left_, static_cast<size_t>(end - out), input_[span_].size - pos_});
+                    const uint8_t* src = input_[span_].data + pos_;
+                    for (size_t i = 0; i < count; i++) {
+                        put(src[i], out);
+                    }
+                    pos_ += count;
+                    stored_left_ -= static_cast<uint32_t>(count);
+                }
+                break;
+            }
+            case State::Codes: {
+                uint32_t symbol;
+                if (!decode(literals_, symbol)) {
+                    return FRESCO_ERROR_CORRUPTED_DATA;
+                }
+                if (symbol < 256) {
+                    put(static_cast<uint8_t>(symbol), out);
+                    break;
+                }
+                if (symbol == 256) {
+                    state_ = final_ ? State::Done : State::Header;
+                    break;
+                }
+                symbol -= 257;
+                if (symbol >= 29 || !need(kLengthExtra[symbol])) {
+                    return FRESCO_ERROR_CORRUPTED_DATA;
+                }
+                const uint32_t length = kLengthBase[symbol] + bits(kLengthExtra[symbol]);
+                uint32_t distance_symbol;
+                if (!decode(distances_, distance_symbol) || distance_symbol >= 30 ||
+                    !need(kDistanceExtra[distance_symbol])) {
+                    return FRESCO_ERROR_CORRUPTED_DATA;
+                }
+                const uint32_t distance =
+                    kDistanceBase[distance_symbol] + bits(kDistanceExtra[distance_symbol]);
+                if (distance > written_) {
+                    return FRESCO_ERROR_CORRUPTED_DATA;
+                }
+                match_left_ = length;
+                match_distance_ = distance;
+                break;
+            }
+            case State::Done:
+                return FRESCO_ERROR_CORRUPTED_DATA;
+        }
+    }
+    if (result != FRESCO_OK) {
+        return result;
+    }
+
+    // Adler-32 of what was handed out, while it is still in cache
+    adler_ = adler32(adler_, start, size);
+    return FRESCO_OK;
+}
+
+fresco_error_t Inflater::finish() {
+    // Blocks that produce nothing, such as the empty final block of a
+    // flushed stream, may still be ahead
+    while (state_ != State::Done) {
+        if (match_left_ > 0 || (state_ == State::Stored && stored_left_ > 0)) {
+            return FRESCO_ERROR_CORRUPTED_DATA;
+        }
+        if (state_ == State::Stored) {
+            state_ = final_ ? State::Done : State::Header;
+        } else if (state_ == State::Header) {
+            fresco_error_t result = begin_block();
+            if (result != FRESCO_OK) {
+                return result;
+            }
+        } else {
+            uint32_t symbol;
+            if (!decode(literals_, symbol) || symbol != 256) {
+                return FRESCO_ERROR_CORRUPTED_DATA;
+            }
+            state_ = final_ ? State::Done : State::Header;
+        }
+    }
+    bits(count_ & 7);
+    if (!need(32)) {
+        return FRESCO_ERROR_CORRUPTED_DATA;
+    }
+    uint32_t check = 0;
+    for (int i = 0; i < 4; i++) {
+        check = (check << 8) | bits(8);
+    }
+    return check == adler_ ? FRESCO_OK : FRESCO_ERROR_CORRUPTED_DATA;
+}
+
+} // namespace fresco
@@ -0,0 +1,84 @@
+/**
+ * @file inflate.h
+ * @brief FRESCO zlib stream decoding
+ * @author Mehmet T. AKALIN
+ * @date 2025
+ * @license MIT
+ */
+
+#ifndef FRESCO_INFLATE_H
+#define FRESCO_INFLATE_H
+
+#include "fresco/fresco.h"
+#include <vector>
+
+namespace fresco {
+
+// Contiguous part of a compressed stream, such as the payload of one PNG
+// IDAT chunk
+struct ByteSpan {
+    const uint8_t* data;
+    size_t size;
+};
+
+/**
+ * Decodes a zlib stream (RFC 1950/1951) that may be split over several
+ * spans, without joining them. Output is pulled in pieces of any size, so a
+ * caller can take one row at a time and never hold the whole of it; only
+ * the 32 KiB that back-references may reach is kept.
+ */
+class Inflater {
+public:
+    explicit Inflater(std::vector<ByteSpan> input);
+
+    // Fills out with the next size bytes of output; a stream that ends
+    // first or is malformed gives FRESCO_ERROR_CORRUPTED_DATA
+    fresco_error_t read(uint8_t* out, size_t size);
+
+    // Checks that the stream ends after the output read so far, with a
+    // matching Adler-32
+    fresco_error_t finish();
+
+private:
+    // Canonical Huffman code: a lookup of the first kFastBits bits, and
+    // counts and symbols by length for the longer codes
+    struct HuffmanCode {
+        static constexpr uint32_t kFastBits = 10;
+        uint16_t fast[1u << kFastBits];    // (symbol << 4) | length, 0 when longer
+        uint16_t count[16];
+        uint16_t symbol[288];
+    };
+
+    enum class State { Header, Stored, Codes, Done };
+
+    bool need(uint32_t count);
+    uint32_t bits(uint32_t count);
+    bool build(HuffmanCode& code, const uint8_t* lengths, uint32_t count);
+    bool decode(const HuffmanCode& code, uint32_t& symbol);
+    fresco_error_t begin_block();
+    fresco_error_t read_dynamic_codes();
+    void put(uint8_t byte, uint8_t*& out);
+
+    std::vector<ByteSpan> input_;
+    size_t span_ = 0;
+    size_t pos_ = 0;
+    uint64_t buffer_ = 0;
+    uint32_t count_ = 0;
+
+    State state_ = State::Header;
+    bool final_ = false;
+    bool header_read_ = false;
+    uint32_t stored_left_ = 0;
+    uint32_t match_left_ = 0;
+    uint32_t match_distance_ = 0;
+    HuffmanCode literals_;
+    HuffmanCode distances_;
+
+    std::vector<uint8_t> window_;    // Last 32 KiB of output, circular
+    size_t written_ = 0;
+    uint32_t adler_ = 1;
+};
+
+} // namespace fresco
+
+#endif // FRESCO_INFLATE_H
@@ -0,0 +1,182 @@
+/**
+ * @file parallel.cpp
+ * @brief FRESCO parallel loop helpers
+ * @author Mehmet T. AKALIN
+ * @date 2025
+ * @license MIT
+ */
+
+#include "fresco/fresco.h"
+#include "parallel.h"
+#include "counters.h"
+#include "thread_pool.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+namespace fresco {
+
+namespace {
+
+// State of one parallel_for on a pool. Pool tasks hold it by shared_ptr, as
+// a task the loop cancelled may still be queued after parallel_for returns.
+struct PooledLoop {
+    PooledLoop(size_t count, uint32_t threads,
+               const std::function<void(size_t index, uint32_t worker)>& body)
+        : count(count), body(body), claimed(threads, false) {}
+
+    const size_t count;
+    const std::function<void(size_t index, uint32_t worker)>& body;
+    std::atomic<size_t> next{0};
+    std::atomic<size_t> taken{0};
+    std::mutex mutex;
+    std::condition_variable finished;
+    std::vector<bool> claimed;  // Per worker id, under mutex
+    uint32_t running = 0;       // Workers claimed by the pool and not done
+    std::exception_ptr error;
+
+    void work(uint32_t worker) {
+        try {
+            for (size_t i = next.fetch_add(1); i < count; i = next.fetch_add(1)) {
+                taken.fetch_add(1, std::memory_order_relaxed);
+                counter_sub(Counter::QueueDepth, 1);
+                body(i, worker);
+            }
+        } catch (...) {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (!error) {
+                error = std::current_exception();
+            }
+            next.store(count);
+        }
+    }
+};
+
+// Workers 1 and up are offered to the pool, worker 0 is the caller. Those
+// the pool has not started by the time the caller runs out of items are
+// cancelled rather than waited for, so a busy pool never delays the call.
+void pooled_for(ThreadPool& pool, size_t count, uint32_t threads,
+                const std::function<void(size_t index, uint32_t worker)>& body) {
+    auto loop = std::make_shared<PooledLoop>(count, threads, body);
+    for (uint32_t worker = 1; worker < threads; worker++) {
+        try {
+            pool.submit([loop, worker]() {
+                {
+                    std::lock_guard<std::mutex> lock(loop->mutex);
+                    if (loop->claimed[worker]) {
+                        return;
+                    }
+                    loop->claimed[worker] = true;
+                    loop->running++;
+                }
+                loop->work(worker);
+                std::lock_guard<std::mutex> lock(loop->mutex);
+                loop->running--;
+                loop->finished.notify_all();
+            });
+        } catch (const std::bad_alloc&) {
+            // The workers already offered pick up the remaining items
+            break;
+        }
+    }
+    loop->work(0);
+
+    std::unique_lock<std::mutex> lock(loop->mutex);
+    std::fill(loop->claimed.begin(), loop->claimed.end(), true);
+    while (loop->running > 0) {
+        loop->finished.wait_for(lock, std::chrono::milliseconds(100));
+    }
+    counter_sub(Counter::QueueDepth, count - loop->taken.load());
+    if (loop->error) {
+        std::rethrow_exception(loop->error);
+    }
+}
+
+} // namespace
+
+uint32_t resolve_thread_count(uint32_t max_threads, size_t count) {
+    uint32_t threads = max_threads;
+    if (threads == 0) {
+        const ThreadPool* pool = current_pool();
+        threads = pool ? pool->size() : std::max(1u, std::thread::hardware_concurrency());
+    }
+    if (count < threads) {
+        threads = static_cast<uint32_t>(std::max<size_t>(count, 1));
+    }
+    return threads;
+}
+
+void parallel_for(size_t count, uint32_t max_threads,
+                  const std::function<void(size_t index, uint32_t worker)>& body) {
+    // Every item counts towards the queue depth until a worker takes it
+    const uint32_t threads = resolve_thread_count(max_threads, count);
+    counter_add(Counter::QueueDepth, count);
+    if (threads <= 1) {
+        size_t i = 0;
+        try {
+            for (; i < count; i++) {
+                counter_sub(Counter::QueueDepth, 1);
+                body(i, 0);
+            }
+        } catch (...) {
+            counter_sub(Counter::QueueDepth, count - i - 1);
+            throw;
+        }
+        return;
+    }
+
+    if (ThreadPool* pool = current_pool()) {
+        pooled_for(*pool, count, threads, body);
+        return;
+    }
+
+    std::atomic<size_t> next(0);
+    std::atomic<size_t> taken(0);
+    std::exception_ptr error;
+    std::mutex error_mutex;
+
+    auto worker_loop = [&](uint32_t worker) {
+        try {
+            for (size_t i = next.fetch_add(1); i < count; i = next.fetch_add(1)) {
+                taken.fetch_add(1, std::memory_order_relaxed);
+                counter_sub(Counter::QueueDepth, 1);
+                body(i, worker);
+            }
+        } catch (...) {
+            std::lock_guard<std::mutex> lock(error_mutex);
+            if (!error) {
+                error = std::current_exception();
+            }
+            next.store(count);
+        }
+    };
+
+    std::vector<std::thread> workers;
+    workers.reserve(threads - 1);
+    for (uint32_t worker = 1; worker < threads; worker++) {
+        try {
+            workers.emplace_back(worker_loop, worker);
+        } catch (const std::system_error&) {
+            // The workers already running pick up the remaining items
+            break;
+        }
+    }
+    worker_loop(0);
+    for (auto& thread : workers) {
+        thread.join();
+    }
+    counter_sub(Counter::QueueDepth, count - taken.load());
+
+    if (error) {
+        std::rethrow_exception(error);
+    }
+}
+
+} // namespace fresco
@@ -0,0 +1,31 @@
+/**
+ * @file parallel.h
+ * @brief FRESCO parallel loop helpers
+ * @author Mehmet T. AKALIN
+ * @date 2025
+ * @license MIT
+ */
+
+#ifndef FRESCO_PARALLEL_H
+#define FRESCO_PARALLEL_H
+
+#include "fresco/fresco.h"
+#include <functional>
+
+namespace fresco {
+
+// Number of workers used for count items; max_threads 0 means one per core,
+// or one per pool thread inside a PoolScope
+uint32_t resolve_thread_count(uint32_t max_threads, size_t count);
+
+// Runs body(index, worker) for every index in [0, count). Worker ids are
+// below resolve_thread_count(max_threads, count), so callers can keep
+// per-worker scratch. The first exception thrown by body is rethrown.
+// Inside a PoolScope the workers run on the pool with the calling thread
+// as one of them; otherwise each call starts threads of its own.
+void parallel_for(size_t count, uint32_t max_threads,
+                  const std::function<void(size_t index, uint32_t worker)>& body);
+
+} // namespace fresco
+
+#endif // FRESCO_PARALLEL_H
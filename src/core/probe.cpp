@@ -0,0 +1,124 @@
+/**
+ * @file probe.cpp
+ * @brief FRESCO metadata probe of files on disk
+ * @author Mehmet T. AKALIN
+ * @date 2025
+ * @license MIT
+ */
+
+#include "fresco/fresco.h"
+#include "container.h"
+#include "utils.h"
+#include <cerrno>
+#include <cstdio>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace fresco {
+
+namespace {
+
+fresco_error_t probe(const Container::ReadAt& read, uint64_t file_size,
+                     fresco_metadata_t* metadata) {
+    try {
+        ContainerInfo container_info;
+        fresco_error_t result = Container::probe(read, file_size, container_info);
+        if (result != FRESCO_OK) {
+            return result;
+        }
+        fill_metadata(container_info, file_size, *metadata);
+        return FRESCO_OK;
+    } catch (const std::bad_alloc&) {
+        return FRESCO_ERROR_OUT_OF_MEMORY;
+    } catch (const std::exception&) {
+        return FRESCO_ERROR_DECODING_FAILED;
+    }
+}
+
+#ifndef _WIN32
+// pread until size bytes are in, so short reads from network file
+// systems are not mistaken for the end of the file
+bool pread_all(int fd, uint64_t offset, size_t size, uint8_t* out) {
+    while (size > 0) {
+        const ssize_t got = ::pread(fd, out, size, static_cast<off_t>(offset));
+        if (got < 0 && errno == EINTR) {
+            continue;
+        }
+        if (got <= 0) {
+            return false;
+        }
+        out += got;
+        offset += static_cast<uint64_t>(got);
+        size -= static_cast<size_t>(got);
+    }
+    return true;
+}
+#endif
+
+} // namespace
+
+} // namespace fresco
+
+extern "C" {
+
+fresco_error_t fresco_probe_fd(int fd, fresco_metadata_t* metadata) {
+    if (fd < 0 || !metadata) {
+        return FRESCO_ERROR_INVALID_PARAMETER;
+    }
+#ifndef _WIN32
+    struct stat info;
+    if (::fstat(fd, &info) != 0 || !S_ISREG(info.st_mode)) {
+        return FRESCO_ERROR_IO;
+    }
+    return fresco::probe(
+        [fd](uint64_t offset, size_t size, uint8_t* out) {
+            return fresco::pread_all(fd, offset, size, out);
+        },
+        static_cast<uint64_t>(info.st_size), metadata);
+#else
+    return FRESCO_ERROR_NOT_IMPLEMENTED;
+#endif
+}
+
+fresco_error_t fresco_probe_path(const char* path, fresco_metadata_t* metadata) {
+    if (!path || !metadata) {
+        return FRESCO_ERROR_INVALID_PARAMETER;
+    }
+#ifndef _WIN32
+    int fd;
+    do {
+        fd = ::open(path, O_RDONLY | O_CLOEXEC);
+    } while (fd < 0 && errno == EINTR);
+    if (fd < 0) {
+        return FRESCO_ERROR_IO;
+    }
+    const fresco_error_t result = fresco_probe_fd(fd, metadata);
+    ::close(fd);
+    return result;
+#else
+    FILE* file = std::fopen(path, "rb");
+    if (!file) {
+        return FRESCO_ERROR_IO;
+    }
+    fresco_error_t result = FRESCO_ERROR_IO;
+    if (_fseeki64(file, 0, SEEK_END) == 0) {
+        const __int64 file_size = _ftelli64(file);
+        if (file_size >= 0) {
+            result = fresco::probe(
+                [file](uint64_t offset, size_t size, uint8_t* out) {
+                    return _fseeki64(file, static_cast<__int64>(offset), SEEK_SET) == 0 &&
+                           std::fread(out, 1, size, file) == size;
+                },
+                static_cast<uint64_t>(file_size), metadata);
+        }
+    }
+    std::fclose(file);
+    return result;
+#endif
+}
+
+} // extern "C"
@@ -0,0 +1,204 @@
+/**
+ * @file pyramid.cpp
+ * @brief FRESCO deep-zoom pyramid tiling
+ * @author Mehmet T. AKALIN
+ * @date 2025
+ * @license MIT
+ */
+
+#include "pyramid.h"
+#include "parallel.h"
+#include <algorithm>
+
+namespace fresco {
+
+namespace {
+
+uint32_t halve(uint32_t size) {
+    return (size + 1) / 2;
+}
+
+uint32_t tile_count(uint32_t size, uint32_t tile_size) {
+    return (size + tile_size - 1) / tile_size;
+}
+
+// 2x2 box filter; on odd edges the last row or column is read twice, which
+// keeps every output a mean of four samples
+void downsample(const uint8_t* src, uint32_t width, uint32_t height, uint8_t channels,
+                uint8_t* dst) {
+    const uint32_t out_width = halve(width);
+    const uint32_t out_height = halve(height);
+    const size_t src_stride = static_cast<size_t>(width) * channels;
+    for (uint32_t y = 0; y < out_height; y++) {
+        const uint32_t y1 = std::min(2 * y + 1, height - 1);
+        const uint8_t* row0 = src + 2 * y * src_stride;
+        const uint8_t* row1 = src + y1 * src_stride;
+        for (uint32_t x = 0; x < out_width; x++) {
+            const uint32_t x1 = std::min(2 * x + 1, width - 1);
+            for (uint8_t c = 0; c < channels; c++) {
+                const uint32_t sum = row0[2 * x * channels + c] + row0[x1 * channels + c] +
+                                     row1[2 * x * channels + c] + row1[x1 * channels + c];
+                *dst++ = static_cast<uint8_t>((sum + 2) / 4);
+            }
+        }
+    }
+}
+
+} // namespace
+
+uint32_t pyramid_top_level(uint32_t width, uint32_t height) {
+    uint32_t level = 0;
+    while (width > 1 || height > 1) {
+        width = halve(width);
+        height = halve(height);
+        level++;
+    }
+    return level;
+}
+
+PyramidBuilder::PyramidBuilder(uint32_t width, uint32_t height, uint8_t channels,
+                               uint32_t native_levels, uint32_t raster_tile,
+                               const fresco_pyramid_params_t& params, uint32_t max_threads,
+                               fresco_pyramid_sink_t sink, void* user_data)
+    : channels_(channels), raster_tile_(raster_tile),
+      top_level_(pyramid_top_level(width, height)), params_(params),
+      max_threads_(max_threads), sink_(sink), user_data_(user_data) {
+    const uint32_t coarsest = top_level_ - params_.min_level;
+    canvases_.resize(std::min(native_levels, coarsest) + 1);
+    for (size_t reduction = 0; reduction < canvases_.size(); reduction++) {
+        Canvas& canvas = canvases_[reduction];
+        canvas.width = static_cast<uint32_t>((uint64_t(width) + (uint64_t(1) << reduction) - 1) >>
+                                             reduction);
+        canvas.height = static_cast<uint32_t>(
+            (uint64_t(height) + (uint64_t(1) << reduction) - 1) >> reduction);
+    }
+    canvases_.back().keep = canvases_.size() - 1 < coarsest;
+}
+
+fresco_error_t PyramidBuilder::begin_row(uint32_t row) {
+    // Workers write into the rows concurrently, so they are all there first
+    const uint64_t bottom = (uint64_t(row) + 1) * raster_tile_;
+    for (size_t reduction = 0; reduction < canvases_.size(); reduction++) {
+        Canvas& canvas = canvases_[reduction];
+        const uint32_t rows =
+            static_cast<uint32_t>(std::min<uint64_t>(canvas.height, bottom >> reduction));
+        canvas.pixels.resize(static_cast<size_t>(rows - canvas.top) * canvas.width * channels_);
+    }
+    return FRESCO_OK;
+}
+
+uint8_t* PyramidBuilder::tile_pixels(uint32_t level, uint32_t x, uint32_t y,
+                                     size_t& row_stride) {
+    Canvas& canvas = canvases_[level];
+    row_stride = static_cast<size_t>(canvas.width) * channels_;
+    return canvas.pixels.data() + (y - canvas.top) * row_stride +
+           static_cast<size_t>(x) * channels_;
+}
+
+fresco_error_t PyramidBuilder::end_row(uint32_t row) {
+    const uint64_t bottom = (uint64_t(row) + 1) * raster_tile_;
+    for (size_t reduction = 0; reduction < canvases_.size(); reduction++) {
+        Canvas& canvas = canvases_[reduction];
+        canvas.filled =
+            static_cast<uint32_t>(std::min<uint64_t>(canvas.height, bottom >> reduction));
+        fresco_error_t result = emit_ready(canvas, top_level_ - static_cast<uint32_t>(reduction));
+        if (result != FRESCO_OK) {
+            return result;
+        }
+    }
+    return FRESCO_OK;
+}
+
+fresco_error_t PyramidBuilder::finish() {
+    Canvas source = std::move(canvases_.back());
+    uint32_t level = top_level_ - static_cast<uint32_t>(canvases_.size() - 1);
+    while (level > params_.min_level) {
+        level--;
+        Canvas canvas;
+        canvas.width = halve(source.width);
+        canvas.height = halve(source.height);
+        canvas.filled = canvas.height;
+        canvas.keep = level > params_.min_level;
+        canvas.pixels.resize(static_cast<size_t>(canvas.width) * canvas.height * channels_);
+        downsample(source.pixels.data(), source.width, source.height, channels_,
+                   canvas.pixels.data());
+        fresco_error_t result = emit_ready(canvas, level);
+        if (result != FRESCO_OK) {
+            return result;
+        }
+        source = std::move(canvas);
+    }
+    return FRESCO_OK;
+}
+
+fresco_error_t PyramidBuilder::emit_ready(Canvas& canvas, uint32_t level) {
+    const uint32_t tile_size = params_.tile_size;
+    const uint32_t overlap = params_.overlap;
+    const uint32_t rows = tile_count(canvas.height, tile_size);
+    while (canvas.next_row < rows) {
+        const uint64_t bottom = (uint64_t(canvas.next_row) + 1) * tile_size + overlap;
+        if (std::min<uint64_t>(bottom, canvas.height) > canvas.filled) {
+            break;
+        }
+        fresco_error_t result = emit_row(canvas, level, canvas.next_row);
+        if (result != FRESCO_OK) {
+            return result;
+        }
+        canvas.next_row++;
+    }
+    if (canvas.keep) {
+        return FRESCO_OK;
+    }
+
+    // Drop the rows above the next row of tiles, overlap included
+    uint32_t first = canvas.filled;
+    if (canvas.next_row < rows) {
+        first = canvas.next_row * tile_size - (canvas.next_row ? overlap : 0);
+    }
+    if (first > canvas.top) {
+        const size_t row_bytes = static_cast<size_t>(canvas.width) * channels_;
+        canvas.pixels.erase(canvas.pixels.begin(),
+                            canvas.pixels.begin() + (first - canvas.top) * row_bytes);
+        canvas.top = first;
+    }
+    return FRESCO_OK;
+}
+
+fresco_error_t PyramidBuilder::emit_row(const Canvas& canvas, uint32_t level, uint32_t row) {
+    const uint32_t tile_size = params_.tile_size;
+    const uint32_t overlap = params_.overlap;
+    const uint32_t columns = tile_count(canvas.width, tile_size);
+    const size_t row_bytes = static_cast<size_t>(canvas.width) * channels_;
+    const uint32_t y0 = row * tile_size - (row ? overlap : 0);
+    const uint32_t y1 = static_cast<uint32_t>(
+        std::min<uint64_t>(canvas.height, (uint64_t(row) + 1) * tile_size + overlap));
+
+    std::vector<fresco_error_t> results(columns, FRESCO_OK);
+    parallel_for(columns, max_threads_, [&](size_t column, uint32_t) {
+        const uint32_t x0 = static_cast<uint32_t>(column) * tile_size - (column ? overlap : 0);
+        const uint32_t x1 = static_cast<uint32_t>(
+            std::min<uint64_t>(canvas.width, (uint64_t(column) + 1) * tile_size + overlap));
+        fresco_image_t tile = {};
+        tile.pixels = canvas.pixels.data() + (y0 - canvas.top) * row_bytes +
+                      static_cast<size_t>(x0) * channels_;
+        tile.width = x1 - x0;
+        tile.height = y1 - y0;
+        tile.channels = channels_;
+        tile.row_stride = row_bytes;
+        results[column] = sink_(level, static_cast<uint32_t>(column), row, &tile, user_data_);
+    });
+    for (uint32_t column = 0; column < columns; column++) {
+        const uint32_t x0 = column * tile_size - (column ? overlap : 0);
+        const uint32_t x1 = static_cast<uint32_t>(
+            std::min<uint64_t>(canvas.width, (uint64_t(column) + 1) * tile_size + overlap));
+        tile_bytes_ += static_cast<uint64_t>(x1 - x0) * (y1 - y0) * channels_;
+    }
+    for (fresco_error_t result : results) {
+        if (result != FRESCO_OK) {
+            return result;
+        }
+    }
+    return FRESCO_OK;
+}
+
+} // namespace fresco
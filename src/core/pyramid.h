@@ -0,0 +1,76 @@
+/**
+ * @file pyramid.h
+ * @brief FRESCO deep-zoom pyramid tiling
+ * @author Mehmet T. AKALIN
+ * @date 2025
+ * @license MIT
+ */
+
+#ifndef FRESCO_PYRAMID_H
+#define FRESCO_PYRAMID_H
+
+#include "fresco/fresco.h"
+#include "compression.h"
+#include <vector>
+
+namespace fresco {
+
+// Level of the full-size image in a pyramid: the number of halvings, each
+// rounded up, that take width and height down to a single pixel
+uint32_t pyramid_top_level(uint32_t width, uint32_t height);
+
+// Cuts the levels written by Compression::decompress_levels into pyramid
+// tiles as soon as their rows are complete. Each level keeps only the band
+// of rows its next row of tiles needs, except the coarsest decoded level
+// when coarser ones must still be downsampled from it.
+class PyramidBuilder : public TileRowSink {
+public:
+    // native_levels and raster_tile as Compression::native_levels reports
+    // them; params.tile_size must be set, overlap below it and min_level at
+    // most the top level
+    PyramidBuilder(uint32_t width, uint32_t height, uint8_t channels, uint32_t native_levels,
+                   uint32_t raster_tile, const fresco_pyramid_params_t& params,
+                   uint32_t max_threads, fresco_pyramid_sink_t sink, void* user_data);
+
+    // Deepest level below full size to decode, as max_level of decompress_levels
+    uint32_t max_reduction() const { return static_cast<uint32_t>(canvases_.size() - 1); }
+
+    fresco_error_t begin_row(uint32_t row) override;
+    uint8_t* tile_pixels(uint32_t level, uint32_t x, uint32_t y, size_t& row_stride) override;
+    fresco_error_t end_row(uint32_t row) override;
+
+    // Downsamples and emits the levels coarser than the decoded ones
+    fresco_error_t finish();
+
+    // Bytes of pixels passed to the sink
+    uint64_t tile_bytes() const { return tile_bytes_; }
+
+private:
+    // One level, rows [top, filled) held in pixels
+    struct Canvas {
+        uint32_t width = 0;
+        uint32_t height = 0;
+        uint32_t top = 0;
+        uint32_t filled = 0;
+        uint32_t next_row = 0;    // First row of output tiles not yet emitted
+        bool keep = false;        // Hold every row for the coarser levels
+        std::vector<uint8_t> pixels;
+    };
+
+    fresco_error_t emit_ready(Canvas& canvas, uint32_t level);
+    fresco_error_t emit_row(const Canvas& canvas, uint32_t level, uint32_t row);
+
+    uint8_t channels_;
+    uint32_t raster_tile_;
+    uint32_t top_level_;
+    fresco_pyramid_params_t params_;
+    uint32_t max_threads_;
+    fresco_pyramid_sink_t sink_;
+    void* user_data_;
+    std::vector<Canvas> canvases_;    // Indexed by reduction, 0 for full size
+    uint64_t tile_bytes_ = 0;
+};
+
+} // namespace fresco
+
+#endif // FRESCO_PYRAMID_H
@@ -0,0 +1,164 @@
+/**
+ * @file range_coder.h
+ * @brief Adaptive binary range coder
+ * @author Mehmet T. AKALIN
+ * @date 2025
+ * @license MIT
+ */
+
+#ifndef FRESCO_RANGE_CODER_H
+#define FRESCO_RANGE_CODER_H
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+namespace fresco {
+
+constexpr uint32_t kProbBits = 12;
+constexpr uint32_t kProbOne = 1u << kProbBits;
+constexpr uint32_t kProbAdaptShift = 5;
+constexpr uint32_t kRangeTop = 1u << 24;
+
+// Probability that the next bit is 0, in units of 1/4096
+struct BitModel {
+    uint16_t p = kProbOne / 2;
+};
+
+/**
+ * Binary arithmetic coder in the LZMA style: 32-bit range, byte-wise
+ * renormalization and carry propagation through a cached byte. Models adapt
+ * by 1/32 of the distance to the coded bit.
+ */
+class RangeEncoder {
+public:
+    explicit RangeEncoder(std::vector<uint8_t>& out) : out_(out) {}
+
+    void encode(BitModel& model, uint32_t bit) {
+        const uint32_t bound = (range_ >> kProbBits) * model.p;
+        if (bit == 0) {
+            range_ = bound;
+            model.p += (kProbOne - model.p) >> kProbAdaptShift;
+        } else {
+            low_ += bound;
+            range_ -= bound;
+            model.p -= model.p >> kProbAdaptShift;
+        }
+        while (range_ < kRangeTop) {
+            range_ <<= 8;
+            shift_low();
+        }
+    }
+
+    // Equiprobable bits, most significant first
+    void encode_direct(uint32_t value, uint32_t bit_count) {
+        while (bit_count > 0) {
+            bit_count--;
+            range_ >>= 1;
+            if ((value >> bit_count) & 1) {
+                low_ += range_;
+            }
+            while (range_ < kRangeTop) {
+                range_ <<= 8;
+                shift_low();
+            }
+        }
+    }
+
+    void finish() {
+        for (int i = 0; i < 5; i++) {
+            shift_low();
+        }
+    }
+
+private:
+    void shift_low() {
+        if (static_cast<uint32_t>(low_) < 0xff000000u || (low_ >> 32) != 0) {
+            const uint8_t carry = static_cast<uint8_t>(low_ >> 32);
+            uint8_t byte = cache_;
+            do {
+                out_.push_back(static_cast<uint8_t>(byte + carry));
+                byte = 0xff;
+            } while (--pending_ != 0);
+            cache_ = static_cast<uint8_t>(low_ >> 24);
+        }
+        pending_++;
+        low_ = (low_ & 0x00ffffffu) << 8;
+    }
+
+    std::vector<uint8_t>& out_;
+    uint64_t low_ = 0;
+    uint32_t range_ = 0xffffffffu;
+    uint8_t cache_ = 0;
+    uint64_t pending_ = 1;
+};
+
+// Reads past the end return zero bytes; overrun() tells whether the
+// stream was shorter than what was decoded from it
+class RangeDecoder {
+public:
+    RangeDecoder(const uint8_t* data, const uint8_t* end) : data_(data), end_(end) {
+        for (int i = 0; i < 5; i++) {
+            code_ = (code_ << 8) | next_byte();
+        }
+    }
+
+    uint32_t decode(BitModel& model) {
+        const uint32_t bound = (range_ >> kProbBits) * model.p;
+        uint32_t bit;
+        if (code_ < bound) {
+            range_ = bound;
+            model.p += (kProbOne - model.p) >> kProbAdaptShift;
+            bit = 0;
+        } else {
+            code_ -= bound;
+            range_ -= bound;
+            model.p -= model.p >> kProbAdaptShift;
+            bit = 1;
+        }
+        while (range_ < kRangeTop) {
+            range_ <<= 8;
+            code_ = (code_ << 8) | next_byte();
+        }
+        return bit;
+    }
+
+    uint32_t decode_direct(uint32_t bit_count) {
+        uint32_t value = 0;
+        while (bit_count > 0) {
+            bit_count--;
+            range_ >>= 1;
+            const uint32_t bit = code_ >= range_ ? 1 : 0;
+            code_ -= range_ & (0u - bit);
+            value = (value << 1) | bit;
+            while (range_ < kRangeTop) {
+                range_ <<= 8;
+                code_ = (code_ << 8) | next_byte();
+            }
+        }
+        return value;
+    }
+
+    // finish() writes out all of low, so the decoder reads exactly the bytes
+    // of a valid stream and never beyond its end
+    bool overrun() const { return overrun_ > 0; }
+
+private:
+    uint8_t next_byte() {
+        if (data_ < end_) {
+            return *data_++;
+        }
+        overrun_++;
+        return 0;
+    }
+
+    const uint8_t* data_;
+    const uint8_t* end_;
+    uint32_t code_ = 0;
+    uint32_t range_ = 0xffffffffu;
+    size_t overrun_ = 0;
+};
+
+} // namespace fresco
+
+#endif // FRESCO_RANGE_CODER_H
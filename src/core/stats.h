@@ -0,0 +1,140 @@
+/**
+ * @file stats.h
+ * @brief FRESCO per-call stage timing
+ * @author Mehmet T. AKALIN
+ * @date 2025
+ * @license MIT
+ */
+
+#ifndef FRESCO_STATS_H
+#define FRESCO_STATS_H
+
+#include "fresco/fresco.h"
+#include "trace.h"
+#include <chrono>
+#include <cstddef>
+#include <vector>
+
+namespace fresco {
+
+enum class Stage : uint32_t {
+    Parse = 0,
+    Color,
+    Transform,
+    Quantize,
+    Entropy,
+    Container,
+    Vector,
+    Mesh
+};
+
+constexpr size_t kStageCount = 8;
+
+inline const char* stage_name(Stage stage) {
+    static const char* const names[kStageCount] = {
+        "parse", "color", "transform", "quantize", "entropy", "container", "vector", "mesh"};
+    return names[static_cast<size_t>(stage)];
+}
+
+inline uint64_t now_ns() {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+struct StageTimes {
+    uint64_t ns[kStageCount] = {};
+
+    uint64_t& operator[](Stage stage) { return ns[static_cast<size_t>(stage)]; }
+    uint64_t operator[](Stage stage) const { return ns[static_cast<size_t>(stage)]; }
+
+    void merge(const StageTimes& other) {
+        for (size_t i = 0; i < kStageCount; i++) {
+            ns[i] += other.ns[i];
+        }
+    }
+};
+
+// Charges the time since the previous lap (or construction) to a stage, so
+// consecutive stages of a loop cost one clock read each. While a trace sink
+// is set every lap is also a trace event; a stopwatch given a tile index
+// traces its whole lifetime as that tile.
+class Stopwatch {
+public:
+    explicit Stopwatch(StageTimes& times, int64_t tile = -1)
+        : times_(times), last_(now_ns()), start_(last_), tile_(tile), traced_(trace_enabled()) {}
+
+    ~Stopwatch() {
+        if (traced_ && tile_ >= 0) {
+            trace_complete("tile", start_, now_ns(), tile_);
+        }
+    }
+
+    Stopwatch(const Stopwatch&) = delete;
+    Stopwatch& operator=(const Stopwatch&) = delete;
+
+    void lap(Stage stage) {
+        const uint64_t now = now_ns();
+        times_[stage] += now - last_;
+        if (traced_) {
+            trace_complete(stage_name(stage), last_, now, tile_);
+        }
+        last_ = now;
+    }
+
+    // Drops the time since the previous lap, e.g. time spent waiting on
+    // workers that keep their own stopwatches
+    void skip() { last_ = now_ns(); }
+
+private:
+    StageTimes& times_;
+    uint64_t last_;
+    uint64_t start_;
+    int64_t tile_;
+    bool traced_;
+};
+
+// What the raster codec reports back for one call
+struct RasterStats {
+    StageTimes times;                 // Summed over workers
+    uint64_t tiles = 0;               // Tile codings, every rate control pass included
+    uint32_t threads = 0;
+    uint64_t peak_scratch_bytes = 0;
+    uint64_t tile_cache_hits = 0;
+};
+
+template <typename T>
+uint64_t capacity_bytes(const std::vector<T>& buffer) {
+    return static_cast<uint64_t>(buffer.capacity()) * sizeof(T);
+}
+
+template <typename T>
+uint64_t capacity_bytes(const std::vector<std::vector<T>>& buffers) {
+    uint64_t bytes = static_cast<uint64_t>(buffers.capacity()) * sizeof(std::vector<T>);
+    for (const auto& buffer : buffers) {
+        bytes += capacity_bytes(buffer);
+    }
+    return bytes;
+}
+
+// Public form of the stage times and raster figures; track sizes are left
+// to the caller
+inline void fill_stats(const StageTimes& times, const RasterStats& raster, uint64_t total_ns,
+                       fresco_stats_t& stats) {
+    stats.total_ns = total_ns;
+    stats.parse_ns = times[Stage::Parse];
+    stats.color_ns = times[Stage::Color];
+    stats.transform_ns = times[Stage::Transform];
+    stats.quantize_ns = times[Stage::Quantize];
+    stats.entropy_ns = times[Stage::Entropy];
+    stats.container_ns = times[Stage::Container];
+    stats.vector_ns = times[Stage::Vector];
+    stats.mesh_ns = times[Stage::Mesh];
+    stats.tiles = raster.tiles;
+    stats.threads = raster.threads;
+    stats.peak_scratch_bytes = raster.peak_scratch_bytes;
+    stats.tile_cache_hits = raster.tile_cache_hits;
+}
+
+} // namespace fresco
+
+#endif // FRESCO_STATS_H
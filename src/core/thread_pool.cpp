@@ -0,0 +1,164 @@
+/**
+ * @file thread_pool.cpp
+ * @brief FRESCO work-stealing thread pool
+ * @author Mehmet T. AKALIN
+ * @date 2025
+ * @license MIT
+ */
+
+#include "thread_pool.h"
+#include <algorithm>
+#include <chrono>
+#include <new>
+#include <system_error>
+
+namespace fresco {
+
+namespace {
+
+thread_local ThreadPool* t_scope_pool = nullptr;
+// Set on pool workers, whose own submissions go to their own deque
+thread_local ThreadPool* t_worker_pool = nullptr;
+thread_local uint32_t t_worker_index = 0;
+
+} // namespace
+
+ThreadPool::ThreadPool(uint32_t threads) {
+    if (threads == 0) {
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    for (uint32_t i = 0; i < threads; i++) {
+        deques_.push_back(std::make_unique<Deque>());
+    }
+    workers_.reserve(threads);
+    try {
+        for (uint32_t i = 0; i < threads; i++) {
+            workers_.emplace_back(&ThreadPool::run, this, i);
+        }
+    } catch (...) {
+        {
+            std::lock_guard<std::mutex> lock(sleep_mutex_);
+            stopping_ = true;
+        }
+        wake_.notify_all();
+        for (auto& worker : workers_) {
+            worker.join();
+        }
+        throw;
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(sleep_mutex_);
+        stopping_ = true;
+    }
+    wake_.notify_all();
+    for (auto& worker : workers_) {
+        worker.join();
+    }
+}
+
+void ThreadPool::submit(std::function<void()> task) {
+    const uint32_t target = t_worker_pool == this
+                                ? t_worker_index
+                                : next_deque_.fetch_add(1, std::memory_order_relaxed) % size();
+    {
+        Deque& deque = *deques_[target];
+        std::lock_guard<std::mutex> lock(deque.mutex);
+        deque.tasks.push_back(std::move(task));
+    }
+    queued_.fetch_add(1);
+    // A worker that saw nothing queued is either still before its check,
+    // and will see this task, or already waiting, and gets the notify
+    { std::lock_guard<std::mutex> lock(sleep_mutex_); }
+    wake_.notify_one();
+}
+
+bool ThreadPool::take(uint32_t self, std::function<void()>& task) {
+    const uint32_t count = size();
+    for (uint32_t k = 0; k < count; k++) {
+        Deque& deque = *deques_[(self + k) % count];
+        std::lock_guard<std::mutex> lock(deque.mutex);
+        if (deque.tasks.empty()) {
+            continue;
+        }
+        // Newest from the own deque, oldest from a victim's
+        if (k == 0) {
+            task = std::move(deque.tasks.back());
+            deque.tasks.pop_back();
+        } else {
+            task = std::move(deque.tasks.front());
+            deque.tasks.pop_front();
+        }
+        queued_.fetch_sub(1);
+        return true;
+    }
+    return false;
+}
+
+void ThreadPool::run(uint32_t self) {
+    t_worker_pool = this;
+    t_worker_index = self;
+    for (;;) {
+        std::function<void()> task;
+        if (take(self, task)) {
+            task();
+            continue;
+        }
+        std::unique_lock<std::mutex> lock(sleep_mutex_);
+        if (queued_.load() > 0) {
+            continue;
+        }
+        if (stopping_) {
+            return;
+        }
+        // Timed, as in AsyncWorker, to stay clear of the untimed wait's
+        // newer libstdc++ symbol
+        wake_.wait_for(lock, std::chrono::seconds(1));
+    }
+}
+
+PoolScope::PoolScope(ThreadPool* pool) : previous_(t_scope_pool) {
+    t_scope_pool = pool;
+}
+
+PoolScope::~PoolScope() {
+    t_scope_pool = previous_;
+}
+
+ThreadPool* current_pool() {
+    return t_scope_pool;
+}
+
+} // namespace fresco
+
+extern "C" {
+
+fresco_error_t fresco_thread_pool_create(uint32_t threads, fresco_thread_pool_t** pool) {
+    if (!pool) {
+        return FRESCO_ERROR_INVALID_PARAMETER;
+    }
+
+    try {
+        *pool = reinterpret_cast<fresco_thread_pool_t*>(new fresco::ThreadPool(threads));
+        return FRESCO_OK;
+    } catch (const std::bad_alloc&) {
+        return FRESCO_ERROR_OUT_OF_MEMORY;
+    } catch (const std::system_error&) {
+        // Not every worker thread could be started
+        return FRESCO_ERROR_OUT_OF_MEMORY;
+    }
+}
+
+void fresco_thread_pool_destroy(fresco_thread_pool_t* pool) {
+    if (pool) {
+        delete reinterpret_cast<fresco::ThreadPool*>(pool);
+    }
+}
+
+uint32_t fresco_thread_pool_size(const fresco_thread_pool_t* pool) {
+    return pool ? reinterpret_cast<const fresco::ThreadPool*>(pool)->size() : 0;
+}
+
+} // extern "C"
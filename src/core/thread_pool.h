@@ -0,0 +1,81 @@
+/**
+ * @file thread_pool.h
+ * @brief FRESCO work-stealing thread pool
+ * @author Mehmet T. AKALIN
+ * @date 2025
+ * @license MIT
+ */
+
+#ifndef FRESCO_THREAD_POOL_H
+#define FRESCO_THREAD_POOL_H
+
+#include "fresco/fresco.h"
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace fresco {
+
+// Fixed set of workers shared by any number of handles. Each worker owns a
+// deque: it takes its newest task from the back, and an idle worker steals
+// the oldest task from the front of another's. Tasks submitted from outside
+// the pool are dealt round-robin over the deques.
+class ThreadPool {
+public:
+    // threads 0 means one per core
+    explicit ThreadPool(uint32_t threads);
+    // Runs the tasks still queued, then joins the workers
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    // One deque per worker; deques_ is complete before the first worker
+    // starts, while workers_ is still growing as they run
+    uint32_t size() const { return static_cast<uint32_t>(deques_.size()); }
+
+    void submit(std::function<void()> task);
+
+private:
+    struct alignas(64) Deque {
+        std::mutex mutex;
+        std::deque<std::function<void()>> tasks;
+    };
+
+    bool take(uint32_t self, std::function<void()>& task);
+    void run(uint32_t self);
+
+    std::vector<std::unique_ptr<Deque>> deques_;
+    std::vector<std::thread> workers_;
+    std::atomic<size_t> queued_{0};
+    std::atomic<uint32_t> next_deque_{0};
+    std::mutex sleep_mutex_;
+    std::condition_variable wake_;
+    bool stopping_ = false;
+};
+
+// Makes parallel_for on the calling thread run on pool, or on threads of its
+// own when pool is null, until the scope ends
+class PoolScope {
+public:
+    explicit PoolScope(ThreadPool* pool);
+    ~PoolScope();
+
+    PoolScope(const PoolScope&) = delete;
+    PoolScope& operator=(const PoolScope&) = delete;
+
+private:
+    ThreadPool* previous_;
+};
+
+// Pool of the innermost PoolScope of the calling thread, or null
+ThreadPool* current_pool();
+
+} // namespace fresco
+
+#endif // FRESCO_THREAD_POOL_H
@@ -0,0 +1,136 @@
+/**
+ * @file tile_cache.cpp
+ * @brief FRESCO cache of decoded raster tiles
+ * @author Mehmet T. AKALIN
+ * @date 2025
+ * @license MIT
+ */
+
+#include "tile_cache.h"
+#include "counters.h"
+#include <cstring>
+#include <new>
+
+namespace fresco {
+
+namespace {
+
+constexpr uint64_t kPrime1 = 0x9E3779B185EBCA87ULL;
+constexpr uint64_t kPrime2 = 0xC2B2AE3D27D4EB4FULL;
+
+// Map node, list node and shared_ptr control block of one entry, roughly
+constexpr uint64_t kEntryOverhead = 128;
+
+uint64_t rotate_left(uint64_t value, int bits) {
+    return (value << bits) | (value >> (64 - bits));
+}
+
+uint64_t finalize(uint64_t hash) {
+    hash ^= hash >> 33;
+    hash *= kPrime2;
+    hash ^= hash >> 29;
+    hash *= kPrime1;
+    hash ^= hash >> 32;
+    return hash;
+}
+
+} // namespace
+
+uint64_t hash_bytes(const uint8_t* data, size_t size, uint64_t seed) {
+    uint64_t hash = seed + kPrime1 + static_cast<uint64_t>(size) * kPrime2;
+    size_t i = 0;
+    for (; i + 8 <= size; i += 8) {
+        uint64_t word;
+        std::memcpy(&word, data + i, sizeof(word));
+        hash = rotate_left(hash ^ (word * kPrime2), 31) * kPrime1;
+    }
+    uint64_t tail = 0;
+    for (size_t shift = 0; i < size; i++, shift += 8) {
+        tail |= static_cast<uint64_t>(data[i]) << shift;
+    }
+    return finalize(hash ^ (tail * kPrime2));
+}
+
+TileCache::TileCache(uint64_t max_bytes) : shard_budget_(max_bytes / kShardCount) {}
+
+TileCache::Shard& TileCache::shard(const Key& key) {
+    return shards_[finalize(KeyHash()(key)) % kShardCount];
+}
+
+TileCache::Pixels TileCache::find(const Key& key, uint64_t checksum) {
+    Shard& shard = this->shard(key);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    auto found = shard.index.find(key);
+    if (found == shard.index.end() || found->second->checksum != checksum) {
+        counter_add(Counter::TileCacheMisses, 1);
+        return nullptr;
+    }
+    shard.lru.splice(shard.lru.begin(), shard.lru, found->second);
+    counter_add(Counter::TileCacheHits, 1);
+    return found->second->pixels;
+}
+
+void TileCache::insert(const Key& key, uint64_t checksum, Pixels pixels) {
+    const uint64_t bytes = pixels->size() + kEntryOverhead;
+    if (bytes > shard_budget_) {
+        return;
+    }
+
+    Shard& shard = this->shard(key);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    auto found = shard.index.find(key);
+    if (found != shard.index.end()) {
+        // Another thread decoded the same tile meanwhile, or the file changed
+        shard.bytes -= found->second->bytes;
+        shard.lru.erase(found->second);
+        shard.index.erase(found);
+    }
+    while (!shard.lru.empty() && shard.bytes + bytes > shard_budget_) {
+        const Entry& oldest = shard.lru.back();
+        shard.bytes -= oldest.bytes;
+        shard.index.erase(oldest.key);
+        shard.lru.pop_back();
+        counter_add(Counter::TileCacheEvictions, 1);
+    }
+    shard.lru.push_front(Entry{key, checksum, std::move(pixels), bytes});
+    shard.index.emplace(key, shard.lru.begin());
+    shard.bytes += bytes;
+}
+
+uint64_t TileCache::bytes() const {
+    uint64_t total = 0;
+    for (const Shard& shard : shards_) {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        total += shard.bytes;
+    }
+    return total;
+}
+
+} // namespace fresco
+
+extern "C" {
+
+fresco_error_t fresco_tile_cache_create(uint64_t max_bytes, fresco_tile_cache_t** cache) {
+    if (!cache || max_bytes == 0) {
+        return FRESCO_ERROR_INVALID_PARAMETER;
+    }
+
+    try {
+        *cache = reinterpret_cast<fresco_tile_cache_t*>(new fresco::TileCache(max_bytes));
+        return FRESCO_OK;
+    } catch (const std::bad_alloc&) {
+        return FRESCO_ERROR_OUT_OF_MEMORY;
+    }
+}
+
+void fresco_tile_cache_destroy(fresco_tile_cache_t* cache) {
+    if (cache) {
+        delete reinterpret_cast<fresco::TileCache*>(cache);
+    }
+}
+
+uint64_t fresco_tile_cache_bytes(const fresco_tile_cache_t* cache) {
+    return cache ? reinterpret_cast<const fresco::TileCache*>(cache)->bytes() : 0;
+}
+
+} // extern "C"
@@ -0,0 +1,92 @@
+/**
+ * @file tile_cache.h
+ * @brief FRESCO cache of decoded raster tiles
+ * @author Mehmet T. AKALIN
+ * @date 2025
+ * @license MIT
+ */
+
+#ifndef FRESCO_TILE_CACHE_H
+#define FRESCO_TILE_CACHE_H
+
+#include "fresco/fresco.h"
+#include <cstddef>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+namespace fresco {
+
+// 64-bit hash of size bytes, eight at a time; not for adversarial input
+uint64_t hash_bytes(const uint8_t* data, size_t size, uint64_t seed = 0);
+
+// Decoded tiles shared by any number of decoders, least recently used
+// first out once the pixels exceed the byte budget. Keys hash to one of
+// several shards, each with its own lock, list and share of the budget, so
+// decoders on different threads rarely wait on each other.
+class TileCache {
+public:
+    struct Key {
+        uint64_t file;      // Hash of the raster header and tile index
+        uint32_t tile;
+        uint32_t level;     // Resolution 1 / 2^level
+
+        bool operator==(const Key& other) const {
+            return file == other.file && tile == other.tile && level == other.level;
+        }
+    };
+
+    // Packed rows of the tile at its level
+    using Pixels = std::shared_ptr<const std::vector<uint8_t>>;
+
+    explicit TileCache(uint64_t max_bytes);
+
+    TileCache(const TileCache&) = delete;
+    TileCache& operator=(const TileCache&) = delete;
+
+    // The tile under key, if its compressed bytes hashed to checksum when it
+    // was stored; otherwise null
+    Pixels find(const Key& key, uint64_t checksum);
+
+    // Stores the tile as most recently used and evicts from the other end of
+    // its shard. A tile larger than a shard's budget is not kept.
+    void insert(const Key& key, uint64_t checksum, Pixels pixels);
+
+    // Pixel and bookkeeping bytes held now
+    uint64_t bytes() const;
+
+private:
+    static constexpr size_t kShardCount = 16;
+
+    struct KeyHash {
+        size_t operator()(const Key& key) const {
+            return static_cast<size_t>(key.file ^ (static_cast<uint64_t>(key.tile) << 8) ^
+                                       (static_cast<uint64_t>(key.level) << 56));
+        }
+    };
+
+    struct Entry {
+        Key key;
+        uint64_t checksum;
+        Pixels pixels;
+        uint64_t bytes;
+    };
+
+    struct alignas(64) Shard {
+        mutable std::mutex mutex;
+        std::list<Entry> lru;    // Most recently used first
+        std::unordered_map<Key, std::list<Entry>::iterator, KeyHash> index;
+        uint64_t bytes = 0;
+    };
+
+    Shard& shard(const Key& key);
+
+    uint64_t shard_budget_;
+    Shard shards_[kShardCount];
+};
+
+} // namespace fresco
+
+#endif // FRESCO_TILE_CACHE_H
@@ -0,0 +1,99 @@
+/**
+ * @file trace.cpp
+ * @brief FRESCO Chrome trace-event output
+ * @author Mehmet T. AKALIN
+ * @date 2025
+ * @license MIT
+ */
+
+#include "trace.h"
+#include "stats.h"
+#include <cstdio>
+#include <mutex>
+
+namespace fresco {
+
+#if FRESCO_TRACING
+std::atomic<bool> g_trace_enabled(false);
+
+namespace {
+
+std::mutex g_trace_mutex;
+fresco_trace_sink_t g_trace_sink = nullptr;
+void* g_trace_user_data = nullptr;
+std::atomic<uint32_t> g_next_thread_id(1);
+
+// Small sequential ids read better in trace viewers than native thread ids
+uint32_t trace_thread_id() {
+    thread_local const uint32_t id = g_next_thread_id.fetch_add(1, std::memory_order_relaxed);
+    return id;
+}
+
+} // namespace
+
+void trace_complete(const char* name, uint64_t start_ns, uint64_t end_ns, int64_t tile) {
+    // Timestamps are microseconds with nanosecond fractions
+    char event[256];
+    int length;
+    if (tile >= 0) {
+        length = std::snprintf(event, sizeof(event),
+                               "{\"name\":\"%s\",\"cat\":\"fresco\",\"ph\":\"X\",\"ts\":%llu.%03u,"
+                               "\"dur\":%llu.%03u,\"pid\":1,\"tid\":%u,\"args\":{\"tile\":%lld}}",
+                               name, static_cast<unsigned long long>(start_ns / 1000),
+                               static_cast<unsigned>(start_ns % 1000),
+                               static_cast<unsigned long long>((end_ns - start_ns) / 1000),
+                               static_cast<unsigned>((end_ns - start_ns) % 1000),
+                               trace_thread_id(), static_cast<long long>(tile));
+    } else {
+        length = std::snprintf(event, sizeof(event),
+                               "{\"name\":\"%s\",\"cat\":\"fresco\",\"ph\":\"X\",\"ts\":%llu.%03u,"
+                               "\"dur\":%llu.%03u,\"pid\":1,\"tid\":%u}",
+                               name, static_cast<unsigned long long>(start_ns / 1000),
+                               static_cast<unsigned>(start_ns % 1000),
+                               static_cast<unsigned long long>((end_ns - start_ns) / 1000),
+                               static_cast<unsigned>((end_ns - start_ns) % 1000),
+                               trace_thread_id());
+    }
+    if (length <= 0 || static_cast<size_t>(length) >= sizeof(event)) {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(g_trace_mutex);
+    if (g_trace_sink) {
+        g_trace_sink(event, static_cast<size_t>(length), g_trace_user_data);
+    }
+}
+#else
+void trace_complete(const char*, uint64_t, uint64_t, int64_t) {}
+#endif
+
+TraceSpan::TraceSpan(const char* name)
+    : name_(name), start_(0), traced_(trace_enabled()) {
+    if (traced_) {
+        start_ = now_ns();
+    }
+}
+
+TraceSpan::~TraceSpan() {
+    if (traced_) {
+        trace_complete(name_, start_, now_ns(), -1);
+    }
+}
+
+} // namespace fresco
+
+extern "C" {
+
+fresco_error_t fresco_set_trace_sink(fresco_trace_sink_t sink, void* user_data) {
+#if FRESCO_TRACING
+    std::lock_guard<std::mutex> lock(fresco::g_trace_mutex);
+    fresco::g_trace_sink = sink;
+    fresco::g_trace_user_data = user_data;
+    fresco::g_trace_enabled.store(sink != nullptr, std::memory_order_relaxed);
+    return FRESCO_OK;
+#else
+    return sink ? FRESCO_ERROR_NOT_IMPLEMENTED : FRESCO_OK;
+#endif
+}
+
+} // extern "C"
@@ -0,0 +1,52 @@
+/**
+ * @file trace.h
+ * @brief FRESCO Chrome trace-event output
+ * @author Mehmet T. AKALIN
+ * @date 2025
+ * @license MIT
+ */
+
+#ifndef FRESCO_TRACE_H
+#define FRESCO_TRACE_H
+
+#include "fresco/fresco.h"
+#include <atomic>
+
+// Building with FRESCO_TRACING=0 removes every trace point
+#ifndef FRESCO_TRACING
+#define FRESCO_TRACING 1
+#endif
+
+namespace fresco {
+
+#if FRESCO_TRACING
+extern std::atomic<bool> g_trace_enabled;
+
+// One relaxed load; the sink itself is only touched once this is true
+inline bool trace_enabled() { return g_trace_enabled.load(std::memory_order_relaxed); }
+#else
+constexpr bool trace_enabled() { return false; }
+#endif
+
+// Sends one complete event covering [start_ns, end_ns) on the calling
+// thread to the sink. A negative tile leaves out the tile argument.
+void trace_complete(const char* name, uint64_t start_ns, uint64_t end_ns, int64_t tile);
+
+// Traces the lifetime of the object, e.g. a whole encode call
+class TraceSpan {
+public:
+    explicit TraceSpan(const char* name);
+    ~TraceSpan();
+
+    TraceSpan(const TraceSpan&) = delete;
+    TraceSpan& operator=(const TraceSpan&) = delete;
+
+private:
+    const char* name_;
+    uint64_t start_;
+    bool traced_;
+};
+
+} // namespace fresco
+
+#endif // FRESCO_TRACE_H
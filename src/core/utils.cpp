@@ -8,13 +8,20 @@
 
 #include "fresco/fresco.h"
 #include "utils.h"
+#include "counters.h"
+#include <cmath>
 #include <cstdlib>
 #include <cstring>
 
 namespace fresco {
 
 void* fresco_malloc(size_t size) {
-    return std::malloc(size);
+    void* ptr = std::malloc(size);
+    if (ptr) {
+        counter_add(Counter::Allocations, 1);
+        counter_add(Counter::AllocatedBytes, size);
+    }
+    return ptr;
 }
 
 void fresco_free(void* ptr) {
@@ -22,33 +29,55 @@ void fresco_free(void* ptr) {
 }
 
 fresco_error_t parse_image_format(const uint8_t* input_data, size_t input_size,
-                                 ImageInfo& image_info) {
-    // TODO: Implement actual image format detection
-    // For now, assume it's raw RGB data
+                                 ParsedImage& image) {
+    fresco_error_t result = read_png(input_data, input_size, image);
+    if (result != FRESCO_ERROR_UNSUPPORTED_FORMAT) {
+        return result;
+    }
+    result = read_pnm(input_data, input_size, image);
+    if (result != FRESCO_ERROR_UNSUPPORTED_FORMAT) {
+        return result;
+    }
+
+    // Raw RGB data of a square image
     if (input_size % 3 != 0) {
         return FRESCO_ERROR_UNSUPPORTED_FORMAT;
     }
-    
-    // Assume square image for now
     size_t pixel_count = input_size / 3;
-    size_t side_length = static_cast<size_t>(std::sqrt(pixel_count));
+    size_t side_length = static_cast<size_t>(std::sqrt(static_cast<double>(pixel_count)));
+    while (side_length * side_length > pixel_count) {
+        side_length--;
+    }
+    while ((side_length + 1) * (side_length + 1) <= pixel_count) {
+        side_length++;
+    }
+    if (side_length == 0 || side_length * side_length != pixel_count ||
+        side_length > UINT32_MAX) {
+        return FRESCO_ERROR_UNSUPPORTED_FORMAT;
+    }
     
-    image_info.width = side_length;
-    image_info.height = side_length;
-    image_info.channels = 3;
-    image_info.bit_depth = 8;
-    image_info.colorspace = FRESCO_COLORSPACE_RGB;
+    image.info.width = static_cast<uint32_t>(side_length);
+    image.info.height = static_cast<uint32_t>(side_length);
+    image.info.channels = 3;
+    image.info.bit_depth = 8;
+    image.info.colorspace = FRESCO_COLORSPACE_RGB;
+    image.pixels = input_data;
+    image.pixel_bytes = input_size;
     
     return FRESCO_OK;
 }
 
-fresco_error_t convert_to_output_format(const std::vector<uint8_t>& decompressed_data,
-                                       const ContainerInfo& container_info,
-                                       std::vector<uint8_t>& output_format_data) {
-    // TODO: Implement format conversion
-    // For now, just return the decompressed data
-    output_format_data = decompressed_data;
-    return FRESCO_OK;
+void fill_metadata(const ContainerInfo& container_info, uint64_t file_size,
+                   fresco_metadata_t& metadata) {
+    metadata.width = container_info.width;
+    metadata.height = container_info.height;
+    metadata.channels = container_info.channels;
+    metadata.bit_depth = container_info.bit_depth;
+    metadata.colorspace = container_info.colorspace;
+    metadata.frame_count = container_info.frame_count;
+    metadata.frame_rate = container_info.frame_rate;
+    metadata.file_size = file_size;
+    metadata.compressed_size = container_info.compressed_size;
 }
 
 const char* fresco_error_string(fresco_error_t error) {
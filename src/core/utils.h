@@ -11,6 +11,7 @@
 
 #include "fresco/fresco.h"
 #include "compression.h"
+#include "image_formats.h"
 #include <vector>
 
 namespace fresco {
@@ -18,12 +19,14 @@ namespace fresco {
 void* fresco_malloc(size_t size);
 void fresco_free(void* ptr);
 
+// Recognizes PNG and PNM input; anything else is taken as packed 8-bit
+// RGB of a square image
 fresco_error_t parse_image_format(const uint8_t* input_data, size_t input_size,
-                                 ImageInfo& image_info);
+                                 ParsedImage& image);
 
-fresco_error_t convert_to_output_format(const std::vector<uint8_t>& decompressed_data,
-                                       const ContainerInfo& container_info,
-                                       std::vector<uint8_t>& output_format_data);
+// Public form of a parsed container header
+void fill_metadata(const ContainerInfo& container_info, uint64_t file_size,
+                   fresco_metadata_t& metadata);
 
 const char* fresco_error_string(fresco_error_t error);
 fresco_error_t fresco_get_version(int* major, int* minor, int* patch);
@@ -0,0 +1,260 @@
+/**
+ * @file varint.cpp
+ * @brief FRESCO variable-length integer coding
+ * @author Mehmet T. AKALIN
+ * @date 2025
+ * @license MIT
+ */
+
+#include "fresco/fresco.h"
+#include "varint.h"
+#include <vector>
+#include <cmath>
+#include <cstring>
+
+#if defined(__SSSE3__)
+#include <tmmintrin.h>
+#define FRESCO_SVB_SSSE3 1
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#define FRESCO_SVB_NEON 1
+#endif
+
+namespace fresco {
+
+namespace {
+
+struct StreamVByteTables {
+    uint8_t shuffle[256][16];
+    uint8_t length[256];
+};
+
+constexpr StreamVByteTables make_stream_vbyte_tables() {
+    StreamVByteTables tables{};
+    for (int control = 0; control < 256; control++) {
+        int offset = 0;
+        for (int lane = 0; lane < 4; lane++) {
+            int length = ((control >> (2 * lane)) & 3) + 1;
+            for (int byte = 0; byte < 4; byte++) {
+                // 0x80 selects zero for both pshufb and tbl
+                tables.shuffle[control][4 * lane + byte] =
+                    byte < length ? static_cast<uint8_t>(offset + byte) : 0x80;
+            }
+            offset += length;
+        }
+        tables.length[control] = static_cast<uint8_t>(offset);
+    }
+    return tables;
+}
+
+constexpr StreamVByteTables kStreamVByteTables = make_stream_vbyte_tables();
+
+inline unsigned value_length(uint32_t value) {
+    if (value < (1u << 8)) return 1;
+    if (value < (1u << 16)) return 2;
+    if (value < (1u << 24)) return 3;
+    return 4;
+}
+
+enum class DecodeMode { Raw, Zigzag, Delta2, Delta2Scaled };
+
+// Delta2Scaled writes floats (value * scale) into values; all other modes
+// write 32-bit integers
+template <DecodeMode Mode>
+const uint8_t* stream_vbyte_decode_impl(const uint8_t* data, const uint8_t* end,
+                                        size_t count, void* values, float scale = 1.0f) {
+    constexpr bool kDelta = Mode == DecodeMode::Delta2 || Mode == DecodeMode::Delta2Scaled;
+    uint32_t* int_values = static_cast<uint32_t*>(values);
+    float* float_values = static_cast<float*>(values);
+
+    const size_t control_size = (count + 3) / 4;
+    if (static_cast<size_t>(end - data) < control_size) {
+        return nullptr;
+    }
+
+    const uint8_t* control = data;
+    const uint8_t* p = data + control_size;
+    uint32_t carry_x = 0;
+    uint32_t carry_y = 0;
+    size_t i = 0;
+
+#if defined(FRESCO_SVB_SSSE3)
+    __m128i carry = _mm_setzero_si128();
+    const __m128i one = _mm_set1_epi32(1);
+    const __m128 scale_v = _mm_set1_ps(scale);
+    for (; i + 4 <= count && end - p >= 16; i += 4) {
+        const uint8_t c = control[i >> 2];
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+        v = _mm_shuffle_epi8(v, _mm_loadu_si128(
+            reinterpret_cast<const __m128i*>(kStreamVByteTables.shuffle[c])));
+        p += kStreamVByteTables.length[c];
+        if (Mode != DecodeMode::Raw) {
+            v = _mm_xor_si128(_mm_srli_epi32(v, 1),
+                              _mm_sub_epi32(_mm_setzero_si128(), _mm_and_si128(v, one)));
+        }
+        if (kDelta) {
+            v = _mm_add_epi32(v, _mm_slli_si128(v, 8));
+            v = _mm_add_epi32(v, carry);
+            carry = _mm_shuffle_epi32(v, _MM_SHUFFLE(3, 2, 3, 2));
+        }
+        if (Mode == DecodeMode::Delta2Scaled) {
+            _mm_storeu_ps(float_values + i, _mm_mul_ps(_mm_cvtepi32_ps(v), scale_v));
+        } else {
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(int_values + i), v);
+        }
+    }
+    carry_x = static_cast<uint32_t>(_mm_cvtsi128_si32(carry));
+    carry_y = static_cast<uint32_t>(_mm_cvtsi128_si32(_mm_srli_si128(carry, 4)));
+#elif defined(FRESCO_SVB_NEON)
+    uint32x4_t carry = vdupq_n_u32(0);
+    const uint32x4_t one = vdupq_n_u32(1);
+    const float32x4_t scale_v = vdupq_n_f32(scale);
+    for (; i + 4 <= count && end - p >= 16; i += 4) {
+        const uint8_t c = control[i >> 2];
+        uint8x16_t bytes = vqtbl1q_u8(vld1q_u8(p), vld1q_u8(kStreamVByteTables.shuffle[c]));
+        uint32x4_t v = vreinterpretq_u32_u8(bytes);
+        p += kStreamVByteTables.length[c];
+        if (Mode != DecodeMode::Raw) {
+            v = veorq_u32(vshrq_n_u32(v, 1), vsubq_u32(vdupq_n_u32(0), vandq_u32(v, one)));
+        }
+        if (kDelta) {
+            v = vaddq_u32(v, vextq_u32(vdupq_n_u32(0), v, 2));
+            v = vaddq_u32(v, carry);
+            carry = vcombine_u32(vget_high_u32(v), vget_high_u32(v));
+        }
+        if (Mode == DecodeMode::Delta2Scaled) {
+            vst1q_f32(float_values + i, vmulq_f32(vcvtq_f32_s32(vreinterpretq_s32_u32(v)), scale_v));
+        } else {
+            vst1q_u32(int_values + i, v);
+        }
+    }
+    carry_x = vgetq_lane_u32(carry, 0);
+    carry_y = vgetq_lane_u32(carry, 1);
+#endif
+
+    for (; i < count; i++) {
+        const unsigned length = ((control[i >> 2] >> ((i & 3) * 2)) & 3) + 1;
+        if (static_cast<size_t>(end - p) < length) {
+            return nullptr;
+        }
+        uint32_t v = 0;
+        for (unsigned byte = 0; byte < length; byte++) {
+            v |= static_cast<uint32_t>(p[byte]) << (8 * byte);
+        }
+        p += length;
+        if (Mode != DecodeMode::Raw) {
+            v = static_cast<uint32_t>(zigzag_decode(v));
+        }
+        if (kDelta) {
+            uint32_t& carry_lane = (i & 1) ? carry_y : carry_x;
+            carry_lane += v;
+            v = carry_lane;
+        }
+        if (Mode == DecodeMode::Delta2Scaled) {
+            float_values[i] = static_cast<float>(static_cast<int32_t>(v)) * scale;
+        } else {
+            int_values[i] = v;
+        }
+    }
+
+    return p;
+}
+
+} // namespace
+
+void write_varint(std::vector<uint8_t>& out, uint64_t value) {
+    while (value >= 0x80) {
+        out.push_back(static_cast<uint8_t>(value) | 0x80);
+        value >>= 7;
+    }
+    out.push_back(static_cast<uint8_t>(value));
+}
+
+bool read_varint(const uint8_t*& data, const uint8_t* end, uint64_t& value) {
+    value = 0;
+    for (unsigned shift = 0; shift < 64; shift += 7) {
+        if (data >= end) {
+            return false;
+        }
+        const uint8_t byte = *data++;
+        value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+        if (!(byte & 0x80)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void write_u32_le(std::vector<uint8_t>& out, uint32_t value) {
+    for (int i = 0; i < 4; i++) {
+        out.push_back(static_cast<uint8_t>(value >> (8 * i)));
+    }
+}
+
+bool read_u32_le(const uint8_t*& data, const uint8_t* end, uint32_t& value) {
+    if (end - data < 4) {
+        return false;
+    }
+    value = static_cast<uint32_t>(data[0]) | (static_cast<uint32_t>(data[1]) << 8) |
+            (static_cast<uint32_t>(data[2]) << 16) | (static_cast<uint32_t>(data[3]) << 24);
+    data += 4;
+    return true;
+}
+
+void write_f32_le(std::vector<uint8_t>& out, float value) {
+    uint32_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    write_u32_le(out, bits);
+}
+
+bool read_f32_le(const uint8_t*& data, const uint8_t* end, float& value) {
+    uint32_t bits;
+    if (!read_u32_le(data, end, bits)) {
+        return false;
+    }
+    std::memcpy(&value, &bits, sizeof(value));
+    return std::isfinite(value);
+}
+
+void stream_vbyte_encode(const uint32_t* values, size_t count, std::vector<uint8_t>& out) {
+    const size_t control_offset = out.size();
+    const size_t control_size = (count + 3) / 4;
+    out.resize(control_offset + control_size, 0);
+
+    for (size_t i = 0; i < count; i++) {
+        const uint32_t v = values[i];
+        const unsigned length = value_length(v);
+        out[control_offset + (i >> 2)] |= static_cast<uint8_t>((length - 1) << ((i & 3) * 2));
+        for (unsigned byte = 0; byte < length; byte++) {
+            out.push_back(static_cast<uint8_t>(v >> (8 * byte)));
+        }
+    }
+}
+
+const uint8_t* stream_vbyte_decode(const uint8_t* data, const uint8_t* end,
+                                   size_t count, uint32_t* values) {
+    return stream_vbyte_decode_impl<DecodeMode::Raw>(data, end, count, values);
+}
+
+const uint8_t* stream_vbyte_decode_zigzag(const uint8_t* data, const uint8_t* end,
+                                          size_t count, int32_t* values) {
+    return stream_vbyte_decode_impl<DecodeMode::Zigzag>(data, end, count, values);
+}
+
+const uint8_t* stream_vbyte_decode_delta2(const uint8_t* data, const uint8_t* end,
+                                          size_t count, int32_t* values) {
+    if (count & 1) {
+        return nullptr;
+    }
+    return stream_vbyte_decode_impl<DecodeMode::Delta2>(data, end, count, values);
+}
+
+const uint8_t* stream_vbyte_decode_delta2_scaled(const uint8_t* data, const uint8_t* end,
+                                                 size_t count, float scale, float* values) {
+    if (count & 1) {
+        return nullptr;
+    }
+    return stream_vbyte_decode_impl<DecodeMode::Delta2Scaled>(data, end, count, values, scale);
+}
+
+} // namespace fresco
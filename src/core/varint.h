@@ -0,0 +1,62 @@
+/**
+ * @file varint.h
+ * @brief FRESCO variable-length integer coding
+ * @author Mehmet T. AKALIN
+ * @date 2025
+ * @license MIT
+ */
+
+#ifndef FRESCO_VARINT_H
+#define FRESCO_VARINT_H
+
+#include "fresco/fresco.h"
+#include <vector>
+
+namespace fresco {
+
+inline uint32_t zigzag_encode(int32_t value) {
+    return (static_cast<uint32_t>(value) << 1) ^ static_cast<uint32_t>(value >> 31);
+}
+
+inline int32_t zigzag_decode(uint32_t value) {
+    return static_cast<int32_t>((value >> 1) ^ (0u - (value & 1)));
+}
+
+// LEB128 unsigned varint
+void write_varint(std::vector<uint8_t>& out, uint64_t value);
+bool read_varint(const uint8_t*& data, const uint8_t* end, uint64_t& value);
+
+// Little-endian fixed width helpers
+void write_u32_le(std::vector<uint8_t>& out, uint32_t value);
+bool read_u32_le(const uint8_t*& data, const uint8_t* end, uint32_t& value);
+
+// IEEE float as its little-endian bit pattern; reading rejects NaN and inf
+void write_f32_le(std::vector<uint8_t>& out, float value);
+bool read_f32_le(const uint8_t*& data, const uint8_t* end, float& value);
+
+/**
+ * Stream VByte: the 2-bit byte lengths of four values are packed into one
+ * control byte, and all control bytes precede the data bytes. Decoding four
+ * values is then a single table-driven byte shuffle.
+ */
+void stream_vbyte_encode(const uint32_t* values, size_t count, std::vector<uint8_t>& out);
+
+// The decoders return a pointer past the consumed bytes, or nullptr if the
+// stream is truncated.
+const uint8_t* stream_vbyte_decode(const uint8_t* data, const uint8_t* end,
+                                   size_t count, uint32_t* values);
+
+const uint8_t* stream_vbyte_decode_zigzag(const uint8_t* data, const uint8_t* end,
+                                          size_t count, int32_t* values);
+
+// Zigzag deltas of interleaved (x, y) pairs; count must be even
+const uint8_t* stream_vbyte_decode_delta2(const uint8_t* data, const uint8_t* end,
+                                          size_t count, int32_t* values);
+
+// As above, with the reconstructed values converted to float and scaled
+const uint8_t* stream_vbyte_decode_delta2_scaled(const uint8_t* data, const uint8_t* end,
+                                                 size_t count, float scale, float* values);
+
+} // namespace fresco
+
+#endif // FRESCO_VARINT_H
@@ -134,6 +134,58 @@ TEST_F(FrescoBasicTest, DecoderParameters) {
     fresco_decoder_destroy(decoder);
 }
 
+TEST_F(FrescoBasicTest, EncodeDecodeRoundTrip) {
+    fresco_encoder_t* encoder = nullptr;
+    ASSERT_EQ(fresco_encoder_create(&encoder), FRESCO_OK);
+
+    fresco_encode_params_t params = {};
+    params.mode = FRESCO_COMPRESSION_LOSSLESS;
+    params.quality = 85;
+    params.effort = 5;
+    params.tile_size = 256;
+    ASSERT_EQ(fresco_encoder_set_params(encoder, &params), FRESCO_OK);
+
+    uint8_t* encoded = nullptr;
+    size_t encoded_size = 0;
+    ASSERT_EQ(fresco_encoder_encode(encoder, test_image_.data(), test_image_.size(),
+                                    &encoded, &encoded_size), FRESCO_OK);
+    fresco_encoder_destroy(encoder);
+
+    fresco_metadata_t metadata;
+    ASSERT_EQ(fresco_get_metadata(encoded, encoded_size, &metadata), FRESCO_OK);
+    EXPECT_EQ(metadata.width, 8u);
+    EXPECT_EQ(metadata.height, 8u);
+    EXPECT_EQ(metadata.channels, 3);
+    EXPECT_EQ(metadata.file_size, encoded_size);
+
+    fresco_decoder_t* decoder = nullptr;
+    ASSERT_EQ(fresco_decoder_create(&decoder), FRESCO_OK);
+
+    uint8_t* decoded = nullptr;
+    size_t decoded_size = 0;
+    ASSERT_EQ(fresco_decoder_decode(decoder, encoded, encoded_size, &decoded, &decoded_size),
+              FRESCO_OK);
+    ASSERT_EQ(decoded_size, test_image_.size());
+    EXPECT_EQ(std::memcmp(decoded, test_image_.data(), decoded_size), 0);
+
+    fresco_free(decoded);
+    fresco_free(encoded);
+    fresco_decoder_destroy(decoder);
+}
+
+TEST_F(FrescoBasicTest, DecodeRejectsForeignData) {
+    fresco_decoder_t* decoder = nullptr;
+    ASSERT_EQ(fresco_decoder_create(&decoder), FRESCO_OK);
+
+    uint8_t* decoded = nullptr;
+    size_t decoded_size = 0;
+    EXPECT_EQ(fresco_decoder_decode(decoder, test_image_.data(), test_image_.size(),
+                                    &decoded, &decoded_size),
+              FRESCO_ERROR_UNSUPPORTED_FORMAT);
+
+    fresco_decoder_destroy(decoder);
+}
+
 TEST_F(FrescoBasicTest, MemoryAllocation) {
     void* ptr = malloc(1024);
     EXPECT_NE(ptr, nullptr);
@@ -0,0 +1,443 @@
+/**
+ * @file test_formats.cpp
+ * @brief Unit tests for the image file formats
+ * @author Mehmet T. AKALIN
+ * @date 2025
+ * @license MIT
+ */
+
+#include "fresco/fresco.h"
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace {
+
+// Every filter type, dynamic Huffman codes
+const uint8_t kFilteredRgb[] = {
+    0x89, 0x50, 0x4e, 0x47, 0x0d, 0x0a, 0x1a, 0x0a, 0x00, 0x00, 0x00, 0x0d,
+    0x49, 0x48, 0x44, 0x52, 0x00, 0x00, 0x00, 0x13, 0x00, 0x00, 0x00, 0x0d,
+    0x08, 0x02, 0x00, 0x00, 0x00, 0xc4, 0xee, 0xc2, 0x70, 0x00, 0x00, 0x00,
+    0xed, 0x49, 0x44, 0x41, 0x54, 0x78, 0xda, 0x63, 0x60, 0x30, 0x4a, 0xe1,
+    0xb5, 0x2f, 0x94, 0xf2, 0xa9, 0x53, 0x8f, 0xec, 0x36, 0x49, 0x9b, 0xe1,
+    0x58, 0xbc, 0xd4, 0xaf, 0x61, 0x53, 0x74, 0xef, 0xfe, 0x8c, 0x59, 0x67,
+    0x4a, 0x97, 0xdf, 0x6c, 0xda, 0xf2, 0xac, 0xff, 0xe0, 0xe7, 0x39, 0xe7,
+    0x18, 0x56, 0xde, 0xe6, 0xdd, 0xf6, 0x42, 0xea, 0xf0, 0x57, 0xf5, 0x0b,
+    0x4c, 0x26, 0x77, 0xf9, 0x1d, 0x5f, 0xc9, 0xf8, 0x31, 0xb2, 0x5b, 0x66,
+    0xf3, 0x92, 0x05, 0x98, 0xd8, 0xc9, 0x05, 0xcc, 0x7c, 0xea, 0x0e, 0x5c,
+    0x04, 0x40, 0x17, 0x56, 0x26, 0x0b, 0x11, 0xa6, 0xf3, 0x62, 0x65, 0x32,
+    0x28, 0x87, 0xb6, 0x1b, 0x24, 0x4d, 0xb1, 0xcd, 0x5f, 0xe8, 0x55, 0xb3,
+    0x2e, 0xbc, 0x73, 0x77, 0xca, 0xb4, 0x13, 0x85, 0x8b, 0xaf, 0xd6, 0x6d,
+    0x78, 0xd4, 0xbd, 0xf7, 0xfd, 0x8c, 0x53, 0x7f, 0x96, 0x5e, 0xe7, 0xdc,
+    0xf4, 0x44, 0x6c, 0xff, 0x47, 0xe5, 0x33, 0xff, 0x0c, 0x6e, 0x72, 0xdb,
+    0x3e, 0x93, 0xf0, 0xfa, 0xac, 0x1a, 0x0e, 0x09, 0x54, 0x46, 0xad, 0x98,
+    0x3e, 0xba, 0x87, 0x90, 0x82, 0x65, 0x10, 0x17, 0x29, 0xa0, 0x8b, 0x94,
+    0x10, 0xc2, 0x1e, 0x46, 0x0c, 0x6e, 0x15, 0xab, 0x82, 0x5b, 0xb7, 0x27,
+    0x4c, 0x3a, 0x92, 0x3b, 0xff, 0x62, 0xd5, 0x9a, 0x7b, 0xed, 0x3b, 0x5f,
+    0x4f, 0x39, 0xf6, 0x63, 0xe1, 0x65, 0xd6, 0x75, 0x0f, 0x84, 0x76, 0xbf,
+    0x95, 0x3f, 0xf1, 0x4b, 0xe7, 0x2a, 0xbb, 0xe5, 0x23, 0x11, 0xb7, 0xf7,
+    0x8a, 0xc1, 0x7f, 0xf4, 0x12, 0x38, 0xad, 0x73, 0xc5, 0x3c, 0xaa, 0x20,
+    0x81, 0xca, 0xe8, 0x5b, 0xbf, 0x91, 0xde, 0x21, 0x04, 0x00, 0x5e, 0x22,
+    0x6f, 0x37, 0x03, 0x83, 0x14, 0x79, 0x00, 0x00, 0x00, 0x00, 0x49, 0x45,
+    0x4e, 0x44, 0xae, 0x42, 0x60, 0x82,
+};
+
+// The same pixels interlaced
+const uint8_t kInterlacedRgb[] = {
+    0x89, 0x50, 0x4e, 0x47, 0x0d, 0x0a, 0x1a, 0x0a, 0x00, 0x00, 0x00, 0x0d,
+    0x49, 0x48, 0x44, 0x52, 0x00, 0x00, 0x00, 0x13, 0x00, 0x00, 0x00, 0x0d,
+    0x08, 0x02, 0x00, 0x00, 0x01, 0xb3, 0xe9, 0xf2, 0xe6, 0x00, 0x00, 0x01,
+    0x72, 0x49, 0x44, 0x41, 0x54, 0x78, 0xda, 0x63, 0x60, 0x30, 0x4a, 0xc9,
+    0x98, 0x75, 0xe6, 0x02, 0x93, 0x09, 0xa3, 0x45, 0xd6, 0x9c, 0x0c, 0x30,
+    0x60, 0x30, 0x49, 0x9b, 0x31, 0xe7, 0x1c, 0x03, 0x63, 0xce, 0xbc, 0x0b,
+    0x20, 0x9e, 0x8c, 0x5f, 0x43, 0x40, 0xd3, 0x96, 0x96, 0x6d, 0x2f, 0x76,
+    0xbc, 0x92, 0x79, 0x23, 0x17, 0xc0, 0x18, 0xd2, 0xb6, 0xc3, 0x04, 0x09,
+    0x30, 0x48, 0xf9, 0xd4, 0xf9, 0x35, 0x6c, 0x6a, 0xda, 0xf2, 0x6c, 0xdb,
+    0x0b, 0xa9, 0x57, 0x32, 0x7e, 0x8c, 0x66, 0x19, 0xb3, 0x90, 0xe5, 0x99,
+    0x64, 0x50, 0x01, 0xb3, 0x6b, 0x5c, 0xb9, 0x06, 0x12, 0x60, 0xe0, 0x73,
+    0x28, 0xd2, 0x88, 0xea, 0x71, 0x2a, 0x59, 0x16, 0xd3, 0x77, 0xa0, 0x6c,
+    0xc5, 0xad, 0x09, 0x87, 0xbe, 0xac, 0xba, 0xc3, 0x77, 0xe4, 0x9b, 0xc6,
+    0x3d, 0x01, 0xa7, 0x1f, 0x5a, 0x31, 0x8c, 0x5a, 0x31, 0x7d, 0x52, 0xb8,
+    0x01, 0xba, 0xe9, 0x68, 0x80, 0x81, 0xd7, 0xbe, 0x50, 0x3d, 0xb2, 0xdb,
+    0xb1, 0x78, 0x69, 0x74, 0xef, 0xfe, 0xd2, 0xe5, 0x37, 0xfb, 0x0f, 0x7e,
+    0x5e, 0x79, 0x9b, 0xf7, 0xf0, 0x57, 0xf5, 0xbb, 0xfc, 0x8e, 0x8c, 0xd2,
+    0xbe, 0xf5, 0x38, 0x8d, 0xe5, 0xc3, 0x0d, 0x98, 0x95, 0x6d, 0x42, 0x45,
+    0x70, 0x00, 0x16, 0x3c, 0xfa, 0x18, 0x82, 0x5b, 0xb7, 0xe7, 0xce, 0xbf,
+    0xd8, 0xbe, 0xf3, 0xf5, 0xc2, 0xcb, 0xac, 0xbb, 0xdf, 0xca, 0x5f, 0x65,
+    0xb7, 0x7c, 0xaf, 0x18, 0xcc, 0x69, 0x9d, 0xab, 0x1c, 0xda, 0xce, 0x98,
+    0x38, 0xf9, 0x28, 0x2e, 0xb7, 0x30, 0xb0, 0x5b, 0x66, 0x8b, 0xb8, 0x55,
+    0x28, 0x06, 0xb7, 0xea, 0x25, 0x4c, 0xb2, 0xce, 0x9d, 0xef, 0x51, 0xb5,
+    0x26, 0xb4, 0x7d, 0x67, 0xd2, 0x94, 0x63, 0xf9, 0x0b, 0x2f, 0xd7, 0xac,
+    0x7b, 0xd0, 0xb9, 0xfb, 0xed, 0xb4, 0x13, 0xbf, 0x16, 0x5f, 0x65, 0xdf,
+    0xf0, 0x48, 0x64, 0xef, 0x7b, 0xc5, 0x53, 0x7f, 0xf4, 0xae, 0x73, 0x5a,
+    0x3f, 0x11, 0xf3, 0xf8, 0xa8, 0x1c, 0xca, 0x28, 0xea, 0x5e, 0xc9, 0x4b,
+    0x16, 0xc0, 0xe7, 0x7f, 0xfc, 0x80, 0x59, 0xc1, 0x32, 0x88, 0x3c, 0x9d,
+    0xa0, 0xb0, 0xc3, 0xed, 0x22, 0x3e, 0x4c, 0x26, 0x5c, 0x88, 0xc1, 0xb7,
+    0x7e, 0x63, 0x54, 0xcf, 0xbe, 0xf4, 0x99, 0xa7, 0x4b, 0x96, 0xdd, 0x68,
+    0xdc, 0xfc, 0xb4, 0xef, 0xc0, 0xa7, 0xd9, 0x67, 0xff, 0xaf, 0xb8, 0xc5,
+    0xb3, 0xf5, 0xb9, 0xe4, 0xa1, 0x2f, 0x6a, 0xe7, 0x19, 0x8d, 0xef, 0xf0,
+    0x39, 0xbc, 0x94, 0xf6, 0xfd, 0xa6, 0x11, 0xc5, 0x6c, 0x9a, 0x2e, 0xe0,
+    0x54, 0x22, 0xeb, 0xdf, 0x08, 0x4c, 0x56, 0xe6, 0x99, 0xb3, 0x01, 0xe4,
+    0xaa, 0xac, 0xa7, 0xd4, 0x5c, 0x0e, 0x76, 0x00, 0x00, 0x00, 0x00, 0x49,
+    0x45, 0x4e, 0x44, 0xae, 0x42, 0x60, 0x82,
+};
+
+// 2-bit palette whose second entry is half transparent
+const uint8_t kPaletteAlpha[] = {
+    0x89, 0x50, 0x4e, 0x47, 0x0d, 0x0a, 0x1a, 0x0a, 0x00, 0x00, 0x00, 0x0d,
+    0x49, 0x48, 0x44, 0x52, 0x00, 0x00, 0x00, 0x13, 0x00, 0x00, 0x00, 0x0d,
+    0x02, 0x03, 0x00, 0x00, 0x00, 0x36, 0xe2, 0xbd, 0xb4, 0x00, 0x00, 0x00,
+    0x0c, 0x50, 0x4c, 0x54, 0x45, 0x0a, 0x14, 0x1e, 0xc8, 0x64, 0x32, 0x00,
+    0xff, 0x00, 0x01, 0x02, 0x03, 0xf0, 0x4d, 0xfc, 0x0c, 0x00, 0x00, 0x00,
+    0x02, 0x74, 0x52, 0x4e, 0x53, 0xff, 0x80, 0x08, 0x0f, 0xb3, 0x6a, 0x00,
+    0x00, 0x00, 0x46, 0x49, 0x44, 0x41, 0x54, 0x78, 0xda, 0x63, 0x90, 0x06,
+    0x02, 0x09, 0xc6, 0x1c, 0x06, 0x20, 0x60, 0x72, 0x05, 0x02, 0x17, 0xe6,
+    0x3c, 0x6e, 0x6e, 0x6e, 0x4e, 0x96, 0x50, 0xa0, 0xc0, 0x5f, 0x86, 0x1c,
+    0x10, 0x60, 0xdc, 0x08, 0x64, 0xff, 0x67, 0x12, 0x05, 0x02, 0x11, 0xe6,
+    0x1d, 0xab, 0x57, 0xaf, 0x5e, 0xc9, 0x12, 0x08, 0x52, 0xcf, 0xb0, 0x11,
+    0x08, 0x36, 0x30, 0x1e, 0x03, 0xb2, 0xfe, 0x31, 0x85, 0x02, 0x41, 0x08,
+    0x00, 0x5a, 0x81, 0x13, 0x11, 0xb7, 0x3e, 0x3d, 0x2b, 0x00, 0x00, 0x00,
+    0x00, 0x49, 0x45, 0x4e, 0x44, 0xae, 0x42, 0x60, 0x82,
+};
+
+// Pixels of kFilteredRgb and kInterlacedRgb
+std::vector<uint8_t> filtered_rgb_pixels() {
+    std::vector<uint8_t> pixels;
+    for (uint32_t y = 0; y < 13; y++) {
+        for (uint32_t x = 0; x < 19; x++) {
+            for (uint32_t c = 0; c < 3; c++) {
+                pixels.push_back(static_cast<uint8_t>(x * 13 + y * 7 + c * 50));
+            }
+        }
+    }
+    return pixels;
+}
+
+std::vector<uint8_t> palette_alpha_pixels() {
+    const uint8_t palette[4][4] = {{10, 20, 30, 255}, {200, 100, 50, 128}, {0, 255, 0, 255},
+                                   {1, 2, 3, 255}};
+    std::vector<uint8_t> pixels;
+    for (uint32_t y = 0; y < 13; y++) {
+        for (uint32_t x = 0; x < 19; x++) {
+            pixels.insert(pixels.end(), palette[(x + y) % 4], palette[(x + y) % 4] + 4);
+        }
+    }
+    return pixels;
+}
+
+void append_u32_be(std::vector<uint8_t>& out, uint32_t value) {
+    for (int shift = 24; shift >= 0; shift -= 8) {
+        out.push_back(static_cast<uint8_t>(value >> shift));
+    }
+}
+
+// An 8-bit RGB PNG in stored deflate blocks, unfiltered. Chunk CRCs are
+// left zero; the reader does not check them.
+std::vector<uint8_t> stored_png(const std::vector<uint8_t>& pixels, uint32_t width,
+                                uint32_t height) {
+    std::vector<uint8_t> raw;
+    for (uint32_t y = 0; y < height; y++) {
+        raw.push_back(0);
+        raw.insert(raw.end(), pixels.begin() + y * width * 3,
+                   pixels.begin() + (y + 1) * width * 3);
+    }
+    std::vector<uint8_t> zlib = {0x78, 0x01};
+    for (size_t pos = 0; pos < raw.size(); pos += 65535) {
+        const size_t length = std::min<size_t>(65535, raw.size() - pos);
+        zlib.push_back(pos + length == raw.size() ? 1 : 0);
+        zlib.push_back(static_cast<uint8_t>(length));
+        zlib.push_back(static_cast<uint8_t>(length >> 8));
+        zlib.push_back(static_cast<uint8_t>(~length));
+        zlib.push_back(static_cast<uint8_t>(~length >> 8));
+        zlib.insert(zlib.end(), raw.begin() + pos, raw.begin() + pos + length);
+    }
+    uint32_t a = 1, b = 0;
+    for (uint8_t byte : raw) {
+        a = (a + byte) % 65521;
+        b = (b + a) % 65521;
+    }
+    append_u32_be(zlib, (b << 16) | a);
+
+    std::vector<uint8_t> png = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+    auto add_chunk = [&](const char* type, const std::vector<uint8_t>& data) {
+        append_u32_be(png, static_cast<uint32_t>(data.size()));
+        png.insert(png.end(), type, type + 4);
+        png.insert(png.end(), data.begin(), data.end());
+        append_u32_be(png, 0);
+    };
+    std::vector<uint8_t> header;
+    append_u32_be(header, width);
+    append_u32_be(header, height);
+    header.insert(header.end(), {8, 2, 0, 0, 0});
+    add_chunk("IHDR", header);
+    // Two IDAT chunks, split mid-block
+    const size_t half = zlib.size() / 2;
+    add_chunk("IDAT", std::vector<uint8_t>(zlib.begin(), zlib.begin() + half));
+    add_chunk("IDAT", std::vector<uint8_t>(zlib.begin() + half, zlib.end()));
+    add_chunk("IEND", {});
+    return png;
+}
+
+std::vector<uint8_t> with_header(const std::string& header, const std::vector<uint8_t>& samples) {
+    std::vector<uint8_t> file(header.begin(), header.end());
+    file.insert(file.end(), samples.begin(), samples.end());
+    return file;
+}
+
+struct Encoded {
+    fresco_error_t result = FRESCO_OK;
+    std::vector<uint8_t> data;
+};
+
+fresco_encode_params_t lossless_params() {
+    fresco_encode_params_t params = {};
+    params.mode = FRESCO_COMPRESSION_LOSSLESS;
+    params.quality = 85;
+    params.effort = 5;
+    params.tile_size = 64;
+    return params;
+}
+
+// Encodes a file, or with channels set, the pixels it should read as
+Encoded encode(const std::vector<uint8_t>& input, const fresco_encode_params_t& params,
+               uint32_t width = 0, uint32_t height = 0, uint8_t channels = 0) {
+    Encoded encoded;
+    fresco_encoder_t* encoder = nullptr;
+    EXPECT_EQ(fresco_encoder_create(&encoder), FRESCO_OK);
+    EXPECT_EQ(fresco_encoder_set_params(encoder, &params), FRESCO_OK);
+    uint8_t* output = nullptr;
+    size_t output_size = 0;
+    if (channels) {
+        fresco_image_t image = {input.data(), width, height, channels, 0};
+        encoded.result = fresco_encoder_encode_image(encoder, &image, &output, &output_size);
+    } else {
+        encoded.result =
+            fresco_encoder_encode(encoder, input.data(), input.size(), &output, &output_size);
+    }
+    if (encoded.result == FRESCO_OK) {
+        encoded.data.assign(output, output + output_size);
+        fresco_free(output);
+    }
+    fresco_encoder_destroy(encoder);
+    return encoded;
+}
+
+void expect_same_encoding(const std::vector<uint8_t>& file, const std::vector<uint8_t>& pixels,
+                          uint32_t width, uint32_t height, uint8_t channels,
+                          const fresco_encode_params_t& params) {
+    Encoded from_file = encode(file, params);
+    Encoded from_pixels = encode(pixels, params, width, height, channels);
+    ASSERT_EQ(from_file.result, FRESCO_OK);
+    ASSERT_EQ(from_pixels.result, FRESCO_OK);
+    EXPECT_EQ(from_file.data, from_pixels.data);
+}
+
+// Decodes to raw samples, or with file set, to a file of format
+std::vector<uint8_t> decode(const std::vector<uint8_t>& input, bool file = false,
+                            fresco_file_format_t format = FRESCO_FILE_PNM) {
+    fresco_decoder_t* decoder = nullptr;
+    EXPECT_EQ(fresco_decoder_create(&decoder), FRESCO_OK);
+    uint8_t* output = nullptr;
+    size_t output_size = 0;
+    const fresco_error_t result =
+        file ? fresco_decoder_decode_file(decoder, input.data(), input.size(), format, &output,
+                                          &output_size)
+             : fresco_decoder_decode(decoder, input.data(), input.size(), &output, &output_size);
+    EXPECT_EQ(result, FRESCO_OK);
+    std::vector<uint8_t> decoded;
+    if (result == FRESCO_OK) {
+        decoded.assign(output, output + output_size);
+        fresco_free(output);
+    }
+    fresco_decoder_destroy(decoder);
+    return decoded;
+}
+
+} // namespace
+
+TEST(FrescoFormatsTest, PnmFilesEncodeLikeTheirPixels) {
+    const uint32_t width = 37, height = 29;
+    std::vector<uint8_t> rgb, rgba, gray16, gray8;
+    for (uint32_t y = 0; y < height; y++) {
+        for (uint32_t x = 0; x < width; x++) {
+            for (uint32_t c = 0; c < 4; c++) {
+                const uint8_t value = static_cast<uint8_t>(x * 5 + y * 11 + c * 40);
+                rgba.push_back(value);
+                if (c < 3) {
+                    rgb.push_back(value);
+                }
+            }
+            const uint32_t sample = (x * y) % 1024;
+            gray16.push_back(static_cast<uint8_t>(sample >> 8));
+            gray16.push_back(static_cast<uint8_t>(sample));
+            gray8.push_back(static_cast<uint8_t>((sample * 255 + 511) / 1023));
+        }
+    }
+    const fresco_encode_params_t params = lossless_params();
+
+    // maxval 255 is read in place; the 10-bit PGM is scaled to 8 bits
+    expect_same_encoding(with_header("P6\n# comment\n37 29\n255\n", rgb), rgb, width, height, 3,
+                         params);
+    expect_same_encoding(with_header("P5 37 29 1023\n", gray16), gray8, width, height, 1,
+                         params);
+    expect_same_encoding(with_header("P7\nWIDTH 37\nHEIGHT 29\nDEPTH 4\nMAXVAL 255\n"
+                                     "TUPLTYPE RGB_ALPHA\nENDHDR\n",
+                                     rgba),
+                         rgba, width, height, 4, params);
+
+    // A raster shorter than the header says
+    rgb.pop_back();
+    EXPECT_EQ(encode(with_header("P6 37 29 255\n", rgb), params).result,
+              FRESCO_ERROR_CORRUPTED_DATA);
+}
+
+TEST(FrescoFormatsTest, PngFilesEncodeLikeTheirPixels) {
+    const fresco_encode_params_t params = lossless_params();
+    const std::vector<uint8_t> rgb = filtered_rgb_pixels();
+    expect_same_encoding({kFilteredRgb, kFilteredRgb + sizeof(kFilteredRgb)}, rgb, 19, 13, 3,
+                         params);
+    expect_same_encoding({kInterlacedRgb, kInterlacedRgb + sizeof(kInterlacedRgb)}, rgb, 19, 13,
+                         3, params);
+    expect_same_encoding({kPaletteAlpha, kPaletteAlpha + sizeof(kPaletteAlpha)},
+                         palette_alpha_pixels(), 19, 13, 4, params);
+
+    // A flipped bit in the compressed data fails the Adler-32 or the stream
+    std::vector<uint8_t> corrupted(kFilteredRgb, kFilteredRgb + sizeof(kFilteredRgb));
+    corrupted[corrupted.size() - 24] ^= 0x10;
+    EXPECT_EQ(encode(corrupted, params).result, FRESCO_ERROR_CORRUPTED_DATA);
+
+    // A size in IHDR far beyond what the IDAT data inflates to is refused
+    // before any row is allocated
+    for (uint8_t byte : {0x7F, 0x01}) {
+        std::vector<uint8_t> huge(kFilteredRgb, kFilteredRgb + sizeof(kFilteredRgb));
+        std::fill(huge.begin() + 16, huge.begin() + 24, 0);
+        huge[16] = huge[20] = byte;    // Width and height of 0x7F000000 or 2^24
+        EXPECT_EQ(encode(huge, params).result, FRESCO_ERROR_CORRUPTED_DATA);
+    }
+}
+
+TEST(FrescoFormatsTest, PngRowsStreamIntoTileRows) {
+    // Three rows of 64-pixel tiles, the last partial
+    const uint32_t width = 150, height = 140;
+    std::vector<uint8_t> pixels(static_cast<size_t>(width) * height * 3);
+    for (size_t i = 0; i < pixels.size(); i++) {
+        pixels[i] = static_cast<uint8_t>((i * 7) ^ (i / 450));
+    }
+    const std::vector<uint8_t> png = stored_png(pixels, width, height);
+
+    fresco_encode_params_t params = lossless_params();
+    params.max_threads = 2;
+    expect_same_encoding(png, pixels, width, height, 3, params);
+
+    // Rate control needs the whole image and decodes it first
+    params.mode = FRESCO_COMPRESSION_LOSSY;
+    params.target_bytes = 8000;
+    expect_same_encoding(png, pixels, width, height, 3, params);
+}
+
+TEST(FrescoFormatsTest, DecodedFilesReadBackAsTheirPixels) {
+    // Three rows of 64-pixel tiles, the last partial, written as they decode
+    const uint32_t width = 150, height = 140;
+    fresco_encode_params_t params = lossless_params();
+    params.max_threads = 2;
+    for (uint8_t channels = 1; channels <= 4; channels++) {
+        std::vector<uint8_t> pixels(static_cast<size_t>(width) * height * channels);
+        for (size_t i = 0; i < pixels.size(); i++) {
+            pixels[i] = static_cast<uint8_t>((i / channels) % 251 + (i % channels) * 60);
+        }
+        Encoded encoded = encode(pixels, params, width, height, channels);
+        ASSERT_EQ(encoded.result, FRESCO_OK);
+        const std::vector<uint8_t> raw = decode(encoded.data);
+
+        const std::vector<uint8_t> pnm = decode(encoded.data, true, FRESCO_FILE_PNM);
+        const std::string pnm_header(pnm.begin(), pnm.begin() + 3);
+        EXPECT_EQ(pnm_header, channels == 1 ? "P5\n" : channels == 3 ? "P6\n" : "P7\n");
+        EXPECT_EQ(std::vector<uint8_t>(pnm.end() - raw.size(), pnm.end()), raw);
+
+        for (fresco_file_format_t format :
+             {FRESCO_FILE_PNM, FRESCO_FILE_PAM, FRESCO_FILE_PNG, FRESCO_FILE_PNG_STORED}) {
+            expect_same_encoding(decode(encoded.data, true, format), raw, width, height,
+                                 channels, params);
+        }
+    }
+}
+
+TEST(FrescoFormatsTest, WrittenFilesReadBackAsTheirPixels) {
+    const uint32_t width = 45, height = 31;
+    const fresco_encode_params_t params = lossless_params();
+    for (uint8_t channels = 1; channels <= 4; channels++) {
+        const size_t row_bytes = static_cast<size_t>(width) * channels;
+        // Rows padded past their pixels, as a tile's view into a wider image
+        const size_t stride = row_bytes + 7;
+        std::vector<uint8_t> padded(stride * height, 0xEE);
+        std::vector<uint8_t> pixels;
+        for (uint32_t y = 0; y < height; y++) {
+            for (size_t x = 0; x < row_bytes; x++) {
+                padded[y * stride + x] = static_cast<uint8_t>(x * 5 + y * 3);
+            }
+            pixels.insert(pixels.end(), padded.begin() + y * stride,
+                          padded.begin() + y * stride + row_bytes);
+        }
+        const fresco_image_t image = {padded.data(), width, height, channels, stride};
+        for (fresco_file_format_t format :
+             {FRESCO_FILE_PNM, FRESCO_FILE_PAM, FRESCO_FILE_PNG, FRESCO_FILE_PNG_STORED}) {
+            uint8_t* data = nullptr;
+            size_t size = 0;
+            ASSERT_EQ(fresco_write_image_file(&image, format, &data, &size), FRESCO_OK);
+            const std::vector<uint8_t> file(data, data + size);
+            fresco_free(data);
+            expect_same_encoding(file, pixels, width, height, channels, params);
+        }
+    }
+
+    uint8_t* data = nullptr;
+    size_t size = 0;
+    const std::vector<uint8_t> pixels(16);
+    const fresco_image_t narrow = {pixels.data(), 4, 2, 3, 8};
+    EXPECT_EQ(fresco_write_image_file(&narrow, FRESCO_FILE_PNG, &data, &size),
+              FRESCO_ERROR_INVALID_PARAMETER);
+    const fresco_image_t empty = {pixels.data(), 0, 2, 3, 0};
+    EXPECT_EQ(fresco_write_image_file(&empty, FRESCO_FILE_PNG, &data, &size),
+              FRESCO_ERROR_UNSUPPORTED_FORMAT);
+}
+
+TEST(FrescoFormatsTest, FilesDecodeRowsOnSeveralThreads) {
+    // Six rows of eight tiles, enough for the threads of each row to share
+    const uint32_t width = 1024, height = 768;
+    const uint8_t channels = 3;
+    fresco_encode_params_t params = lossless_params();
+    params.tile_size = 128;
+    std::vector<uint8_t> pixels(static_cast<size_t>(width) * height * channels);
+    for (size_t i = 0; i < pixels.size(); i++) {
+        pixels[i] = static_cast<uint8_t>((i / channels) % 251 + (i % channels) * 60);
+    }
+    Encoded encoded = encode(pixels, params, width, height, channels);
+    ASSERT_EQ(encoded.result, FRESCO_OK);
+
+    for (fresco_file_format_t format : {FRESCO_FILE_PNM, FRESCO_FILE_PNG}) {
+        std::vector<uint8_t> files[2];
+        for (uint32_t threads : {1u, 4u}) {
+            fresco_decoder_t* decoder = nullptr;
+            ASSERT_EQ(fresco_decoder_create(&decoder), FRESCO_OK);
+            fresco_decode_params_t decode_params = {};
+            decode_params.max_threads = threads;
+            ASSERT_EQ(fresco_decoder_set_params(decoder, &decode_params), FRESCO_OK);
+            uint8_t* output = nullptr;
+            size_t output_size = 0;
+            ASSERT_EQ(fresco_decoder_decode_file(decoder, encoded.data.data(),
+                                                 encoded.data.size(), format, &output,
+                                                 &output_size),
+                      FRESCO_OK);
+            files[threads > 1].assign(output, output + output_size);
+            fresco_free(output);
+            fresco_decoder_destroy(decoder);
+        }
+        EXPECT_EQ(files[1], files[0]);
+        if (format == FRESCO_FILE_PNM) {
+            EXPECT_EQ(std::vector<uint8_t>(files[1].end() - pixels.size(), files[1].end()),
+                      pixels);
+        }
+    }
+}
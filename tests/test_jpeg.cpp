@@ -0,0 +1,251 @@
+/**
+ * @file test_jpeg.cpp
+ * @brief Unit tests for lossless JPEG recompression
+ * @author Mehmet T. AKALIN
+ * @date 2025
+ * @license MIT
+ */
+
+#include "fresco/fresco.h"
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <cstring>
+#include <iterator>
+#include <vector>
+
+namespace {
+
+// 32x32 progressive 4:2:0 with refinement scans and a restart interval of
+// two MCUs, from libjpeg's simple progression
+const uint8_t kProgressive420[] = {
+    0xff, 0xd8, 0xff, 0xe0, 0x00, 0x10, 0x4a, 0x46, 0x49, 0x46, 0x00, 0x01,
+    0x01, 0x00, 0x00, 0x01, 0x00, 0x01, 0x00, 0x00, 0xff, 0xdb, 0x00, 0x43,
+    0x00, 0x0d, 0x09, 0x0a, 0x0b, 0x0a, 0x08, 0x0d, 0x0b, 0x0a, 0x0b, 0x0e,
+    0x0e, 0x0d, 0x0f, 0x13, 0x20, 0x15, 0x13, 0x12, 0x12, 0x13, 0x27, 0x1c,
+    0x1e, 0x17, 0x20, 0x2e, 0x29, 0x31, 0x30, 0x2e, 0x29, 0x2d, 0x2c, 0x33,
+    0x3a, 0x4a, 0x3e, 0x33, 0x36, 0x46, 0x37, 0x2c, 0x2d, 0x40, 0x57, 0x41,
+    0x46, 0x4c, 0x4e, 0x52, 0x53, 0x52, 0x32, 0x3e, 0x5a, 0x61, 0x5a, 0x50,
+    0x60, 0x4a, 0x51, 0x52, 0x4f, 0xff, 0xdb, 0x00, 0x43, 0x01, 0x0e, 0x0e,
+    0x0e, 0x13, 0x11, 0x13, 0x26, 0x15, 0x15, 0x26, 0x4f, 0x35, 0x2d, 0x35,
+    0x4f, 0x4f, 0x4f, 0x4f, 0x4f, 0x4f, 0x4f, 0x4f, 0x4f, 0x4f, 0x4f, 0x4f,
+    0x4f, 0x4f, 0x4f, 0x4f, 0x4f, 0x4f, 0x4f, 0x4f, 0x4f, 0x4f, 0x4f, 0x4f,
+    0x4f, 0x4f, 0x4f, 0x4f, 0x4f, 0x4f, 0x4f, 0x4f, 0x4f, 0x4f, 0x4f, 0x4f,
+    0x4f, 0x4f, 0x4f, 0x4f, 0x4f, 0x4f, 0x4f, 0x4f, 0x4f, 0x4f, 0x4f, 0x4f,
+    0x4f, 0x4f, 0xff, 0xc2, 0x00, 0x11, 0x08, 0x00, 0x20, 0x00, 0x20, 0x03,
+    0x01, 0x22, 0x00, 0x02, 0x11, 0x01, 0x03, 0x11, 0x01, 0xff, 0xc4, 0x00,
+    0x18, 0x00, 0x00, 0x03, 0x01, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x02, 0x03, 0x04, 0x01, 0x05, 0xff,
+    0xc4, 0x00, 0x18, 0x01, 0x00, 0x02, 0x03, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x03, 0x04, 0x00, 0x01,
+    0x02, 0xff, 0xdd, 0x00, 0x04, 0x00, 0x02, 0xff, 0xda, 0x00, 0x0c, 0x03,
+    0x01, 0x00, 0x02, 0x10, 0x03, 0x10, 0x00, 0x00, 0x01, 0x8e, 0x85, 0x91,
+    0x82, 0x36, 0x93, 0x65, 0x7f, 0xff, 0xd0, 0xe7, 0x75, 0x52, 0xe6, 0x57,
+    0xb3, 0x4b, 0x56, 0xdf, 0xff, 0xc4, 0x00, 0x1b, 0x10, 0x00, 0x03, 0x00,
+    0x03, 0x01, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x01, 0x02, 0x11, 0x12, 0x22, 0x03, 0x21, 0xff, 0xda, 0x00,
+    0x08, 0x01, 0x01, 0x00, 0x01, 0x05, 0x02, 0x99, 0x1a, 0xd4, 0xff, 0xd0,
+    0x7d, 0x9e, 0x33, 0x83, 0xff, 0xd1, 0xcc, 0xe2, 0x76, 0xa3, 0xff, 0xd2,
+    0x8f, 0x34, 0x8a, 0xf8, 0x7f, 0xff, 0xd3, 0x98, 0xea, 0x56, 0xa7, 0xff,
+    0xd4, 0xce, 0xe9, 0x41, 0xff, 0xd5, 0xe4, 0xf3, 0x55, 0x9f, 0xff, 0xd6,
+    0x5c, 0x94, 0xf2, 0x7f, 0xff, 0xc4, 0x00, 0x17, 0x11, 0x00, 0x03, 0x01,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x01, 0x11, 0x02, 0xff, 0xda, 0x00, 0x08, 0x01, 0x03, 0x01,
+    0x01, 0x3f, 0x01, 0x4e, 0x12, 0x9f, 0xff, 0xd0, 0xd1, 0x93, 0xff, 0xc4,
+    0x00, 0x1a, 0x11, 0x00, 0x03, 0x01, 0x00, 0x03, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x02, 0x12, 0x11, 0x01,
+    0x31, 0x41, 0xff, 0xda, 0x00, 0x08, 0x01, 0x02, 0x01, 0x01, 0x3f, 0x01,
+    0x9d, 0x1b, 0x96, 0x9c, 0x5e, 0xcf, 0xff, 0xd0, 0xf0, 0xb5, 0xac, 0x3f,
+    0xff, 0xc4, 0x00, 0x19, 0x10, 0x01, 0x00, 0x03, 0x01, 0x01, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x01, 0x11,
+    0x21, 0x10, 0x22, 0xff, 0xda, 0x00, 0x08, 0x01, 0x01, 0x00, 0x06, 0x3f,
+    0x02, 0x5b, 0xff, 0xd0, 0xa8, 0xe7, 0xff, 0xd1, 0xc9, 0xd5, 0x4b, 0xff,
+    0xd2, 0xd7, 0x97, 0xff, 0xd3, 0x5b, 0xff, 0xd4, 0xae, 0x7f, 0xff, 0xd5,
+    0xc6, 0xbf, 0xff, 0xd6, 0x79, 0xc7, 0xff, 0xc4, 0x00, 0x1e, 0x10, 0x00,
+    0x02, 0x03, 0x00, 0x03, 0x00, 0x03, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x01, 0x11, 0x21, 0x31, 0x41, 0x51, 0x71, 0x61,
+    0x81, 0x91, 0xff, 0xda, 0x00, 0x08, 0x01, 0x01, 0x00, 0x01, 0x3f, 0x21,
+    0x7c, 0xac, 0x35, 0x71, 0x74, 0x7f, 0xff, 0xd0, 0x82, 0x40, 0xf6, 0x6c,
+    0x66, 0xcf, 0xff, 0xd1, 0x4a, 0x68, 0x3a, 0x58, 0xef, 0xb1, 0xa7, 0xf0,
+    0x7f, 0xff, 0xd2, 0x6d, 0x29, 0x1e, 0x98, 0xcf, 0xd8, 0xb3, 0xff, 0xd3,
+    0xa9, 0x7c, 0x95, 0x74, 0x7f, 0xff, 0xd4, 0x56, 0x4a, 0x39, 0x37, 0xb3,
+    0xff, 0xd5, 0x53, 0x4f, 0x97, 0x14, 0x42, 0x29, 0x3f, 0x59, 0xff, 0xd6,
+    0x75, 0xa4, 0xbf, 0x0a, 0xff, 0x00, 0x64, 0x1f, 0xff, 0xda, 0x00, 0x0c,
+    0x03, 0x01, 0x00, 0x02, 0x00, 0x03, 0x00, 0x00, 0x00, 0x10, 0x38, 0xaf,
+    0xff, 0xd0, 0xc0, 0x3f, 0xff, 0xc4, 0x00, 0x17, 0x11, 0x00, 0x03, 0x01,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x01, 0x11, 0x21, 0xff, 0xda, 0x00, 0x08, 0x01, 0x03, 0x01,
+    0x01, 0x3f, 0x10, 0x86, 0x0e, 0xb4, 0xff, 0xd0, 0x4a, 0xf0, 0xca, 0xd3,
+    0xff, 0xc4, 0x00, 0x1c, 0x11, 0x00, 0x02, 0x02, 0x02, 0x03, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x01, 0x11, 0x00,
+    0x21, 0x41, 0x91, 0x31, 0x61, 0xa1, 0xff, 0xda, 0x00, 0x08, 0x01, 0x02,
+    0x01, 0x01, 0x3f, 0x10, 0x2c, 0x71, 0xe1, 0x56, 0x0e, 0x7f, 0xff, 0xd0,
+    0x2c, 0xa8, 0x28, 0xd6, 0x9d, 0xf9, 0x2e, 0x03, 0x43, 0x36, 0x46, 0xf8,
+    0xae, 0xcc, 0xff, 0xc4, 0x00, 0x1e, 0x10, 0x01, 0x00, 0x02, 0x03, 0x01,
+    0x00, 0x03, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x01,
+    0x00, 0x11, 0x21, 0x31, 0x41, 0x51, 0x71, 0xc1, 0xf0, 0xb1, 0xff, 0xda,
+    0x00, 0x08, 0x01, 0x01, 0x00, 0x01, 0x3f, 0x10, 0xdd, 0xf6, 0x3b, 0x18,
+    0x61, 0x76, 0x1b, 0x79, 0x3f, 0xff, 0xd0, 0x42, 0x11, 0x34, 0x3f, 0x7b,
+    0x2d, 0x30, 0xcd, 0x6a, 0x7f, 0xff, 0xd1, 0x48, 0xaa, 0x16, 0x97, 0xcf,
+    0x20, 0x2e, 0xe4, 0x61, 0x3f, 0xff, 0xd2, 0xc4, 0xfd, 0x2a, 0xd2, 0x4a,
+    0x82, 0x48, 0xdf, 0xf0, 0x7d, 0xcf, 0xff, 0xd3, 0x5f, 0x86, 0xe4, 0xaa,
+    0x39, 0x78, 0x95, 0x3f, 0xff, 0xd4, 0xa2, 0x2b, 0x1c, 0x8c, 0xfe, 0xdc,
+    0xab, 0x1f, 0x3c, 0x9f, 0xff, 0xd5, 0xa1, 0x32, 0xe2, 0x51, 0x19, 0xe7,
+    0x23, 0xeb, 0x5f, 0x2c, 0x9f, 0xff, 0xd6, 0x5e, 0xc6, 0xeb, 0x31, 0x45,
+    0x34, 0x17, 0x92, 0xaf, 0xcf, 0xb9, 0xff, 0xd9,
+};
+
+// 24x16 baseline grayscale with optimized Huffman tables
+const uint8_t kBaselineGray[] = {
+    0xff, 0xd8, 0xff, 0xe0, 0x00, 0x10, 0x4a, 0x46, 0x49, 0x46, 0x00, 0x01,
+    0x01, 0x00, 0x00, 0x01, 0x00, 0x01, 0x00, 0x00, 0xff, 0xdb, 0x00, 0x43,
+    0x00, 0x06, 0x04, 0x05, 0x06, 0x05, 0x04, 0x06, 0x06, 0x05, 0x06, 0x07,
+    0x07, 0x06, 0x08, 0x0a, 0x10, 0x0a, 0x0a, 0x09, 0x09, 0x0a, 0x14, 0x0e,
+    0x0f, 0x0c, 0x10, 0x17, 0x14, 0x18, 0x18, 0x17, 0x14, 0x16, 0x16, 0x1a,
+    0x1d, 0x25, 0x1f, 0x1a, 0x1b, 0x23, 0x1c, 0x16, 0x16, 0x20, 0x2c, 0x20,
+    0x23, 0x26, 0x27, 0x29, 0x2a, 0x29, 0x19, 0x1f, 0x2d, 0x30, 0x2d, 0x28,
+    0x30, 0x25, 0x28, 0x29, 0x28, 0xff, 0xc0, 0x00, 0x0b, 0x08, 0x00, 0x10,
+    0x00, 0x18, 0x01, 0x01, 0x11, 0x00, 0xff, 0xc4, 0x00, 0x16, 0x00, 0x00,
+    0x03, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x02, 0x06, 0x07, 0xff, 0xc4, 0x00, 0x25, 0x10, 0x00,
+    0x02, 0x01, 0x03, 0x02, 0x06, 0x03, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x01, 0x03, 0x02, 0x04, 0x11, 0x21, 0x00, 0x05, 0x06,
+    0x13, 0x31, 0x32, 0x41, 0x51, 0x12, 0x14, 0x15, 0x71, 0xff, 0xda, 0x00,
+    0x08, 0x01, 0x01, 0x00, 0x00, 0x3f, 0x00, 0x8c, 0x70, 0x96, 0xd4, 0xd8,
+    0x3a, 0x9c, 0x19, 0x2b, 0xbe, 0x3e, 0x4f, 0xbf, 0xe6, 0xa8, 0xcf, 0x57,
+    0xe7, 0xa4, 0xd5, 0xbc, 0x89, 0x29, 0x7d, 0x44, 0x32, 0x73, 0x8f, 0x36,
+    0xf7, 0xa5, 0x7d, 0xf5, 0x8b, 0xdf, 0x55, 0x1a, 0x7a, 0x48, 0x32, 0x33,
+    0x8c, 0xc3, 0x09, 0x60, 0x00, 0x58, 0x02, 0x3c, 0x13, 0xef, 0x42, 0x2a,
+    0x36, 0xfa, 0x5a, 0x76, 0x4a, 0x95, 0xe8, 0xfb, 0x11, 0x81, 0x2b, 0x11,
+    0x68, 0x27, 0xe5, 0x6c, 0x58, 0x5f, 0x39, 0xd1, 0xed, 0x3b, 0x8e, 0xe5,
+    0xba, 0xb2, 0x34, 0xb5, 0x7c, 0xc6, 0x26, 0x7d, 0xd1, 0xe5, 0x81, 0x7b,
+    0x64, 0x64, 0x0b, 0xf5, 0x1a, 0x7b, 0xe1, 0xee, 0x1d, 0xa5, 0x5b, 0x79,
+    0x95, 0x4a, 0x09, 0x81, 0x8d, 0x84, 0x99, 0x23, 0x10, 0x4e, 0x31, 0x72,
+    0x75, 0xff, 0xd9,
+};
+
+// Offset of the SOF0 marker code in kBaselineGray
+constexpr size_t kGraySofOffset = 90;
+
+std::vector<uint8_t> encode_jpeg(const uint8_t* jpeg, size_t size, fresco_error_t& result) {
+    fresco_encoder_t* encoder = nullptr;
+    EXPECT_EQ(fresco_encoder_create(&encoder), FRESCO_OK);
+    uint8_t* output = nullptr;
+    size_t output_size = 0;
+    result = fresco_encoder_encode_jpeg(encoder, jpeg, size, &output, &output_size);
+    std::vector<uint8_t> encoded;
+    if (result == FRESCO_OK) {
+        encoded.assign(output, output + output_size);
+        fresco_free(output);
+    }
+    fresco_encoder_destroy(encoder);
+    return encoded;
+}
+
+} // namespace
+
+TEST(FrescoJpegTest, RecompressedJpegRebuildsByteForByte) {
+    const struct {
+        const uint8_t* data;
+        size_t size;
+        uint32_t width;
+        uint32_t height;
+        uint32_t channels;
+        fresco_colorspace_t colorspace;
+    } cases[] = {
+        {kProgressive420, sizeof(kProgressive420), 32, 32, 3, FRESCO_COLORSPACE_YUV420},
+        {kBaselineGray, sizeof(kBaselineGray), 24, 16, 1, FRESCO_COLORSPACE_GRAY},
+    };
+
+    fresco_decoder_t* decoder = nullptr;
+    ASSERT_EQ(fresco_decoder_create(&decoder), FRESCO_OK);
+    for (const auto& test : cases) {
+        fresco_error_t result;
+        std::vector<uint8_t> encoded = encode_jpeg(test.data, test.size, result);
+        ASSERT_EQ(result, FRESCO_OK);
+
+        fresco_metadata_t metadata;
+        ASSERT_EQ(fresco_get_metadata(encoded.data(), encoded.size(), &metadata), FRESCO_OK);
+        EXPECT_EQ(metadata.width, test.width);
+        EXPECT_EQ(metadata.height, test.height);
+        EXPECT_EQ(metadata.channels, test.channels);
+        EXPECT_EQ(metadata.colorspace, test.colorspace);
+
+        uint8_t* jpeg = nullptr;
+        size_t jpeg_size = 0;
+        ASSERT_EQ(fresco_decoder_decode_jpeg(decoder, encoded.data(), encoded.size(), &jpeg,
+                                             &jpeg_size),
+                  FRESCO_OK);
+        ASSERT_EQ(jpeg_size, test.size);
+        EXPECT_EQ(std::memcmp(jpeg, test.data, jpeg_size), 0);
+        fresco_free(jpeg);
+
+        fresco_stats_t stats;
+        ASSERT_EQ(fresco_decoder_get_stats(decoder, &stats), FRESCO_OK);
+        EXPECT_GT(stats.raster_bytes, 0u);
+
+        // There are no pixels to decode
+        uint8_t* pixels = nullptr;
+        size_t pixel_size = 0;
+        EXPECT_EQ(fresco_decoder_decode(decoder, encoded.data(), encoded.size(), &pixels,
+                                        &pixel_size),
+                  FRESCO_ERROR_UNSUPPORTED_FORMAT);
+    }
+    fresco_decoder_destroy(decoder);
+}
+
+TEST(FrescoJpegTest, UnsupportedJpegsAreRefused) {
+    fresco_error_t result;
+
+    // Arithmetic coding
+    std::vector<uint8_t> arithmetic(kBaselineGray, kBaselineGray + sizeof(kBaselineGray));
+    ASSERT_EQ(arithmetic[kGraySofOffset - 1], 0xFF);
+    ASSERT_EQ(arithmetic[kGraySofOffset], 0xC0);
+    arithmetic[kGraySofOffset] = 0xC9;
+    encode_jpeg(arithmetic.data(), arithmetic.size(), result);
+    EXPECT_EQ(result, FRESCO_ERROR_UNSUPPORTED_FORMAT);
+
+    // More codes of one bit than there are, which would write past the
+    // lookup table of short codes
+    const uint8_t ac_table[] = {0xFF, 0xC4, 0x00, 0x25, 0x10, 0x00, 0x02};
+    std::vector<uint8_t> oversubscribed(kBaselineGray, kBaselineGray + sizeof(kBaselineGray));
+    const auto dht = std::search(oversubscribed.begin(), oversubscribed.end(),
+                                 std::begin(ac_table), std::end(ac_table));
+    ASSERT_NE(dht, oversubscribed.end());
+    // All 18 values get one-bit codes instead, in the last AC table
+    dht[4] = 0x13;
+    std::fill(dht + 5, dht + 21, 0);
+    dht[5] = 18;
+    encode_jpeg(oversubscribed.data(), oversubscribed.size(), result);
+    EXPECT_EQ(result, FRESCO_ERROR_CORRUPTED_DATA);
+
+    // Not a JPEG
+    const uint8_t png[] = {0x89, 'P', 'N', 'G', 0x0D, 0x0A, 0x1A, 0x0A};
+    encode_jpeg(png, sizeof(png), result);
+    EXPECT_EQ(result, FRESCO_ERROR_UNSUPPORTED_FORMAT);
+
+    // Cut off before the frame header
+    encode_jpeg(kProgressive420, 100, result);
+    EXPECT_EQ(result, FRESCO_ERROR_CORRUPTED_DATA);
+
+    // A file without a JPEG track
+    std::vector<uint8_t> pixels(16 * 16 * 3, 128);
+    fresco_image_t image = {};
+    image.pixels = pixels.data();
+    image.width = 16;
+    image.height = 16;
+    image.channels = 3;
+    fresco_encoder_t* encoder = nullptr;
+    ASSERT_EQ(fresco_encoder_create(&encoder), FRESCO_OK);
+    uint8_t* output = nullptr;
+    size_t output_size = 0;
+    ASSERT_EQ(fresco_encoder_encode_image(encoder, &image, &output, &output_size), FRESCO_OK);
+    fresco_decoder_t* decoder = nullptr;
+    ASSERT_EQ(fresco_decoder_create(&decoder), FRESCO_OK);
+    uint8_t* jpeg = nullptr;
+    size_t jpeg_size = 0;
+    EXPECT_EQ(fresco_decoder_decode_jpeg(decoder, output, output_size, &jpeg, &jpeg_size),
+              FRESCO_ERROR_UNSUPPORTED_FORMAT);
+    fresco_free(output);
+    fresco_decoder_destroy(decoder);
+    fresco_encoder_destroy(encoder);
+}
@@ -0,0 +1,472 @@
+/**
+ * @file test_mesh.cpp
+ * @brief Unit tests for the FRESCO 3D track
+ * @author Mehmet T. AKALIN
+ * @date 2025
+ * @license MIT
+ */
+
+#include "fresco/fresco.h"
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <map>
+#include <random>
+#include <vector>
+
+namespace {
+
+struct TestMesh {
+    std::vector<float> positions;
+    std::vector<float> normals;
+    std::vector<float> uvs;
+    std::vector<uint32_t> indices;
+
+    fresco_mesh_t view() const {
+        return {positions.data(), normals.empty() ? nullptr : normals.data(),
+                uvs.empty() ? nullptr : uvs.data(), positions.size() / 3, indices.data(),
+                indices.size() / 3};
+    }
+};
+
+// Closed torus without seams, so every position is unique
+TestMesh make_torus(uint32_t rings, uint32_t sides) {
+    const float pi = 3.14159265358979f;
+    TestMesh mesh;
+    for (uint32_t i = 0; i < rings; i++) {
+        const float u = 2.0f * pi * i / rings;
+        for (uint32_t j = 0; j < sides; j++) {
+            const float v = 2.0f * pi * j / sides;
+            const float r = 3.0f + std::cos(v);
+            mesh.positions.insert(mesh.positions.end(),
+                                  {r * std::cos(u), r * std::sin(u), std::sin(v)});
+            mesh.normals.insert(mesh.normals.end(),
+                                {std::cos(v) * std::cos(u), std::cos(v) * std::sin(u), std::sin(v)});
+            mesh.uvs.insert(mesh.uvs.end(), {static_cast<float>(i) / rings,
+                                             static_cast<float>(j) / sides});
+        }
+    }
+    for (uint32_t i = 0; i < rings; i++) {
+        for (uint32_t j = 0; j < sides; j++) {
+            const uint32_t a = i * sides + j;
+            const uint32_t b = ((i + 1) % rings) * sides + j;
+            const uint32_t c = ((i + 1) % rings) * sides + (j + 1) % sides;
+            const uint32_t d = i * sides + (j + 1) % sides;
+            mesh.indices.insert(mesh.indices.end(), {a, b, c, a, c, d});
+        }
+    }
+    return mesh;
+}
+
+std::vector<uint8_t> encode_mesh(const TestMesh& mesh, uint8_t quality = 85,
+                                 uint32_t lod_levels = 0) {
+    fresco_encoder_t* encoder = nullptr;
+    EXPECT_EQ(fresco_encoder_create(&encoder), FRESCO_OK);
+
+    fresco_encode_params_t params = {};
+    params.mode = FRESCO_COMPRESSION_LOSSY;
+    params.quality = quality;
+    params.effort = 5;
+    params.enable_3d = 1;
+    params.mesh_lod_levels = lod_levels;
+    EXPECT_EQ(fresco_encoder_set_params(encoder, &params), FRESCO_OK);
+    fresco_mesh_t view = mesh.view();
+    EXPECT_EQ(fresco_encoder_set_mesh(encoder, &view), FRESCO_OK);
+
+    uint8_t* output = nullptr;
+    size_t output_size = 0;
+    EXPECT_EQ(fresco_encoder_encode(encoder, nullptr, 0, &output, &output_size), FRESCO_OK);
+    std::vector<uint8_t> encoded(output, output + output_size);
+    fresco_free(output);
+    fresco_encoder_destroy(encoder);
+    return encoded;
+}
+
+// Triangle as vertex ids rotated so the smallest comes first; keeps winding
+std::array<uint32_t, 3> canonical(uint32_t a, uint32_t b, uint32_t c) {
+    if (b < a && b < c) {
+        return {b, c, a};
+    }
+    if (c < a && c < b) {
+        return {c, a, b};
+    }
+    return {a, b, c};
+}
+
+// Maps decoded vertices back to input vertices by nearest position and
+// compares the triangle sets
+void expect_same_surface(const TestMesh& input, const fresco_mesh_t& decoded, float tolerance) {
+    const size_t vertex_count = input.positions.size() / 3;
+    ASSERT_EQ(decoded.vertex_count, vertex_count);
+    ASSERT_EQ(decoded.triangle_count, input.indices.size() / 3);
+
+    std::vector<uint32_t> original(vertex_count);
+    for (size_t v = 0; v < vertex_count; v++) {
+        float best = INFINITY;
+        for (size_t w = 0; w < vertex_count; w++) {
+            float d = 0.0f;
+            for (int k = 0; k < 3; k++) {
+                d = std::max(d, std::fabs(decoded.positions[v * 3 + k] - input.positions[w * 3 + k]));
+            }
+            if (d < best) {
+                best = d;
+                original[v] = static_cast<uint32_t>(w);
+            }
+        }
+        ASSERT_LE(best, tolerance);
+    }
+
+    std::vector<std::array<uint32_t, 3>> expected, actual;
+    for (size_t t = 0; t < input.indices.size(); t += 3) {
+        expected.push_back(canonical(input.indices[t], input.indices[t + 1], input.indices[t + 2]));
+        actual.push_back(canonical(original[decoded.indices[t]], original[decoded.indices[t + 1]],
+                                   original[decoded.indices[t + 2]]));
+    }
+    std::sort(expected.begin(), expected.end());
+    std::sort(actual.begin(), actual.end());
+    EXPECT_EQ(actual, expected);
+}
+
+// Merges vertices with identical positions, as repeated across chunk borders
+TestMesh weld(const fresco_mesh_t& mesh) {
+    TestMesh welded;
+    std::map<std::array<float, 3>, uint32_t> ids;
+    std::vector<uint32_t> remap(mesh.vertex_count);
+    for (size_t v = 0; v < mesh.vertex_count; v++) {
+        const std::array<float, 3> p = {mesh.positions[v * 3], mesh.positions[v * 3 + 1],
+                                        mesh.positions[v * 3 + 2]};
+        auto inserted = ids.emplace(p, static_cast<uint32_t>(ids.size()));
+        if (inserted.second) {
+            welded.positions.insert(welded.positions.end(), p.begin(), p.end());
+        }
+        remap[v] = inserted.first->second;
+    }
+    for (size_t i = 0; i < mesh.triangle_count * 3; i++) {
+        welded.indices.push_back(remap[mesh.indices[i]]);
+    }
+    return welded;
+}
+
+} // namespace
+
+TEST(FrescoMeshTest, TorusRoundTrip) {
+    TestMesh torus = make_torus(48, 24);
+    std::vector<uint8_t> encoded = encode_mesh(torus);
+
+    // Connectivity and 14-bit attributes take far less than the raw arrays
+    const size_t raw_size = torus.positions.size() * 4 + torus.normals.size() * 4 +
+                            torus.uvs.size() * 4 + torus.indices.size() * 4;
+    EXPECT_LT(encoded.size(), raw_size / 4);
+
+    fresco_decoder_t* decoder = nullptr;
+    ASSERT_EQ(fresco_decoder_create(&decoder), FRESCO_OK);
+    fresco_mesh_t* decoded = nullptr;
+    ASSERT_EQ(fresco_decoder_decode_mesh(decoder, encoded.data(), encoded.size(), &decoded),
+              FRESCO_OK);
+    ASSERT_NE(decoded->normals, nullptr);
+    ASSERT_NE(decoded->uvs, nullptr);
+
+    // 14 bits over an extent of 8 units
+    const float position_tolerance = 8.0f / 16383.0f;
+    expect_same_surface(torus, *decoded, position_tolerance);
+
+    // Attributes follow their vertex through the renumbering
+    for (size_t v = 0; v < decoded->vertex_count; v++) {
+        const float* p = decoded->positions + v * 3;
+        const float* n = decoded->normals + v * 3;
+        const float u = std::atan2(p[1], p[0]);
+        const float r = std::hypot(p[0], p[1]) - 3.0f;
+        const float expected[3] = {r * std::cos(u), r * std::sin(u), p[2]};
+        for (int k = 0; k < 3; k++) {
+            EXPECT_NEAR(n[k], expected[k], 0.01f);
+        }
+    }
+    for (size_t v = 0; v < decoded->vertex_count * 2; v++) {
+        EXPECT_GE(decoded->uvs[v], 0.0f);
+        EXPECT_LE(decoded->uvs[v], 1.0f);
+    }
+
+    fresco_free(decoded);
+    fresco_decoder_destroy(decoder);
+}
+
+TEST(FrescoMeshTest, IrregularConnectivity) {
+    // Random triangles over a small vertex set: non-manifold edges, mixed
+    // orientation, degenerate and duplicate triangles, unused vertices
+    std::mt19937 gen(99);
+    std::uniform_int_distribution<uint32_t> vertex(0, 59);
+    std::uniform_real_distribution<float> coord(-10.0f, 10.0f);
+
+    TestMesh mesh;
+    for (int v = 0; v < 64; v++) {
+        mesh.positions.insert(mesh.positions.end(), {coord(gen), coord(gen), coord(gen)});
+    }
+    for (int t = 0; t < 400; t++) {
+        mesh.indices.insert(mesh.indices.end(), {vertex(gen), vertex(gen), vertex(gen)});
+    }
+    mesh.indices.insert(mesh.indices.end(), {1, 2, 3, 1, 2, 3, 3, 2, 1, 5, 5, 6});
+
+    std::vector<uint8_t> encoded = encode_mesh(mesh, 100);
+
+    fresco_decoder_t* decoder = nullptr;
+    ASSERT_EQ(fresco_decoder_create(&decoder), FRESCO_OK);
+    fresco_mesh_t* decoded = nullptr;
+    ASSERT_EQ(fresco_decoder_decode_mesh(decoder, encoded.data(), encoded.size(), &decoded),
+              FRESCO_OK);
+    EXPECT_EQ(decoded->normals, nullptr);
+    EXPECT_EQ(decoded->uvs, nullptr);
+    expect_same_surface(mesh, *decoded, 20.0f / 65535.0f);
+
+    fresco_free(decoded);
+    fresco_decoder_destroy(decoder);
+}
+
+TEST(FrescoMeshTest, PointCloud) {
+    TestMesh cloud;
+    for (int v = 0; v < 100; v++) {
+        cloud.positions.insert(cloud.positions.end(), {v * 0.5f, v * 0.25f, -v * 1.0f});
+    }
+    std::vector<uint8_t> encoded = encode_mesh(cloud);
+
+    fresco_decoder_t* decoder = nullptr;
+    ASSERT_EQ(fresco_decoder_create(&decoder), FRESCO_OK);
+    fresco_mesh_t* decoded = nullptr;
+    ASSERT_EQ(fresco_decoder_decode_mesh(decoder, encoded.data(), encoded.size(), &decoded),
+              FRESCO_OK);
+    ASSERT_EQ(decoded->vertex_count, 100u);
+    EXPECT_EQ(decoded->triangle_count, 0u);
+    for (size_t i = 0; i < cloud.positions.size(); i++) {
+        EXPECT_NEAR(decoded->positions[i], cloud.positions[i], 0.01f);
+    }
+    fresco_free(decoded);
+    fresco_decoder_destroy(decoder);
+}
+
+TEST(FrescoMeshTest, InvalidMesh) {
+    fresco_encoder_t* encoder = nullptr;
+    ASSERT_EQ(fresco_encoder_create(&encoder), FRESCO_OK);
+
+    TestMesh torus = make_torus(8, 6);
+    torus.indices[5] = 1000;
+    fresco_mesh_t view = torus.view();
+    EXPECT_EQ(fresco_encoder_set_mesh(encoder, &view), FRESCO_ERROR_INVALID_PARAMETER);
+
+    torus = make_torus(8, 6);
+    torus.positions[7] = std::nanf("");
+    view = torus.view();
+    EXPECT_EQ(fresco_encoder_set_mesh(encoder, &view), FRESCO_ERROR_INVALID_PARAMETER);
+
+    fresco_encoder_destroy(encoder);
+}
+
+TEST(FrescoMeshTest, MissingAndCorruptedTrack) {
+    std::vector<uint8_t> encoded = encode_mesh(make_torus(16, 8));
+
+    fresco_decoder_t* decoder = nullptr;
+    ASSERT_EQ(fresco_decoder_create(&decoder), FRESCO_OK);
+
+    fresco_mesh_t* decoded = nullptr;
+    std::vector<uint8_t> truncated(encoded.begin(), encoded.end() - 8);
+    EXPECT_NE(fresco_decoder_decode_mesh(decoder, truncated.data(), truncated.size(), &decoded),
+              FRESCO_OK);
+
+    // Flipped bytes must never crash the decoder
+    std::mt19937 gen(5);
+    for (int trial = 0; trial < 200; trial++) {
+        std::vector<uint8_t> damaged = encoded;
+        damaged[100 + gen() % (damaged.size() - 100)] ^= static_cast<uint8_t>(1 + gen() % 255);
+        if (fresco_decoder_decode_mesh(decoder, damaged.data(), damaged.size(), &decoded) ==
+            FRESCO_OK) {
+            fresco_free(decoded);
+        }
+    }
+
+    // A raster-only file has no 3D track
+    std::vector<uint8_t> raster(4 * 4 * 3, 7);
+    fresco_encoder_t* encoder = nullptr;
+    ASSERT_EQ(fresco_encoder_create(&encoder), FRESCO_OK);
+    uint8_t* output = nullptr;
+    size_t output_size = 0;
+    ASSERT_EQ(fresco_encoder_encode(encoder, raster.data(), raster.size(), &output, &output_size),
+              FRESCO_OK);
+    EXPECT_EQ(fresco_decoder_decode_mesh(decoder, output, output_size, &decoded),
+              FRESCO_ERROR_UNSUPPORTED_FORMAT);
+    fresco_free(output);
+    fresco_encoder_destroy(encoder);
+
+    fresco_decoder_destroy(decoder);
+}
+
+TEST(FrescoMeshTest, ProgressiveOctree) {
+    TestMesh torus = make_torus(128, 64);
+    std::vector<uint8_t> encoded = encode_mesh(torus, 85, 4);
+
+    fresco_decoder_t* decoder = nullptr;
+    ASSERT_EQ(fresco_decoder_create(&decoder), FRESCO_OK);
+
+    fresco_mesh_node_t* nodes = nullptr;
+    size_t node_count = 0;
+    ASSERT_EQ(fresco_decoder_get_mesh_nodes(decoder, encoded.data(), encoded.size(), &nodes,
+                                            &node_count),
+              FRESCO_OK);
+    ASSERT_GT(node_count, 1u);
+    EXPECT_EQ(nodes[0].level, 0u);
+    EXPECT_EQ(nodes[0].parent, UINT32_MAX);
+
+    // Children nest in their parent cube; leaves hold every input triangle
+    size_t leaf_triangles = 0;
+    for (size_t i = 0; i < node_count; i++) {
+        const fresco_mesh_node_t& node = nodes[i];
+        ASSERT_LT(node.level, 4u);
+        for (uint32_t c = node.first_child; c < node.first_child + node.child_count; c++) {
+            ASSERT_LT(c, node_count);
+            EXPECT_EQ(nodes[c].parent, i);
+            EXPECT_EQ(nodes[c].level, node.level + 1);
+            EXPECT_FLOAT_EQ(nodes[c].bounds_size, node.bounds_size / 2);
+            for (int k = 0; k < 3; k++) {
+                EXPECT_GE(nodes[c].bounds_min[k], node.bounds_min[k]);
+                EXPECT_LE(nodes[c].bounds_min[k] + nodes[c].bounds_size,
+                          node.bounds_min[k] + node.bounds_size * 1.0001f);
+            }
+        }
+        if (node.child_count == 0) {
+            EXPECT_EQ(node.level, 3u);
+            EXPECT_EQ(node.error, 0.0f);
+            leaf_triangles += node.triangle_count;
+        }
+    }
+    EXPECT_EQ(leaf_triangles, torus.indices.size() / 3);
+
+    // Coarser levels have fewer triangles, all within the level's error of
+    // the surface
+    size_t previous = 0;
+    for (uint32_t level = 0; level < 3; level++) {
+        fresco_mesh_t* lod = nullptr;
+        ASSERT_EQ(fresco_decoder_decode_mesh_lod(decoder, encoded.data(), encoded.size(), level,
+                                                 nullptr, nullptr, &lod),
+                  FRESCO_OK);
+        EXPECT_GT(lod->triangle_count, previous);
+        EXPECT_LE(lod->triangle_count, torus.indices.size() / 3);
+        if (level == 0) {
+            EXPECT_LT(lod->triangle_count, torus.indices.size() / 3 / 2);
+        }
+        ASSERT_NE(lod->normals, nullptr);
+        previous = lod->triangle_count;
+
+        float error = 0.0f;
+        for (size_t i = 0; i < node_count; i++) {
+            if (nodes[i].level == level) {
+                error = nodes[i].error;
+            }
+        }
+        for (size_t v = 0; v < lod->vertex_count; v++) {
+            const float* p = lod->positions + v * 3;
+            const float distance = std::hypot(std::hypot(p[0], p[1]) - 3.0f, p[2]) - 1.0f;
+            EXPECT_LE(std::fabs(distance), error);
+        }
+        fresco_free(lod);
+    }
+
+    // Full resolution: chunks share one position grid, so welding the
+    // repeated border vertices gives back the input surface
+    fresco_mesh_t* full = nullptr;
+    ASSERT_EQ(fresco_decoder_decode_mesh(decoder, encoded.data(), encoded.size(), &full),
+              FRESCO_OK);
+    TestMesh welded = weld(*full);
+    fresco_mesh_t welded_view = welded.view();
+    expect_same_surface(torus, welded_view, 8.0f / 16383.0f);
+    fresco_free(full);
+
+    // A region decodes only the nodes overlapping it
+    const float region_min[3] = {3.0f, -0.5f, -1.0f};
+    const float region_max[3] = {4.0f, 0.5f, 1.0f};
+    std::vector<uint32_t> expected_nodes;
+    size_t expected_triangles = 0;
+    for (uint32_t i = 0; i < node_count; i++) {
+        bool overlaps = nodes[i].level == 3;
+        for (int k = 0; k < 3; k++) {
+            overlaps = overlaps && nodes[i].bounds_min[k] <= region_max[k] &&
+                       nodes[i].bounds_min[k] + nodes[i].bounds_size >= region_min[k];
+        }
+        if (overlaps) {
+            expected_nodes.push_back(i);
+            expected_triangles += nodes[i].triangle_count;
+        }
+    }
+    fresco_mesh_t* region = nullptr;
+    ASSERT_EQ(fresco_decoder_decode_mesh_lod(decoder, encoded.data(), encoded.size(), 3,
+                                             region_min, region_max, &region),
+              FRESCO_OK);
+    EXPECT_EQ(region->triangle_count, expected_triangles);
+    EXPECT_LT(region->triangle_count, torus.indices.size() / 8);
+    fresco_free(region);
+
+    fresco_mesh_t* selected = nullptr;
+    ASSERT_EQ(fresco_decoder_decode_mesh_nodes(decoder, encoded.data(), encoded.size(),
+                                               expected_nodes.data(), expected_nodes.size(),
+                                               &selected),
+              FRESCO_OK);
+    EXPECT_EQ(selected->triangle_count, expected_triangles);
+    fresco_free(selected);
+
+    const uint32_t bad_node = static_cast<uint32_t>(node_count);
+    EXPECT_EQ(fresco_decoder_decode_mesh_nodes(decoder, encoded.data(), encoded.size(), &bad_node,
+                                               1, &selected),
+              FRESCO_ERROR_INVALID_PARAMETER);
+
+    fresco_free(nodes);
+    fresco_decoder_destroy(decoder);
+}
+
+TEST(FrescoMeshTest, ProgressivePointCloudAndCorruption) {
+    TestMesh cloud;
+    for (int v = 0; v < 500; v++) {
+        cloud.positions.insert(cloud.positions.end(), {std::cos(v * 0.1f) * v, std::sin(v * 0.1f) * v,
+                                                       v * 0.01f});
+    }
+    std::vector<uint8_t> encoded = encode_mesh(cloud, 85, 3);
+
+    fresco_decoder_t* decoder = nullptr;
+    ASSERT_EQ(fresco_decoder_create(&decoder), FRESCO_OK);
+    fresco_mesh_t* decoded = nullptr;
+    ASSERT_EQ(fresco_decoder_decode_mesh(decoder, encoded.data(), encoded.size(), &decoded),
+              FRESCO_OK);
+    EXPECT_EQ(decoded->vertex_count, 500u);
+    fresco_free(decoded);
+    ASSERT_EQ(fresco_decoder_decode_mesh_lod(decoder, encoded.data(), encoded.size(), 0, nullptr,
+                                             nullptr, &decoded),
+              FRESCO_OK);
+    EXPECT_GT(decoded->vertex_count, 0u);
+    EXPECT_LT(decoded->vertex_count, 500u);
+    fresco_free(decoded);
+
+    // Damaged index or chunks must never crash the decoder
+    std::vector<uint8_t> torus = encode_mesh(make_torus(32, 16), 85, 3);
+    std::mt19937 gen(11);
+    for (int trial = 0; trial < 300; trial++) {
+        std::vector<uint8_t> damaged = torus;
+        damaged[100 + gen() % (damaged.size() - 100)] ^= static_cast<uint8_t>(1 + gen() % 255);
+        fresco_mesh_node_t* nodes = nullptr;
+        size_t node_count = 0;
+        if (fresco_decoder_get_mesh_nodes(decoder, damaged.data(), damaged.size(), &nodes,
+                                          &node_count) == FRESCO_OK) {
+            fresco_free(nodes);
+        }
+        if (fresco_decoder_decode_mesh(decoder, damaged.data(), damaged.size(), &decoded) ==
+            FRESCO_OK) {
+            fresco_free(decoded);
+        }
+    }
+
+    fresco_encoder_t* encoder = nullptr;
+    ASSERT_EQ(fresco_encoder_create(&encoder), FRESCO_OK);
+    fresco_encode_params_t params = {};
+    params.quality = 85;
+    params.effort = 5;
+    params.mesh_lod_levels = 9;
+    EXPECT_EQ(fresco_encoder_set_params(encoder, &params), FRESCO_ERROR_INVALID_PARAMETER);
+    fresco_encoder_destroy(encoder);
+
+    fresco_decoder_destroy(decoder);
+}
@@ -0,0 +1,1140 @@
+/**
+ * @file test_raster.cpp
+ * @brief Unit tests for the FRESCO raster track
+ * @author Mehmet T. AKALIN
+ * @date 2025
+ * @license MIT
+ */
+
+#include "fresco/fresco.h"
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <map>
+#include <mutex>
+#include <poll.h>
+#include <random>
+#include <string>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+namespace {
+
+// Smooth shading, a hard-edged checker and mild noise: something between a
+// photo and a screenshot
+std::vector<uint8_t> make_image(uint32_t size) {
+    std::vector<uint8_t> image(static_cast<size_t>(size) * size * 3);
+    std::mt19937 rng(7);
+    std::uniform_int_distribution<int> noise(-4, 4);
+    auto clamp = [](double v) { return static_cast<uint8_t>(v < 0 ? 0 : (v > 255 ? 255 : v)); };
+    for (uint32_t y = 0; y < size; y++) {
+        for (uint32_t x = 0; x < size; x++) {
+            uint8_t* p = &image[(static_cast<size_t>(y) * size + x) * 3];
+            const double checker = ((x / 24 + y / 24) % 2) * 50.0;
+            p[0] = clamp(120 + 70 * std::sin(x * 0.03) * std::cos(y * 0.02) + noise(rng));
+            p[1] = clamp(60 + checker + 40 * std::sin((x + y) * 0.01) + noise(rng));
+            p[2] = clamp(40 + 0.5 * x + noise(rng));
+        }
+    }
+    return image;
+}
+
+struct Encoded {
+    fresco_error_t result = FRESCO_OK;
+    std::vector<uint8_t> data;
+};
+
+Encoded encode(const std::vector<uint8_t>& image, const fresco_encode_params_t& params) {
+    Encoded encoded;
+    fresco_encoder_t* encoder = nullptr;
+    EXPECT_EQ(fresco_encoder_create(&encoder), FRESCO_OK);
+    encoded.result = fresco_encoder_set_params(encoder, &params);
+    if (encoded.result == FRESCO_OK) {
+        uint8_t* output = nullptr;
+        size_t output_size = 0;
+        encoded.result = fresco_encoder_encode(encoder, image.data(), image.size(), &output,
+                                               &output_size);
+        if (encoded.result == FRESCO_OK) {
+            encoded.data.assign(output, output + output_size);
+            fresco_free(output);
+        }
+    }
+    fresco_encoder_destroy(encoder);
+    return encoded;
+}
+
+fresco_encode_params_t lossy_params(uint8_t quality) {
+    fresco_encode_params_t params = {};
+    params.mode = FRESCO_COMPRESSION_LOSSY;
+    params.quality = quality;
+    params.effort = 5;
+    params.tile_size = 128;
+    return params;
+}
+
+std::vector<uint8_t> decode(const std::vector<uint8_t>& encoded, uint32_t threads = 0) {
+    fresco_decoder_t* decoder = nullptr;
+    EXPECT_EQ(fresco_decoder_create(&decoder), FRESCO_OK);
+    fresco_decode_params_t params = {};
+    params.max_threads = threads;
+    EXPECT_EQ(fresco_decoder_set_params(decoder, &params), FRESCO_OK);
+    uint8_t* output = nullptr;
+    size_t output_size = 0;
+    EXPECT_EQ(fresco_decoder_decode(decoder, encoded.data(), encoded.size(), &output,
+                                    &output_size), FRESCO_OK);
+    std::vector<uint8_t> pixels(output, output + output_size);
+    fresco_free(output);
+    fresco_decoder_destroy(decoder);
+    return pixels;
+}
+
+double psnr(const std::vector<uint8_t>& a, const std::vector<uint8_t>& b) {
+    double error = 0.0;
+    for (size_t i = 0; i < a.size(); i++) {
+        const double d = static_cast<double>(a[i]) - b[i];
+        error += d * d;
+    }
+    error /= static_cast<double>(a.size());
+    return error == 0.0 ? 99.0 : 10.0 * std::log10(255.0 * 255.0 / error);
+}
+
+} // namespace
+
+TEST(FrescoRasterTest, LosslessIsExactAcrossPartialTiles) {
+    // 200 is not a multiple of the tile size, so edge tiles are partial
+    const std::vector<uint8_t> image = make_image(200);
+    fresco_encode_params_t params = lossy_params(85);
+    params.mode = FRESCO_COMPRESSION_LOSSLESS;
+    params.tile_size = 64;
+    Encoded encoded = encode(image, params);
+    ASSERT_EQ(encoded.result, FRESCO_OK);
+    EXPECT_LT(encoded.data.size(), image.size());
+
+    EXPECT_EQ(decode(encoded.data, 1), image);
+    EXPECT_EQ(decode(encoded.data, 4), image);
+}
+
+TEST(FrescoRasterTest, LossyQualityTradesSizeForError) {
+    const std::vector<uint8_t> image = make_image(256);
+    size_t previous_size = 0;
+    double previous_psnr = 0.0;
+    for (uint8_t quality : {30, 60, 85, 100}) {
+        Encoded encoded = encode(image, lossy_params(quality));
+        ASSERT_EQ(encoded.result, FRESCO_OK);
+        const double quality_psnr = psnr(image, decode(encoded.data));
+        EXPECT_GT(encoded.data.size(), previous_size) << "quality " << int(quality);
+        EXPECT_GT(quality_psnr, previous_psnr) << "quality " << int(quality);
+        previous_size = encoded.data.size();
+        previous_psnr = quality_psnr;
+    }
+    // The default quality should look clean
+    EXPECT_GT(psnr(image, decode(encode(image, lossy_params(85)).data)), 38.0);
+}
+
+TEST(FrescoRasterTest, EveryEffortLevelRoundTrips) {
+    const std::vector<uint8_t> image = make_image(200);
+    size_t fastest_size = 0;
+    for (uint8_t effort = 1; effort <= 10; effort++) {
+        fresco_encode_params_t params = lossy_params(85);
+        params.effort = effort;
+        params.tile_size = 0;
+        Encoded lossy = encode(image, params);
+        ASSERT_EQ(lossy.result, FRESCO_OK) << "effort " << int(effort);
+        EXPECT_GT(psnr(image, decode(lossy.data)), 38.0) << "effort " << int(effort);
+        if (effort == 1) {
+            fastest_size = lossy.data.size();
+        } else {
+            // Only the real-time path gives up the adaptive coder
+            EXPECT_LT(lossy.data.size(), fastest_size) << "effort " << int(effort);
+        }
+
+        params.mode = FRESCO_COMPRESSION_LOSSLESS;
+        Encoded lossless = encode(image, params);
+        ASSERT_EQ(lossless.result, FRESCO_OK) << "effort " << int(effort);
+        EXPECT_EQ(decode(lossless.data), image) << "effort " << int(effort);
+    }
+}
+
+TEST(FrescoRasterTest, TargetBytesIsMetAndUsed) {
+    const std::vector<uint8_t> image = make_image(256);
+    for (uint64_t target : {3000u, 12000u, 40000u}) {
+        fresco_encode_params_t params = lossy_params(85);
+        params.target_bytes = target;
+        Encoded encoded = encode(image, params);
+        ASSERT_EQ(encoded.result, FRESCO_OK);
+        EXPECT_LE(encoded.data.size(), target);
+        EXPECT_GE(encoded.data.size(), target * 9 / 10);
+        EXPECT_GT(psnr(image, decode(encoded.data)), 24.0);
+    }
+}
+
+TEST(FrescoRasterTest, TargetBppAndTighterTargetWins) {
+    const std::vector<uint8_t> image = make_image(256);
+    fresco_encode_params_t params = lossy_params(85);
+    params.target_bpp = 0.5f;
+    Encoded by_bpp = encode(image, params);
+    ASSERT_EQ(by_bpp.result, FRESCO_OK);
+    EXPECT_LE(by_bpp.data.size(), 256u * 256u / 16u);
+
+    params.target_bytes = 2000;
+    Encoded tighter = encode(image, params);
+    ASSERT_EQ(tighter.result, FRESCO_OK);
+    EXPECT_LE(tighter.data.size(), 2000u);
+}
+
+TEST(FrescoRasterTest, TargetValidation) {
+    const std::vector<uint8_t> image = make_image(64);
+    fresco_encode_params_t params = lossy_params(85);
+    params.mode = FRESCO_COMPRESSION_LOSSLESS;
+    params.target_bytes = 1000;
+    EXPECT_EQ(encode(image, params).result, FRESCO_ERROR_INVALID_PARAMETER);
+
+    params = lossy_params(85);
+    params.target_bpp = -1.0f;
+    EXPECT_EQ(encode(image, params).result, FRESCO_ERROR_INVALID_PARAMETER);
+    params.target_bpp = NAN;
+    EXPECT_EQ(encode(image, params).result, FRESCO_ERROR_INVALID_PARAMETER);
+
+    // Smaller than the container itself
+    params = lossy_params(85);
+    params.target_bytes = 64;
+    EXPECT_EQ(encode(image, params).result, FRESCO_ERROR_ENCODING_FAILED);
+}
+
+TEST(FrescoRasterTest, RejectsNonSquareRawInput) {
+    std::vector<uint8_t> image(20 * 10 * 3, 128);
+    EXPECT_EQ(encode(image, lossy_params(85)).result, FRESCO_ERROR_UNSUPPORTED_FORMAT);
+}
+
+TEST(FrescoRasterTest, TruncatedFileIsRejected) {
+    const std::vector<uint8_t> image = make_image(128);
+    Encoded encoded = encode(image, lossy_params(85));
+    ASSERT_EQ(encoded.result, FRESCO_OK);
+    std::vector<uint8_t> truncated(encoded.data.begin(), encoded.data.end() - 16);
+
+    fresco_decoder_t* decoder = nullptr;
+    ASSERT_EQ(fresco_decoder_create(&decoder), FRESCO_OK);
+    uint8_t* output = nullptr;
+    size_t output_size = 0;
+    EXPECT_NE(fresco_decoder_decode(decoder, truncated.data(), truncated.size(), &output,
+                                    &output_size), FRESCO_OK);
+    fresco_decoder_destroy(decoder);
+}
+
+TEST(FrescoRasterTest, StatsReportStagesAndSizes) {
+    const std::vector<uint8_t> image = make_image(200);
+    fresco_encoder_t* encoder = nullptr;
+    ASSERT_EQ(fresco_encoder_create(&encoder), FRESCO_OK);
+    fresco_encode_params_t params = lossy_params(85);
+    ASSERT_EQ(fresco_encoder_set_params(encoder, &params), FRESCO_OK);
+    uint8_t* output = nullptr;
+    size_t output_size = 0;
+    ASSERT_EQ(fresco_encoder_encode(encoder, image.data(), image.size(), &output, &output_size),
+              FRESCO_OK);
+    std::vector<uint8_t> encoded(output, output + output_size);
+    fresco_free(output);
+
+    fresco_stats_t stats = {};
+    ASSERT_EQ(fresco_encoder_get_stats(encoder, &stats), FRESCO_OK);
+    EXPECT_EQ(fresco_encoder_get_stats(encoder, nullptr), FRESCO_ERROR_INVALID_PARAMETER);
+    fresco_encoder_destroy(encoder);
+    EXPECT_GT(stats.total_ns, 0u);
+    EXPECT_GT(stats.transform_ns, 0u);
+    EXPECT_GT(stats.entropy_ns, 0u);
+    EXPECT_GT(stats.raster_bytes, 0u);
+    EXPECT_LT(stats.raster_bytes, encoded.size());
+    EXPECT_EQ(stats.vector_bytes, 0u);
+    EXPECT_GE(stats.tiles, 4u);  // 200x200 at 128x128 tiles
+    EXPECT_GE(stats.threads, 1u);
+    EXPECT_GT(stats.peak_scratch_bytes, 0u);
+
+    fresco_decoder_t* decoder = nullptr;
+    ASSERT_EQ(fresco_decoder_create(&decoder), FRESCO_OK);
+    ASSERT_EQ(fresco_decoder_decode(decoder, encoded.data(), encoded.size(), &output,
+                                    &output_size), FRESCO_OK);
+    fresco_free(output);
+    fresco_stats_t decoded = {};
+    ASSERT_EQ(fresco_decoder_get_stats(decoder, &decoded), FRESCO_OK);
+    fresco_decoder_destroy(decoder);
+    EXPECT_GT(decoded.total_ns, 0u);
+    EXPECT_GT(decoded.parse_ns + decoded.container_ns, 0u);
+    EXPECT_GT(decoded.entropy_ns, 0u);
+    EXPECT_EQ(decoded.raster_bytes, stats.raster_bytes);
+    EXPECT_EQ(decoded.tiles, 4u);
+    EXPECT_GT(decoded.peak_scratch_bytes, 0u);
+}
+
+void collect_trace_event(const char* event, size_t length, void* user_data) {
+    static_cast<std::vector<std::string>*>(user_data)->emplace_back(event, length);
+}
+
+TEST(FrescoRasterTest, TraceSinkReceivesTileAndStageEvents) {
+    std::vector<std::string> events;
+    const fresco_error_t result = fresco_set_trace_sink(collect_trace_event, &events);
+    if (result == FRESCO_ERROR_NOT_IMPLEMENTED) {
+        GTEST_SKIP() << "built without tracing";
+    }
+    ASSERT_EQ(result, FRESCO_OK);
+    fresco_encode_params_t params = lossy_params(85);
+    params.tile_size = 64;
+    params.max_threads = 2;
+    Encoded encoded = encode(make_image(128), params);
+    ASSERT_EQ(fresco_set_trace_sink(nullptr, nullptr), FRESCO_OK);
+    ASSERT_EQ(encoded.result, FRESCO_OK);
+
+    size_t tiles = 0;
+    size_t entropy = 0;
+    size_t calls = 0;
+    for (const std::string& event : events) {
+        ASSERT_EQ(event.front(), '{');
+        ASSERT_EQ(event.back(), '}');
+        EXPECT_NE(event.find("\"ph\":\"X\""), std::string::npos);
+        tiles += event.find("\"name\":\"tile\"") != std::string::npos;
+        entropy += event.find("\"name\":\"entropy\"") != std::string::npos;
+        calls += event.find("\"name\":\"encode\"") != std::string::npos;
+    }
+    EXPECT_EQ(tiles, 4u);
+    EXPECT_GE(entropy, 4u);
+    EXPECT_EQ(calls, 1u);
+
+    // A cleared sink is not called any more
+    const size_t count = events.size();
+    decode(encoded.data);
+    EXPECT_EQ(events.size(), count);
+}
+
+TEST(FrescoRasterTest, CountersAccumulateAcrossCalls) {
+    fresco_counters_t before = {};
+    ASSERT_EQ(fresco_get_counters(&before), FRESCO_OK);
+    const std::vector<uint8_t> image = make_image(128);
+    Encoded encoded = encode(image, lossy_params(85));
+    ASSERT_EQ(encoded.result, FRESCO_OK);
+    const std::vector<uint8_t> decoded = decode(encoded.data, 2);
+    const std::vector<uint8_t> garbage(64, 0x5a);
+    fresco_decoder_t* decoder = nullptr;
+    ASSERT_EQ(fresco_decoder_create(&decoder), FRESCO_OK);
+    uint8_t* output = nullptr;
+    size_t output_size = 0;
+    EXPECT_NE(fresco_decoder_decode(decoder, garbage.data(), garbage.size(), &output,
+                                    &output_size), FRESCO_OK);
+    fresco_decoder_destroy(decoder);
+
+    fresco_counters_t after = {};
+    ASSERT_EQ(fresco_get_counters(&after), FRESCO_OK);
+    EXPECT_EQ(after.images_encoded - before.images_encoded, 1u);
+    EXPECT_EQ(after.images_decoded - before.images_decoded, 1u);
+    EXPECT_EQ(after.decode_errors - before.decode_errors, 1u);
+    EXPECT_EQ(after.encode_bytes_in - before.encode_bytes_in, image.size());
+    EXPECT_EQ(after.encode_bytes_out - before.encode_bytes_out, encoded.data.size());
+    EXPECT_EQ(after.decode_bytes_in - before.decode_bytes_in, encoded.data.size());
+    EXPECT_EQ(after.decode_bytes_out - before.decode_bytes_out, decoded.size());
+    EXPECT_GT(after.entropy_ns, before.entropy_ns);
+    EXPECT_GE(after.allocations - before.allocations, 2u);
+    EXPECT_EQ(after.queue_depth, 0u);
+
+    char* text = nullptr;
+    size_t length = 0;
+    ASSERT_EQ(fresco_format_counters_prometheus(&after, &text, &length), FRESCO_OK);
+    const std::string prometheus(text, length);
+    fresco_free(text);
+    EXPECT_NE(prometheus.find("# TYPE fresco_images_total counter\n"), std::string::npos);
+    EXPECT_NE(prometheus.find("fresco_images_total{operation=\"encode\"} " +
+                              std::to_string(after.images_encoded) + "\n"),
+              std::string::npos);
+    EXPECT_NE(prometheus.find("fresco_stage_seconds_total{stage=\"entropy\"} "),
+              std::string::npos);
+    EXPECT_NE(prometheus.find("fresco_queue_depth 0\n"), std::string::npos);
+}
+
+TEST(FrescoRasterTest, MemoryBudgetFallsBackToStripMode) {
+    const std::vector<uint8_t> image = make_image(512);
+    fresco_encode_params_t params = lossy_params(85);
+    params.target_bytes = 20000;
+    Encoded unlimited = encode(image, params);
+    ASSERT_EQ(unlimited.result, FRESCO_OK);
+
+    // Every tile's coefficients take 3 MiB; 1.5 MB leaves room for two
+    // workers only, so the tiles are transformed again on each pass
+    params.max_memory_bytes = 1500000;
+    fresco_encoder_t* encoder = nullptr;
+    ASSERT_EQ(fresco_encoder_create(&encoder), FRESCO_OK);
+    ASSERT_EQ(fresco_encoder_set_params(encoder, &params), FRESCO_OK);
+    uint8_t* output = nullptr;
+    size_t output_size = 0;
+    ASSERT_EQ(fresco_encoder_encode(encoder, image.data(), image.size(), &output, &output_size),
+              FRESCO_OK);
+    const std::vector<uint8_t> strip(output, output + output_size);
+    fresco_free(output);
+    fresco_stats_t stats = {};
+    ASSERT_EQ(fresco_encoder_get_stats(encoder, &stats), FRESCO_OK);
+    fresco_encoder_destroy(encoder);
+    EXPECT_EQ(strip, unlimited.data);
+    EXPECT_LE(stats.peak_scratch_bytes, params.max_memory_bytes);
+
+    params.max_memory_bytes = 100000;
+    EXPECT_EQ(encode(image, params).result, FRESCO_ERROR_OUT_OF_MEMORY);
+}
+
+TEST(FrescoRasterTest, DecodeMemoryBudgetCoversOutput) {
+    const std::vector<uint8_t> image = make_image(256);
+    Encoded encoded = encode(image, lossy_params(85));
+    ASSERT_EQ(encoded.result, FRESCO_OK);
+    const std::vector<uint8_t> expected = decode(encoded.data);
+
+    fresco_decoder_t* decoder = nullptr;
+    ASSERT_EQ(fresco_decoder_create(&decoder), FRESCO_OK);
+    fresco_decode_params_t params = {};
+    uint8_t* output = nullptr;
+    size_t output_size = 0;
+
+    // The output alone fills the budget
+    params.max_memory_bytes = image.size();
+    ASSERT_EQ(fresco_decoder_set_params(decoder, &params), FRESCO_OK);
+    EXPECT_EQ(fresco_decoder_decode(decoder, encoded.data.data(), encoded.data.size(), &output,
+                                    &output_size), FRESCO_ERROR_OUT_OF_MEMORY);
+
+    // Room for the output and one 128x128 tile worker
+    params.max_memory_bytes = image.size() + 128 * 128 * (3 * 12 + 1) + 4096;
+    ASSERT_EQ(fresco_decoder_set_params(decoder, &params), FRESCO_OK);
+    ASSERT_EQ(fresco_decoder_decode(decoder, encoded.data.data(), encoded.data.size(), &output,
+                                    &output_size), FRESCO_OK);
+    EXPECT_EQ(std::vector<uint8_t>(output, output + output_size), expected);
+    fresco_free(output);
+    fresco_stats_t stats = {};
+    ASSERT_EQ(fresco_decoder_get_stats(decoder, &stats), FRESCO_OK);
+    EXPECT_EQ(stats.threads, 1u);
+    EXPECT_LE(stats.peak_scratch_bytes + image.size(), params.max_memory_bytes);
+    fresco_decoder_destroy(decoder);
+}
+
+namespace {
+
+void write_bytes(const std::string& path, const std::vector<uint8_t>& data) {
+    FILE* file = std::fopen(path.c_str(), "wb");
+    ASSERT_NE(file, nullptr);
+    ASSERT_EQ(std::fwrite(data.data(), 1, data.size(), file), data.size());
+    std::fclose(file);
+}
+
+void expect_same_metadata(const fresco_metadata_t& a, const fresco_metadata_t& b) {
+    EXPECT_EQ(a.width, b.width);
+    EXPECT_EQ(a.height, b.height);
+    EXPECT_EQ(a.channels, b.channels);
+    EXPECT_EQ(a.bit_depth, b.bit_depth);
+    EXPECT_EQ(a.colorspace, b.colorspace);
+    EXPECT_EQ(a.frame_count, b.frame_count);
+    EXPECT_EQ(a.file_size, b.file_size);
+    EXPECT_EQ(a.compressed_size, b.compressed_size);
+}
+
+} // namespace
+
+TEST(FrescoRasterTest, ProbeReadsOnlyHeaderBoxes) {
+    fresco_encode_params_t params = lossy_params(85);
+    params.mode = FRESCO_COMPRESSION_LOSSLESS;
+    params.tile_size = 128;
+    Encoded encoded = encode(make_image(256), params);
+    ASSERT_EQ(encoded.result, FRESCO_OK);
+    fresco_metadata_t expected = {};
+    ASSERT_EQ(fresco_get_metadata(encoded.data.data(), encoded.data.size(), &expected),
+              FRESCO_OK);
+
+    const std::string path = ::testing::TempDir() + "fresco_probe.fresco";
+    write_bytes(path, encoded.data);
+    fresco_metadata_t metadata = {};
+    ASSERT_EQ(fresco_probe_path(path.c_str(), &metadata), FRESCO_OK);
+    expect_same_metadata(metadata, expected);
+
+    const int fd = ::open(path.c_str(), O_RDONLY);
+    ASSERT_GE(fd, 0);
+    metadata = {};
+    ASSERT_EQ(fresco_probe_fd(fd, &metadata), FRESCO_OK);
+    expect_same_metadata(metadata, expected);
+    EXPECT_EQ(::lseek(fd, 0, SEEK_CUR), 0);
+    ::close(fd);
+
+    // moov after the payload, well past the first read
+    std::vector<uint8_t> moov, rest;
+    for (size_t offset = 0; offset + 8 <= encoded.data.size();) {
+        const size_t size = (static_cast<size_t>(encoded.data[offset]) << 24) |
+                            (encoded.data[offset + 1] << 16) | (encoded.data[offset + 2] << 8) |
+                            encoded.data[offset + 3];
+        ASSERT_GE(size, 8u);
+        ASSERT_LE(offset + size, encoded.data.size());
+        auto& target = std::memcmp(&encoded.data[offset + 4], "moov", 4) ? rest : moov;
+        target.insert(target.end(), encoded.data.begin() + offset,
+                      encoded.data.begin() + offset + size);
+        offset += size;
+    }
+    ASSERT_FALSE(moov.empty());
+    ASSERT_GT(rest.size(), 4096u);
+    rest.insert(rest.end(), moov.begin(), moov.end());
+    write_bytes(path, rest);
+    metadata = {};
+    ASSERT_EQ(fresco_probe_path(path.c_str(), &metadata), FRESCO_OK);
+    expect_same_metadata(metadata, expected);
+
+    write_bytes(path, std::vector<uint8_t>(64, 0x42));
+    EXPECT_EQ(fresco_probe_path(path.c_str(), &metadata), FRESCO_ERROR_UNSUPPORTED_FORMAT);
+    std::remove(path.c_str());
+    EXPECT_EQ(fresco_probe_path(path.c_str(), &metadata), FRESCO_ERROR_IO);
+    EXPECT_EQ(fresco_probe_path(nullptr, &metadata), FRESCO_ERROR_INVALID_PARAMETER);
+}
+
+TEST(FrescoRasterTest, StridedImagesNeedNoCopy) {
+    const uint32_t size = 160;
+    const std::vector<uint8_t> image = make_image(size);
+    fresco_encode_params_t params = lossy_params(85);
+    params.mode = FRESCO_COMPRESSION_LOSSLESS;
+    Encoded packed = encode(image, params);
+    ASSERT_EQ(packed.result, FRESCO_OK);
+
+    // The same image as a crop of a wider one
+    const size_t row_bytes = size * 3;
+    const size_t stride = row_bytes + 37;
+    std::vector<uint8_t> wide(stride * size, 0xee);
+    for (uint32_t y = 0; y < size; y++) {
+        std::memcpy(&wide[y * stride], &image[y * row_bytes], row_bytes);
+    }
+    fresco_encoder_t* encoder = nullptr;
+    ASSERT_EQ(fresco_encoder_create(&encoder), FRESCO_OK);
+    ASSERT_EQ(fresco_encoder_set_params(encoder, &params), FRESCO_OK);
+    fresco_image_t view = {wide.data(), size, size, 3, stride};
+    uint8_t* output = nullptr;
+    size_t output_size = 0;
+    ASSERT_EQ(fresco_encoder_encode_image(encoder, &view, &output, &output_size), FRESCO_OK);
+    EXPECT_EQ(std::vector<uint8_t>(output, output + output_size), packed.data);
+    fresco_free(output);
+    view.row_stride = row_bytes - 1;
+    EXPECT_EQ(fresco_encoder_encode_image(encoder, &view, &output, &output_size),
+              FRESCO_ERROR_INVALID_PARAMETER);
+    fresco_encoder_destroy(encoder);
+
+    fresco_decoder_t* decoder = nullptr;
+    ASSERT_EQ(fresco_decoder_create(&decoder), FRESCO_OK);
+    std::vector<uint8_t> decoded(stride * size, 0x11);
+    EXPECT_EQ(fresco_decoder_decode_into(decoder, packed.data.data(), packed.data.size(),
+                                         decoded.data(), stride, decoded.size() - 40),
+              FRESCO_ERROR_INVALID_PARAMETER);
+    ASSERT_EQ(fresco_decoder_decode_into(decoder, packed.data.data(), packed.data.size(),
+                                         decoded.data(), stride, decoded.size()),
+              FRESCO_OK);
+    for (uint32_t y = 0; y < size; y++) {
+        ASSERT_EQ(std::memcmp(&decoded[y * stride], &image[y * row_bytes], row_bytes), 0);
+        EXPECT_EQ(decoded[y * stride + row_bytes], 0x11);
+    }
+    fresco_decoder_destroy(decoder);
+}
+
+namespace {
+
+struct CallbackResult {
+    std::atomic<int> calls{0};
+    fresco_error_t result = FRESCO_ERROR_NOT_IMPLEMENTED;
+    std::vector<uint8_t> output;
+};
+
+void keep_completion(const fresco_completion_t* completion) {
+    auto* received = static_cast<CallbackResult*>(completion->user_data);
+    received->result = completion->result;
+    received->output.assign(completion->output_data,
+                            completion->output_data + completion->output_size);
+    fresco_free(completion->output_data);
+    received->calls++;
+}
+
+} // namespace
+
+TEST(FrescoRasterTest, AsyncCallsCompleteThroughQueueAndCallback) {
+    const std::vector<uint8_t> image = make_image(128);
+    const fresco_encode_params_t params = lossy_params(85);
+    Encoded expected = encode(image, params);
+    ASSERT_EQ(expected.result, FRESCO_OK);
+
+    fresco_completion_queue_t* queue = nullptr;
+    ASSERT_EQ(fresco_completion_queue_create(&queue), FRESCO_OK);
+    const int fd = fresco_completion_queue_fd(queue);
+    ASSERT_GE(fd, 0);
+
+    // Two handles feed one queue
+    fresco_encoder_t* encoders[2] = {};
+    for (auto& encoder : encoders) {
+        ASSERT_EQ(fresco_encoder_create(&encoder), FRESCO_OK);
+        ASSERT_EQ(fresco_encoder_set_params(encoder, &params), FRESCO_OK);
+    }
+    EXPECT_EQ(fresco_encoder_encode_async(encoders[0], image.data(), image.size(), nullptr,
+                                          nullptr, nullptr),
+              FRESCO_ERROR_INVALID_PARAMETER);
+    int tags[4] = {0, 1, 2, 3};
+    for (int i = 0; i < 4; i++) {
+        ASSERT_EQ(fresco_encoder_encode_async(encoders[i % 2], image.data(), image.size(),
+                                              nullptr, queue, &tags[i]),
+                  FRESCO_OK);
+    }
+
+    std::vector<int> seen;
+    while (seen.size() < 4) {
+        pollfd ready = {fd, POLLIN, 0};
+        ASSERT_EQ(::poll(&ready, 1, 10000), 1);
+        fresco_completion_t completions[4];
+        size_t count = 0;
+        ASSERT_EQ(fresco_completion_queue_poll(queue, completions, 4, &count), FRESCO_OK);
+        for (size_t i = 0; i < count; i++) {
+            EXPECT_EQ(completions[i].result, FRESCO_OK);
+            EXPECT_EQ(std::vector<uint8_t>(completions[i].output_data,
+                                           completions[i].output_data +
+                                               completions[i].output_size),
+                      expected.data);
+            fresco_free(completions[i].output_data);
+            seen.push_back(*static_cast<int*>(completions[i].user_data));
+        }
+    }
+    std::sort(seen.begin(), seen.end());
+    EXPECT_EQ(seen, std::vector<int>({0, 1, 2, 3}));
+    pollfd drained = {fd, POLLIN, 0};
+    EXPECT_EQ(::poll(&drained, 1, 0), 0);
+    for (auto& encoder : encoders) {
+        fresco_encoder_destroy(encoder);
+    }
+    fresco_completion_queue_destroy(queue);
+
+    // Destroying the handle waits for the callback
+    const std::vector<uint8_t> truncated(expected.data.begin(), expected.data.begin() + 40);
+    CallbackResult decoded, failed;
+    fresco_decoder_t* decoder = nullptr;
+    ASSERT_EQ(fresco_decoder_create(&decoder), FRESCO_OK);
+    ASSERT_EQ(fresco_decoder_decode_async(decoder, expected.data.data(), expected.data.size(),
+                                          keep_completion, nullptr, &decoded),
+              FRESCO_OK);
+    ASSERT_EQ(fresco_decoder_decode_async(decoder, truncated.data(), truncated.size(),
+                                          keep_completion, nullptr, &failed),
+              FRESCO_OK);
+    fresco_decoder_destroy(decoder);
+    EXPECT_EQ(decoded.calls, 1);
+    EXPECT_EQ(decoded.result, FRESCO_OK);
+    EXPECT_EQ(decoded.output, decode(expected.data));
+    EXPECT_EQ(failed.calls, 1);
+    EXPECT_NE(failed.result, FRESCO_OK);
+    EXPECT_TRUE(failed.output.empty());
+}
+
+TEST(FrescoRasterTest, ThreadPoolIsSharedByConcurrentHandles) {
+    const std::vector<uint8_t> image = make_image(256);
+    fresco_encode_params_t params = lossy_params(85);
+    params.tile_size = 64;
+    Encoded expected = encode(image, params);
+    ASSERT_EQ(expected.result, FRESCO_OK);
+    const std::vector<uint8_t> expected_pixels = decode(expected.data);
+
+    fresco_thread_pool_t* pool = nullptr;
+    ASSERT_EQ(fresco_thread_pool_create(3, &pool), FRESCO_OK);
+    EXPECT_EQ(fresco_thread_pool_size(pool), 3u);
+
+    // More handles than pool threads, each coding several images at once
+    std::atomic<int> mismatches{0};
+    std::vector<std::thread> callers;
+    for (int t = 0; t < 4; t++) {
+        callers.emplace_back([&]() {
+            fresco_encoder_t* encoder = nullptr;
+            fresco_decoder_t* decoder = nullptr;
+            fresco_encoder_create(&encoder);
+            fresco_decoder_create(&decoder);
+            fresco_encoder_set_params(encoder, &params);
+            fresco_encoder_set_thread_pool(encoder, pool);
+            fresco_decoder_set_thread_pool(decoder, pool);
+            for (int i = 0; i < 3; i++) {
+                uint8_t* output = nullptr;
+                size_t output_size = 0;
+                if (fresco_encoder_encode(encoder, image.data(), image.size(), &output,
+                                          &output_size) != FRESCO_OK ||
+                    std::vector<uint8_t>(output, output + output_size) != expected.data) {
+                    mismatches++;
+                }
+                fresco_free(output);
+                output = nullptr;
+                if (fresco_decoder_decode(decoder, expected.data.data(), expected.data.size(),
+                                          &output, &output_size) != FRESCO_OK ||
+                    std::vector<uint8_t>(output, output + output_size) != expected_pixels) {
+                    mismatches++;
+                }
+                fresco_free(output);
+            }
+            fresco_stats_t stats = {};
+            fresco_decoder_get_stats(decoder, &stats);
+            if (stats.threads != 3) {
+                mismatches++;
+            }
+            fresco_decoder_destroy(decoder);
+            fresco_encoder_destroy(encoder);
+        });
+    }
+    for (auto& caller : callers) {
+        caller.join();
+    }
+    EXPECT_EQ(mismatches, 0);
+    fresco_thread_pool_destroy(pool);
+}
+
+TEST(FrescoRasterTest, ThreadPoolsStartAndStopCleanly) {
+    const std::vector<uint8_t> image = make_image(64);
+    fresco_encode_params_t params = lossy_params(85);
+    params.tile_size = 32;
+    Encoded encoded = encode(image, params);
+    ASSERT_EQ(encoded.result, FRESCO_OK);
+    const std::vector<uint8_t> expected = decode(encoded.data);
+
+    // Workers look for tasks while later ones are still being started, and
+    // a pool may be torn down right after; run under TSan to catch races
+    for (int i = 0; i < 50; i++) {
+        fresco_thread_pool_t* pool = nullptr;
+        ASSERT_EQ(fresco_thread_pool_create(4, &pool), FRESCO_OK);
+        EXPECT_EQ(fresco_thread_pool_size(pool), 4u);
+        if (i % 5 == 0) {
+            fresco_decoder_t* decoder = nullptr;
+            ASSERT_EQ(fresco_decoder_create(&decoder), FRESCO_OK);
+            fresco_decoder_set_thread_pool(decoder, pool);
+            uint8_t* output = nullptr;
+            size_t output_size = 0;
+            EXPECT_EQ(fresco_decoder_decode(decoder, encoded.data.data(), encoded.data.size(),
+                                            &output, &output_size),
+                      FRESCO_OK);
+            EXPECT_EQ(std::vector<uint8_t>(output, output + output_size), expected);
+            fresco_free(output);
+            fresco_decoder_destroy(decoder);
+        }
+        fresco_thread_pool_destroy(pool);
+    }
+}
+
+TEST(FrescoRasterTest, DecoderConfigIsSharedByThreads) {
+    const std::vector<uint8_t> image = make_image(256);
+    fresco_encode_params_t params = lossy_params(85);
+    params.tile_size = 64;
+    Encoded encoded = encode(image, params);
+    ASSERT_EQ(encoded.result, FRESCO_OK);
+    const std::vector<uint8_t> expected = decode(encoded.data);
+
+    fresco_decode_params_t decode_params = {};
+    decode_params.max_threads = 1;
+    fresco_decoder_config_t* config = nullptr;
+    ASSERT_EQ(fresco_decoder_config_create(&decode_params, nullptr, nullptr, &config), FRESCO_OK);
+
+    // One configuration, no locks: every thread decodes through it at once
+    std::atomic<int> mismatches{0};
+    std::vector<std::thread> callers;
+    for (int t = 0; t < 4; t++) {
+        callers.emplace_back([&]() {
+            std::vector<uint8_t> pixels(expected.size());
+            for (int i = 0; i < 3; i++) {
+                fresco_stats_t stats = {};
+                if (fresco_decoder_config_decode_into(config, encoded.data.data(),
+                                                      encoded.data.size(), pixels.data(), 0,
+                                                      pixels.size(), &stats) != FRESCO_OK ||
+                    pixels != expected || stats.tiles != 16 || stats.threads != 1) {
+                    mismatches++;
+                }
+                uint8_t* output = nullptr;
+                size_t output_size = 0;
+                if (fresco_decoder_config_decode(config, encoded.data.data(), encoded.data.size(),
+                                                 &output, &output_size, nullptr) != FRESCO_OK ||
+                    std::vector<uint8_t>(output, output + output_size) != expected) {
+                    mismatches++;
+                }
+                fresco_free(output);
+            }
+        });
+    }
+    for (auto& caller : callers) {
+        caller.join();
+    }
+    EXPECT_EQ(mismatches, 0);
+    fresco_decoder_config_destroy(config);
+}
+
+TEST(FrescoRasterTest, RegionDecodesUseTheTileCache) {
+    const std::vector<uint8_t> image = make_image(256);
+    fresco_encode_params_t params = lossy_params(85);
+    params.tile_size = 64;
+    Encoded encoded = encode(image, params);
+    ASSERT_EQ(encoded.result, FRESCO_OK);
+    const std::vector<uint8_t> full = decode(encoded.data);
+
+    // A region across tile edges matches the same crop of the whole image
+    fresco_decoder_t* decoder = nullptr;
+    ASSERT_EQ(fresco_decoder_create(&decoder), FRESCO_OK);
+    const fresco_region_t region = {50, 70, 100, 90, 0};
+    std::vector<uint8_t> pixels(100 * 90 * 3);
+    ASSERT_EQ(fresco_decoder_decode_region(decoder, encoded.data.data(), encoded.data.size(),
+                                           &region, pixels.data(), 0, pixels.size()),
+              FRESCO_OK);
+    for (uint32_t y = 0; y < region.height; y++) {
+        ASSERT_EQ(std::memcmp(&pixels[y * 300], &full[((70 + y) * 256 + 50) * 3], 300), 0);
+    }
+    fresco_stats_t stats = {};
+    fresco_decoder_get_stats(decoder, &stats);
+    EXPECT_EQ(stats.tiles, 6u);
+
+    // Level 1 is about the 2x2 average of the image
+    const fresco_region_t half = {0, 0, 128, 128, 1};
+    std::vector<uint8_t> uncached(128 * 128 * 3);
+    ASSERT_EQ(fresco_decoder_decode_region(decoder, encoded.data.data(), encoded.data.size(),
+                                           &half, uncached.data(), 0, uncached.size()),
+              FRESCO_OK);
+    double error = 0.0;
+    for (uint32_t y = 0; y < 128; y++) {
+        for (uint32_t x = 0; x < 128; x++) {
+            for (uint32_t c = 0; c < 3; c++) {
+                const double average = (image[((2 * y) * 256 + 2 * x) * 3 + c] +
+                                        image[((2 * y) * 256 + 2 * x + 1) * 3 + c] +
+                                        image[((2 * y + 1) * 256 + 2 * x) * 3 + c] +
+                                        image[((2 * y + 1) * 256 + 2 * x + 1) * 3 + c]) / 4.0;
+                error += std::fabs(uncached[(y * 128 + x) * 3 + c] - average);
+            }
+        }
+    }
+    EXPECT_LT(error / uncached.size(), 3.0);
+    const fresco_region_t deepest = {0, 0, 1, 1, 9};
+    EXPECT_EQ(fresco_decoder_decode_region(decoder, encoded.data.data(), encoded.data.size(),
+                                           &deepest, pixels.data(), 0, pixels.size()),
+              FRESCO_ERROR_UNSUPPORTED_FORMAT);
+    const fresco_region_t outside = {100, 0, 29, 1, 1};
+    EXPECT_EQ(fresco_decoder_decode_region(decoder, encoded.data.data(), encoded.data.size(),
+                                           &outside, pixels.data(), 0, pixels.size()),
+              FRESCO_ERROR_INVALID_PARAMETER);
+
+    // Repeated requests are served from the cache, pixel for pixel
+    fresco_tile_cache_t* cache = nullptr;
+    ASSERT_EQ(fresco_tile_cache_create(64 << 20, &cache), FRESCO_OK);
+    ASSERT_EQ(fresco_decoder_set_tile_cache(decoder, cache), FRESCO_OK);
+    std::vector<uint8_t> cached(uncached.size());
+    for (int pass = 0; pass < 2; pass++) {
+        std::fill(cached.begin(), cached.end(), 0);
+        ASSERT_EQ(fresco_decoder_decode_region(decoder, encoded.data.data(),
+                                               encoded.data.size(), &half, cached.data(), 0,
+                                               cached.size()),
+                  FRESCO_OK);
+        EXPECT_EQ(cached, uncached);
+        fresco_decoder_get_stats(decoder, &stats);
+        EXPECT_EQ(stats.tiles, pass == 0 ? 16u : 0u);
+        EXPECT_EQ(stats.tile_cache_hits, pass == 0 ? 0u : 16u);
+    }
+    EXPECT_GT(fresco_tile_cache_bytes(cache), 128u * 128 * 3);
+
+    // A different file with the same layout gets none of those tiles
+    Encoded other = encode(make_image(256), lossy_params(60));
+    ASSERT_EQ(other.result, FRESCO_OK);
+    ASSERT_EQ(fresco_decoder_decode_region(decoder, other.data.data(), other.data.size(), &half,
+                                           cached.data(), 0, cached.size()),
+              FRESCO_OK);
+    fresco_decoder_get_stats(decoder, &stats);
+    EXPECT_EQ(stats.tile_cache_hits, 0u);
+
+    // Threads sharing a configuration and the cache see the same pixels
+    fresco_decoder_config_t* config = nullptr;
+    ASSERT_EQ(fresco_decoder_config_create(nullptr, nullptr, cache, &config), FRESCO_OK);
+    std::atomic<int> mismatches{0};
+    std::vector<std::thread> callers;
+    for (int t = 0; t < 4; t++) {
+        callers.emplace_back([&, t]() {
+            const fresco_region_t view = {static_cast<uint32_t>(20 * t), 30, 150, 120, 0};
+            std::vector<uint8_t> out(150 * 120 * 3);
+            if (fresco_decoder_config_decode_region(config, encoded.data.data(),
+                                                    encoded.data.size(), &view, out.data(), 0,
+                                                    out.size(), nullptr) != FRESCO_OK) {
+                mismatches++;
+                return;
+            }
+            for (uint32_t y = 0; y < view.height; y++) {
+                if (std::memcmp(&out[y * 450], &full[((30 + y) * 256 + view.x) * 3], 450) != 0) {
+                    mismatches++;
+                }
+            }
+        });
+    }
+    for (auto& caller : callers) {
+        caller.join();
+    }
+    EXPECT_EQ(mismatches, 0);
+    fresco_decoder_config_destroy(config);
+    fresco_decoder_destroy(decoder);
+    fresco_tile_cache_destroy(cache);
+}
+
+struct PyramidTiles {
+    std::mutex mutex;
+    std::map<std::vector<uint32_t>, std::vector<uint8_t>> tiles;    // By level, column, row
+    uint32_t failing_level = ~0u;
+};
+
+fresco_error_t collect_tile(uint32_t level, uint32_t column, uint32_t row,
+                            const fresco_image_t* tile, void* user_data) {
+    auto* collected = static_cast<PyramidTiles*>(user_data);
+    if (level == collected->failing_level) {
+        return FRESCO_ERROR_IO;
+    }
+    std::vector<uint8_t> pixels;
+    for (uint32_t y = 0; y < tile->height; y++) {
+        const uint8_t* src = tile->pixels + y * tile->row_stride;
+        pixels.insert(pixels.end(), src, src + tile->width * tile->channels);
+    }
+    std::lock_guard<std::mutex> lock(collected->mutex);
+    collected->tiles[{level, column, row, tile->width, tile->height}] = std::move(pixels);
+    return FRESCO_OK;
+}
+
+TEST(FrescoRasterTest, PyramidTilesMatchRegionDecodes) {
+    const std::vector<uint8_t> image = make_image(256);
+    fresco_encode_params_t params = lossy_params(85);
+    params.tile_size = 64;
+    Encoded encoded = encode(image, params);
+    ASSERT_EQ(encoded.result, FRESCO_OK);
+
+    fresco_decoder_t* decoder = nullptr;
+    ASSERT_EQ(fresco_decoder_create(&decoder), FRESCO_OK);
+    const fresco_pyramid_params_t pyramid = {100, 2, 0};
+    PyramidTiles collected;
+    ASSERT_EQ(fresco_decoder_decode_pyramid(decoder, encoded.data.data(), encoded.data.size(),
+                                            &pyramid, collect_tile, &collected),
+              FRESCO_OK);
+    fresco_stats_t stats = {};
+    fresco_decoder_get_stats(decoder, &stats);
+    EXPECT_EQ(stats.tiles, 16u);
+
+    // Levels 8 (full size) to 0 (one pixel), each cut into 100-pixel tiles
+    // that reach 2 pixels into their neighbours
+    std::vector<uint32_t> per_level(9, 0);
+    uint32_t native_levels = 0;
+    for (const auto& tile : collected.tiles) {
+        const uint32_t level = tile.first[0];
+        const uint32_t size = (256 + (1u << (8 - level)) - 1) >> (8 - level);
+        const uint32_t x0 = tile.first[1] * 100 - (tile.first[1] ? 2 : 0);
+        const uint32_t y0 = tile.first[2] * 100 - (tile.first[2] ? 2 : 0);
+        EXPECT_EQ(tile.first[3], std::min(size, (tile.first[1] + 1) * 100 + 2) - x0);
+        EXPECT_EQ(tile.first[4], std::min(size, (tile.first[2] + 1) * 100 + 2) - y0);
+        per_level[level]++;
+
+        // Down to the wavelet depth, tiles are exactly the region decodes
+        const fresco_region_t region = {x0, y0, tile.first[3], tile.first[4], 8 - level};
+        std::vector<uint8_t> pixels(tile.second.size());
+        if (fresco_decoder_decode_region(decoder, encoded.data.data(), encoded.data.size(),
+                                         &region, pixels.data(), 0, pixels.size()) == FRESCO_OK) {
+            EXPECT_EQ(pixels, tile.second);
+            native_levels = std::max(native_levels, 8 - level);
+        }
+    }
+    EXPECT_GE(native_levels, 3u);
+    EXPECT_EQ(per_level, (std::vector<uint32_t>{1, 1, 1, 1, 1, 1, 1, 4, 9}));
+
+    // The first sink error ends the pyramid; bad parameters are refused
+    collected.failing_level = 7;
+    EXPECT_EQ(fresco_decoder_decode_pyramid(decoder, encoded.data.data(), encoded.data.size(),
+                                            &pyramid, collect_tile, &collected),
+              FRESCO_ERROR_IO);
+    const fresco_pyramid_params_t wide = {16, 16, 0};
+    EXPECT_EQ(fresco_decoder_decode_pyramid(decoder, encoded.data.data(), encoded.data.size(),
+                                            &wide, collect_tile, &collected),
+              FRESCO_ERROR_INVALID_PARAMETER);
+    const fresco_pyramid_params_t deep = {256, 0, 9};
+    EXPECT_EQ(fresco_decoder_decode_pyramid(decoder, encoded.data.data(), encoded.data.size(),
+                                            &deep, collect_tile, &collected),
+              FRESCO_ERROR_INVALID_PARAMETER);
+    fresco_decoder_destroy(decoder);
+}
+
+TEST(FrescoRasterTest, PyramidRowsDecodeOnThreadsOfTheirOwn) {
+    const std::vector<uint8_t> image = make_image(1024);
+    fresco_encode_params_t params = lossy_params(85);
+    params.tile_size = 256;
+    Encoded encoded = encode(image, params);
+    ASSERT_EQ(encoded.result, FRESCO_OK);
+
+    // Without a pool every row of tiles starts threads of its own, which
+    // exit before the next row
+    const fresco_pyramid_params_t pyramid = {256, 1, 0};
+    PyramidTiles serial, threaded;
+    for (uint32_t threads : {1u, 4u}) {
+        fresco_decoder_t* decoder = nullptr;
+        ASSERT_EQ(fresco_decoder_create(&decoder), FRESCO_OK);
+        fresco_decode_params_t decode_params = {};
+        decode_params.max_threads = threads;
+        ASSERT_EQ(fresco_decoder_set_params(decoder, &decode_params), FRESCO_OK);
+        ASSERT_EQ(fresco_decoder_decode_pyramid(decoder, encoded.data.data(),
+                                                encoded.data.size(), &pyramid, collect_tile,
+                                                threads == 1 ? &serial : &threaded),
+                  FRESCO_OK);
+        fresco_decoder_destroy(decoder);
+    }
+    EXPECT_FALSE(serial.tiles.empty());
+    EXPECT_EQ(threaded.tiles, serial.tiles);
+}
+
+TEST(FrescoRasterTest, ChecksumsCatchCorruptTilesAndBoxes) {
+    const std::vector<uint8_t> image = make_image(256);
+    fresco_encode_params_t params = lossy_params(85);
+    params.tile_size = 128;
+    Encoded encoded = encode(image, params);
+    ASSERT_EQ(encoded.result, FRESCO_OK);
+
+    fresco_decoder_t* decoder = nullptr;
+    ASSERT_EQ(fresco_decoder_create(&decoder), FRESCO_OK);
+    fresco_decode_params_t decode_params = {};
+    auto decode_with = [&](const std::vector<uint8_t>& data, fresco_verify_t verify,
+                           const fresco_region_t* region) {
+        decode_params.verify = verify;
+        EXPECT_EQ(fresco_decoder_set_params(decoder, &decode_params), FRESCO_OK);
+        std::vector<uint8_t> pixels(image.size());
+        if (region) {
+            return fresco_decoder_decode_region(decoder, data.data(), data.size(), region,
+                                                pixels.data(), 0, pixels.size());
+        }
+        return fresco_decoder_decode_into(decoder, data.data(), data.size(), pixels.data(), 0,
+                                          pixels.size());
+    };
+    const fresco_region_t first_tile = {0, 0, 128, 128, 0};
+    for (fresco_verify_t verify : {FRESCO_VERIFY_LAZY, FRESCO_VERIFY_ALWAYS, FRESCO_VERIFY_SKIP}) {
+        EXPECT_EQ(decode_with(encoded.data, verify, nullptr), FRESCO_OK);
+    }
+
+    // A flipped bit in the last tile fails any call that reads that tile,
+    // and with ALWAYS any call at all
+    std::vector<uint8_t> corrupt_tile = encoded.data;
+    corrupt_tile[corrupt_tile.size() - 10] ^= 0x04;
+    EXPECT_EQ(decode_with(corrupt_tile, FRESCO_VERIFY_LAZY, nullptr),
+              FRESCO_ERROR_CORRUPTED_DATA);
+    EXPECT_EQ(decode_with(corrupt_tile, FRESCO_VERIFY_LAZY, &first_tile), FRESCO_OK);
+    EXPECT_EQ(decode_with(corrupt_tile, FRESCO_VERIFY_ALWAYS, &first_tile),
+              FRESCO_ERROR_CORRUPTED_DATA);
+    EXPECT_EQ(decode_with(corrupt_tile, FRESCO_VERIFY_SKIP, &first_tile), FRESCO_OK);
+
+    // The image width in mvhd is covered by the moov checksum
+    std::vector<uint8_t> corrupt_box = encoded.data;
+    corrupt_box[48] ^= 0x01;
+    EXPECT_EQ(decode_with(corrupt_box, FRESCO_VERIFY_LAZY, nullptr),
+              FRESCO_ERROR_CORRUPTED_DATA);
+    fresco_metadata_t metadata = {};
+    EXPECT_EQ(fresco_get_metadata(corrupt_box.data(), corrupt_box.size(), &metadata),
+              FRESCO_ERROR_CORRUPTED_DATA);
+
+    // A header claiming far more tiles than the track has bytes for is
+    // refused before anything is sized from it
+    std::vector<uint8_t> huge = encoded.data;
+    const uint8_t mvhd[] = {'m', 'v', 'h', 'd'};
+    const auto box = std::search(huge.begin(), huge.end(), mvhd, mvhd + 4);
+    ASSERT_NE(box, huge.end());
+    std::fill(box + 8, box + 16, 0x7F);    // Width and height
+    EXPECT_EQ(decode_with(huge, FRESCO_VERIFY_SKIP, &first_tile), FRESCO_ERROR_CORRUPTED_DATA);
+
+    decode_params.verify = static_cast<fresco_verify_t>(3);
+    EXPECT_EQ(fresco_decoder_set_params(decoder, &decode_params), FRESCO_ERROR_INVALID_PARAMETER);
+    fresco_decoder_destroy(decoder);
+}
+
+namespace {
+
+// Flat panels and glyph-like strokes in a handful of colors, beside a
+// quadrant of make_image() content
+std::vector<uint8_t> make_screen(uint32_t size) {
+    std::vector<uint8_t> image = make_image(size);
+    auto fill = [&](uint32_t x0, uint32_t y0, uint32_t x1, uint32_t y1, uint8_t r, uint8_t g,
+                    uint8_t b) {
+        for (uint32_t y = y0; y < y1; y++) {
+            for (uint32_t x = x0; x < x1; x++) {
+                uint8_t* p = &image[(static_cast<size_t>(y) * size + x) * 3];
+                p[0] = r;
+                p[1] = g;
+                p[2] = b;
+            }
+        }
+    };
+    const uint32_t half = size / 2;
+    fill(0, 0, size, half, 236, 238, 242);
+    fill(0, half, half, size, 236, 238, 242);
+    fill(0, 0, size, 20, 40, 44, 52);
+    fill(12, 32, size - 12, 100, 255, 255, 255);
+    std::mt19937 rng(5);
+    for (uint32_t y = 40; y + 12 < size; y += 16) {
+        const uint32_t right = y < half ? size - 16 : half - 8;
+        for (uint32_t x = 20; x + 8 < right; x += 7) {
+            if (rng() % 6 == 0) {
+                continue;    // Between words
+            }
+            fill(x, y + rng() % 4, x + 1 + rng() % 4, y + 8 + rng() % 4, 20, 20, 24);
+        }
+    }
+    return image;
+}
+
+} // namespace
+
+TEST(FrescoRasterTest, ScreenContentTilesAreCodedExactly) {
+    const std::vector<uint8_t> image = make_screen(256);
+    fresco_encode_params_t params = lossy_params(85);
+    params.tile_size = 64;
+    params.mode = FRESCO_COMPRESSION_LOSSLESS;
+    Encoded lossless = encode(image, params);
+    ASSERT_EQ(lossless.result, FRESCO_OK);
+    EXPECT_EQ(decode(lossless.data, 1), image);
+    EXPECT_EQ(decode(lossless.data, 4), image);
+    EXPECT_LT(lossless.data.size(), image.size() / 6);
+
+    // Few-color tiles stay exact in lossy mode too, with or without a
+    // target, while the quadrant of shading goes through the transform
+    params.mode = FRESCO_COMPRESSION_LOSSY;
+    params.quality = 50;
+    for (uint64_t target : {0u, 16000u}) {
+        params.target_bytes = target;
+        Encoded lossy = encode(image, params);
+        ASSERT_EQ(lossy.result, FRESCO_OK);
+        EXPECT_LT(lossy.data.size(), lossless.data.size());
+        if (target) {
+            EXPECT_LE(lossy.data.size(), target);
+        }
+        const std::vector<uint8_t> decoded = decode(lossy.data);
+        for (uint32_t y = 0; y < 256; y++) {
+            const size_t exact = y < 128 ? 256 * 3 : 128 * 3;
+            ASSERT_EQ(std::memcmp(&decoded[y * 256 * 3], &image[y * 256 * 3], exact), 0);
+        }
+        EXPECT_NE(decoded, image);
+    }
+
+    // Reduced levels transform the exact tiles on the way, and the pyramid
+    // and region decodes agree on them
+    fresco_decoder_t* decoder = nullptr;
+    ASSERT_EQ(fresco_decoder_create(&decoder), FRESCO_OK);
+    const fresco_pyramid_params_t pyramid = {64, 0, 0};
+    PyramidTiles collected;
+    ASSERT_EQ(fresco_decoder_decode_pyramid(decoder, lossless.data.data(), lossless.data.size(),
+                                            &pyramid, collect_tile, &collected),
+              FRESCO_OK);
+    for (uint32_t level = 0; level <= 2; level++) {
+        const uint32_t size = 256 >> level;
+        const fresco_region_t region = {0, 0, size, size, level};
+        std::vector<uint8_t> pixels(size * size * 3);
+        ASSERT_EQ(fresco_decoder_decode_region(decoder, lossless.data.data(),
+                                               lossless.data.size(), &region, pixels.data(), 0,
+                                               pixels.size()),
+                  FRESCO_OK);
+        if (level == 0) {
+            EXPECT_EQ(pixels, image);
+        }
+        const uint32_t count = size / 64;
+        for (uint32_t row = 0; row < count; row++) {
+            for (uint32_t column = 0; column < count; column++) {
+                const auto& tile = collected.tiles[{8 - level, column, row, 64, 64}];
+                ASSERT_EQ(tile.size(), 64u * 64u * 3u);
+                for (uint32_t y = 0; y < 64; y++) {
+                    ASSERT_EQ(std::memcmp(&tile[y * 64 * 3],
+                                          &pixels[((row * 64 + y) * size + column * 64) * 3],
+                                          64 * 3),
+                              0);
+                }
+            }
+        }
+    }
+    fresco_decoder_destroy(decoder);
+}
@@ -0,0 +1,317 @@
+/**
+ * @file test_vector.cpp
+ * @brief Unit tests for the FRESCO vector track
+ * @author Mehmet T. AKALIN
+ * @date 2025
+ * @license MIT
+ */
+
+#include "fresco/fresco.h"
+#include <gtest/gtest.h>
+#include <vector>
+#include <random>
+#include <cmath>
+
+class FrescoVectorTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        // Square followed by a curved shape
+        square_commands_ = {FRESCO_PATH_MOVE, FRESCO_PATH_LINE, FRESCO_PATH_LINE,
+                            FRESCO_PATH_LINE, FRESCO_PATH_CLOSE};
+        square_points_ = {10.0f, 10.0f, 50.0f, 10.0f, 50.0f, 50.0f, 10.0f, 50.0f};
+
+        curve_commands_ = {FRESCO_PATH_MOVE, FRESCO_PATH_QUAD, FRESCO_PATH_CUBIC,
+                           FRESCO_PATH_CLOSE};
+        curve_points_ = {0.5f, 0.25f, 20.0f, -3.0f, 40.0f, 0.5f,
+                         60.0f, 10.0f, 30.0f, 40.0f, 0.5f, 0.25f};
+
+        paths_.resize(2);
+        paths_[0] = {square_commands_.data(), square_commands_.size(), square_points_.data(),
+                     square_points_.size() / 2, 0xff0000ffu, FRESCO_FILL_NONZERO};
+        paths_[1] = {curve_commands_.data(), curve_commands_.size(), curve_points_.data(),
+                     curve_points_.size() / 2, 0x00ff0080u, FRESCO_FILL_EVENODD};
+    }
+
+    std::vector<uint8_t> encode(const std::vector<fresco_vector_path_t>& paths,
+                                const std::vector<uint8_t>& raster = {}) {
+        fresco_encoder_t* encoder = nullptr;
+        EXPECT_EQ(fresco_encoder_create(&encoder), FRESCO_OK);
+
+        fresco_encode_params_t params = {};
+        params.mode = FRESCO_COMPRESSION_LOSSLESS;
+        params.quality = 85;
+        params.effort = 5;
+        params.enable_vector = 1;
+        EXPECT_EQ(fresco_encoder_set_params(encoder, &params), FRESCO_OK);
+        EXPECT_EQ(fresco_encoder_set_vector_paths(encoder, 64, 64, paths.data(), paths.size()),
+                  FRESCO_OK);
+
+        uint8_t* output = nullptr;
+        size_t output_size = 0;
+        EXPECT_EQ(fresco_encoder_encode(encoder, raster.empty() ? nullptr : raster.data(),
+                                        raster.size(), &output, &output_size),
+                  FRESCO_OK);
+        std::vector<uint8_t> encoded(output, output + output_size);
+        fresco_free(output);
+        fresco_encoder_destroy(encoder);
+        return encoded;
+    }
+
+    std::vector<uint8_t> square_commands_;
+    std::vector<float> square_points_;
+    std::vector<uint8_t> curve_commands_;
+    std::vector<float> curve_points_;
+    std::vector<fresco_vector_path_t> paths_;
+};
+
+TEST_F(FrescoVectorTest, RoundTrip) {
+    std::vector<uint8_t> encoded = encode(paths_);
+
+    fresco_decoder_t* decoder = nullptr;
+    ASSERT_EQ(fresco_decoder_create(&decoder), FRESCO_OK);
+
+    fresco_vector_path_t* decoded = nullptr;
+    size_t path_count = 0;
+    ASSERT_EQ(fresco_decoder_decode_vector(decoder, encoded.data(), encoded.size(),
+                                           &decoded, &path_count),
+              FRESCO_OK);
+    ASSERT_EQ(path_count, paths_.size());
+
+    for (size_t i = 0; i < path_count; i++) {
+        const fresco_vector_path_t& expected = paths_[i];
+        const fresco_vector_path_t& actual = decoded[i];
+        ASSERT_EQ(actual.command_count, expected.command_count);
+        ASSERT_EQ(actual.point_count, expected.point_count);
+        EXPECT_EQ(actual.fill_color, expected.fill_color);
+        EXPECT_EQ(actual.fill_rule, expected.fill_rule);
+        for (size_t c = 0; c < actual.command_count; c++) {
+            EXPECT_EQ(actual.commands[c], expected.commands[c]);
+        }
+        for (size_t p = 0; p < actual.point_count * 2; p++) {
+            EXPECT_NEAR(actual.points[p], expected.points[p], 1.0f / 32);
+        }
+    }
+
+    fresco_free(decoded);
+    fresco_decoder_destroy(decoder);
+}
+
+TEST_F(FrescoVectorTest, ManySegments) {
+    // Long random polylines exercise the vectorized coordinate decoder
+    std::mt19937 gen(42);
+    std::uniform_real_distribution<float> step(-300.0f, 300.0f);
+
+    std::vector<std::vector<uint8_t>> commands(7);
+    std::vector<std::vector<float>> points(7);
+    std::vector<fresco_vector_path_t> paths;
+    for (size_t i = 0; i < commands.size(); i++) {
+        size_t segments = 1000 + 37 * i;
+        float x = 0.0f, y = 0.0f;
+        commands[i].push_back(FRESCO_PATH_MOVE);
+        points[i].insert(points[i].end(), {x, y});
+        for (size_t s = 0; s < segments; s++) {
+            x += step(gen);
+            y += step(gen);
+            commands[i].push_back(FRESCO_PATH_LINE);
+            points[i].insert(points[i].end(), {x, y});
+        }
+        paths.push_back({commands[i].data(), commands[i].size(), points[i].data(),
+                         points[i].size() / 2, 0xffffffffu, FRESCO_FILL_NONZERO});
+    }
+
+    std::vector<uint8_t> encoded = encode(paths);
+
+    fresco_decoder_t* decoder = nullptr;
+    ASSERT_EQ(fresco_decoder_create(&decoder), FRESCO_OK);
+    fresco_vector_path_t* decoded = nullptr;
+    size_t path_count = 0;
+    ASSERT_EQ(fresco_decoder_decode_vector(decoder, encoded.data(), encoded.size(),
+                                           &decoded, &path_count),
+              FRESCO_OK);
+    ASSERT_EQ(path_count, paths.size());
+    for (size_t i = 0; i < path_count; i++) {
+        ASSERT_EQ(decoded[i].point_count, paths[i].point_count);
+        for (size_t p = 0; p < decoded[i].point_count * 2; p++) {
+            ASSERT_NEAR(decoded[i].points[p], paths[i].points[p], 1.0f / 32);
+        }
+    }
+    fresco_free(decoded);
+    fresco_decoder_destroy(decoder);
+}
+
+TEST_F(FrescoVectorTest, RasterAndVectorTracks) {
+    std::vector<uint8_t> raster(8 * 8 * 3);
+    for (size_t i = 0; i < raster.size(); i++) {
+        raster[i] = static_cast<uint8_t>(i * 7);
+    }
+    std::vector<uint8_t> encoded = encode(paths_, raster);
+
+    fresco_decoder_t* decoder = nullptr;
+    ASSERT_EQ(fresco_decoder_create(&decoder), FRESCO_OK);
+
+    uint8_t* output = nullptr;
+    size_t output_size = 0;
+    ASSERT_EQ(fresco_decoder_decode(decoder, encoded.data(), encoded.size(), &output, &output_size),
+              FRESCO_OK);
+    EXPECT_EQ(std::vector<uint8_t>(output, output + output_size), raster);
+    fresco_free(output);
+
+    fresco_vector_path_t* decoded = nullptr;
+    size_t path_count = 0;
+    EXPECT_EQ(fresco_decoder_decode_vector(decoder, encoded.data(), encoded.size(),
+                                           &decoded, &path_count),
+              FRESCO_OK);
+    EXPECT_EQ(path_count, paths_.size());
+    fresco_free(decoded);
+    fresco_decoder_destroy(decoder);
+}
+
+TEST_F(FrescoVectorTest, InvalidPaths) {
+    fresco_encoder_t* encoder = nullptr;
+    ASSERT_EQ(fresco_encoder_create(&encoder), FRESCO_OK);
+
+    // Point count does not match the commands
+    fresco_vector_path_t path = paths_[0];
+    path.point_count = 3;
+    EXPECT_EQ(fresco_encoder_set_vector_paths(encoder, 64, 64, &path, 1),
+              FRESCO_ERROR_INVALID_PARAMETER);
+
+    // Path must start with a move
+    std::vector<uint8_t> commands = {FRESCO_PATH_LINE};
+    float points[2] = {1.0f, 2.0f};
+    path = {commands.data(), 1, points, 1, 0, FRESCO_FILL_NONZERO};
+    EXPECT_EQ(fresco_encoder_set_vector_paths(encoder, 64, 64, &path, 1),
+              FRESCO_ERROR_INVALID_PARAMETER);
+
+    // Non-finite coordinates
+    commands[0] = FRESCO_PATH_MOVE;
+    points[0] = std::nanf("");
+    EXPECT_EQ(fresco_encoder_set_vector_paths(encoder, 64, 64, &path, 1),
+              FRESCO_ERROR_INVALID_PARAMETER);
+
+    fresco_encoder_destroy(encoder);
+}
+
+TEST_F(FrescoVectorTest, CorruptedTrack) {
+    std::vector<uint8_t> encoded = encode(paths_);
+
+    fresco_decoder_t* decoder = nullptr;
+    ASSERT_EQ(fresco_decoder_create(&decoder), FRESCO_OK);
+
+    // Truncating the coordinate stream must be detected
+    std::vector<uint8_t> truncated(encoded.begin(), encoded.end() - 4);
+    fresco_vector_path_t* decoded = nullptr;
+    size_t path_count = 0;
+    EXPECT_NE(fresco_decoder_decode_vector(decoder, truncated.data(), truncated.size(),
+                                           &decoded, &path_count),
+              FRESCO_OK);
+
+    fresco_decoder_destroy(decoder);
+}
+
+namespace {
+
+std::vector<uint8_t> decode_pixels(const std::vector<uint8_t>& encoded, uint32_t threads,
+                                   int render_vector = 0) {
+    fresco_decoder_t* decoder = nullptr;
+    EXPECT_EQ(fresco_decoder_create(&decoder), FRESCO_OK);
+    fresco_decode_params_t params = {};
+    params.max_threads = threads;
+    params.render_vector = render_vector;
+    EXPECT_EQ(fresco_decoder_set_params(decoder, &params), FRESCO_OK);
+
+    uint8_t* output = nullptr;
+    size_t output_size = 0;
+    EXPECT_EQ(fresco_decoder_decode(decoder, encoded.data(), encoded.size(), &output, &output_size),
+              FRESCO_OK);
+    std::vector<uint8_t> pixels(output, output + output_size);
+    fresco_free(output);
+    fresco_decoder_destroy(decoder);
+    return pixels;
+}
+
+} // namespace
+
+TEST_F(FrescoVectorTest, RenderVectorOnly) {
+    std::vector<uint8_t> encoded = encode({paths_[0]});
+    std::vector<uint8_t> pixels = decode_pixels(encoded, 1);
+    ASSERT_EQ(pixels.size(), 64u * 64u * 4u);
+
+    auto pixel = [&](int x, int y) { return &pixels[(y * 64 + x) * 4]; };
+
+    // Inside the square: opaque red
+    EXPECT_EQ(pixel(30, 30)[0], 255);
+    EXPECT_EQ(pixel(30, 30)[1], 0);
+    EXPECT_EQ(pixel(30, 30)[3], 255);
+    EXPECT_EQ(pixel(10, 10)[3], 255);
+    EXPECT_EQ(pixel(49, 49)[3], 255);
+
+    // Outside: untouched transparent canvas
+    EXPECT_EQ(pixel(5, 5)[3], 0);
+    EXPECT_EQ(pixel(50, 30)[3], 0);
+    EXPECT_EQ(pixel(60, 60)[3], 0);
+}
+
+TEST_F(FrescoVectorTest, RenderAntialiasedEdges) {
+    // Square with edges on half pixels covers its border pixels halfway
+    std::vector<float> points = {10.5f, 10.5f, 40.5f, 10.5f, 40.5f, 40.5f, 10.5f, 40.5f};
+    fresco_vector_path_t path = paths_[0];
+    path.points = points.data();
+    std::vector<uint8_t> pixels = decode_pixels(encode({path}), 1);
+
+    auto alpha = [&](int x, int y) { return pixels[(y * 64 + x) * 4 + 3]; };
+    EXPECT_EQ(alpha(20, 20), 255);
+    EXPECT_NEAR(alpha(10, 20), 128, 1);
+    EXPECT_NEAR(alpha(40, 20), 128, 1);
+    EXPECT_NEAR(alpha(20, 10), 128, 1);
+    EXPECT_NEAR(alpha(10, 10), 64, 1);
+    EXPECT_EQ(alpha(9, 20), 0);
+}
+
+TEST_F(FrescoVectorTest, RenderEvenOdd) {
+    // Two nested squares with the same winding leave a hole under even-odd
+    std::vector<uint8_t> commands = {FRESCO_PATH_MOVE, FRESCO_PATH_LINE, FRESCO_PATH_LINE,
+                                     FRESCO_PATH_LINE, FRESCO_PATH_CLOSE,
+                                     FRESCO_PATH_MOVE, FRESCO_PATH_LINE, FRESCO_PATH_LINE,
+                                     FRESCO_PATH_LINE, FRESCO_PATH_CLOSE};
+    std::vector<float> points = {8, 8, 56, 8, 56, 56, 8, 56,
+                                 24, 24, 40, 24, 40, 40, 24, 40};
+    fresco_vector_path_t path = {commands.data(), commands.size(), points.data(),
+                                 points.size() / 2, 0xffffffffu, FRESCO_FILL_EVENODD};
+
+    std::vector<uint8_t> pixels = decode_pixels(encode({path}), 1);
+    auto alpha = [&](int x, int y) { return pixels[(y * 64 + x) * 4 + 3]; };
+    EXPECT_EQ(alpha(12, 32), 255);
+    EXPECT_EQ(alpha(32, 32), 0);
+
+    path.fill_rule = FRESCO_FILL_NONZERO;
+    pixels = decode_pixels(encode({path}), 1);
+    EXPECT_EQ(alpha(32, 32), 255);
+}
+
+TEST_F(FrescoVectorTest, RenderThreadCountInvariant) {
+    // Many overlapping translucent curves spanning every band
+    std::mt19937 gen(7);
+    std::uniform_real_distribution<float> coord(-8.0f, 72.0f);
+    std::vector<std::vector<uint8_t>> commands(40);
+    std::vector<std::vector<float>> points(40);
+    std::vector<fresco_vector_path_t> paths;
+    for (size_t i = 0; i < commands.size(); i++) {
+        commands[i] = {FRESCO_PATH_MOVE, FRESCO_PATH_CUBIC, FRESCO_PATH_QUAD, FRESCO_PATH_CLOSE};
+        for (int p = 0; p < 6; p++) {
+            points[i].push_back(coord(gen));
+            points[i].push_back(coord(gen));
+        }
+        paths.push_back({commands[i].data(), commands[i].size(), points[i].data(), 6,
+                         static_cast<uint32_t>(gen()) | 0x40u,
+                         i % 2 ? FRESCO_FILL_EVENODD : FRESCO_FILL_NONZERO});
+    }
+
+    std::vector<uint8_t> raster(48 * 48 * 3, 90);
+    std::vector<uint8_t> encoded = encode(paths, raster);
+    std::vector<uint8_t> single = decode_pixels(encoded, 1, 1);
+    std::vector<uint8_t> multi = decode_pixels(encoded, 4, 1);
+    ASSERT_EQ(single.size(), raster.size());
+    EXPECT_NE(single, raster);
+    EXPECT_EQ(single, multi);
+}
@@ -12,23 +12,49 @@
 #include <vector>
 #include <string>
 #include <cstring>
+#include <cstdio>
+#include <algorithm>
+#include <cctype>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <filesystem>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
 
 void print_usage(const char* program_name) {
     std::cout << "FRESCO: Fast, Rich, and Efficient Scalable Content Object\n";
     std::cout << "Usage: " << program_name << " <command> [options]\n\n";
     std::cout << "Commands:\n";
-    std::cout << "  encode <input> <output> [options]  Encode image to FRESCO format\n";
-    std::cout << "  decode <input> <output> [options]  Decode FRESCO file to image\n";
+    std::cout << "  encode <input> <output> [options]  Encode image to FRESCO format; JPEG input is\n";
+    std::cout << "                                     recompressed without loss\n";
+    std::cout << "  decode <input> <output> [options]  Decode FRESCO file to raw samples, to a PNG,\n";
+    std::cout << "                                     PGM/PPM or PAM file by output extension, or\n";
+    std::cout << "                                     to the original JPEG for .jpg or .jpeg\n";
     std::cout << "  convert <input> <output> [options] Convert between formats\n";
     std::cout << "  info <input>                       Show file information\n";
+    std::cout << "  batch encode|decode <in-dir> <out-dir> [-j N] [options]\n";
+    std::cout << "                                     Code every file of a directory, N files at a time;\n";
+    std::cout << "                                     decoded files are written as PNG\n";
+    std::cout << "  pyramid <input> <out-dir> [--tile N] [--overlap N] [--layout dz|xyz]\n";
+    std::cout << "                                     Write the PNG tiles of a deep-zoom pyramid\n";
     std::cout << "  version                            Show version information\n\n";
     std::cout << "Options:\n";
     std::cout << "  --quality <1-100>                  Quality setting (default: 85)\n";
     std::cout << "  --effort <1-10>                    Encoding effort (default: 5)\n";
     std::cout << "  --lossless                         Use lossless compression\n";
     std::cout << "  --lossy                            Use lossy compression (default)\n";
-    std::cout << "  --tile-size <size>                 Tile size for encoding\n";
+    std::cout << "  --tile-size <size>                 Tile size for encoding (default: set by effort)\n";
+    std::cout << "  --target-bytes <bytes>             Largest output size, overrides quality (lossy)\n";
+    std::cout << "  --target-bpp <bits>                Largest output size in bits per pixel (lossy)\n";
     std::cout << "  --threads <count>                  Number of threads\n";
+    std::cout << "  --max-memory <bytes>               Largest working memory, output included\n";
+    std::cout << "  --render-vector                    Draw the vector track over the decoded image\n";
+    std::cout << "  --verify <lazy|always|skip>        When to check tile and track checksums (default: lazy)\n";
+    std::cout << "  --trace <file>                     Write a Chrome trace of the run (chrome://tracing, Perfetto)\n";
     std::cout << "  --help                             Show this help message\n";
 }
 
@@ -65,24 +91,62 @@ fresco_error_t write_file(const std::string& filename, const std::vector<uint8_t
     return file.good() ? FRESCO_OK : FRESCO_ERROR_IO;
 }
 
-fresco_error_t encode_command(const std::vector<std::string>& args) {
-    if (args.size() < 2) {
-        std::cerr << "Error: encode command requires input and output files\n";
-        return FRESCO_ERROR_INVALID_PARAMETER;
+// JPEG files start with SOI and the marker of their first segment
+bool is_jpeg(const std::vector<uint8_t>& data) {
+    return data.size() >= 3 && data[0] == 0xFF && data[1] == 0xD8 && data[2] == 0xFF;
+}
+
+std::string lower_extension(const std::string& filename) {
+    std::string extension = std::filesystem::path(filename).extension().string();
+    std::transform(extension.begin(), extension.end(), extension.begin(),
+                   [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+    return extension;
+}
+
+bool has_jpeg_extension(const std::string& filename) {
+    const std::string extension = lower_extension(filename);
+    return extension == ".jpg" || extension == ".jpeg";
+}
+
+// The image file format an output name asks for; false for raw samples
+bool file_format_for(const std::string& filename, fresco_file_format_t& format) {
+    const std::string extension = lower_extension(filename);
+    if (extension == ".pgm" || extension == ".ppm" || extension == ".pnm") {
+        format = FRESCO_FILE_PNM;
+    } else if (extension == ".pam") {
+        format = FRESCO_FILE_PAM;
+    } else if (extension == ".png") {
+        format = FRESCO_FILE_PNG;
+    } else {
+        return false;
     }
+    return true;
+}
 
-    std::string input_file = args[0];
-    std::string output_file = args[1];
+// Collects trace events into a JSON array file
+struct TraceFile {
+    FILE* file = nullptr;
+    bool first = true;
+};
+
+void write_trace_event(const char* event, size_t length, void* user_data) {
+    TraceFile* trace = static_cast<TraceFile*>(user_data);
+    std::fputs(trace->first ? "[\n" : ",\n", trace->file);
+    std::fwrite(event, 1, length, trace->file);
+    trace->first = false;
+}
 
-    // Parse options
+// Codec options shared by the single-file commands and batch mode; args
+// before first are positional
+fresco_encode_params_t parse_encode_options(const std::vector<std::string>& args, size_t first) {
     fresco_encode_params_t params = {};
     params.mode = FRESCO_COMPRESSION_LOSSY;
     params.quality = 85;
     params.effort = 5;
     params.max_threads = 0;
-    params.tile_size = 256;
+    params.tile_size = 0;    // The effort preset's
 
-    for (size_t i = 2; i < args.size(); i++) {
+    for (size_t i = first; i < args.size(); i++) {
         if (args[i] == "--quality" && i + 1 < args.size()) {
             params.quality = std::stoi(args[++i]);
         } else if (args[i] == "--effort" && i + 1 < args.size()) {
@@ -93,11 +157,64 @@ fresco_error_t encode_command(const std::vector<std::string>& args) {
             params.mode = FRESCO_COMPRESSION_LOSSY;
         } else if (args[i] == "--tile-size" && i + 1 < args.size()) {
             params.tile_size = std::stoi(args[++i]);
+        } else if (args[i] == "--target-bytes" && i + 1 < args.size()) {
+            params.target_bytes = std::stoull(args[++i]);
+        } else if (args[i] == "--target-bpp" && i + 1 < args.size()) {
+            params.target_bpp = std::stof(args[++i]);
         } else if (args[i] == "--threads" && i + 1 < args.size()) {
             params.max_threads = std::stoi(args[++i]);
+        } else if (args[i] == "--max-memory" && i + 1 < args.size()) {
+            params.max_memory_bytes = std::stoull(args[++i]);
         }
     }
 
+    return params;
+}
+
+fresco_error_t parse_decode_options(const std::vector<std::string>& args, size_t first,
+                                    fresco_decode_params_t& params) {
+    params = {};
+    params.max_threads = 0;
+
+    for (size_t i = first; i < args.size(); i++) {
+        if (args[i] == "--threads" && i + 1 < args.size()) {
+            params.max_threads = std::stoi(args[++i]);
+        } else if (args[i] == "--progressive") {
+            params.enable_progressive = 1;
+        } else if (args[i] == "--render-vector") {
+            params.render_vector = 1;
+        } else if (args[i] == "--max-memory" && i + 1 < args.size()) {
+            params.max_memory_bytes = std::stoull(args[++i]);
+        } else if (args[i] == "--verify" && i + 1 < args.size()) {
+            const std::string& mode = args[++i];
+            if (mode == "lazy") {
+                params.verify = FRESCO_VERIFY_LAZY;
+            } else if (mode == "always") {
+                params.verify = FRESCO_VERIFY_ALWAYS;
+            } else if (mode == "skip") {
+                params.verify = FRESCO_VERIFY_SKIP;
+            } else {
+                std::cerr << "Error: --verify must be lazy, always or skip, not '" << mode << "'\n";
+                return FRESCO_ERROR_INVALID_PARAMETER;
+            }
+        }
+    }
+
+    return FRESCO_OK;
+}
+
+fresco_error_t encode_command(const std::vector<std::string>& args) {
+    if (args.size() < 2) {
+        std::cerr << "Error: encode command requires input and output files\n";
+        return FRESCO_ERROR_INVALID_PARAMETER;
+    }
+
+    std::string input_file = args[0];
+    std::string output_file = args[1];
+
+    // Parse options
+    fresco_encode_params_t params = parse_encode_options(args, 2);
+
     // Read input file
     std::vector<uint8_t> input_data;
     fresco_error_t result = read_file(input_file, input_data);
@@ -125,8 +242,13 @@ fresco_error_t encode_command(const std::vector<std::string>& args) {
     // Encode
     uint8_t* output_data = nullptr;
     size_t output_size = 0;
-    result = fresco_encoder_encode(encoder, input_data.data(), input_data.size(),
-                                 &output_data, &output_size);
+    if (is_jpeg(input_data)) {
+        result = fresco_encoder_encode_jpeg(encoder, input_data.data(), input_data.size(),
+                                            &output_data, &output_size);
+    } else {
+        result = fresco_encoder_encode(encoder, input_data.data(), input_data.size(),
+                                       &output_data, &output_size);
+    }
     if (result != FRESCO_OK) {
         std::cerr << "Error: Failed to encode: " << fresco_error_string(result) << "\n";
         fresco_encoder_destroy(encoder);
@@ -165,20 +287,15 @@ fresco_error_t decode_command(const std::vector<std::string>& args) {
     std::string output_file = args[1];
 
     // Parse options
-    fresco_decode_params_t params = {};
-    params.max_threads = 0;
-
-    for (size_t i = 2; i < args.size(); i++) {
-        if (args[i] == "--threads" && i + 1 < args.size()) {
-            params.max_threads = std::stoi(args[++i]);
-        } else if (args[i] == "--progressive") {
-            params.enable_progressive = 1;
-        }
+    fresco_decode_params_t params;
+    fresco_error_t result = parse_decode_options(args, 2, params);
+    if (result != FRESCO_OK) {
+        return result;
     }
 
     // Read input file
     std::vector<uint8_t> input_data;
-    fresco_error_t result = read_file(input_file, input_data);
+    result = read_file(input_file, input_data);
     if (result != FRESCO_OK) {
         std::cerr << "Error: Failed to read input file: " << fresco_error_string(result) << "\n";
         return result;
@@ -203,8 +320,17 @@ fresco_error_t decode_command(const std::vector<std::string>& args) {
     // Decode
     uint8_t* output_data = nullptr;
     size_t output_size = 0;
-    result = fresco_decoder_decode(decoder, input_data.data(), input_data.size(),
-                                 &output_data, &output_size);
+    fresco_file_format_t file_format = FRESCO_FILE_PNM;
+    if (has_jpeg_extension(output_file)) {
+        result = fresco_decoder_decode_jpeg(decoder, input_data.data(), input_data.size(),
+                                            &output_data, &output_size);
+    } else if (file_format_for(output_file, file_format)) {
+        result = fresco_decoder_decode_file(decoder, input_data.data(), input_data.size(),
+                                            file_format, &output_data, &output_size);
+    } else {
+        result = fresco_decoder_decode(decoder, input_data.data(), input_data.size(),
+                                       &output_data, &output_size);
+    }
     if (result != FRESCO_OK) {
         std::cerr << "Error: Failed to decode: " << fresco_error_string(result) << "\n";
         fresco_decoder_destroy(decoder);
@@ -240,17 +366,9 @@ fresco_error_t info_command(const std::vector<std::string>& args) {
 
     std::string input_file = args[0];
 
-    // Read input file
-    std::vector<uint8_t> input_data;
-    fresco_error_t result = read_file(input_file, input_data);
-    if (result != FRESCO_OK) {
-        std::cerr << "Error: Failed to read input file: " << fresco_error_string(result) << "\n";
-        return result;
-    }
-
-    // Get metadata
+    // Only the header boxes are read, so this is cheap on large files
     fresco_metadata_t metadata;
-    result = fresco_get_metadata(input_data.data(), input_data.size(), &metadata);
+    fresco_error_t result = fresco_probe_path(input_file.c_str(), &metadata);
     if (result != FRESCO_OK) {
         std::cerr << "Error: Failed to get metadata: " << fresco_error_string(result) << "\n";
         return result;
@@ -276,6 +394,423 @@ fresco_error_t info_command(const std::vector<std::string>& args) {
     return FRESCO_OK;
 }
 
+// Blocking FIFO with a capacity, so a fast reader cannot run ahead of the
+// coders by more than a few files
+template <typename T>
+class BoundedQueue {
+public:
+    explicit BoundedQueue(size_t capacity) : capacity_(capacity) {}
+
+    void push(T item) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        not_full_.wait(lock, [this] { return items_.size() < capacity_; });
+        items_.push_back(std::move(item));
+        not_empty_.notify_one();
+    }
+
+    // False once the queue is closed and drained
+    bool pop(T& item) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        not_empty_.wait(lock, [this] { return !items_.empty() || closed_; });
+        if (items_.empty()) {
+            return false;
+        }
+        item = std::move(items_.front());
+        items_.pop_front();
+        not_full_.notify_one();
+        return true;
+    }
+
+    void close() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        closed_ = true;
+        not_empty_.notify_all();
+    }
+
+private:
+    size_t capacity_;
+    std::deque<T> items_;
+    bool closed_ = false;
+    std::mutex mutex_;
+    std::condition_variable not_full_;
+    std::condition_variable not_empty_;
+};
+
+struct BatchJob {
+    std::filesystem::path input;
+    std::vector<uint8_t> data;
+};
+
+struct BatchResult {
+    std::filesystem::path output;
+    std::unique_ptr<uint8_t, void (*)(void*)> data{nullptr, fresco_free};
+    size_t size = 0;
+};
+
+// Name of the file an input is coded to in out_dir
+std::filesystem::path batch_output(const std::filesystem::path& out_dir,
+                                   const std::filesystem::path& input, bool encode) {
+    return out_dir / input.filename().replace_extension(encode ? ".fresco" : ".png");
+}
+
+// Codes one file with a worker's own handle; on success fills the output
+// name and buffer
+fresco_error_t batch_encode(fresco_encoder_t* encoder, const std::filesystem::path& out_dir,
+                            const BatchJob& job, BatchResult& result) {
+    uint8_t* output = nullptr;
+    fresco_error_t error =
+        is_jpeg(job.data)
+            ? fresco_encoder_encode_jpeg(encoder, job.data.data(), job.data.size(), &output,
+                                         &result.size)
+            : fresco_encoder_encode(encoder, job.data.data(), job.data.size(), &output,
+                                    &result.size);
+    if (error == FRESCO_OK) {
+        result.data.reset(output);
+        result.output = batch_output(out_dir, job.input, true);
+    }
+    return error;
+}
+
+fresco_error_t batch_decode(fresco_decoder_t* decoder, const std::filesystem::path& out_dir,
+                            const BatchJob& job, BatchResult& result) {
+    uint8_t* output = nullptr;
+    const fresco_error_t error =
+        fresco_decoder_decode_file(decoder, job.data.data(), job.data.size(), FRESCO_FILE_PNG,
+                                   &output, &result.size);
+    if (error == FRESCO_OK) {
+        result.data.reset(output);
+        result.output = batch_output(out_dir, job.input, false);
+    }
+    return error;
+}
+
+// batch encode|decode <in-dir> <out-dir> [-j N] [options]: one thread reads
+// files ahead, N workers code them with one thread each, and this thread
+// writes the results, so reading, coding and writing overlap and the
+// machine runs N coders at a time
+fresco_error_t batch_command(const std::vector<std::string>& args) {
+    if (args.size() < 3 || (args[0] != "encode" && args[0] != "decode")) {
+        std::cerr << "Error: batch command requires encode or decode, an input and an output directory\n";
+        return FRESCO_ERROR_INVALID_PARAMETER;
+    }
+    const bool encode = args[0] == "encode";
+    const std::filesystem::path in_dir = args[1];
+    const std::filesystem::path out_dir = args[2];
+
+    uint32_t jobs = std::max(1u, std::thread::hardware_concurrency());
+    for (size_t i = 3; i + 1 < args.size(); i++) {
+        if (args[i] == "-j" || args[i] == "--jobs") {
+            jobs = std::max(1, std::stoi(args[i + 1]));
+        }
+    }
+    // Files run side by side, each on one thread
+    fresco_encode_params_t encode_params = parse_encode_options(args, 3);
+    fresco_decode_params_t decode_params;
+    if (parse_decode_options(args, 3, decode_params) != FRESCO_OK) {
+        return FRESCO_ERROR_INVALID_PARAMETER;
+    }
+    encode_params.max_threads = 1;
+    decode_params.max_threads = 1;
+
+    std::vector<std::filesystem::path> inputs;
+    std::error_code error_code;
+    for (const auto& entry : std::filesystem::directory_iterator(in_dir, error_code)) {
+        if (entry.is_regular_file()) {
+            inputs.push_back(entry.path());
+        }
+    }
+    if (error_code) {
+        std::cerr << "Error: Failed to list " << in_dir.string() << ": " << error_code.message() << "\n";
+        return FRESCO_ERROR_IO;
+    }
+    std::sort(inputs.begin(), inputs.end());
+    // Inputs that differ only in extension would overwrite each other's
+    // output, so nothing is coded until every name is known to be free
+    std::map<std::filesystem::path, std::filesystem::path> outputs;
+    for (const auto& input : inputs) {
+        const auto [it, added] = outputs.emplace(batch_output(out_dir, input, encode), input);
+        if (!added) {
+            std::cerr << "Error: " << it->second.filename().string() << " and "
+                      << input.filename().string() << " would both be written to "
+                      << it->first.string() << "\n";
+            return FRESCO_ERROR_INVALID_PARAMETER;
+        }
+    }
+    std::filesystem::create_directories(out_dir, error_code);
+    if (error_code) {
+        std::cerr << "Error: Failed to create " << out_dir.string() << ": " << error_code.message() << "\n";
+        return FRESCO_ERROR_IO;
+    }
+
+    const auto start = std::chrono::steady_clock::now();
+    BoundedQueue<BatchJob> pending(2 * jobs);
+    BoundedQueue<BatchResult> finished(2 * jobs);
+    std::mutex report_mutex;
+    size_t failures = 0;
+    fresco_error_t first_error = FRESCO_OK;
+    uint64_t bytes_in = 0;
+    uint64_t bytes_out = 0;
+    auto report = [&](const std::filesystem::path& path, const char* what, fresco_error_t error) {
+        std::lock_guard<std::mutex> lock(report_mutex);
+        std::cerr << "Error: " << what << " " << path.string() << ": " << fresco_error_string(error) << "\n";
+        if (failures++ == 0) {
+            first_error = error;
+        }
+    };
+
+    std::thread reader([&]() {
+        for (const auto& input : inputs) {
+            BatchJob job;
+            job.input = input;
+            const fresco_error_t error = read_file(input.string(), job.data);
+            if (error != FRESCO_OK) {
+                report(input, "Failed to read", error);
+                continue;
+            }
+            pending.push(std::move(job));
+        }
+        pending.close();
+    });
+
+    std::vector<std::thread> workers;
+    std::mutex done_mutex;
+    uint32_t running = jobs;
+    for (uint32_t w = 0; w < jobs; w++) {
+        workers.emplace_back([&]() {
+            fresco_encoder_t* encoder = nullptr;
+            fresco_decoder_t* decoder = nullptr;
+            fresco_error_t error = encode ? fresco_encoder_create(&encoder) :
+                                            fresco_decoder_create(&decoder);
+            if (error == FRESCO_OK) {
+                error = encode ? fresco_encoder_set_params(encoder, &encode_params) :
+                                 fresco_decoder_set_params(decoder, &decode_params);
+            }
+            BatchJob job;
+            while (pending.pop(job)) {
+                if (error != FRESCO_OK) {
+                    report(job.input, "Failed to set up a coder for", error);
+                    continue;
+                }
+                BatchResult result;
+                const fresco_error_t coded = encode ? batch_encode(encoder, out_dir, job, result) :
+                                                      batch_decode(decoder, out_dir, job, result);
+                if (coded != FRESCO_OK) {
+                    report(job.input, encode ? "Failed to encode" : "Failed to decode", coded);
+                    continue;
+                }
+                {
+                    std::lock_guard<std::mutex> lock(report_mutex);
+                    bytes_in += job.data.size();
+                }
+                finished.push(std::move(result));
+            }
+            fresco_encoder_destroy(encoder);
+            fresco_decoder_destroy(decoder);
+            std::lock_guard<std::mutex> lock(done_mutex);
+            if (--running == 0) {
+                finished.close();
+            }
+        });
+    }
+
+    size_t written = 0;
+    BatchResult result;
+    while (finished.pop(result)) {
+        std::ofstream file(result.output, std::ios::binary);
+        file.write(reinterpret_cast<const char*>(result.data.get()), result.size);
+        if (!file.good()) {
+            report(result.output, "Failed to write", FRESCO_ERROR_IO);
+            continue;
+        }
+        bytes_out += result.size;
+        written++;
+    }
+    reader.join();
+    for (auto& worker : workers) {
+        worker.join();
+    }
+
+    const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::cout << (encode ? "Encoded " : "Decoded ") << written << " of " << inputs.size()
+              << " files with " << jobs << " jobs in " << seconds << " s ("
+              << (seconds > 0.0 ? written / seconds : 0.0) << " files/s)\n";
+    std::cout << "Input size: " << bytes_in << " bytes\n";
+    std::cout << "Output size: " << bytes_out << " bytes\n";
+    return first_error;
+}
+
+// Where pyramid tiles go, as PNG: <stem>_files/<level>/<column>_<row> beside
+// <stem>.dzi for DeepZoom, or <z>/<column>/<row> for XYZ, where z counts
+// from the level that fits in one tile
+struct PyramidLayout {
+    std::filesystem::path out_dir;
+    std::filesystem::path files_dir;
+    bool xyz = false;
+    uint32_t first_level = 0;
+    const char* extension = ".png";
+    std::atomic<uint64_t> tiles{0};
+};
+
+fresco_error_t write_pyramid_tile(uint32_t level, uint32_t column, uint32_t row,
+                                  const fresco_image_t* tile, void* user_data) {
+    PyramidLayout* layout = static_cast<PyramidLayout*>(user_data);
+    std::filesystem::path path;
+    if (layout->xyz) {
+        path = layout->out_dir / std::to_string(level - layout->first_level) /
+               std::to_string(column) / (std::to_string(row) + layout->extension);
+    } else {
+        path = layout->files_dir / std::to_string(level) /
+               (std::to_string(column) + "_" + std::to_string(row) + layout->extension);
+    }
+    uint8_t* data = nullptr;
+    size_t size = 0;
+    const fresco_error_t error = fresco_write_image_file(tile, FRESCO_FILE_PNG, &data, &size);
+    if (error != FRESCO_OK) {
+        return error;
+    }
+    std::unique_ptr<uint8_t, void (*)(void*)> png(data, fresco_free);
+    std::ofstream file(path, std::ios::binary);
+    file.write(reinterpret_cast<const char*>(png.get()), size);
+    if (!file.good()) {
+        return FRESCO_ERROR_IO;
+    }
+    layout->tiles++;
+    return FRESCO_OK;
+}
+
+// pyramid <input> <out-dir> [--tile N] [--overlap N] [--layout dz|xyz]:
+// every raster tile is decoded once and each pyramid level down to the
+// wavelet depth comes from the inverse transform, so the image is never
+// decoded at full size and then downsampled over and over
+fresco_error_t pyramid_command(const std::vector<std::string>& args) {
+    if (args.size() < 2) {
+        std::cerr << "Error: pyramid command requires an input file and an output directory\n";
+        return FRESCO_ERROR_INVALID_PARAMETER;
+    }
+    const std::filesystem::path input_file = args[0];
+    PyramidLayout layout;
+    layout.out_dir = args[1];
+
+    fresco_pyramid_params_t pyramid = {};
+    bool overlap_set = false;
+    for (size_t i = 2; i + 1 < args.size(); i++) {
+        if (args[i] == "--tile") {
+            pyramid.tile_size = std::stoi(args[++i]);
+        } else if (args[i] == "--overlap") {
+            pyramid.overlap = std::stoi(args[++i]);
+            overlap_set = true;
+        } else if (args[i] == "--layout") {
+            const std::string& name = args[++i];
+            if (name != "dz" && name != "xyz") {
+                std::cerr << "Error: --layout must be dz or xyz, not '" << name << "'\n";
+                return FRESCO_ERROR_INVALID_PARAMETER;
+            }
+            layout.xyz = name == "xyz";
+        }
+    }
+    if (pyramid.tile_size == 0) {
+        // As the library resolves it, so the .dzi and XYZ levels match the tiles
+        pyramid.tile_size = FRESCO_PYRAMID_TILE_SIZE;
+    }
+    if (!overlap_set) {
+        // DeepZoom viewers blend across one shared pixel; XYZ tiles abut
+        pyramid.overlap = layout.xyz ? 0 : 1;
+    }
+    fresco_decode_params_t params;
+    fresco_error_t result = parse_decode_options(args, 2, params);
+    if (result != FRESCO_OK) {
+        return result;
+    }
+
+    std::vector<uint8_t> input_data;
+    result = read_file(input_file.string(), input_data);
+    if (result != FRESCO_OK) {
+        std::cerr << "Error: Failed to read input file: " << fresco_error_string(result) << "\n";
+        return result;
+    }
+    fresco_metadata_t metadata = {};
+    result = fresco_get_metadata(input_data.data(), input_data.size(), &metadata);
+    if (result != FRESCO_OK) {
+        std::cerr << "Error: Failed to read metadata: " << fresco_error_string(result) << "\n";
+        return result;
+    }
+
+    // Level n is full size and each level below halves it, rounding up;
+    // directories are made up front so tiles can be written from any thread
+    std::vector<std::pair<uint32_t, uint32_t>> sizes;
+    for (uint32_t width = metadata.width, height = metadata.height;;
+         width = (width + 1) / 2, height = (height + 1) / 2) {
+        sizes.insert(sizes.begin(), {width, height});
+        if (width <= 1 && height <= 1) {
+            break;
+        }
+    }
+    const uint32_t tile_size = pyramid.tile_size;
+    if (layout.xyz) {
+        while (layout.first_level + 1 < sizes.size() &&
+               std::max(sizes[layout.first_level + 1].first,
+                        sizes[layout.first_level + 1].second) <= tile_size) {
+            layout.first_level++;
+        }
+        pyramid.min_level = layout.first_level;
+    }
+    const std::string stem = input_file.stem().string();
+    layout.files_dir = layout.out_dir / (stem + "_files");
+    std::error_code error_code;
+    for (uint32_t level = pyramid.min_level; level < sizes.size(); level++) {
+        if (!layout.xyz) {
+            std::filesystem::create_directories(layout.files_dir / std::to_string(level), error_code);
+            continue;
+        }
+        const uint32_t columns = (sizes[level].first + tile_size - 1) / tile_size;
+        for (uint32_t column = 0; column < columns && !error_code; column++) {
+            std::filesystem::create_directories(layout.out_dir /
+                                                    std::to_string(level - layout.first_level) /
+                                                    std::to_string(column),
+                                                error_code);
+        }
+    }
+    if (error_code) {
+        std::cerr << "Error: Failed to create " << layout.out_dir.string() << ": " << error_code.message() << "\n";
+        return FRESCO_ERROR_IO;
+    }
+
+    fresco_decoder_t* decoder = nullptr;
+    result = fresco_decoder_create(&decoder);
+    if (result == FRESCO_OK) {
+        result = fresco_decoder_set_params(decoder, &params);
+    }
+    const auto start = std::chrono::steady_clock::now();
+    if (result == FRESCO_OK) {
+        result = fresco_decoder_decode_pyramid(decoder, input_data.data(), input_data.size(),
+                                               &pyramid, write_pyramid_tile, &layout);
+    }
+    fresco_decoder_destroy(decoder);
+    if (result != FRESCO_OK) {
+        std::cerr << "Error: Failed to write the pyramid: " << fresco_error_string(result) << "\n";
+        return result;
+    }
+
+    if (!layout.xyz) {
+        std::ofstream dzi(layout.out_dir / (stem + ".dzi"));
+        dzi << "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+            << "<Image xmlns=\"http://schemas.microsoft.com/deepzoom/2008\" Format=\""
+            << (layout.extension + 1) << "\" Overlap=\"" << pyramid.overlap << "\" TileSize=\""
+            << tile_size << "\">\n"
+            << "  <Size Width=\"" << metadata.width << "\" Height=\"" << metadata.height << "\"/>\n"
+            << "</Image>\n";
+        if (!dzi.good()) {
+            std::cerr << "Error: Failed to write " << stem << ".dzi\n";
+            return FRESCO_ERROR_IO;
+        }
+    }
+
+    const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::cout << "Wrote " << layout.tiles << " tiles in " << (sizes.size() - pyramid.min_level)
+              << " levels to " << layout.out_dir.string() << " in " << seconds << " s\n";
+    return FRESCO_OK;
+}
+
 int main(int argc, char* argv[]) {
     if (argc < 2) {
         print_usage(argv[0]);
@@ -300,6 +835,23 @@ int main(int argc, char* argv[]) {
         args.push_back(argv[i]);
     }
 
+    // --trace applies to every command, so it is taken out before dispatch
+    TraceFile trace;
+    for (size_t i = 0; i < args.size(); i++) {
+        if (args[i] == "--trace" && i + 1 < args.size()) {
+            trace.file = std::fopen(args[i + 1].c_str(), "w");
+            if (!trace.file) {
+                std::cerr << "Error: Failed to open trace file " << args[i + 1] << "\n";
+                return 1;
+            }
+            if (fresco_set_trace_sink(write_trace_event, &trace) != FRESCO_OK) {
+                std::cerr << "Warning: this build of FRESCO has no tracing\n";
+            }
+            args.erase(args.begin() + i, args.begin() + i + 2);
+            break;
+        }
+    }
+
     fresco_error_t result = FRESCO_ERROR_INVALID_PARAMETER;
 
     if (command == "encode") {
@@ -311,12 +863,22 @@ int main(int argc, char* argv[]) {
         result = encode_command(args);
     } else if (command == "info") {
         result = info_command(args);
+    } else if (command == "batch") {
+        result = batch_command(args);
+    } else if (command == "pyramid") {
+        result = pyramid_command(args);
     } else {
         std::cerr << "Error: Unknown command '" << command << "'\n";
         print_usage(argv[0]);
         return 1;
     }
 
+    if (trace.file) {
+        fresco_set_trace_sink(nullptr, nullptr);
+        std::fputs(trace.first ? "[]\n" : "\n]\n", trace.file);
+        std::fclose(trace.file);
+    }
+
     if (result != FRESCO_OK) {
         std::cerr << "Error: " << fresco_error_string(result) << "\n";
         return 1;